@@ -1,8 +1,15 @@
+#include "daemon.hpp"
+#include "startup_trace.hpp"
 #include <facter/version.h>
 #include <facter/logging/logging.hpp>
+#include <facter/execution/execution.hpp>
 #include <facter/facts/collection.hpp>
+#include <facter/facts/uploader.hpp>
 #include <facter/ruby/ruby.hpp>
+#include <facter/util/trace.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
 // Note the caveats in nowide::cout/cerr; they're not synchronized with stdio.
 // Thus they can't be relied on to flush before program exit.
 // Use endl/ends or flush to force synchronization when necessary.
@@ -18,8 +25,11 @@
 
 #include <iostream>
 #include <set>
+#include <map>
+#include <chrono>
 #include <algorithm>
 #include <iterator>
+#include <limits>
 
 using namespace std;
 using namespace facter::facts;
@@ -96,34 +106,246 @@ void log_queries(set<string> const& queries)
     log(level::info, "requested queries: %1%.", output.str());
 }
 
+chrono::milliseconds parse_duration(string const& description, string const& value, string duration)
+{
+    // The duration is in seconds unless suffixed with ms, s, m, h, or d
+    int64_t multiplier = 1000;
+    if (boost::ends_with(duration, "ms")) {
+        multiplier = 1;
+        duration.resize(duration.size() - 2);
+    } else if (!duration.empty()) {
+        switch (duration.back()) {
+            case 's': multiplier = 1000; duration.pop_back(); break;
+            case 'm': multiplier = 1000 * 60; duration.pop_back(); break;
+            case 'h': multiplier = 1000 * 60 * 60; duration.pop_back(); break;
+            case 'd': multiplier = 1000 * 60 * 60 * 24; duration.pop_back(); break;
+        }
+    }
+
+    int64_t amount;
+    try {
+        amount = boost::lexical_cast<int64_t>(duration);
+    } catch (boost::bad_lexical_cast&) {
+        throw po::error("invalid " + description + " '" + value + "': expected a duration such as 500ms, 30m, 12h, or 7d.");
+    }
+    return chrono::milliseconds(amount * multiplier);
+}
+
+map<string, chrono::seconds> parse_ttls(vector<string> const& values)
+{
+    // Each TTL is specified as <resolver>=<duration>
+    map<string, chrono::seconds> ttls;
+    for (auto const& value : values) {
+        auto pos = value.rfind('=');
+        string name = pos == string::npos ? string() : boost::trim_copy(value.substr(0, pos));
+        string duration = pos == string::npos ? string() : boost::trim_copy(value.substr(pos + 1));
+        if (name.empty() || duration.empty()) {
+            throw po::error("invalid TTL '" + value + "': expected <resolver>=<duration>.");
+        }
+        ttls[name] = chrono::duration_cast<chrono::seconds>(parse_duration("TTL", value, duration));
+    }
+    return ttls;
+}
+
+chrono::milliseconds parse_timeouts(vector<string> const& values, map<string, chrono::milliseconds>& timeouts)
+{
+    // Each timeout is specified as [<resolver>=]<duration>; a timeout without a resolver applies to every resolver
+    chrono::milliseconds timeout(0);
+    for (auto const& value : values) {
+        auto pos = value.rfind('=');
+        string name = pos == string::npos ? string() : boost::trim_copy(value.substr(0, pos));
+        string duration = boost::trim_copy(pos == string::npos ? value : value.substr(pos + 1));
+        if ((pos != string::npos && name.empty()) || duration.empty()) {
+            throw po::error("invalid resolver timeout '" + value + "': expected [<resolver>=]<duration>.");
+        }
+        if (name.empty()) {
+            timeout = parse_duration("resolver timeout", value, duration);
+        } else {
+            timeouts[name] = parse_duration("resolver timeout", value, duration);
+        }
+    }
+    return timeout;
+}
+
+vector<unsigned int> parse_cpu_set(string const& value)
+{
+    // The processors are specified as a list of numbers and ranges (e.g. "0-1,6"), as by taskset
+    vector<string> parts;
+    boost::split(parts, value, boost::is_any_of(","));
+    vector<unsigned int> cpus;
+    for (auto const& part : parts) {
+        auto pos = part.find('-');
+        try {
+            auto first = boost::lexical_cast<unsigned int>(boost::trim_copy(part.substr(0, pos)));
+            auto last = pos == string::npos ? first : boost::lexical_cast<unsigned int>(boost::trim_copy(part.substr(pos + 1)));
+            if (last < first || last >= 1024) {
+                throw boost::bad_lexical_cast();
+            }
+            for (auto cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (boost::bad_lexical_cast&) {
+            throw po::error("invalid CPU set '" + value + "': expected a list of processors such as 0-1,6.");
+        }
+    }
+    sort(cpus.begin(), cpus.end());
+    cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+void print_timings(collection& facts)
+{
+    auto milliseconds = [](chrono::nanoseconds duration) {
+        return chrono::duration_cast<chrono::duration<double, milli>>(duration).count();
+    };
+
+    // Print the table to stderr so that the fact output remains parsable; write queued messages first
+    flush_logging();
+    boost::format row("%-32s %6s %12s %12s %10s %12s %6s\n");
+    boost::nowide::cerr << row % "resolver" % "runs" % "wall (ms)" % "cpu (ms)" % "processes" % "bytes read" % "http";
+    for (auto const& timing : facts.timings()) {
+        boost::nowide::cerr <<
+            row %
+            timing.name %
+            timing.resolutions %
+            (boost::format("%.3f") % milliseconds(timing.wall_time)) %
+            (boost::format("%.3f") % milliseconds(timing.cpu_time)) %
+            timing.processes %
+            timing.bytes_read %
+            timing.http_requests;
+    }
+    boost::nowide::cerr << flush;
+}
+
+void answer_batch(collection& facts, istream& input, ostream& output, bool project)
+{
+    // Each answer is flushed so that a script can read it before writing its next line
+    // Resolvers are only resolved for the first line that needs them; later lines reuse their facts, and a resolver
+    // that skipped values the earlier lines didn't query is resolved again for the lines that need them
+    string line;
+    while (getline(input, line)) {
+        vector<string> tokens;
+        boost::trim(line);
+        boost::split(tokens, line, boost::is_space(), boost::token_compress_on);
+        facts.write(output, format::json_compact, parse_queries(tokens), project);
+        output << '\n' << flush;
+    }
+}
+
+void print_memory_usage(collection& facts)
+{
+    auto usage = facts.memory_usage();
+    size_t total = 0;
+    for (auto const& fact : usage) {
+        total += fact.bytes;
+    }
+
+    // Print the table to stderr so that the fact output remains parsable; write queued messages first
+    flush_logging();
+    boost::format row("%-40s %12s %8s\n");
+    boost::nowide::cerr << row % "fact" % "bytes" % "%";
+    for (auto const& fact : usage) {
+        boost::nowide::cerr <<
+            row %
+            fact.name %
+            fact.bytes %
+            (boost::format("%.1f") % (total == 0 ? 0.0 : 100.0 * fact.bytes / total));
+    }
+    boost::nowide::cerr << row % "total" % total % "100.0" << flush;
+}
+
 int main(int argc, char **argv)
 {
+    trace_startup("static initializers");
     try
     {
         // Fix args on Windows to be UTF-8
         boost::nowide::args arg_utf8(argc, argv);
 
-        // Setup logging
-        setup_logging(boost::nowide::cerr);
+        // Setup logging; messages are written on a separate thread so that resolving threads don't wait on stderr
+        // The thread and the sink are only created once a message is logged, so quiet runs don't pay for them
+        setup_async_logging(boost::nowide::cerr);
+        trace_startup("logging");
 
         vector<string> external_directories;
         vector<string> custom_directories;
+        vector<string> plugin_directories;
+        vector<string> ttls;
+        vector<string> resolver_timeouts;
+        vector<string> blocked;
+        vector<string> allowed;
+        vector<string> included_interfaces;
+        vector<string> excluded_interfaces;
+        vector<string> excluded_filesystems;
+        vector<string> sampled_facts;
+        chrono::milliseconds filesystem_timeout = chrono::seconds(2);
+        chrono::milliseconds fqdn_timeout = chrono::seconds(5);
 
         // Build a list of options visible on the command line
         // Keep this list sorted alphabetically
         po::options_description visible_options("");
         visible_options.add_options()
+            ("allow", po::value<vector<string>>(&allowed)->composing(), "A resolver to resolve even if it is blocked or expensive (e.g. \"EC2\").")
+            ("batch", "Answer lines of queries read from stdin in order, writing one line of compact JSON for each; every line is answered from the same facts, which are only resolved once.")
+            ("block", po::value<vector<string>>(&blocked)->composing(), "A resolver to never resolve (e.g. \"GCE\").")
+            ("cache-file", po::value<string>(), "The file to cache the facts of resolvers with a TTL in; the location of the Ruby library is also remembered in a file beside it.")
+            ("changes-since-last-run", "Output only the facts added, changed, or removed since the last run with the same cache file; the cache file keeps a hash of every fact.")
             ("color", "Enables color output.")
+            ("config", po::value<string>(), "A file of options to use, one \"name = value\" per line; options on the command line take precedence.")
+            ("cost-budget", "Skip resolvers that are expensive (e.g. those making network requests) unless their facts are queried.")
+            ("cpu-set", po::value<string>(), "The processors to run facter and its commands on in low impact mode (e.g. a host's housekeeping processors \"0-1\").")
+            ("custom-cache-dir", po::value<string>(), "A directory to cache compiled custom facts (requires Ruby 2.3 or later) and the facts each custom fact file defines in, so a query loads only the files it needs.")
             ("custom-dir", po::value<vector<string>>(&custom_directories), "A directory to use for custom facts.")
+            ("custom-workers", po::value<unsigned int>(), "The number of worker processes to resolve custom facts in once the native facts are resolved (not supported on Windows).")
+            ("daemon", "Run as a daemon that answers queries on the socket given by the socket option.")
             ("debug,d", "Enable debug output.")
+            ("exclude-filesystem", po::value<vector<string>>(&excluded_filesystems)->composing(), "A file system type whose mountpoints are not resolved (e.g. \"nfs\" or \"fuse.sshfs\").")
+            ("exclude-interface", po::value<vector<string>>(&excluded_interfaces)->composing(), "A regular expression of network interfaces to not resolve (e.g. \"veth.*\").")
             ("external-dir", po::value<vector<string>>(&external_directories), "A directory to use for external facts.")
+            ("filesystem-timeout", po::value<string>(), "The time limit for querying the size of a remote file system mountpoint (e.g. \"500ms\"); defaults to 2s.")
+            ("fqdn-timeout", po::value<string>(), "The time limit for looking up the fully qualified domain name of the host (e.g. \"1s\"), after which the domain is taken from /etc/resolv.conf; defaults to 5s.")
             ("help", "Print this help message.")
+            ("interface", po::value<vector<string>>(&included_interfaces)->composing(), "A regular expression of network interfaces to resolve (e.g. \"eth.*\"); by default, every interface that is not excluded is resolved.")
+            ("interface-summary", "Count the network interfaces of each class (e.g. \"veth\") in the networking fact, including those that are not resolved.")
             ("json,j", "Output in JSON format.")
+            ("json-compact", "Output in JSON format without whitespace.")
+            ("legacy-on-demand", "Only add hidden legacy facts (e.g. ipaddress_eth0) when a query names them; custom facts can't look them up otherwise.")
+            ("log-format", po::value<string>()->default_value("text"), "Set the format of log messages.\nSupported formats are: text, and json (one object per line tagged with the resolver, its elapsed time, and any child process or HTTP request).")
             ("log-level,l", po::value<level>()->default_value(level::warning, "warn"), "Set logging level.\nSupported levels are: none, trace, debug, info, warn, error, and fatal.")
+            ("low-impact", "Run facter and every command it starts at the lowest CPU and I/O priority, resolving on one thread (or one per processor of cpu-set), so that it disturbs other services as little as possible.")
+            ("low-memory", "Write each fact as soon as it is resolved and release it rather than holding every fact until output; facts are resolved on one thread, written unsorted, and Ruby is only loaded for custom-dir.")
+            ("max-ttl", po::value<string>(), "The longest time-to-live of cached facts that don't change (e.g. \"1d\"): each time a resolver's cached facts expire unchanged, their TTL doubles up to this.")
+            ("memory-report", "Print the approximate memory used by each fact's name and value to stderr, largest first.")
+            ("metrics-port", po::value<unsigned int>(), "A port on the loopback address the daemon serves Prometheus metrics on at /metrics: resolver times, cache hits and misses, child processes, HTTP requests, and memory use.")
+            ("min-refresh-interval", po::value<unsigned int>()->default_value(0), "The fewest seconds between daemon refreshes of a fact that changes; facts that don't change are refreshed less and less often, up to the refresh interval. 0 refreshes every fact at the refresh interval.")
+            ("msgpack", "Output in MessagePack (binary) format.")
             ("no-color", "Disables color output.")
             ("no-custom-facts", "Disables custom facts.")
             ("no-external-facts", "Disables external facts.")
+            ("no-ruby-gc", "Disables Ruby's garbage collector while custom facts are loaded and resolved; faster, but uses more memory.")
+            ("plugin-dir", po::value<vector<string>>(&plugin_directories)->composing(), "A directory of native fact plugins (shared libraries built with facter/facts/plugin.hpp) to load.")
+            ("powershell-host", "Run every external PowerShell fact script in one PowerShell process on Windows rather than starting PowerShell for each script.")
+            ("prime-cache", "Resolve the facts that do not change until the host is rebooted (e.g. DMI, disks, processors, cloud metadata, SSH keys, and the operating system release) into the cache file and output nothing; later runs with the same cache file load them until the host is rebooted.")
+            ("projection", "Output queried values nested beneath the facts they were queried from rather than by query (not supported by the default format).")
+            ("publish-file", po::value<string>(), "A file the daemon publishes its facts to after every refresh; local processes map it into memory to read facts without connecting to the daemon.")
+            ("refresh-interval", po::value<unsigned int>()->default_value(300), "The number of seconds between daemon fact refreshes.")
+            ("resolver-timeout", po::value<vector<string>>(&resolver_timeouts), "The time limit of every resolver (e.g. \"10s\") or of a specific resolver (e.g. \"networking=2s\").")
+            ("root", po::value<string>(), "The root directory of a container or chroot to resolve facts from files beneath.")
+            ("sample-fact", po::value<vector<string>>(&sampled_facts)->composing(), "A fact the daemon samples at the sample interval (e.g. \"mountpoints\"); defaults to load_averages, memory, pressure, system_uptime, and utilization.")
+            ("sample-history", po::value<unsigned int>()->default_value(60), "The number of daemon samples to keep in the sample_history fact.")
+            ("sample-interval", po::value<unsigned int>()->default_value(0), "The number of seconds between daemon samples of frequently changing facts; 0 disables sampling.")
+            ("socket", po::value<string>(), "The Unix domain socket of the daemon.\nWithout the daemon option, queries are answered by a running daemon if one is listening.")
+            ("spawn-helper", "Start commands from a helper process started before Ruby is loaded, so that facter is never forked once it has grown large.")
+            ("stream", "Output each fact as a line of JSON (NDJSON) as soon as it is resolved, rather than once every fact is resolved.")
+            ("threads", po::value<unsigned int>()->default_value(1), "The number of threads to use when resolving facts and formatting their output.")
+            ("timeout", po::value<string>(), "The time limit for resolving facts (e.g. \"30s\"); only the facts resolved in time are output.")
+            ("timing", "Print the time spent in each resolver, custom fact file, and custom fact resolution to stderr.")
             ("trace", "Enable backtraces for custom facts.")
+            ("trace-file", po::value<string>(), "A file to write a Chrome trace (viewable with chrome://tracing or Perfetto) of the run to, with a span for each resolver, child process, HTTP request, external fact file, and custom fact file load and resolution on the thread that did it.")
+            ("ttl", po::value<vector<string>>(&ttls), "The time-to-live of a resolver's or an external fact file's cached facts (e.g. \"desktop management interface=7d\" or \"cmdb.sh=1h\").")
+            ("unavailable-ttl", po::value<string>()->default_value("1d"), "How long to remember, until the next reboot, that a resolver's facts are unavailable (e.g. EC2 on a host that isn't an instance); 0 disables.")
+            ("upload-changes", "Upload only the facts added, changed, or removed since the previous upload; the first upload of a process, and so of every run but the daemon's, has every fact.")
+            ("upload-url", po::value<string>(), "An endpoint to POST facts to, as gzip-compressed MessagePack, instead of outputting them; the daemon uploads after every refresh, and retries and batches uploads that fail.")
             ("verbose", "Enable verbose (info) output.")
             ("version,v", "Print the version and exit.")
             ("yaml,y", "Output in YAML format.");
@@ -142,6 +364,13 @@ int main(int argc, char **argv)
         positional_options.add("query", -1);
 
         po::variables_map vm;
+        map<string, chrono::seconds> cache_ttls;
+        chrono::seconds unavailable_ttl(0);
+        chrono::seconds max_ttl(0);
+        vector<unsigned int> cpus;
+        chrono::milliseconds resolver_timeout(0);
+        map<string, chrono::milliseconds> timeouts;
+        chrono::milliseconds timeout(0);
         try {
             po::store(po::command_line_parser(argc, argv).
                       options(command_line_options).positional(positional_options).run(), vm);
@@ -152,14 +381,19 @@ int main(int argc, char **argv)
                 return EXIT_SUCCESS;
             }
 
+            // Options in the config file are used only if not given on the command line
+            if (vm.count("config")) {
+                po::store(po::parse_config_file<char>(vm["config"].as<string>().c_str(), visible_options), vm);
+            }
+
             po::notify(vm);
 
             // Check for conflicting options
             if (vm.count("color") && vm.count("no-color")) {
                 throw po::error("color and no-color options conflict: please specify only one.");
             }
-            if (vm.count("json") && vm.count("yaml")) {
-                throw po::error("json and yaml options conflict: please specify only one.");
+            if (vm.count("json") + vm.count("json-compact") + vm.count("msgpack") + vm.count("stream") + vm.count("yaml") > 1) {
+                throw po::error("json, json-compact, msgpack, stream, and yaml options conflict: please specify only one.");
             }
             if (vm.count("no-external-facts") && vm.count("external-dir")) {
                 throw po::error("no-external-facts and external-dir options conflict: please specify only one.");
@@ -167,11 +401,144 @@ int main(int argc, char **argv)
             if (vm.count("no-custom-facts") && vm.count("custom-dir")) {
                 throw po::error("no-custom-facts and custom-dir options conflict: please specify only one.");
             }
+            if (vm.count("no-custom-facts") && vm.count("custom-cache-dir")) {
+                throw po::error("no-custom-facts and custom-cache-dir options conflict: please specify only one.");
+            }
+            if (vm.count("no-custom-facts") && vm.count("custom-workers")) {
+                throw po::error("no-custom-facts and custom-workers options conflict: please specify only one.");
+            }
+            if (vm.count("no-custom-facts") && vm.count("no-ruby-gc")) {
+                throw po::error("no-custom-facts and no-ruby-gc options conflict: please specify only one.");
+            }
+            if (vm.count("daemon") && !vm.count("socket")) {
+                throw po::error("daemon option requires socket: please specify a socket path.");
+            }
+            if (vm.count("publish-file") && !vm.count("daemon")) {
+                throw po::error("publish-file option requires daemon: please specify daemon.");
+            }
+            if (vm.count("metrics-port") && !vm.count("daemon")) {
+                throw po::error("metrics-port option requires daemon: please specify daemon.");
+            }
+            if (vm.count("metrics-port") && (vm["metrics-port"].as<unsigned int>() == 0 || vm["metrics-port"].as<unsigned int>() > 65535)) {
+                throw po::error("metrics-port option must be a port from 1 to 65535.");
+            }
+            if (vm.count("batch") && vm.count("query")) {
+                throw po::error("batch option conflicts with queries: please specify queries on stdin.");
+            }
+            if (vm.count("batch") && (vm.count("daemon") || vm.count("socket"))) {
+                throw po::error("batch option conflicts with daemon and socket: please specify only one.");
+            }
+            if (vm.count("batch") && (vm.count("json") + vm.count("msgpack") + vm.count("stream") + vm.count("yaml") > 0)) {
+                throw po::error("batch option conflicts with output formats: each answer is written as a line of compact JSON.");
+            }
+            if (vm.count("batch") && vm.count("low-memory")) {
+                throw po::error("batch and low-memory options conflict: facts are released as they are written in low memory mode.");
+            }
+            if (vm.count("changes-since-last-run") && !vm.count("cache-file")) {
+                throw po::error("changes-since-last-run option requires cache-file: please specify a cache file.");
+            }
+            if (vm.count("changes-since-last-run") && vm.count("query")) {
+                throw po::error("changes-since-last-run option conflicts with queries: every fact is compared.");
+            }
+            if (vm.count("changes-since-last-run") && (vm.count("batch") + vm.count("daemon") + vm.count("low-memory") > 0)) {
+                throw po::error("changes-since-last-run option conflicts with batch, daemon, and low-memory: please specify only one.");
+            }
+            if (vm.count("daemon") && vm.count("query")) {
+                throw po::error("daemon option conflicts with queries: please specify queries when querying the daemon.");
+            }
+            if (vm.count("trace-file") && vm.count("daemon")) {
+                throw po::error("trace-file and daemon options conflict: please specify only one.");
+            }
+            if (vm.count("low-memory") && vm.count("daemon")) {
+                throw po::error("low-memory and daemon options conflict: please specify only one.");
+            }
+            if (vm.count("memory-report") && vm.count("daemon")) {
+                throw po::error("memory-report and daemon options conflict: please specify only one.");
+            }
+            if (vm.count("memory-report") && vm.count("stream")) {
+                throw po::error("memory-report and stream options conflict: facts are released as they are written when streaming.");
+            }
+            if (vm.count("memory-report") && vm.count("low-memory")) {
+                throw po::error("memory-report and low-memory options conflict: facts are released as they are written in low memory mode.");
+            }
+            if (vm.count("low-memory") && vm.count("msgpack")) {
+                throw po::error("low-memory and msgpack options conflict: MessagePack output needs every fact before writing.");
+            }
+            if (vm.count("prime-cache") && !vm.count("cache-file")) {
+                throw po::error("prime-cache option requires cache-file: please specify a cache file.");
+            }
+            if (vm.count("prime-cache") && (vm.count("query") + vm.count("batch") + vm.count("daemon") + vm.count("changes-since-last-run") > 0)) {
+                throw po::error("prime-cache option conflicts with queries, batch, daemon, and changes-since-last-run: please specify only one.");
+            }
+            if (vm.count("upload-url")) {
+#ifndef USE_CURL
+                throw po::error("upload-url option requires facter to be built with libcurl support.");
+#endif
+                if (vm.count("query") + vm.count("batch") + vm.count("changes-since-last-run") + vm.count("prime-cache") > 0) {
+                    throw po::error("upload-url option conflicts with queries, batch, changes-since-last-run, and prime-cache: please specify only one.");
+                }
+            }
+            if (vm.count("upload-changes") && !vm.count("upload-url")) {
+                throw po::error("upload-changes option requires upload-url: please specify an endpoint.");
+            }
+            if (vm.count("ttl") && !vm.count("cache-file")) {
+                throw po::error("ttl option requires cache-file: please specify a cache file.");
+            }
+            if (!vm["unavailable-ttl"].defaulted() && !vm.count("cache-file")) {
+                throw po::error("unavailable-ttl option requires cache-file: please specify a cache file.");
+            }
+            if (vm.count("cpu-set") && !vm.count("low-impact")) {
+                throw po::error("cpu-set option requires low-impact: please specify low-impact.");
+            }
+            if (vm.count("max-ttl") && !vm.count("cache-file")) {
+                throw po::error("max-ttl option requires cache-file: please specify a cache file.");
+            }
+            if (!vm["min-refresh-interval"].defaulted() && !vm.count("daemon")) {
+                throw po::error("min-refresh-interval option requires daemon: please specify daemon.");
+            }
+            auto const& log_format = vm["log-format"].as<string>();
+            if (log_format != "text" && log_format != "json") {
+                throw po::error("invalid log format '" + log_format + "': expected text or json.");
+            }
             if ((vm.count("debug") + vm.count("verbose") + (vm["log-level"].defaulted() ? 0 : 1)) > 1) {
                 throw po::error("debug, verbose, and log-level options conflict: please specify only one.");
             }
+
+            cache_ttls = parse_ttls(ttls);
+            auto unavailable = vm["unavailable-ttl"].as<string>();
+            unavailable_ttl = chrono::duration_cast<chrono::seconds>(parse_duration("unavailable TTL", unavailable, boost::trim_copy(unavailable)));
+            if (vm.count("cpu-set")) {
+                cpus = parse_cpu_set(vm["cpu-set"].as<string>());
+            }
+            if (vm.count("max-ttl")) {
+                auto value = vm["max-ttl"].as<string>();
+                max_ttl = chrono::duration_cast<chrono::seconds>(parse_duration("maximum TTL", value, boost::trim_copy(value)));
+            }
+            resolver_timeout = parse_timeouts(resolver_timeouts, timeouts);
+            if (vm.count("timeout")) {
+                auto value = vm["timeout"].as<string>();
+                timeout = parse_duration("timeout", value, boost::trim_copy(value));
+            }
+            if (vm.count("filesystem-timeout")) {
+                auto value = vm["filesystem-timeout"].as<string>();
+                filesystem_timeout = parse_duration("file system timeout", value, boost::trim_copy(value));
+            }
+            if (vm.count("fqdn-timeout")) {
+                auto value = vm["fqdn-timeout"].as<string>();
+                fqdn_timeout = parse_duration("FQDN timeout", value, boost::trim_copy(value));
+            }
+            for (auto const* expressions : { &included_interfaces, &excluded_interfaces }) {
+                for (auto const& expression : *expressions) {
+                    try {
+                        boost::regex validated(expression);
+                    } catch (boost::regex_error const& ex) {
+                        throw po::error("invalid interface expression '" + expression + "': " + ex.what() + ".");
+                    }
+                }
+            }
         }
         catch (exception& ex) {
+            flush_logging();
             boost::nowide::cerr << colorize(level::error) << "error: " << ex.what() << colorize() << "\n" << endl;
             help(visible_options);
             return EXIT_FAILURE;
@@ -183,6 +550,11 @@ int main(int argc, char **argv)
             return EXIT_SUCCESS;
         }
 
+        // Switch to structured log messages if requested
+        if (vm["log-format"].as<string>() == "json") {
+            setup_structured_logging(boost::nowide::cerr);
+        }
+
         // Set colorization; if no option was specified, use the default
         if (vm.count("color")) {
             set_colorization(true);
@@ -201,58 +573,193 @@ int main(int argc, char **argv)
 
         log_command_line(argc, argv);
 
-        // Initialize Ruby in main
-        bool ruby = facter::ruby::initialize(vm.count("trace") == 1);
-
         // Build a set of queries from the command line
         set<string> queries;
         if (vm.count("query")) {
-            for (auto const &q : vm["query"].as<vector<string>>()) {
-                // Strip whitespace and query delimiter
-                string query = boost::trim_copy_if(q, boost::is_any_of(".") || boost::is_space());
-
-                // Erase any duplicate consecutive delimiters
-                query.erase(unique(query.begin(), query.end(), [](char a, char b) {
-                    return a == b && a == '.';
-                }), query.end());
-
-                // Don't insert empty queries
-                if (query.empty()) {
-                    continue;
-                }
-
-                queries.emplace(move(query));
-            }
+            queries = parse_queries(vm["query"].as<vector<string>>());
         }
 
         log_queries(queries);
+        trace_startup("options");
 
-        collection facts;
-        facts.add_default_facts();
-
-        if (!vm.count("no-external-facts")) {
-            facts.add_external_facts(external_directories);
-        }
-
-        // Add the environment facts
-        facts.add_environment_facts();
-
-        if (ruby) {
-            facter::ruby::load_custom_facts(facts, custom_directories);
+        if (vm.count("trace-file")) {
+            facter::util::start_trace();
         }
 
-        // Output the facts
         format fmt = format::hash;
         if (vm.count("json")) {
             fmt = format::json;
+        } else if (vm.count("json-compact")) {
+            fmt = format::json_compact;
+        } else if (vm.count("msgpack")) {
+            fmt = format::msgpack;
+        } else if (vm.count("stream")) {
+            fmt = format::ndjson;
         } else if (vm.count("yaml")) {
             fmt = format::yaml;
         }
-        facts.write(boost::nowide::cout, fmt, queries);
-        boost::nowide::cout << endl;
+
+        // Let a running daemon answer the queries if there is one
+        if (vm.count("socket") && !vm.count("daemon")) {
+            if (query_daemon(vm["socket"].as<string>(), fmt, queries, vm.count("projection") == 1, boost::nowide::cout)) {
+                boost::nowide::cout << flush;
+                return error_logged() ? EXIT_FAILURE : EXIT_SUCCESS;
+            }
+            log(level::debug, "no daemon is listening on %1%: resolving facts locally.", vm["socket"].as<string>());
+        }
+
+        // Lower the priority before any threads or processes are started, so that they inherit it
+        unsigned int max_threads = numeric_limits<unsigned int>::max();
+        if (vm.count("low-impact")) {
+            if (!facter::execution::lower_priority(cpus)) {
+                log(level::warning, "low impact mode is only partially in effect: facts may compete with other work on the host.");
+            }
+            max_threads = max<unsigned int>(static_cast<unsigned int>(cpus.size()), 1);
+        }
+
+        // Start the spawn helper while this process is still small
+        if (vm.count("spawn-helper") && !facter::execution::start_spawn_helper()) {
+            log(level::warning, "could not start the spawn helper: commands will be started directly.");
+        }
+
+        // Initialize Ruby in main; the location of the Ruby library is remembered next to the fact cache
+        // In low memory mode, Ruby is only loaded when custom fact directories are given
+        bool low_memory = vm.count("low-memory") == 1;
+        bool ruby = false;
+        if (!low_memory || vm.count("custom-dir")) {
+            ruby = facter::ruby::initialize(vm.count("trace") == 1, vm.count("cache-file") ? vm["cache-file"].as<string>() + ".ruby" : string());
+            trace_startup("ruby");
+        }
+
+        auto build = [&]() {
+            unique_ptr<collection> facts(new collection());
+            facts->filter(set<string>(blocked.begin(), blocked.end()), set<string>(allowed.begin(), allowed.end()));
+            facts->cost_budget(vm.count("cost-budget") == 1);
+            if (vm.count("root")) {
+                facts->root(vm["root"].as<string>());
+            }
+            facts->concurrency(min(vm["threads"].as<unsigned int>(), max_threads));
+            facts->interface_filter(included_interfaces, excluded_interfaces, vm.count("interface-summary") == 1);
+            facts->legacy_facts_on_demand(vm.count("legacy-on-demand") == 1);
+            facts->powershell_host(vm.count("powershell-host") == 1);
+            facts->filesystem_filter(excluded_filesystems, filesystem_timeout);
+            facts->fqdn_timeout(fqdn_timeout);
+            // A single run frees every value at exit; the daemon keeps values alive across refreshes, so allocate them individually
+            // Values are also allocated individually in low memory mode so that releasing a written fact frees its memory
+            facts->arena(vm.count("daemon") == 0 && !low_memory);
+            facts->timeouts(resolver_timeout, timeouts);
+            if (timeout.count() > 0) {
+                facts->deadline(chrono::steady_clock::now() + timeout);
+            }
+            if (vm.count("cache-file")) {
+                facts->cache(vm["cache-file"].as<string>(), cache_ttls, unavailable_ttl, max_ttl);
+            }
+            facts->add_default_facts();
+            facts->add_plugins(plugin_directories);
+
+            if (!vm.count("no-external-facts")) {
+                facts->add_external_facts(external_directories);
+            }
+
+            // Add the environment facts
+            facts->add_environment_facts();
+            trace_startup("resolvers");
+
+            if (ruby) {
+                facter::ruby::load_custom_facts(
+                    *facts,
+                    custom_directories,
+                    vm.count("custom-cache-dir") ? vm["custom-cache-dir"].as<string>() : string(),
+                    queries,
+                    vm.count("custom-workers") ? min(vm["custom-workers"].as<unsigned int>(), max_threads) : 0,
+                    vm.count("no-ruby-gc") == 1);
+                trace_startup("custom facts");
+            }
+            return facts;
+        };
+
+#ifdef USE_CURL
+        // The uploader outlives each collection, so that the daemon's uploads have only what changed and reuse the connection
+        unique_ptr<uploader> uploading;
+        if (vm.count("upload-url")) {
+            upload_options options;
+            options.url = vm["upload-url"].as<string>();
+            options.changes_only = vm.count("upload-changes") == 1;
+            uploading.reset(new uploader(move(options)));
+        }
+#endif
+
+        if (vm.count("daemon")) {
+            sampling_options sampling;
+            sampling.interval = chrono::seconds(vm["sample-interval"].as<unsigned int>());
+            sampling.facts = sampled_facts.empty() ?
+                set<string>({ "load_averages", "memory", "pressure", "system_uptime", "utilization" }) :
+                set<string>(sampled_facts.begin(), sampled_facts.end());
+            sampling.history = vm["sample-history"].as<unsigned int>();
+            auto metrics_port = static_cast<unsigned short>(vm.count("metrics-port") ? vm["metrics-port"].as<unsigned int>() : 0);
+            auto publish_path = vm.count("publish-file") ? vm["publish-file"].as<string>() : string();
+            // Every snapshot the daemon takes is uploaded, whether it was rebuilt, sampled, or refreshed
+            function<void(snapshot const&)> upload;
+#ifdef USE_CURL
+            if (uploading) {
+                upload = [&](snapshot const& facts) {
+                    uploading->add(facts);
+                    uploading->upload();
+                };
+            }
+#endif
+            return run_daemon(vm["socket"].as<string>(), chrono::seconds(vm["refresh-interval"].as<unsigned int>()), chrono::seconds(vm["min-refresh-interval"].as<unsigned int>()), sampling, metrics_port, publish_path, [&]() {
+                auto facts = build();
+
+                // Resolve every fact now rather than while answering a query
+                facts->size();
+                return facts;
+            }, upload);
+        }
+
+        auto facts = build();
+        trace_first_output(boost::nowide::cout);
+
+        // Output the facts; queries only resolve what they select, so they're written as usual in low memory mode and when streaming
+        if (vm.count("prime-cache")) {
+            facts->prime_cache();
+        } else if (vm.count("upload-url")) {
+#ifdef USE_CURL
+            uploading->add(*facts);
+            if (!uploading->upload()) {
+                log(level::error, "facts could not be uploaded to %1%.", vm["upload-url"].as<string>());
+            }
+#endif
+        } else if (vm.count("batch")) {
+            answer_batch(*facts, boost::nowide::cin, boost::nowide::cout, vm.count("projection") == 1);
+        } else if (vm.count("changes-since-last-run")) {
+            facts->write_changes(boost::nowide::cout, fmt);
+        } else if ((low_memory || fmt == format::ndjson) && queries.empty()) {
+            facts->write_streaming(boost::nowide::cout, fmt);
+        } else {
+            facts->write(boost::nowide::cout, fmt, queries, vm.count("projection") == 1);
+        }
+        // Binary output is written as-is so that it can be decoded; each streamed or batch line already ends with a newline
+        if (fmt == format::msgpack || fmt == format::ndjson || vm.count("batch")) {
+            boost::nowide::cout << flush;
+        } else if (!vm.count("prime-cache") && !vm.count("upload-url")) {
+            boost::nowide::cout << endl;
+        }
+        trace_startup("output");
+
+        if (vm.count("timing")) {
+            print_timings(*facts);
+        }
+        if (vm.count("memory-report")) {
+            print_memory_usage(*facts);
+        }
+        if (vm.count("trace-file")) {
+            facter::util::write_trace(vm["trace-file"].as<string>());
+        }
     } catch (exception& ex) {
         log(level::fatal, "unhandled exception: %1%", ex.what());
     }
 
+    flush_logging();
     return error_logged() ? EXIT_FAILURE : EXIT_SUCCESS;
 }
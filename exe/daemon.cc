@@ -0,0 +1,768 @@
+#include "daemon.hpp"
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/mapped_snapshot.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <facter/logging/logging.hpp>
+#include <facter/util/metrics.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/asio.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <list>
+#include <map>
+#include <sstream>
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::logging;
+
+set<string> parse_queries(vector<string> const& values)
+{
+    set<string> queries;
+    for (auto const& q : values) {
+        // Strip whitespace and query delimiter
+        string query = boost::trim_copy_if(q, boost::is_any_of(".") || boost::is_space());
+
+        // Erase any duplicate consecutive delimiters
+        query.erase(unique(query.begin(), query.end(), [](char a, char b) {
+            return a == b && a == '.';
+        }), query.end());
+
+        // Don't insert empty queries
+        if (query.empty()) {
+            continue;
+        }
+
+        queries.emplace(move(query));
+    }
+    return queries;
+}
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+namespace asio = boost::asio;
+using asio::local::stream_protocol;
+
+static string format_name(format fmt)
+{
+    if (fmt == format::json) {
+        return "json";
+    }
+    if (fmt == format::json_compact) {
+        return "json-compact";
+    }
+    if (fmt == format::msgpack) {
+        return "msgpack";
+    }
+    if (fmt == format::yaml) {
+        return "yaml";
+    }
+    if (fmt == format::ndjson) {
+        return "ndjson";
+    }
+    return "hash";
+}
+
+static char const* const projection_suffix = "+projection";
+
+static bool parse_format(string const& name, format& fmt)
+{
+    for (auto candidate : { format::hash, format::json, format::yaml, format::json_compact, format::msgpack, format::ndjson }) {
+        if (name == format_name(candidate)) {
+            fmt = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Answers a request line of the daemon's protocol with the given facts
+static string answer(string line, snapshot const& facts)
+{
+    vector<string> tokens;
+    boost::trim(line);
+    boost::split(tokens, line, boost::is_space(), boost::token_compress_on);
+
+    ostringstream output;
+    // A "+projection" suffix on the format requests projected output
+    string name = tokens.front();
+    bool project = boost::ends_with(name, projection_suffix);
+    if (project) {
+        name.erase(name.size() - strlen(projection_suffix));
+    }
+    format fmt;
+    if (!parse_format(name, fmt)) {
+        output << "error: unsupported format '" << name << "'.\n";
+    } else {
+        auto queries = parse_queries(vector<string>(tokens.begin() + 1, tokens.end()));
+        log(level::debug, "answering daemon request: %1%.", line);
+        facts.write(output, fmt, queries, project);
+        if (fmt != format::msgpack && fmt != format::ndjson) {
+            output << '\n';
+        }
+    }
+    return output.str();
+}
+
+// Answers a request of a local client; the socket is only used on the I/O service
+// The request line is limited in size and must arrive in time, so a slow or malicious client can't hold on to memory or threads
+// The facts are written on another thread, as formatting them can take a while
+struct daemon_connection : enable_shared_from_this<daemon_connection>
+{
+    static size_t const max_request_size = 8192;
+
+    explicit daemon_connection(asio::io_service& service) :
+        socket(service),
+        _service(service),
+        _buffer(max_request_size),
+        _timer(service)
+    {
+    }
+
+    void start(shared_ptr<snapshot const> facts, function<void(function<void()>)> const& spawn)
+    {
+        auto self = shared_from_this();
+        expire(boost::posix_time::seconds(5), "the request was not received in time");
+        asio::async_read_until(socket, _buffer, '\n', [self, facts, spawn](boost::system::error_code const& ec, size_t) {
+            self->_timer.cancel();
+            if (ec && ec != asio::error::eof) {
+                log(level::debug, "failed to read daemon request: %1%.", ec == asio::error::not_found ? "the request is too large" : ec.message());
+                return;
+            }
+            istream input(&self->_buffer);
+            string line;
+            getline(input, line);
+            spawn([self, facts, line]() {
+                auto output = make_shared<string>(answer(line, *facts));
+                self->_service.post([self, output]() {
+                    self->respond(output);
+                });
+            });
+        });
+    }
+
+    stream_protocol::socket socket;
+
+ private:
+    void respond(shared_ptr<string> const& output)
+    {
+        auto self = shared_from_this();
+        expire(boost::posix_time::seconds(30), "the response was not read in time");
+        asio::async_write(socket, asio::buffer(*output), [self, output](boost::system::error_code const& ec, size_t) {
+            self->_timer.cancel();
+            if (ec) {
+                log(level::debug, "failed to write daemon response: %1%.", ec.message());
+            }
+        });
+    }
+
+    // Closes the connection unless the timer is cancelled or set again before the given time
+    void expire(boost::posix_time::time_duration const& after, char const* reason)
+    {
+        auto self = shared_from_this();
+        _timer.expires_from_now(after);
+        _timer.async_wait([self, reason](boost::system::error_code const& ec) {
+            if (ec || self->_timer.expires_at() > asio::deadline_timer::traits_type::now()) {
+                return;
+            }
+            log(level::debug, "closing daemon connection: %1%.", reason);
+            boost::system::error_code ignored;
+            self->socket.close(ignored);
+        });
+    }
+
+    asio::io_service& _service;
+    asio::streambuf _buffer;
+    asio::deadline_timer _timer;
+};
+
+// Answers a HTTP request for the metrics on the I/O service; anything other than a GET of /metrics is not found
+// The request is limited in size and the connection in time, so a slow or malicious client can't hold on to memory or threads
+struct metrics_connection : enable_shared_from_this<metrics_connection>
+{
+    static size_t const max_request_size = 8192;
+
+    explicit metrics_connection(asio::io_service& service) :
+        socket(service),
+        _buffer(max_request_size),
+        _timer(service)
+    {
+    }
+
+    void start()
+    {
+        auto self = shared_from_this();
+        _timer.expires_from_now(boost::posix_time::seconds(5));
+        _timer.async_wait([self](boost::system::error_code const& ec) {
+            if (!ec) {
+                log(level::debug, "closing metrics connection: the request was not answered in time.");
+                boost::system::error_code ignored;
+                self->socket.close(ignored);
+            }
+        });
+        asio::async_read_until(socket, _buffer, "\r\n\r\n", [self](boost::system::error_code const& ec, size_t) {
+            self->respond(ec);
+        });
+    }
+
+    asio::ip::tcp::socket socket;
+
+ private:
+    void respond(boost::system::error_code const& ec)
+    {
+        if (ec && ec != asio::error::eof) {
+            log(level::debug, "failed to read metrics request: %1%.", ec == asio::error::not_found ? "the request is too large" : ec.message());
+            _timer.cancel();
+            return;
+        }
+        istream input(&_buffer);
+        string line;
+        getline(input, line);
+        vector<string> tokens;
+        boost::trim(line);
+        boost::split(tokens, line, boost::is_space(), boost::token_compress_on);
+
+        ostringstream body;
+        string status = "200 OK";
+        string content_type = "text/plain; version=0.0.4; charset=utf-8";
+        if (tokens.size() < 2 || tokens[0] != "GET" || (tokens[1] != "/metrics" && !boost::starts_with(tokens[1], "/metrics?"))) {
+            status = "404 Not Found";
+            content_type = "text/plain; charset=utf-8";
+            body << "metrics are served at /metrics.\n";
+        } else {
+            facter::util::write_metrics(body);
+        }
+
+        // The connection is closed after the response, so the body needs no framing beyond its length
+        auto content = body.str();
+        ostringstream response;
+        response << "HTTP/1.0 " << status << "\r\n";
+        response << "Content-Type: " << content_type << "\r\n";
+        response << "Content-Length: " << content.size() << "\r\n";
+        response << "Connection: close\r\n\r\n";
+        response << content;
+        _response = response.str();
+
+        auto self = shared_from_this();
+        asio::async_write(socket, asio::buffer(_response), [self](boost::system::error_code const& ec, size_t) {
+            self->_timer.cancel();
+            if (ec) {
+                log(level::debug, "failed to write metrics response: %1%.", ec.message());
+            }
+        });
+    }
+
+    asio::streambuf _buffer;
+    asio::deadline_timer _timer;
+    string _response;
+};
+
+// Records a sample of the sampled facts and returns the given snapshot updated with the changed facts and the sample history
+static shared_ptr<snapshot const> take_sample(
+    collection& facts,
+    shared_ptr<snapshot const> const& base,
+    set<string> const& changed,
+    sampling_options const& sampling,
+    boost::circular_buffer<shared_ptr<value const>>& history)
+{
+    map<string, shared_ptr<value const>> values;
+    base->each([&](string const& name, value const*) {
+        values.emplace(name, base->share(name));
+        return true;
+    });
+
+    // Refreshing a sampled fact also refreshes the other facts of its resolver (e.g. memoryfree with memory)
+    for (auto const& name : changed) {
+        auto fact = facts[name];
+        if (fact) {
+            values[name] = fact->clone();
+        } else {
+            values.erase(name);
+        }
+    }
+
+    auto sample = make_value<map_value>();
+    sample->add("timestamp", make_value<integer_value>(static_cast<int64_t>(time(nullptr))));
+    for (auto const& name : sampling.facts) {
+        auto it = values.find(name);
+        if (it != values.end()) {
+            sample->add(name, it->second);
+        }
+    }
+    history.push_back(move(sample));
+
+    // Samples are shared between the history of each snapshot; only the array is new
+    auto samples = make_value<array_value>();
+    for (auto const& entry : history) {
+        samples->add(entry);
+    }
+    values[sample_history_fact] = move(samples);
+    return make_shared<snapshot const>(move(values), base);
+}
+
+// Schedules the refreshes of each fact by how often it has changed
+// A fact that is refreshed without changing is refreshed half as often, up to the maximum interval; a fact that changes returns to the minimum
+struct refresh_schedule
+{
+    typedef boost::chrono::steady_clock::time_point time_point;
+
+    refresh_schedule(chrono::seconds minimum, chrono::seconds maximum) :
+        _minimum(minimum.count()),
+        _maximum(maximum.count())
+    {
+    }
+
+    // Updates the schedule of the refreshed facts given the facts that were added, removed, or changed
+    void refreshed(set<string> names, set<string> const& changed, time_point now)
+    {
+        // Refreshing a fact may also change the other facts of its resolver
+        names.insert(changed.begin(), changed.end());
+        for (auto const& name : names) {
+            auto& scheduled = _entries[name];
+            if (changed.count(name) || scheduled.interval == boost::chrono::seconds::zero()) {
+                scheduled.interval = _minimum;
+            } else {
+                scheduled.interval = min(scheduled.interval * 2, _maximum);
+            }
+            scheduled.due = now + scheduled.interval;
+        }
+    }
+
+    // Forgets the facts that are no longer refreshable (e.g. they were removed or overridden)
+    void retain(set<string> const& names)
+    {
+        for (auto it = _entries.begin(); it != _entries.end();) {
+            if (names.count(it->first)) {
+                ++it;
+            } else {
+                it = _entries.erase(it);
+            }
+        }
+    }
+
+    // Gets the facts that are due to be refreshed
+    set<string> due(time_point now) const
+    {
+        set<string> names;
+        for (auto const& kvp : _entries) {
+            if (kvp.second.due <= now) {
+                names.insert(kvp.first);
+            }
+        }
+        return names;
+    }
+
+    // Gets the time the next fact is due to be refreshed
+    time_point next() const
+    {
+        auto next = time_point::max();
+        for (auto const& kvp : _entries) {
+            next = min(next, kvp.second.due);
+        }
+        return next;
+    }
+
+ private:
+    struct entry
+    {
+        boost::chrono::seconds interval;
+        time_point due;
+    };
+
+    boost::chrono::seconds _minimum;
+    boost::chrono::seconds _maximum;
+    map<string, entry> _entries;
+};
+
+// Gets the names of the facts of a snapshot that are not shared with the previous snapshot
+static set<string> changed_facts(snapshot const& facts, snapshot const& previous)
+{
+    set<string> changed;
+    facts.each([&](string const& name, value const* val) {
+        if (previous[name] != val) {
+            changed.insert(name);
+        }
+        return true;
+    });
+    previous.each([&](string const& name, value const*) {
+        if (!facts[name]) {
+            changed.insert(name);
+        }
+        return true;
+    });
+    return changed;
+}
+
+// Gets the given snapshot with the sample history of the previous snapshot
+static shared_ptr<snapshot const> keep_history(shared_ptr<snapshot const> const& facts, shared_ptr<snapshot const> const& previous)
+{
+    auto history = previous->share(sample_history_fact);
+    if (!history) {
+        return facts;
+    }
+    map<string, shared_ptr<value const>> values;
+    facts->each([&](string const& name, value const*) {
+        values.emplace(name, facts->share(name));
+        return true;
+    });
+    values[sample_history_fact] = move(history);
+    return make_shared<snapshot const>(move(values), previous);
+}
+
+int run_daemon(string const& socket_path, chrono::seconds refresh_interval, chrono::seconds min_refresh_interval, sampling_options const& sampling, unsigned short metrics_port, string const& publish_path, function<unique_ptr<collection>()> build, function<void(snapshot const&)> upload)
+{
+    bool sampling_enabled = sampling.interval.count() > 0 && !sampling.facts.empty();
+    boost::circular_buffer<shared_ptr<value const>> history(max<size_t>(sampling.history, 1));
+
+    bool adaptive = min_refresh_interval.count() > 0 && min_refresh_interval < refresh_interval;
+    refresh_schedule schedule(min_refresh_interval, refresh_interval);
+
+    // Queries are answered from an immutable snapshot so readers never wait on the collection
+    // The collection is only kept between refreshes when sampling or refreshing adaptively, as facts are refreshed in it
+    unique_ptr<collection> live = build();
+    shared_ptr<snapshot const> current = live->take_snapshot();
+    if (adaptive) {
+        // Only facts added by a resolver are scheduled; any other fact keeps its value when refreshed, so it would never change
+        schedule.refreshed(live->refreshable_facts(), {}, boost::chrono::steady_clock::now());
+    }
+    if (sampling_enabled) {
+        current = take_sample(*live, current, {}, sampling, history);
+    } else if (!adaptive) {
+        live.reset();
+    }
+
+    boost::mutex mutex;
+    boost::condition_variable stopped;
+    bool stopping = false;
+
+    asio::io_service service;
+
+    // Metrics are only served on the loopback address; they are scraped by a local agent rather than exposed to the network
+    asio::ip::tcp::acceptor metrics_acceptor(service);
+    if (metrics_port != 0) {
+        try {
+            asio::ip::tcp::endpoint endpoint(asio::ip::address_v4::loopback(), metrics_port);
+            metrics_acceptor.open(endpoint.protocol());
+            metrics_acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+            metrics_acceptor.bind(endpoint);
+            metrics_acceptor.listen();
+        } catch (boost::system::system_error const& ex) {
+            log(level::error, "failed to listen for metrics on port %1%: %2%.", metrics_port, ex.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    stream_protocol::acceptor acceptor(service);
+    try {
+        // Remove a socket left behind by a daemon that did not exit cleanly, but never anything else at that path
+        boost::system::error_code ec;
+        auto type = boost::filesystem::symlink_status(socket_path, ec).type();
+        if (type == boost::filesystem::socket_file) {
+            boost::filesystem::remove(socket_path, ec);
+        } else if (type != boost::filesystem::file_not_found && type != boost::filesystem::status_error) {
+            log(level::error, "failed to listen on %1%: the path exists and is not a socket.", socket_path);
+            return EXIT_FAILURE;
+        }
+
+        stream_protocol::endpoint endpoint(socket_path);
+        acceptor.open(endpoint.protocol());
+        acceptor.bind(endpoint);
+        acceptor.listen();
+    } catch (boost::system::system_error const& ex) {
+        log(level::error, "failed to listen on %1%: %2%.", socket_path, ex.what());
+        return EXIT_FAILURE;
+    }
+
+    // Stop when interrupted or terminated
+    asio::signal_set signals(service, SIGINT, SIGTERM);
+    signals.async_wait([&](boost::system::error_code const& ec, int signal) {
+        if (ec) {
+            return;
+        }
+        log(level::info, "received signal %1%: stopping daemon.", signal);
+        boost::system::error_code ignored;
+        acceptor.close(ignored);
+        metrics_acceptor.close(ignored);
+
+        boost::lock_guard<boost::mutex> lock(mutex);
+        stopping = true;
+        stopped.notify_all();
+    });
+
+    // Answer each connection using the snapshot that was current when it connected
+    // The threads formatting the facts are only used on the I/O service; finished ones are joined as connections are
+    // accepted and the rest before returning, as they hold connections of the service
+    list<boost::thread> serving;
+    function<void()> accept_next;
+    accept_next = [&]() {
+        auto connection = make_shared<daemon_connection>(service);
+        acceptor.async_accept(connection->socket, [&, connection](boost::system::error_code const& ec) {
+            if (ec) {
+                return;
+            }
+            shared_ptr<snapshot const> facts;
+            {
+                boost::lock_guard<boost::mutex> lock(mutex);
+                facts = current;
+            }
+            serving.remove_if([](boost::thread& thread) {
+                return thread.try_join_for(boost::chrono::milliseconds(0));
+            });
+            connection->start(move(facts), [&](function<void()> work) {
+                serving.emplace_back(move(work));
+            });
+            accept_next();
+        });
+    };
+    accept_next();
+
+    // Metrics connections are served on the I/O service rather than on threads of their own
+    function<void()> accept_metrics;
+    accept_metrics = [&]() {
+        auto connection = make_shared<metrics_connection>(service);
+        metrics_acceptor.async_accept(connection->socket, [&, connection](boost::system::error_code const& ec) {
+            if (ec) {
+                return;
+            }
+            connection->start();
+            accept_metrics();
+        });
+    };
+    if (metrics_port != 0) {
+        accept_metrics();
+    }
+
+    boost::thread listener([&]() {
+        service.run();
+    });
+
+    // Upload on a thread of its own so that retrying an endpoint that is down doesn't delay refreshes
+    // Only the most recent snapshot waits to be uploaded; the uploader finds what changed since the last one it was given
+    shared_ptr<snapshot const> unuploaded;
+    boost::condition_variable upload_ready;
+    boost::thread uploading;
+    if (upload) {
+        unuploaded = current;
+        uploading = boost::thread([&]() {
+            try {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (!stopping) {
+                    if (!unuploaded) {
+                        upload_ready.wait(lock);
+                        continue;
+                    }
+                    auto facts = move(unuploaded);
+                    unuploaded.reset();
+                    lock.unlock();
+                    try {
+                        upload(*facts);
+                    } catch (exception& ex) {
+                        log(level::error, "failed to upload facts: %1%.", ex.what());
+                    }
+                    lock.lock();
+                }
+            } catch (boost::thread_interrupted&) {
+            }
+        });
+    }
+
+    // Local processes can also read the facts from the published file without connecting; it's written on this thread only
+    unique_ptr<snapshot_publisher> publisher;
+    if (!publish_path.empty()) {
+        publisher.reset(new snapshot_publisher(publish_path));
+        if (!publisher->publish(*current)) {
+            log(level::error, "failed to publish facts to %1%.", publish_path);
+        }
+    }
+
+    log(level::info, "daemon listening on %1% (refreshing every %2% seconds).", socket_path, refresh_interval.count());
+    if (metrics_port != 0) {
+        log(level::info, "serving metrics at http://127.0.0.1:%1%/metrics.", metrics_port);
+    }
+    if (sampling_enabled) {
+        log(level::info, "sampling %1% every %2% seconds.", boost::join(sampling.facts, ", "), sampling.interval.count());
+    }
+
+    if (adaptive) {
+        log(level::info, "refreshing facts that change as often as every %1% seconds.", min_refresh_interval.count());
+    }
+
+    // Refresh on this thread as custom facts must be resolved on the thread that initialized Ruby
+    enum struct refresh_kind
+    {
+        rebuild,
+        sample,
+        adapt
+    };
+    boost::unique_lock<boost::mutex> lock(mutex);
+    auto next_refresh = boost::chrono::steady_clock::now() + boost::chrono::seconds(refresh_interval.count());
+    auto next_sample = boost::chrono::steady_clock::now() + boost::chrono::seconds(sampling.interval.count());
+    while (!stopping) {
+        auto kind = refresh_kind::rebuild;
+        auto deadline = next_refresh;
+        if (sampling_enabled && next_sample < deadline) {
+            kind = refresh_kind::sample;
+            deadline = next_sample;
+        }
+        if (adaptive && schedule.next() < deadline) {
+            kind = refresh_kind::adapt;
+            deadline = schedule.next();
+        }
+        while (!stopping && stopped.wait_until(lock, deadline) != boost::cv_status::timeout) {
+        }
+        if (stopping) {
+            break;
+        }
+
+        // Only this thread replaces the current snapshot, so it can be read without the lock below
+        auto previous = current;
+        lock.unlock();
+        shared_ptr<snapshot const> facts;
+        set<string> due;
+        if (kind == refresh_kind::adapt) {
+            due = schedule.due(boost::chrono::steady_clock::now());
+        }
+        try {
+            if (kind == refresh_kind::sample) {
+                // Resolve only the sampled facts again; every other fact is shared with the previous snapshot
+                auto changed = live->refresh(sampling.facts);
+                facts = take_sample(*live, previous, changed, sampling, history);
+            } else if (kind == refresh_kind::adapt) {
+                // Resolve only the facts that are due; every other fact is shared with the previous snapshot
+                log(level::debug, "refreshing %1% daemon facts that are due.", due.size());
+                auto changed = live->refresh(due);
+                facts = live->take_snapshot(previous);
+                if (sampling_enabled) {
+                    facts = keep_history(facts, previous);
+                }
+                schedule.refreshed(move(due), changed, boost::chrono::steady_clock::now());
+                schedule.retain(live->refreshable_facts());
+            } else {
+                log(level::debug, "refreshing daemon facts.");
+                // Share unchanged facts with the previous snapshot so memory stays flat between refreshes
+                auto built = build();
+                facts = built->take_snapshot(previous);
+                if (adaptive) {
+                    auto names = built->refreshable_facts();
+                    schedule.refreshed(names, changed_facts(*facts, *previous), boost::chrono::steady_clock::now());
+                    schedule.retain(names);
+                }
+                if (sampling_enabled || adaptive) {
+                    live = move(built);
+                }
+                if (sampling_enabled) {
+                    facts = take_sample(*live, facts, {}, sampling, history);
+                }
+            }
+        } catch (exception& ex) {
+            log(level::error, "failed to %1% facts: %2%.", kind == refresh_kind::sample ? "sample" : "refresh", ex.what());
+            if (kind == refresh_kind::adapt) {
+                // Try again at the minimum interval rather than at once
+                schedule.refreshed(due, due, boost::chrono::steady_clock::now());
+            }
+        }
+
+        // Schedule from the current time so a slow refresh doesn't cause a burst of samples
+        auto now = boost::chrono::steady_clock::now();
+        if (kind == refresh_kind::rebuild) {
+            next_refresh = now + boost::chrono::seconds(refresh_interval.count());
+        }
+        if (kind != refresh_kind::adapt) {
+            next_sample = now + boost::chrono::seconds(sampling.interval.count());
+        }
+        if (facts && publisher) {
+            publisher->publish(*facts);
+        }
+        lock.lock();
+        if (facts) {
+            if (upload) {
+                unuploaded = facts;
+                upload_ready.notify_one();
+            }
+            current = move(facts);
+        }
+    }
+    lock.unlock();
+    publisher.reset();
+
+    // Stop waiting to retry an upload; an upload in progress is bounded by its request timeout
+    if (uploading.joinable()) {
+        upload_ready.notify_one();
+        uploading.interrupt();
+        uploading.join();
+    }
+
+    service.stop();
+    listener.join();
+    for (auto& thread : serving) {
+        thread.join();
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::remove(socket_path, ec);
+    return EXIT_SUCCESS;
+}
+
+bool query_daemon(string const& socket_path, format fmt, set<string> const& queries, bool project, ostream& stream)
+{
+    boost::system::error_code ec;
+    asio::io_service service;
+    stream_protocol::socket socket(service);
+    socket.connect(stream_protocol::endpoint(socket_path), ec);
+    if (ec) {
+        log(level::debug, "could not connect to daemon at %1%: %2%.", socket_path, ec.message());
+        return false;
+    }
+
+    string request = format_name(fmt);
+    if (project) {
+        request += projection_suffix;
+    }
+    for (auto const& query : queries) {
+        request += ' ';
+        request += query;
+    }
+    request += '\n';
+    asio::write(socket, asio::buffer(request), ec);
+    if (ec) {
+        log(level::debug, "failed to send request to daemon at %1%: %2%.", socket_path, ec.message());
+        return false;
+    }
+
+    // The daemon closes the connection after writing the response
+    asio::streambuf response;
+    asio::read(socket, response, ec);
+    if (ec && ec != asio::error::eof) {
+        log(level::debug, "failed to read response from daemon at %1%: %2%.", socket_path, ec.message());
+        return false;
+    }
+    if (response.size() > 0) {
+        stream << &response;
+    }
+    return true;
+}
+
+#else
+
+int run_daemon(string const& socket_path, chrono::seconds refresh_interval, chrono::seconds min_refresh_interval, sampling_options const& sampling, unsigned short metrics_port, string const& publish_path, function<unique_ptr<collection>()> build, function<void(snapshot const&)> upload)
+{
+    log(level::error, "daemon mode is not supported on this platform.");
+    return EXIT_FAILURE;
+}
+
+bool query_daemon(string const& socket_path, format fmt, set<string> const& queries, bool project, ostream& stream)
+{
+    return false;
+}
+
+#endif  // BOOST_ASIO_HAS_LOCAL_SOCKETS
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * Declares the cfacter daemon that keeps a fact collection resident and answers queries over a Unix domain socket.
+ *
+ * Each connection sends a single request line of the form "<format> [query] [query] [...]", where format is
+ * one of "hash", "json", "json-compact", "msgpack", "ndjson", or "yaml". The daemon writes the requested facts in the given format and closes the connection.
+ * The daemon can also serve its metrics in the Prometheus text format over HTTP on the loopback address.
+ */
+#pragma once
+
+#include <facter/facts/collection.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Normalizes the given command line or request queries.
+ * @param values The queries to normalize.
+ * @return Returns the set of non-empty queries with surrounding whitespace and delimiters removed.
+ */
+std::set<std::string> parse_queries(std::vector<std::string> const& values);
+
+/**
+ * The name of the fact the daemon publishes its sample history under.
+ */
+constexpr char const* sample_history_fact = "sample_history";
+
+/**
+ * Represents how the daemon samples frequently changing facts (e.g. load_averages) between refreshes.
+ */
+struct sampling_options
+{
+    /**
+     * The interval between samples; zero disables sampling.
+     */
+    std::chrono::seconds interval;
+
+    /**
+     * The names of the facts to sample.
+     */
+    std::set<std::string> facts;
+
+    /**
+     * The number of samples to keep in the sample history fact.
+     */
+    size_t history;
+};
+
+/**
+ * Runs the daemon until it is interrupted or terminated.
+ * Collections are built and resolved on the calling thread; queries are answered from a snapshot of the most recently built collection.
+ * When sampling, the most recently built collection is kept so that only the sampled facts are resolved again at each sample;
+ * the snapshot is then updated with their values and with the sample history, an array of the most recent samples
+ * (each a hash of the sample's "timestamp" and the sampled facts), oldest first.
+ * With a minimum refresh interval, the most recently built collection is also kept so that facts can be refreshed on a
+ * schedule learned from how often they change: every fact added by a resolver starts at the minimum interval, and each time a fact is refreshed
+ * without changing, its interval doubles up to the refresh interval; a fact that changes returns to the minimum interval.
+ * @param socket_path The path of the Unix domain socket to listen on.
+ * @param refresh_interval The interval between rebuilding the fact collection.
+ * @param min_refresh_interval The shortest interval between refreshes of a fact that changes, or zero to only refresh facts by rebuilding the collection.
+ * @param sampling The options for sampling facts between refreshes.
+ * @param metrics_port The port on the loopback address to serve Prometheus metrics on at /metrics, or zero to not serve them.
+ * @param publish_path The file to publish each snapshot to for local processes to map (see mapped_snapshot), or empty to not publish.
+ * @param build The function to build a new fact collection.
+ * @param upload The function to upload each snapshot with, or empty to not upload. It's called on a thread of its own so that a slow
+ * endpoint doesn't delay refreshes; if several snapshots are taken during an upload, only the most recent is uploaded next.
+ * @return Returns the process exit code.
+ */
+int run_daemon(
+    std::string const& socket_path,
+    std::chrono::seconds refresh_interval,
+    std::chrono::seconds min_refresh_interval,
+    sampling_options const& sampling,
+    unsigned short metrics_port,
+    std::string const& publish_path,
+    std::function<std::unique_ptr<facter::facts::collection>()> build,
+    std::function<void(facter::facts::snapshot const&)> upload);
+
+/**
+ * Queries a running daemon.
+ * @param socket_path The path of the Unix domain socket the daemon is listening on.
+ * @param fmt The output format to request.
+ * @param queries The queries to request; if empty, all facts are requested.
+ * @param project True to request the queried values as a tree of the facts they were queried from.
+ * @param stream The stream to write the response to.
+ * @return Returns true if the daemon answered the query or false if no daemon could be reached.
+ */
+bool query_daemon(
+    std::string const& socket_path,
+    facter::facts::format fmt,
+    std::set<std::string> const& queries,
+    bool project,
+    std::ostream& stream);
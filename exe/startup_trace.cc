@@ -0,0 +1,107 @@
+#include "startup_trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <streambuf>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// The phases of startup, in the order they ended
+struct startup_trace
+{
+    startup_trace() :
+        enabled(getenv("FACTER_STARTUP_TRACE") != nullptr)
+    {
+        // This is the executable's first static initializer, so everything before it is loading and dynamic linking
+        if (enabled) {
+            phases.reserve(16);
+            mark("dynamic linking");
+        }
+    }
+
+    ~startup_trace()
+    {
+        if (!enabled) {
+            return;
+        }
+        mark("exit");
+        for (auto const& phase : phases) {
+            fprintf(stderr, "startup: %s %lld\n", phase.first, phase.second);
+        }
+        fflush(stderr);
+    }
+
+    void mark(char const* phase)
+    {
+        auto now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch());
+        phases.emplace_back(phase, static_cast<long long>(now.count()));
+    }
+
+    bool enabled;
+    vector<pair<char const*, long long>> phases;
+};
+
+// Constructed before the executable's other static objects and destroyed after them
+#if defined(__GNUC__)
+static startup_trace trace __attribute__((init_priority(101)));
+#else
+static startup_trace trace;
+#endif
+
+// Passes output through to a stream buffer, recording when the first of it is written
+struct first_output_buf : streambuf
+{
+    explicit first_output_buf(streambuf* target) :
+        _target(target),
+        _written(false)
+    {
+    }
+
+ protected:
+    int_type overflow(int_type ch) override
+    {
+        written();
+        return traits_type::eq_int_type(ch, traits_type::eof()) ? traits_type::not_eof(ch) : _target->sputc(traits_type::to_char_type(ch));
+    }
+
+    streamsize xsputn(char const* s, streamsize count) override
+    {
+        written();
+        return _target->sputn(s, count);
+    }
+
+    int sync() override
+    {
+        return _target->pubsync();
+    }
+
+ private:
+    void written()
+    {
+        if (!_written) {
+            _written = true;
+            trace.mark("resolution");
+        }
+    }
+
+    streambuf* _target;
+    bool _written;
+};
+
+void trace_startup(char const* phase)
+{
+    if (trace.enabled) {
+        trace.mark(phase);
+    }
+}
+
+void trace_first_output(ostream& out)
+{
+    if (!trace.enabled) {
+        return;
+    }
+    // The buffer passes output on to the stream's own buffer for the rest of the process, so it is never freed
+    out.rdbuf(new first_output_buf(out.rdbuf()));
+}
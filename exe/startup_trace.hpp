@@ -0,0 +1,23 @@
+/**
+ * @file
+ * Declares the trace of the phases of cfacter's startup, which the startup benchmark uses to break down its time.
+ *
+ * Tracing is enabled by setting FACTER_STARTUP_TRACE in the environment. At exit, each phase is written to stderr
+ * as a line of the form "startup: <phase> <time>", in the order the phases ended, where the time is the number of
+ * nanoseconds since the epoch of the monotonic clock (which is shared with the process that started cfacter).
+ */
+#pragma once
+
+#include <ostream>
+
+/**
+ * Records that a phase of startup has ended, if tracing is enabled.
+ * @param phase The name of the phase; it must be a string literal.
+ */
+void trace_startup(char const* phase);
+
+/**
+ * Records the "resolution" phase as ending when the first byte of output is written to the stream, if tracing is enabled.
+ * @param out The stream the facts are written to.
+ */
+void trace_first_output(std::ostream& out);
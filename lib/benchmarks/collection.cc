@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/query.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include "synthetic.hpp"
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::benchmarks;
+
+static void collection_add(benchmark::State& state)
+{
+    auto count = static_cast<size_t>(state.range(0));
+    vector<string> names;
+    for (size_t i = 0; i < count; ++i) {
+        names.push_back("fact" + to_string(i));
+    }
+    for (auto _ : state) {
+        collection facts;
+        for (auto const& name : names) {
+            facts.add(string(name), make_value<string_value>("value"));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(collection_add)->Arg(100)->Arg(10000);
+
+static void collection_get(benchmark::State& state)
+{
+    collection facts;
+    populate(facts, static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(facts.get<string_value>("scalar50"));
+        benchmark::DoNotOptimize(facts.get<string_value>("ipaddress_eth0"));
+        benchmark::DoNotOptimize(facts.get("missing"));
+    }
+}
+BENCHMARK(collection_get)->Arg(4)->Arg(4096);
+
+static void collection_query(benchmark::State& state)
+{
+    collection facts;
+    populate(facts, static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(facts.query<string_value>("networking.interfaces.eth3.ip"));
+    }
+}
+BENCHMARK(collection_query)->Arg(4)->Arg(4096);
+
+static void collection_query_compiled(benchmark::State& state)
+{
+    collection facts;
+    populate(facts, static_cast<size_t>(state.range(0)));
+    query compiled("networking.interfaces.eth3.ip");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(facts.query<string_value>(compiled));
+    }
+}
+BENCHMARK(collection_query_compiled)->Arg(4)->Arg(4096);
+
+static void collection_query_all(benchmark::State& state)
+{
+    collection facts;
+    populate(facts, static_cast<size_t>(state.range(0)));
+    query compiled("networking.interfaces.*.ip");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(facts.query_all(compiled));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(collection_query_all)->Arg(4)->Arg(4096);
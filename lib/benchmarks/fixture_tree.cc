@@ -0,0 +1,190 @@
+#include "fixture_tree.hpp"
+#include <facter/util/file.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace facter::util;
+namespace fs = boost::filesystem;
+
+namespace facter { namespace benchmarks {
+
+    static string recorded(string const& name)
+    {
+        string contents;
+        if (!file::read(string(LIBFACTER_FIXTURES_DIRECTORY) + "/facts/linux/" + name, contents)) {
+            throw runtime_error("fixture " + name + " could not be read.");
+        }
+        return contents;
+    }
+
+    static string replace_field(string stanza, string const& key, string const& value)
+    {
+        // cpuinfo fields are "key<tabs>: value" on a line of their own
+        auto start = stanza.find("\n" + key + "\t");
+        start = start == string::npos ? (stanza.compare(0, key.size(), key) == 0 ? 0 : string::npos) : start + 1;
+        if (start == string::npos) {
+            return stanza;
+        }
+        auto colon = stanza.find(": ", start);
+        auto end = stanza.find('\n', colon);
+        return stanza.replace(colon + 2, end - colon - 2, value);
+    }
+
+    fixture_tree const& fixture_tree::many_processors(unsigned int sockets, unsigned int threads)
+    {
+        static map<pair<unsigned int, unsigned int>, unique_ptr<fixture_tree>> trees;
+        auto& tree = trees[make_pair(sockets, threads)];
+        if (tree) {
+            return *tree;
+        }
+        tree.reset(new fixture_tree());
+
+        // Logical processors are numbered across the sockets first, then across the second thread of each core
+        unsigned int cores = threads / 2;
+        unsigned int cores_per_socket = cores / sockets;
+        auto stanza = recorded("cpuinfo");
+        ostringstream cpuinfo;
+        vector<ostringstream> node_cpus(sockets);
+        for (unsigned int cpu = 0; cpu < threads; ++cpu) {
+            unsigned int core = cpu % cores;
+            unsigned int socket = core / cores_per_socket;
+            unsigned int sibling = cpu < cores ? cpu + cores : cpu - cores;
+            auto siblings = to_string(min(cpu, sibling)) + "," + to_string(max(cpu, sibling));
+
+            auto entry = replace_field(stanza, "processor", to_string(cpu));
+            entry = replace_field(entry, "physical id", to_string(socket));
+            entry = replace_field(entry, "core id", to_string(core % cores_per_socket));
+            cpuinfo << entry;
+
+            auto directory = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+            tree->write(directory + "/topology/physical_package_id", to_string(socket) + "\n");
+            tree->write(directory + "/topology/core_id", to_string(core % cores_per_socket) + "\n");
+            tree->write(directory + "/topology/thread_siblings_list", siblings + "\n");
+            tree->write(directory + "/cpufreq/cpuinfo_max_freq", "2250000\n");
+
+            // Each core has its own L1 and L2 caches; the L3 is shared by four cores
+            auto first_core = to_string(core - core % 4);
+            tree->write(directory + "/cache/index0/level", "1\n");
+            tree->write(directory + "/cache/index0/type", "Data\n");
+            tree->write(directory + "/cache/index0/size", "32K\n");
+            tree->write(directory + "/cache/index0/shared_cpu_list", siblings + "\n");
+            tree->write(directory + "/cache/index1/level", "1\n");
+            tree->write(directory + "/cache/index1/type", "Instruction\n");
+            tree->write(directory + "/cache/index1/size", "32K\n");
+            tree->write(directory + "/cache/index1/shared_cpu_list", siblings + "\n");
+            tree->write(directory + "/cache/index2/level", "2\n");
+            tree->write(directory + "/cache/index2/type", "Unified\n");
+            tree->write(directory + "/cache/index2/size", "512K\n");
+            tree->write(directory + "/cache/index2/shared_cpu_list", siblings + "\n");
+            tree->write(directory + "/cache/index3/level", "3\n");
+            tree->write(directory + "/cache/index3/type", "Unified\n");
+            tree->write(directory + "/cache/index3/size", "16384K\n");
+            tree->write(directory + "/cache/index3/shared_cpu_list", first_core + "-" + to_string(core - core % 4 + 3) + "\n");
+
+            auto& list = node_cpus[socket];
+            if (list.tellp() != 0) {
+                list << ",";
+            }
+            list << cpu;
+        }
+        tree->write("/proc/cpuinfo", cpuinfo.str());
+        tree->write("/proc/meminfo", recorded("meminfo"));
+
+        for (unsigned int node = 0; node < sockets; ++node) {
+            auto directory = "/sys/devices/system/node/node" + to_string(node);
+            tree->write(directory + "/cpulist", node_cpus[node].str() + "\n");
+            tree->write(directory + "/meminfo", "Node " + to_string(node) + " MemTotal:       528301222 kB\nNode " + to_string(node) + " MemFree:        446607260 kB\n");
+        }
+        for (auto const& size : { "2048kB", "1048576kB" }) {
+            auto directory = string("/sys/kernel/mm/hugepages/hugepages-") + size;
+            tree->write(directory + "/nr_hugepages", "1024\n");
+            tree->write(directory + "/free_hugepages", "1000\n");
+            tree->write(directory + "/resv_hugepages", "0\n");
+            tree->write(directory + "/surplus_hugepages", "0\n");
+        }
+        return *tree;
+    }
+
+    fixture_tree const& fixture_tree::container_host(unsigned int pods)
+    {
+        static map<unsigned int, unique_ptr<fixture_tree>> trees;
+        auto& tree = trees[pods];
+        if (tree) {
+            return *tree;
+        }
+        tree.reset(new fixture_tree());
+
+        // Two NVMe disks with udev records for their partitions, and a loop device for every fourth pod's volume
+        struct device { string name; string number; string size; bool disk; string type; };
+        vector<device> devices = {
+            { "nvme0n1", "259:0", "1875385008", true, "" },
+            { "nvme0n1p1", "259:1", "1048576", false, "vfat" },
+            { "nvme0n1p2", "259:2", "1874334720", false, "ext4" },
+            { "nvme1n1", "259:3", "7501476528", true, "xfs" },
+        };
+        for (unsigned int loop = 0; loop < pods / 4; ++loop) {
+            devices.push_back({ "loop" + to_string(loop), "7:" + to_string(loop), "2097152", false, "ext4" });
+        }
+        for (auto const& d : devices) {
+            tree->write("/sys/class/block/" + d.name + "/dev", d.number + "\n");
+            tree->write("/sys/class/block/" + d.name + "/size", d.size + "\n");
+            if (d.disk) {
+                tree->write("/sys/block/" + d.name + "/size", d.size + "\n");
+                tree->write("/sys/block/" + d.name + "/device/model", "SAMSUNG MZQLB7T6HMLA-00007\n");
+                tree->write("/sys/block/" + d.name + "/device/vendor", "Samsung\n");
+            } else if (d.name.compare(0, 4, "loop") == 0) {
+                tree->write("/sys/block/" + d.name + "/size", d.size + "\n");
+            }
+            if (!d.type.empty()) {
+                tree->write("/run/udev/data/b" + d.number, "E:ID_FS_TYPE=" + d.type + "\nE:ID_FS_UUID=" + d.name + "-0000-4000-8000-000000000000\nE:ID_FS_USAGE=filesystem\n");
+            }
+        }
+
+        // Every pod has an overlay root, bind mounts of files on the data disk, and a volume on a loop device
+        ostringstream mtab;
+        mtab << recorded("mtab");
+        for (unsigned int pod = 0; pod < pods; ++pod) {
+            auto uid = "/var/lib/kubelet/pods/" + to_string(100000 + pod);
+            mtab << "overlay /run/containerd/io.containerd.runtime.v2.task/k8s.io/" << pod << "/rootfs overlay rw,relatime,lowerdir=/var/lib/containerd/snapshots/" << pod << "/fs,upperdir=/var/lib/containerd/snapshots/" << pod + 1 << "/fs 0 0\n";
+            mtab << "shm /run/containerd/io.containerd.grpc.v1.cri/sandboxes/" << pod << "/shm tmpfs rw,nosuid,nodev,noexec,relatime,size=65536k 0 0\n";
+            mtab << "/dev/nvme1n1 " << uid << "/etc-hosts xfs rw,relatime,attr2,inode64,logbufs=8,logbsize=32k,noquota 0 0\n";
+            mtab << "/dev/nvme1n1 " << uid << "/containers/app/" << pod << " xfs rw,relatime,attr2,inode64,logbufs=8,logbsize=32k,noquota 0 0\n";
+            if (pod % 4 == 0) {
+                mtab << "/dev/loop" << pod / 4 << " " << uid << "/volumes/kubernetes.io~csi/data/mount ext4 rw,relatime 0 0\n";
+            }
+        }
+        tree->write("/etc/mtab", mtab.str());
+        tree->write("/proc/filesystems", "nodev\tsysfs\nnodev\ttmpfs\nnodev\tproc\nnodev\toverlay\n\text4\n\txfs\n\tvfat\n");
+        return *tree;
+    }
+
+    fixture_tree::fixture_tree() :
+        _root((fs::temp_directory_path() / fs::unique_path("facter-benchmark-%%%%-%%%%")).string())
+    {
+    }
+
+    fixture_tree::~fixture_tree()
+    {
+        boost::system::error_code ec;
+        fs::remove_all(_root, ec);
+    }
+
+    string const& fixture_tree::root() const
+    {
+        return _root;
+    }
+
+    void fixture_tree::write(string const& path, string const& contents) const
+    {
+        fs::path target(_root + path);
+        fs::create_directories(target.parent_path());
+        boost::nowide::ofstream stream(target.string().c_str());
+        stream << contents;
+    }
+
+}}  // namespace facter::benchmarks
@@ -0,0 +1,62 @@
+/**
+ * @file
+ * Declares the file system trees the resolver benchmarks are run against.
+ */
+#pragma once
+
+#include <string>
+
+namespace facter { namespace benchmarks {
+
+    /**
+     * A temporary directory holding the /proc, /sys, /run, and /etc files of a host, for resolving facts with an alternate root.
+     * The trees are built from the files recorded in lib/tests/fixtures/facts/linux, repeated for each processor,
+     * device, or pod, so hosts far larger than the one running the benchmarks can be reproduced.
+     */
+    struct fixture_tree
+    {
+        /**
+         * Builds the tree of a host with many processors.
+         * @param sockets The number of processor packages (and NUMA nodes).
+         * @param threads The total number of logical processors; each core has two.
+         * @return Returns the tree, which lives until the process exits.
+         */
+        static fixture_tree const& many_processors(unsigned int sockets, unsigned int threads);
+
+        /**
+         * Builds the tree of a container host, with the mounts of many pods and many loop devices.
+         * @param pods The number of pods; each has a veth interface, an overlay mount, and bind mounts of the data disk.
+         * @return Returns the tree, which lives until the process exits.
+         */
+        static fixture_tree const& container_host(unsigned int pods);
+
+        /**
+         * Removes the tree.
+         */
+        ~fixture_tree();
+
+        /**
+         * Prevents the tree from being copied.
+         */
+        fixture_tree(fixture_tree const&) = delete;
+
+        /**
+         * Prevents the tree from being copied.
+         * @returns Returns this tree.
+         */
+        fixture_tree& operator=(fixture_tree const&) = delete;
+
+        /**
+         * Gets the root directory of the tree.
+         * @return Returns the directory to pass to collection::root.
+         */
+        std::string const& root() const;
+
+     private:
+        fixture_tree();
+        void write(std::string const& path, std::string const& contents) const;
+
+        std::string _root;
+    };
+
+}}  // namespace facter::benchmarks
@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <facter/logging/logging.hpp>
+#include <boost/nowide/iostream.hpp>
+#include <cstring>
+#include <string>
+#include "replay.hpp"
+#include "soak.hpp"
+
+using namespace std;
+using namespace facter::logging;
+using namespace facter::benchmarks;
+
+int main(int argc, char** argv)
+{
+    // Logging would dominate the measurements
+    set_level(level::none);
+
+    // --record=FILE records the commands and HTTP requests of this host; --replay=FILE benchmarks a recording
+    // --soak=CYCLES runs a soak test instead of the benchmarks, refreshing the facts of the recording given with --replay,
+    // or synthetic facts, and the custom facts of each --soak-custom-dir=DIR; --soak-report=CYCLES sets how often it reports
+    soak_options soak;
+    int count = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--record=", 9) == 0) {
+            return record_host(argv[i] + 9) ? 0 : 1;
+        }
+        if (strncmp(argv[i], "--replay=", 9) == 0) {
+            soak.recording = argv[i] + 9;
+            if (!add_replayed_host(argv[i] + 9)) {
+                boost::nowide::cerr << "error: " << (argv[i] + 9) << " is not a recording." << endl;
+                return 1;
+            }
+            continue;
+        }
+        if (strncmp(argv[i], "--soak=", 7) == 0) {
+            soak.cycles = stoull(argv[i] + 7);
+            continue;
+        }
+        if (strncmp(argv[i], "--soak-report=", 14) == 0) {
+            soak.report_every = stoull(argv[i] + 14);
+            continue;
+        }
+        if (strncmp(argv[i], "--soak-custom-dir=", 18) == 0) {
+            soak.custom_directories.emplace_back(argv[i] + 18);
+            continue;
+        }
+        argv[count++] = argv[i];
+    }
+    argc = count;
+
+    if (soak.cycles > 0) {
+        return run_soak(soak) ? 0 : 1;
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+#include <facter/facts/query.hpp>
+#include <facter/facts/map_value.hpp>
+#include <internal/facts/writer.hpp>
+#include "synthetic.hpp"
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::benchmarks;
+
+static void query_compile(benchmark::State& state)
+{
+    for (auto _ : state) {
+        query compiled("networking.interfaces.\"eth0.100\".bindings.0.address");
+        benchmark::DoNotOptimize(compiled.wildcard());
+    }
+}
+BENCHMARK(query_compile);
+
+static void query_value_parse(benchmark::State& state)
+{
+    auto networking = make_networking(static_cast<size_t>(state.range(0)));
+    auto get = [&](string const& name) -> value const* {
+        return name == "networking" ? networking.get() : nullptr;
+    };
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(query_value("networking.interfaces.eth3.mtu", get));
+    }
+}
+BENCHMARK(query_value_parse)->Arg(4)->Arg(4096);
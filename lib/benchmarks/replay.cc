@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+#include <facter/execution/execution.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/resolver.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <internal/util/replay_log.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/iostream.hpp>
+#include "replay.hpp"
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::util;
+
+namespace facter { namespace benchmarks {
+
+    // The number of resolvers in the synthetic profile, each executing one command
+    static const size_t command_resolvers = 16;
+
+    // Resolves a fact from the output of a command
+    struct command_resolver : resolver
+    {
+        explicit command_resolver(size_t index) :
+            resolver("command " + to_string(index), { "command_" + to_string(index) }),
+            _index(index)
+        {
+        }
+
+        void resolve(collection& facts) override
+        {
+            auto result = execution::execute("echo", { to_string(_index) });
+            facts.add("command_" + to_string(_index), make_value<string_value>(move(result.second)));
+        }
+
+     private:
+        size_t _index;
+    };
+
+    static void add_command_resolvers(collection& facts)
+    {
+        for (size_t i = 0; i < command_resolvers; ++i) {
+            facts.add(make_shared<command_resolver>(i));
+        }
+    }
+
+    // Records the commands of the synthetic profile once; they replay with a fixed latency rather than their own
+    static replay_log* command_profile()
+    {
+        static replay_log log(replay_mode::replay);
+        static bool recorded = []() {
+            replay_log recording(replay_mode::record);
+            {
+                scoped_replay_log scope(&recording);
+                collection facts;
+                add_command_resolvers(facts);
+                facts.size();
+            }
+            string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("facter-replay-%%%%-%%%%.json")).string();
+            bool saved = recording.save(path) && log.load(path);
+            boost::system::error_code ec;
+            boost::filesystem::remove(path, ec);
+            return saved;
+        }();
+        log.latency(0, chrono::milliseconds(20));
+        return recorded ? &log : nullptr;
+    }
+
+    // Resolves resolvers that each wait 20ms on a command, on the given number of threads
+    static void commands_replayed(benchmark::State& state)
+    {
+        auto profile = command_profile();
+        if (!profile) {
+            state.SkipWithError("the commands could not be recorded.");
+            return;
+        }
+        scoped_replay_log replaying(profile);
+        for (auto _ : state) {
+            collection facts;
+            facts.concurrency(static_cast<unsigned int>(state.range(0)));
+            add_command_resolvers(facts);
+            benchmark::DoNotOptimize(facts.size());
+        }
+        state.SetItemsProcessed(state.iterations() * command_resolvers);
+    }
+    BENCHMARK(commands_replayed)->Arg(1)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+    bool record_host(string const& path)
+    {
+        replay_log log(replay_mode::record);
+        {
+            scoped_replay_log recording(&log);
+            collection facts;
+            facts.add_default_facts();
+            facts.size();
+        }
+        if (!log.save(path)) {
+            return false;
+        }
+        boost::nowide::cout << "recorded " << log.size() << " commands and requests to " << path << "." << endl;
+        return true;
+    }
+
+    bool add_replayed_host(string const& path)
+    {
+        // The log is shared by every run of the benchmark and lives until the process exits
+        auto log = make_shared<replay_log>(replay_mode::replay);
+        if (!log->load(path)) {
+            return false;
+        }
+        benchmark::RegisterBenchmark("host_replayed", [log](benchmark::State& state) {
+            scoped_replay_log replaying(log.get());
+            for (auto _ : state) {
+                collection facts;
+                facts.concurrency(static_cast<unsigned int>(state.range(0)));
+                facts.add_default_facts();
+                benchmark::DoNotOptimize(facts.size());
+            }
+        })->Arg(1)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+        return true;
+    }
+
+}}  // namespace facter::benchmarks
@@ -0,0 +1,26 @@
+/**
+ * @file
+ * Declares the benchmarks that replay the commands and HTTP requests recorded on a host.
+ */
+#pragma once
+
+#include <string>
+
+namespace facter { namespace benchmarks {
+
+    /**
+     * Resolves the default facts on this host, recording the commands executed and the HTTP requests made.
+     * @param path The fixture file to save the recording to.
+     * @return Returns true if the recording was saved or false if not.
+     */
+    bool record_host(std::string const& path);
+
+    /**
+     * Adds a benchmark that resolves the default facts with the commands and HTTP requests answered from a recording.
+     * Each takes as long as it did when recorded, so the benchmark shows how well resolving in parallel hides them.
+     * @param path The fixture file of the recording.
+     * @return Returns true if the recording was loaded or false if not.
+     */
+    bool add_replayed_host(std::string const& path);
+
+}}  // namespace facter::benchmarks
@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+#include <facter/facts/collection.hpp>
+#include <internal/facts/linux/disk_resolver.hpp>
+#include <internal/facts/linux/filesystem_resolver.hpp>
+#include <internal/facts/linux/memory_resolver.hpp>
+#include <internal/facts/linux/processor_resolver.hpp>
+#include <internal/facts/resolvers/networking_resolver.hpp>
+#include "fixture_tree.hpp"
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::benchmarks;
+
+template <typename Resolver>
+static void resolve(benchmark::State& state, fixture_tree const& tree)
+{
+    for (auto _ : state) {
+        collection facts;
+        facts.root(tree.root());
+        facts.add(make_shared<Resolver>());
+        benchmark::DoNotOptimize(facts.size());
+    }
+}
+
+static void processor_resolver_256_threads(benchmark::State& state)
+{
+    resolve<linux::processor_resolver>(state, fixture_tree::many_processors(2, 256));
+}
+BENCHMARK(processor_resolver_256_threads)->Unit(benchmark::kMicrosecond);
+
+static void memory_resolver_256_threads(benchmark::State& state)
+{
+    resolve<linux::memory_resolver>(state, fixture_tree::many_processors(2, 256));
+}
+BENCHMARK(memory_resolver_256_threads)->Unit(benchmark::kMicrosecond);
+
+static void disk_resolver_container_host(benchmark::State& state)
+{
+    resolve<linux::disk_resolver>(state, fixture_tree::container_host(3000));
+}
+BENCHMARK(disk_resolver_container_host)->Unit(benchmark::kMicrosecond);
+
+static void filesystem_resolver_container_host(benchmark::State& state)
+{
+    resolve<linux::filesystem_resolver>(state, fixture_tree::container_host(3000));
+}
+BENCHMARK(filesystem_resolver_container_host)->Unit(benchmark::kMicrosecond);
+
+// The Linux resolver reads interfaces from netlink, which a file tree can't replay, so the interfaces are given directly
+struct recorded_networking_resolver : resolvers::networking_resolver
+{
+    explicit recorded_networking_resolver(unsigned int veths = 3000)
+    {
+        _data.hostname = "node";
+        _data.domain = "cluster.local";
+        _data.primary_interface = "eth0";
+        for (unsigned int i = 0; i < veths + 2; ++i) {
+            interface value;
+            if (i == 0) {
+                value.name = "lo";
+                value.address.v4 = "127.0.0.1";
+                value.netmask.v4 = "255.0.0.0";
+                value.network.v4 = "127.0.0.0";
+                value.address.v6 = "::1";
+                value.mtu = 65536;
+            } else if (i == 1) {
+                value.name = "eth0";
+                value.address.v4 = "10.0.0.10";
+                value.netmask.v4 = "255.255.255.0";
+                value.network.v4 = "10.0.0.0";
+                value.macaddress = "0a:1b:2c:3d:4e:5f";
+                value.dhcp_server = "10.0.0.1";
+                value.mtu = 9001;
+            } else {
+                char mac[18];
+                snprintf(mac, sizeof(mac), "ee:ee:ee:ee:%02x:%02x", (i >> 8) & 0xff, i & 0xff);
+                value.name = "veth" + to_string(i);
+                value.address.v6 = "fe80::ecee:eeff:feee:" + to_string(i);
+                value.netmask.v6 = "ffff:ffff:ffff:ffff::";
+                value.network.v6 = "fe80::";
+                value.macaddress = mac;
+                value.mtu = 8951;
+            }
+            _data.interfaces.emplace_back(move(value));
+        }
+    }
+
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        return _data;
+    }
+
+ private:
+    data _data;
+};
+
+static void networking_resolver_container_host(benchmark::State& state)
+{
+    auto resolver = make_shared<recorded_networking_resolver>();
+    for (auto _ : state) {
+        collection facts;
+        facts.add(resolver);
+        benchmark::DoNotOptimize(facts.size());
+    }
+}
+BENCHMARK(networking_resolver_container_host)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,185 @@
+#include <benchmark/benchmark.h>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/ruby/ruby.hpp>
+#include <internal/ruby/module.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace facter::facts;
+namespace fs = boost::filesystem;
+
+// The shapes of custom fact files, after the fixtures in lib/tests/fixtures/ruby
+// Each shape writes the file with the given index; files may refer to the facts of files with lower indexes
+static string simple_file(int index)
+{
+    ostringstream out;
+    out << "Facter.add(:bench_simple_" << index << ") do\n"
+        << "  setcode { 'value" << index << "' }\n"
+        << "end\n";
+    return out.str();
+}
+
+// Chains of 16 facts, each confined to the value of the one before it, as well as to built-in facts
+// Every file also adds a resolution that is never suitable, so most confines evaluated are of the same facts
+static string confine_file(int index)
+{
+    ostringstream out;
+    out << "Facter.add(:bench_confine_" << index << ") do\n"
+        << "  confine :kernel => 'Linux', :osfamily => ['RedHat', 'Debian']\n";
+    if (index % 16 != 0) {
+        out << "  confine :bench_confine_" << (index - 1) << " => 'value" << (index - 1) << "'\n";
+    }
+    out << "  confine :kernel do |value|\n"
+        << "    value.start_with?('Lin')\n"
+        << "  end\n"
+        << "  setcode { 'value" << index << "' }\n"
+        << "end\n"
+        << "\n"
+        << "Facter.add(:bench_confine_" << index << ") do\n"
+        << "  confine :kernel => 'windows'\n"
+        << "  setcode { 'unsuitable' }\n"
+        << "end\n";
+    return out.str();
+}
+
+// Facts with several weighted resolutions, only some of which are suitable
+static string weight_file(int index)
+{
+    ostringstream out;
+    for (int weight = 1; weight <= 4; ++weight) {
+        out << "Facter.add(:bench_weight_" << index << ") do\n"
+            << "  has_weight " << (weight * 100) << "\n";
+        if (weight % 2 == 0) {
+            out << "  confine :kernel => 'windows'\n";
+        }
+        out << "  setcode { 'value" << weight << "' }\n"
+            << "end\n"
+            << "\n";
+    }
+    return out.str();
+}
+
+// Aggregates of 8 chunks, each requiring the one before it, and a last chunk requiring all of them
+static string aggregate_file(int index)
+{
+    ostringstream out;
+    out << "Facter.add(:bench_aggregate_" << index << ", :type => :aggregate) do\n"
+        << "  chunk :chunk0 do\n"
+        << "    { 'chunk0' => " << index << " }\n"
+        << "  end\n";
+    for (int chunk = 1; chunk < 8; ++chunk) {
+        out << "  chunk :chunk" << chunk << ", :require => :chunk" << (chunk - 1) << " do |previous|\n"
+            << "    { 'chunk" << chunk << "' => previous.size }\n"
+            << "  end\n";
+    }
+    out << "  chunk :all, :require => [";
+    for (int chunk = 0; chunk < 8; ++chunk) {
+        out << (chunk ? ", " : "") << ":chunk" << chunk;
+    }
+    out << "] do |*chunks|\n"
+        << "    { 'all' => chunks.size }\n"
+        << "  end\n"
+        << "end\n";
+    return out.str();
+}
+
+// Facts whose values are built from the values of up to 8 other custom facts and a built-in fact
+static string value_file(int index)
+{
+    ostringstream out;
+    out << "Facter.add(:bench_value_" << index << ") do\n"
+        << "  setcode do\n"
+        << "    values = [Facter.value(:kernel)]\n";
+    for (int other = max(0, index - 8); other < index; ++other) {
+        out << "    values << Facter.value('bench_value_" << other << "')\n";
+    }
+    out << "    values.compact.size.to_s\n"
+        << "  end\n"
+        << "end\n";
+    return out.str();
+}
+
+// Writes a corpus of custom fact files once for each shape and size
+static string corpus(string const& shape, int files)
+{
+    static map<pair<string, int>, string> directories;
+    auto& directory = directories[make_pair(shape, files)];
+    if (!directory.empty()) {
+        return directory;
+    }
+
+    static map<string, string (*)(int)> const shapes = {
+        { "simple", simple_file },
+        { "confine", confine_file },
+        { "weight", weight_file },
+        { "aggregate", aggregate_file },
+        { "value", value_file },
+    };
+    auto path = fs::temp_directory_path() / fs::unique_path("facter-ruby-%%%%-%%%%");
+    fs::create_directories(path);
+    for (int i = 0; i < files; ++i) {
+        boost::nowide::ofstream out((path / ("bench_" + shape + "_" + to_string(i) + ".rb")).string().c_str());
+        out << shapes.at(shape)(i);
+    }
+    directory = path.string();
+    return directory;
+}
+
+// Loads and resolves a corpus of custom facts, reporting the time taken by each in milliseconds
+// With a cache directory, the compiled instruction sequences and the manifest of the corpus are written before timing
+static void custom_facts(benchmark::State& state, string const& shape, bool cached)
+{
+    if (!facter::ruby::initialize()) {
+        state.SkipWithError("Ruby could not be loaded.");
+        return;
+    }
+    vector<string> paths = { corpus(shape, static_cast<int>(state.range(0))) };
+    string cache_directory;
+    if (cached) {
+        cache_directory = (fs::path(paths.front()).parent_path() / fs::unique_path("facter-ruby-cache-%%%%-%%%%")).string();
+    }
+
+    auto run = [&](double* load, double* resolve) {
+        collection facts;
+        facts.add(fact::kernel, make_value<string_value>("Linux"));
+        facts.add(fact::os_family, make_value<string_value>("RedHat"));
+
+        auto start = chrono::steady_clock::now();
+        facter::ruby::module mod(facts, paths, cache_directory);
+        mod.load_facts();
+        auto loaded = chrono::steady_clock::now();
+        mod.resolve_facts();
+        auto resolved = chrono::steady_clock::now();
+        if (load && resolve) {
+            *load += chrono::duration<double, milli>(loaded - start).count();
+            *resolve += chrono::duration<double, milli>(resolved - loaded).count();
+        }
+        return resolved - start;
+    };
+    if (cached) {
+        run(nullptr, nullptr);
+    }
+
+    double load = 0;
+    double resolve = 0;
+    for (auto _ : state) {
+        state.SetIterationTime(chrono::duration<double>(run(&load, &resolve)).count());
+    }
+    state.counters["load_ms"] = benchmark::Counter(load, benchmark::Counter::kAvgIterations);
+    state.counters["resolve_ms"] = benchmark::Counter(resolve, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_CAPTURE(custom_facts, simple, string("simple"), false)->Arg(100)->Arg(500)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(custom_facts, simple_cached, string("simple"), true)->Arg(100)->Arg(500)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(custom_facts, confine, string("confine"), false)->Arg(100)->Arg(500)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(custom_facts, weight, string("weight"), false)->Arg(100)->Arg(500)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(custom_facts, aggregate, string("aggregate"), false)->Arg(100)->Arg(500)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(custom_facts, value, string("value"), false)->Arg(100)->Arg(500)->UseManualTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,157 @@
+#include <facter/facts/collection.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <facter/ruby/ruby.hpp>
+#include <internal/util/replay_log.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/nowide/iostream.hpp>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif  // __GLIBC__
+#include "soak.hpp"
+#include "synthetic.hpp"
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::util;
+
+namespace facter { namespace benchmarks {
+
+    // The queries answered at each cycle, as they would be sent to the daemon; the empty set writes every fact
+    static vector<set<string>> const soak_queries = {
+        { "kernel" },
+        { "os.family" },
+        { "networking.interfaces" },
+        { "processors.count" },
+        {},
+    };
+
+    // Gets the resident memory of the process in bytes, or zero if it isn't known
+    static uint64_t resident_memory()
+    {
+#ifdef __linux__
+        // The second field of statm is the number of resident pages
+        boost::nowide::ifstream statm("/proc/self/statm");
+        uint64_t size = 0;
+        uint64_t resident = 0;
+        if (!(statm >> size >> resident)) {
+            return 0;
+        }
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif  // __linux__
+    }
+
+    // Gets the bytes the allocator has given out and the bytes it holds free; free bytes that grow while the bytes in use don't are fragmentation
+    static void heap_usage(uint64_t& in_use, uint64_t& free)
+    {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        auto info = mallinfo2();
+        in_use = info.uordblks + info.hblkhd;
+        free = info.fordblks;
+#elif defined(__GLIBC__)
+        auto info = mallinfo();
+        in_use = static_cast<uint64_t>(static_cast<unsigned int>(info.uordblks)) + static_cast<unsigned int>(info.hblkhd);
+        free = static_cast<unsigned int>(info.fordblks);
+#else
+        in_use = 0;
+        free = 0;
+#endif
+    }
+
+    static double percentile(vector<double>& samples, double fraction)
+    {
+        if (samples.empty()) {
+            return 0;
+        }
+        auto nth = samples.begin() + static_cast<ptrdiff_t>(fraction * (samples.size() - 1));
+        nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+    }
+
+    bool run_soak(soak_options const& options)
+    {
+        replay_log log(replay_mode::replay);
+        if (!options.recording.empty()) {
+            if (!log.load(options.recording)) {
+                boost::nowide::cerr << "error: " << options.recording << " is not a recording." << endl;
+                return false;
+            }
+            // Replay without the recorded latency, so the cycles measure facter rather than the recorded host
+            log.latency(0);
+        }
+        scoped_replay_log replaying(options.recording.empty() ? nullptr : &log);
+
+        if (!options.custom_directories.empty() && !facter::ruby::initialize()) {
+            boost::nowide::cerr << "error: Ruby could not be loaded to resolve custom facts." << endl;
+            return false;
+        }
+
+        // Build the facts the way the daemon does at each refresh
+        auto build = [&]() {
+            unique_ptr<collection> facts(new collection());
+            facts->arena(false);
+            if (options.recording.empty()) {
+                populate(*facts, 64);
+            } else {
+                facts->add_default_facts();
+            }
+            if (!options.custom_directories.empty()) {
+                facter::ruby::load_custom_facts(*facts, options.custom_directories);
+            }
+            facts->size();
+            return facts;
+        };
+
+        auto report_every = options.report_every ? options.report_every : max<uint64_t>(options.cycles / 100, 1);
+        auto start = chrono::steady_clock::now();
+        shared_ptr<snapshot const> current;
+        vector<double> latencies;
+        double refresh_ms = 0;
+
+        boost::nowide::cout << "cycle\tseconds\trss_bytes\theap_in_use_bytes\theap_free_bytes\trefresh_ms\tquery_p50_us\tquery_p99_us" << endl;
+        for (uint64_t cycle = 1; cycle <= options.cycles; ++cycle) {
+            // Share unchanged facts with the previous snapshot, then drop the collection, as the daemon does when not sampling
+            auto refresh_start = chrono::steady_clock::now();
+            {
+                auto facts = build();
+                current = facts->take_snapshot(current);
+            }
+            refresh_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - refresh_start).count();
+
+            for (auto const& queries : soak_queries) {
+                auto query_start = chrono::steady_clock::now();
+                ostringstream output;
+                current->write(output, format::json, queries);
+                latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - query_start).count());
+            }
+
+            if (cycle % report_every == 0 || cycle == options.cycles) {
+                auto cycles = cycle % report_every ? cycle % report_every : report_every;
+                uint64_t in_use = 0;
+                uint64_t free = 0;
+                heap_usage(in_use, free);
+                boost::nowide::cout
+                    << cycle << '\t'
+                    << chrono::duration<double>(chrono::steady_clock::now() - start).count() << '\t'
+                    << resident_memory() << '\t'
+                    << in_use << '\t'
+                    << free << '\t'
+                    << refresh_ms / cycles << '\t'
+                    << percentile(latencies, 0.5) << '\t'
+                    << percentile(latencies, 0.99) << endl;
+                latencies.clear();
+                refresh_ms = 0;
+            }
+        }
+        return true;
+    }
+
+}}  // namespace facter::benchmarks
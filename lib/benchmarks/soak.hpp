@@ -0,0 +1,59 @@
+/**
+ * @file
+ * Declares the soak test that refreshes and queries facts the way the daemon does for many cycles.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace facter { namespace benchmarks {
+
+    /**
+     * Represents the options of a soak test.
+     */
+    struct soak_options
+    {
+        /**
+         * Constructs the default soak options.
+         */
+        soak_options() :
+            cycles(0),
+            report_every(0)
+        {
+        }
+
+        /**
+         * The number of refresh and query cycles to run.
+         */
+        uint64_t cycles;
+
+        /**
+         * The number of cycles between reports; zero reports a hundred times over the run.
+         */
+        uint64_t report_every;
+
+        /**
+         * The recording of a host to resolve the default facts from, or empty to refresh synthetic facts.
+         */
+        std::string recording;
+
+        /**
+         * The directories of custom facts to load and resolve at each refresh.
+         */
+        std::vector<std::string> custom_directories;
+    };
+
+    /**
+     * Runs a soak test: each cycle builds a collection, takes a snapshot of it sharing the unchanged facts of the
+     * previous snapshot, and answers queries from the snapshot, as the daemon does at each refresh.
+     * Every report is written to stdout as a line of tab-separated columns: the cycle, the elapsed seconds, the
+     * resident memory, the bytes the allocator has in use and holds free, the average refresh time, and the p50 and
+     * p99 query latencies of the cycles since the previous report.
+     * @param options The options of the soak test.
+     * @return Returns true if every cycle ran or false if the facts could not be built.
+     */
+    bool run_soak(soak_options const& options);
+
+}}  // namespace facter::benchmarks
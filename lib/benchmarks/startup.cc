@@ -0,0 +1,178 @@
+#include <benchmark/benchmark.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+namespace facter { namespace benchmarks {
+
+    // A run of cfacter, from its exec to its exit
+    struct startup_run
+    {
+        chrono::nanoseconds total;
+        chrono::nanoseconds first_output;
+        vector<pair<string, chrono::nanoseconds>> phases;
+    };
+
+    static chrono::nanoseconds now()
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch());
+    }
+
+    // Runs cfacter with its startup trace enabled; the trace's phases are in the same clock as the run's start
+    static bool run_cfacter(vector<string> const& arguments, startup_run& run)
+    {
+        int out[2];
+        int err[2];
+        if (pipe(out) != 0) {
+            return false;
+        }
+        if (pipe(err) != 0) {
+            close(out[0]);
+            close(out[1]);
+            return false;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+        posix_spawn_file_actions_addclose(&actions, out[0]);
+        posix_spawn_file_actions_addclose(&actions, err[0]);
+
+        vector<string> args = { CFACTER_EXECUTABLE };
+        args.insert(args.end(), arguments.begin(), arguments.end());
+        vector<char*> argv;
+        for (auto& arg : args) {
+            argv.push_back(&arg[0]);
+        }
+        argv.push_back(nullptr);
+
+        string trace = "FACTER_STARTUP_TRACE=1";
+        vector<char*> envp = { &trace[0] };
+        for (auto variable = environ; *variable; ++variable) {
+            envp.push_back(*variable);
+        }
+        envp.push_back(nullptr);
+
+        auto start = now();
+        pid_t pid;
+        int result = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), envp.data());
+        posix_spawn_file_actions_destroy(&actions);
+        close(out[1]);
+        close(err[1]);
+        if (result != 0) {
+            close(out[0]);
+            close(err[0]);
+            return false;
+        }
+
+        // Read both pipes until cfacter closes them, noting when the first byte of output arrives
+        run.first_output = chrono::nanoseconds(0);
+        string errors;
+        pollfd fds[] = { { out[0], POLLIN, 0 }, { err[0], POLLIN, 0 } };
+        char buffer[65536];
+        while (fds[0].fd >= 0 || fds[1].fd >= 0) {
+            if (poll(fds, 2, -1) < 0) {
+                break;
+            }
+            for (auto& fd : fds) {
+                if (fd.fd < 0 || fd.revents == 0) {
+                    continue;
+                }
+                auto count = read(fd.fd, buffer, sizeof(buffer));
+                if (count <= 0) {
+                    close(fd.fd);
+                    fd.fd = -1;
+                    continue;
+                }
+                if (fd.fd == out[0] && run.first_output.count() == 0) {
+                    run.first_output = now() - start;
+                }
+                if (fd.fd == err[0]) {
+                    errors.append(buffer, static_cast<size_t>(count));
+                }
+            }
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        run.total = now() - start;
+
+        // Each phase lasts from the end of the one before it; the first starts with the exec
+        run.phases.clear();
+        auto previous = start;
+        istringstream lines(errors);
+        string line;
+        while (getline(lines, line)) {
+            if (!boost::starts_with(line, "startup: ")) {
+                continue;
+            }
+            auto pos = line.rfind(' ');
+            chrono::nanoseconds ended(stoll(line.substr(pos + 1)));
+            run.phases.emplace_back(line.substr(9, pos - 9), ended - previous);
+            previous = ended;
+        }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0 && !run.phases.empty();
+    }
+
+    // Runs cfacter, reporting the average time of each phase of its startup in milliseconds
+    static void startup(benchmark::State& state, vector<string> arguments)
+    {
+        map<string, double> phases;
+        double first_output = 0;
+        for (auto _ : state) {
+            startup_run run;
+            if (!run_cfacter(arguments, run)) {
+                state.SkipWithError("cfacter failed or did not trace its startup.");
+                return;
+            }
+            state.SetIterationTime(chrono::duration<double>(run.total).count());
+            first_output += chrono::duration<double, milli>(run.first_output).count();
+            for (auto const& phase : run.phases) {
+                phases[boost::replace_all_copy(phase.first, " ", "_")] += chrono::duration<double, milli>(phase.second).count();
+            }
+        }
+        state.counters["first_output_ms"] = benchmark::Counter(first_output, benchmark::Counter::kAvgIterations);
+        for (auto const& phase : phases) {
+            state.counters[phase.first + "_ms"] = benchmark::Counter(phase.second, benchmark::Counter::kAvgIterations);
+        }
+    }
+
+    // A custom fact directory with a single trivial fact
+    static string custom_directory()
+    {
+        static string directory = []() {
+            auto path = fs::temp_directory_path() / fs::unique_path("facter-startup-%%%%-%%%%");
+            fs::create_directories(path);
+            boost::nowide::ofstream out((path / "startup.rb").string().c_str());
+            out << "Facter.add(:startup_benchmark) do\n  setcode { 'value' }\nend\n";
+            return path.string();
+        }();
+        return directory;
+    }
+
+    static void startup_custom_fact(benchmark::State& state)
+    {
+        startup(state, { "--custom-dir", custom_directory(), "startup_benchmark" });
+    }
+
+    BENCHMARK_CAPTURE(startup, single_fact, vector<string>{ "kernel" })->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(startup, single_fact_without_custom_facts, vector<string>{ "--no-custom-facts", "kernel" })->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(startup, full_json, vector<string>{ "--json" })->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(startup, full_json_without_custom_facts, vector<string>{ "--no-custom-facts", "--json" })->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK(startup_custom_fact)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+}}  // namespace facter::benchmarks
@@ -0,0 +1,75 @@
+#include "synthetic.hpp"
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+
+using namespace std;
+using namespace facter::facts;
+
+namespace facter { namespace benchmarks {
+
+    unique_ptr<map_value> make_networking(size_t interfaces)
+    {
+        auto networking = make_value<map_value>();
+        networking->add("hostname", make_value<string_value>("host"));
+        networking->add("domain", make_value<string_value>("example.com"));
+        networking->add("fqdn", make_value<string_value>("host.example.com"));
+        networking->add("ip", make_value<string_value>("10.0.0.1"));
+        networking->add("primary", make_value<string_value>("eth0"));
+
+        auto values = make_value<map_value>();
+        for (size_t i = 0; i < interfaces; ++i) {
+            auto octets = to_string(i / 256) + "." + to_string(i % 256);
+            auto value = make_value<map_value>();
+            value->add("ip", make_value<string_value>("10.0." + octets));
+            value->add("ip6", make_value<string_value>("fe80::" + to_string(i)));
+            value->add("mac", make_value<string_value>("02:42:ac:11:00:" + to_string(i % 100)));
+            value->add("mtu", make_value<integer_value>(1500));
+            value->add("netmask", make_value<string_value>("255.255.0.0"));
+            value->add("network", make_value<string_value>("10.0.0.0"));
+            values->add("eth" + to_string(i), move(value));
+        }
+        networking->add("interfaces", move(values));
+        return networking;
+    }
+
+    void populate(collection& facts, size_t interfaces)
+    {
+        for (size_t i = 0; i < 100; ++i) {
+            facts.add("scalar" + to_string(i), make_value<string_value>("a value of a typical length " + to_string(i)));
+        }
+        facts.add("networking", make_networking(interfaces));
+
+        // Hidden flat facts are added for each interface but not written
+        for (size_t i = 0; i < interfaces; ++i) {
+            auto name = "eth" + to_string(i);
+            facts.add("ipaddress_" + name, make_value<string_value>("10.0." + to_string(i / 256) + "." + to_string(i % 256), true));
+            facts.add("macaddress_" + name, make_value<string_value>("02:42:ac:11:00:" + to_string(i % 100), true));
+            facts.add("mtu_" + name, make_value<integer_value>(1500, true));
+        }
+
+        auto mountpoints = make_value<map_value>();
+        for (size_t i = 0; i < interfaces; ++i) {
+            auto value = make_value<map_value>();
+            value->add("device", make_value<string_value>("overlay"));
+            value->add("filesystem", make_value<string_value>("overlay"));
+            value->add("size_bytes", make_value<integer_value>(1024 * 1024 * 1024));
+            value->add("available_bytes", make_value<integer_value>(512 * 1024 * 1024));
+            auto options = make_value<array_value>();
+            options->add(make_value<string_value>("rw"));
+            options->add(make_value<string_value>("relatime"));
+            value->add("options", move(options));
+            mountpoints->add("/var/lib/docker/overlay2/" + to_string(i) + "/merged", move(value));
+        }
+        facts.add("mountpoints", move(mountpoints));
+
+        auto processors = make_value<map_value>();
+        auto models = make_value<array_value>();
+        for (size_t i = 0; i < 16; ++i) {
+            models->add(make_value<string_value>("Intel(R) Xeon(R) CPU E5-2680 v4 @ 2.40GHz"));
+        }
+        processors->add("count", make_value<integer_value>(16));
+        processors->add("models", move(models));
+        facts.add("processors", move(processors));
+    }
+
+}}  // namespace facter::benchmarks
@@ -0,0 +1,30 @@
+/**
+ * @file
+ * Declares the synthetic facts the benchmarks are run against.
+ */
+#pragma once
+
+#include <facter/facts/collection.hpp>
+#include <facter/facts/map_value.hpp>
+#include <memory>
+#include <string>
+
+namespace facter { namespace benchmarks {
+
+    /**
+     * Builds a networking fact shaped like the one resolved on a host.
+     * @param interfaces The number of interfaces in the fact.
+     * @return Returns the networking fact.
+     */
+    std::unique_ptr<facts::map_value> make_networking(size_t interfaces);
+
+    /**
+     * Adds facts shaped like those resolved on a host: about a hundred scalar facts, the structured
+     * networking, mountpoints, and processors facts, and the hidden flat facts for each interface.
+     * Container hosts have thousands of interfaces; a typical server has a few.
+     * @param facts The collection to add the facts to.
+     * @param interfaces The number of network interfaces (and mountpoints) to add.
+     */
+    void populate(facts::collection& facts, size_t interfaces);
+
+}}  // namespace facter::benchmarks
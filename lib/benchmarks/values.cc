@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include "synthetic.hpp"
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::benchmarks;
+
+static void map_value_construction(benchmark::State& state)
+{
+    auto count = static_cast<size_t>(state.range(0));
+    vector<string> keys;
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back("key" + to_string(i));
+    }
+    for (auto _ : state) {
+        map_value value;
+        for (auto const& key : keys) {
+            value.add(string(key), make_value<string_value>("value"));
+        }
+        benchmark::DoNotOptimize(value.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(map_value_construction)->Arg(8)->Arg(4096);
+
+static void array_value_construction(benchmark::State& state)
+{
+    auto count = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        array_value value;
+        for (size_t i = 0; i < count; ++i) {
+            value.add(make_value<integer_value>(static_cast<int64_t>(i)));
+        }
+        benchmark::DoNotOptimize(value.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(array_value_construction)->Arg(8)->Arg(4096);
+
+static void networking_construction(benchmark::State& state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(make_networking(static_cast<size_t>(state.range(0))));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(networking_construction)->Arg(4)->Arg(4096);
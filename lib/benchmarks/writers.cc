@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+#include <facter/facts/collection.hpp>
+#include "synthetic.hpp"
+#include <sstream>
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::benchmarks;
+
+static void write(benchmark::State& state, format fmt)
+{
+    collection facts;
+    populate(facts, static_cast<size_t>(state.range(0)));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        ostringstream stream;
+        facts.write(stream, fmt);
+        bytes += stream.str().size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+static void write_hash(benchmark::State& state)
+{
+    write(state, format::hash);
+}
+BENCHMARK(write_hash)->Arg(4)->Arg(256)->Arg(4096);
+
+static void write_json(benchmark::State& state)
+{
+    write(state, format::json);
+}
+BENCHMARK(write_json)->Arg(4)->Arg(256)->Arg(4096);
+
+static void write_yaml(benchmark::State& state)
+{
+    write(state, format::yaml);
+}
+BENCHMARK(write_yaml)->Arg(4)->Arg(256)->Arg(4096);
+
+static void write_queries(benchmark::State& state)
+{
+    collection facts;
+    populate(facts, static_cast<size_t>(state.range(0)));
+    set<string> queries = { "scalar1", "networking.ip", "networking.interfaces.eth3", "ipaddress_eth2" };
+    for (auto _ : state) {
+        ostringstream stream;
+        facts.write(stream, format::json, queries);
+        benchmark::DoNotOptimize(stream.str().size());
+    }
+}
+BENCHMARK(write_queries)->Arg(4)->Arg(4096);
@@ -1,9 +1,12 @@
 /**
  * @file
  * Declares functions used for executing commands.
+ * The functions are thread-safe: the environment of a child is built from a snapshot of this process' environment
+ * rather than by changing this process' environment.
  */
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -148,14 +151,67 @@ namespace facter { namespace execution {
         int _signal;
     };
 
+    /**
+     * Exception that is thrown when a child process is killed because it did not exit before its timeout.
+     */
+    struct LIBFACTER_EXPORT timeout_exception : execution_exception
+    {
+        /**
+         * Constructs a timeout_exception.
+         * @param message The exception message.
+         * @param pid The process id of the child process that was killed.
+         */
+        timeout_exception(std::string const& message, size_t pid);
+
+        /**
+         * Gets the process id of the child process that was killed.
+         * @return Returns the process id of the child process.
+         */
+        size_t pid() const;
+
+     private:
+        size_t _pid;
+    };
+
     /**
      * Searches the given paths for the given executable file.
+     * The result of searching for a file name without a directory is remembered for the given paths, whether or not
+     * the file was found, so the paths are searched only once per process; see clear_which_cache.
      * @param file The file to search for.
      * @param directories The directories to search.
      * @return Returns the full path or empty if the file could not be found.
      */
     std::string LIBFACTER_EXPORT which(std::string const& file, std::vector<std::string> const& directories = facter::util::environment::search_paths());
 
+    /**
+     * Forgets the results of previous searches by which.
+     * Call this after executables are added to or removed from the search paths.
+     */
+    void LIBFACTER_EXPORT clear_which_cache();
+
+    /**
+     * Starts a helper process that starts child processes on behalf of this process.
+     * The helper is forked while this process is small, so starting commands never forks this process once it has
+     * grown large (e.g. after loading Ruby). This must be called before any other threads are started.
+     * @return Returns true if the helper is running or false if it could not be started or is not supported on this platform.
+     */
+    bool LIBFACTER_EXPORT start_spawn_helper();
+
+    /**
+     * Stops the helper process started by start_spawn_helper; later commands are started by this process.
+     */
+    void LIBFACTER_EXPORT stop_spawn_helper();
+
+    /**
+     * Lowers the CPU and I/O priority of this process, and optionally restricts it to the given processors, so that it
+     * competes as little as possible with other work on the host.
+     * Threads and child processes started afterwards (including the spawn helper) inherit the priority and processors,
+     * so this should be called before they are started.
+     * @param cpus The processors to run on (e.g. a host's housekeeping processors); if empty, any processor is used.
+     * @return Returns true if the priority was lowered and the processors restricted, or false if any of them could not be.
+     */
+    bool LIBFACTER_EXPORT lower_priority(std::vector<unsigned int> const& cpus = {});
+
     /**
      * Expands the executable in the command to the full path.
      * @param command The command to expand.
@@ -164,27 +220,43 @@ namespace facter { namespace execution {
      */
     std::string LIBFACTER_EXPORT expand_command(std::string const& command, std::vector<std::string> const& directories = facter::util::environment::search_paths());
 
+    /**
+     * Gets the program and arguments to run a command line with.
+     * A command that uses no shell features (quoting, escapes, variables, globbing, redirection, pipes, command lists,
+     * substitution, comments, reserved words, or builtins) is run directly with its arguments split on whitespace, which
+     * saves starting a shell; any other command, or one whose program isn't found, is run with the command shell.
+     * Commands are always run with the command shell on Windows.
+     * @param command The command line to run.
+     * @param directories The directories to search for the program.
+     * @return Returns the program to execute and its arguments.
+     */
+    std::pair<std::string, std::vector<std::string>> LIBFACTER_EXPORT command_invocation(std::string const& command, std::vector<std::string> const& directories = facter::util::environment::search_paths());
+
     /**
      * Executes the given program.
      * @param file The name or path of the program to execute.
      * @param options The execution options.
+     * @param timeout The number of seconds after which the child process (and any process it started) is killed, or 0 for no timeout.
      * @return Returns whether or not the execution succeeded paired with the child process output.
      */
     std::pair<bool, std::string> LIBFACTER_EXPORT execute(
         std::string const& file,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program.
      * @param file The name or path of the program to execute.
      * @param arguments The arguments to pass to the program. On Windows they will be quoted as needed for spaces.
      * @param options The execution options.
+     * @param timeout The number of seconds after which the child process (and any process it started) is killed, or 0 for no timeout.
      * @return Returns whether or not the execution succeeded paired with the child process output.
      */
     std::pair<bool, std::string> LIBFACTER_EXPORT execute(
         std::string const& file,
         std::vector<std::string> const& arguments,
-        facter::util::option_set<execution_options> const& options  = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program.
@@ -192,25 +264,29 @@ namespace facter { namespace execution {
      * @param arguments The arguments to pass to the program. On Windows they will be quoted as needed for spaces.
      * @param environment The environment variables to pass to the child process.
      * @param options The execution options.
+     * @param timeout The number of seconds after which the child process (and any process it started) is killed, or 0 for no timeout.
      * @return Returns whether or not the execution succeeded paired with the child process output.
      */
     std::pair<bool, std::string> LIBFACTER_EXPORT execute(
         std::string const& file,
         std::vector<std::string> const& arguments,
         std::map<std::string, std::string> const& environment,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program and returns each line of output.
      * @param file The name or path of the program to execute.
      * @param callback The callback that is called with each line of output.
      * @param options The execution options.
+     * @param timeout The number of seconds after which the child process (and any process it started) is killed, or 0 for no timeout.
      * @return Returns true if the execution succeeded or false if it did not.
      */
     bool LIBFACTER_EXPORT each_line(
         std::string const& file,
         std::function<bool(std::string&)> callback,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program and returns each line of output.
@@ -218,13 +294,15 @@ namespace facter { namespace execution {
      * @param arguments The arguments to pass to the program. On Windows they will be quoted as needed for spaces.
      * @param callback The callback that is called with each line of output.
      * @param options The execution options.
+     * @param timeout The number of seconds after which the child process (and any process it started) is killed, or 0 for no timeout.
      * @return Returns true if the execution succeeded or false if it did not.
      */
     bool LIBFACTER_EXPORT each_line(
         std::string const& file,
         std::vector<std::string> const& arguments,
         std::function<bool(std::string&)> callback,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program and returns each line of output.
@@ -233,6 +311,7 @@ namespace facter { namespace execution {
      * @param environment The environment variables to pass to the child process.
      * @param callback The callback that is called with each line of output.
      * @param options The execution options.
+     * @param timeout The number of seconds after which the child process (and any process it started) is killed, or 0 for no timeout.
      * @return Returns true if the execution succeeded or false if it did not.
      */
     bool LIBFACTER_EXPORT each_line(
@@ -240,6 +319,27 @@ namespace facter { namespace execution {
         std::vector<std::string> const& arguments,
         std::map<std::string, std::string> const& environment,
         std::function<bool(std::string&)> callback,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
+
+    /**
+     * Executes the given program and returns each line of output, capturing stdout and stderr separately.
+     * @param file The name or path of the program to execute.
+     * @param arguments The arguments to pass to the program. On Windows they will be quoted as needed for spaces.
+     * @param environment The environment variables to pass to the child process.
+     * @param stdout_callback The callback that is called with each line of stdout.
+     * @param stderr_callback The callback that is called with each line of stderr; the redirect_stderr option is ignored.
+     * @param options The execution options.
+     * @param timeout The number of seconds after which the child process (and any process it started) is killed, or 0 for no timeout.
+     * @return Returns true if the execution succeeded or false if it did not.
+     */
+    bool LIBFACTER_EXPORT each_line(
+        std::string const& file,
+        std::vector<std::string> const& arguments,
+        std::map<std::string, std::string> const& environment,
+        std::function<bool(std::string&)> stdout_callback,
+        std::function<bool(std::string&)> stderr_callback,
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
 }}  // namespace facter::execution
@@ -6,14 +6,31 @@
 
 #include "value.hpp"
 #include "../export.h"
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <functional>
 
 namespace facter { namespace facts {
 
+    struct array_value;
+
+    /**
+     * Specializes the type tag for array values.
+     */
+    template <>
+    struct value_type_of<array_value>
+    {
+        /**
+         * The type tag of array values.
+         */
+        static constexpr value_type type = value_type::array;
+    };
+
     /**
      * Represents an array of values.
+     * Elements are shared: copies of the array share every element that is not deferred, so unchanged
+     * subtrees are pointer-equal between copies. Elements must not be changed once they are added.
      * This type can be moved but cannot be copied.
      */
     struct LIBFACTER_EXPORT array_value : value
@@ -23,7 +40,9 @@ namespace facter { namespace facts {
          * @param hidden True if the fact is hidden from output by default or false if not.
          */
         array_value(bool hidden = false) :
-            value(hidden)
+            value(value_type::array, hidden),
+            _deferred(false),
+            _hash(0)
         {
         }
 
@@ -55,9 +74,18 @@ namespace facter { namespace facts {
 
         /**
          * Adds a value to the array.
+         * The value may already be shared with other maps or arrays.
          * @param value The value to add to the array.
          */
-        void add(std::unique_ptr<value> value);
+        void add(std::shared_ptr<value const> value);
+
+        /**
+         * Gets the shared value at the given index.
+         * Lazy values are not unwrapped.
+         * @param i The index in the array to get the element at.
+         * @return Returns the shared value at the given index or nullptr if the index is out of range.
+         */
+        std::shared_ptr<value const> share(size_t i) const;
 
         /**
          * Checks to see if the array is empty.
@@ -67,12 +95,14 @@ namespace facter { namespace facts {
 
         /**
          * Gets the size of the array.
+         * Lazy values that have not been computed are counted.
          * @return Returns the number of values in the array.
          */
         size_t size() const;
 
         /**
          * Enumerates all facts in the array.
+         * Lazy values are computed and unwrapped; lazy values without a value are skipped.
          * @param func The callback function called for each value in the array.
          */
         void each(std::function<bool(value const*)> func) const;
@@ -84,6 +114,12 @@ namespace facter { namespace facts {
          */
         virtual void to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const override;
 
+        /**
+         * Writes the value as MessagePack.
+         * @param writer The MessagePack writer to write to.
+         */
+        virtual void to_msgpack(msgpack_writer& writer) const override;
+
         /**
          * Gets the element at the given index.
          * @tparam T The expected type of the value.
@@ -92,13 +128,16 @@ namespace facter { namespace facts {
          */
         template <typename T = value> T const* get(size_t i) const
         {
-            return dynamic_cast<T const*>(_elements.at(i).get());
+            // Use at() so that an invalid index throws std::out_of_range
+            _elements.at(i);
+            return value_cast<T>(this->operator [](i));
         }
 
         /**
          * Gets the value at the given index.
          * @param i The index in the array to get the element at.
-         * @return Returns the value at the given index.
+         * Lazy values are computed and unwrapped.
+         * @return Returns the value at the given index or nullptr if the index is out of range or a lazy value has no value.
          */
         value const* operator[](size_t i) const;
 
@@ -118,8 +157,45 @@ namespace facter { namespace facts {
           */
         virtual YAML::Emitter& write(YAML::Emitter& emitter) const override;
 
+        /**
+         * Determines if the array contains a value that is computed on first use.
+         * @return Returns true if any element is deferred or false if not.
+         */
+        virtual bool deferred() const override;
+
+        /**
+         * Creates a copy of the value.
+         * Elements that are not deferred are shared with the copy; lazy elements are evaluated and copied,
+         * and elements without a value are not copied.
+         * @return Returns the copy of the value.
+         */
+        virtual std::unique_ptr<value> clone() const override;
+
+        /**
+         * Determines if the given value is equal to this value.
+         * Whether or not the values or their elements are hidden is not compared.
+         * @param other The value to compare to.
+         * @return Returns true if the other value is an array with equal elements or false if not.
+         */
+        virtual bool equals(value const& other) const override;
+
+        /**
+         * Gets a hash of the array's elements in order, computed from the hashes of the elements.
+         * The hash is kept until an element is added.
+         * @return Returns the hash of the array.
+         */
+        virtual uint64_t hash() const override;
+
+        /**
+         * Estimates the memory used by the array and its elements.
+         * @return Returns the approximate number of bytes used by the array.
+         */
+        virtual size_t memory_usage() const override;
+
      private:
-        std::vector<std::unique_ptr<value>> _elements;
+        std::vector<std::shared_ptr<value const>> _elements;
+        bool _deferred;
+        mutable std::atomic<uint64_t> _hash;
     };
 
 }}  // namespace facter::facts
@@ -0,0 +1,244 @@
+/**
+ * @file
+ * Declares the C API for embedding fact collections in other languages.
+ * Values are borrowed: a value, and the string and name storage it points to, is owned by its collection and is valid
+ * until the collection is freed or its facts change (e.g. by adding, refreshing, or resolving facts again).
+ * Every function may be called with a NULL collection or value; functions that fail record a message that
+ * facter_last_error returns.
+ * A collection may not be used from more than one thread at a time.
+ */
+#pragma once
+
+#include "../export.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An opaque fact collection.
+ */
+typedef struct facter_collection facter_collection;
+
+/**
+ * An opaque fact value borrowed from a collection.
+ */
+typedef struct facter_value facter_value;
+
+/**
+ * The type of a fact value.
+ */
+typedef enum facter_value_type
+{
+    /**
+     * A value of any other type (e.g. a Ruby value).
+     */
+    FACTER_VALUE_OTHER,
+    /**
+     * A string value.
+     */
+    FACTER_VALUE_STRING,
+    /**
+     * An integer value.
+     */
+    FACTER_VALUE_INTEGER,
+    /**
+     * A boolean value.
+     */
+    FACTER_VALUE_BOOLEAN,
+    /**
+     * A double value.
+     */
+    FACTER_VALUE_DOUBLE,
+    /**
+     * An array value.
+     */
+    FACTER_VALUE_ARRAY,
+    /**
+     * A map value.
+     */
+    FACTER_VALUE_MAP
+} facter_value_type;
+
+/**
+ * Called for each named fact or map element.
+ * The name is not null-terminated.
+ * @param context The context given to the enumerating function.
+ * @param name The name of the fact or element.
+ * @param length The length of the name in bytes.
+ * @param value The value of the fact or element.
+ * @return Returns nonzero to continue enumerating or zero to stop.
+ */
+typedef int (*facter_name_callback)(void* context, char const* name, size_t length, facter_value const* value);
+
+/**
+ * Called for each array element.
+ * @param context The context given to the enumerating function.
+ * @param value The value of the element.
+ * @return Returns nonzero to continue enumerating or zero to stop.
+ */
+typedef int (*facter_element_callback)(void* context, facter_value const* value);
+
+/**
+ * Gets the message of the last failure on the calling thread.
+ * @return Returns the message of the last failure or an empty string if there was none; valid until the next failure on the thread.
+ */
+LIBFACTER_EXPORT char const* facter_last_error(void);
+
+/**
+ * Creates an empty fact collection.
+ * @return Returns the new collection or NULL if it could not be created.
+ */
+LIBFACTER_EXPORT facter_collection* facter_collection_new(void);
+
+/**
+ * Frees a fact collection and every value borrowed from it.
+ * @param facts The collection to free.
+ */
+LIBFACTER_EXPORT void facter_collection_free(facter_collection* facts);
+
+/**
+ * Adds the default (native) facts to a collection.
+ * @param facts The collection to add to.
+ * @return Returns zero on success or nonzero on failure.
+ */
+LIBFACTER_EXPORT int facter_collection_add_default_facts(facter_collection* facts);
+
+/**
+ * Adds external facts to a collection.
+ * @param facts The collection to add to.
+ * @param directories The directories to search for external facts; if count is zero, the default search paths are used.
+ * @param count The number of directories.
+ * @return Returns zero on success or nonzero on failure.
+ */
+LIBFACTER_EXPORT int facter_collection_add_external_facts(facter_collection* facts, char const* const* directories, size_t count);
+
+/**
+ * Adds a string fact to a collection.
+ * @param facts The collection to add to.
+ * @param name The name of the fact.
+ * @param value The null-terminated string value of the fact.
+ * @return Returns zero on success or nonzero on failure.
+ */
+LIBFACTER_EXPORT int facter_collection_add_string(facter_collection* facts, char const* name, char const* value);
+
+/**
+ * Resolves the facts needed to answer the given queries.
+ * Querying a collection resolves facts on demand; resolving first lets the work be done up front, or in parallel.
+ * @param facts The collection to resolve.
+ * @param queries The queries to resolve; if count is zero, all facts are resolved.
+ * @param count The number of queries.
+ * @return Returns zero on success or nonzero on failure.
+ */
+LIBFACTER_EXPORT int facter_collection_resolve(facter_collection* facts, char const* const* queries, size_t count);
+
+/**
+ * Queries a collection (e.g. "os.release.major").
+ * @param facts The collection to query.
+ * @param query The query to run.
+ * @return Returns the borrowed value or NULL if the query selected no value.
+ */
+LIBFACTER_EXPORT facter_value const* facter_collection_query(facter_collection* facts, char const* query);
+
+/**
+ * Enumerates every fact in a collection, resolving all facts first.
+ * @param facts The collection to enumerate.
+ * @param callback The callback called with the name and value of each fact.
+ * @param context The context passed to the callback.
+ * @return Returns zero on success or nonzero on failure.
+ */
+LIBFACTER_EXPORT int facter_collection_each(facter_collection* facts, facter_name_callback callback, void* context);
+
+/**
+ * Gets the type of a value.
+ * @param value The value.
+ * @return Returns the type of the value; a NULL value is of the other type.
+ */
+LIBFACTER_EXPORT facter_value_type facter_value_get_type(facter_value const* value);
+
+/**
+ * Determines if a value is hidden from output by default.
+ * @param value The value.
+ * @return Returns nonzero if the value is hidden or zero if it is not.
+ */
+LIBFACTER_EXPORT int facter_value_hidden(facter_value const* value);
+
+/**
+ * Gets the contents of a string value without copying them.
+ * @param value The string value.
+ * @param data Receives a pointer to the string's storage; it is null-terminated, but may also contain null bytes.
+ * @param length Receives the length of the string in bytes.
+ * @return Returns zero on success or nonzero if the value is not a string.
+ */
+LIBFACTER_EXPORT int facter_value_get_string(facter_value const* value, char const** data, size_t* length);
+
+/**
+ * Gets an integer value.
+ * @param value The integer value.
+ * @param result Receives the integer.
+ * @return Returns zero on success or nonzero if the value is not an integer.
+ */
+LIBFACTER_EXPORT int facter_value_get_integer(facter_value const* value, int64_t* result);
+
+/**
+ * Gets a boolean value.
+ * @param value The boolean value.
+ * @param result Receives nonzero if the value is true or zero if it is false.
+ * @return Returns zero on success or nonzero if the value is not a boolean.
+ */
+LIBFACTER_EXPORT int facter_value_get_boolean(facter_value const* value, int* result);
+
+/**
+ * Gets a double value.
+ * @param value The double value.
+ * @param result Receives the double.
+ * @return Returns zero on success or nonzero if the value is not a double.
+ */
+LIBFACTER_EXPORT int facter_value_get_double(facter_value const* value, double* result);
+
+/**
+ * Gets the number of elements in an array or map value.
+ * @param value The array or map value.
+ * @return Returns the number of elements or zero if the value is not an array or map.
+ */
+LIBFACTER_EXPORT size_t facter_value_size(facter_value const* value);
+
+/**
+ * Gets an element of an array value.
+ * @param value The array value.
+ * @param index The index of the element.
+ * @return Returns the borrowed element or NULL if the value is not an array or the index is out of range.
+ */
+LIBFACTER_EXPORT facter_value const* facter_value_array_get(facter_value const* value, size_t index);
+
+/**
+ * Gets an element of a map value.
+ * @param value The map value.
+ * @param name The null-terminated name of the element.
+ * @return Returns the borrowed element or NULL if the value is not a map or has no element with the name.
+ */
+LIBFACTER_EXPORT facter_value const* facter_value_map_get(facter_value const* value, char const* name);
+
+/**
+ * Enumerates the elements of an array value.
+ * @param value The array value.
+ * @param callback The callback called with each element.
+ * @param context The context passed to the callback.
+ * @return Returns zero on success or nonzero if the value is not an array.
+ */
+LIBFACTER_EXPORT int facter_value_array_each(facter_value const* value, facter_element_callback callback, void* context);
+
+/**
+ * Enumerates the elements of a map value in name order.
+ * @param value The map value.
+ * @param callback The callback called with the name and value of each element.
+ * @param context The context passed to the callback.
+ * @return Returns zero on success or nonzero if the value is not a map.
+ */
+LIBFACTER_EXPORT int facter_value_map_each(facter_value const* value, facter_name_callback callback, void* context);
+
+#ifdef __cplusplus
+}
+#endif
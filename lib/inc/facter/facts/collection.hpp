@@ -5,21 +5,45 @@
 #pragma once
 
 #include "resolver.hpp"
+#include "query.hpp"
 #include "value.hpp"
 #include "external/resolver.hpp"
 #include "../export.h"
 #include <list>
 #include <map>
 #include <set>
+#include <utility>
 #include <vector>
 #include <string>
 #include <memory>
 #include <functional>
 #include <stdexcept>
 #include <iostream>
+#include <chrono>
+#include <atomic>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace facter { namespace util {
+
+    struct statistics;
+
+}}  // namespace facter::util
+
+namespace facter { namespace execution {
+
+    struct command_cache;
+
+}}  // namespace facter::execution
 
 namespace facter { namespace facts {
 
+    struct fact_cache;
+    struct resolver_index;
+    struct snapshot;
+    struct value_arena;
+
     /**
      * The supported output format for the fact collection.
      */
@@ -36,7 +60,108 @@ namespace facter { namespace facts {
         /**
          * Use YAML as the format.
          */
-        yaml
+        yaml,
+        /**
+         * Use JSON without any whitespace as the format.
+         */
+        json_compact,
+        /**
+         * Use MessagePack (binary) as the format.
+         */
+        msgpack,
+        /**
+         * Use newline-delimited JSON as the format: each fact (or query) is written as a single-line JSON object
+         * of its name and value, and the stream is flushed after each line.
+         */
+        ndjson
+    };
+
+    /**
+     * Stores the time spent and the work performed by the resolvers with a given name.
+     * Time spent resolving another resolver inline is attributed to that resolver instead.
+     */
+    struct LIBFACTER_EXPORT resolver_timing
+    {
+        /**
+         * Stores the name of the resolver.
+         */
+        std::string name;
+
+        /**
+         * Stores the number of times a resolver with this name was resolved.
+         */
+        size_t resolutions;
+
+        /**
+         * Stores the wall time spent resolving.
+         */
+        std::chrono::nanoseconds wall_time;
+
+        /**
+         * Stores the CPU time spent resolving.
+         */
+        std::chrono::nanoseconds cpu_time;
+
+        /**
+         * Stores the number of child processes spawned.
+         */
+        size_t processes;
+
+        /**
+         * Stores the number of bytes read from files and child processes.
+         */
+        size_t bytes_read;
+
+        /**
+         * Stores the number of HTTP requests made.
+         */
+        size_t http_requests;
+    };
+
+    /**
+     * Stores the estimated memory used by a top-level fact.
+     */
+    struct LIBFACTER_EXPORT fact_memory_usage
+    {
+        /**
+         * Stores the name of the fact.
+         */
+        std::string name;
+
+        /**
+         * Stores the approximate number of bytes used by the fact: its name, its entry in the collection, and its value tree.
+         */
+        size_t bytes;
+    };
+
+    /**
+     * Describes a fact whose value was added, removed, or changed when the fact was refreshed.
+     */
+    struct LIBFACTER_EXPORT fact_change
+    {
+        /**
+         * Stores the name of the fact.
+         */
+        std::string name;
+
+        /**
+         * Stores the value of the fact before the refresh or nullptr if the fact was added.
+         * The value is only valid for the duration of the subscription callback.
+         */
+        value const* previous;
+
+        /**
+         * Stores the value of the fact after the refresh or nullptr if the fact was removed.
+         * The value is a copy of the fact's value, so it isn't affected by changes to the collection during the callback.
+         * The value is only valid for the duration of the subscription callback.
+         */
+        value const* current;
+
+        /**
+         * Stores the query paths (e.g. "networking.interfaces.eth0.ip") of the values that were added, removed, or changed.
+         * Map keys containing a "." are quoted; for a fact that was added or removed, this is only the fact's name.
+         */
+        std::vector<std::string> paths;
     };
 
     /**
@@ -106,12 +231,28 @@ namespace facter { namespace facts {
          */
         void add_external_facts(std::vector<std::string> const& directories = {});
 
+        /**
+         * Adds the resolvers of native fact plugins to the fact collection.
+         * Every shared library in the directories is loaded and the resolvers created by its plugin factory are added.
+         * See facter/facts/plugin.hpp for how plugins are defined; libraries that aren't plugins for this version are skipped.
+         * @param directories The directories to load fact plugins from.
+         */
+        void add_plugins(std::vector<std::string> const& directories);
+
         /**
          * Adds facts defined via "FACTER_xyz" environment variables.
          * @param callback The callback that is called with the name of each fact added from the environment.
          */
         void add_environment_facts(std::function<void(std::string const&)> callback = nullptr);
 
+        /**
+         * Adds facts previously written in the MessagePack format to the fact collection.
+         * No facts are added if the data cannot be decoded.
+         * @param data The MessagePack data to decode.
+         * @return Returns true if the facts were added or false if the data could not be decoded.
+         */
+        bool add_msgpack_facts(std::string const& data);
+
         /**
          * Removes a resolver from the fact collection.
          * @param res The resolver to remove from the fact collection.
@@ -144,6 +285,300 @@ namespace facter { namespace facts {
          */
         size_t size();
 
+        /**
+         * Gets the number of threads used to resolve all facts.
+         * @return Returns the number of threads used to resolve all facts.
+         */
+        unsigned int concurrency() const;
+
+        /**
+         * Sets the number of threads used to resolve all facts.
+         * Resolvers are started in the order they were added; a resolver is not started while an
+         * earlier resolver for one of the same fact names is still resolving or while a resolver
+         * for one of its declared dependencies has yet to finish resolving.
+         * Resolvers that are not thread safe are always resolved on the calling thread.
+         * When every fact is written, the facts are also formatted on this many threads; the output is unchanged.
+         * @param threads The number of threads to use; 0 or 1 resolves facts serially on the calling thread.
+         */
+        void concurrency(unsigned int threads);
+
+        /**
+         * Enables caching the facts of resolvers with a time-to-live (TTL) in the given file.
+         * Facts of a resolver with a TTL are loaded from the cache file until they expire,
+         * after which the resolver is resolved again and the cache file updated.
+         * Resolvers that report their facts as unavailable are recorded in the cache file too, and are not resolved
+         * again until the record expires or the host is rebooted.
+         * @param path The path to the cache file.
+         * @param ttls The time-to-live of each resolver's facts, keyed by resolver name.
+         * @param unavailable_ttl The time-to-live of the records of resolvers whose facts are unavailable; zero means they are not recorded.
+         * @param max_ttl The longest time-to-live of facts that do not change: each time a resolver's facts expire and are
+         * resolved to the same values, their TTL doubles up to this, and when they change it returns to the resolver's TTL.
+         * Zero keeps every TTL fixed.
+         */
+        void cache(std::string path, std::map<std::string, std::chrono::seconds> ttls, std::chrono::seconds unavailable_ttl = std::chrono::seconds(0), std::chrono::seconds max_ttl = std::chrono::seconds(0));
+
+        /**
+         * Resolves the facts that do not change until the host is rebooted (e.g. DMI, disks, processors, cloud metadata,
+         * SSH keys, and the operating system release) and stores them in the cache file until the host is rebooted.
+         * This is meant to be run once at boot: later collections using the same cache file then load these facts
+         * rather than resolving them, regardless of any TTL. Facts already primed during this boot are not resolved again.
+         * Does nothing without a cache file (see cache) or where the current boot cannot be identified.
+         */
+        void prime_cache();
+
+        /**
+         * Called by a resolver to report that its facts are unavailable on this host (e.g. it is not a cloud instance).
+         * When caching, the resolver is then not resolved again until the record expires or the host is rebooted.
+         * @param res The resolver whose facts are unavailable.
+         */
+        void unavailable(resolver const& res);
+
+        /**
+         * Sets the time limit of each resolver.
+         * Once a resolver exceeds its time limit, its long running operations (e.g. executing commands or making
+         * HTTP requests) are abandoned; the facts it resolved before then are kept but are not cached.
+         * @param timeout The time limit of every resolver without a specific time limit; zero means no time limit.
+         * @param timeouts The time limits of specific resolvers, keyed by resolver name.
+         */
+        void timeouts(std::chrono::milliseconds timeout, std::map<std::string, std::chrono::milliseconds> timeouts = {});
+
+        /**
+         * Sets the deadline for resolving facts.
+         * Resolvers that have not started by the deadline are not resolved and resolvers that are still
+         * resolving are abandoned, so the collection contains only the facts that resolved in time.
+         * @param deadline The deadline for resolving facts.
+         */
+        void deadline(std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * Cancels resolving facts.
+         * This may be called from any thread. Resolvers that are resolving are abandoned and no further resolvers are resolved.
+         */
+        void cancel();
+
+        /**
+         * Sets the resolvers that should not be added to the collection.
+         * This must be called before resolvers are added (e.g. before add_default_facts); blocked resolvers are
+         * never added and therefore never resolved.
+         * @param blocked The names of the resolvers to block.
+         * @param allowed The names of the resolvers that are allowed even if blocked or expensive.
+         */
+        void filter(std::set<std::string> blocked, std::set<std::string> allowed = {});
+
+        /**
+         * Sets whether or not expensive resolvers are resolved when resolving all facts.
+         * When enabled, expensive resolvers (see resolver::is_expensive) that are not explicitly allowed are
+         * only resolved when one of their facts is queried or accessed by name.
+         * @param enabled True to skip expensive resolvers or false to resolve them.
+         */
+        void cost_budget(bool enabled);
+
+        /**
+         * Sets whether or not fact values created by resolvers are allocated from an arena.
+         * The arena allocates values from large chunks of memory, reducing the number of allocations made when
+         * resolving facts; a chunk is freed once every value allocated from it has been destroyed.
+         * @param enabled True to allocate fact values from an arena or false to allocate them individually.
+         */
+        void arena(bool enabled);
+
+        /**
+         * Sets the root directory that facts are resolved relative to.
+         * Files read by resolvers (e.g. from /proc, /sys, or /etc) and the default external fact directories are
+         * found beneath the root, so the facts of a container or chroot can be resolved from the host.
+         * Facts that come from executed commands or system calls still describe the host.
+         * @param root The root directory; an empty string resolves facts relative to "/".
+         */
+        void root(std::string root);
+
+        /**
+         * Gets the root directory that facts are resolved relative to.
+         * @return Returns the root directory or an empty string if facts are resolved relative to "/".
+         */
+        std::string const& root() const;
+
+        /**
+         * Sets the network interfaces that are resolved.
+         * Interface names are matched in full against the regular expressions (e.g. "veth.*"); an interface is resolved
+         * if it matches one of the included expressions (or none are given) and none of the excluded expressions.
+         * Filtered interfaces are skipped before their DHCP servers are looked up or their facts are added.
+         * @param included The expressions of the interfaces to resolve; empty resolves every interface that is not excluded.
+         * @param excluded The expressions of the interfaces to not resolve.
+         * @param summarize True to also count the interfaces of each class (e.g. "veth") in the networking fact.
+         */
+        void interface_filter(std::vector<std::string> included, std::vector<std::string> excluded, bool summarize = false);
+
+        /**
+         * Gets the expressions of the network interfaces that are resolved.
+         * @return Returns the expressions or an empty vector if every interface that is not excluded is resolved.
+         */
+        std::vector<std::string> const& included_interfaces() const;
+
+        /**
+         * Gets the expressions of the network interfaces that are not resolved.
+         * @return Returns the expressions of the excluded interfaces.
+         */
+        std::vector<std::string> const& excluded_interfaces() const;
+
+        /**
+         * Gets whether or not the interfaces of each class are counted in the networking fact.
+         * @return Returns true if interfaces are counted by class or false if not.
+         */
+        bool summarize_interfaces() const;
+
+        /**
+         * Sets whether hidden legacy facts (e.g. "ipaddress_eth0" or "blockdevice_sda_size") are only added when queried.
+         * These are the facts matching a resolver's patterns; there may be thousands of them on hosts with many
+         * interfaces or devices, and they are never output unless queried. When added on demand, they are only added
+         * while resolving queries that name them, so custom facts can't look them up otherwise.
+         * @param on_demand True to only add hidden legacy facts when queried or false to always add them.
+         */
+        void legacy_facts_on_demand(bool on_demand);
+
+        /**
+         * Gets whether hidden legacy facts are only added when queried.
+         * @return Returns true if hidden legacy facts are only added when queried or false if they are always added.
+         */
+        bool legacy_facts_on_demand() const;
+
+        /**
+         * Sets whether external PowerShell facts (.ps1 files) are resolved by one PowerShell process on Windows.
+         * Starting PowerShell takes a significant fraction of a second, so running every script in one process is
+         * much faster, but the scripts are then run one at a time and share the process' state.
+         * This must be set before external facts are added; it has no effect on other platforms.
+         * @param persistent True to run every PowerShell script in one process or false to start PowerShell for each script.
+         */
+        void powershell_host(bool persistent);
+
+        /**
+         * Gets whether external PowerShell facts are resolved by one PowerShell process on Windows.
+         * @return Returns true if every PowerShell script is run in one process or false if PowerShell is started for each script.
+         */
+        bool powershell_host() const;
+
+        /**
+         * Determines if a resolver should add the hidden legacy facts matching its patterns.
+         * @param res The resolver that is resolving.
+         * @return Returns true if legacy facts are always added or if a query names a fact matching the resolver's patterns.
+         */
+        bool is_legacy_queried(resolver const& res) const;
+
+        /**
+         * Sets the mountpoints that are resolved.
+         * Mountpoints of an excluded file system type (e.g. "nfs" or "fuse.sshfs") are not resolved. The sizes of
+         * remote file systems (e.g. NFS, CIFS, or FUSE) are queried with a time limit so that an unresponsive server
+         * can't block resolution; a mountpoint that doesn't respond in time is reported as unavailable.
+         * @param excluded The file system types of the mountpoints to not resolve.
+         * @param remote_timeout The time limit for querying the size of a remote file system.
+         */
+        void filesystem_filter(std::vector<std::string> excluded, std::chrono::milliseconds remote_timeout = std::chrono::seconds(2));
+
+        /**
+         * Gets the file system types of the mountpoints that are not resolved.
+         * @return Returns the excluded file system types.
+         */
+        std::vector<std::string> const& excluded_filesystems() const;
+
+        /**
+         * Gets the time limit for querying the size of a remote file system.
+         * @return Returns the time limit.
+         */
+        std::chrono::milliseconds remote_filesystem_timeout() const;
+
+        /**
+         * Sets the time limit for looking up the fully qualified domain name of the host.
+         * If the lookup doesn't finish in time (e.g. DNS is unreachable), the domain is taken from the resolver configuration.
+         * @param timeout The time limit for looking up the FQDN.
+         */
+        void fqdn_timeout(std::chrono::milliseconds timeout);
+
+        /**
+         * Gets the time limit for looking up the fully qualified domain name of the host.
+         * @return Returns the time limit.
+         */
+        std::chrono::milliseconds fqdn_timeout() const;
+
+        /**
+         * Resolves all facts of the given collections using a shared set of threads.
+         * Each collection is resolved by one thread at a time; resolvers that are not thread safe are resolved
+         * on the calling thread once the other resolvers have been resolved.
+         * @param collections The collections to resolve.
+         * @param threads The number of threads to use; 0 or 1 resolves the collections serially on the calling thread.
+         */
+        static void resolve_all(std::vector<collection*> const& collections, unsigned int threads);
+
+        /**
+         * Gets the timing of the resolvers that have been resolved.
+         * @return Returns the resolver timings, ordered by descending wall time.
+         */
+        std::vector<resolver_timing> timings();
+
+        /**
+         * Estimates the memory used by each fact, resolving every fact first.
+         * Lazy values that have not been computed are not computed; values shared with a snapshot are counted in full.
+         * @return Returns the memory used by each fact, ordered by descending size.
+         */
+        std::vector<fact_memory_usage> memory_usage();
+
+        /**
+         * Records time spent and work performed outside of a resolver (e.g. loading or resolving a custom fact).
+         * The timing is reported by timings alongside the resolvers' timings.
+         * @param name The name to record the timing under.
+         * @param stats The statistics to record.
+         */
+        LIBFACTER_NO_EXPORT void record_timing(std::string const& name, util::statistics const& stats);
+
+        /**
+         * Resolves the given facts again, leaving every other fact untouched.
+         * Every resolved resolver responsible for one of the facts is resolved again, as is every resolved resolver
+         * that declares a dependency on the facts those resolvers are responsible for.
+         * Cached facts are not loaded from the cache when refreshing; the cache is updated with the new values instead.
+         * @param names The names of the facts to refresh.
+         * @return Returns the names of the facts that were added, removed, or changed by the refresh.
+         */
+        std::set<std::string> refresh(std::set<std::string> const& names);
+
+        /**
+         * Gets the names of the facts that refreshing resolves again.
+         * These are the facts added by a resolved resolver; facts that were added directly (e.g. custom facts or
+         * FACTER_ environment variables) keep their values when refreshed and are not included.
+         * @return Returns the names of the facts that can be refreshed.
+         */
+        std::set<std::string> refreshable_facts();
+
+        /**
+         * Resolves the facts of every resolver that was resolved at least the given age ago, leaving every other fact untouched.
+         * Resolvers that declare a dependency on the facts of a refreshed resolver are also resolved again.
+         * @param age The age at which a resolver's facts are resolved again.
+         * @return Returns the names of the facts that were added, removed, or changed by the refresh.
+         */
+        std::set<std::string> refresh_all_older_than(std::chrono::steady_clock::duration age);
+
+        /**
+         * Resolves the external facts of the files that were added, changed, or removed since external facts were added,
+         * leaving every other fact untouched.
+         * The directories searched by add_external_facts are watched where the platform supports it (inotify on Linux);
+         * otherwise they are scanned and each file's modification time and size are compared. Only the files that changed
+         * are resolved again, along with any unchanged file that provides one of the same facts, and the facts of removed
+         * files are removed. Subscribers are notified of the facts that changed.
+         * @return Returns the names of the facts that were added, removed, or changed by the refresh.
+         */
+        std::set<std::string> refresh_external_facts();
+
+        /**
+         * Subscribes to changes of fact values.
+         * The callback is called once for every fact that is added, removed, or changed when facts are refreshed.
+         * Callbacks are called after the refresh completes and must not modify the collection.
+         * @param callback The callback to call with each changed fact.
+         * @return Returns the subscription identifier to pass to unsubscribe.
+         */
+        size_t subscribe(std::function<void(fact_change const&)> callback);
+
+        /**
+         * Cancels a subscription to changes of fact values.
+         * @param id The subscription identifier returned from subscribe.
+         */
+        void unsubscribe(size_t id);
+
         /**
          * Gets a fact value by name.
          * @tparam T The expected type of the value.
@@ -153,7 +588,7 @@ namespace facter { namespace facts {
         template <typename T = value>
         T const* get(std::string const& name)
         {
-            return dynamic_cast<T const*>(get_value(name));
+            return value_cast<T>(get_value(name));
         }
 
         /**
@@ -172,9 +607,29 @@ namespace facter { namespace facts {
         template <typename T = value>
         T const* query(std::string const& query)
         {
-            return dynamic_cast<T const*>(query_value(query));
+            return value_cast<T>(query_value(query));
         }
 
+        /**
+         * Query the collection with a compiled query.
+         * @tparam T The expected type of the value.
+         * @param query The compiled query to run.
+         * @return Returns the result of the query or nullptr if the query returned no value.
+         */
+        template <typename T = value>
+        T const* query(facts::query const& query)
+        {
+            return value_cast<T>(query_value(query));
+        }
+
+        /**
+         * Query the collection for every value selected by a compiled query.
+         * A query with wildcards (e.g. "partitions.*.size") may select any number of values.
+         * @param query The compiled query to run.
+         * @return Returns the query path (e.g. "partitions.sda1.size") and value of each selected value.
+         */
+        std::vector<std::pair<std::string, value const*>> query_all(facts::query const& query);
+
         /**
          * Enumerates all facts in the collection.
          * All facts will be resolved prior to enumeration.
@@ -182,25 +637,112 @@ namespace facter { namespace facts {
          */
         void each(std::function<bool(std::string const&, value const*)> func);
 
+        /**
+         * Gets the names of the facts in the collection without resolving any facts.
+         * The names are those of the facts that have resolved and the facts declared by resolvers that have not.
+         * A declared fact may not resolve to a value, and the facts a resolver adds for a pattern (e.g. the facts
+         * of each network interface) are only named once they have resolved.
+         * @return Returns the fact names in order.
+         */
+        std::vector<std::string> names();
+
+        /**
+         * Resolves the facts needed to answer the given queries.
+         * Only the resolvers responsible for the top-level fact of each query, and the providers
+         * of their declared dependencies, are resolved. Resolvers may skip work for values that
+         * were not queried; such a resolver is resolved again when a later query, lookup, or
+         * resolution of every fact needs values its earlier queries did not select.
+         * @param queries The queries to resolve; if empty, all facts are resolved.
+         */
+        void resolve(std::set<std::string> const& queries);
+
+        /**
+         * Determines if a value is needed by the queries currently being resolved.
+         * Resolvers can use this to skip expensive work for values that were not queried.
+         * @param path The dotted path to the value (e.g. "networking.interfaces.*.dhcp"); a "*" segment matches any segment.
+         * @return Returns true if all facts are being resolved or if a query selects the value, one of its parents, or one of its children.
+         */
+        bool is_queried(std::string const& path) const;
+
         /**
          * Writes the contents of the fact collection to the given stream.
          * All facts will be resolved prior to writing.
          * @param stream The stream to write the facts to.
          * @param fmt The output format to use.
          * @param queries The set of queries to filter the output to. If empty, all facts will be output.
+         * @param project True to output the queried values as a tree of the facts they were queried from (e.g. {"os": {"release": {"major": "7"}}}) or false to output them by query; ignored by the hash format.
          * @return Returns the stream being written to.
          */
-        std::ostream& write(std::ostream& stream, format fmt = format::hash, std::set<std::string> const& queries = std::set<std::string>());
+        std::ostream& write(std::ostream& stream, format fmt = format::hash, std::set<std::string> const& queries = std::set<std::string>(), bool project = false);
+
+        /**
+         * Resolves and writes every fact, writing each fact as soon as no resolver left to resolve provides or depends on it.
+         * Each fact's value is released once it is written, so memory use is bounded by the largest facts rather than by all of them.
+         * Facts are written in the order they become final rather than sorted, and the written facts are removed from the collection.
+         * With a concurrency of more than one, facts are written from the calling thread whenever it is not resolving a resolver.
+         * MessagePack maps are written with their size first, so that format is written as with write.
+         * @param stream The stream to write the facts to.
+         * @param fmt The output format to use.
+         * @return Returns the stream being written to.
+         */
+        std::ostream& write_streaming(std::ostream& stream, format fmt = format::hash);
+
+        /**
+         * Resolves and writes the facts that changed since the last run recorded in the cache file, then records this run.
+         * The output has an "added" and a "changed" hash of the facts' values and a "removed" array of the facts' names.
+         * Facts are compared by a hash of their values, so the cache file holds only a hash of each fact.
+         * Hidden facts are not compared. Without a cache file (see cache), every fact is written as added.
+         * @param stream The stream to write the changes to.
+         * @param fmt The output format to use.
+         * @return Returns the stream being written to.
+         */
+        std::ostream& write_changes(std::ostream& stream, format fmt = format::hash);
+
+        /**
+         * Takes an immutable snapshot of the fact collection.
+         * All facts will be resolved prior to taking the snapshot; the snapshot holds its own copy of every
+         * fact value and lazy values are evaluated while copying, so it can be read from any number of threads
+         * without locking while the collection continues to change.
+         * When custom facts are loaded, this must be called on the thread that initialized Ruby.
+         * @param previous The previously taken snapshot; facts and subtrees that did not change are shared with it.
+         * @return Returns the snapshot of the facts.
+         */
+        std::shared_ptr<snapshot const> take_snapshot(std::shared_ptr<snapshot const> const& previous = nullptr);
 
      private:
-        LIBFACTER_NO_EXPORT void resolve_facts();
-        LIBFACTER_NO_EXPORT void resolve_fact(std::string const& name);
+        typedef boost::unique_lock<boost::mutex> lock_type;
+        typedef std::vector<std::pair<std::string, std::unique_ptr<value>>> recorded_facts;
+        typedef std::map<std::string, std::unique_ptr<value>>::iterator fact_iterator;
+        struct external_files;
+        struct external_file_resolver;
+
+        LIBFACTER_NO_EXPORT void resolve_facts(std::set<resolver const*> const* plan = nullptr, std::function<void(lock_type&)> const& resolved = nullptr);
+        LIBFACTER_NO_EXPORT void resolve_facts_parallel(std::set<resolver const*> const* plan, std::function<void(lock_type&)> const& resolved);
+        LIBFACTER_NO_EXPORT void resolve_fact(std::string const& name, lock_type& lock);
+        LIBFACTER_NO_EXPORT void add(recorded_facts facts);
+        LIBFACTER_NO_EXPORT void insert(std::string name, std::unique_ptr<value> value, lock_type& lock);
+        LIBFACTER_NO_EXPORT fact_iterator find_fact(std::string const& name);
+        LIBFACTER_NO_EXPORT fact_iterator erase_fact(fact_iterator it);
+        LIBFACTER_NO_EXPORT void index_facts();
+        LIBFACTER_NO_EXPORT void resolve(std::shared_ptr<resolver> res, lock_type& lock);
+        LIBFACTER_NO_EXPORT std::set<std::string> refresh(std::set<resolver const*> selected, lock_type& lock);
+        LIBFACTER_NO_EXPORT void select_affected(std::set<resolver const*>& selected, bool dependents) const;
+        LIBFACTER_NO_EXPORT std::vector<std::vector<std::string>> reregister(std::set<resolver const*> const& selected, std::map<std::string, std::unique_ptr<value>>* previous);
+        LIBFACTER_NO_EXPORT bool selects(resolver const& res, std::vector<std::vector<std::string>> const& scope, std::vector<std::string> const& query) const;
+        LIBFACTER_NO_EXPORT std::vector<std::vector<std::string>> register_unselected(std::vector<std::string> const& query);
+        LIBFACTER_NO_EXPORT void resolve_unselected(std::string const& query);
+        LIBFACTER_NO_EXPORT std::set<std::string> report_changes(std::map<std::string, std::unique_ptr<value>> const& previous, std::function<bool(std::string const&)> const& is_selected, lock_type& lock);
+        LIBFACTER_NO_EXPORT std::vector<recorded_facts> resolve_external_files(std::vector<std::pair<std::string const*, external::resolver const*>> const& work);
+        LIBFACTER_NO_EXPORT void store(resolver const& res);
+        LIBFACTER_NO_EXPORT void record(resolver const& res, util::statistics const& stats);
+        LIBFACTER_NO_EXPORT void unregister(std::shared_ptr<resolver> const& res);
+        LIBFACTER_NO_EXPORT std::set<resolver const*> plan_within_budget(lock_type& lock) const;
+        LIBFACTER_NO_EXPORT std::shared_ptr<resolver> next_resolver(bool thread_safe_only, std::set<resolver const*> const* plan, bool break_cycles) const;
+        LIBFACTER_NO_EXPORT bool would_deadlock(resolver const* res) const;
         LIBFACTER_NO_EXPORT value const* get_value(std::string const& name);
+        LIBFACTER_NO_EXPORT value const* find_value(std::string const& name);
         LIBFACTER_NO_EXPORT value const* query_value(std::string const& query);
-        LIBFACTER_NO_EXPORT value const* lookup(value const* value, std::string const& name);
-        LIBFACTER_NO_EXPORT void write_hash(std::ostream& stream, std::set<std::string> const& queries);
-        LIBFACTER_NO_EXPORT void write_json(std::ostream& stream, std::set<std::string> const& queries);
-        LIBFACTER_NO_EXPORT void write_yaml(std::ostream& stream, std::set<std::string> const& queries);
+        LIBFACTER_NO_EXPORT value const* query_value(facts::query const& query);
         LIBFACTER_NO_EXPORT void add_common_facts();
 
         // Platform specific members
@@ -209,9 +751,51 @@ namespace facter { namespace facts {
         LIBFACTER_NO_EXPORT std::vector<std::unique_ptr<external::resolver>> get_external_resolvers();
 
         std::map<std::string, std::unique_ptr<value>> _facts;
+        // The built-in facts by id (_facts.end() if the fact is not present), so that they are found without searching _facts
+        std::vector<fact_iterator> _builtins;
         std::list<std::shared_ptr<resolver>> _resolvers;
-        std::multimap<std::string, std::shared_ptr<resolver>> _resolver_map;
-        std::list<std::shared_ptr<resolver>> _pattern_resolvers;
+        std::unique_ptr<resolver_index> _index;
+        std::list<std::shared_ptr<resolver>> _added;
+        std::map<resolver const*, std::chrono::steady_clock::time_point> _resolved_at;
+        // The facts whose values were added other than by a resolver (e.g. external, environment, and custom facts)
+        std::set<std::string> _overrides;
+        unsigned int _concurrency;
+        std::unique_ptr<fact_cache> _cache;
+        std::chrono::milliseconds _timeout;
+        std::map<std::string, std::chrono::milliseconds> _timeouts;
+        std::chrono::steady_clock::time_point _deadline;
+        std::atomic<bool> _cancelled;
+        std::set<std::string> _blocked;
+        std::set<std::string> _allowed;
+        bool _cost_budget;
+        std::string _root;
+        std::vector<std::string> _included_interfaces;
+        std::vector<std::string> _excluded_interfaces;
+        bool _summarize_interfaces;
+        bool _legacy_on_demand;
+        bool _powershell_host;
+        std::vector<std::string> _excluded_filesystems;
+        std::chrono::milliseconds _remote_filesystem_timeout;
+        std::chrono::milliseconds _fqdn_timeout;
+        std::unique_ptr<value_arena> _arena;
+        std::unique_ptr<execution::command_cache> _commands;
+        std::unique_ptr<external_files> _external;
+
+        // Synchronizes access to the facts and resolvers while resolving in parallel
+        boost::mutex _mutex;
+        boost::condition_variable _resolved;
+        std::map<resolver const*, boost::thread::id> _active;
+        std::map<boost::thread::id, resolver const*> _waiting;
+        std::map<std::string, resolver_timing> _timings;
+        std::vector<std::vector<std::string>> _queries;
+        // The queries each resolver was last resolved for, when it may have skipped values they don't select (see is_queried)
+        std::map<resolver const*, std::vector<std::vector<std::string>>> _scoped;
+        std::set<resolver const*> _refreshing;
+        std::map<size_t, std::function<void(fact_change const&)>> _subscribers;
+        size_t _next_subscriber;
+
+        // The facts added to the collection, in order, when it only records them (see add_external_facts)
+        recorded_facts* _recording;
     };
 
 }}  // namespace facter::facts
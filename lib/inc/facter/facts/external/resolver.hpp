@@ -44,6 +44,13 @@ namespace facter { namespace facts { namespace external {
          * @param facts The fact collection to populate the external facts into.
          */
         virtual void resolve(std::string const& path, collection& facts) const = 0;
+
+        /**
+         * Determines if the facts resolved from a file change only when the file changes (e.g. a parsed file)
+         * rather than each time the file is resolved (e.g. an executed file).
+         * @return Returns true if the facts change only when the file changes or false if not.
+         */
+        virtual bool is_static() const;
     };
 
 }}}  // namespace facter::facts::external
@@ -538,6 +538,11 @@ namespace facter { namespace facts {
          */
         constexpr static char const* zpool_featurenumbers = "zpool_featurenumbers";
 
+        /**
+         * The structured fact for the imported ZFS storage pools.
+         */
+        constexpr static char const* zpools = "zpools";
+
         /**
          * The fact for number of Solaris zones.
          */
@@ -593,6 +598,21 @@ namespace facter { namespace facts {
          */
         constexpr static char const* gce = "gce";
 
+        /**
+         * The fact for Azure instance metadata.
+         */
+        constexpr static char const* az_metadata = "az_metadata";
+
+        /**
+         * The fact for OpenStack instance metadata.
+         */
+        constexpr static char const* openstack_metadata = "openstack_metadata";
+
+        /**
+         * The fact for DigitalOcean droplet metadata.
+         */
+        constexpr static char const* digitalocean_metadata = "digitalocean_metadata";
+
         /**
          * The fact for Ruby metadata.
          */
@@ -617,6 +637,31 @@ namespace facter { namespace facts {
          * The fact for the PATH environment variable.
          */
         constexpr static char const* path = "path";
+
+        /**
+         * The structured fact for the resource limits of facter's control group.
+         */
+        constexpr static char const* cgroup = "cgroup";
+
+        /**
+         * The structured fact for the namespaces facter runs in.
+         */
+        constexpr static char const* namespaces = "namespaces";
+
+        /**
+         * The structured fact for the system load averages.
+         */
+        constexpr static char const* load_averages = "load_averages";
+
+        /**
+         * The structured fact for the system's resource pressure stall information.
+         */
+        constexpr static char const* pressure = "pressure";
+
+        /**
+         * The structured fact for the system's processor and disk utilization.
+         */
+        constexpr static char const* utilization = "utilization";
     };
 
 }}  // namespace facter::facts
@@ -0,0 +1,174 @@
+/**
+ * @file
+ * Declares the fact value that is resolved on first use.
+ */
+#pragma once
+
+#include "value.hpp"
+#include "../export.h"
+#include <functional>
+#include <memory>
+
+namespace facter { namespace facts {
+
+    struct lazy_value;
+
+    /**
+     * Specializes the type tag for lazy values.
+     */
+    template <>
+    struct value_type_of<lazy_value>
+    {
+        /**
+         * The type tag of lazy values.
+         */
+        static constexpr value_type type = value_type::lazy;
+    };
+
+    /**
+     * Represents a value that is computed the first time it is accessed.
+     * Map and array values transparently unwrap lazy elements when they are accessed or written;
+     * a lazy value that evaluates to null is treated as if it was never added.
+     * This type can be moved but cannot be copied.
+     */
+    struct LIBFACTER_EXPORT lazy_value : value
+    {
+        /**
+         * The function that computes the value.
+         * The function may return nullptr if there is no value.
+         */
+        using thunk_type = std::function<std::unique_ptr<value>()>;
+
+        /**
+         * Constructs a lazy_value.
+         * @param thunk The function to call to compute the value.
+         * @param hidden True if the fact is hidden from output by default or false if not.
+         */
+        lazy_value(thunk_type thunk, bool hidden = false);
+
+        /**
+         * Prevents the lazy_value from being copied.
+         */
+        lazy_value(lazy_value const&) = delete;
+
+        /**
+         * Prevents the lazy_value from being copied.
+         * @returns Returns this lazy_value.
+         */
+        lazy_value& operator=(lazy_value const&) = delete;
+
+        /**
+         * Moves the given lazy_value into this lazy_value.
+         * @param other The lazy_value to move into this lazy_value.
+         */
+        // Visual Studio 12 still doesn't allow default for move constructor.
+        lazy_value(lazy_value&& other);
+
+        /**
+         * Moves the given lazy_value into this lazy_value.
+         * @param other The lazy_value to move into this lazy_value.
+         * @return Returns this lazy_value.
+         */
+        // Visual Studio 12 still doesn't allow default for move assignment.
+        lazy_value& operator=(lazy_value&& other);
+
+        /**
+         * Creates another lazy_value that shares this value's evaluation.
+         * The thunk is called at most once regardless of which of the values is accessed first.
+         * @param hidden True if the new value is hidden from output by default or false if not.
+         * @return Returns the new lazy_value.
+         */
+        std::unique_ptr<lazy_value> share(bool hidden = false) const;
+
+        /**
+         * Determines if the value has been computed.
+         * @return Returns true if the thunk has been called or false if it has not.
+         */
+        bool evaluated() const;
+
+        /**
+         * Gets the computed value, calling the thunk if it has not yet been called.
+         * If the thunk throws an exception, the exception is logged and there is no value.
+         * @return Returns the computed value or nullptr if there is no value.
+         */
+        value const* get() const;
+
+        /**
+         * Unwraps the given value if it is a lazy value.
+         * @param val The value to unwrap.
+         * @return Returns the computed value if the given value is lazy or the given value if it is not.
+         */
+        static value const* resolve(value const* val);
+
+        /**
+         * Converts the value to a JSON value.
+         * @param allocator The allocator to use for creating the JSON value.
+         * @param value The returned JSON value.
+         */
+        virtual void to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const override;
+
+        /**
+         * Writes the value as MessagePack.
+         * @param writer The MessagePack writer to write to.
+         */
+        virtual void to_msgpack(msgpack_writer& writer) const override;
+
+        /**
+          * Writes the value to the given stream.
+          * @param os The stream to write to.
+          * @param quoted True if string values should be quoted or false if not.
+          * @param level The current indentation level.
+          * @returns Returns the stream being written to.
+          */
+        virtual std::ostream& write(std::ostream& os, bool quoted = true, unsigned int level = 1) const override;
+
+        /**
+          * Writes the value to the given YAML emitter.
+          * @param emitter The YAML emitter to write to.
+          * @returns Returns the given YAML emitter.
+          */
+        virtual YAML::Emitter& write(YAML::Emitter& emitter) const override;
+
+        /**
+         * Determines if the value is or contains a value that is computed on first use.
+         * @return Always returns true.
+         */
+        virtual bool deferred() const override;
+
+        /**
+         * Creates a copy of the computed value, calling the thunk if it has not yet been called.
+         * The copy is not lazy.
+         * @return Returns the copy of the computed value or nullptr if there is no value.
+         */
+        virtual std::unique_ptr<value> clone() const override;
+
+        /**
+         * Determines if the given value is equal to this value.
+         * Both values are unwrapped before comparing.
+         * @param other The value to compare to.
+         * @return Returns true if the values are equal or false if they are not.
+         */
+        virtual bool equals(value const& other) const override;
+
+        /**
+         * Gets the hash of the value computed by the thunk, computing it if it has not been computed.
+         * @return Returns the hash of the computed value or the initial hash if there is no value.
+         */
+        virtual uint64_t hash() const override;
+
+        /**
+         * Estimates the memory used by the value, including the computed value once it has been computed.
+         * The thunk is not called.
+         * @return Returns the approximate number of bytes used by the value.
+         */
+        virtual size_t memory_usage() const override;
+
+     private:
+        struct state;
+
+        lazy_value(std::shared_ptr<state> state, bool hidden);
+
+        std::shared_ptr<state> _state;
+    };
+
+}}  // namespace facter::facts
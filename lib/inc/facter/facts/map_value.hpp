@@ -5,16 +5,37 @@
 #pragma once
 
 #include "value.hpp"
+#include "symbol.hpp"
 #include "../export.h"
-#include <map>
+#include <atomic>
 #include <string>
+#include <utility>
+#include <vector>
 #include <memory>
 #include <functional>
 
 namespace facter { namespace facts {
 
+    struct map_value;
+
+    /**
+     * Specializes the type tag for map values.
+     */
+    template <>
+    struct value_type_of<map_value>
+    {
+        /**
+         * The type tag of map values.
+         */
+        static constexpr value_type type = value_type::map;
+    };
+
     /**
      * Represents a fact value that maps fact names to values.
+     * Elements are stored contiguously, sorted by name; lookups are a binary search.
+     * Element names are interned symbols, so maps with the same keys share the key strings.
+     * Elements are shared: copies of the map share every element that is not deferred, so unchanged
+     * subtrees are pointer-equal between copies. Elements must not be changed once they are added.
      * This type can be moved but cannot be copied.
      */
     struct LIBFACTER_EXPORT map_value : value
@@ -24,7 +45,9 @@ namespace facter { namespace facts {
          * @param hidden True if the fact is hidden from output by default or false if not.
          */
         map_value(bool hidden = false) :
-            value(hidden)
+            value(value_type::map, hidden),
+            _deferred(false),
+            _hash(0)
         {
         }
 
@@ -56,10 +79,33 @@ namespace facter { namespace facts {
 
         /**
          * Adds a value to the map.
+         * The value may already be shared with other maps or arrays.
          * @param name The name of map element.
          * @param value The value of the map element.
          */
-        void add(std::string name, std::unique_ptr<value> value);
+        void add(symbol name, std::shared_ptr<value const> value);
+
+        /**
+         * Replaces the elements of the map in bulk.
+         * This is faster than adding many elements individually as the elements are sorted once.
+         * As with add, only the first element with a given name is kept; null values are ignored.
+         * @param elements The elements of the map.
+         */
+        void assign(std::vector<std::pair<symbol, std::shared_ptr<value const>>> elements);
+
+        /**
+         * Reserves storage for the given number of elements.
+         * @param count The number of elements to reserve storage for.
+         */
+        void reserve(size_t count);
+
+        /**
+         * Gets the shared value in the map of the given name.
+         * Lazy values are not unwrapped.
+         * @param name The name of the value in the map to get.
+         * @return Returns the shared value in the map or nullptr if the value is not in the map.
+         */
+        std::shared_ptr<value const> share(std::string const& name) const;
 
         /**
          * Checks to see if the map is empty.
@@ -69,12 +115,14 @@ namespace facter { namespace facts {
 
         /**
          * Gets the size of the map.
+         * Lazy values that have not been computed are counted.
          * @return Returns the number of elements in the map.
          */
         size_t size() const;
 
         /**
          * Enumerates all facts in the map.
+         * Lazy values are computed and unwrapped; lazy values without a value are skipped.
          * @param func The callback function called for each element in the map.
          */
         void each(std::function<bool(std::string const&, value const*)> func) const;
@@ -86,6 +134,12 @@ namespace facter { namespace facts {
          */
         virtual void to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const override;
 
+        /**
+         * Writes the value as MessagePack.
+         * @param writer The MessagePack writer to write to.
+         */
+        virtual void to_msgpack(msgpack_writer& writer) const override;
+
         /**
          * Gets the value in the map of the given name.
          * @tparam T The expected type of the value.
@@ -94,11 +148,12 @@ namespace facter { namespace facts {
          */
         template <typename T = value> T const* get(std::string const& name) const
         {
-            return dynamic_cast<T const*>(this->operator [](name));
+            return value_cast<T>(this->operator [](name));
         }
 
         /**
          * Gets the value in the map of the given name.
+         * Lazy values are computed and unwrapped.
          * @param name The name of the value in the map to get.
          * @return Returns the value in the map or nullptr if the value is not in the map.
          */
@@ -120,8 +175,49 @@ namespace facter { namespace facts {
           */
         virtual YAML::Emitter& write(YAML::Emitter& emitter) const override;
 
+        /**
+         * Determines if the map contains a value that is computed on first use.
+         * @return Returns true if any element is deferred or false if not.
+         */
+        virtual bool deferred() const override;
+
+        /**
+         * Creates a copy of the value.
+         * Elements that are not deferred are shared with the copy; lazy elements are evaluated and copied,
+         * and elements without a value are not copied.
+         * @return Returns the copy of the value.
+         */
+        virtual std::unique_ptr<value> clone() const override;
+
+        /**
+         * Determines if the given value is equal to this value.
+         * Whether or not the values or their elements are hidden is not compared.
+         * @param other The value to compare to.
+         * @return Returns true if the other value is a map with equal elements or false if not.
+         */
+        virtual bool equals(value const& other) const override;
+
+        /**
+         * Gets a hash of the map's elements, computed from the hashes of the elements.
+         * The hash is kept once computed, so a subtree shared between snapshots is only hashed once; adding an element discards it.
+         * @return Returns the hash of the map.
+         */
+        virtual uint64_t hash() const override;
+
+        /**
+         * Estimates the memory used by the map and its elements.
+         * @return Returns the approximate number of bytes used by the map.
+         */
+        virtual size_t memory_usage() const override;
+
      private:
-        std::map<std::string, std::unique_ptr<value>> _elements;
+        typedef std::vector<std::pair<symbol, std::shared_ptr<value const>>> elements_type;
+
+        LIBFACTER_NO_EXPORT elements_type::const_iterator find(std::string const& name) const;
+
+        elements_type _elements;
+        bool _deferred;
+        mutable std::atomic<uint64_t> _hash;
     };
 
 }}  // namespace facter::facts
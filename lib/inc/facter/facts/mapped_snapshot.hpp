@@ -0,0 +1,156 @@
+/**
+ * @file
+ * Declares the published snapshot that local processes map into memory to read facts.
+ */
+#pragma once
+
+#include "value.hpp"
+#include "../export.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace facter { namespace facts {
+
+    struct snapshot;
+
+    /**
+     * Publishes snapshots to a file that local processes map into memory with mapped_snapshot.
+     * The file is a small header followed by the facts in the MessagePack output format.
+     * Each snapshot is written to a new file that is renamed over the published file, so a reader never sees a
+     * partially written snapshot; the file it replaces is then marked as superseded so that its readers know to reload.
+     * Each published snapshot has a generation one greater than the snapshot it replaces, including a snapshot
+     * published by a previous publisher of the same file.
+     * This type cannot be copied.
+     */
+    struct LIBFACTER_EXPORT snapshot_publisher
+    {
+        /**
+         * Constructs a publisher of the given file.
+         * Nothing is written until a snapshot is published.
+         * @param path The path of the file to publish snapshots to.
+         */
+        explicit snapshot_publisher(std::string path);
+
+        /**
+         * Marks the published file as superseded and removes it, so that readers stop reading facts that will not be refreshed.
+         */
+        ~snapshot_publisher();
+
+        /**
+         * Prevents the publisher from being copied.
+         */
+        snapshot_publisher(snapshot_publisher const&) = delete;
+
+        /**
+         * Prevents the publisher from being copied.
+         * @returns Returns this publisher.
+         */
+        snapshot_publisher& operator=(snapshot_publisher const&) = delete;
+
+        /**
+         * Publishes the given snapshot, replacing the previously published snapshot.
+         * @param facts The snapshot to publish.
+         * @return Returns true if the snapshot was published or false if the file could not be written.
+         */
+        bool publish(snapshot const& facts);
+
+        /**
+         * Gets the generation of the last published snapshot.
+         * @return Returns the generation of the last published snapshot or zero if none has been published.
+         */
+        uint64_t generation() const;
+
+     private:
+        struct mapping;
+
+        std::string _path;
+        uint64_t _generation;
+        std::unique_ptr<mapping> _published;
+    };
+
+    /**
+     * Reads facts from a snapshot published by snapshot_publisher.
+     * The file is mapped read-only into memory: queries find their values in the mapped MessagePack data without
+     * decoding the facts around them, so reading a fact costs no request, no parsing of other facts, and no copy.
+     * A mapping always reads the snapshot it was opened with; reload maps the newest snapshot once it is superseded.
+     * Queries may be made from any number of threads, but not while reloading.
+     * This type cannot be copied.
+     */
+    struct LIBFACTER_EXPORT mapped_snapshot
+    {
+        /**
+         * Maps the snapshot published to the given file.
+         * @param path The path of the published file.
+         */
+        explicit mapped_snapshot(std::string path);
+
+        /**
+         * Unmaps the snapshot.
+         */
+        ~mapped_snapshot();
+
+        /**
+         * Prevents the mapped snapshot from being copied.
+         */
+        mapped_snapshot(mapped_snapshot const&) = delete;
+
+        /**
+         * Prevents the mapped snapshot from being copied.
+         * @returns Returns this mapped snapshot.
+         */
+        mapped_snapshot& operator=(mapped_snapshot const&) = delete;
+
+        /**
+         * Determines if a published snapshot is mapped.
+         * @return Returns true if a snapshot is mapped or false if the file was not published or is not a valid snapshot.
+         */
+        bool is_open() const;
+
+        /**
+         * Gets the generation of the mapped snapshot.
+         * @return Returns the generation of the mapped snapshot or zero if no snapshot is mapped.
+         */
+        uint64_t generation() const;
+
+        /**
+         * Determines if the mapped snapshot has been superseded by a newer snapshot or is no longer published.
+         * This reads the mapped memory only; it makes no system call.
+         * @return Returns true if the snapshot is superseded or nothing is mapped, or false if the snapshot is current.
+         */
+        bool stale() const;
+
+        /**
+         * Maps the published snapshot again if the mapped snapshot is stale.
+         * The mapped snapshot is kept if the file can't be mapped.
+         * @return Returns true if a newer snapshot was mapped or false if the mapping did not change.
+         */
+        bool reload();
+
+        /**
+         * Finds the MessagePack encoding of a queried value in the mapped snapshot.
+         * As with a collection, a fact with the exact name of the query takes precedence; otherwise each segment
+         * of the query (e.g. "os.release.major" or "processors.models.0") selects an element of a hash or array.
+         * Wildcard queries are not supported.
+         * @param query The query to find.
+         * @param data Receives a pointer to the encoded value in the mapped memory; valid until the mapping is reloaded or destroyed.
+         * @param size Receives the size of the encoded value.
+         * @return Returns true if the query selected a value or false if it did not.
+         */
+        bool query(std::string const& query, char const*& data, size_t& size) const;
+
+        /**
+         * Decodes a queried value in the mapped snapshot.
+         * @param query The query to find.
+         * @return Returns the value or nullptr if the query did not select a value.
+         */
+        std::unique_ptr<value> get(std::string const& query) const;
+
+     private:
+        struct mapping;
+
+        std::string _path;
+        std::unique_ptr<mapping> _mapping;
+    };
+
+}}  // namespace facter::facts
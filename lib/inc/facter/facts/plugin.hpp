@@ -0,0 +1,47 @@
+/**
+ * @file
+ * Declares the interface of native fact plugins.
+ */
+#pragma once
+
+#include "resolver.hpp"
+#include "../version.h"
+#include <memory>
+#include <vector>
+
+/**
+ * Exports a function of a fact plugin from its shared library.
+ */
+#if defined(_WIN32)
+#define LIBFACTER_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define LIBFACTER_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+namespace facter { namespace facts {
+
+    /**
+     * The function a fact plugin exports to create its resolvers.
+     * The function is called once for every collection the plugin's facts are added to.
+     * It may throw an exception to add no facts to the collection.
+     */
+    using plugin_factory = void(*)(std::vector<std::shared_ptr<resolver>>& resolvers);
+
+}}  // namespace facter::facts
+
+/**
+ * Defines the exports of a fact plugin.
+ * A plugin is a shared library built against libfacter; use this macro once in the library, passing a function
+ * with the signature of facter::facts::plugin_factory that adds the plugin's resolvers to the given vector.
+ * Resolvers are C++ objects shared with libfacter, so a plugin is only loaded by the version of facter it was built for.
+ * Plugins are never unloaded, so their resolvers and values may outlive the collection they were added to.
+ */
+#define LIBFACTER_PLUGIN(factory) \
+    extern "C" LIBFACTER_PLUGIN_EXPORT char const* facter_plugin_version() \
+    { \
+        return LIBFACTER_VERSION; \
+    } \
+    extern "C" LIBFACTER_PLUGIN_EXPORT void facter_plugin_resolvers(std::vector<std::shared_ptr<facter::facts::resolver>>& resolvers) \
+    { \
+        static_cast<facter::facts::plugin_factory>(factory)(resolvers); \
+    }
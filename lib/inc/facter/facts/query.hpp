@@ -0,0 +1,92 @@
+/**
+ * @file
+ * Declares the compiled fact query.
+ */
+#pragma once
+
+#include "value.hpp"
+#include "../export.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace facter { namespace facts {
+
+    /**
+     * Represents a compiled fact query.
+     * The query is split into its segments and its array indices are parsed once, so it can be
+     * evaluated any number of times against a fact collection or snapshot without parsing it again.
+     */
+    struct LIBFACTER_EXPORT query
+    {
+        /**
+         * Compiles a query.
+         * Segments are separated by '.'; a double-quoted segment may contain '.'.
+         * A "*" segment after the first is a wildcard that selects every element of a map or array.
+         * @param text The query to compile (e.g. "networking.interfaces.eth0.ip").
+         */
+        explicit query(std::string text);
+
+        /**
+         * Gets the text of the query.
+         * @return Returns the text the query was compiled from.
+         */
+        std::string const& text() const;
+
+        /**
+         * Determines if the query contains a wildcard and may select more than one value.
+         * @return Returns true if the query contains a wildcard or false if not.
+         */
+        bool wildcard() const;
+
+        /**
+         * Evaluates the query.
+         * A fact named by the entire query text takes precedence over the query's segments.
+         * For a query with a wildcard, the first selected value is returned.
+         * @param get The function used to get a top-level fact by name.
+         * @param path If not nullptr, receives the name of the fact and the keys or indices the result was found under.
+         * @return Returns the result of the query or nullptr if the query returned no value.
+         */
+        value const* evaluate(std::function<value const*(std::string const&)> const& get, std::vector<std::string>* path = nullptr) const;
+
+        /**
+         * Evaluates the query, calling the given callback with each selected value.
+         * Every value selected by a query with wildcards is found in a single traversal.
+         * @param get The function used to get a top-level fact by name.
+         * @param callback The callback to call with the path (the fact name followed by the keys or indices) and each selected value; return false to stop.
+         */
+        void each(
+            std::function<value const*(std::string const&)> const& get,
+            std::function<bool(std::vector<std::string> const&, value const*)> const& callback) const;
+
+        /**
+         * Joins a path into a query that selects only the value at the path.
+         * Segments that contain '.' are quoted.
+         * @param path The path to join.
+         * @return Returns the query text for the path.
+         */
+        static std::string join(std::vector<std::string> const& path);
+
+     private:
+        struct segment
+        {
+            std::string name;
+            int index;
+            bool integral;
+            bool wildcard;
+        };
+
+        LIBFACTER_NO_EXPORT value const* lookup(value const* current, segment const& seg, std::function<value const*(std::string const&)> const& get) const;
+        LIBFACTER_NO_EXPORT bool match(
+            value const* current,
+            size_t index,
+            std::vector<std::string>& path,
+            std::function<value const*(std::string const&)> const& get,
+            std::function<bool(std::vector<std::string> const&, value const*)> const& callback) const;
+
+        std::string _text;
+        std::vector<segment> _segments;
+        bool _wildcard;
+    };
+
+}}  // namespace facter::facts
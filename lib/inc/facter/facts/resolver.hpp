@@ -39,8 +39,9 @@ namespace facter { namespace facts {
          * @param name The fact resolver name.
          * @param names The fact names the resolver is responsible for.
          * @param patterns Regular expression patterns for additional ("dynamic") facts the resolver is responsible for.
+         * @param dependencies The fact names the resolver consumes while resolving.
          */
-        resolver(std::string name, std::vector<std::string> names, std::vector<std::string> const& patterns = {});
+        resolver(std::string name, std::vector<std::string> names, std::vector<std::string> const& patterns = {}, std::vector<std::string> dependencies = {});
 
         /**
          * Destructs the resolver.
@@ -91,6 +92,19 @@ namespace facter { namespace facts {
          */
         bool has_patterns() const;
 
+        /**
+         * Gets the regular expression patterns for the additional ("dynamic") facts the resolver is responsible for.
+         * @return Returns a vector of patterns.
+         */
+        std::vector<std::string> const& patterns() const;
+
+        /**
+         * Gets the fact names the resolver consumes while resolving.
+         * The collection will resolve the providers of these facts before starting this resolver.
+         * @return Returns a vector of fact names.
+         */
+        std::vector<std::string> const& dependencies() const;
+
         /**
          * Determines if the given name matches a pattern for the resolver.
          * @param name The fact name to check.
@@ -98,6 +112,21 @@ namespace facter { namespace facts {
          */
         bool is_match(std::string const& name) const;
 
+        /**
+         * Determines if the resolver can be resolved on a thread other than the one resolving the collection.
+         * Resolvers that use thread-affine APIs (such as the Ruby VM or COM) should return false.
+         * @return Returns true if the resolver is thread safe or false if it must be resolved on the calling thread.
+         */
+        virtual bool is_thread_safe() const;
+
+        /**
+         * Determines if the resolver is expensive to resolve.
+         * Expensive resolvers spawn processes, probe devices, or make network requests; they are skipped when
+         * resolving all facts within a cost budget unless their facts are queried.
+         * @return Returns true if the resolver is expensive or false if it is not.
+         */
+        virtual bool is_expensive() const;
+
         /**
          * Called to resolve all facts the resolver is responsible for.
          * @param facts The fact collection that is resolving facts.
@@ -107,7 +136,9 @@ namespace facter { namespace facts {
      private:
         std::string _name;
         std::vector<std::string> _names;
+        std::vector<std::string> _patterns;
         std::vector<boost::regex> _regexes;
+        std::vector<std::string> _dependencies;
     };
 
 }}  // namespace facter::facts
@@ -9,10 +9,61 @@
 #include <cstdint>
 #include <string>
 #include <iostream>
+#include <type_traits>
 #include <yaml-cpp/yaml.h>
 
 namespace facter { namespace facts {
 
+    template <typename T> struct scalar_value;
+
+    /**
+     * Specializes the type tag for string values.
+     */
+    template <>
+    struct value_type_of<scalar_value<std::string>>
+    {
+        /**
+         * The type tag of string values.
+         */
+        static constexpr value_type type = value_type::string;
+    };
+
+    /**
+     * Specializes the type tag for integer values.
+     */
+    template <>
+    struct value_type_of<scalar_value<int64_t>>
+    {
+        /**
+         * The type tag of integer values.
+         */
+        static constexpr value_type type = value_type::integer;
+    };
+
+    /**
+     * Specializes the type tag for boolean values.
+     */
+    template <>
+    struct value_type_of<scalar_value<bool>>
+    {
+        /**
+         * The type tag of boolean values.
+         */
+        static constexpr value_type type = value_type::boolean;
+    };
+
+    /**
+     * Specializes the type tag for double values.
+     */
+    template <>
+    struct value_type_of<scalar_value<double>>
+    {
+        /**
+         * The type tag of double values.
+         */
+        static constexpr value_type type = value_type::floating_point;
+    };
+
     /**
      * Represents a simple scalar value.
      * This type can be moved but cannot be copied.
@@ -27,11 +78,30 @@ namespace facter { namespace facts {
          * @param hidden True if the fact is hidden from output by default or false if not.
          */
         scalar_value(T value, bool hidden = false) :
-            facter::facts::value(hidden),
+            facter::facts::value(value_type_of<scalar_value<T>>::type, hidden),
             _value(std::move(value))
         {
         }
 
+        /**
+         * Constructs a string scalar_value from a range of characters without an intermediate string.
+         * This is useful for building values from buffers (e.g. parsed JSON or a substring) that are not strings.
+         * @tparam Iterator The type of the character iterators.
+         * @param first The iterator to the first character.
+         * @param last The iterator past the last character.
+         * @param hidden True if the fact is hidden from output by default or false if not.
+         */
+        template <
+            typename Iterator,
+            typename U = T,
+            typename = typename std::enable_if<std::is_same<U, std::string>::value>::type
+        >
+        scalar_value(Iterator first, Iterator last, bool hidden = false) :
+            facter::facts::value(value_type_of<scalar_value<T>>::type, hidden),
+            _value(first, last)
+        {
+        }
+
         /**
          * Moves the given scalar_value into this scalar_value.
          * @param other The scalar_value to move into this scalar_value.
@@ -64,6 +134,12 @@ namespace facter { namespace facts {
          */
         virtual void to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const override;
 
+        /**
+         * Writes the value as MessagePack.
+         * @param writer The MessagePack writer to write to.
+         */
+        virtual void to_msgpack(msgpack_writer& writer) const override;
+
         /**
          * Gets the underlying scalar value.
          * @return Returns the underlying scalar value.
@@ -94,6 +170,42 @@ namespace facter { namespace facts {
             return emitter;
         }
 
+        /**
+         * Creates a deep copy of the value.
+         * @return Returns the copy of the value.
+         */
+        virtual std::unique_ptr<struct value> clone() const override
+        {
+            return std::unique_ptr<struct value>(new scalar_value(_value, hidden()));
+        }
+
+        /**
+         * Determines if the given value is equal to this value.
+         * Whether or not the values are hidden is not compared.
+         * @param other The value to compare to.
+         * @return Returns true if the other value is the same type and has the same underlying value or false if not.
+         */
+        virtual bool equals(struct value const& other) const override
+        {
+            auto ptr = other.template as<scalar_value<T>>();
+            return ptr && ptr->_value == _value;
+        }
+
+        /**
+         * Gets a hash of the value's type and contents.
+         * @return Returns the hash of the value.
+         */
+        virtual uint64_t hash() const override;
+
+        /**
+         * Estimates the memory used by the value.
+         * @return Returns the approximate number of bytes used by the value.
+         */
+        virtual size_t memory_usage() const override
+        {
+            return sizeof(scalar_value);
+        }
+
      private:
         scalar_value(scalar_value const&) = delete;
         scalar_value& operator=(scalar_value const&) = delete;
@@ -111,6 +223,16 @@ namespace facter { namespace facts {
     template <>
     void scalar_value<double>::to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const;
 
+    // Declare the specializations for MessagePack output
+    template <>
+    void scalar_value<std::string>::to_msgpack(msgpack_writer& writer) const;
+    template <>
+    void scalar_value<int64_t>::to_msgpack(msgpack_writer& writer) const;
+    template <>
+    void scalar_value<bool>::to_msgpack(msgpack_writer& writer) const;
+    template <>
+    void scalar_value<double>::to_msgpack(msgpack_writer& writer) const;
+
     // Declare the specializations for YAML output
     template <>
     YAML::Emitter& scalar_value<std::string>::write(YAML::Emitter& emitter) const;
@@ -121,6 +243,20 @@ namespace facter { namespace facts {
     template <>
     std::ostream& scalar_value<std::string>::write(std::ostream& os, bool quoted, unsigned int level) const;
 
+    // Declare the specializations for hashing
+    template <>
+    uint64_t scalar_value<std::string>::hash() const;
+    template <>
+    uint64_t scalar_value<int64_t>::hash() const;
+    template <>
+    uint64_t scalar_value<bool>::hash() const;
+    template <>
+    uint64_t scalar_value<double>::hash() const;
+
+    // Declare the specializations for memory accounting
+    template <>
+    size_t scalar_value<std::string>::memory_usage() const;
+
     // Declare the common instantiations as external; defined in scalar_value.cc
     extern template struct scalar_value<std::string>;
     extern template struct scalar_value<int64_t>;
@@ -0,0 +1,160 @@
+/**
+ * @file
+ * Declares the immutable snapshot of a fact collection.
+ */
+#pragma once
+
+#include "collection.hpp"
+#include "query.hpp"
+#include "value.hpp"
+#include "../export.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace facter { namespace facts {
+
+    /**
+     * Represents an immutable copy of the facts in a fact collection.
+     * Snapshots are taken with collection::take_snapshot and shared between readers; because a snapshot
+     * never changes once taken, any number of threads may read it at the same time without locking.
+     * Fact values are structurally shared with the previous snapshot: any fact, hash or array that did not
+     * change is the same object in both snapshots, so unchanged subtrees can be detected by pointer comparison.
+     * This type can be moved but cannot be copied.
+     */
+    struct LIBFACTER_EXPORT snapshot
+    {
+        /**
+         * Constructs a snapshot from the given facts.
+         * @param facts The fact values of the snapshot; the values must not be deferred.
+         * @param previous The previous snapshot to share unchanged values with or nullptr to share nothing.
+         */
+        explicit snapshot(std::map<std::string, std::shared_ptr<value const>> facts, std::shared_ptr<snapshot const> const& previous = nullptr);
+
+        /**
+         * Prevents the snapshot from being copied.
+         */
+        snapshot(snapshot const&) = delete;
+
+        /**
+         * Prevents the snapshot from being copied.
+         * @returns Returns this snapshot.
+         */
+        snapshot& operator=(snapshot const&) = delete;
+
+        /**
+         * Moves the given snapshot into this snapshot.
+         * @param other The snapshot to move into this snapshot.
+         */
+        // Visual Studio 12 still doesn't allow default for move constructor.
+        snapshot(snapshot&& other);
+
+        /**
+         * Moves the given snapshot into this snapshot.
+         * @param other The snapshot to move into this snapshot.
+         * @return Returns this snapshot.
+         */
+        // Visual Studio 12 still doesn't allow default for move assignment.
+        snapshot& operator=(snapshot&& other);
+
+        /**
+         * Determines if the snapshot is empty.
+         * @return Returns true if the snapshot has no facts or false if it has facts.
+         */
+        bool empty() const;
+
+        /**
+         * Gets the count of facts in the snapshot.
+         * @return Returns the number of facts in the snapshot.
+         */
+        size_t size() const;
+
+        /**
+         * Gets a fact value by name.
+         * @tparam T The expected type of the value.
+         * @param name The name of the fact to get the value of.
+         * @return Returns a pointer to the fact value or nullptr if the fact is not in the snapshot or the value is not the expected type.
+         */
+        template <typename T = value>
+        T const* get(std::string const& name) const
+        {
+            return value_cast<T>(get_value(name));
+        }
+
+        /**
+         * Gets a fact value by name
+         * @param name The name of the fact to get the value of.
+         * @return Returns a pointer to the fact value or nullptr if the fact is not in the snapshot.
+         */
+        value const* operator[](std::string const& name) const;
+
+        /**
+         * Gets the shared fact value by name.
+         * The value can outlive the snapshot and is pointer-equal to the value in the previous snapshot if the fact did not change.
+         * @param name The name of the fact to get the value of.
+         * @return Returns the shared fact value or nullptr if the fact is not in the snapshot.
+         */
+        std::shared_ptr<value const> share(std::string const& name) const;
+
+        /**
+         * Query the snapshot.
+         * @tparam T The expected type of the value.
+         * @param query The query to run.
+         * @return Returns the result of the query or nullptr if the query returned no value.
+         */
+        template <typename T = value>
+        T const* query(std::string const& query) const
+        {
+            return value_cast<T>(query_value(query));
+        }
+
+        /**
+         * Query the snapshot with a compiled query.
+         * @tparam T The expected type of the value.
+         * @param query The compiled query to run.
+         * @return Returns the result of the query or nullptr if the query returned no value.
+         */
+        template <typename T = value>
+        T const* query(facts::query const& query) const
+        {
+            return value_cast<T>(query_value(query));
+        }
+
+        /**
+         * Query the snapshot for every value selected by a compiled query.
+         * A query with wildcards (e.g. "partitions.*.size") may select any number of values.
+         * @param query The compiled query to run.
+         * @return Returns the query path (e.g. "partitions.sda1.size") and value of each selected value.
+         */
+        std::vector<std::pair<std::string, value const*>> query_all(facts::query const& query) const;
+
+        /**
+         * Enumerates all facts in the snapshot.
+         * @param func The callback function called for each fact in the snapshot.
+         */
+        void each(std::function<bool(std::string const&, value const*)> func) const;
+
+        /**
+         * Writes the contents of the snapshot to the given stream.
+         * @param stream The stream to write the facts to.
+         * @param fmt The output format to use.
+         * @param queries The set of queries to filter the output to. If empty, all facts will be output.
+         * @param project True to output the queried values as a tree of the facts they were queried from (e.g. {"os": {"release": {"major": "7"}}}) or false to output them by query; ignored by the hash format.
+         * @return Returns the stream being written to.
+         */
+        std::ostream& write(std::ostream& stream, format fmt = format::hash, std::set<std::string> const& queries = std::set<std::string>(), bool project = false) const;
+
+     private:
+        LIBFACTER_NO_EXPORT value const* get_value(std::string const& name) const;
+        LIBFACTER_NO_EXPORT value const* query_value(std::string const& query) const;
+        LIBFACTER_NO_EXPORT value const* query_value(facts::query const& query) const;
+
+        std::map<std::string, std::shared_ptr<value const>> _facts;
+    };
+
+}}  // namespace facter::facts
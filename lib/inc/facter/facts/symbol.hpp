@@ -0,0 +1,99 @@
+/**
+ * @file
+ * Declares the interned name type used for map keys.
+ */
+#pragma once
+
+#include "../export.h"
+#include <string>
+#include <iostream>
+
+namespace facter { namespace facts {
+
+    /**
+     * Represents an interned name.
+     * Every symbol with the same name refers to the same string, so a symbol is the size of a pointer,
+     * copying one never allocates, and symbols are compared for equality by pointer.
+     * Interned names are never freed; they are intended for fact names and map keys, which repeat between
+     * values and collections.
+     */
+    struct LIBFACTER_EXPORT symbol
+    {
+        /**
+         * Constructs a symbol by interning the given name.
+         * @param name The name to intern.
+         */
+        symbol(std::string const& name);
+
+        /**
+         * Constructs a symbol by interning the given name.
+         * @param name The name to intern.
+         */
+        symbol(char const* name);
+
+        /**
+         * Gets the name of the symbol.
+         * @return Returns the interned name.
+         */
+        std::string const& str() const
+        {
+            return *_name;
+        }
+
+        /**
+         * Gets the name of the symbol.
+         * @return Returns the interned name.
+         */
+        operator std::string const&() const
+        {
+            return *_name;
+        }
+
+        /**
+         * Determines if two symbols are the same.
+         * @param other The symbol to compare to.
+         * @return Returns true if the symbols have the same name or false if not.
+         */
+        bool operator==(symbol const& other) const
+        {
+            return _name == other._name;
+        }
+
+        /**
+         * Determines if two symbols are different.
+         * @param other The symbol to compare to.
+         * @return Returns true if the symbols have different names or false if not.
+         */
+        bool operator!=(symbol const& other) const
+        {
+            return _name != other._name;
+        }
+
+        /**
+         * Determines if this symbol's name sorts before another symbol's name.
+         * @param other The symbol to compare to.
+         * @return Returns true if this symbol's name sorts before the other's or false if not.
+         */
+        bool operator<(symbol const& other) const
+        {
+            return _name != other._name && *_name < *other._name;
+        }
+
+     private:
+        static std::string const* intern(std::string const& name);
+
+        std::string const* _name;
+    };
+
+    /**
+     * Writes the name of the symbol to the given stream.
+     * @param os The stream to write to.
+     * @param sym The symbol to write.
+     * @return Returns the stream being written to.
+     */
+    inline std::ostream& operator<<(std::ostream& os, symbol const& sym)
+    {
+        return os << sym.str();
+    }
+
+}}  // namespace facter::facts
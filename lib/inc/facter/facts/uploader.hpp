@@ -0,0 +1,158 @@
+/**
+ * @file
+ * Declares the uploader that pushes facts to an inventory endpoint over HTTP.
+ */
+#pragma once
+
+#include "../export.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace facter { namespace http {
+
+    struct client;
+
+}}  // namespace facter::http
+
+namespace facter { namespace facts {
+
+    struct collection;
+    struct snapshot;
+    struct value;
+
+    /**
+     * Represents the options of an uploader.
+     */
+    struct upload_options
+    {
+        /**
+         * Constructs the default upload options.
+         */
+        upload_options() :
+            changes_only(false),
+            retries(3),
+            retry_delay(1000),
+            timeout(30000),
+            max_pending(16)
+        {
+        }
+
+        /**
+         * The URL of the endpoint to POST facts to.
+         */
+        std::string url;
+
+        /**
+         * True to upload only the facts that changed since the previous upload or false to always upload every fact.
+         */
+        bool changes_only;
+
+        /**
+         * The number of times a failed upload is retried before its facts are kept for the next upload.
+         */
+        unsigned int retries;
+
+        /**
+         * The delay before the first retry; each retry doubles the delay, and a random jitter of up to the delay is added.
+         */
+        std::chrono::milliseconds retry_delay;
+
+        /**
+         * The time limit of each request.
+         */
+        std::chrono::milliseconds timeout;
+
+        /**
+         * The maximum number of fact sets kept for the next upload while the endpoint cannot be reached.
+         */
+        size_t max_pending;
+    };
+
+    /**
+     * Uploads facts to an inventory endpoint.
+     * Each added collection or snapshot becomes a fact set: a map of "full" (true if the set has every fact), "facts" (the facts
+     * added or changed since the previous set, or every fact), and "removed" (the names of the facts removed since the
+     * previous set), in the MessagePack output format. Hidden facts are never uploaded.
+     * An upload POSTs every pending set in one request, as a gzip-compressed stream of MessagePack maps, oldest first;
+     * the sets are kept for the next upload if the endpoint cannot be reached or fails. If more sets are pending than allowed,
+     * or the endpoint rejects them with a client error, they are discarded and the next set has every fact, so that the
+     * endpoint never receives changes it cannot apply.
+     * The connection to the endpoint is reused between uploads.
+     * This type cannot be copied and is not thread-safe.
+     */
+    struct LIBFACTER_EXPORT uploader
+    {
+        /**
+         * Constructs an uploader.
+         * @param options The options of the uploader.
+         */
+        explicit uploader(upload_options options);
+
+        /**
+         * Destructs the uploader; fact sets that were not uploaded are discarded.
+         */
+        ~uploader();
+
+        /**
+         * Prevents the uploader from being copied.
+         */
+        uploader(uploader const&) = delete;
+
+        /**
+         * Prevents the uploader from being copied.
+         * @returns Returns this uploader.
+         */
+        uploader& operator=(uploader const&) = delete;
+
+        /**
+         * Adds a fact set for the collection's facts to upload; every fact in the collection is resolved.
+         * @param facts The collection to add the facts of.
+         */
+        void add(collection& facts);
+
+        /**
+         * Adds a fact set for the snapshot's facts to upload.
+         * @param facts The snapshot to add the facts of.
+         */
+        void add(snapshot const& facts);
+
+        /**
+         * Uploads the pending fact sets, retrying with backoff if the upload fails.
+         * @return Returns true if there was nothing to upload or the endpoint accepted the sets, or false if they were not uploaded.
+         */
+        bool upload();
+
+        /**
+         * Gets the number of fact sets that have not been uploaded.
+         * @return Returns the number of pending fact sets.
+         */
+        size_t pending() const;
+
+     private:
+        enum struct upload_status
+        {
+            accepted,
+            failed,
+            rejected
+        };
+
+        using fact_enumerator = std::function<void(std::function<bool(std::string const&, value const*)>)>;
+
+        void add_facts(fact_enumerator const& each);
+        upload_status post(std::string const& body);
+
+        upload_options _options;
+        std::unique_ptr<http::client> _client;
+        std::vector<std::string> _pending;
+        std::map<std::string, uint64_t> _hashes;
+        bool _full;
+        std::mt19937 _random;
+    };
+
+}}  // namespace facter::facts
@@ -5,10 +5,12 @@
 #pragma once
 
 #include "../export.h"
+#include <cstdint>
 #include <string>
 #include <functional>
 #include <memory>
 #include <iostream>
+#include <sstream>
 
 // Forward declare needed yaml-cpp classes.
 namespace YAML {
@@ -34,6 +36,63 @@ extern "C" {
 
 namespace facter { namespace facts {
 
+    // Forward declare the MessagePack writer.
+    struct msgpack_writer;
+
+    /**
+     * The type tag of a fact value.
+     * Values carry their type tag so that their type can be checked without RTTI.
+     */
+    enum class value_type : std::uint8_t
+    {
+        /**
+         * A value of any other type (e.g. a Ruby value).
+         */
+        other,
+        /**
+         * A string value.
+         */
+        string,
+        /**
+         * An integer value.
+         */
+        integer,
+        /**
+         * A boolean value.
+         */
+        boolean,
+        /**
+         * A double value.
+         */
+        floating_point,
+        /**
+         * An array value.
+         */
+        array,
+        /**
+         * A map value.
+         */
+        map,
+        /**
+         * A lazy value.
+         */
+        lazy
+    };
+
+    /**
+     * Gets the type tag of the given value type.
+     * This is specialized for each value type with its own tag; other types are checked with dynamic_cast.
+     * @tparam T The value type.
+     */
+    template <typename T>
+    struct value_type_of
+    {
+        /**
+         * The type tag of the value type.
+         */
+        static constexpr value_type type = value_type::other;
+    };
+
     /**
      * Base class for values.
      * This type can be moved but cannot be copied.
@@ -45,6 +104,7 @@ namespace facter { namespace facts {
          * @param hidden True if the fact is hidden from output by default or false if not.
          */
         value(bool hidden = false) :
+            _type(value_type::other),
             _hidden(hidden)
         {
         }
@@ -54,6 +114,20 @@ namespace facter { namespace facts {
          */
         virtual ~value() = default;
 
+        /**
+         * Allocates memory for a value.
+         * Values created while a collection resolves facts are allocated from the collection's arena, if enabled.
+         * @param size The number of bytes to allocate.
+         * @return Returns the allocated memory.
+         */
+        static void* operator new(std::size_t size);
+
+        /**
+         * Frees the memory of a value.
+         * @param ptr The memory to free.
+         */
+        static void operator delete(void* ptr);
+
         /**
          * Moves the given value into this value.
          * @param other The value to move into this value.
@@ -61,6 +135,7 @@ namespace facter { namespace facts {
         // Visual Studio 12 still doesn't allow default for move constructor.
         value(value&& other)
         {
+            _type = other._type;
             _hidden = other._hidden;
         }
 
@@ -72,10 +147,36 @@ namespace facter { namespace facts {
         // Visual Studio 12 still doesn't allow default for move assignment.
         value& operator=(value&& other)
         {
+            _type = other._type;
             _hidden = other._hidden;
             return *this;
         }
 
+        /**
+         * Gets the type tag of the value.
+         * @return Returns the type tag of the value.
+         */
+        value_type type() const
+        {
+            return _type;
+        }
+
+        /**
+         * Casts the value to the given value type.
+         * Types with their own type tag are checked by tag; other types are checked with dynamic_cast.
+         * Lazy values are not unwrapped.
+         * @tparam T The value type to cast to.
+         * @return Returns the value as the given type or nullptr if the value is not of the given type.
+         */
+        template <typename T>
+        T const* as() const
+        {
+            if (value_type_of<T>::type == value_type::other) {
+                return dynamic_cast<T const*>(this);
+            }
+            return _type == value_type_of<T>::type ? static_cast<T const*>(this) : nullptr;
+        }
+
         /**
          * Determines if the value is hidden from output by default.
          * @return Returns true if the value is hidden from output by default or false if it is not.
@@ -92,6 +193,13 @@ namespace facter { namespace facts {
          */
         virtual void to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const = 0;
 
+        /**
+         * Writes the value as MessagePack.
+         * The default implementation writes the value's JSON representation.
+         * @param writer The MessagePack writer to write to.
+         */
+        virtual void to_msgpack(msgpack_writer& writer) const;
+
         /**
           * Writes the value to the given stream.
           * @param os The stream to write to.
@@ -108,13 +216,89 @@ namespace facter { namespace facts {
           */
         virtual YAML::Emitter& write(YAML::Emitter& emitter) const = 0;
 
+        /**
+         * Determines if the value is or contains a value that is computed on first use.
+         * Values that are not deferred never change once they have been added to a map or array,
+         * so they may be shared between copies of a value tree.
+         * @return Returns true if the value is or contains a lazy value or false if not.
+         */
+        virtual bool deferred() const
+        {
+            return false;
+        }
+
+        /**
+         * Creates a copy of the value.
+         * The default implementation copies the value through its JSON representation.
+         * @return Returns the copy of the value or nullptr if the value cannot be copied.
+         */
+        virtual std::unique_ptr<value> clone() const;
+
+        /**
+         * Determines if the given value is equal to this value.
+         * Whether or not the values are hidden is not compared.
+         * The default implementation compares the stream output of the values.
+         * @param other The value to compare to.
+         * @return Returns true if the values are equal or false if they are not.
+         */
+        virtual bool equals(value const& other) const
+        {
+            std::ostringstream first;
+            write(first);
+            std::ostringstream second;
+            other.write(second);
+            return first.str() == second.str();
+        }
+
+        /**
+         * Gets a hash of the value's contents that is the same in every process, so that it can be stored.
+         * Equal values have equal hashes; whether or not the value is hidden is not hashed.
+         * The default implementation hashes a copy of the value (see clone).
+         * @return Returns the hash of the value.
+         */
+        virtual uint64_t hash() const;
+
+        /**
+         * Estimates the memory used by the value: the value itself, the memory it has allocated (e.g. a string's
+         * characters), and the values it contains. Values shared with other values (e.g. between snapshots) are
+         * counted in full by each value that contains them, and lazy values are only counted once they are evaluated.
+         * The default implementation counts only the base value; derived types override it to count themselves.
+         * @return Returns the approximate number of bytes used by the value.
+         */
+        virtual size_t memory_usage() const;
+
+     protected:
+        /**
+         * Constructs a value with a type tag.
+         * @param type The type tag of the value.
+         * @param hidden True if the fact is hidden from output by default or false if not.
+         */
+        value(value_type type, bool hidden) :
+            _type(type),
+            _hidden(hidden)
+        {
+        }
+
      private:
         value(value const&) = delete;
         value& operator=(value const&) = delete;
 
+        value_type _type;
         bool _hidden;
     };
 
+    /**
+     * Casts the given value to the given value type.
+     * @tparam T The value type to cast to.
+     * @param val The value to cast; may be nullptr.
+     * @return Returns the value as the given type or nullptr if the value is nullptr or not of the given type.
+     */
+    template <typename T>
+    T const* value_cast(value const* val)
+    {
+        return val ? val->template as<T>() : nullptr;
+    }
+
     /**
      * Utility function for making a value.
      * @tparam T The type of the value being constructed.
@@ -0,0 +1,78 @@
+/**
+ * @file
+ * Declares the visitor for fact values.
+ */
+#pragma once
+
+#include "value.hpp"
+#include "scalar_value.hpp"
+#include "../export.h"
+
+namespace facter { namespace facts {
+
+    struct array_value;
+    struct map_value;
+
+    /**
+     * Visits fact values by their type tag rather than by RTTI.
+     * Each method does nothing by default; override the methods for the value types of interest.
+     */
+    struct LIBFACTER_EXPORT value_visitor
+    {
+        /**
+         * Destructs the visitor.
+         */
+        virtual ~value_visitor() = default;
+
+        /**
+         * Visits a string value.
+         * @param val The value being visited.
+         */
+        virtual void visit(string_value const& val);
+
+        /**
+         * Visits an integer value.
+         * @param val The value being visited.
+         */
+        virtual void visit(integer_value const& val);
+
+        /**
+         * Visits a boolean value.
+         * @param val The value being visited.
+         */
+        virtual void visit(boolean_value const& val);
+
+        /**
+         * Visits a double value.
+         * @param val The value being visited.
+         */
+        virtual void visit(double_value const& val);
+
+        /**
+         * Visits an array value.
+         * @param val The value being visited.
+         */
+        virtual void visit(array_value const& val);
+
+        /**
+         * Visits a map value.
+         * @param val The value being visited.
+         */
+        virtual void visit(map_value const& val);
+
+        /**
+         * Visits a value of any other type (e.g. a Ruby value).
+         * @param val The value being visited.
+         */
+        virtual void visit(value const& val);
+    };
+
+    /**
+     * Calls the visitor method for the type of the given value.
+     * Lazy values are unwrapped first; a lazy value without a value is not visited.
+     * @param val The value to visit.
+     * @param visitor The visitor to call.
+     */
+    LIBFACTER_EXPORT void visit(value const& val, value_visitor& visitor);
+
+}}  // namespace facter::facts
@@ -9,6 +9,8 @@
 #include "request.hpp"
 #include "response.hpp"
 #include <curl/curl.h>
+#include <functional>
+#include <vector>
 
 namespace facter { namespace http {
 
@@ -26,6 +28,20 @@ namespace facter { namespace http {
         static void cleanup(CURL* curl);
     };
 
+    /**
+     * Resource for a cURL multi handle.
+     */
+    struct LIBFACTER_EXPORT curl_multi_handle : facter::util::scoped_resource<CURLM*>
+    {
+        /**
+         * Constructs a cURL multi handle.
+         */
+        curl_multi_handle();
+
+     private:
+        static void cleanup(CURLM* multi);
+    };
+
     /**
      * Resource for a cURL linked-list.
      */
@@ -151,6 +167,32 @@ namespace facter { namespace http {
          */
         response put(request const& req);
 
+        /**
+         * Performs GETs with the given requests concurrently.
+         * The callback is called on the calling thread as each request completes and can add requests to perform next,
+         * such as for the entries of a listing.
+         * Throws http_request_exception for the first request that fails; the requests still in progress are abandoned.
+         * @param requests The HTTP requests to perform.
+         * @param callback The callback that is called with each request, its response, and a list to add the requests to perform next to.
+         * @param concurrency The maximum number of requests to perform at once.
+         */
+        void get(
+            std::vector<request> requests,
+            std::function<void(request const&, response&, std::vector<request>&)> const& callback,
+            size_t concurrency = 8);
+
+        /**
+         * Performs a GET with the given request and reads the body as it is received instead of buffering all of it.
+         * The callback is called once the response headers are received and reads the body in parts with the given function,
+         * which replaces the contents of the given string with the next part and returns false at the end of the body.
+         * The transfer is abandoned if the callback returns before the entire body is read.
+         * The request's body callback, if any, receives the body instead and the read function returns false.
+         * @param req The HTTP request to perform.
+         * @param callback The callback that is called with the response and the function that reads the next part of the body.
+         * @return Returns the HTTP response; the body is not set.
+         */
+        response get(request const& req, std::function<void(response const&, std::function<bool(std::string&)> const&)> const& callback);
+
      private:
         client(client const&) = delete;
         client& operator=(client const&) = delete;
@@ -164,21 +206,35 @@ namespace facter { namespace http {
 
         struct LIBFACTER_NO_EXPORT context
         {
-            context(request const& req, response& res) :
+            context(CURL* handle, request const& req, response& res) :
+                handle(handle),
                 req(req),
                 res(res),
-                read_offset(0)
+                read_offset(0),
+                buffered(true),
+                received(0),
+                stopped(false),
+                exceeded(false),
+                recording(false)
             {
             }
 
+            CURL* handle;
             request const& req;
             response& res;
             size_t read_offset;
+            bool buffered;
+            size_t received;
+            bool stopped;
+            bool exceeded;
+            bool recording;
             curl_list request_headers;
             std::string response_buffer;
+            std::string recorded_body;
         };
 
         LIBFACTER_NO_EXPORT response perform(http_method method, request const& req);
+        LIBFACTER_NO_EXPORT void prepare(context& ctx, http_method method);
         LIBFACTER_NO_EXPORT void set_method(context& ctx, http_method method);
         LIBFACTER_NO_EXPORT void set_url(context& ctx);
         LIBFACTER_NO_EXPORT void set_headers(context& ctx);
@@ -187,10 +243,13 @@ namespace facter { namespace http {
         LIBFACTER_NO_EXPORT void set_timeouts(context& ctx);
         LIBFACTER_NO_EXPORT void set_write_callbacks(context& ctx);
 
+        static LIBFACTER_NO_EXPORT void configure(CURL* handle);
+        static LIBFACTER_NO_EXPORT void check_result(context const& ctx, CURLcode result);
         static LIBFACTER_NO_EXPORT size_t read_body(char* buffer, size_t size, size_t count, void* ptr);
         static LIBFACTER_NO_EXPORT size_t write_header(char* buffer, size_t size, size_t count, void* ptr);
         static LIBFACTER_NO_EXPORT size_t write_body(char* buffer, size_t size, size_t count, void* ptr);
         static LIBFACTER_NO_EXPORT int debug(CURL* handle, curl_infotype type, char* data, size_t size, void* ptr);
+        static LIBFACTER_NO_EXPORT int progress(void* ptr, curl_off_t download_total, curl_off_t downloaded, curl_off_t upload_total, curl_off_t uploaded);
 
         curl_handle _handle;
     };
@@ -11,6 +11,8 @@
 
 namespace facter { namespace http {
 
+    struct response;
+
     /**
      * Implements the HTTP request.
      */
@@ -118,11 +120,40 @@ namespace facter { namespace http {
          */
         void connection_timeout(long value);
 
+        /**
+         * Gets the maximum size of the response body, in bytes.
+         * @return Returns the maximum size of the response body, in bytes, or 0 if the size is unlimited.
+         */
+        size_t max_body_size() const;
+
+        /**
+         * Sets the maximum size of the response body, in bytes.
+         * A request whose response body is larger fails with an http_request_exception.
+         * @param value The maximum size, in bytes, or 0 for no limit.
+         */
+        void max_body_size(size_t value);
+
+        /**
+         * Gets the callback that consumes the response body as it is received.
+         * @return Returns the callback or an empty function if the response body is buffered.
+         */
+        std::function<bool(response const&, char const*, size_t)> const& body_callback() const;
+
+        /**
+         * Sets the callback that consumes the response body as it is received, instead of the body being buffered in the response.
+         * The callback is called with the response, whose status code and headers have been received, and each part of the body.
+         * Returning false from the callback stops the transfer without failing the request.
+         * @param callback The callback to call with each part of the response body.
+         */
+        void body_callback(std::function<bool(response const&, char const*, size_t)> callback);
+
      private:
         std::string _url;
         std::string _body;
         long _timeout;
         long _connection_timeout;
+        size_t _max_body_size;
+        std::function<bool(response const&, char const*, size_t)> _body_callback;
         std::map<std::string, std::string> _headers;
         std::map<std::string, std::string> _cookies;
     };
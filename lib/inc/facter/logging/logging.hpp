@@ -4,6 +4,7 @@
 */
 #pragma once
 
+#include <functional>
 #include <ostream>
 #include <string>
 #include <boost/format.hpp>
@@ -66,10 +67,44 @@ namespace facter { namespace logging {
     /**
      * Sets up logging for the given stream.
      * The logging level is set to warning by default.
+     * This is not synchronized with logging on other threads; set up logging before starting them.
      * @param os The output stream to configure for logging.
      */
     LIBFACTER_EXPORT void setup_logging(std::ostream& os);
 
+    /**
+     * Sets up logging for the given stream, writing to it on a dedicated thread.
+     * Threads that log hand complete messages to the writer thread rather than waiting on the stream.
+     * The stream's sink and the writer thread are only created when the first message is logged at an enabled level.
+     * Call flush_logging before writing to the stream directly so that earlier messages come first.
+     * The logging level is set to warning by default.
+     * @param os The output stream to configure for logging; it must remain valid until the process exits.
+     */
+    LIBFACTER_EXPORT void setup_async_logging(std::ostream& os);
+
+    /**
+     * Sets up logging for the given stream, writing each message as a JSON object on its own line.
+     * Messages are tagged with the resolver being resolved, the time it has spent resolving so far,
+     * and the child process or HTTP request being waited on, if any.
+     * Messages are written on a dedicated thread as with setup_async_logging.
+     * @param os The output stream to configure for logging; it must remain valid until the process exits.
+     */
+    LIBFACTER_EXPORT void setup_structured_logging(std::ostream& os);
+
+    /**
+     * Waits until every message logged so far has been written.
+     * This does nothing unless logging was set up with setup_async_logging.
+     */
+    LIBFACTER_EXPORT void flush_logging();
+
+    /**
+     * Starts logging again in a child process forked without exec (e.g. a worker process).
+     * Only the forking thread is copied into the child, so the thread that writes messages logged with setup_async_logging
+     * is not; without this, the child's messages would be queued but never written.
+     * Call this in the child before it logs anything, and call flush_logging before the child exits.
+     */
+    LIBFACTER_EXPORT void restart_logging_after_fork();
+
     /**
      * Sets the current logging level.
      * @param lvl The new current logging level to set.
@@ -94,6 +129,13 @@ namespace facter { namespace logging {
      */
     LIBFACTER_EXPORT bool get_colorization();
 
+    /**
+     * Sets the callback that is called with each message logged at an enabled level.
+     * Use this rather than leatherman's on_message so that logging set up by setup_async_logging is still started.
+     * @param callback The callback to call; it returns true to log the message or false to discard it. Pass nullptr to remove the callback.
+     */
+    LIBFACTER_EXPORT void on_message(std::function<bool(level, std::string const&)> callback);
+
     /**
      * Determines if the given logging level is enabled.
      * @param lvl The logging level to check.
@@ -114,6 +156,7 @@ namespace facter { namespace logging {
 
     /**
      * Logs a given message.
+     * Logging is thread-safe: each message is written whole.
      * @param lvl The logging level to log with.
      * @param message The message to log.
      */
@@ -152,6 +195,10 @@ namespace facter { namespace logging {
     template <typename... TArgs>
     void log(level lvl, std::string const& format, TArgs... args)
     {
+        // Don't format messages that won't be logged; errors are always passed on so that they are recorded
+        if (lvl < level::error && !is_enabled(lvl)) {
+            return;
+        }
         boost::format message(format);
         log(lvl, message, std::forward<TArgs>(args)...);
     }
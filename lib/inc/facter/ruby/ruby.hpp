@@ -6,6 +6,7 @@
 
 #include "../facts/collection.hpp"
 #include "../export.h"
+#include <set>
 #include <vector>
 #include <string>
 
@@ -13,12 +14,14 @@ namespace facter { namespace ruby {
 
     /**
      * Initialize Ruby integration in Facter.
+     * Ruby is not located or loaded until custom facts or the ruby facts are first needed, so native-only queries never load it.
      * Important: this function must be called in main().
      * Calling this function from an arbitrary stack depth may result in segfaults during Ruby GC.
      * @param include_stack_trace True if Ruby exception messages should include a stack trace or false if not.
-     * @return Returns true if Ruby was initialized or false if Ruby could not be initialized (likely not found).
+     * @param library_cache The file to remember the location of the Ruby library in, or an empty string to always search for it.
+     * @return Returns true if Ruby integration is enabled; whether Ruby can be found is only known once it is needed.
      */
-    LIBFACTER_EXPORT bool initialize(bool include_stack_trace = false);
+    LIBFACTER_EXPORT bool initialize(bool include_stack_trace = false, std::string const& library_cache = std::string());
 
     /**
      * Loads custom facts into the given collection.
@@ -26,7 +29,17 @@ namespace facter { namespace ruby {
      * Calling this function from an arbitrary stack depth may result in segfaults during Ruby GC.
      * @param facts The collection to populate with custom facts.
      * @param paths The paths to search for custom facts.
+     * @param cache_directory The directory to cache compiled custom facts and the manifest of the facts each file defines in, or empty to not cache them.
+     * @param queries The queries to resolve; with a current manifest, only the files defining the queried facts are loaded. If empty, all custom facts are resolved.
+     * @param workers The number of worker processes to resolve custom facts in when all are resolved; 0 or 1 resolves them in this process.
+     * @param disable_gc True to disable Ruby's garbage collector while custom facts are loaded and resolved or false to leave it enabled.
      */
-    LIBFACTER_EXPORT void load_custom_facts(facter::facts::collection& facts, std::vector<std::string> const& paths = {});
+    LIBFACTER_EXPORT void load_custom_facts(
+        facter::facts::collection& facts,
+        std::vector<std::string> const& paths = {},
+        std::string const& cache_directory = {},
+        std::set<std::string> const& queries = {},
+        unsigned int workers = 0,
+        bool disable_gc = false);
 
 }}  // namespace facter::ruby
@@ -12,9 +12,63 @@ namespace facter { namespace util {
 
     /**
      * Contains utility functions for enumerating directories.
+     * While a fact collection with an alternate root directory is resolving, absolute paths are enumerated beneath the root.
      */
     struct LIBFACTER_EXPORT directory
     {
+        /**
+         * Filters the names of directory entries.
+         * A filter is built once (e.g. a regular expression is compiled once) and can be reused across enumerations.
+         */
+        struct LIBFACTER_EXPORT name_filter
+        {
+            /**
+             * Creates a filter that passes every name.
+             * @return Returns the filter.
+             */
+            static name_filter any();
+
+            /**
+             * Creates a filter that passes names starting with the given text (e.g. "cpu").
+             * @param text The text names must start with.
+             * @return Returns the filter.
+             */
+            static name_filter prefix(std::string text);
+
+            /**
+             * Creates a filter that passes names ending with the given text (e.g. ".rb").
+             * @param text The text names must end with.
+             * @return Returns the filter.
+             */
+            static name_filter suffix(std::string text);
+
+            /**
+             * Creates a filter that passes names matching the given glob, where '*' matches any run of characters and '?' matches any one character (e.g. "dhclient*lease*").
+             * @param pattern The glob names must match.
+             * @return Returns the filter.
+             */
+            static name_filter glob(std::string pattern);
+
+            /**
+             * Creates a filter that passes names containing a match of the given regular expression (e.g. "^cpu\\d+$").
+             * @param pattern The regular expression, which is compiled once.
+             * @return Returns the filter.
+             */
+            static name_filter regex(std::string const& pattern);
+
+            /**
+             * Determines if the given name passes the filter.
+             * @param name The name of the directory entry.
+             * @return Returns true if the name passes or false if not.
+             */
+            bool operator()(std::string const& name) const;
+
+         private:
+            explicit name_filter(std::function<bool(std::string const&)> match);
+
+            std::function<bool(std::string const&)> _match;
+        };
+
         /**
          * Enumerates the files that match the given pattern in the given directory.
          * @param path The directory path to search for the files.
@@ -23,6 +77,14 @@ namespace facter { namespace util {
          */
         static void each_file(std::string const& path, std::function<bool(std::string const&)> callback, std::string const& pattern = {});
 
+        /**
+         * Enumerates the files that pass the given filter in the given directory.
+         * @param path The directory path to search for the files.
+         * @param callback The callback to invoke when a matching file is found.
+         * @param filter The filter of file names.
+         */
+        static void each_file(std::string const& path, std::function<bool(std::string const&)> callback, name_filter const& filter);
+
         /**
          * Enumerates the subdirectories in the given directory.
          * @param path The directory path to search for the subdirectories.
@@ -30,6 +92,14 @@ namespace facter { namespace util {
          * @param pattern The pattern to filter the subdirectory names by.  If empty, all subdirectories are passed.
          */
         static void each_subdirectory(std::string const& path, std::function<bool(std::string const&)> callback, std::string const& pattern = {});
+
+        /**
+         * Enumerates the subdirectories that pass the given filter in the given directory.
+         * @param path The directory path to search for the subdirectories.
+         * @param callback The callback to invoke when a matching subdirectory is found.
+         * @param filter The filter of subdirectory names.
+         */
+        static void each_subdirectory(std::string const& path, std::function<bool(std::string const&)> callback, name_filter const& filter);
     };
 
 }}  // namespace facter::util
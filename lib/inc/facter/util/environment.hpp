@@ -13,6 +13,9 @@ namespace facter { namespace util {
 
     /**
      * Represents a platform-agnostic way for manipulating environment variables.
+     * All functions are thread-safe: reads and changes of the environment are serialized, and callbacks passed to each
+     * are called without the environment locked, so they may change the environment themselves.
+     * Changing the environment other than through this type (e.g. with setenv) is not synchronized.
      */
     struct LIBFACTER_EXPORT environment
     {
@@ -28,6 +31,7 @@ namespace facter { namespace util {
          * Sets an environment variable.
          * Note that on Windows, setting an environment variable to an empty string is
          * equivalent to clearing it.
+         * Setting PATH reloads the search program paths.
          * @param name The name of the environment variable to set.
          * @param value The value of the environment variable to set.
          * @return Returns true if the environment variable could be changed.
@@ -37,6 +41,7 @@ namespace facter { namespace util {
 
         /**
          * Unsets an environment variable.
+         * Unsetting PATH reloads the search program paths.
          * @param name The name of the environment variable to unset.
          * @return Returns true if the environment variable could be unset.
          *         If false, it sets the system error state.
@@ -51,6 +56,8 @@ namespace facter { namespace util {
 
         /**
          * Gets the platform-specific search program paths.
+         * The paths are split from PATH once and kept until PATH is changed with set or clear.
+         * The returned paths remain valid after a reload; a reload publishes new paths rather than changing these.
          * @return Returns the platform-specific program search paths.
          */
         static std::vector<std::string> const& search_paths();
@@ -65,6 +72,14 @@ namespace facter { namespace util {
          * @param callback The callback to call for each environment variable (passes the variable name and value).
          */
         static void each(std::function<bool(std::string&, std::string&)> callback);
+
+        /**
+         * Enumerates the environment variables for the current process whose names start with the given prefix.
+         * The prefix is compared without regard to case; only matching variables are copied for the callback.
+         * @param prefix The prefix of the names of the environment variables to enumerate (e.g. "FACTER_").
+         * @param callback The callback to call for each matching environment variable (passes the variable name and value).
+         */
+        static void each(std::string const& prefix, std::function<bool(std::string&, std::string&)> callback);
     };
 
 }}
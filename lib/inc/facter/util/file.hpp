@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../export.h"
+#include "string.hpp"
 #include <string>
 #include <stdexcept>
 #include <functional>
@@ -13,17 +14,39 @@ namespace facter { namespace util {
 
     /**
      * Contains utility functions for reading data from files.
+     * While a fact collection with an alternate root directory is resolving, absolute paths are read from beneath the root.
      */
     struct LIBFACTER_EXPORT file
     {
         /**
          * Reads each line from the given file.
+         * The file is read once into a single buffer; the line passed to the callback is reused between lines.
          * @param path The path to the file to read.
          * @param callback The callback function that is passed each line in the file.
          * @return Returns true if the file was opened successfully or false if it was not.
          */
         static bool each_line(std::string const& path, std::function<bool(std::string&)> callback);
 
+        /**
+         * Reads each line from the given file.
+         * Unlike the std::function overload, the callback is not type-erased, so it can be inlined into the loop.
+         * @tparam Callback The type of callback; it is called with a std::string& and returns false to stop.
+         * @param path The path to the file to read.
+         * @param callback The callback that is passed each line in the file.
+         * @return Returns true if the file was opened successfully or false if it was not.
+         */
+        template <typename Callback>
+        static bool each_line(std::string const& path, Callback&& callback)
+        {
+            // The file is read once into a single buffer and split in place
+            std::string contents;
+            if (!read(path, contents)) {
+                return false;
+            }
+            util::each_line(contents, std::forward<Callback>(callback));
+            return true;
+        }
+
         /**
          * Reads the entire contents of the given file into a string.
          * @param path The path of the file to read.
@@ -33,6 +56,8 @@ namespace facter { namespace util {
 
         /**
          * Reads the entire contents of the given file into a string.
+         * The string's existing capacity is reused, so reading many small files (e.g. in sysfs or procfs) into the
+         * same string avoids allocating for each file.
          * @param path The path of the file to read.
          * @param contents The returned file contents.
          * @return Returns true if the contents were read or false if the file is not readable.
@@ -0,0 +1,20 @@
+/**
+ * @file
+ * Declares the functions for reporting the process-wide metrics of fact resolution.
+ */
+#pragma once
+
+#include "../export.h"
+#include <ostream>
+
+namespace facter { namespace util {
+
+    /**
+     * Writes the metrics recorded since the process started in the Prometheus text exposition format (version 0.0.4):
+     * a histogram of each resolver's resolution time, the hits and misses of the fact and command caches, the number of
+     * child processes spawned and HTTP requests made, and (where it is known) the resident memory of the process.
+     * @param stream The stream to write the metrics to.
+     */
+    LIBFACTER_EXPORT void write_metrics(std::ostream& stream);
+
+}}  // namespace facter::util
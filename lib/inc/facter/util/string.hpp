@@ -30,6 +30,37 @@ namespace facter { namespace util {
      */
     void each_line(std::string const& s, std::function<bool(std::string&)> callback);
 
+    /**
+     * Reads each line from the given string.
+     * Unlike the std::function overload, the callback is not type-erased, so it can be inlined into the loop.
+     * The line passed to the callback is reused between lines.
+     * @tparam Callback The type of callback; it is called with a std::string& and returns false to stop.
+     * @param s The string to read.
+     * @param callback The callback that is passed each line in the string.
+     */
+    template <typename Callback>
+    void each_line(std::string const& s, Callback&& callback)
+    {
+        std::string line;
+        size_t start = 0;
+        while (start < s.size()) {
+            auto end = s.find('\n', start);
+            if (end == std::string::npos) {
+                end = s.size();
+            }
+            // Handle Windows CR in the string.
+            auto length = end - start;
+            if (length && s[end - 1] == '\r') {
+                --length;
+            }
+            line.assign(s, start, length);
+            if (!callback(line)) {
+                break;
+            }
+            start = end + 1;
+        }
+    }
+
    /**
      * Converts a size, in bytes, to a corresponding string using SI-prefixed units.
      * @param size The size in bytes.
@@ -60,4 +91,68 @@ namespace facter { namespace util {
      */
     bool needs_quotation(std::string const& str);
 
+    /**
+     * Parses a signed decimal integer without throwing or allocating.
+     * Surrounding whitespace is ignored; otherwise the text must be an optional sign and digits that fit the value.
+     * @param first The first character of the text.
+     * @param last One past the last character of the text.
+     * @param value Receives the parsed value; it is unchanged if the text is not a valid integer.
+     * @return Returns true if the text is a valid integer or false if not.
+     */
+    bool parse_integer(char const* first, char const* last, int64_t& value);
+
+    /**
+     * Parses an unsigned decimal integer without throwing or allocating.
+     * Surrounding whitespace is ignored; otherwise the text must be an optional '+' and digits that fit the value.
+     * @param first The first character of the text.
+     * @param last One past the last character of the text.
+     * @param value Receives the parsed value; it is unchanged if the text is not a valid integer.
+     * @return Returns true if the text is a valid integer or false if not.
+     */
+    bool parse_integer(char const* first, char const* last, uint64_t& value);
+
+    /**
+     * Parses a decimal floating point number (e.g. "0.25", "-3", or "1.5e3") without throwing.
+     * Only numbers of 64 or more characters allocate.
+     * Surrounding whitespace is ignored; otherwise the whole text must be the number.
+     * @param first The first character of the text.
+     * @param last One past the last character of the text.
+     * @param value Receives the parsed value; it is unchanged if the text is not a valid number.
+     * @return Returns true if the text is a valid number or false if not.
+     */
+    bool parse_double(char const* first, char const* last, double& value);
+
+    /**
+     * Parses a signed decimal integer without throwing or allocating.
+     * @param text The text to parse; surrounding whitespace is ignored.
+     * @param value Receives the parsed value; it is unchanged if the text is not a valid integer.
+     * @return Returns true if the text is a valid integer or false if not.
+     */
+    inline bool parse_integer(std::string const& text, int64_t& value)
+    {
+        return parse_integer(text.data(), text.data() + text.size(), value);
+    }
+
+    /**
+     * Parses an unsigned decimal integer without throwing or allocating.
+     * @param text The text to parse; surrounding whitespace is ignored.
+     * @param value Receives the parsed value; it is unchanged if the text is not a valid integer.
+     * @return Returns true if the text is a valid integer or false if not.
+     */
+    inline bool parse_integer(std::string const& text, uint64_t& value)
+    {
+        return parse_integer(text.data(), text.data() + text.size(), value);
+    }
+
+    /**
+     * Parses a decimal floating point number without throwing.
+     * @param text The text to parse; surrounding whitespace is ignored.
+     * @param value Receives the parsed value; it is unchanged if the text is not a valid number.
+     * @return Returns true if the text is a valid number or false if not.
+     */
+    inline bool parse_double(std::string const& text, double& value)
+    {
+        return parse_double(text.data(), text.data() + text.size(), value);
+    }
+
 }}  // namespace facter::util
@@ -0,0 +1,27 @@
+/**
+ * @file
+ * Declares the functions for tracing where the time of a run is spent.
+ */
+#pragma once
+
+#include "../export.h"
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * Starts recording spans for the work of the process: each resolver, child process, HTTP request, external
+     * fact file, and custom fact file load and resolution, on the thread that does it.
+     * The calling thread is named the main thread in the trace.
+     */
+    LIBFACTER_EXPORT void start_trace();
+
+    /**
+     * Writes the spans recorded since the trace was started as a Chrome trace event file, which can be viewed
+     * with chrome://tracing or Perfetto.
+     * @param path The path of the file to write.
+     * @return Returns true if the file was written or false if not.
+     */
+    LIBFACTER_EXPORT bool write_trace(std::string const& path);
+
+}}  // namespace facter::util
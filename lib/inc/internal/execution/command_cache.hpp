@@ -0,0 +1,94 @@
+/**
+ * @file
+ * Declares the cache of command results used while resolving facts.
+ */
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace facter { namespace execution {
+
+    /**
+     * Caches the results of executed commands so that a command executed by more than one resolver is only run once.
+     * Commands are keyed on the program, its arguments, its environment, and the options that change its output.
+     * The cache can be shared by threads.
+     */
+    struct command_cache
+    {
+        /**
+         * The result of a command.
+         */
+        struct result
+        {
+            /**
+             * True if the command was terminated by a signal or false if it exited.
+             */
+            bool signaled;
+
+            /**
+             * The exit status or the signal that terminated the command.
+             */
+            int status;
+
+            /**
+             * The entire output of the command, untrimmed.
+             */
+            std::string output;
+        };
+
+        /**
+         * Gets the result of a command, running the command if it has not been run.
+         * The command is run without holding the cache's lock, so commands on other threads aren't blocked.
+         * @param key The key identifying the command.
+         * @param run The function to call to run the command.
+         * @return Returns the result of the command; it remains valid for the lifetime of the cache.
+         */
+        result const& get(std::string const& key, std::function<result()> const& run);
+
+     private:
+        boost::mutex _mutex;
+        std::map<std::string, result> _results;
+    };
+
+    /**
+     * This is an RAII type for using a command cache for the commands executed on the calling thread.
+     */
+    struct scoped_command_cache
+    {
+        /**
+         * Constructs a scoped_command_cache and applies the cache to the calling thread.
+         * @param cache The cache to use or nullptr to execute commands without a cache.
+         */
+        explicit scoped_command_cache(command_cache* cache);
+
+        /**
+         * Restores the enclosing scope, if any.
+         */
+        ~scoped_command_cache();
+
+        /**
+         * Prevents the scope from being copied.
+         */
+        scoped_command_cache(scoped_command_cache const&) = delete;
+
+        /**
+         * Prevents the scope from being copied.
+         * @returns Returns this scope.
+         */
+        scoped_command_cache& operator=(scoped_command_cache const&) = delete;
+
+        /**
+         * Gets the command cache of the calling thread.
+         * @return Returns the command cache or nullptr if commands are not cached.
+         */
+        static command_cache* current();
+
+     private:
+        scoped_command_cache* _previous;
+        command_cache* _cache;
+    };
+
+}}  // namespace facter::execution
@@ -5,23 +5,89 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <functional>
 #include <facter/execution/execution.hpp>
 #include <facter/util/option_set.hpp>
 
 namespace facter { namespace execution {
 
+    /**
+     * Searches the given paths for the given executable file without consulting the results of previous searches.
+     * @param file The file to search for.
+     * @param directories The directories to search.
+     * @return Returns the full path or empty if the file could not be found.
+     */
+    std::string search_executable(std::string const& file, std::vector<std::string> const& directories);
+
+    /**
+     * Processes the output of a child process as it is read.
+     * If a callback is supplied, buffers each line and passes it to the callback.
+     * Otherwise, buffers the entire output.
+     * Output can be read directly into the processor's storage with prepare and commit, which avoids
+     * copying it through an intermediate buffer; the amount prepared grows while reads fill it.
+     */
+    struct output_processor
+    {
+        /**
+         * Constructs an output processor.
+         * @param callback The callback that is called with each line of output.
+         * @param options The execution options.
+         */
+        output_processor(std::function<bool(std::string&)> callback, facter::util::option_set<execution_options> const& options);
+
+        /**
+         * Prepares storage for the next read of output.
+         * Without a callback, the storage is the end of the output itself.
+         * @param size Receives the number of bytes that can be read into the storage.
+         * @return Returns the storage to read into; it is valid until the next call to commit.
+         */
+        char* prepare(size_t& size);
+
+        /**
+         * Processes output that was read into the storage returned by prepare.
+         * @param count The number of bytes that were read.
+         * @return Returns true if more output should be processed or false if the callback requested to stop.
+         */
+        bool commit(size_t count);
+
+        /**
+         * Processes output that was read.
+         * @param buffer The output that was read.
+         * @return Returns true if more output should be processed or false if the callback requested to stop.
+         */
+        bool process(std::string& buffer);
+
+        /**
+         * Processes any output remaining after the last line.
+         * @return Returns the output concatenated together, or an empty string if there is a callback.
+         */
+        std::string finish();
+
+     private:
+        bool process(char const* data, size_t size);
+        bool emit();
+
+        std::function<bool(std::string&)> _callback;
+        facter::util::option_set<execution_options> _options;
+        std::string _output;
+        std::string _buffer;
+        size_t _prepared;
+        size_t _read_size;
+        bool _stopped;
+    };
+
     /**
      * Reads from a stream closure until there is no more data to read.
      * If a callback is supplied, buffers each line and passes it to the callback.
      * Otherwise, returns the concatenation of the stream.
-     * @param yield_input The input stream closure; it expects a mutable string buffer, and returns whether the closure should be invoked again for more input.
+     * @param yield_input The input stream closure; it expects storage to read into and the size of the storage, sets the size to the number of bytes read, and returns whether the closure should be invoked again for more input.
      * @param callback The callback that is called with each line of output.
      * @param options The execution options.
      * @return Returns the stream results concatenated together, or an empty string if callback is not null.
      */
     std::string process_stream(
-        std::function<bool(std::string&)> yield_input,
+        std::function<bool(char*, size_t&)> yield_input,
         std::function<bool(std::string&)> callback,
         facter::util::option_set<execution_options> const& options = { execution_options::defaults });
 
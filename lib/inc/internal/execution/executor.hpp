@@ -0,0 +1,89 @@
+/**
+ * @file
+ * Declares the executor for running commands concurrently.
+ */
+#pragma once
+
+#include <facter/execution/execution.hpp>
+#include <facter/util/option_set.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace facter { namespace execution {
+
+    /**
+     * Runs commands concurrently so that their latencies overlap.
+     * Commands are added and then started together by run, which multiplexes their output on the calling thread
+     * and calls each command's callbacks on that thread as its output is read and when it exits.
+     */
+    struct executor
+    {
+        /**
+         * Constructs an executor.
+         * @param concurrency The maximum number of commands to run at once.
+         */
+        explicit executor(size_t concurrency = 8);
+
+        /**
+         * Prevents the executor from being copied.
+         */
+        executor(executor const&) = delete;
+
+        /**
+         * Prevents the executor from being copied.
+         * @returns Returns this executor.
+         */
+        executor& operator=(executor const&) = delete;
+
+        /**
+         * Adds a command whose entire output is passed to a callback when it exits.
+         * @param file The name or path of the program to execute.
+         * @param arguments The arguments to pass to the program.
+         * @param completed The callback that is called with whether or not the command succeeded and its output; the same as execute returns.
+         * @param options The execution options.
+         */
+        void add(
+            std::string const& file,
+            std::vector<std::string> const& arguments,
+            std::function<void(bool, std::string&)> completed,
+            facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+
+        /**
+         * Adds a command whose output is passed to a callback a line at a time.
+         * @param file The name or path of the program to execute.
+         * @param arguments The arguments to pass to the program.
+         * @param callback The callback that is called with each line of output; return false to stop reading the output.
+         * @param completed The callback that is called with whether or not the command succeeded when it exits.
+         * @param options The execution options.
+         */
+        void each_line(
+            std::string const& file,
+            std::vector<std::string> const& arguments,
+            std::function<bool(std::string&)> callback,
+            std::function<void(bool)> completed,
+            facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+
+        /**
+         * Runs the added commands and waits for all of them to exit.
+         * If a command fails in a way its options ask to throw for, the other commands still run to completion
+         * and the first such exception is rethrown once they have.
+         * If the deadline of the calling thread passes, the commands still running are killed and deadline_exceeded_exception is thrown.
+         */
+        void run();
+
+     private:
+        struct command
+        {
+            std::string file;
+            std::vector<std::string> arguments;
+            std::function<bool(std::string&)> callback;
+            std::function<void(bool, std::string&)> completed;
+            facter::util::option_set<execution_options> options;
+        };
+
+        size_t _concurrency;
+        std::vector<command> _commands;
+    };
+
+}}  // namespace facter::execution
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * Declares the POSIX functions used for starting and waiting on child processes.
+ */
+#pragma once
+
+#include <facter/execution/execution.hpp>
+#include <facter/util/option_set.hpp>
+#include <internal/util/posix/scoped_descriptor.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace facter { namespace execution {
+
+    /**
+     * Starts a child process with an empty stdin and its stdout (and stderr, if redirected) written to a pipe.
+     * @param file The program as given; passed to the child as argv[0].
+     * @param executable The path to the program to execute.
+     * @param arguments The arguments to pass to the program or nullptr for no arguments.
+     * @param environment The environment variables to pass to the program or nullptr for none.
+     * @param options The execution options.
+     * @param child Receives the process id of the child.
+     * @param output Receives the read end of the child's output pipe.
+     * @param new_group True to start the child in a new process group with the child as its leader or false to use the parent's group.
+     * @param error_output If not nullptr, receives the read end of a separate pipe for the child's stderr; the redirect_stderr option is then ignored.
+     * @return Returns 0 if the child process was started or the error that prevented the program from being executed.
+     */
+    int start_child(
+        std::string const& file,
+        std::string const& executable,
+        std::vector<std::string> const* arguments,
+        std::map<std::string, std::string> const* environment,
+        facter::util::option_set<execution_options> const& options,
+        pid_t& child,
+        facter::util::posix::scoped_descriptor& output,
+        bool new_group = false,
+        facter::util::posix::scoped_descriptor* error_output = nullptr);
+
+    /**
+     * Waits for a child process to exit.
+     * Throws child_exit_exception or child_signal_exception if requested by the execution options.
+     * @param child The process id of the child.
+     * @param output The output of the child, for the exceptions.
+     * @param options The execution options.
+     * @return Returns true if the child exited with a status of zero or false if not.
+     */
+    bool wait_child(pid_t child, std::string const& output, facter::util::option_set<execution_options> const& options);
+
+    /**
+     * Waits for a child process to exit and reaps it.
+     * @param child The process id of the child.
+     * @return Returns the wait status of the child.
+     */
+    int reap_child(pid_t child);
+
+    /**
+     * Closes every descriptor from the given descriptor on.
+     * This only makes system calls, so it can be called in a child between fork and exec.
+     * @param first The first descriptor to close.
+     */
+    void close_descriptors(int first);
+
+}}  // namespace facter::execution
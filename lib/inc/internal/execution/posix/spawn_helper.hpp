@@ -0,0 +1,73 @@
+/**
+ * @file
+ * Declares the helper process that starts child processes on behalf of a large parent.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace facter { namespace execution {
+
+    /**
+     * Controls a helper process that starts child processes on behalf of this process.
+     * The helper is forked while this process is still small; afterwards each command is sent to the
+     * helper over a socket, so starting a child never copies this process (e.g. once Ruby is loaded).
+     * The helper waits on the children it starts and reports their exit status back through a pipe per child.
+     */
+    struct spawn_helper
+    {
+        /**
+         * Starts the helper process.
+         * This must be called before any other threads are started.
+         * @return Returns true if the helper is running or false if it could not be started.
+         */
+        static bool start();
+
+        /**
+         * Stops the helper process.
+         * Children that are still running continue to run, but their exit status is no longer reported.
+         */
+        static void stop();
+
+        /**
+         * Starts a child process from the helper, if it is running.
+         * @param error Receives 0 if the child was started or the error that prevented the program from being executed.
+         * @param child Receives the process id of the child.
+         * @param executable The path to the program to execute.
+         * @param args The arguments of the child, including argv[0], terminated by a null.
+         * @param envp The environment of the child, terminated by a null.
+         * @param stdout_write The descriptor to use as the child's stdout.
+         * @param stderr_write The descriptor to use as the child's stderr or -1 to use the null device.
+         * @param new_group True to start the child in a new process group with the child as its leader.
+         * @return Returns true if the request was handled by the helper or false if the helper is not running.
+         */
+        static bool spawn(
+            int& error,
+            pid_t& child,
+            std::string const& executable,
+            std::vector<char const*> const& args,
+            std::vector<char const*> const& envp,
+            int stdout_write,
+            int stderr_write,
+            bool new_group);
+
+        /**
+         * Determines if a child started by the helper has exited, without reaping it.
+         * @param child The process id of the child.
+         * @param exited Receives true if the child has exited or false if it is still running.
+         * @return Returns true if the child was started by the helper or false if not.
+         */
+        static bool exited(pid_t child, bool& exited);
+
+        /**
+         * Waits for a child started by the helper to exit.
+         * @param child The process id of the child.
+         * @param status Receives the wait status of the child.
+         * @return Returns true if the child was started by the helper or false if not.
+         */
+        static bool reap(pid_t child, int& status);
+    };
+
+}}  // namespace facter::execution
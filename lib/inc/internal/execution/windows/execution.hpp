@@ -0,0 +1,153 @@
+/**
+ * @file
+ * Declares the Windows functions used for starting and waiting on child processes.
+ */
+#pragma once
+
+#include <facter/execution/execution.hpp>
+#include <facter/util/option_set.hpp>
+#include <facter/util/scoped_resource.hpp>
+#include <internal/execution/execution.hpp>
+#include <internal/util/windows/windows.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace facter { namespace execution {
+
+    /**
+     * Represents a child process started by start_child.
+     */
+    struct child_process
+    {
+        /**
+         * Constructs a child process that has not been started.
+         */
+        child_process();
+
+        /**
+         * The process id of the child.
+         */
+        DWORD id;
+
+        /**
+         * The handle of the child process.
+         */
+        facter::util::scoped_resource<HANDLE> process;
+
+        /**
+         * The job the child was assigned to, so that the processes it starts can be terminated with it.
+         * This is nullptr if the child could not be assigned to a job.
+         */
+        facter::util::scoped_resource<HANDLE> job;
+
+        /**
+         * The read end of the child's output pipe, opened for overlapped I/O.
+         */
+        facter::util::scoped_resource<HANDLE> output;
+
+        /**
+         * The read end of the child's stderr pipe, opened for overlapped I/O, if stderr is captured separately.
+         */
+        facter::util::scoped_resource<HANDLE> error_output;
+
+        /**
+         * The write end of the child's stdin pipe, if the child was started to read input.
+         */
+        facter::util::scoped_resource<HANDLE> input;
+    };
+
+    /**
+     * Reads a child's output pipe with overlapped I/O and passes what is read to an output processor.
+     * The read can be waited on with the reader's event or through an I/O completion port associated with the pipe.
+     */
+    struct pipe_reader
+    {
+        /**
+         * Constructs a pipe reader.
+         * @param pipe The pipe to read from; it must be opened for overlapped I/O and outlive the reader.
+         * @param processor The processor to pass the output to; it must outlive the reader.
+         * @param signal True to create an event that is signaled when a read completes or false if the pipe is associated with a completion port.
+         */
+        pipe_reader(HANDLE pipe, output_processor& processor, bool signal);
+
+        /**
+         * Cancels any pending read.
+         */
+        ~pipe_reader();
+
+        /**
+         * Prevents the reader from being copied.
+         */
+        pipe_reader(pipe_reader const&) = delete;
+
+        /**
+         * Prevents the reader from being copied.
+         * @returns Returns this reader.
+         */
+        pipe_reader& operator=(pipe_reader const&) = delete;
+
+        /**
+         * Starts the next read.
+         * @return Returns true if a read is pending or false if the end of the output was reached.
+         */
+        bool start();
+
+        /**
+         * Completes a pending read once it has been signaled and passes the data to the output processor.
+         * @return Returns true if the next read should be started or false if the end of the output was reached or the processor stopped.
+         */
+        bool complete();
+
+        /**
+         * Gets the event that is signaled when a read completes.
+         * @return Returns the event or nullptr if the reader was constructed without one.
+         */
+        HANDLE event() const;
+
+     private:
+        HANDLE _pipe;
+        output_processor& _processor;
+        facter::util::scoped_resource<HANDLE> _event;
+        OVERLAPPED _overlapped;
+        bool _pending;
+    };
+
+    /**
+     * Starts a child process with an empty stdin, or one written through a pipe, and its stdout (and stderr, if redirected) written to a pipe.
+     * The child is assigned to a new job so that it and the processes it starts can be terminated together.
+     * Throws execution_exception if the child could not be started.
+     * @param executable The path to the program to execute.
+     * @param arguments The arguments to pass to the program or nullptr for no arguments.
+     * @param environment The environment variables to pass to the program or nullptr for none.
+     * @param options The execution options.
+     * @param capture_stderr True to capture stderr in a separate pipe; the redirect_stderr option is then ignored.
+     * @param child Receives the started child process.
+     * @param pipe_input True to keep the write end of the child's stdin pipe open in the child's input or false to close it.
+     */
+    void start_child(
+        std::string const& executable,
+        std::vector<std::string> const* arguments,
+        std::map<std::string, std::string> const* environment,
+        facter::util::option_set<execution_options> const& options,
+        bool capture_stderr,
+        child_process& child,
+        bool pipe_input = false);
+
+    /**
+     * Terminates a child process and the processes it started, then waits for the child to exit.
+     * @param child The child process to terminate.
+     */
+    void terminate_child(child_process& child);
+
+    /**
+     * Waits for a child process to exit.
+     * Throws child_exit_exception if requested by the execution options.
+     * @param child The child process to wait for.
+     * @param output The output of the child, for the exception.
+     * @param options The execution options.
+     * @return Returns true if the child exited with a status of zero or false if not.
+     */
+    bool wait_child(child_process& child, std::string const& output, facter::util::option_set<execution_options> const& options);
+
+}}  // namespace facter::execution
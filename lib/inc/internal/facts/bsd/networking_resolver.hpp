@@ -23,6 +23,14 @@ namespace facter { namespace facts { namespace bsd {
          */
         virtual data collect_data(collection& facts) override;
 
+        /**
+         * Populates the interfaces of the resolver data from the given interface addresses.
+         * @param facts The fact collection that is resolving facts.
+         * @param result The resolver data to populate.
+         * @param interface_map The map between interface name and the addresses of that interface.
+         */
+        void populate_interfaces(collection& facts, data& result, std::multimap<std::string, ifaddrs const*> const& interface_map);
+
         /**
          * Gets the MTU of the link layer data.
          * @param interface The name of the link layer interface.
@@ -40,16 +48,19 @@ namespace facter { namespace facts { namespace bsd {
 
         /**
          * Finds known DHCP servers for all interfaces.
+         * Each lease directory is searched and each lease file is read once per resolution.
          * @return Returns a map between interface name and DHCP server.
          */
         virtual std::map<std::string, std::string> find_dhcp_servers() const;
 
         /**
-         * Finds the DHCP server for the given interface.
-         * @param interface The interface to find the DHCP server for.
-         * @returns Returns the DHCP server for the interface or empty string if one isn't found.
+         * Finds the DHCP servers of the given interfaces.
+         * This is called at most once per resolution, for all of the interfaces that find_dhcp_servers did not find,
+         * when the DHCP server of one of them is first accessed.
+         * @param interfaces The interfaces to find the DHCP servers for.
+         * @returns Returns a map between interface name and DHCP server.
          */
-        virtual std::string find_dhcp_server(std::string const& interface) const;
+        virtual std::map<std::string, std::string> find_dhcp_servers(std::vector<std::string> const& interfaces) const;
 
      private:
         void populate_address(interface& iface, ifaddrs const* addr) const;
@@ -0,0 +1,38 @@
+/**
+ * @file
+ * Declares the dense ids of the built-in fact names.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace facter { namespace facts {
+
+    /**
+     * The id of a fact name that is not built-in.
+     */
+    constexpr size_t no_builtin_fact = static_cast<size_t>(-1);
+
+    /**
+     * Gets the number of built-in fact names; their ids are dense, from 0 to one less than this.
+     * @return Returns the number of built-in fact names.
+     */
+    size_t builtin_fact_count();
+
+    /**
+     * Gets the id of a built-in fact name.
+     * Built-in names are found with a perfect hash: at most one name is compared.
+     * @param name The fact name to get the id of.
+     * @return Returns the id of the fact name or no_builtin_fact if the name is not built-in.
+     */
+    size_t builtin_fact_id(std::string const& name);
+
+    /**
+     * Gets the built-in fact name with the given id.
+     * @param id The id of the fact name.
+     * @return Returns the fact name or nullptr if the id is not the id of a built-in fact name.
+     */
+    char const* builtin_fact_name(size_t id);
+
+}}  // namespace facter::facts
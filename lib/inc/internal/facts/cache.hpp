@@ -0,0 +1,191 @@
+/**
+ * @file
+ * Declares the on-disk fact cache.
+ */
+#pragma once
+
+#include <facter/facts/value.hpp>
+#include <rapidjson/document.h>
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace facter { namespace facts {
+
+    struct collection;
+    struct resolver;
+
+    /**
+     * Responsible for persisting the facts of resolvers that have a time-to-live (TTL).
+     * The cache is stored as a JSON document keyed by resolver name.
+     * The entire cache is discarded when it was written by a different version of facter.
+     * The cache also records resolvers whose facts are unavailable on this host (e.g. a metadata service that
+     * does not respond), so that they are not resolved again until the record expires or the host is rebooted.
+     * The hashes of the facts of the last run are kept so that a run can report only what changed.
+     * The facts of resolvers that were primed (e.g. at boot) are kept until the host is rebooted, regardless of any TTL.
+     * With a maximum TTL, the TTL of a resolver's facts adapts to how often they change: each time the facts expire and
+     * are resolved to the same values, their TTL doubles up to the maximum; when they change, it returns to the resolver's TTL.
+     */
+    struct fact_cache
+    {
+        /**
+         * Constructs a fact cache and loads any existing cache file.
+         * @param path The path to the cache file.
+         * @param ttls The time-to-live of each resolver's facts, keyed by resolver name.
+         * @param unavailable_ttl The time-to-live of the records of resolvers whose facts are unavailable; zero means they are not recorded.
+         * @param max_ttl The longest time-to-live of facts that do not change; zero (or a TTL longer than it) keeps a resolver's TTL fixed.
+         */
+        fact_cache(std::string path, std::map<std::string, std::chrono::seconds> ttls, std::chrono::seconds unavailable_ttl = std::chrono::seconds(0), std::chrono::seconds max_ttl = std::chrono::seconds(0));
+
+        /**
+         * Prevents the fact cache from being copied.
+         */
+        fact_cache(fact_cache const&) = delete;
+
+        /**
+         * Prevents the fact cache from being copied.
+         * @returns Returns this fact cache.
+         */
+        fact_cache& operator=(fact_cache const&) = delete;
+
+        /**
+         * Gets the path to the cache file.
+         * @return Returns the path to the cache file.
+         */
+        std::string const& path() const;
+
+        /**
+         * Determines if the given resolver's facts are cached.
+         * @param res The resolver to check.
+         * @return Returns true if the resolver has a TTL or is primed or false if it is neither.
+         */
+        bool is_cached(resolver const& res) const;
+
+        /**
+         * Determines if facts can be primed; priming requires an identifier of the current boot.
+         * @return Returns true if facts can be primed or false if they cannot.
+         */
+        bool can_prime() const;
+
+        /**
+         * Primes the cache with the given resolver's facts: once stored, they are loaded until the host is rebooted.
+         * Resolvers are primed before resolving, as the set of primed resolvers is not synchronized.
+         * Facts primed during the current boot are primed again when the cache file is loaded.
+         * @param res The resolver to prime the cache with.
+         */
+        void prime(resolver const& res);
+
+        /**
+         * Adds the resolver's cached facts to the collection if they have not expired.
+         * @param res The resolver to load the facts of.
+         * @param facts The fact collection to add the cached facts to.
+         * @return Returns true if the cached facts were added or false if the resolver needs to be resolved.
+         */
+        bool load(resolver const& res, collection& facts);
+
+        /**
+         * Stores the resolver's facts in the cache.
+         * The cache file is written by flush, so that it isn't written while the collection is locked.
+         * @param res The resolver that resolved the facts.
+         * @param facts The facts resolved by the resolver.
+         */
+        void store(resolver const& res, std::vector<std::pair<std::string, value const*>> const& facts);
+
+        /**
+         * Determines if the given resolver's facts were recorded as unavailable.
+         * A record expires after its TTL or when the host has been rebooted since it was stored.
+         * @param res The resolver to check.
+         * @return Returns true if the resolver should not be resolved or false if it should be.
+         */
+        bool is_unavailable(resolver const& res);
+
+        /**
+         * Records that the resolver's facts are unavailable and writes the cache file.
+         * @param res The resolver whose facts are unavailable.
+         */
+        void store_unavailable(resolver const& res);
+
+        /**
+         * Gets the time-to-live of the facts of an external fact file.
+         * The TTL of an external fact file is given by its file name (e.g. "cmdb.sh").
+         * @param path The path of the external fact file.
+         * @return Returns the TTL of the file's facts or zero if the file has no TTL.
+         */
+        std::chrono::seconds external_ttl(std::string const& path) const;
+
+        /**
+         * Loads the facts of an external fact file from the cache.
+         * The facts are loaded only if the file's modification time and size have not changed since they were stored
+         * and, for a TTL greater than zero, the facts have not expired.
+         * @param path The path of the external fact file.
+         * @param ttl The time-to-live of the facts or zero if they don't expire while the file is unchanged.
+         * @param facts Receives the facts in the order they were resolved; a null value removes a fact.
+         * @return Returns true if the facts were loaded or false if the file needs to be resolved.
+         */
+        bool load_external(std::string const& path, std::chrono::seconds ttl, std::vector<std::pair<std::string, std::unique_ptr<value>>>& facts);
+
+        /**
+         * Gets the names of the facts of an external fact file from the cache, without loading their values.
+         * The names are loaded under the same conditions as load_external loads the facts.
+         * @param path The path of the external fact file.
+         * @param ttl The time-to-live of the facts or zero if they don't expire while the file is unchanged.
+         * @param names Receives the names of the facts, in the order they were resolved.
+         * @return Returns true if the names were loaded or false if the file needs to be resolved.
+         */
+        bool external_names(std::string const& path, std::chrono::seconds ttl, std::vector<std::string>& names);
+
+        /**
+         * Stores the facts of an external fact file in the cache.
+         * The cache file is written by save, as the facts of many files are usually stored at once.
+         * @param path The path of the external fact file.
+         * @param facts The facts resolved from the file, in the order they were resolved.
+         */
+        void store_external(std::string const& path, std::vector<std::pair<std::string, std::unique_ptr<value>>> const& facts);
+
+        /**
+         * Writes the cache file if any facts were stored since it was last written.
+         * The cached facts of external fact files that no longer exist are discarded.
+         */
+        void save();
+
+        /**
+         * Writes the cache file if any facts were stored since it was last written.
+         */
+        void flush();
+
+        /**
+         * Compares facts with the facts of the last run and records them as the facts of the last run.
+         * Facts are compared by a hash of their value tree, so only the hash of each fact is stored.
+         * Every fact is reported as added when no run has been recorded.
+         * @param facts The facts of this run; null values are ignored.
+         * @param added Receives the names of the facts that were not in the last run.
+         * @param changed Receives the names of the facts whose values differ from the last run.
+         * @param removed Receives the names of the facts of the last run that are not in this run.
+         */
+        void compare_last_run(
+            std::vector<std::pair<std::string, value const*>> const& facts,
+            std::vector<std::string>& added,
+            std::vector<std::string>& changed,
+            std::vector<std::string>& removed);
+
+     private:
+        rapidjson::Value const* find_external(std::string const& path, std::chrono::seconds ttl);
+        void read();
+        void write();
+
+        std::string _path;
+        std::map<std::string, std::chrono::seconds> _ttls;
+        std::set<std::string> _primed;
+        std::chrono::seconds _unavailable_ttl;
+        std::chrono::seconds _max_ttl;
+        std::string _boot_id;
+        bool _modified;
+        rapidjson::Document _document;
+        boost::mutex _mutex;
+    };
+
+}}  // namespace facter::facts
@@ -0,0 +1,63 @@
+/**
+ * @file
+ * Declares the detection of the cloud platform a machine runs on.
+ */
+#pragma once
+
+#include <facter/facts/map_value.hpp>
+#include <memory>
+#include <string>
+
+namespace facter { namespace facts {
+
+    /**
+     * The cloud platforms that can be detected from the hardware of a machine.
+     */
+    enum class cloud_platform
+    {
+        /**
+         * The platform can't be determined from the hardware, such as when DMI isn't available.
+         */
+        unknown,
+        /**
+         * The machine is not on a cloud platform with a metadata service.
+         */
+        none,
+        /**
+         * The machine is an EC2 instance.
+         */
+        ec2,
+        /**
+         * The machine is a Google Compute Engine instance.
+         */
+        gce,
+        /**
+         * The machine is a Microsoft Azure virtual machine.
+         */
+        azure,
+        /**
+         * The machine is an OpenStack instance; OpenStack also provides an EC2-compatible metadata service.
+         */
+        openstack,
+        /**
+         * The machine is a DigitalOcean droplet.
+         */
+        digitalocean
+    };
+
+    /**
+     * Detects the cloud platform of the machine from its DMI and hypervisor information in sysfs.
+     * This neither executes commands nor makes network requests, so it can decide whether a metadata service
+     * should be queried before paying for either.
+     * @return Returns the detected cloud platform.
+     */
+    cloud_platform detect_cloud_platform();
+
+    /**
+     * Parses a JSON document returned by a metadata service.
+     * @param document The JSON document to parse.
+     * @return Returns the document as a map value or nullptr if the document is not a JSON object.
+     */
+    std::unique_ptr<map_value> parse_metadata(std::string const& document);
+
+}}  // namespace facter::facts
@@ -5,9 +5,51 @@
 #pragma once
 
 #include <facter/facts/external/resolver.hpp>
+#include <string>
 
 namespace facter { namespace facts { namespace external {
 
+    /**
+     * Reads the facts output by an executable external fact, a line at a time.
+     * Output whose first line is "---" is a YAML document and output whose first line begins with "{" is a JSON object;
+     * the facts of either keep their types and structure. Any other output is read as "name=value" lines of string facts.
+     */
+    struct executable_output
+    {
+        /**
+         * Constructs the output reader.
+         * @param facts The fact collection to populate the facts into.
+         */
+        explicit executable_output(collection& facts);
+
+        /**
+         * Reads a line of output.
+         * "name=value" lines are added as facts immediately; structured output is collected until finish is called.
+         * @param line The line to read; its contents may be moved from.
+         * @return Returns true to continue reading the output.
+         */
+        bool read_line(std::string& line);
+
+        /**
+         * Parses structured output once all of it has been read.
+         * Throws external_fact_exception if the output is not valid.
+         */
+        void finish();
+
+     private:
+        enum class output_format
+        {
+            unknown,
+            lines,
+            json,
+            yaml
+        };
+
+        collection& _facts;
+        output_format _format;
+        std::string _document;
+    };
+
     /**
      * Responsible for resolving facts from executable files.
      */
@@ -26,6 +26,23 @@ namespace facter { namespace facts { namespace external {
          * @param facts The fact collection to populate the external facts into.
          */
         virtual void resolve(std::string const& path, collection& facts) const;
+
+        /**
+         * Determines if the facts resolved from a file change only when the file changes.
+         * The facts of a JSON file are parsed from its contents.
+         * @return Returns true.
+         */
+        virtual bool is_static() const;
     };
 
+    /**
+     * Resolves facts from JSON text, such as the output of an executable external fact.
+     * The text is parsed in situ, so its contents are modified.
+     * Throws external_fact_exception if the text is not a JSON object.
+     * @param begin The beginning of the text.
+     * @param end The end of the text.
+     * @param facts The fact collection to populate the facts into.
+     */
+    void resolve_json(char* begin, char* end, collection& facts);
+
 }}}  // namespace facter::facts::external
@@ -26,6 +26,13 @@ namespace facter { namespace facts { namespace external {
          * @param facts The fact collection to populate the external facts into.
          */
         virtual void resolve(std::string const& path, collection& facts) const;
+
+        /**
+         * Determines if the facts resolved from a file change only when the file changes.
+         * The facts of a text file are parsed from its contents.
+         * @return Returns true.
+         */
+        virtual bool is_static() const;
     };
 
 }}}  // namespace facter::facts::external
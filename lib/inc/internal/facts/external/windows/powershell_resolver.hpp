@@ -6,6 +6,8 @@
 #define FACTER_FACTS_EXTERNAL_POWERSHELL_RESOLVER_HPP_
 
 #include <facter/facts/external/resolver.hpp>
+#include <boost/thread/mutex.hpp>
+#include <memory>
 
 namespace facter { namespace facts { namespace external {
 
@@ -14,6 +16,19 @@ namespace facter { namespace facts { namespace external {
      */
     struct powershell_resolver : resolver
     {
+        /**
+         * Constructs the powershell resolver.
+         * @param persistent True to run every script in one PowerShell process or false to start PowerShell for each script.
+         * A persistent process avoids PowerShell's startup time for each script, but scripts are then run one at a time
+         * and share the process' state (e.g. global variables, environment variables, and loaded modules).
+         */
+        explicit powershell_resolver(bool persistent = false);
+
+        /**
+         * Destructs the powershell resolver, stopping its PowerShell process.
+         */
+        ~powershell_resolver();
+
         /**
          * Determines if the resolver can resolve the facts from the given file.
          * @param path The path to the file to resolve facts from.
@@ -27,6 +42,16 @@ namespace facter { namespace facts { namespace external {
          * @param facts The fact collection to populate the external facts into.
          */
         virtual void resolve(std::string const& path, collection& facts) const;
+
+     private:
+        struct host;
+
+        std::string powershell(collection& facts) const;
+        bool resolve_in_host(std::string const& path, collection& facts) const;
+
+        bool _persistent;
+        mutable boost::mutex _mutex;
+        mutable std::unique_ptr<host> _host;
     };
 
 }}}  // namespace facter::facts::external
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <facter/facts/external/resolver.hpp>
+#include <istream>
 
 namespace facter { namespace facts { namespace external {
 
@@ -26,6 +27,22 @@ namespace facter { namespace facts { namespace external {
          * @param facts The fact collection to populate the external facts into.
          */
         virtual void resolve(std::string const& path, collection& facts) const;
+
+        /**
+         * Determines if the facts resolved from a file change only when the file changes.
+         * The facts of a YAML file are parsed from its contents.
+         * @return Returns true.
+         */
+        virtual bool is_static() const;
     };
 
+    /**
+     * Resolves facts from a YAML document, such as the output of an executable external fact.
+     * Only the first document in the stream is read.
+     * Throws external_fact_exception if the document is not a map.
+     * @param stream The stream to read the document from.
+     * @param facts The fact collection to populate the facts into.
+     */
+    void resolve_yaml(std::istream& stream, collection& facts);
+
 }}}  // namespace facter::facts::external
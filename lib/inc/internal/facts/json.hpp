@@ -0,0 +1,21 @@
+/**
+ * @file
+ * Declares the conversion of JSON values to fact values.
+ */
+#pragma once
+
+#include <facter/facts/value.hpp>
+#include <memory>
+
+namespace facter { namespace facts {
+
+    /**
+     * Converts a JSON value to a fact value.
+     * Elements of arrays and objects that cannot be converted are not included.
+     * @param json The JSON value to convert.
+     * @param hidden True if the fact value is hidden from output by default or false if not.
+     * @return Returns the fact value or nullptr if the JSON value is null.
+     */
+    std::unique_ptr<value> from_json(rapidjson::Value const& json, bool hidden = false);
+
+}}  // namespace facter::facts
@@ -0,0 +1,25 @@
+/**
+ * @file
+ * Declares the Linux control group (cgroup) fact resolver.
+ */
+#pragma once
+
+#include "../resolvers/cgroup_resolver.hpp"
+
+namespace facter { namespace facts { namespace linux {
+
+    /**
+     * Responsible for resolving control group facts.
+     */
+    struct cgroup_resolver : resolvers::cgroup_resolver
+    {
+     protected:
+        /**
+         * Collects the resolver data.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) override;
+    };
+
+}}}  // namespace facter::facts::linux
@@ -21,9 +21,6 @@ namespace facter { namespace facts { namespace linux {
          * @return Returns the resolver data.
          */
         virtual data collect_data(collection& facts) override;
-
-     private:
-        std::string read(std::string const& path);
     };
 
 }}}  // namespace facter::facts::linux
@@ -13,6 +13,13 @@ namespace facter { namespace facts { namespace linux {
      */
     struct filesystem_resolver : resolvers::filesystem_resolver
     {
+        /**
+         * Determines if the resolver is expensive to resolve.
+         * Partition data is read from the udev database, with blkid probing devices udev has no record of.
+         * @return Returns true.
+         */
+        virtual bool is_expensive() const override;
+
      protected:
         /**
          * Collects the DMI data.
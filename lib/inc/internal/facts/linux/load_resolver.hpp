@@ -0,0 +1,25 @@
+/**
+ * @file
+ * Declares the Linux system load fact resolver.
+ */
+#pragma once
+
+#include "../posix/load_resolver.hpp"
+
+namespace facter { namespace facts { namespace linux {
+
+    /**
+     * Responsible for resolving system load facts.
+     */
+    struct load_resolver : posix::load_resolver
+    {
+     protected:
+        /**
+         * Collects the resolver data.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) override;
+    };
+
+}}}  // namespace facter::facts::linux
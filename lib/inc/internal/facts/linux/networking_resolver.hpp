@@ -5,6 +5,9 @@
 #pragma once
 
 #include "../bsd/networking_resolver.hpp"
+#include <deque>
+#include <unordered_map>
+#include <sys/socket.h>
 
 namespace facter { namespace facts { namespace linux {
 
@@ -13,12 +16,19 @@ namespace facter { namespace facts { namespace linux {
      *
      * The Linux networking_resolver inherits from the BSD networking_resolver.
      * This is because getifaddrs is a BSD concept that was implemented in Linux.
-     * The only thing this resolver is responsible for is handing link-level
-     * addressing and MTU.
+     * The links, addresses and default route are read from a few netlink dumps;
+     * getifaddrs is only used if netlink is unavailable.
      */
     struct networking_resolver : bsd::networking_resolver
     {
      protected:
+        /**
+         * Collects the resolver data.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) override;
+
         /**
          * Determines if the given sock address is a link layer address.
          * @param addr The socket address to check.
@@ -47,6 +57,21 @@ namespace facter { namespace facts { namespace linux {
          * @return Returns the primary interface or empty string if one could not be determined.
          */
         virtual std::string get_primary_interface() const override;
+
+     private:
+        struct netlink_address
+        {
+            std::string name;
+            sockaddr_storage address;
+            sockaddr_storage netmask;
+            uint64_t mtu;
+            ifaddrs entry;
+        };
+
+        bool read_netlink(std::deque<netlink_address>& addresses);
+
+        std::unordered_map<std::string, uint64_t> _mtus;
+        boost::optional<std::string> _primary_interface;
     };
 
 }}}  // namespace facter::facts::linux
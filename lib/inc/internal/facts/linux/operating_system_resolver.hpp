@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../posix/operating_system_resolver.hpp"
+#include <map>
 
 namespace facter { namespace facts { namespace linux {
 
@@ -30,9 +31,12 @@ namespace facter { namespace facts { namespace linux {
         virtual std::tuple<std::string, std::string> parse_release(std::string const& name, std::string const& release) const override;
 
      private:
-        static std::string get_name(std::string const& distro_id);
+        static std::map<std::string, std::string> read_os_release();
+        static bool read_lsb_release_file(distribution& distro, std::string& specification_version);
+        static void run_lsb_release(distribution& distro, std::string& specification_version);
+        static std::string get_name(std::map<std::string, std::string> const& os_release);
         static std::string get_release(std::string const& name, std::string const& distro_release);
-        static std::string check_os_release_linux();
+        static std::string check_os_release_linux(std::map<std::string, std::string> const& os_release);
         static std::string check_debian_linux(std::string const& distro_id);
         static std::string check_oracle_linux();
         static std::string check_redhat_linux();
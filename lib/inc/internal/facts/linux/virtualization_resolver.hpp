@@ -14,6 +14,18 @@ namespace facter { namespace facts { namespace linux {
      */
     struct virtualization_resolver : resolvers::virtualization_resolver
     {
+        /**
+         * Constructs the virtualization_resolver.
+         */
+        virtualization_resolver();
+
+        /**
+         * Determines if the resolver is expensive to resolve.
+         * When the hypervisor isn't found natively, it may be found by executing commands such as virt-what and lspci.
+         * @return Returns true.
+         */
+        virtual bool is_expensive() const override;
+
      protected:
         /**
          * Gets the name of the hypervisor.
@@ -24,12 +36,15 @@ namespace facter { namespace facts { namespace linux {
 
      private:
         static std::string get_cgroup_vm();
+        static std::string get_container_vm();
         static std::string get_gce_vm(collection& facts);
         static std::string get_what_vm();
         static std::string get_vserver_vm();
         static std::string get_vmware_vm();
         static std::string get_openvz_vm();
         static std::string get_xen_vm();
+        static std::string get_zlinux_vm();
+        static std::string get_cpuid_vm();
         static std::string get_product_name_vm(collection& facts);
         static std::string get_lspci_vm();
     };
@@ -0,0 +1,38 @@
+/**
+ * @file
+ * Declares the helpers for estimating the memory used by fact values.
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace facter { namespace facts {
+
+    /**
+     * The estimated size of a shared_ptr's control block: a vtable pointer, the use and weak counts, and the pointer.
+     */
+    constexpr size_t shared_control_block_size = 2 * sizeof(void*) + 2 * sizeof(int);
+
+    /**
+     * The estimated size of a node of a std::map beyond its element: the color and the parent, left, and right links.
+     */
+    constexpr size_t map_node_overhead = 4 * sizeof(void*);
+
+    /**
+     * Gets the number of bytes a string has allocated beyond its own size.
+     * Strings short enough to be stored in the string itself allocate nothing.
+     * @param str The string to get the allocated size of.
+     * @return Returns the allocated size of the string, including its terminator.
+     */
+    inline size_t string_memory_usage(std::string const& str)
+    {
+        auto self = reinterpret_cast<char const*>(&str);
+        if (str.data() >= self && str.data() < self + sizeof(str)) {
+            return 0;
+        }
+        return str.capacity() + 1;
+    }
+
+}}  // namespace facter::facts
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * Declares the MessagePack encoding of fact values.
+ */
+#pragma once
+
+#include <facter/facts/value.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace facter { namespace facts {
+
+    /**
+     * Thrown when MessagePack data cannot be decoded.
+     */
+    struct msgpack_exception : std::runtime_error
+    {
+        /**
+         * Constructs a msgpack_exception.
+         * @param message The exception message.
+         */
+        explicit msgpack_exception(std::string const& message);
+    };
+
+    /**
+     * Encodes values as MessagePack into a buffer.
+     * Containers are written by starting them with their element count and then writing each element.
+     */
+    struct msgpack_writer
+    {
+        /**
+         * Constructs a MessagePack writer.
+         * @param buffer The buffer to append the encoded data to.
+         */
+        explicit msgpack_writer(std::string& buffer);
+
+        /**
+         * Writes a nil.
+         */
+        void nil();
+
+        /**
+         * Writes a boolean.
+         * @param value The boolean to write.
+         */
+        void boolean(bool value);
+
+        /**
+         * Writes an integer in the smallest encoding that holds it.
+         * @param value The integer to write.
+         */
+        void integer(int64_t value);
+
+        /**
+         * Writes a double.
+         * @param value The double to write.
+         */
+        void floating_point(double value);
+
+        /**
+         * Writes a string.
+         * @param value The string's characters.
+         * @param size The length of the string.
+         */
+        void str(char const* value, size_t size);
+
+        /**
+         * Writes a string.
+         * @param value The string to write.
+         */
+        void str(std::string const& value);
+
+        /**
+         * Starts an array.
+         * @param size The number of elements that will follow.
+         */
+        void start_array(size_t size);
+
+        /**
+         * Starts a map.
+         * @param size The number of key-value pairs that will follow; each key is written as a string.
+         */
+        void start_map(size_t size);
+
+        /**
+         * Writes a JSON value.
+         * @param value The JSON value to write.
+         */
+        void json(rapidjson::Value const& value);
+
+     private:
+        void header(uint8_t fix, uint8_t fix_limit, uint8_t code, size_t size);
+        void put(uint8_t byte);
+        void put(uint64_t value, unsigned int bytes);
+
+        std::string& _buffer;
+    };
+
+    /**
+     * Decodes a fact value from MessagePack data.
+     * Nil elements of arrays and maps are not included.
+     * @param data The data to decode; updated to point past the decoded value.
+     * @param end The end of the data.
+     * @param hidden True if the fact value is hidden from output by default or false if not.
+     * @return Returns the fact value or nullptr if the data encodes nil.
+     */
+    std::unique_ptr<value> from_msgpack(char const*& data, char const* end, bool hidden = false);
+
+    /**
+     * Decodes facts written in the MessagePack output format (a map of fact name to value).
+     * Facts with nil values are not included.
+     * @param data The data to decode.
+     * @param callback The callback to call with each decoded fact.
+     */
+    void read_msgpack_facts(std::string const& data, std::function<void(std::string&& name, std::unique_ptr<value> val)> const& callback);
+
+    /**
+     * Skips over a MessagePack value, including every value it contains, without decoding it.
+     * Throws msgpack_exception if the data is not a valid value.
+     * @param data The data to skip; on return, points past the value.
+     * @param end The end of the data.
+     */
+    void skip_msgpack(char const*& data, char const* end);
+
+    /**
+     * Finds a value nested in MessagePack data without decoding it.
+     * Each segment of the path selects an element of a map by name or of an array by index.
+     * Throws msgpack_exception if the data is not valid.
+     * @param data The data to search; on success, points at the found value.
+     * @param end The end of the data.
+     * @param path The path of the value to find; an empty path selects the value itself.
+     * @return Returns true if the value was found or false if it was not.
+     */
+    bool find_msgpack(char const*& data, char const* end, std::vector<std::string> const& path);
+
+}}  // namespace facter::facts
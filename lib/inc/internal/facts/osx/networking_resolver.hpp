@@ -50,11 +50,11 @@ namespace facter { namespace facts { namespace osx {
         virtual std::map<std::string, std::string> find_dhcp_servers() const override;
 
         /**
-         * Finds the DHCP server for the given interface.
-         * @param interface The interface to find the DHCP server for.
-         * @returns Returns the DHCP server for the interface or empty string if one isn't found.
+         * Finds the DHCP servers of the given interfaces.
+         * @param interfaces The interfaces to find the DHCP servers for.
+         * @returns Returns a map between interface name and DHCP server.
          */
-        virtual std::string find_dhcp_server(std::string const& interface) const override;
+        virtual std::map<std::string, std::string> find_dhcp_servers(std::vector<std::string> const& interfaces) const override;
     };
 
 }}}  // namespace facter::facts::osx
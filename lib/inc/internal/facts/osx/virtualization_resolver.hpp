@@ -13,6 +13,11 @@ namespace facter { namespace facts { namespace osx {
      */
     struct virtualization_resolver : resolvers::virtualization_resolver
     {
+        /**
+         * Constructs the virtualization_resolver.
+         */
+        virtualization_resolver();
+
      protected:
         /**
          * Gets the name of the hypervisor.
@@ -0,0 +1,25 @@
+/**
+ * @file
+ * Declares the POSIX system load fact resolver.
+ */
+#pragma once
+
+#include "../resolvers/load_resolver.hpp"
+
+namespace facter { namespace facts { namespace posix {
+
+    /**
+     * Responsible for resolving system load facts.
+     */
+    struct load_resolver : resolvers::load_resolver
+    {
+     protected:
+        /**
+         * Collects the resolver data.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) override;
+    };
+
+}}}  // namespace facter::facts::posix
@@ -5,6 +5,9 @@
 #pragma once
 
 #include "../resolvers/networking_resolver.hpp"
+#include <chrono>
+#include <functional>
+#include <string>
 #include <sys/socket.h>
 
 namespace facter { namespace facts { namespace posix {
@@ -43,6 +46,17 @@ namespace facter { namespace facts { namespace posix {
          * @return Returns the resolver data.
          */
         virtual data collect_data(collection& facts) override;
+
+        /**
+         * Looks up the FQDN of a hostname with a time limit.
+         * The lookup runs on a worker thread; if it doesn't return in time, the thread is abandoned and no FQDN is returned.
+         * Another lookup of the hostname isn't started until the abandoned one returns.
+         * @param hostname The hostname to look up.
+         * @param timeout The time limit of the lookup; the deadline of the calling thread also limits it.
+         * @param lookup The function that looks up the canonical name of the given hostname.
+         * @return Returns the FQDN or an empty string if it was not found in time.
+         */
+        static std::string lookup_fqdn(std::string const& hostname, std::chrono::milliseconds timeout, std::function<std::string(std::string const& hostname)> const& lookup);
     };
 
 }}}  // namespace facter::facts::posix
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * Declares the index used to find the resolvers responsible for a fact.
+ */
+#pragma once
+
+#include <facter/facts/resolver.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace facter { namespace facts {
+
+    /**
+     * Indexes resolvers by the fact names and patterns they are responsible for.
+     * Built-in fact names are indexed by their ids and other fact names are hashed; patterns are indexed by the literal prefix they are anchored to, if any,
+     * so that only the patterns that could match a name are evaluated.
+     */
+    struct resolver_index
+    {
+        /**
+         * Constructs an empty resolver index.
+         */
+        resolver_index();
+
+        /**
+         * Adds a resolver to the index.
+         * @param res The resolver to add.
+         */
+        void add(std::shared_ptr<resolver> const& res);
+
+        /**
+         * Removes a resolver from the index.
+         * @param res The resolver to remove.
+         */
+        void remove(std::shared_ptr<resolver> const& res);
+
+        /**
+         * Removes all resolvers from the index.
+         */
+        void clear();
+
+        /**
+         * Finds a resolver responsible for the given fact name.
+         * Resolvers for the name itself are found before resolvers with a matching pattern; otherwise
+         * resolvers are found in the order they were added.
+         * @param name The fact name to find a resolver for.
+         * @return Returns the resolver or nullptr if no resolver is responsible for the fact.
+         */
+        std::shared_ptr<resolver> find(std::string const& name) const;
+
+        /**
+         * Gets the literal prefix a pattern is anchored to.
+         * Any name the pattern matches is guaranteed to start with the prefix.
+         * @param pattern The regular expression pattern.
+         * @return Returns the anchored literal prefix or an empty string if the pattern is not anchored to a literal prefix.
+         */
+        static std::string anchored_prefix(std::string const& pattern);
+
+     private:
+        struct node
+        {
+            std::map<char, std::unique_ptr<node>> children;
+            std::vector<size_t> resolvers;
+        };
+
+        node* find_node(std::string const& prefix, bool create);
+
+        std::vector<std::vector<std::shared_ptr<resolver>>> _builtins;
+        std::unordered_map<std::string, std::vector<std::shared_ptr<resolver>>> _names;
+        std::map<size_t, std::shared_ptr<resolver>> _patterns;
+        std::map<resolver const*, size_t> _ids;
+        node _root;
+        size_t _next_id;
+    };
+
+}}  // namespace facter::facts
@@ -0,0 +1,136 @@
+/**
+ * @file
+ * Declares the base control group (cgroup) fact resolver.
+ */
+#pragma once
+
+#include <facter/facts/resolver.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace facter { namespace facts { namespace resolvers {
+
+    /**
+     * Responsible for resolving the resource limits of facter's control group and the namespaces it runs in.
+     */
+    struct cgroup_resolver : resolver
+    {
+        /**
+         * Constructs the cgroup_resolver.
+         */
+        cgroup_resolver();
+
+        /**
+         * Called to resolve all facts the resolver is responsible for.
+         * @param facts The fact collection that is resolving facts.
+         */
+        virtual void resolve(collection& facts) override;
+
+     protected:
+        /**
+         * Represents the I/O limits of a block device.
+         * A limit of -1 means the device is not limited.
+         */
+        struct io_limit
+        {
+            /**
+             * Constructs the I/O limit.
+             */
+            io_limit() :
+                read_bps(-1),
+                write_bps(-1),
+                read_iops(-1),
+                write_iops(-1)
+            {
+            }
+
+            /**
+             * Stores the device number of the block device (e.g. "8:0").
+             */
+            std::string device;
+
+            /**
+             * Stores the maximum bytes read per second.
+             */
+            int64_t read_bps;
+
+            /**
+             * Stores the maximum bytes written per second.
+             */
+            int64_t write_bps;
+
+            /**
+             * Stores the maximum read operations per second.
+             */
+            int64_t read_iops;
+
+            /**
+             * Stores the maximum write operations per second.
+             */
+            int64_t write_iops;
+        };
+
+        /**
+         * Represents the resolver's data.
+         * A limit of -1 means the control group is not limited.
+         */
+        struct data
+        {
+            /**
+             * Constructs the data.
+             */
+            data() :
+                version(0),
+                cpu_quota(-1),
+                cpu_period(0),
+                memory_max(-1)
+            {
+            }
+
+            /**
+             * Stores the version of the cgroup hierarchy or 0 if it is unknown.
+             */
+            int version;
+
+            /**
+             * Stores the path of the control group in the hierarchy.
+             */
+            std::string path;
+
+            /**
+             * Stores the CPU time the control group may use in each period, in microseconds.
+             */
+            int64_t cpu_quota;
+
+            /**
+             * Stores the length of the CPU period, in microseconds.
+             */
+            int64_t cpu_period;
+
+            /**
+             * Stores the maximum memory the control group may use, in bytes.
+             */
+            int64_t memory_max;
+
+            /**
+             * Stores the I/O limits of the control group's block devices.
+             */
+            std::vector<io_limit> io;
+
+            /**
+             * Stores the identifiers (inode numbers) of the namespaces the process is in, keyed by namespace type.
+             */
+            std::map<std::string, uint64_t> namespaces;
+        };
+
+        /**
+         * Collects the resolver data.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) = 0;
+    };
+
+}}}  // namespace facter::facts::resolvers
@@ -0,0 +1,42 @@
+/**
+* @file
+* Declares the base DigitalOcean fact resolver.
+*/
+#pragma once
+
+#include <facter/facts/resolver.hpp>
+#include <internal/facts/cloud.hpp>
+
+namespace facter { namespace facts { namespace resolvers {
+
+    /**
+    * Responsible for resolving DigitalOcean facts.
+    * The metadata service is only queried when the platform is detected from the hardware.
+    */
+    struct digitalocean_resolver : resolver
+    {
+        /**
+         * Constructs the digitalocean_resolver.
+         */
+        digitalocean_resolver();
+
+        /**
+         * Called to resolve all facts the resolver is responsible for.
+         * @param facts The fact collection that is resolving facts.
+         */
+        virtual void resolve(collection& facts) override;
+
+        /**
+         * Determines if the resolver is expensive to resolve.
+         * The DigitalOcean facts are resolved with HTTP requests to the metadata service.
+         * @return Returns true.
+         */
+        virtual bool is_expensive() const override;
+
+     private:
+        explicit digitalocean_resolver(cloud_platform platform);
+
+        cloud_platform _platform;
+    };
+
+}}}  // namespace facter::facts::resolvers
@@ -6,6 +6,7 @@
 
 #include <facter/facts/resolver.hpp>
 #include <string>
+#include <vector>
 
 namespace facter { namespace facts { namespace resolvers {
 
@@ -16,8 +17,9 @@ namespace facter { namespace facts { namespace resolvers {
     {
         /**
          * Constructs the dmi_resolver.
+         * @param dependencies The fact names the platform implementation consumes while resolving.
          */
-        dmi_resolver();
+        dmi_resolver(std::vector<std::string> dependencies = {});
 
         /**
          * Converts the given chassis type identifier to a description string.
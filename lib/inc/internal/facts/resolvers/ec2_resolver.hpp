@@ -5,16 +5,25 @@
 #pragma once
 
 #include <facter/facts/resolver.hpp>
+#include <internal/facts/cloud.hpp>
+#include <facter/facts/map_value.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
 
 namespace facter { namespace facts { namespace resolvers {
 
     /**
     * Responsible for resolving EC2 facts.
+    * The metadata service is accessed with an IMDSv2 session token when the service provides one.
+    * The metadata is kept for the lifetime of the token, so resolving the facts again only requests
+    * the metadata that can change while the instance runs.
     */
     struct ec2_resolver : resolver
     {
         /**
          * Constructs the ec2_resolver.
+         * The platform is detected from the hardware so that the virtualization facts are only needed when it can't be.
          */
         ec2_resolver();
 
@@ -23,6 +32,22 @@ namespace facter { namespace facts { namespace resolvers {
          * @param facts The fact collection that is resolving facts.
          */
         virtual void resolve(collection& facts) override;
+
+        /**
+         * Determines if the resolver is expensive to resolve.
+         * The EC2 facts are resolved with HTTP requests to the metadata service.
+         * @return Returns true.
+         */
+        virtual bool is_expensive() const override;
+
+     private:
+        explicit ec2_resolver(cloud_platform platform);
+        void not_ec2(collection& facts) const;
+
+        cloud_platform _platform;
+        std::string _token;
+        std::chrono::steady_clock::time_point _token_expiry;
+        std::shared_ptr<map_value const> _snapshot;
     };
 
 }}}  // namespace facter::facts::resolvers
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <facter/facts/resolver.hpp>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
 #include <set>
@@ -39,7 +41,8 @@ namespace facter { namespace facts { namespace resolvers {
              */
             mountpoint() :
                 size(0),
-                available(0)
+                available(0),
+                unavailable(false)
             {
             }
 
@@ -68,6 +71,11 @@ namespace facter { namespace facts { namespace resolvers {
              */
             uint64_t available;
 
+            /**
+             * Stores whether the size of the mountpoint is unavailable because its file system did not respond in time.
+             */
+            bool unavailable;
+
             /**
              * Stores the mountpoint options.
              */
@@ -155,6 +163,35 @@ namespace facter { namespace facts { namespace resolvers {
          * @return Returns the file system data.
          */
         virtual data collect_data(collection& facts) = 0;
+
+        /**
+         * Determines if mountpoints of the given file system type are resolved.
+         * @param type The file system type (e.g. "nfs").
+         * @return Returns true if the type was excluded by the fact collection or false if not.
+         */
+        bool is_filesystem_excluded(std::string const& type) const;
+
+        /**
+         * Determines if the given file system type is served remotely or by a user-space process (e.g. NFS, CIFS, or FUSE).
+         * Querying such a file system can block for as long as its server doesn't respond.
+         * @param type The file system type.
+         * @return Returns true if the file system is remote or false if it is local.
+         */
+        static bool is_remote_filesystem(std::string const& type);
+
+        /**
+         * Populates the size of a mountpoint.
+         * The sizes of remote file systems are queried on a worker thread; if the query doesn't return in time, the
+         * thread is abandoned and the mountpoint is marked as unavailable. A mountpoint whose query is still blocked
+         * from an earlier resolution is not queried again.
+         * @param point The mountpoint to populate; its file system type must already be set.
+         * @param stat The function that queries the total and available bytes of the given mountpoint path.
+         */
+        void populate_size(mountpoint& point, std::function<bool(std::string const& path, uint64_t& size, uint64_t& available)> const& stat) const;
+
+     private:
+        std::set<std::string> _excluded_filesystems;
+        std::chrono::milliseconds _remote_timeout;
     };
 
 }}}  // namespace facter::facts::resolvers
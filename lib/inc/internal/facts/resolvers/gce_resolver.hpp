@@ -5,6 +5,7 @@
 #pragma once
 
 #include <facter/facts/resolver.hpp>
+#include <internal/facts/cloud.hpp>
 
 namespace facter { namespace facts { namespace resolvers {
 
@@ -15,6 +16,7 @@ namespace facter { namespace facts { namespace resolvers {
     {
         /**
          * Constructs the gce_resolver.
+         * The platform is detected from the hardware so that the virtualization facts are only needed when it can't be.
          */
         gce_resolver();
 
@@ -23,6 +25,18 @@ namespace facter { namespace facts { namespace resolvers {
          * @param facts The fact collection that is resolving facts.
          */
         virtual void resolve(collection& facts) override;
+
+        /**
+         * Determines if the resolver is expensive to resolve.
+         * The GCE facts are resolved with HTTP requests to the metadata service.
+         * @return Returns true.
+         */
+        virtual bool is_expensive() const override;
+
+     private:
+        explicit gce_resolver(cloud_platform platform);
+
+        cloud_platform _platform;
     };
 
 }}}  // namespace facter::facts::resolvers
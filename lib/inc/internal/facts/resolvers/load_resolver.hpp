@@ -0,0 +1,137 @@
+/**
+ * @file
+ * Declares the base system load fact resolver.
+ */
+#pragma once
+
+#include <facter/facts/resolver.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace facter { namespace facts { namespace resolvers {
+
+    /**
+     * Responsible for resolving the system load averages, resource pressure, and utilization.
+     * These facts change continuously; the daemon can sample them between refreshes.
+     */
+    struct load_resolver : resolver
+    {
+        /**
+         * Constructs the load_resolver.
+         */
+        load_resolver();
+
+        /**
+         * Called to resolve all facts the resolver is responsible for.
+         * @param facts The fact collection that is resolving facts.
+         */
+        virtual void resolve(collection& facts) override;
+
+     protected:
+        /**
+         * Represents the share of time that tasks were stalled on a resource.
+         */
+        struct stall
+        {
+            /**
+             * Constructs the stall.
+             */
+            stall() :
+                avg10(0),
+                avg60(0),
+                avg300(0),
+                total(0)
+            {
+            }
+
+            /**
+             * Stores the percentage of time stalled over the last 10 seconds.
+             */
+            double avg10;
+
+            /**
+             * Stores the percentage of time stalled over the last 60 seconds.
+             */
+            double avg60;
+
+            /**
+             * Stores the percentage of time stalled over the last 300 seconds.
+             */
+            double avg300;
+
+            /**
+             * Stores the total time stalled, in microseconds.
+             */
+            uint64_t total;
+        };
+
+        /**
+         * Represents the resolver's data.
+         */
+        struct data
+        {
+            /**
+             * Constructs the data.
+             */
+            data() :
+                load_averages_available(false),
+                one(0),
+                five(0),
+                fifteen(0),
+                utilization_available(false),
+                cpu_utilization(0),
+                disk_queue_length(0)
+            {
+            }
+
+            /**
+             * Stores whether or not the load averages are available.
+             */
+            bool load_averages_available;
+
+            /**
+             * Stores the load average over the last minute.
+             */
+            double one;
+
+            /**
+             * Stores the load average over the last 5 minutes.
+             */
+            double five;
+
+            /**
+             * Stores the load average over the last 15 minutes.
+             */
+            double fifteen;
+
+            /**
+             * Stores the stalls of each resource (e.g. "cpu"), keyed by the kind of stall ("some" or "full").
+             */
+            std::map<std::string, std::map<std::string, stall>> pressure;
+
+            /**
+             * Stores whether or not the utilization is available.
+             */
+            bool utilization_available;
+
+            /**
+             * Stores the percentage of processor time spent busy since the last resolve.
+             */
+            double cpu_utilization;
+
+            /**
+             * Stores the average number of disk requests queued since the last resolve.
+             */
+            double disk_queue_length;
+        };
+
+        /**
+         * Collects the resolver data.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) = 0;
+    };
+
+}}}  // namespace facter::facts::resolvers
@@ -6,6 +6,8 @@
 
 #include <facter/facts/resolver.hpp>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 namespace facter { namespace facts { namespace resolvers {
 
@@ -45,6 +47,91 @@ namespace facter { namespace facts { namespace resolvers {
             not_encrypted
         };
 
+        /**
+         * Represents a pool of huge pages of one size.
+         */
+        struct hugepage_pool
+        {
+            /**
+             * Constructs the hugepage pool.
+             */
+            hugepage_pool() :
+                size(0),
+                total(0),
+                free(0),
+                reserved(0),
+                surplus(0)
+            {
+            }
+
+            /**
+             * Stores the size of each page, in bytes.
+             */
+            uint64_t size;
+
+            /**
+             * Stores the number of pages in the pool.
+             */
+            uint64_t total;
+
+            /**
+             * Stores the number of pages that are not allocated.
+             */
+            uint64_t free;
+
+            /**
+             * Stores the number of pages that are reserved for allocations but not yet allocated.
+             */
+            uint64_t reserved;
+
+            /**
+             * Stores the number of pages allocated beyond the size of the pool (i.e. overcommitted).
+             */
+            uint64_t surplus;
+        };
+
+        /**
+         * Represents the memory of a NUMA node.
+         */
+        struct numa_node
+        {
+            /**
+             * Constructs the NUMA node.
+             */
+            numa_node() :
+                total(0),
+                free(0),
+                hugepages_total(0),
+                hugepages_free(0)
+            {
+            }
+
+            /**
+             * Stores the name of the node (e.g. "node0").
+             */
+            std::string name;
+
+            /**
+             * Stores the total memory of the node, in bytes.
+             */
+            uint64_t total;
+
+            /**
+             * Stores the free memory of the node, in bytes.
+             */
+            uint64_t free;
+
+            /**
+             * Stores the number of huge pages of the default size on the node.
+             */
+            uint64_t hugepages_total;
+
+            /**
+             * Stores the number of huge pages of the default size on the node that are not allocated.
+             */
+            uint64_t hugepages_free;
+        };
+
         /**
          * Represents data about system memory.
          */
@@ -86,6 +173,16 @@ namespace facter { namespace facts { namespace resolvers {
              * Stores the swap encryption status.
              */
             encryption_status swap_encryption;
+
+            /**
+             * Stores the pools of huge pages, one for each page size.
+             */
+            std::vector<hugepage_pool> hugepages;
+
+            /**
+             * Stores the memory of each NUMA node.
+             */
+            std::vector<numa_node> numa_nodes;
         };
 
         /**
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <facter/facts/resolver.hpp>
+#include <functional>
+#include <map>
 #include <string>
 #include <vector>
 #include <boost/optional.hpp>
@@ -28,6 +30,21 @@ namespace facter { namespace facts { namespace resolvers {
          */
         static std::string macaddress_to_string(uint8_t const* bytes);
 
+        /**
+         * Utility function to convert the bytes of an IPv4 address to a string.
+         * @param bytes The bytes of the address in network order; expected to be 4 bytes long.
+         * @returns Returns the address in dotted decimal notation.
+         */
+        static std::string ipv4_to_string(uint8_t const* bytes);
+
+        /**
+         * Utility function to convert the bytes of an IPv6 address to a string.
+         * The address is formatted the same way as inet_ntop formats it.
+         * @param bytes The bytes of the address in network order; expected to be 16 bytes long.
+         * @returns Returns the address in the compressed text form of RFC 5952.
+         */
+        static std::string ipv6_to_string(uint8_t const* bytes);
+
         /**
          * Called to resolve all facts the resolver is responsible for.
          * @param facts The fact collection that is resolving facts.
@@ -66,6 +83,12 @@ namespace facter { namespace facts { namespace resolvers {
              */
             std::string dhcp_server;
 
+            /**
+             * Stores the function to find the DHCP server address when it is first accessed.
+             * Used only when the DHCP server address is empty; the function must not outlive the resolver.
+             */
+            std::function<std::string()> find_dhcp_server;
+
             /**
              * Stores the interface's address.
              */
@@ -121,6 +144,11 @@ namespace facter { namespace facts { namespace resolvers {
              * Stores the interface.
              */
             std::vector<interface> interfaces;
+
+            /**
+             * Stores the number of interfaces of each class (e.g. "veth") when the collection summarizes interfaces.
+             */
+            std::map<std::string, uint64_t> interface_counts;
         };
 
         /**
@@ -129,6 +157,23 @@ namespace facter { namespace facts { namespace resolvers {
          * @return Returns the resolver data.
          */
         virtual data collect_data(collection& facts) = 0;
+
+        /**
+         * Determines if an interface passes the collection's interface filter.
+         * When the collection summarizes interfaces, the interface is also counted by class in the resolver data.
+         * Call this once per interface before looking up its DHCP server or other details.
+         * @param result The resolver data to count the interface in.
+         * @param name The name of the interface.
+         * @return Returns true if the interface should be resolved or false if it is filtered out.
+         */
+        bool is_interface_included(data& result, std::string const& name) const;
+
+     private:
+        void compile_filter(collection const& facts);
+
+        std::vector<boost::regex> _included;
+        std::vector<boost::regex> _excluded;
+        bool _summarize;
     };
 
 }}}  // namespace facter::facts::resolvers
@@ -5,7 +5,11 @@
 #pragma once
 
 #include <facter/facts/resolver.hpp>
+#include <facter/facts/map_value.hpp>
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace facter { namespace facts { namespace resolvers {
 
@@ -171,6 +175,13 @@ namespace facter { namespace facts { namespace resolvers {
              */
             distribution distro;
 
+            /**
+             * Finds the distribution information and specification version (e.g. by running lsb_release).
+             * If set, the function is called the first time one of the distribution facts is accessed rather than
+             * when the facts are resolved; the distro and specification_version members are then ignored.
+             */
+            std::function<void(distribution& distro, std::string& specification_version)> find_distro;
+
             /**
              * Stores information about Mac OSX.
              */
@@ -209,6 +220,10 @@ namespace facter { namespace facts { namespace resolvers {
          * @return Returns the OS family or empty string if there is no family.
          */
         virtual std::string determine_os_family(collection& facts, std::string const& name) const;
+
+     private:
+        std::vector<std::pair<std::string, std::string>> get_distro_facts(std::string const& name, distribution const& distro, std::string const& specification_version) const;
+        std::unique_ptr<map_value> get_distro_value(std::string const& name, distribution const& distro, std::string const& specification_version) const;
     };
 
 }}}  // namespace facter::facts::resolvers
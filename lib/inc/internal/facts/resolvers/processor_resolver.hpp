@@ -28,6 +28,114 @@ namespace facter { namespace facts { namespace resolvers {
         virtual void resolve(collection& facts) override;
 
      protected:
+        /**
+         * Represents the topology of a logical processor.
+         */
+        struct logical_processor
+        {
+            /**
+             * Constructs a logical processor with an unknown topology.
+             */
+            logical_processor() :
+                id(-1),
+                package(-1),
+                core(-1),
+                node(-1),
+                max_speed(0)
+            {
+            }
+
+            /**
+             * Stores the number of the logical processor.
+             */
+            int id;
+
+            /**
+             * Stores the physical package (socket) of the logical processor or -1 if unknown.
+             */
+            int package;
+
+            /**
+             * Stores the core of the logical processor within its package or -1 if unknown.
+             */
+            int core;
+
+            /**
+             * Stores the NUMA node of the logical processor or -1 if unknown.
+             */
+            int node;
+
+            /**
+             * Stores the maximum speed of the logical processor, in Hz, or 0 if unknown.
+             */
+            int64_t max_speed;
+
+            /**
+             * Stores the logical processors that share the core (e.g. "0,64").
+             */
+            std::string siblings;
+        };
+
+        /**
+         * Represents the caches of one kind (e.g. "L1d").
+         */
+        struct cache
+        {
+            /**
+             * Constructs a cache.
+             */
+            cache() :
+                size(0),
+                instances(0)
+            {
+            }
+
+            /**
+             * Stores the name of the cache (e.g. "L1d", "L1i", or "L2").
+             */
+            std::string name;
+
+            /**
+             * Stores the size of each cache, in bytes.
+             */
+            uint64_t size;
+
+            /**
+             * Stores the number of caches of this kind.
+             */
+            int instances;
+        };
+
+        /**
+         * Represents a NUMA node.
+         */
+        struct numa_node
+        {
+            /**
+             * Constructs a NUMA node.
+             */
+            numa_node() :
+                id(-1),
+                memory(0)
+            {
+            }
+
+            /**
+             * Stores the number of the node.
+             */
+            int id;
+
+            /**
+             * Stores the logical processors of the node (e.g. "0-31,64-95").
+             */
+            std::string cpus;
+
+            /**
+             * Stores the memory of the node, in bytes.
+             */
+            uint64_t memory;
+        };
+
         /**
          * Represents processor resolver data.
          */
@@ -67,6 +175,21 @@ namespace facter { namespace facts { namespace resolvers {
              * Stores the processor instruction set architecture.
              */
             std::string isa;
+
+            /**
+             * Stores the topology of each logical processor, ordered by number.
+             */
+            std::vector<logical_processor> topology;
+
+            /**
+             * Stores the caches of the processors.
+             */
+            std::vector<cache> caches;
+
+            /**
+             * Stores the NUMA nodes, ordered by number.
+             */
+            std::vector<numa_node> nodes;
         };
 
         /**
@@ -24,6 +24,13 @@ namespace facter { namespace facts { namespace resolvers {
          */
         virtual void resolve(collection& facts) override;
 
+        /**
+         * Determines if the resolver can be resolved on a thread other than the one resolving the collection.
+         * The Ruby VM may only be called from the thread that initialized it, so this resolver is not thread safe.
+         * @return Returns false.
+         */
+        virtual bool is_thread_safe() const override;
+
      protected:
         /**
          * Represents Ruby metadata.
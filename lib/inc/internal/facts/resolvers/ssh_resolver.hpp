@@ -93,7 +93,7 @@ namespace facter { namespace facts { namespace resolvers {
         virtual data collect_data(collection& facts) = 0;
 
      private:
-        void add_key(collection& facts, map_value& value, ssh_key& key, std::string const& name, std::string const& key_fact_name, std::string const& fingerprint_fact_name);
+        void add_key(collection& facts, map_value& value, ssh_key& key, char const* name, char const* key_fact_name, char const* fingerprint_fact_name);
     };
 
 }}}  // namespace facter::facts::resolvers
@@ -24,6 +24,13 @@ namespace facter { namespace facts { namespace resolvers {
          */
         virtual void resolve(collection& facts) override;
 
+        /**
+         * Determines if the resolver is expensive to resolve.
+         * The system profiler facts are resolved by executing system_profiler, which can take several seconds.
+         * @return Returns true.
+         */
+        virtual bool is_expensive() const override;
+
      protected:
         /**
          *  Represents the resolver's data.
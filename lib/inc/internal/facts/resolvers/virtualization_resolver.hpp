@@ -6,6 +6,7 @@
 
 #include <facter/facts/resolver.hpp>
 #include <string>
+#include <vector>
 
 namespace facter { namespace facts { namespace resolvers {
 
@@ -16,8 +17,9 @@ namespace facter { namespace facts { namespace resolvers {
     {
         /**
          * Constructs the virtualization_resolver.
+         * @param dependencies The fact names the platform implementation consumes while resolving.
          */
-        virtualization_resolver();
+        virtualization_resolver(std::vector<std::string> dependencies = {});
 
         /**
          * Called to resolve all facts the resolver is responsible for.
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <facter/facts/resolver.hpp>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,53 @@ namespace facter { namespace facts { namespace resolvers {
          */
         virtual std::string zpool_command() = 0;
 
+        /**
+         * Represents a ZFS storage pool.
+         */
+        struct pool
+        {
+            /**
+             * Constructs a pool.
+             */
+            pool() :
+                size(0),
+                free(0),
+                fragmentation(-1),
+                version(0)
+            {
+            }
+
+            /**
+             * Stores the name of the pool.
+             */
+            std::string name;
+
+            /**
+             * Stores the health of the pool (e.g. "ONLINE" or "DEGRADED").
+             */
+            std::string health;
+
+            /**
+             * Stores the size of the pool, in bytes.
+             */
+            uint64_t size;
+
+            /**
+             * Stores the unallocated space in the pool, in bytes.
+             */
+            uint64_t free;
+
+            /**
+             * Stores the fragmentation percentage of the pool's free space or -1 if it is not known.
+             */
+            int64_t fragmentation;
+
+            /**
+             * Stores the on-disk version of the pool or 0 if the pool uses feature flags.
+             */
+            uint64_t version;
+        };
+
         /**
          *  Represents the resolver's data.
          */
@@ -46,6 +94,10 @@ namespace facter { namespace facts { namespace resolvers {
              * Stores the zpool feature numbers.
              */
             std::vector<std::string> features;
+            /**
+             * Stores the imported pools.
+             */
+            std::vector<pool> pools;
         };
 
         /**
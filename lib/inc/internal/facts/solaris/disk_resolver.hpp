@@ -5,6 +5,8 @@
 #pragma once
 
 #include "../resolvers/disk_resolver.hpp"
+#include "../../util/solaris/k_stat.hpp"
+#include <memory>
 
 namespace facter { namespace facts { namespace solaris {
 
@@ -13,6 +15,12 @@ namespace facter { namespace facts { namespace solaris {
      */
     struct disk_resolver : resolvers::disk_resolver
     {
+        /**
+         * Constructs the disk_resolver.
+         * @param kstat The kstat handle to share with other resolvers or nullptr to open one when resolving.
+         */
+        disk_resolver(std::shared_ptr<util::solaris::k_stat> kstat = nullptr);
+
      protected:
         /**
          * Collects the resolver data.
@@ -20,6 +28,9 @@ namespace facter { namespace facts { namespace solaris {
          * @return Returns the resolver data.
          */
         virtual data collect_data(collection& facts) override;
+
+     private:
+        std::shared_ptr<util::solaris::k_stat> _kstat;
     };
 
 }}}  // namespace facter::facts::solaris
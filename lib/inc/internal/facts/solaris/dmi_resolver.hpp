@@ -13,6 +13,11 @@ namespace facter { namespace facts { namespace solaris {
      */
     struct dmi_resolver : resolvers::dmi_resolver
     {
+        /**
+         * Constructs the dmi_resolver.
+         */
+        dmi_resolver();
+
      protected:
         /**
          * Collects the resolver data.
@@ -20,6 +25,9 @@ namespace facter { namespace facts { namespace solaris {
          * @return Returns the resolver data.
          */
         virtual data collect_data(collection& facts) override;
+
+     private:
+        void collect_smbios_data(data& result);
     };
 
 }}}  // namespace facter::facts::solaris
@@ -42,6 +42,7 @@ namespace facter { namespace facts { namespace solaris {
         void populate_macaddress(interface& iface, lifreq const* addr) const;
         void populate_network(interface& iface, lifreq const* addr) const;
         void populate_mtu(interface& iface, lifreq const* addr) const;
+        bool is_dhcp_running(lifreq const* addr) const;
         std::string find_dhcp_server(std::string const& interface) const;
         std::string get_primary_interface() const;
     };
@@ -5,6 +5,8 @@
 #pragma once
 
 #include "../posix/uptime_resolver.hpp"
+#include "../../util/solaris/k_stat.hpp"
+#include <memory>
 
 namespace facter { namespace facts { namespace solaris {
 
@@ -13,12 +15,21 @@ namespace facter { namespace facts { namespace solaris {
      */
     struct uptime_resolver : posix::uptime_resolver
     {
+        /**
+         * Constructs the uptime_resolver.
+         * @param kstat The kstat handle to share with other resolvers or nullptr to open one when resolving.
+         */
+        uptime_resolver(std::shared_ptr<util::solaris::k_stat> kstat = nullptr);
+
      protected:
         /**
          * Gets the system uptime in seconds.
          * @return Returns the system uptime in seconds.
          */
         virtual int64_t get_uptime() override;
+
+     private:
+        std::shared_ptr<util::solaris::k_stat> _kstat;
     };
 
 }}}  // namespace facter::facts::solaris
@@ -19,6 +19,17 @@ namespace facter { namespace facts { namespace solaris {
          * @return Returns the platform's zpool command.
          */
         virtual std::string zpool_command();
+
+        /**
+         * Collects the resolver data.
+         * The pools are read with libzfs, which is loaded when resolving so that facter does not depend on it.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) override;
+
+     private:
+        void collect_pool_data(data& result);
     };
 
 }}}  // namespace facter::facts::solaris
@@ -0,0 +1,112 @@
+/**
+ * @file
+ * Declares the arena that fact values are allocated from.
+ */
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <cstddef>
+
+namespace facter { namespace facts {
+
+    /**
+     * Allocates fact values from large chunks of memory rather than individually.
+     * Each chunk is released once the arena and every value allocated from it have been destroyed,
+     * so values may safely outlive the arena (e.g. when shared with a snapshot).
+     * Allocation is thread safe.
+     */
+    struct value_arena
+    {
+        /**
+         * Constructs a value arena.
+         * @param chunk_size The size of each chunk of memory, in bytes.
+         */
+        explicit value_arena(size_t chunk_size = 16 * 1024);
+
+        /**
+         * Releases the arena's reference to its current chunk.
+         */
+        ~value_arena();
+
+        /**
+         * Prevents the arena from being copied.
+         */
+        value_arena(value_arena const&) = delete;
+
+        /**
+         * Prevents the arena from being copied.
+         * @returns Returns this arena.
+         */
+        value_arena& operator=(value_arena const&) = delete;
+
+        /**
+         * Allocates memory from the arena.
+         * Allocations larger than a quarter of the chunk size are made individually.
+         * @param size The number of bytes to allocate.
+         * @return Returns the allocated memory, which must be freed with deallocate.
+         */
+        void* allocate(size_t size);
+
+        /**
+         * Allocates memory from the arena of the calling thread or individually if there is no arena.
+         * @param size The number of bytes to allocate.
+         * @return Returns the allocated memory, which must be freed with deallocate.
+         */
+        static void* allocate_current(size_t size);
+
+        /**
+         * Frees memory allocated by allocate or allocate_current.
+         * This may be called from any thread.
+         * @param ptr The memory to free.
+         */
+        static void deallocate(void* ptr);
+
+     private:
+        struct chunk;
+
+        static void release(chunk* owner);
+
+        boost::mutex _mutex;
+        size_t _chunk_size;
+        chunk* _current;
+    };
+
+    /**
+     * This is an RAII type for allocating the fact values created on the calling thread from an arena.
+     */
+    struct scoped_arena
+    {
+        /**
+         * Constructs a scoped_arena and applies the arena to the calling thread.
+         * @param arena The arena to allocate values from or nullptr to allocate values individually.
+         */
+        explicit scoped_arena(value_arena* arena);
+
+        /**
+         * Restores the enclosing scope, if any.
+         */
+        ~scoped_arena();
+
+        /**
+         * Prevents the scope from being copied.
+         */
+        scoped_arena(scoped_arena const&) = delete;
+
+        /**
+         * Prevents the scope from being copied.
+         * @returns Returns this scope.
+         */
+        scoped_arena& operator=(scoped_arena const&) = delete;
+
+        /**
+         * Gets the arena of the calling thread.
+         * @return Returns the arena of the calling thread or nullptr if values are allocated individually.
+         */
+        static value_arena* current();
+
+     private:
+        scoped_arena* _previous;
+        value_arena* _arena;
+    };
+
+}}  // namespace facter::facts
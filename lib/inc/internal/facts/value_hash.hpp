@@ -0,0 +1,58 @@
+/**
+ * @file
+ * Declares the helpers for hashing fact values.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace facter { namespace facts {
+
+    /**
+     * The initial hash of 64-bit FNV-1a.
+     * Value hashes are stored in the fact cache, so they must not differ between processes.
+     */
+    constexpr uint64_t hash_basis = 14695981039346656037ull;
+
+    /**
+     * Hashes bytes with 64-bit FNV-1a, continuing from the given hash.
+     * @param hash The hash to continue from.
+     * @param data The bytes to hash.
+     * @param size The number of bytes to hash.
+     * @return Returns the combined hash.
+     */
+    inline uint64_t hash_bytes(uint64_t hash, void const* data, size_t size)
+    {
+        auto bytes = static_cast<unsigned char const*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /**
+     * Hashes an integer, continuing from the given hash.
+     * @param hash The hash to continue from.
+     * @param value The integer to hash.
+     * @return Returns the combined hash.
+     */
+    inline uint64_t hash_integer(uint64_t hash, uint64_t value)
+    {
+        return hash_bytes(hash, &value, sizeof(value));
+    }
+
+    /**
+     * Hashes a string and its length, so that consecutive strings hash differently than their concatenation.
+     * @param hash The hash to continue from.
+     * @param str The string to hash.
+     * @return Returns the combined hash.
+     */
+    inline uint64_t hash_string(uint64_t hash, std::string const& str)
+    {
+        return hash_bytes(hash_integer(hash, str.size()), str.data(), str.size());
+    }
+
+}}  // namespace facter::facts
@@ -22,6 +22,13 @@ namespace facter { namespace facts { namespace windows {
          */
         dmi_resolver(std::shared_ptr<util::windows::wmi> wmi_conn = std::make_shared<util::windows::wmi>());
 
+        /**
+         * Determines if the resolver can be resolved on a thread other than the one resolving the collection.
+         * The WMI connection is bound to the thread that initialized COM, so this resolver is not thread safe.
+         * @return Returns false.
+         */
+        virtual bool is_thread_safe() const override;
+
      protected:
         /**
          * Collects the resolver data.
@@ -32,6 +39,7 @@ namespace facter { namespace facts { namespace windows {
 
      private:
         std::string read(std::string const& path);
+        void collect_smbios_data(data& result);
         std::shared_ptr<util::windows::wmi> _wmi;
     };
 
@@ -0,0 +1,40 @@
+/**
+ * @file
+ * Declares the Windows system load fact resolver.
+ */
+#pragma once
+
+#include "../resolvers/load_resolver.hpp"
+#include <facter/util/scoped_resource.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace facter { namespace facts { namespace windows {
+
+    /**
+     * Responsible for resolving system load facts from performance counters.
+     * The counters are rates, so the query stays open between resolves and each resolve reports the rate since the last.
+     */
+    struct load_resolver : resolvers::load_resolver
+    {
+        /**
+         * Constructs the load_resolver.
+         */
+        load_resolver();
+
+     protected:
+        /**
+         * Collects the resolver data.
+         * @param facts The fact collection that is resolving facts.
+         * @return Returns the resolver data.
+         */
+        virtual data collect_data(collection& facts) override;
+
+     private:
+        boost::mutex _mutex;
+        util::scoped_resource<void*> _query;
+        void* _cpu;
+        void* _disk;
+        bool _sampled;
+    };
+
+}}}  // namespace facter::facts::windows
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../resolvers/networking_resolver.hpp"
+#include <boost/thread/mutex.hpp>
 #include <vector>
 #include <string>
 #include <functional>
@@ -89,6 +90,11 @@ namespace facter { namespace facts { namespace windows {
          * Stores a pointer to ConvertLengthToIpv4Mask, which is used post-Windows Server 2003.
          */
         std::function<int(unsigned long, unsigned long*)> _convertLengthToIpv4Mask;
+
+     private:
+        // The buffer for GetAdaptersAddresses; kept between resolves so that it only grows when adapters are added
+        boost::mutex _addresses_mutex;
+        std::vector<char> _addresses;
     };
 
 }}}  // namespace facter::facts::windows
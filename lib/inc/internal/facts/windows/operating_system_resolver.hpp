@@ -21,6 +21,13 @@ namespace facter { namespace facts { namespace windows {
          */
         operating_system_resolver(std::shared_ptr<util::windows::wmi> wmi_conn = std::make_shared<util::windows::wmi>());
 
+        /**
+         * Determines if the resolver can be resolved on a thread other than the one resolving the collection.
+         * The WMI connection is bound to the thread that initialized COM, so this resolver is not thread safe.
+         * @return Returns false.
+         */
+        virtual bool is_thread_safe() const override;
+
      protected:
         /**
          * Collects the resolver data.
@@ -6,6 +6,7 @@
 
 #include "../resolvers/uptime_resolver.hpp"
 #include "../../util/windows/wmi.hpp"
+#include <functional>
 #include <string>
 #include <memory>
 
@@ -18,9 +19,17 @@ namespace facter { namespace facts { namespace windows {
     {
         /**
          * Constructs the uptime_resolver.
-         * @param wmi_conn The WMI connection to use when resolving facts.
+         * @param wmi_conn The WMI connection to use when GetTickCount64 is unavailable (Windows Server 2003), or nullptr for none.
          */
-        uptime_resolver(std::shared_ptr<util::windows::wmi> wmi_conn = std::make_shared<util::windows::wmi>());
+        uptime_resolver(std::shared_ptr<util::windows::wmi> wmi_conn = nullptr);
+
+        /**
+         * Determines if the resolver can be resolved on a thread other than the one resolving the collection.
+         * The WMI connection is bound to the thread that initialized COM, so this resolver is only thread safe when
+         * GetTickCount64 is used instead.
+         * @return Returns true if the uptime is read without WMI or false if not.
+         */
+        virtual bool is_thread_safe() const override;
 
      protected:
         /**
@@ -31,6 +40,7 @@ namespace facter { namespace facts { namespace windows {
 
      private:
         std::shared_ptr<util::windows::wmi> _wmi;
+        std::function<unsigned long long()> _getTickCount64;
     };
 
 }}}  // namespace facter::facts::windows
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * Declares the functions used to query and output a set of facts.
+ */
+#pragma once
+
+#include <facter/facts/collection.hpp>
+#include <facter/facts/value.hpp>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace facter { namespace facts {
+
+    /**
+     * The function used to get a top-level fact by name.
+     */
+    using fact_getter = std::function<value const*(std::string const&)>;
+
+    /**
+     * The function used to enumerate the facts that have values.
+     * The given callback is called with the name and value of each fact; the value may be lazy.
+     */
+    using fact_enumerator = std::function<void(std::function<void(std::string const&, value const*)> const&)>;
+
+    /**
+     * Splits a query into its segments.
+     * Segments are separated by '.'; a double-quoted segment may contain '.'.
+     * @param query The query to split.
+     * @return Returns the segments of the query.
+     */
+    std::vector<std::string> split_query(std::string const& query);
+
+    /**
+     * Runs a query against a set of facts.
+     * @param query The query to run.
+     * @param get The function used to get a top-level fact by name.
+     * @return Returns the result of the query or nullptr if the query returned no value.
+     */
+    value const* query_value(std::string const& query, fact_getter const& get);
+
+    /**
+     * Writes a set of facts to the given stream.
+     * @param stream The stream to write the facts to.
+     * @param fmt The output format to use.
+     * @param queries The set of queries to filter the output to. If empty, all facts will be output.
+     * @param each The function used to enumerate the facts with values when there are no queries.
+     * @param get The function used to get a top-level fact by name.
+     * @param project True to output the queried values nested beneath the facts and keys they were queried from or false to output them by query.
+     * @param concurrency The number of threads that format the facts when there are no queries; each fact is formatted
+     * into its own buffer and the buffers are written in order, so the output is the same as when formatted on one thread.
+     */
+    void write_facts(
+        std::ostream& stream,
+        format fmt,
+        std::set<std::string> const& queries,
+        fact_enumerator const& each,
+        fact_getter const& get,
+        bool project = false,
+        unsigned int concurrency = 1);
+
+}}  // namespace facter::facts
@@ -0,0 +1,53 @@
+/**
+ * @file
+ * Declares the YAML writer for facts.
+ */
+#pragma once
+
+#include <facter/facts/value.hpp>
+#include <ostream>
+#include <string>
+
+namespace facter { namespace facts {
+
+    /**
+     * Writes facts as a block-style YAML map directly to a stream.
+     * This produces the same output as yaml-cpp's emitter for the values facter outputs without building emitter state.
+     */
+    struct yaml_writer
+    {
+        /**
+         * Constructs a YAML writer.
+         * @param stream The stream to write to.
+         */
+        explicit yaml_writer(std::ostream& stream);
+
+        /**
+         * Writes a fact.
+         * @param name The name of the fact.
+         * @param val The value of the fact; if nullptr, an empty string is written.
+         */
+        void write(std::string const& name, value const* val);
+
+        /**
+         * Ends the map of facts.
+         * This must be called after the last fact is written.
+         */
+        void end();
+
+     private:
+        enum class position
+        {
+            key,
+            item
+        };
+
+        void write_value(value const& val, unsigned int indent, position pos);
+        void write_string(std::string const& str, bool quote);
+        void write_indent(unsigned int indent);
+
+        std::ostream& _stream;
+        bool _empty;
+    };
+
+}}  // namespace facter::facts
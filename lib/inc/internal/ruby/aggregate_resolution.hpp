@@ -8,6 +8,7 @@
 #include "chunk.hpp"
 #include <string>
 #include <map>
+#include <vector>
 
 namespace facter { namespace ruby {
 
@@ -68,10 +69,12 @@ namespace facter { namespace ruby {
 
         // Helper functions
         static VALUE deep_merge(api const& ruby, VALUE left, VALUE right);
+        void order_chunks();
 
         VALUE _self;
         VALUE _block;
         std::map<VALUE, ruby::chunk> _chunks;
+        std::vector<VALUE> _order;
     };
 
 }}  // namespace facter::ruby
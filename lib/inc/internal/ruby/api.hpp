@@ -4,6 +4,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -11,6 +12,7 @@
 #include <functional>
 #include <memory>
 #include <initializer_list>
+#include <unordered_map>
 #include "../util/dynamic_library.hpp"
 
 namespace facter { namespace facts {
@@ -96,6 +98,19 @@ namespace facter {  namespace ruby {
          */
         static api* instance();
 
+        /**
+         * Defers locating, loading, and initializing Ruby until initialized_instance is first called.
+         * This should be called from main(), as Ruby's garbage collector scans the stack from the calling frame.
+         * @param include_stack_trace True if Ruby exception messages should include a stack trace or false if not.
+         */
+        static void defer_initialize(bool include_stack_trace);
+
+        /**
+         * Gets the Ruby API instance, initializing Ruby first if its initialization was deferred.
+         * @return Returns the initialized Ruby API instance or nullptr if the Ruby API is unavailable or not initialized.
+         */
+        static api* initialized_instance();
+
         /**
          * Called to initialize the API.
          * This should be done at the same stack frame where code is loaded into the Ruby VM.
@@ -284,6 +299,11 @@ namespace facter {  namespace ruby {
          * See MRI documentation.
          */
         VALUE (* const rb_hash_new)();
+        /**
+         * See MRI documentation.
+         * This is only present in Ruby 3.2 or later; use hash_with_capacity rather than calling it directly.
+         */
+        VALUE (* const rb_hash_new_capa)(long);
         /**
          * See MRI documentation.
          */
@@ -538,6 +558,7 @@ namespace facter {  namespace ruby {
 
         /**
          * Converts the given value to a corresponding Ruby object.
+         * The keys of hashes are frozen strings that are shared between conversions.
          * @param val The value to convert.
          * @return Returns a Ruby object for the value.
          */
@@ -580,6 +601,21 @@ namespace facter {  namespace ruby {
             return reinterpret_cast<T*>(reinterpret_cast<RData*>(obj)->data);
         }
 
+        /**
+         * Creates a hash sized for the given number of entries, if the Ruby version supports it.
+         * @param capacity The number of entries the hash will hold.
+         * @return Returns the new hash.
+         */
+        VALUE hash_with_capacity(size_t capacity) const;
+
+        /**
+         * Gets a frozen string to use as a hash key.
+         * One string is shared by every hash with the key, so Ruby stores it as is rather than copying it.
+         * @param key The key.
+         * @return Returns the frozen string for the key.
+         */
+        VALUE key_value(std::string const& key) const;
+
         /**
          * Registers a data object for cleanup when the API is destructed.
          * The object must have been created with rb_data_object_alloc.
@@ -599,11 +635,32 @@ namespace facter {  namespace ruby {
             _data_objects.erase(obj);
         }
 
+        /**
+         * Keeps an object alive until it is released.
+         * Retained objects are referenced from a single hash registered with the GC rather than each registering an address,
+         * which the GC must scan and which is slow to unregister.
+         * @param obj The object to retain; it is retained once for each call.
+         */
+        void retain(VALUE obj) const;
+
+        /**
+         * Releases an object retained with retain.
+         * @param obj The object to release.
+         */
+        void release(VALUE obj) const;
+
         /**
          * Global flag to disable Ruby VM cleanup.
          * This should be set to false in any forked child processes.
+         * The flag is atomic so that it may be cleared on any thread.
+         */
+        static std::atomic<bool> cleanup;
+
+        /**
+         * The file to remember the location of the Ruby library in, or an empty string to always search for it.
+         * Finding the library on the PATH runs ruby; the location it reports is reused until that ruby changes.
          */
-        static bool cleanup;
+        static std::string library_cache;
 
      private:
         explicit api(facter::util::dynamic_library library);
@@ -612,6 +669,7 @@ namespace facter {  namespace ruby {
         void (* const ruby_init)();
         void* (* const ruby_options)(int, char**);
         int (* const ruby_cleanup)(volatile int);
+        void (* const ruby_init_stack)(volatile VALUE*);
 
         static std::unique_ptr<api> create();
         static facter::util::dynamic_library find_library();
@@ -623,6 +681,9 @@ namespace facter {  namespace ruby {
         static int hash_for_each_thunk(VALUE key, VALUE value, VALUE arg);
 
         static std::set<VALUE> _data_objects;
+        static volatile VALUE* _stack_start;
+        static bool _deferred;
+        static bool _deferred_stack_trace;
 
         // Represents object data
         // This definition comes from Ruby (unfortunately)
@@ -645,6 +706,9 @@ namespace facter {  namespace ruby {
         VALUE _false = 0u;
         bool _initialized = false;
         bool _include_stack_trace = false;
+        mutable std::unordered_map<std::string, VALUE> _keys;
+        mutable VALUE _key_strings = 0u;
+        mutable VALUE _retained = 0u;
     };
 
 }}  // namespace facter::ruby
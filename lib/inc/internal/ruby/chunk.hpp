@@ -17,10 +17,11 @@ namespace facter { namespace ruby {
     {
         /**
          * Constructs an aggregate resolution chunk.
+         * @param name The name of the chunk.
          * @param dependencies The symbol or array of symbols this chunk depends on.
          * @param block The block to run to resolve the chunk.
          */
-        chunk(VALUE dependencies, VALUE block);
+        chunk(VALUE name, VALUE dependencies, VALUE block);
 
         /**
          * Moves the given chunk into this chunk.
@@ -66,6 +67,11 @@ namespace facter { namespace ruby {
          */
         void block(VALUE block);
 
+        /**
+         * Forgets the chunk's value so that its block is called again when the value is next requested.
+         */
+        void reset();
+
      private:
         chunk(chunk const&) = delete;
         chunk& operator=(chunk const&) = delete;
@@ -73,6 +79,7 @@ namespace facter { namespace ruby {
 
         friend struct aggregate_resolution;
 
+        VALUE _name;
         VALUE _dependencies;
         VALUE _block;
         VALUE _value;
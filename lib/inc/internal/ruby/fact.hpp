@@ -6,11 +6,14 @@
 
 #include "api.hpp"
 #include "resolution.hpp"
-#include <vector>
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace facter { namespace facts {
 
+    struct collection;
     struct value;
 
 }}  // namespace facter::facts
@@ -95,6 +98,10 @@ namespace facter { namespace ruby {
         static VALUE ruby_resolution(VALUE self, VALUE name);
         static VALUE ruby_define_resolution(int argc, VALUE* argv, VALUE self);
         static VALUE ruby_flush(VALUE self);
+        static VALUE ruby_timed_block(VALUE yielded, VALUE context, int argc, VALUE* argv);
+
+        // Helper functions
+        bool timed(facter::facts::collection& facts, std::string const& timing_name, std::function<void()> const& callback, double timeout = 0);
 
         VALUE _self;
         VALUE _name;
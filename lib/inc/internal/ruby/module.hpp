@@ -6,9 +6,12 @@
 
 #include "api.hpp"
 #include "fact.hpp"
+#include <atomic>
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace facter { namespace facts {
 
@@ -33,23 +36,53 @@ namespace facter { namespace ruby {
          * Constructs the Ruby Facter module.
          * @param facts The collection of facts to populate.
          * @param paths The search paths for loading custom facts.
+         * @param cache_directory The directory to cache the compiled instruction sequences of custom fact files in or empty to not cache them.
          */
-        module(facter::facts::collection& facts, std::vector<std::string> const& paths = {});
+        module(facter::facts::collection& facts, std::vector<std::string> const& paths = {}, std::string cache_directory = {});
 
         /**
          * Destructs the Facter module.
          */
         ~module();
 
+        /**
+         * Determines, without loading Ruby, whether custom facts may define any of the queried facts.
+         * This is only known from a current manifest in the cache directory; the directories on Ruby's load path
+         * are assumed to be those that were searched when the manifest was written.
+         * @param cache_directory The directory the manifest of custom facts was saved in.
+         * @param paths The custom fact directories that will be searched in addition to FACTERLIB and Ruby's load path.
+         * @param queries The queries to resolve.
+         * @return Returns false if the manifest shows that no custom fact file defines a queried fact or true if one may.
+         */
+        static bool may_define(std::string const& cache_directory, std::vector<std::string> const& paths, std::set<std::string> const& queries);
+
         /**
          * Loads all custom facts.
          */
         void load_facts();
 
         /**
-         * Resolves all custom facts.
+         * Resolves custom facts.
+         * With a cache directory, the manifest of the custom facts defined by each file is used to load only the files
+         * that define the queried facts; without it or a current manifest, every custom fact is loaded and resolved.
+         * @param queries The queries (e.g. "foo.bar") of the facts to resolve; if empty, every custom fact is resolved.
+         */
+        void resolve_facts(std::set<std::string> const& queries = {});
+
+        /**
+         * Sets the number of worker processes to resolve custom facts in.
+         * When resolving every custom fact, the facts are divided between workers forked once the native facts are
+         * resolved; their values are returned in the MessagePack format. This is not supported on Windows.
+         * @param count The number of worker processes; 0 or 1 resolves custom facts in this process.
+         */
+        void workers(unsigned int count);
+
+        /**
+         * Sets whether Ruby's garbage collector is disabled while custom facts are loaded and resolved.
+         * The collector is enabled again once resolve_facts returns; memory use grows in the meantime.
+         * @param disable True to disable the garbage collector while resolving or false to leave it enabled.
          */
-        void resolve_facts();
+        void disable_gc(bool disable);
 
         /**
          * Clears the facts.
@@ -66,11 +99,32 @@ namespace facter { namespace ruby {
 
         /**
          * Normalizes the given fact name.
+         * The normalized name of each symbol and string is remembered, and is frozen as it is shared.
          * @param name The fact name to normalize.
          * @return Returns the normalized fact name.
          */
         VALUE normalize(VALUE name) const;
 
+        /**
+         * Gets the memoized result of a confine.
+         * @param key The key of the confine (its normalized fact name and expected values).
+         * @return Returns true or false if the confine was evaluated since the facts were last flushed or nil if it was not.
+         */
+        VALUE confine_result(VALUE key) const;
+
+        /**
+         * Memoizes the result of a confine until the facts are flushed.
+         * @param key The key of the confine (its normalized fact name and expected values).
+         * @param suitable True if the confine is suitable or false if not.
+         */
+        void confine_result(VALUE key, bool suitable);
+
+        /**
+         * Discards the hash of every fact built for to_hash and each.
+         * Called when a fact is defined or flushed; changes to the collection discard the hash on their own.
+         */
+        void invalidate_hash();
+
         /**
          * Gets the collection associated with the module.
          * @return Returns the collection associated with the Facter module.
@@ -113,17 +167,26 @@ namespace facter { namespace ruby {
         static VALUE ruby_which(VALUE self, VALUE binary);
         static VALUE ruby_exec(VALUE self, VALUE command);
         static VALUE ruby_execute(int argc, VALUE* argv, VALUE self);
+        static VALUE ruby_execute_all(int argc, VALUE* argv, VALUE self);
         static VALUE ruby_on_message(VALUE self);
 
         // Helper functions
         static module* from_self(VALUE self);
         static VALUE execute_command(std::string const& command, VALUE failure_default, bool raise);
+        static void raise_timed_out(char const* command);
 
         void initialize_search_paths(std::vector<std::string> const& paths);
         VALUE load_fact(VALUE value);
         void load_file(std::string const& path);
+        VALUE load_compiled(std::string const& path);
+        std::map<std::string, std::vector<std::string>> const* manifest();
+        void save_manifest();
+        void add_definition(VALUE name);
         VALUE create_fact(VALUE name);
+        void resolve_in_workers();
+        void run_worker(std::vector<std::string> const& names, VALUE writer);
         static VALUE level_to_symbol(leatherman::logging::log_level level);
+        VALUE fact_hash();
 
         facter::facts::collection& _collection;
         std::map<std::string, VALUE> _facts;
@@ -133,10 +196,26 @@ namespace facter { namespace ruby {
         std::vector<std::string> _additional_search_paths;
         std::vector<std::string> _external_search_paths;
         std::set<std::string> _loaded_files;
+        std::string _cache_directory;
+        std::vector<std::string> _loading;
+        std::map<std::string, std::set<std::string>> _definitions;
+        std::map<std::string, std::vector<std::string>> _manifest;
+        std::vector<std::string> _manifest_paths;
+        bool _manifest_checked;
+        bool _manifest_valid;
         bool _loaded_all;
+        unsigned int _workers;
+        bool _disable_gc;
         VALUE _self;
         VALUE _previous_facter;
         VALUE _on_message_block;
+        VALUE _confine_results;
+        VALUE _hash;
+        std::vector<std::pair<VALUE, VALUE>> _hash_entries;
+        std::atomic<bool> _hash_stale;
+        size_t _subscription;
+        VALUE _normalized_names;
+        mutable size_t _normalized_count;
 
         static std::map<VALUE, module*> _instances;
     };
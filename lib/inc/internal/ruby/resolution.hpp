@@ -6,8 +6,9 @@
 
 #include "api.hpp"
 #include "confine.hpp"
-#include <vector>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace facter { namespace facts {
 
@@ -49,6 +50,30 @@ namespace facter { namespace ruby {
          */
         void weight(size_t weight);
 
+        /**
+         * Gets the number of seconds the resolution is allowed to run for.
+         * @return Returns the timeout of the resolution in seconds or 0 if the resolution has no timeout.
+         */
+        double timeout() const;
+
+        /**
+         * Sets the number of seconds the resolution is allowed to run for.
+         * @param seconds The timeout of the resolution in seconds or 0 for no timeout.
+         */
+        void timeout(double seconds);
+
+        /**
+         * Gets the name that the time spent resolving the resolution is recorded under.
+         * @return Returns the timing name of the resolution.
+         */
+        std::string const& timing_name() const;
+
+        /**
+         * Sets the name that the time spent resolving the resolution is recorded under.
+         * @param name The timing name of the resolution.
+         */
+        void timing_name(std::string name);
+
         /**
          * Gets the value of the resolution.
          * @return Returns the value of the resolution or nil if the value did not resolve.
@@ -121,6 +146,8 @@ namespace facter { namespace ruby {
         std::vector<ruby::confine> _confines;
         bool _has_weight;
         size_t _weight;
+        double _timeout;
+        std::string _timing_name;
     };
 
 }}  // namespace facter::ruby
@@ -73,6 +73,16 @@ namespace facter { namespace ruby {
           */
         virtual YAML::Emitter& write(YAML::Emitter& emitter) const override;
 
+        /**
+         * Estimates the memory used by the value.
+         * The Ruby object is owned by Ruby's heap, so only the reference to it is counted.
+         * @return Returns the approximate number of bytes used by the value.
+         */
+        virtual size_t memory_usage() const override
+        {
+            return sizeof(ruby_value);
+        }
+
         /**
          * Gets the Ruby value.
          * @return Returns the Ruby value.
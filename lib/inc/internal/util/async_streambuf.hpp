@@ -0,0 +1,98 @@
+/**
+ * @file
+ * Declares the stream buffer that writes to another stream on a dedicated thread.
+ */
+#pragma once
+
+#include <boost/lockfree/queue.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * A stream buffer that hands complete lines to a writer thread, which writes them to a target stream.
+     * Each thread gathers its own partial line; a line is queued when it ends or the stream is flushed.
+     * The queue is a bounded lock-free ring, so threads writing lines never wait on the target stream or on each other;
+     * a thread only waits when the ring is full and the writer has fallen behind.
+     */
+    struct async_streambuf : std::streambuf
+    {
+        /**
+         * Constructs the stream buffer and starts its writer thread.
+         * @param target The stream to write lines to; it must outlive the stream buffer.
+         * @param capacity The number of lines the ring can hold before writing threads wait.
+         * @param format The function to rewrite each line with before it is queued; it is called on the thread that wrote the line.
+         */
+        explicit async_streambuf(std::ostream& target, size_t capacity = 1024, std::function<void(std::string&)> format = nullptr);
+
+        /**
+         * Writes any queued lines and stops the writer thread.
+         */
+        ~async_streambuf();
+
+        /**
+         * Prevents the stream buffer from being copied.
+         */
+        async_streambuf(async_streambuf const&) = delete;
+
+        /**
+         * Prevents the stream buffer from being copied.
+         * @returns Returns this stream buffer.
+         */
+        async_streambuf& operator=(async_streambuf const&) = delete;
+
+        /**
+         * Waits until every line queued so far has been written to the target stream.
+         */
+        void drain();
+
+     protected:
+        /**
+         * Appends a character to the calling thread's line.
+         * @param c The character to append.
+         * @return Returns the character or EOF if it could not be written.
+         */
+        virtual int_type overflow(int_type c) override;
+
+        /**
+         * Appends characters to the calling thread's line.
+         * @param s The characters to append.
+         * @param n The number of characters to append.
+         * @return Returns the number of characters appended.
+         */
+        virtual std::streamsize xsputn(char const* s, std::streamsize n) override;
+
+        /**
+         * Queues the calling thread's partial line.
+         * @return Returns 0 on success.
+         */
+        virtual int sync() override;
+
+     private:
+        std::string& line();
+        void push(std::string* text);
+        void write();
+
+        std::ostream& _target;
+        std::function<void(std::string&)> _format;
+        boost::lockfree::queue<std::string*> _queue;
+        boost::thread_specific_ptr<std::string> _line;
+        std::atomic<uint64_t> _queued;
+        std::atomic<uint64_t> _written;
+        std::atomic<bool> _sleeping;
+        std::atomic<bool> _stopping;
+        boost::mutex _mutex;
+        boost::condition_variable _wake;
+        boost::condition_variable _drained;
+        boost::thread _writer;
+    };
+
+}}  // namespace facter::util
@@ -0,0 +1,70 @@
+/**
+ * @file
+ * Declares the snapshot of sysctl values used while resolving facts.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace facter { namespace util { namespace bsd {
+
+    /**
+     * Reads sysctl values by name and remembers them for the lifetime of the snapshot.
+     * A snapshot is meant to live for one resolve, so a value read by more than one part of a resolver is only read once.
+     * The translation of names to MIBs is shared by all snapshots and done once per name for the life of the process.
+     * A snapshot is not thread-safe; give each resolving thread its own.
+     */
+    struct sysctl_snapshot
+    {
+        /**
+         * Gets the raw value of a sysctl.
+         * @param name The name of the sysctl (e.g. "hw.memsize").
+         * @return Returns the value or nullptr if the sysctl does not exist or could not be read.
+         */
+        std::vector<char> const* get(std::string const& name);
+
+        /**
+         * Gets the value of a string sysctl.
+         * @param name The name of the sysctl (e.g. "kern.osrelease").
+         * @param value Receives the value, without the terminating null.
+         * @return Returns true if the value was read or false if not.
+         */
+        bool get_string(std::string const& name, std::string& value);
+
+        /**
+         * Gets the value of an integer sysctl that is either 32 or 64 bits wide.
+         * @param name The name of the sysctl (e.g. "hw.physicalcpu").
+         * @param value Receives the value.
+         * @return Returns true if the value was read or false if not.
+         */
+        bool get_integer(std::string const& name, uint64_t& value);
+
+        /**
+         * Gets the value of a sysctl that is a fixed-size structure (e.g. the timeval of "kern.boottime").
+         * @tparam T The type of the structure.
+         * @param name The name of the sysctl.
+         * @param value Receives the value.
+         * @return Returns true if the value was read and is the size of the structure or false if not.
+         */
+        template <typename T>
+        bool get_struct(std::string const& name, T& value)
+        {
+            auto raw = get(name);
+            if (!raw || raw->size() != sizeof(T)) {
+                return false;
+            }
+            memcpy(&value, raw->data(), sizeof(T));
+            return true;
+        }
+
+     private:
+        std::map<std::string, std::vector<char>> _values;
+        std::set<std::string> _missing;
+    };
+
+}}}  // namespace facter::util::bsd
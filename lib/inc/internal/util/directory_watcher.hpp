@@ -0,0 +1,57 @@
+/**
+ * @file
+ * Declares the directory watcher for finding the files that changed in a set of directories.
+ */
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace facter { namespace util {
+
+    /**
+     * Watches directories for files that are created, modified, or removed.
+     * Where the platform can't watch directories (or on Linux, without inotify), changes are never known and the
+     * directories have to be scanned to find them.
+     */
+    struct directory_watcher
+    {
+        /**
+         * Starts watching the given directories.
+         * Only the files directly in each directory are watched; subdirectories are not.
+         * @param directories The directories to watch.
+         */
+        explicit directory_watcher(std::vector<std::string> const& directories);
+
+        /**
+         * Stops watching the directories.
+         */
+        ~directory_watcher();
+
+        /**
+         * Prevents the watcher from being copied.
+         */
+        directory_watcher(directory_watcher const&) = delete;
+
+        /**
+         * Prevents the watcher from being copied.
+         * @returns Returns this watcher.
+         */
+        directory_watcher& operator=(directory_watcher const&) = delete;
+
+        /**
+         * Gets the paths of the files that were created, modified, or removed since the watcher was started or
+         * this was last called.
+         * @param paths Receives the paths of the changed files.
+         * @return Returns true if the changes are known or false if the directories must be scanned to find them
+         *         (e.g. the directories can't be watched or changes were lost).
+         */
+        bool changes(std::set<std::string>& paths);
+
+     private:
+        int _descriptor;
+        std::vector<std::pair<int, std::string>> _watches;
+    };
+
+}}  // namespace facter::util
@@ -24,6 +24,8 @@ namespace facter { namespace util {
 
     /**
      * Represents a dynamic library.
+     * Loading and finding libraries is thread-safe, but an instance is not synchronized: it must not be loaded or closed
+     * on one thread while another thread uses it.
      */
     struct dynamic_library
     {
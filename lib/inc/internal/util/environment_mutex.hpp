@@ -0,0 +1,20 @@
+/**
+ * @file
+ * Declares the lock that serializes access to the process environment.
+ */
+#pragma once
+
+#include <boost/thread/shared_mutex.hpp>
+
+namespace facter { namespace util {
+
+    /**
+     * Gets the lock that serializes access to the process environment.
+     * Reading the environment (getenv or environ) while another thread changes it (setenv or unsetenv) is undefined,
+     * so code that reads the environment holds this lock shared and code that changes it holds it exclusively.
+     * environment::get, set, clear, and each take it; code reading environ directly must take it itself.
+     * @return Returns the environment lock.
+     */
+    boost::shared_mutex& environment_mutex();
+
+}}  // namespace facter::util
@@ -0,0 +1,75 @@
+/**
+ * @file
+ * Declares the snapshot of the FreeBSD GEOM tree.
+ */
+#pragma once
+
+#include <functional>
+#include <string>
+
+struct gmesh;
+struct gprovider;
+struct ggeom;
+
+namespace facter { namespace util { namespace freebsd {
+
+    /**
+     * A snapshot of the GEOM tree of classes, geoms, and providers (the kern.geom.confxml sysctl) read with libgeom.
+     * The whole tree is read once, so walking disks, partitions, and labels does not run gpart or glabel for each disk.
+     */
+    struct geom_tree
+    {
+        /**
+         * Reads the GEOM tree.
+         */
+        geom_tree();
+
+        /**
+         * Frees the GEOM tree.
+         */
+        ~geom_tree();
+
+        /**
+         * Prevents the tree from being copied.
+         */
+        geom_tree(geom_tree const&) = delete;
+
+        /**
+         * Prevents the tree from being copied.
+         * @returns Returns this tree.
+         */
+        geom_tree& operator=(geom_tree const&) = delete;
+
+        /**
+         * Determines if the tree was read.
+         * @return Returns true if the tree was read or false if not.
+         */
+        bool is_open() const;
+
+        /**
+         * Calls the given callback for each geom of a class (e.g. "DISK", "PART", or "LABEL").
+         * @param class_name The name of the GEOM class.
+         * @param callback The callback to call with each geom; return false to stop.
+         */
+        void each_geom(std::string const& class_name, std::function<bool(ggeom const&)> const& callback) const;
+
+        /**
+         * Calls the given callback for each provider of a class (e.g. "ada0" of "DISK" or "ada0p2" of "PART").
+         * @param class_name The name of the GEOM class.
+         * @param callback The callback to call with each provider; return false to stop.
+         */
+        void each_provider(std::string const& class_name, std::function<bool(gprovider const&)> const& callback) const;
+
+        /**
+         * Gets a configuration value of a provider (e.g. "descr" of a disk or "rawuuid" of a partition).
+         * @param provider The provider to get the value of.
+         * @param name The name of the configuration value.
+         * @return Returns the value or an empty string if the provider has no such value.
+         */
+        static std::string config(gprovider const& provider, std::string const& name);
+
+     private:
+        gmesh* _mesh;
+    };
+
+}}}  // namespace facter::util::freebsd
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * Declares the io_uring submission ring used to read many small files at once.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace facter { namespace util { namespace linux {
+
+    /**
+     * An io_uring instance for reading many small files (e.g. sysfs attributes) with a few system calls.
+     * Every file is opened, then every file is read, then every file is closed, each with a single io_uring_enter
+     * rather than a system call per file. Each thread has its own ring.
+     */
+    struct io_ring
+    {
+        /**
+         * Gets the calling thread's ring, creating it on first use.
+         * @return Returns the ring or nullptr if io_uring or the operations it needs (Linux 5.6 or later) are unavailable.
+         */
+        static io_ring* instance();
+
+        /**
+         * Frees the ring.
+         */
+        ~io_ring();
+
+        /**
+         * Prevents the ring from being copied.
+         */
+        io_ring(io_ring const&) = delete;
+
+        /**
+         * Prevents the ring from being copied.
+         * @returns Returns this ring.
+         */
+        io_ring& operator=(io_ring const&) = delete;
+
+        /**
+         * Reads many files relative to a directory.
+         * The values are not trimmed; files that can't be read are set to empty strings.
+         * @param directory The descriptor of the directory the file names are relative to.
+         * @param files The pairs of file names and the strings that receive their contents.
+         * @param count The number of files to read.
+         * @return Returns true if the files were read or false if the ring failed and the files must be read another way.
+         */
+        bool read_files(int directory, std::pair<char const*, std::string*> const* files, size_t count);
+
+     private:
+        io_ring();
+        bool open();
+        io_uring_sqe* next(uint8_t opcode, int fd, uint64_t user_data);
+        bool run(std::vector<int>& results);
+
+        int _fd;
+        void* _sq_ring;
+        size_t _sq_ring_size;
+        void* _cq_ring;
+        size_t _cq_ring_size;
+        io_uring_sqe* _sqes;
+        size_t _sqes_size;
+        unsigned* _sq_tail;
+        unsigned* _sq_array;
+        unsigned _sq_mask;
+        unsigned _entries;
+        unsigned* _cq_head;
+        unsigned* _cq_tail;
+        unsigned _cq_mask;
+        io_uring_cqe* _cqes;
+        unsigned _pending;
+        bool _failed;
+        std::vector<int> _descriptors;
+        std::vector<int> _results;
+        std::vector<char> _buffer;
+    };
+
+}}}  // namespace facter::util::linux
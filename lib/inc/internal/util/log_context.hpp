@@ -0,0 +1,103 @@
+/**
+ * @file
+ * Declares the context that structured log messages are tagged with.
+ */
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * Stores what the logging thread is working on: the resolver, and the child process or HTTP request it is waiting on.
+     */
+    struct log_context
+    {
+        /**
+         * Constructs an empty log context.
+         */
+        log_context();
+
+        /**
+         * Stores the name of the resolver being resolved, or an empty string if none.
+         */
+        std::string resolver;
+
+        /**
+         * Stores the time the resolver started resolving.
+         */
+        std::chrono::steady_clock::time_point start;
+
+        /**
+         * Stores the process identifier of the child process being waited on, or 0 if none.
+         */
+        long pid;
+
+        /**
+         * Stores the URL of the HTTP request being made, or an empty string if none.
+         */
+        std::string url;
+    };
+
+    /**
+     * This is an RAII type for setting the log context of the calling thread.
+     * The enclosing context, if any, is restored on destruction.
+     */
+    struct scoped_log_context
+    {
+        /**
+         * Constructs a scoped_log_context and makes the given context current on the calling thread.
+         * @param context The context to make current.
+         */
+        explicit scoped_log_context(log_context context);
+
+        /**
+         * Restores the enclosing context.
+         */
+        ~scoped_log_context();
+
+        /**
+         * Prevents the scope from being copied.
+         */
+        scoped_log_context(scoped_log_context const&) = delete;
+
+        /**
+         * Prevents the scope from being copied.
+         * @returns Returns this scope.
+         */
+        scoped_log_context& operator=(scoped_log_context const&) = delete;
+
+        /**
+         * Gets the calling thread's current context.
+         * @return Returns the current context or nullptr if there is none.
+         */
+        static log_context const* get();
+
+        /**
+         * Makes a context for resolving the given resolver, starting now.
+         * @param resolver The name of the resolver.
+         * @return Returns the context.
+         */
+        static log_context for_resolver(std::string resolver);
+
+        /**
+         * Makes a context for waiting on a child process within the current context.
+         * @param pid The process identifier of the child process.
+         * @return Returns the context.
+         */
+        static log_context for_child(long pid);
+
+        /**
+         * Makes a context for making a HTTP request within the current context.
+         * @param url The URL being requested.
+         * @return Returns the context.
+         */
+        static log_context for_url(std::string url);
+
+     private:
+        log_context _context;
+        scoped_log_context* _previous;
+    };
+
+}}  // namespace facter::util
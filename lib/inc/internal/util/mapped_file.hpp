@@ -0,0 +1,67 @@
+/**
+ * @file
+ * Declares the memory-mapped file for reading files without copying them into memory.
+ */
+#pragma once
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * This is an RAII type for mapping the contents of a file into memory.
+     * The mapping is private: the contents may be modified in place (e.g. to parse them in situ),
+     * but the modifications are never written to the file and are discarded when the mapping is destroyed.
+     * While a fact collection with an alternate root directory is resolving, absolute paths are mapped from beneath the root.
+     */
+    struct mapped_file
+    {
+        /**
+         * Maps the given file into memory.
+         * @param path The path of the file to map.
+         */
+        explicit mapped_file(std::string const& path);
+
+        /**
+         * Prevents the mapping from being copied.
+         */
+        mapped_file(mapped_file const&) = delete;
+
+        /**
+         * Prevents the mapping from being copied.
+         * @returns Returns this mapping.
+         */
+        mapped_file& operator=(mapped_file const&) = delete;
+
+        /**
+         * Determines if the file was mapped.
+         * An empty file is mapped with no contents.
+         * @return Returns true if the file was mapped or false if it could not be opened.
+         */
+        bool is_open() const;
+
+        /**
+         * Gets the beginning of the mapped contents.
+         * @return Returns a pointer to the first character of the file.
+         */
+        char* begin();
+
+        /**
+         * Gets the end of the mapped contents.
+         * @return Returns a pointer past the last character of the file.
+         */
+        char* end();
+
+        /**
+         * Gets the size of the mapped contents.
+         * @return Returns the size of the file, in bytes.
+         */
+        size_t size() const;
+
+     private:
+        boost::iostreams::mapped_file _file;
+        bool _open;
+    };
+
+}}  // namespace facter::util
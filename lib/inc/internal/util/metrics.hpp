@@ -0,0 +1,45 @@
+/**
+ * @file
+ * Declares the process-wide metrics recorded while resolving facts.
+ */
+#pragma once
+
+#include <string>
+
+namespace facter { namespace util {
+
+    struct statistics;
+
+    /**
+     * Records the process-wide metrics written by write_metrics.
+     * Unlike statistics, which are recorded for the resolver on the calling thread, metrics accumulate for the
+     * lifetime of the process (e.g. across the refreshes of a daemon).
+     */
+    struct metrics
+    {
+        /**
+         * Records the resolution of a resolver.
+         * @param name The name of the resolver.
+         * @param stats The statistics recorded while resolving.
+         */
+        static void record_resolution(std::string const& name, statistics const& stats);
+
+        /**
+         * Records a lookup in a cache.
+         * @param cache The name of the cache (e.g. "facts"); it must be a string literal.
+         * @param hit True if the lookup was answered from the cache or false if it was not.
+         */
+        static void record_cache_lookup(char const* cache, bool hit);
+
+        /**
+         * Records that a child process was spawned.
+         */
+        static void record_process();
+
+        /**
+         * Records that a HTTP request was made.
+         */
+        static void record_http_request();
+    };
+
+}}  // namespace facter::util
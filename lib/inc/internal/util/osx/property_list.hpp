@@ -0,0 +1,20 @@
+/**
+ * @file
+ * Declares the property list reader.
+ */
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace facter { namespace util { namespace osx {
+
+    /**
+     * Reads the string values of a property list file whose top-level object is a dictionary
+     * (e.g. /System/Library/CoreServices/SystemVersion.plist). Values of other types are skipped.
+     * @param path The path of the property list file; both XML and binary property lists are supported.
+     * @return Returns the string values by key, or an empty map if the file cannot be read.
+     */
+    std::map<std::string, std::string> read_property_list(std::string const& path);
+
+}}}  // namespace facter::util::osx
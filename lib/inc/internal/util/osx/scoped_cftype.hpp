@@ -0,0 +1,51 @@
+/**
+ * @file
+ * Declares the scoped Core Foundation object resource and Core Foundation string conversion.
+ */
+#pragma once
+
+#include <facter/util/scoped_resource.hpp>
+#include <CoreFoundation/CoreFoundation.h>
+#include <string>
+
+namespace facter { namespace util { namespace osx {
+
+    /**
+     * Represents a scoped Core Foundation object that is released when it goes out of scope.
+     * Use this for objects returned by "Create" or "Copy" functions.
+     */
+    struct scoped_cftype : scoped_resource<CFTypeRef>
+    {
+        /**
+         * Constructs a scoped_cftype.
+         * @param ref The object to release when destroyed; may be nullptr.
+         */
+        explicit scoped_cftype(CFTypeRef ref);
+
+        /**
+         * Gets the object as the given type if it is of that type.
+         * @tparam T The Core Foundation reference type (e.g. CFStringRef).
+         * @param type_id The type identifier of T (e.g. CFStringGetTypeID()).
+         * @return Returns the object or nullptr if there is no object or it is of a different type.
+         */
+        template <typename T>
+        T as(CFTypeID type_id) const
+        {
+            if (!_resource || CFGetTypeID(_resource) != type_id) {
+                return nullptr;
+            }
+            return static_cast<T>(_resource);
+        }
+
+     private:
+        static void release(CFTypeRef ref);
+    };
+
+    /**
+     * Converts a Core Foundation string to a UTF-8 string.
+     * @param str The string to convert; may be nullptr.
+     * @return Returns the UTF-8 string or an empty string if the string is nullptr or cannot be converted.
+     */
+    std::string to_utf8(CFStringRef str);
+
+}}}  // namespace facter::util::osx
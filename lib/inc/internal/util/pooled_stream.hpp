@@ -0,0 +1,69 @@
+/**
+ * @file
+ * Declares the output stream that reuses its storage across uses on a thread.
+ */
+#pragma once
+
+#include <ostream>
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * This is an RAII type for formatting output into storage that is reused.
+     * Each thread keeps a small pool of buffers; a pooled_stream takes a buffer from the pool
+     * when constructed and returns it, cleared but with its capacity intact, when destroyed.
+     * Unlike an ostringstream, formatting into a pooled_stream allocates only when the output
+     * outgrows every output previously formatted on the thread.
+     */
+    struct pooled_stream
+    {
+        /**
+         * Constructs a pooled_stream with an empty buffer from the calling thread's pool.
+         */
+        pooled_stream();
+
+        /**
+         * Returns the buffer to the calling thread's pool.
+         */
+        ~pooled_stream();
+
+        /**
+         * Prevents the stream from being copied.
+         */
+        pooled_stream(pooled_stream const&) = delete;
+
+        /**
+         * Prevents the stream from being copied.
+         * @returns Returns this stream.
+         */
+        pooled_stream& operator=(pooled_stream const&) = delete;
+
+        /**
+         * Gets the output stream to format into.
+         * @return Returns the output stream.
+         */
+        std::ostream& stream();
+
+        /**
+         * Gets the output formatted so far.
+         * @return Returns the output formatted so far.
+         */
+        std::string const& str() const;
+
+        /**
+         * Writes the output formatted so far to the given stream and clears the buffer.
+         * @param os The stream to write to.
+         */
+        void flush_to(std::ostream& os);
+
+        /**
+         * The buffer storage; defined in pooled_stream.cc.
+         */
+        struct buffer;
+
+     private:
+        buffer* _buffer;
+    };
+
+}}  // namespace facter::util
@@ -0,0 +1,72 @@
+/**
+ * @file
+ * Declares the reader for small attribute files such as those in /sys.
+ */
+#pragma once
+
+#include "scoped_descriptor.hpp"
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+namespace facter { namespace util { namespace posix {
+
+    /**
+     * Reads small attribute files (e.g. /sys/block/sda/size) relative to an open directory.
+     * Opening each file relative to the directory skips resolving the directory's path again, and an attribute
+     * is read with a single read() call, so each attribute costs an open, a read, and a close.
+     * While a fact collection with an alternate root directory is resolving, absolute paths are opened beneath the root.
+     */
+    struct attribute_reader
+    {
+        /**
+         * Opens the given directory.
+         * @param directory The path of the directory to read attributes from.
+         */
+        explicit attribute_reader(std::string const& directory);
+
+        /**
+         * Opens a subdirectory of another reader's directory.
+         * @param parent The reader of the parent directory.
+         * @param subdirectory The path of the subdirectory, relative to the parent directory.
+         */
+        attribute_reader(attribute_reader const& parent, std::string const& subdirectory);
+
+        /**
+         * Determines if the directory was opened.
+         * @return Returns true if the directory was opened or false if it does not exist or could not be opened.
+         */
+        bool is_open() const;
+
+        /**
+         * Reads an attribute in the directory.
+         * @param name The path of the attribute file, relative to the directory.
+         * @param value Receives the value of the attribute, trimmed of surrounding whitespace.
+         * @return Returns true if the attribute was read and is not empty or false if not.
+         */
+        bool read(char const* name, std::string& value) const;
+
+        /**
+         * Reads many attributes in the directory.
+         * Attributes that can't be read are set to empty strings.
+         * @param attributes The pairs of attribute file names and the strings that receive their values.
+         * @return Returns the number of attributes that were read and are not empty.
+         */
+        size_t read(std::initializer_list<std::pair<char const*, std::string*>> attributes) const;
+
+        /**
+         * Reads an attribute file at the given path.
+         * @param path The path of the attribute file.
+         * @param value Receives the value of the attribute, trimmed of surrounding whitespace.
+         * @return Returns true if the attribute was read and is not empty or false if not.
+         */
+        static bool read_file(std::string const& path, std::string& value);
+
+     private:
+        explicit attribute_reader(int directory);
+        static bool read_at(int directory, char const* name, std::string& value);
+
+        scoped_descriptor _directory;
+    };
+
+}}}  // namespace facter::util::posix
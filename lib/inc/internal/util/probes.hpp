@@ -0,0 +1,26 @@
+/**
+ * @file
+ * Declares the static probes that dtrace, systemtap, and bpftrace can attach to in a running process.
+ */
+#pragma once
+
+/*
+ * The probes are in the "facter" provider:
+ *   resolver__start(name), resolver__end(name, abandoned)
+ *   exec__start(executable), exec__spawn(executable, pid, error), exec__wait(pid), exec__end(pid, status)
+ *   http__start(method, url), http__end(method, url, status)
+ *   fact__add(name)
+ *
+ * Strings are passed as pointers to null-terminated strings and are only valid while the probe fires.
+ * Without USE_USDT the probes expand to nothing, so their arguments aren't evaluated.
+ */
+#ifdef USE_USDT
+#include <sys/sdt.h>
+#define FACTER_PROBE1(name, a1) DTRACE_PROBE1(facter, name, a1)
+#define FACTER_PROBE2(name, a1, a2) DTRACE_PROBE2(facter, name, a1, a2)
+#define FACTER_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(facter, name, a1, a2, a3)
+#else
+#define FACTER_PROBE1(name, a1)
+#define FACTER_PROBE2(name, a1, a2)
+#define FACTER_PROBE3(name, a1, a2, a3)
+#endif  // USE_USDT
@@ -0,0 +1,75 @@
+/**
+ * @file
+ * Declares the reader for files of lines such as those in /proc.
+ */
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * Reads a file of lines (e.g. /proc/meminfo or /proc/cpuinfo) into a single buffer and splits it in place.
+     * Files in /proc report no size and cannot be mapped, so the file is read in one pass; the lines, keys, values,
+     * and fields passed to callbacks refer into the buffer and are only valid while the proc_file exists.
+     * While a fact collection with an alternate root directory is resolving, absolute paths are read from beneath the root.
+     */
+    struct proc_file
+    {
+        /**
+         * Reads the given file.
+         * @param path The path of the file to read.
+         */
+        explicit proc_file(std::string const& path);
+
+        /**
+         * Determines if the file was read.
+         * @return Returns true if the file was read or false if it could not be opened.
+         */
+        bool is_open() const;
+
+        /**
+         * Calls the given callback for each line of the file, without the line ending.
+         * @param callback The callback to call with each line; return false to stop.
+         */
+        void each_line(std::function<bool(boost::string_ref line)> const& callback) const;
+
+        /**
+         * Calls the given callback for each line of the file that contains a separator (e.g. "MemTotal: 1024 kB").
+         * The key and value are trimmed of surrounding whitespace.
+         * @param callback The callback to call with the key and value of each line; return false to stop.
+         * @param separator The character separating the key from the value.
+         */
+        void each_value(std::function<bool(boost::string_ref key, boost::string_ref value)> const& callback, char separator = ':') const;
+
+        /**
+         * Removes the next whitespace-delimited field from the front of the given text.
+         * @param text The text to remove the field from.
+         * @return Returns the field or an empty string if there are no more fields.
+         */
+        static boost::string_ref next_field(boost::string_ref& text);
+
+        /**
+         * Trims the given text of surrounding whitespace.
+         * @param text The text to trim.
+         * @return Returns the trimmed text.
+         */
+        static boost::string_ref trim(boost::string_ref text);
+
+        /**
+         * Parses the leading decimal digits of the given text (e.g. "1024 kB").
+         * @param text The text to parse.
+         * @param value Receives the parsed value.
+         * @return Returns true if the text starts with a digit or false if not.
+         */
+        static bool to_uint64(boost::string_ref text, uint64_t& value);
+
+     private:
+        std::string _contents;
+        bool _open;
+    };
+
+}}  // namespace facter::util
@@ -6,9 +6,51 @@
 
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
+#include <string>
 
 namespace facter { namespace util {
 
+    /**
+     * Gets the compiled regular expression for the given pattern.
+     * Each distinct pattern and set of flags is compiled once per process; later calls return the same expression.
+     * Throws boost::regex_error if the pattern is not a valid regular expression.
+     * @param pattern The pattern to compile.
+     * @param flags The flags to compile the pattern with.
+     * @return Returns the compiled regular expression, which lives for the rest of the process.
+     */
+    boost::regex const& cached_regex(std::string const& pattern, boost::regex::flag_type flags = boost::regex::normal);
+
+    /**
+     * Determines if the given pattern is a literal: it has no regular expression syntax, so it is found wherever the text contains it.
+     * @param pattern The pattern to check.
+     * @return Returns true if the pattern is a literal or false if it must be compiled.
+     */
+    bool is_literal_pattern(std::string const& pattern);
+
+    /**
+     * Searches text for a pattern: a literal pattern is found with a substring search and any other pattern with a cached compiled expression.
+     */
+    struct pattern_matcher
+    {
+        /**
+         * Constructs a matcher for the given pattern.
+         * Throws boost::regex_error if the pattern is not a valid regular expression.
+         * @param pattern The pattern to search for.
+         */
+        explicit pattern_matcher(std::string pattern);
+
+        /**
+         * Searches the given text for the pattern.
+         * @param text The text to search.
+         * @return Returns true if the text contains a match of the pattern or false if not.
+         */
+        bool search(std::string const& text) const;
+
+     private:
+        std::string _literal;
+        boost::regex const* _regex;
+    };
+
     /**
      * Helper function for resolving variadic arguments to re_search.
      * @tparam Text The type of the text to search.
@@ -0,0 +1,196 @@
+/**
+ * @file
+ * Declares the log that records the commands and HTTP requests of a run so that tests and benchmarks can replay them.
+ */
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace facter { namespace util {
+
+    /**
+     * The modes of a replay log.
+     */
+    enum class replay_mode
+    {
+        /**
+         * Commands are executed and requests are made; their results are added to the log.
+         */
+        record,
+        /**
+         * Commands and requests are answered from the log rather than executed or made.
+         */
+        replay
+    };
+
+    /**
+     * The recorded result of a command or HTTP request.
+     */
+    struct replay_entry
+    {
+        /**
+         * Constructs an empty entry.
+         */
+        replay_entry();
+
+        /**
+         * The exit status or signal of a command, or the status code of an HTTP response.
+         */
+        int status;
+
+        /**
+         * Whether or not a command was terminated by a signal.
+         */
+        bool signaled;
+
+        /**
+         * The output of a command or the body of an HTTP response.
+         */
+        std::string output;
+
+        /**
+         * The headers of an HTTP response.
+         */
+        std::vector<std::pair<std::string, std::string>> headers;
+
+        /**
+         * The message of the error that failed an HTTP request, or empty if a response was received.
+         */
+        std::string error;
+
+        /**
+         * The time the command or request took when it was recorded.
+         */
+        std::chrono::milliseconds elapsed;
+    };
+
+    /**
+     * A log of the results of the commands executed and the HTTP requests made during a run.
+     * A log recorded on a real host is saved to a fixture file; replaying it answers the same commands and requests
+     * without the host, taking as long as they took when recorded (or a configured multiple of that).
+     * A log is installed for the whole process with scoped_replay_log, as resolvers run on the threads of the pool.
+     */
+    struct replay_log
+    {
+        /**
+         * Constructs an empty log.
+         * @param mode The mode of the log.
+         */
+        explicit replay_log(replay_mode mode);
+
+        /**
+         * Prevents the log from being copied.
+         */
+        replay_log(replay_log const&) = delete;
+
+        /**
+         * Prevents the log from being copied.
+         * @returns Returns this log.
+         */
+        replay_log& operator=(replay_log const&) = delete;
+
+        /**
+         * Gets the mode of the log.
+         * @return Returns the mode of the log.
+         */
+        replay_mode mode() const;
+
+        /**
+         * Sets the latency added to replayed entries.
+         * An entry replays after its recorded time multiplied by the scale, plus the extra time.
+         * @param scale The multiple of the recorded time to wait; 0 replays without waiting.
+         * @param extra The time to wait in addition to the scaled recorded time.
+         */
+        void latency(double scale, std::chrono::milliseconds extra = std::chrono::milliseconds(0));
+
+        /**
+         * Gets the time an entry takes to replay.
+         * @param entry The entry being replayed.
+         * @return Returns the time to wait before answering with the entry.
+         */
+        std::chrono::milliseconds latency(replay_entry const& entry) const;
+
+        /**
+         * Adds an entry to the log, replacing any entry with the same key.
+         * @param key The key of the command or request.
+         * @param entry The result of the command or request.
+         */
+        void add(std::string key, replay_entry entry);
+
+        /**
+         * Finds the entry of a command or request.
+         * @param key The key of the command or request.
+         * @return Returns the entry or nullptr if the command or request was not recorded.
+         */
+        replay_entry const* find(std::string const& key) const;
+
+        /**
+         * Gets the number of entries in the log.
+         * @return Returns the number of entries in the log.
+         */
+        size_t size() const;
+
+        /**
+         * Loads the entries of a fixture file into the log.
+         * @param path The path to the fixture file.
+         * @return Returns true if the file was loaded or false if it could not be read or parsed.
+         */
+        bool load(std::string const& path);
+
+        /**
+         * Saves the entries of the log to a fixture file.
+         * @param path The path to the fixture file.
+         * @return Returns true if the file was written or false if not.
+         */
+        bool save(std::string const& path) const;
+
+        /**
+         * Gets the log installed for the process.
+         * @return Returns the installed log or nullptr if commands and requests are not being recorded or replayed.
+         */
+        static replay_log* current();
+
+     private:
+        replay_mode _mode;
+        double _scale;
+        std::chrono::milliseconds _extra;
+        mutable boost::mutex _mutex;
+        std::map<std::string, replay_entry> _entries;
+    };
+
+    /**
+     * Installs a replay log for the process while in scope.
+     */
+    struct scoped_replay_log
+    {
+        /**
+         * Installs the log, replacing the one installed until the scope ends.
+         * @param log The log to install; nullptr stops recording or replaying for the scope.
+         */
+        explicit scoped_replay_log(replay_log* log);
+
+        /**
+         * Restores the log that was installed before the scope.
+         */
+        ~scoped_replay_log();
+
+        /**
+         * Prevents the scope from being copied.
+         */
+        scoped_replay_log(scoped_replay_log const&) = delete;
+
+        /**
+         * Prevents the scope from being copied.
+         * @returns Returns this scope.
+         */
+        scoped_replay_log& operator=(scoped_replay_log const&) = delete;
+
+     private:
+        replay_log* _previous;
+    };
+
+}}  // namespace facter::util
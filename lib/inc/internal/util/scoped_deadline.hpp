@@ -0,0 +1,86 @@
+/**
+ * @file
+ * Declares the utility functions for limiting the time spent by fact resolvers.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * Exception that is thrown when work is abandoned because its deadline passed or it was cancelled.
+     */
+    struct deadline_exceeded_exception : std::runtime_error
+    {
+        /**
+         * Constructs a deadline_exceeded_exception.
+         * @param message The exception message.
+         */
+        explicit deadline_exceeded_exception(std::string const& message);
+    };
+
+    /**
+     * This is an RAII type for limiting the time spent by work on the calling thread.
+     * Long running operations (e.g. executing a command or making a HTTP request) check the
+     * deadline cooperatively and abandon their work once it passes or the work is cancelled.
+     * A nested scope cannot extend the deadline of the enclosing scope.
+     */
+    struct scoped_deadline
+    {
+        /**
+         * Constructs a scoped_deadline and applies the deadline to the calling thread.
+         * @param deadline The time after which work should be abandoned.
+         * @param cancelled The flag that is set when the work should be abandoned regardless of the deadline; may be nullptr.
+         */
+        scoped_deadline(std::chrono::steady_clock::time_point deadline, std::atomic<bool> const* cancelled = nullptr);
+
+        /**
+         * Restores the enclosing scope, if any.
+         */
+        ~scoped_deadline();
+
+        /**
+         * Prevents the scope from being copied.
+         */
+        scoped_deadline(scoped_deadline const&) = delete;
+
+        /**
+         * Prevents the scope from being copied.
+         * @returns Returns this scope.
+         */
+        scoped_deadline& operator=(scoped_deadline const&) = delete;
+
+        /**
+         * Determines if the calling thread has a deadline.
+         * @return Returns true if work on the calling thread has a deadline or may be cancelled or false if not.
+         */
+        static bool active();
+
+        /**
+         * Determines if work on the calling thread should be abandoned.
+         * @return Returns true if the deadline has passed or the work was cancelled or false if not.
+         */
+        static bool expired();
+
+        /**
+         * Gets the time remaining until the deadline of the calling thread.
+         * @return Returns the time remaining, zero if the work should be abandoned, or duration::max() if there is no deadline.
+         */
+        static std::chrono::steady_clock::duration remaining();
+
+        /**
+         * Throws a deadline_exceeded_exception if work on the calling thread should be abandoned.
+         */
+        static void check();
+
+     private:
+        scoped_deadline* _previous;
+        std::chrono::steady_clock::time_point _deadline;
+        std::atomic<bool> const* _cancelled;
+    };
+
+}}  // namespace facter::util
@@ -13,6 +13,8 @@ namespace facter { namespace util {
     /**
      * This is an RAII wrapper for temporarily changing an environment variable.
      * It sets the environment on construction and restores it on destruction.
+     * The change is visible to every thread for the lifetime of the object, so this should only be used where no other
+     * thread depends on the variable (e.g. in tests).
      */
     struct scoped_env : scoped_resource<std::tuple<std::string, boost::optional<std::string>>>
     {
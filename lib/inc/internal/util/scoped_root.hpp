@@ -0,0 +1,59 @@
+/**
+ * @file
+ * Declares the utility type for resolving files relative to an alternate root directory.
+ */
+#pragma once
+
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * This is an RAII type for resolving absolute file paths relative to an alternate root directory on the calling thread.
+     * This is used to resolve the facts of a container or chroot from the host; files such as /proc, /sys, and /etc are
+     * read from beneath the root directory. The root does not affect executed commands or system calls.
+     */
+    struct scoped_root
+    {
+        /**
+         * Constructs a scoped_root and applies the root directory to the calling thread.
+         * @param root The root directory; an empty string or "/" applies no alternate root.
+         */
+        explicit scoped_root(std::string root);
+
+        /**
+         * Restores the enclosing scope, if any.
+         */
+        ~scoped_root();
+
+        /**
+         * Prevents the scope from being copied.
+         */
+        scoped_root(scoped_root const&) = delete;
+
+        /**
+         * Prevents the scope from being copied.
+         * @returns Returns this scope.
+         */
+        scoped_root& operator=(scoped_root const&) = delete;
+
+        /**
+         * Gets the root directory of the calling thread.
+         * @return Returns the root directory or an empty string if there is no alternate root.
+         */
+        static std::string const& current();
+
+        /**
+         * Gets the path of the given file relative to the root directory of the calling thread.
+         * Relative paths and paths already beneath the root directory are returned as given.
+         * @param path The absolute path of the file on the root file system.
+         * @return Returns the path of the file beneath the root directory.
+         */
+        static std::string path(std::string const& path);
+
+     private:
+        scoped_root* _previous;
+        std::string _root;
+    };
+
+}}  // namespace facter::util
@@ -0,0 +1,69 @@
+/**
+ * @file
+ * Declares the spans recorded while the process is being traced.
+ */
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace facter { namespace util {
+
+    /**
+     * This is an RAII type for recording a span of work on the calling thread while the process is being traced.
+     * Spans on the same thread must nest; work that overlaps on one thread (e.g. concurrent HTTP requests) is
+     * recorded with record_async instead.
+     */
+    struct scoped_trace_span
+    {
+        /**
+         * Starts the span if the process is being traced.
+         * @param category The category of the span (e.g. "resolver"); it must be a string literal.
+         * @param name The name of the span.
+         * @param argument The name of an argument shown with the span, or nullptr for none; it must be a string literal.
+         * @param value The value of the argument.
+         */
+        scoped_trace_span(char const* category, std::string name, char const* argument = nullptr, std::string value = {});
+
+        /**
+         * Ends the span.
+         */
+        ~scoped_trace_span();
+
+        /**
+         * Prevents the span from being copied.
+         */
+        scoped_trace_span(scoped_trace_span const&) = delete;
+
+        /**
+         * Prevents the span from being copied.
+         * @returns Returns this span.
+         */
+        scoped_trace_span& operator=(scoped_trace_span const&) = delete;
+
+        /**
+         * Determines if the process is being traced, so that callers only describe spans that are recorded.
+         * @return Returns true if the process is being traced or false if not.
+         */
+        static bool enabled();
+
+        /**
+         * Records a span that ends now and may overlap other spans on the calling thread.
+         * @param category The category of the span; it must be a string literal.
+         * @param name The name of the span.
+         * @param start The time the span started.
+         * @param argument The name of an argument shown with the span, or nullptr for none; it must be a string literal.
+         * @param value The value of the argument.
+         */
+        static void record_async(char const* category, std::string name, std::chrono::steady_clock::time_point start, char const* argument = nullptr, std::string value = {});
+
+     private:
+        bool _active;
+        char const* _category;
+        std::string _name;
+        char const* _argument;
+        std::string _value;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+}}  // namespace facter::util
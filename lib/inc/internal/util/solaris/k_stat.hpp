@@ -5,6 +5,8 @@
 #pragma once
 
 #include "scoped_kstat.hpp"
+#include <boost/thread/mutex.hpp>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
@@ -138,6 +140,9 @@ namespace facter { namespace util { namespace solaris {
      * Wrapper around the kstat_ctl structure. It represents our
      * link to kernel stats, and controls the lifetime of any kstat
      * structures associated. (They go away when it is closed)
+     * The kstat chain is indexed by module when first looked up and only re-indexed when the kernel
+     * reports a change to the chain, so one k_stat can be shared by the resolvers of a collection.
+     * Lookups are serialized; only the matching kstats are read.
      */
     struct k_stat
     {
@@ -170,7 +175,11 @@ namespace facter { namespace util { namespace solaris {
 
      private:
         std::vector<k_stat_entry> lookup(std::string const& module, int instance, std::string const& name);
+        void update_index();
         scoped_kstat ctrl;
+        boost::mutex _mutex;
+        bool _indexed;
+        std::unordered_map<std::string, std::vector<kstat_t*>> _modules;
     };
 
 }}}  // namespace facter::util::solaris
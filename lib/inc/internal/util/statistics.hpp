@@ -0,0 +1,102 @@
+/**
+ * @file
+ * Declares the utility functions for recording the work performed by fact resolvers.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace facter { namespace util {
+
+    /**
+     * Stores the time spent and the work performed while recording statistics.
+     */
+    struct statistics
+    {
+        /**
+         * Constructs an empty statistics.
+         */
+        statistics();
+
+        /**
+         * Stores the elapsed wall time.
+         */
+        std::chrono::nanoseconds wall_time;
+
+        /**
+         * Stores the CPU time consumed by the recording thread.
+         */
+        std::chrono::nanoseconds cpu_time;
+
+        /**
+         * Stores the number of child processes spawned.
+         */
+        size_t processes;
+
+        /**
+         * Stores the number of bytes read from files and child processes.
+         */
+        size_t bytes_read;
+
+        /**
+         * Stores the number of HTTP requests made.
+         */
+        size_t http_requests;
+    };
+
+    /**
+     * This is an RAII type for recording statistics on the calling thread.
+     * Statistics are recorded from construction until destruction.
+     * A nested scope records its own statistics; its time is excluded from the enclosing scope.
+     */
+    struct scoped_statistics
+    {
+        /**
+         * Constructs a scoped_statistics and starts recording on the calling thread.
+         * @param stats The statistics to record into.
+         */
+        explicit scoped_statistics(statistics& stats);
+
+        /**
+         * Stops recording and restores the enclosing scope, if any.
+         */
+        ~scoped_statistics();
+
+        /**
+         * Prevents the scope from being copied.
+         */
+        scoped_statistics(scoped_statistics const&) = delete;
+
+        /**
+         * Prevents the scope from being copied.
+         * @returns Returns this scope.
+         */
+        scoped_statistics& operator=(scoped_statistics const&) = delete;
+
+        /**
+         * Records that a child process was spawned on the calling thread.
+         */
+        static void record_process();
+
+        /**
+         * Records that bytes were read on the calling thread.
+         * @param count The number of bytes read.
+         */
+        static void record_bytes_read(size_t count);
+
+        /**
+         * Records that a HTTP request was made on the calling thread.
+         */
+        static void record_http_request();
+
+     private:
+        statistics& _stats;
+        scoped_statistics* _previous;
+        std::chrono::nanoseconds _wall_start;
+        std::chrono::nanoseconds _cpu_start;
+        std::chrono::nanoseconds _nested_wall;
+        std::chrono::nanoseconds _nested_cpu;
+    };
+
+}}  // namespace facter::util
@@ -0,0 +1,42 @@
+/**
+ * @file
+ * Declares the scanners for finding the bytes of a string that writers must quote or escape, or that break lines.
+ * Where SSE2 or NEON is available, clean runs of bytes are skipped 16 bytes at a time.
+ */
+#pragma once
+
+namespace facter { namespace util {
+
+    /**
+     * Finds the first byte that must be escaped in a double-quoted string: a control character, '"', or '\'.
+     * @param first The first byte to scan.
+     * @param last One past the last byte to scan.
+     * @return Returns a pointer to the first byte that must be escaped or last if there is none.
+     */
+    char const* find_escape(char const* first, char const* last);
+
+    /**
+     * Finds the first byte that may prevent a string from being written as a plain YAML scalar: a control character, ':', or '#'.
+     * @param first The first byte to scan.
+     * @param last One past the last byte to scan.
+     * @return Returns a pointer to the first such byte or last if there is none.
+     */
+    char const* find_plain_special(char const* first, char const* last);
+
+    /**
+     * Finds the first byte that is not an ASCII digit.
+     * @param first The first byte to scan.
+     * @param last One past the last byte to scan.
+     * @return Returns a pointer to the first byte that is not a digit or last if there is none.
+     */
+    char const* find_not_digit(char const* first, char const* last);
+
+    /**
+     * Finds the first line break ('\n' or '\r').
+     * @param first The first byte to scan.
+     * @param last One past the last byte to scan.
+     * @return Returns a pointer to the first line break or last if there is none.
+     */
+    char const* find_newline(char const* first, char const* last);
+
+}}  // namespace facter::util
@@ -0,0 +1,204 @@
+/**
+ * @file
+ * Declares the work-stealing thread pool shared by the parts of facter that work in parallel.
+ */
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace facter { namespace util {
+
+    /**
+     * A flag shared by everything that should stop when the work it belongs to is cancelled.
+     * Copies of a token share the same flag.
+     */
+    struct cancellation_token
+    {
+        /**
+         * Constructs a token that has not been cancelled.
+         */
+        cancellation_token();
+
+        /**
+         * Cancels the work the token belongs to.
+         */
+        void cancel() const;
+
+        /**
+         * Determines if the work the token belongs to was cancelled.
+         * @return Returns true if the work was cancelled or false if not.
+         */
+        bool cancelled() const;
+
+        /**
+         * Gets the flag that is set when the work is cancelled (e.g. for a scoped_deadline).
+         * @return Returns the flag; it lives as long as any copy of the token.
+         */
+        std::atomic<bool> const* flag() const;
+
+     private:
+        std::shared_ptr<std::atomic<bool>> _flag;
+    };
+
+    /**
+     * A pool of threads that run tasks.
+     * Each thread has its own queue: tasks submitted by a task running on a pool thread are queued on that thread,
+     * which runs the newest first, and idle threads steal the oldest tasks from the others.
+     * Tasks submitted from other threads are queued for whichever thread is idle first.
+     * Tasks should be submitted through a task_group, which also waits for them, so that one pool can be shared.
+     */
+    struct thread_pool
+    {
+        /**
+         * Constructs a pool and starts its threads.
+         * @param threads The number of threads to start; at least one is started.
+         */
+        explicit thread_pool(unsigned int threads);
+
+        /**
+         * Stops the pool's threads once they finish their current task; tasks that have not started are discarded.
+         */
+        ~thread_pool();
+
+        /**
+         * Prevents the pool from being copied.
+         */
+        thread_pool(thread_pool const&) = delete;
+
+        /**
+         * Prevents the pool from being copied.
+         * @returns Returns this pool.
+         */
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        /**
+         * Gets the pool shared by the process, starting it on first use.
+         * It starts with a thread per processor and grows when more threads are reserved.
+         * @return Returns the shared pool.
+         */
+        static thread_pool& instance();
+
+        /**
+         * Gets the number of threads the shared pool starts with.
+         * @return Returns the number of processors, or 1 if it can't be determined.
+         */
+        static unsigned int default_size();
+
+        /**
+         * Starts more threads if the pool has fewer than the given number.
+         * Tasks that block (e.g. executing commands) use this to run as many at once as they were asked to.
+         * @param threads The number of threads the pool should have.
+         */
+        void reserve(unsigned int threads);
+
+        /**
+         * Gets the number of threads in the pool.
+         * @return Returns the number of threads in the pool.
+         */
+        unsigned int size() const;
+
+        /**
+         * Queues a task to run on one of the pool's threads.
+         * The task must not throw; task_group catches the exceptions of its tasks.
+         * @param task The task to run.
+         */
+        void submit(std::function<void()> task);
+
+     private:
+        struct worker;
+
+        static boost::thread_specific_ptr<worker>& current_worker();
+        void run(worker& self);
+        bool take(worker* self, std::function<void()>& task);
+
+        // Room for the workers is reserved up front, so threads stealing from the workers never see the list move
+        static const unsigned int max_threads = 256;
+
+        mutable boost::mutex _mutex;
+        boost::condition_variable _available;
+        std::deque<std::function<void()>> _queue;
+        std::vector<std::unique_ptr<worker>> _workers;
+        std::atomic<unsigned int> _count;
+        std::atomic<size_t> _queued;
+        bool _stopping;
+    };
+
+    /**
+     * A group of tasks that run on a thread_pool and are waited for together.
+     * Tasks that haven't started when the group is cancelled or its deadline passes are abandoned; tasks that are
+     * running see the cancellation and the deadline through scoped_deadline.
+     * The thread waiting for the group runs the group's queued tasks itself rather than only waiting for them, so
+     * groups may be waited for from tasks running on the pool without exhausting its threads.
+     */
+    struct task_group
+    {
+        /**
+         * Constructs a task group.
+         * @param pool The pool to run the tasks on.
+         * @param token The token that cancels the group's tasks; the group has its own if none is given.
+         * @param deadline The time after which the group's tasks are abandoned.
+         */
+        explicit task_group(
+            thread_pool& pool = thread_pool::instance(),
+            cancellation_token token = cancellation_token(),
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+        /**
+         * Abandons the tasks that haven't started and waits for the others to finish.
+         * The group's token isn't cancelled, as it may be shared with other work.
+         */
+        ~task_group();
+
+        /**
+         * Prevents the task group from being copied.
+         */
+        task_group(task_group const&) = delete;
+
+        /**
+         * Prevents the task group from being copied.
+         * @returns Returns this task group.
+         */
+        task_group& operator=(task_group const&) = delete;
+
+        /**
+         * Queues a task to run on the pool.
+         * @param task The task to run.
+         */
+        void run(std::function<void()> task);
+
+        /**
+         * Waits for every task run so far to finish, running queued tasks on the calling thread.
+         * Throws the first exception thrown by a task, or deadline_exceeded_exception if any task was abandoned.
+         */
+        void wait();
+
+        /**
+         * Cancels the group's tasks.
+         */
+        void cancel();
+
+        /**
+         * Gets the token that cancels the group's tasks.
+         * @return Returns the group's cancellation token.
+         */
+        cancellation_token const& token() const;
+
+     private:
+        struct state;
+
+        static bool run_next(state& tasks);
+
+        thread_pool& _pool;
+        std::shared_ptr<state> _state;
+    };
+
+}}  // namespace facter::util
@@ -8,6 +8,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/compare.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <boost/thread/mutex.hpp>
 #include <string>
 #include <map>
 #include <vector>
@@ -32,6 +33,7 @@ namespace facter { namespace util { namespace windows {
 
     /**
      * A class for initiating a WMI connection over COM and querying it.
+     * The connection is made on the first query, so facts that don't need WMI never pay to initialize COM and connect.
      */
     struct wmi {
         /**
@@ -141,7 +143,28 @@ namespace facter { namespace util { namespace windows {
         using kv_range = boost::iterator_range<imap::const_iterator>;
 
         /**
-         * Initializes a COM connection for WMI queries. Throws a wmi_exception on failure.
+         * A query of the properties of a WMI class, for use with a batch of queries.
+         */
+        struct request
+        {
+            /**
+             * The class alias to query.
+             */
+            std::string group;
+
+            /**
+             * The keys to query from the class.
+             */
+            std::vector<std::string> keys;
+
+            /**
+             * Extra arguments to the WMI query, such as filters.
+             */
+            std::string extra;
+        };
+
+        /**
+         * Prepares a WMI connection. COM is initialized and the connection is made on the first query.
          */
         wmi();
 
@@ -159,6 +182,14 @@ namespace facter { namespace util { namespace windows {
          */
         imaps query(std::string const& group, std::vector<std::string> const& keys, std::string const& extra = "") const;
 
+        /**
+         * Queries several WMI classes in one batch. All of the queries are issued before any results are read,
+         * so WMI works on them together and the batch costs about one round trip rather than one per query.
+         * @param requests The queries to issue.
+         * @return Returns the results of each query, in the order of the requests; a failed query has no results.
+         */
+        std::vector<imaps> query(std::vector<request> const& requests) const;
+
         /**
          * A utility for retrieving a single entry from an imap. It should only be used if
          * it's known that the requested property is not an array.
@@ -197,9 +228,14 @@ namespace facter { namespace util { namespace windows {
         static kv_range get_range(imaps const& kvmaps, std::string const& key);
 
      private:
-        scoped_resource<bool> _coInit;
-        scoped_resource<IWbemLocator *> _pLoc;
-        scoped_resource<IWbemServices *> _pSvc;
+        IWbemServices* services() const;
+        void connect() const;
+
+        mutable boost::mutex _mutex;
+        mutable bool _connected;
+        mutable scoped_resource<bool> _coInit;
+        mutable scoped_resource<IWbemLocator *> _pLoc;
+        mutable scoped_resource<IWbemServices *> _pSvc;
     };
 
 }}}  // namespace facter::util::windows
@@ -0,0 +1,49 @@
+#include <internal/execution/command_cache.hpp>
+#include <internal/util/metrics.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+namespace facter { namespace execution {
+
+    command_cache::result const& command_cache::get(string const& key, function<result()> const& run)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            auto it = _results.find(key);
+            if (it != _results.end()) {
+                util::metrics::record_cache_lookup("commands", true);
+                return it->second;
+            }
+        }
+        util::metrics::record_cache_lookup("commands", false);
+
+        // If another thread ran the same command in the meantime, its result is kept
+        auto output = run();
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        return _results.emplace(key, move(output)).first->second;
+    }
+
+    // The scopes are owned by the calling thread's stack; never delete them
+    static boost::thread_specific_ptr<scoped_command_cache> current_scope([](scoped_command_cache*) {});
+
+    scoped_command_cache::scoped_command_cache(command_cache* cache) :
+        _previous(current_scope.get()),
+        _cache(cache)
+    {
+        current_scope.reset(this);
+    }
+
+    scoped_command_cache::~scoped_command_cache()
+    {
+        current_scope.reset(_previous);
+    }
+
+    command_cache* scoped_command_cache::current()
+    {
+        auto scope = current_scope.get();
+        return scope ? scope->_cache : nullptr;
+    }
+
+}}  // namespace facter::execution
@@ -1,12 +1,22 @@
 #include <facter/execution/execution.hpp>
+#include <internal/execution/command_cache.hpp>
+#include <internal/execution/execution.hpp>
 #include <facter/util/directory.hpp>
+#include <internal/util/replay_log.hpp>
+#include <internal/util/string_scan.hpp>
+#include <internal/util/statistics.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
 #include <cstring>
+#include <thread>
 
 using namespace std;
 using namespace facter::util;
@@ -54,21 +64,73 @@ namespace facter { namespace execution {
         return _signal;
     }
 
+    timeout_exception::timeout_exception(string const& message, size_t pid) :
+        execution_exception(message),
+        _pid(pid)
+    {
+    }
+
+    size_t timeout_exception::pid() const
+    {
+        return _pid;
+    }
+
+    string command_line(string const& file, vector<string> const* arguments)
+    {
+        ostringstream line;
+        line << file;
+
+        if (arguments) {
+            for (auto const& argument : *arguments) {
+                line << ' ' << argument;
+            }
+        }
+        return line.str();
+    }
+
     void log_execution(string const& file, vector<string> const* arguments)
     {
         if (!LOG_IS_DEBUG_ENABLED()) {
             return;
         }
+        LOG_DEBUG("executing command: %1%", command_line(file, arguments));
+    }
 
-        ostringstream command_line;
-        command_line << file;
+    // The results of searching for executables, keyed by file name and search paths
+    static boost::mutex which_mutex;
+    static map<string, string> which_cache;
 
-        if (arguments) {
-            for (auto const& argument : *arguments) {
-                command_line << ' ' << argument;
+    string which(string const& file, vector<string> const& directories)
+    {
+        // Only remember searches for file names; other paths may be relative to the current directory or change often
+        if (file.find_first_of("/\\:") != string::npos) {
+            return search_executable(file, directories);
+        }
+
+        string key = file;
+        for (auto const& directory : directories) {
+            key += '\0';
+            key += directory;
+        }
+        {
+            boost::lock_guard<boost::mutex> lock(which_mutex);
+            auto it = which_cache.find(key);
+            if (it != which_cache.end()) {
+                return it->second;
             }
         }
-        LOG_DEBUG("executing command: %1%", command_line.str());
+
+        // Search without holding the lock; concurrent searches for the same file find the same result
+        string executable = search_executable(file, directories);
+        boost::lock_guard<boost::mutex> lock(which_mutex);
+        which_cache.emplace(move(key), executable);
+        return executable;
+    }
+
+    void clear_which_cache()
+    {
+        boost::lock_guard<boost::mutex> lock(which_mutex);
+        which_cache.clear();
     }
 
     string expand_command(string const& command, vector<string> const& directories)
@@ -115,47 +177,165 @@ namespace facter { namespace execution {
         vector<string> const* arguments,
         map<string, string> const* environment,
         function<bool(string&)> callback,
-        option_set<execution_options> const& options);
+        function<bool(string&)> stderr_callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout);
+
+    // Runs a command to completion so that every caller of a cached or logged command gets its entire output
+    static command_cache::result complete(
+        string const& file,
+        vector<string> const* arguments,
+        map<string, string> const* environment,
+        option_set<execution_options> const& run_options,
+        uint32_t timeout)
+    {
+        command_cache::result result = { false, 0, {} };
+        try {
+            result.output = execute(file, arguments, environment, nullptr, nullptr, run_options, timeout).second;
+        } catch (child_exit_exception& ex) {
+            result.status = ex.status_code();
+            result.output = ex.output();
+        } catch (child_signal_exception& ex) {
+            result.signaled = true;
+            result.status = ex.signal();
+            result.output = ex.output();
+        }
+        return result;
+    }
+
+    // Answers a command from the replay log, or runs it and adds its result to the log
+    static command_cache::result logged(replay_log& log, string const& key, string const& file, function<command_cache::result()> const& run)
+    {
+        if (log.mode() == replay_mode::replay) {
+            auto entry = log.find(key);
+            if (!entry) {
+                // Treat the command as not found, as it would be on a host that doesn't have it
+                LOG_DEBUG("%1% was not recorded in the replay log.", file);
+                return { false, 127, {} };
+            }
+            this_thread::sleep_for(log.latency(*entry));
+            return { entry->signaled, entry->status, entry->output };
+        }
+
+        auto start = chrono::steady_clock::now();
+        auto result = run();
+        replay_entry entry;
+        entry.signaled = result.signaled;
+        entry.status = result.status;
+        entry.output = result.output;
+        entry.elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+        log.add(key, move(entry));
+        return result;
+    }
+
+    static pair<bool, string> cached_execute(
+        string const& file,
+        vector<string> const* arguments,
+        map<string, string> const* environment,
+        function<bool(string&)> callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        auto cache = scoped_command_cache::current();
+        auto log = replay_log::current();
+        if (!cache && !log) {
+            return execute(file, arguments, environment, callback, nullptr, options, timeout);
+        }
+
+        // Only the options that change the output are part of the key; the others are applied to the cached result
+        option_set<execution_options> run_options = { execution_options::throw_on_nonzero_exit, execution_options::throw_on_signal };
+        if (options[execution_options::redirect_stderr]) {
+            run_options.set(execution_options::redirect_stderr);
+        }
+        if (options[execution_options::merge_environment]) {
+            run_options.set(execution_options::merge_environment);
+        }
+        string key = to_string(static_cast<uint64_t>(run_options)) + '\0' + file + '\0';
+        if (arguments) {
+            for (auto const& argument : *arguments) {
+                key += argument;
+                key += '\0';
+            }
+        }
+        if (environment) {
+            key += '\0';
+            for (auto const& variable : *environment) {
+                key += variable.first + '=' + variable.second;
+                key += '\0';
+            }
+        }
+
+        function<command_cache::result()> run = [&]() {
+            auto run_command = [&]() { return complete(file, arguments, environment, run_options, timeout); };
+            return log ? logged(*log, key, file, run_command) : run_command();
+        };
+        command_cache::result uncached;
+        auto const& result = cache ? cache->get(key, run) : (uncached = run());
+        if (cache) {
+            LOG_DEBUG("using the cached output of %1%.", file);
+        }
+
+        // Replay the output as if the command was executed with the given options
+        output_processor processor(move(callback), options);
+        string output = result.output;
+        processor.process(output);
+        output = processor.finish();
+        if (result.signaled) {
+            if (options[execution_options::throw_on_signal]) {
+                throw child_signal_exception(result.status, output, "child process was terminated by signal.");
+            }
+            return { false, move(output) };
+        }
+        if (result.status != 0 && options[execution_options::throw_on_nonzero_exit]) {
+            throw child_exit_exception(result.status, output, "child process returned non-zero exit status.");
+        }
+        return { result.status == 0, move(output) };
+    }
 
     pair<bool, string> execute(
         string const& file,
-        option_set<execution_options> const& options)
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
-        return execute(file, nullptr, nullptr, nullptr, options);
+        return cached_execute(file, nullptr, nullptr, nullptr, options, timeout);
     }
 
     pair<bool, string> execute(
         string const& file,
         vector<string> const& arguments,
-        option_set<execution_options> const& options)
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
-        return execute(file, &arguments, nullptr, nullptr, options);
+        return cached_execute(file, &arguments, nullptr, nullptr, options, timeout);
     }
 
     pair<bool, string> execute(
         string const& file,
         vector<string> const& arguments,
         map<string, string> const& environment,
-        option_set<execution_options> const& options)
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
-        return execute(file, &arguments, &environment, nullptr, options);
+        return cached_execute(file, &arguments, &environment, nullptr, options, timeout);
     }
 
     bool each_line(
         string const& file,
         function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
-        return execute(file, nullptr, nullptr, callback, options).first;
+        return cached_execute(file, nullptr, nullptr, callback, options, timeout).first;
     }
 
     bool each_line(
         string const& file,
         vector<string> const& arguments,
         function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
-        return execute(file, &arguments, nullptr, callback, options).first;
+        return cached_execute(file, &arguments, nullptr, callback, options, timeout).first;
     }
 
     bool each_line(
@@ -163,100 +343,188 @@ namespace facter { namespace execution {
         vector<string> const& arguments,
         map<string, string> const& environment,
         function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
-        return execute(file, &arguments, &environment, callback, options).first;
+        return cached_execute(file, &arguments, &environment, callback, options, timeout).first;
     }
 
-    string process_stream(
-        function<bool(string&)> yield_input,
-        function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+    bool each_line(
+        string const& file,
+        vector<string> const& arguments,
+        map<string, string> const& environment,
+        function<bool(string&)> stdout_callback,
+        function<bool(string&)> stderr_callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
-        // Get a special logger used specifically for child process output
-        const std::string logger = "|";
+        // Output that is captured separately is not cached; it is mostly diagnostic and varies between runs
+        if (!stderr_callback) {
+            return cached_execute(file, &arguments, &environment, stdout_callback, options, timeout).first;
+        }
+        return execute(file, &arguments, &environment, stdout_callback, stderr_callback, options, timeout).first;
+    }
 
-        // Read output until it stops.
-        string output, buffer;
-        bool reading = true;
-        while (reading) {
-            if (!yield_input(buffer)) {
-                // Nothing to read, processing is complete.
-                break;
-            } else if (buffer.size() == 0) {
-                // No data read, but continue. If it were a halting error, an exception was thrown.
-                continue;
-            }
+    // A special logger used specifically for child process output
+    static const string output_logger = "|";
 
-            if (!callback) {
-                // If given no callback, buffer the entire output
-                output.append(buffer);
-                continue;
-            }
+    // Reads start at a page and grow while they fill the storage, up to the size of a typical pipe buffer
+    static size_t const min_read_size = 4096;
+    static size_t const max_read_size = 64 * 1024;
 
-            // Find the last newline, because anything after may not be a complete line.
-            auto lastNL = buffer.find_last_of("\n\r");
-            if (lastNL == string::npos) {
-                // No newline found, so keep appending and continue.
-                output.append(buffer);
-                continue;
-            }
+    output_processor::output_processor(function<bool(string&)> callback, option_set<execution_options> const& options) :
+        _callback(move(callback)),
+        _options(options),
+        _prepared(0),
+        _read_size(min_read_size),
+        _stopped(false)
+    {
+    }
 
-            // Make a range for iterating through lines.
-            auto str_range = make_pair(buffer.begin(), buffer.begin()+lastNL);
-            auto line_iterator = boost::make_iterator_range(
-                make_split_iterator(str_range, token_finder(is_any_of("\n\r"), token_compress_on)),
-                split_iterator<string::iterator>());
+    char* output_processor::prepare(size_t& size)
+    {
+        size = _read_size;
+        if (!_callback) {
+            // Read directly onto the end of the output
+            _prepared = _output.size();
+            _output.resize(_prepared + size);
+            return &_output[_prepared];
+        }
+        _buffer.resize(size);
+        return &_buffer[0];
+    }
 
-            for (auto &line : line_iterator) {
-                // The previous trailing data is picked up by default.
-                output.append(line.begin(), line.end());
+    bool output_processor::commit(size_t count)
+    {
+        if (count == _read_size && _read_size < max_read_size) {
+            _read_size *= 2;
+        }
+        if (!_callback) {
+            _output.resize(_prepared + count);
+            scoped_statistics::record_bytes_read(count);
+            return true;
+        }
+        return process(_buffer.data(), count);
+    }
 
-                if (options[execution_options::trim_output]) {
-                    boost::trim(output);
-                }
+    bool output_processor::process(string& buffer)
+    {
+        if (!_callback) {
+            // If given no callback, buffer the entire output
+            _output.append(buffer);
+            scoped_statistics::record_bytes_read(buffer.size());
+            return true;
+        }
+        return process(buffer.data(), buffer.size());
+    }
 
-                // Skip empty lines
-                if (output.empty()) {
-                    continue;
-                }
+    static void trim_line(char const*& first, char const*& last)
+    {
+        // Trims the same characters as boost::trim
+        auto space = is_space();
+        while (first < last && space(*first)) {
+            ++first;
+        }
+        while (last > first && space(*(last - 1))) {
+            --last;
+        }
+    }
 
-                // Log the line to the output logger
-                if (LOG_IS_DEBUG_ENABLED()) {
-                    log(logger, log_level::debug, output);
+    bool output_processor::process(char const* data, size_t size)
+    {
+        scoped_statistics::record_bytes_read(size);
+
+        // Pass each complete line to the callback; the line is built in the output so that its storage is reused
+        bool trim_output = _options[execution_options::trim_output];
+        auto end = data + size;
+        while (data != end) {
+            auto newline = find_newline(data, end);
+            if (newline == end) {
+                // Anything after the last newline may not be a complete line
+                _output.append(data, end);
+                break;
+            }
+            auto first = data;
+            auto last = newline;
+            data = newline + 1;
+            if (_output.empty()) {
+                // The whole line is in the buffer, so trim it before copying it and skip it if empty
+                if (trim_output) {
+                    trim_line(first, last);
                 }
-
-                // Pass the line to the callback
-                if (!callback(output)) {
-                    LOG_DEBUG("completed processing output; closing child pipe.");
-                    reading = false;
-                    break;
+                if (first == last) {
+                    continue;
                 }
-
-                // Clear the line for the next iteration. Doing this allows us to
-                // append in the 1st iteration without a conditional check.
-                output.clear();
             }
+            _output.append(first, last);
+            if (!emit()) {
+                LOG_DEBUG("completed processing output; closing child pipe.");
+                _stopped = true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool output_processor::emit()
+    {
+        if (_options[execution_options::trim_output]) {
+            boost::trim(_output);
+        }
 
-            // Save the new trailing data
-            output.assign(buffer.begin()+lastNL, buffer.end());
+        // Skip empty lines
+        if (_output.empty()) {
+            return true;
         }
 
-        // Log the result and do a final callback if needed.
-        if (options[execution_options::trim_output]) {
-            boost::trim(output);
+        // Log the line to the output logger
+        if (LOG_IS_DEBUG_ENABLED()) {
+            log(output_logger, log_level::debug, _output);
         }
 
-        if (!output.empty()) {
-            if (LOG_IS_DEBUG_ENABLED()) {
-                log(logger, log_level::debug, output);
+        // Pass the line to the callback and clear it for the next line
+        bool more = _callback(_output);
+        _output.clear();
+        return more;
+    }
+
+    string output_processor::finish()
+    {
+        if (_callback) {
+            // Do a final callback for the last line unless the callback requested to stop
+            if (!_stopped) {
+                emit();
             }
-            if (callback) {
-                callback(output);
-                return {};
+            return {};
+        }
+
+        // Log the result
+        if (_options[execution_options::trim_output]) {
+            boost::trim(_output);
+        }
+        if (!_output.empty() && LOG_IS_DEBUG_ENABLED()) {
+            log(output_logger, log_level::debug, _output);
+        }
+        return move(_output);
+    }
+
+    string process_stream(
+        function<bool(char*, size_t&)> yield_input,
+        function<bool(string&)> callback,
+        option_set<execution_options> const& options)
+    {
+        // Read output until it stops.
+        output_processor processor(move(callback), options);
+        while (true) {
+            size_t count = 0;
+            auto data = processor.prepare(count);
+            bool more = yield_input(data, count);
+            // No data read, but continue. If it were a halting error, an exception was thrown.
+            if (!processor.commit(count) || !more) {
+                break;
             }
         }
-        return output;
+        return processor.finish();
     }
 
 }}  // namespace facter::executions
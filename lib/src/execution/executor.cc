@@ -0,0 +1,36 @@
+#include <internal/execution/executor.hpp>
+
+using namespace std;
+using namespace facter::util;
+
+namespace facter { namespace execution {
+
+    executor::executor(size_t concurrency) :
+        _concurrency(concurrency == 0 ? 1 : concurrency)
+    {
+    }
+
+    void executor::add(
+        string const& file,
+        vector<string> const& arguments,
+        function<void(bool, string&)> completed,
+        option_set<execution_options> const& options)
+    {
+        _commands.push_back({ file, arguments, nullptr, move(completed), options });
+    }
+
+    void executor::each_line(
+        string const& file,
+        vector<string> const& arguments,
+        function<bool(string&)> callback,
+        function<void(bool)> completed,
+        option_set<execution_options> const& options)
+    {
+        _commands.push_back({ file, arguments, move(callback), [=](bool success, string&) {
+            if (completed) {
+                completed(success);
+            }
+        }, options });
+    }
+
+}}  // namespace facter::execution
@@ -1,13 +1,45 @@
 #include <facter/util/directory.hpp>
 #include <internal/execution/execution.hpp>
+#include <internal/execution/posix/execution.hpp>
+#include <internal/execution/posix/spawn_helper.hpp>
+#include <internal/util/environment_mutex.hpp>
+#include <internal/util/log_context.hpp>
 #include <internal/util/posix/scoped_descriptor.hpp>
-#include <internal/ruby/api.hpp>
+#include <internal/util/probes.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <internal/util/statistics.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <thread>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif  // __linux__
+
+// Use posix_spawn where it can also close the descriptors the child shouldn't inherit
+#if defined(__APPLE__) || (defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34)))
+#define USE_POSIX_SPAWN
+#endif
 
 using namespace std;
 using namespace facter::util;
@@ -20,11 +52,56 @@ extern char** environ;
 
 namespace facter { namespace execution {
 
+    string command_line(string const& file, vector<string> const* arguments);
     void log_execution(string const& file, vector<string> const* arguments);
 
     const char *const command_shell = "sh";
     const char *const command_args = "-c";
 
+    // The reserved words and builtins of the shell; a program of the same name on the path would behave differently
+    static const set<string> shell_words = {
+        "!", ".", ":", "alias", "break", "case", "cd", "command", "continue", "do", "done", "elif", "else", "esac",
+        "eval", "exec", "exit", "export", "fi", "for", "function", "getopts", "hash", "if", "in", "local", "read",
+        "readonly", "return", "select", "set", "shift", "source", "then", "time", "times", "trap", "type", "ulimit",
+        "umask", "unalias", "unset", "until", "wait", "while"
+    };
+
+    pair<string, vector<string>> command_invocation(string const& command, vector<string> const& directories)
+    {
+        // Split the command on spaces and tabs; any other character the shell treats specially needs the shell
+        static const string plain = "-_./,:+@%=";
+        vector<string> words;
+        string word;
+        bool direct = true;
+        for (auto c : command) {
+            if (c == ' ' || c == '\t') {
+                if (!word.empty()) {
+                    words.emplace_back(move(word));
+                    word.clear();
+                }
+                continue;
+            }
+            if (!isalnum(static_cast<unsigned char>(c)) && plain.find(c) == string::npos) {
+                direct = false;
+                break;
+            }
+            word += c;
+        }
+        if (!word.empty()) {
+            words.emplace_back(move(word));
+        }
+
+        // A variable assignment before the program also needs the shell
+        if (direct && !words.empty() && words[0].find('=') == string::npos && shell_words.count(words[0]) == 0) {
+            auto file = which(words[0], directories);
+            if (!file.empty()) {
+                words.erase(words.begin());
+                return make_pair(move(file), move(words));
+            }
+        }
+        return make_pair(string(command_shell), vector<string>{ command_args, expand_command(command, directories) });
+    }
+
     uint64_t get_max_descriptor_limit()
     {
 #ifdef _SC_OPEN_MAX
@@ -52,7 +129,7 @@ namespace facter { namespace execution {
 #endif  // OPEN_MAX
     }
 
-    string which(string const& file, vector<string> const& directories)
+    string search_executable(string const& file, vector<string> const& directories)
     {
         // If the file is already absolute, return it if it's executable
         path p = file;
@@ -71,180 +148,668 @@ namespace facter { namespace execution {
         return {};
     }
 
-    pair<bool, string> execute(
+    // Callers merging this process' environment must hold the environment lock
+    static vector<string> build_environment(map<string, string> const* environment, option_set<execution_options> const& options)
+    {
+        map<string, string> variables;
+        if (options[execution_options::merge_environment] && environ) {
+            for (auto variable = environ; *variable; ++variable) {
+                char const* separator = strchr(*variable, '=');
+                if (!separator) {
+                    continue;
+                }
+                variables.emplace(string(*variable, separator - *variable), string(separator + 1));
+            }
+        }
+
+        // Set the locale to C unless specified in the given environment
+        if (!environment || environment->count("LC_ALL") == 0) {
+            variables["LC_ALL"] = "C";
+        }
+        if (!environment || environment->count("LANG") == 0) {
+            variables["LANG"] = "C";
+        }
+        if (environment) {
+            for (auto const& variable : *environment) {
+                variables[variable.first] = variable.second;
+            }
+        }
+
+        vector<string> result;
+        result.reserve(variables.size());
+        for (auto const& variable : variables) {
+            result.emplace_back(variable.first + "=" + variable.second);
+        }
+        return result;
+    }
+
+    static shared_ptr<vector<string> const> child_environment(map<string, string> const* environment, option_set<execution_options> const& options)
+    {
+        if (environment || !options[execution_options::merge_environment]) {
+            boost::shared_lock<boost::shared_mutex> lock(environment_mutex(), boost::defer_lock);
+            if (options[execution_options::merge_environment]) {
+                lock.lock();
+            }
+            return make_shared<vector<string> const>(build_environment(environment, options));
+        }
+
+        // Most commands merge this process' environment without changes, so that environment is built once
+        // It's rebuilt when the environment changes; setenv, unsetenv, and putenv replace the entries of environ
+        // they change, so comparing the entries to the ones it was built from detects a change
+        static boost::mutex mutex;
+        static vector<char const*> entries;
+        static shared_ptr<vector<string> const> cached;
+
+        boost::lock_guard<boost::mutex> lock(mutex);
+        boost::shared_lock<boost::shared_mutex> environment_lock(environment_mutex());
+        size_t count = 0;
+        bool changed = !cached;
+        for (auto variable = environ; variable && *variable; ++variable, ++count) {
+            changed = changed || count >= entries.size() || entries[count] != *variable;
+        }
+        if (!changed && count == entries.size()) {
+            return cached;
+        }
+        entries.assign(environ, environ ? environ + count : environ);
+        cached = make_shared<vector<string> const>(build_environment(nullptr, options));
+        return cached;
+    }
+
+    static bool open_pipe(int (&pipes)[2])
+    {
+#ifdef __linux__
+        if (pipe2(pipes, O_CLOEXEC) == 0) {
+            return true;
+        }
+        if (errno != ENOSYS) {
+            return false;
+        }
+#endif  // __linux__
+        if (pipe(pipes) < 0) {
+            return false;
+        }
+        fcntl(pipes[0], F_SETFD, FD_CLOEXEC);
+        fcntl(pipes[1], F_SETFD, FD_CLOEXEC);
+        return true;
+    }
+
+    void close_descriptors(int first)
+    {
+        // This is called in the child after fork, so it uses only system calls
+#if defined(__FreeBSD__) || defined(__OpenBSD__)
+        closefrom(first);
+        return;
+#endif  // __FreeBSD__ || __OpenBSD__
+
+#if defined(__linux__) && defined(SYS_close_range)
+        if (syscall(SYS_close_range, first, ~0U, 0) == 0) {
+            return;
+        }
+#endif  // __linux__ && SYS_close_range
+
+#ifdef __linux__
+        // Close only the descriptors that are open rather than every descriptor up to the limit
+        int directory = open("/proc/self/fd", O_RDONLY | O_DIRECTORY);
+        if (directory >= 0) {
+            char buffer[4096];
+            long count;
+            while ((count = syscall(SYS_getdents64, directory, buffer, sizeof(buffer))) > 0) {
+                for (long offset = 0; offset < count;) {
+                    auto entry = reinterpret_cast<struct dirent64*>(buffer + offset);
+                    offset += entry->d_reclen;
+
+                    int descriptor = 0;
+                    char const* name = entry->d_name;
+                    if (!*name) {
+                        continue;
+                    }
+                    for (; *name >= '0' && *name <= '9'; ++name) {
+                        descriptor = descriptor * 10 + (*name - '0');
+                    }
+                    if (*name || descriptor < first || descriptor == directory) {
+                        continue;
+                    }
+                    close(descriptor);
+                }
+            }
+            close(directory);
+            if (count == 0) {
+                return;
+            }
+        }
+#endif  // __linux__
+
+        // Close all descriptors up to the limit
+        auto limit = get_max_descriptor_limit();
+        for (decltype(limit) i = first; i < limit; ++i) {
+            close(i);
+        }
+    }
+
+#ifdef USE_POSIX_SPAWN
+    static int spawn(
+        pid_t& child,
+        string const& executable,
+        vector<char const*> const& args,
+        vector<char const*> const& envp,
+        int stdin_read,
+        int stdout_write,
+        int stderr_write,
+        bool new_group)
+    {
+        // posix_spawn starts the child without copying the parent's address space (which may host a Ruby VM)
+        posix_spawn_file_actions_t actions;
+        posix_spawnattr_t attributes;
+        int error = posix_spawn_file_actions_init(&actions);
+        if (error != 0) {
+            throw execution_exception("failed to initialize child process actions.");
+        }
+        error = posix_spawnattr_init(&attributes);
+        if (error != 0) {
+            posix_spawn_file_actions_destroy(&actions);
+            throw execution_exception("failed to initialize child process attributes.");
+        }
+
+        if ((error = posix_spawn_file_actions_adddup2(&actions, stdin_read, STDIN_FILENO)) == 0 &&
+            (error = posix_spawn_file_actions_adddup2(&actions, stdout_write, STDOUT_FILENO)) == 0) {
+            if (stderr_write >= 0) {
+                error = posix_spawn_file_actions_adddup2(&actions, stderr_write, STDERR_FILENO);
+            } else {
+                error = posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_RDWR, 0);
+            }
+        }
+
+        // Close all other descriptors in the child
+        short flags = 0;
+#ifdef __APPLE__
+        flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#else
+        if (error == 0) {
+            error = posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+        }
+#endif  // __APPLE__
+
+        // Start the child in its own process group so that it can be killed along with any process it starts
+        if (error == 0 && new_group) {
+            flags |= POSIX_SPAWN_SETPGROUP;
+            error = posix_spawnattr_setpgroup(&attributes, 0);
+        }
+        if (error == 0 && flags != 0) {
+            error = posix_spawnattr_setflags(&attributes, flags);
+        }
+
+        if (error == 0) {
+            error = posix_spawn(
+                &child,
+                executable.c_str(),
+                &actions,
+                &attributes,
+                const_cast<char* const*>(args.data()),
+                const_cast<char* const*>(envp.data()));
+        } else {
+            LOG_DEBUG("failed to set up redirection for child process: %1%.", strerror(error));
+        }
+
+        posix_spawnattr_destroy(&attributes);
+        posix_spawn_file_actions_destroy(&actions);
+        return error;
+    }
+#else
+    static int spawn(
+        pid_t& child,
+        string const& executable,
+        vector<char const*> const& args,
+        vector<char const*> const& envp,
+        int stdin_read,
+        int stdout_write,
+        int stderr_write,
+        bool new_group)
+    {
+        // Open the null device before forking so that the child doesn't allocate
+        scoped_descriptor dev_null(stderr_write >= 0 ? -1 : open("/dev/null", O_RDWR));
+        if (stderr_write < 0 && dev_null < 0) {
+            throw execution_exception("failed to open null device for child stderr.");
+        }
+
+        // Use a pipe to report a failure to exec back to the parent
+        int pipes[2];
+        if (!open_pipe(pipes)) {
+            throw execution_exception("failed to allocate pipe for child status.");
+        }
+        scoped_descriptor status_read(pipes[0]);
+        scoped_descriptor status_write(pipes[1]);
+
+        child = fork();
+        if (child < 0) {
+            throw execution_exception("failed to fork child process.");
+        }
+
+        if (child == 0) {
+            // Child continues here
+            // Only system calls are made from here on: the parent may have other threads that held locks when it forked
+            if (new_group) {
+                setpgid(0, 0);
+            }
+            if (dup2(stdin_read, STDIN_FILENO) != -1 &&
+                dup2(stdout_write, STDOUT_FILENO) != -1 &&
+                dup2(stderr_write >= 0 ? stderr_write : static_cast<int>(dev_null), STDERR_FILENO) != -1) {
+                // Keep the status pipe open until exec closes it
+                if (dup2(status_write, STDERR_FILENO + 1) != -1) {
+                    fcntl(STDERR_FILENO + 1, F_SETFD, FD_CLOEXEC);
+                    close_descriptors(STDERR_FILENO + 2);
+                    execve(executable.c_str(), const_cast<char* const*>(args.data()), const_cast<char* const*>(envp.data()));
+                }
+            }
+            int error = errno == 0 ? EXIT_FAILURE : errno;
+            if (write(STDERR_FILENO + 1, &error, sizeof(error)) == -1) {
+                // We don't really care if reporting the error failed
+            }
+            _exit(error);
+
+            // CHILD DOES NOT RETURN
+        }
+
+        // Also set the process group from the parent so that it is in place before the parent signals the group
+        if (new_group) {
+            setpgid(child, child);
+        }
+
+        // Wait for the exec to succeed (the pipe is closed without data) or fail (the error is written)
+        status_write.release();
+        int error = 0;
+        ssize_t count;
+        while ((count = read(status_read, &error, sizeof(error))) < 0 && errno == EINTR) {
+        }
+        if (count != sizeof(error)) {
+            return 0;
+        }
+        waitpid(child, nullptr, 0);
+        return error;
+    }
+#endif  // USE_POSIX_SPAWN
+
+    int start_child(
         string const& file,
+        string const& executable,
         vector<string> const* arguments,
         map<string, string> const* environment,
-        function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+        option_set<execution_options> const& options,
+        pid_t& child,
+        scoped_descriptor& output,
+        bool new_group,
+        scoped_descriptor* error_output)
     {
-        // Search for the executable
-        string executable = which(file);
-        log_execution(executable.empty() ? file : executable, arguments);
-        if (executable.empty()) {
-            LOG_DEBUG("%1% was not found on the PATH.", file);
-            if (options[execution_options::throw_on_nonzero_exit]) {
-                throw child_exit_exception(127, "", "child process returned non-zero exit status.");
+        // Build the arguments and environment of the child before starting it, so that the child only has to redirect and exec
+        // The first argument is the program name
+        // The given program arguments then follow
+        // The last element is a null to terminate the array
+        vector<char const*> args((arguments ? arguments->size() : 0) + 2 /* argv[0] + null */);
+        args[0] = file.c_str();
+        if (arguments) {
+            for (size_t i = 0; i < arguments->size(); ++i) {
+                args[i + 1] = arguments->at(i).c_str();
             }
-            return { false, "" };
+        }
+        auto variables = child_environment(environment, options);
+        vector<char const*> envp(variables->size() + 1 /* null */);
+        for (size_t i = 0; i < variables->size(); ++i) {
+            envp[i] = (*variables)[i].c_str();
         }
 
         // Create the pipes for stdin/stdout/stderr redirection
+        // The pipes are close-on-exec so that children started concurrently on other threads don't inherit them
         int pipes[2];
-        if (pipe(pipes) < 0) {
+        if (!open_pipe(pipes)) {
             throw execution_exception("failed to allocate pipe for input redirection.");
         }
         scoped_descriptor stdin_read(pipes[0]);
         scoped_descriptor stdin_write(pipes[1]);
 
-        if (pipe(pipes) < 0) {
+        if (!open_pipe(pipes)) {
             throw execution_exception("failed to allocate pipe for output redirection.");
         }
         scoped_descriptor stdout_read(pipes[0]);
         scoped_descriptor stdout_write(pipes[1]);
 
-        // Fork the child process
-        pid_t child = fork();
-        if (child < 0) {
-            throw execution_exception("failed to fork child process.");
+        // Capture stderr with its own pipe if requested; otherwise it is merged with stdout or discarded
+        scoped_descriptor stderr_read(-1);
+        scoped_descriptor stderr_write(-1);
+        if (error_output) {
+            if (!open_pipe(pipes)) {
+                throw execution_exception("failed to allocate pipe for error redirection.");
+            }
+            stderr_read = scoped_descriptor(pipes[0]);
+            stderr_write = scoped_descriptor(pipes[1]);
         }
+        int stderr_descriptor = error_output ? static_cast<int>(stderr_write) : (options[execution_options::redirect_stderr] ? static_cast<int>(stdout_write) : -1);
 
-        // A non-zero child pid means we're running in the context of the parent process
-        if (child)
-        {
-            // Close the unused descriptors
-            stdin_read.release();
-            stdout_write.release();
-            stdin_write.release();
-
-            string result = process_stream([&](string &buffer) {
-                buffer.resize(4096);
-                auto count = read(stdout_read, &buffer[0], buffer.size());
-                if (count < 0) {
-                    if (errno != EINTR) {
-                        throw execution_exception("failed to read child output.");
-                    }
+        // Start the child process, from the spawn helper if it is running
+        FACTER_PROBE1(exec__start, executable.c_str());
+        child = 0;
+        int error = 0;
+        if (!spawn_helper::spawn(error, child, executable, args, envp, stdout_write, stderr_descriptor, new_group)) {
+            error = spawn(child, executable, args, envp, stdin_read, stdout_write, stderr_descriptor, new_group);
+        }
+        FACTER_PROBE3(exec__spawn, executable.c_str(), child, error);
+        if (error != 0) {
+            LOG_DEBUG("failed to execute %1%: %2%.", executable, strerror(error));
+            return error;
+        }
+        scoped_statistics::record_process();
 
-                    // The call to read was interrupted by a signal before any data was read. Retry read.
-                    // See http://www.gnu.org/software/libc/manual/html_node/Interrupted-Primitives.html
-                    // This happens in Xcode's debugging.
-                    LOG_DEBUG("child pipe read was interrupted and will be retried.");
-                    errno = 0;
-                    buffer.resize(0);
-                    return true;
-                }
-                buffer.resize(count);
-                // Halt if nothing was read.
-                return count != 0;
-            }, callback, options);
-
-            // Close the read pipe
-            // If the child hasn't sent all the data yet, this may signal SIGPIPE on next write
-            stdout_read.release();
-
-            // Wait for the child to exit
-            bool success = false;
-            int status = 0;
-            waitpid(child, &status, 0);
-            if (WIFEXITED(status)) {
-                status = static_cast<char>(WEXITSTATUS(status));
-                LOG_DEBUG("process exited with status code %1%.", status);
-                if (status != 0 && options[execution_options::throw_on_nonzero_exit]) {
-                    throw child_exit_exception(status, result, "child process returned non-zero exit status.");
-                }
-                success = status == 0;
-            } else if (WIFSIGNALED(status)) {
-                status = static_cast<char>(WTERMSIG(status));
-                LOG_DEBUG("process was signaled with signal %1%.", status);
-                if (options[execution_options::throw_on_signal]) {
-                    throw child_signal_exception(status, result, "child process was terminated by signal.");
+        // The unused descriptors are closed when this returns
+        output = move(stdout_read);
+        if (error_output) {
+            *error_output = move(stderr_read);
+        }
+        return 0;
+    }
+
+    // Checks for the child's exit; reaped is set if the child was already reaped, after which its pid may be reused
+    static bool child_exited(pid_t child, bool* reaped = nullptr)
+    {
+        bool exited = false;
+        if (spawn_helper::exited(child, exited)) {
+            // The helper reaps its children as soon as they exit
+            if (reaped) {
+                *reaped = exited;
+            }
+            return exited;
+        }
+
+        // Check for the child's exit without reaping it
+        siginfo_t info;
+        info.si_pid = 0;
+        while (waitid(P_PID, child, &info, WEXITED | WNOHANG | WNOWAIT) != 0) {
+            if (errno != EINTR) {
+                // There is no such child to wait for, so it was reaped
+                if (reaped) {
+                    *reaped = true;
                 }
+                return true;
             }
-            return { success, move(result) };
         }
+        return info.si_pid == child;
+    }
 
-        // Child continues here
-        try
-        {
-            // Disable Ruby cleanup
-            // Ruby doesn't play nice with being forked
-            // The VM records the parent pid, so it doesn't like having ruby_cleanup called from a child process
-            ruby::api::cleanup = false;
+    // Signals the child's process group (or just the child) unless the child was reaped
+    // Once the child is reaped, its pid (and so the id of its process group) may belong to an unrelated process
+    static void signal_child(pid_t child, int signal, bool group)
+    {
+        bool reaped = false;
+        child_exited(child, &reaped);
+        if (reaped) {
+            LOG_DEBUG("child process %1% was already reaped and will not be signaled.", child);
+            return;
+        }
+        kill(group ? -child : child, signal);
+    }
 
-            if (dup2(stdin_read, STDIN_FILENO) == -1) {
-               throw execution_exception("failed to redirect child stdin.");
+    int reap_child(pid_t child)
+    {
+        FACTER_PROBE1(exec__wait, child);
+        int status = 0;
+        if (!spawn_helper::reap(child, status)) {
+            while (waitpid(child, &status, 0) < 0 && errno == EINTR) {
             }
+        }
+        FACTER_PROBE2(exec__end, child, status);
+        return status;
+    }
 
-            if (dup2(stdout_write, STDOUT_FILENO) == -1) {
-               throw execution_exception("failed to redirect child stdout.");
-            }
+    bool start_spawn_helper()
+    {
+        return spawn_helper::start();
+    }
 
-            if (options[execution_options::redirect_stderr]) {
-                if (dup2(stdout_write, STDERR_FILENO) == -1) {
-                    throw execution_exception("failed to redirect child stderr.");
-                }
-            } else {
-                // Redirect to null
-                scoped_descriptor dev_null(open("/dev/null", O_RDWR));
-                if (dev_null < 0 || dup2(dev_null, STDERR_FILENO) == -1) {
-                    throw execution_exception("failed to redirect child stderr to null.");
+    void stop_spawn_helper()
+    {
+        spawn_helper::stop();
+    }
+
+#ifdef __linux__
+    // The I/O priority class that only gets disk time when no other process wants it (see ioprio_set(2))
+    static int const ioprio_class_idle = 3;
+    static int const ioprio_class_shift = 13;
+    static int const ioprio_who_process = 1;
+#endif  // __linux__
+
+    bool lower_priority(vector<unsigned int> const& cpus)
+    {
+        bool success = true;
+
+        // On Linux, priorities and affinity belong to each thread, so apply them to every thread already started
+        vector<pid_t> threads;
+#ifdef __linux__
+        if (DIR* tasks = opendir("/proc/self/task")) {
+            while (dirent* entry = readdir(tasks)) {
+                if (isdigit(static_cast<unsigned char>(entry->d_name[0]))) {
+                    threads.push_back(static_cast<pid_t>(atoi(entry->d_name)));
                 }
             }
+            closedir(tasks);
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+#endif  // __linux__
+        if (threads.empty()) {
+            threads.push_back(0);
+        }
 
-            // Close all open file descriptors up to the limit
-            for (decltype(get_max_descriptor_limit()) i = 3; i < get_max_descriptor_limit(); ++i) {
-                close(i);
+        for (auto thread : threads) {
+            if (setpriority(PRIO_PROCESS, static_cast<id_t>(thread), 19) != 0) {
+                LOG_WARNING("could not lower the CPU priority of facter: %1% (%2%).", strerror(errno), errno);
+                success = false;
+                break;
             }
+        }
 
-            // Build a vector of pointers to the arguments
-            // The first element is the program name
-            // The given program arguments then follow
-            // The last element is a null to terminate the array
-            vector<char const*> args((arguments ? arguments->size() : 0) + 2 /* argv[0] + null */);
-            args[0] = file.c_str();
-            if (arguments) {
-                for (size_t i = 0; i < arguments->size(); ++i) {
-                    args[i + 1] = arguments->at(i).c_str();
+#ifdef __linux__
+        for (auto thread : threads) {
+            if (syscall(SYS_ioprio_set, ioprio_who_process, thread, ioprio_class_idle << ioprio_class_shift) != 0) {
+                LOG_WARNING("could not lower the I/O priority of facter: %1% (%2%).", strerror(errno), errno);
+                success = false;
+                break;
+            }
+        }
+        if (!cpus.empty()) {
+            for (auto thread : threads) {
+                if (sched_setaffinity(thread, sizeof(set), &set) != 0) {
+                    LOG_WARNING("could not restrict facter to the given processors: %1% (%2%).", strerror(errno), errno);
+                    success = false;
+                    break;
                 }
             }
+        }
+#else
+#ifdef __APPLE__
+        // Throttled I/O is inherited by child processes
+        if (setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE) != 0) {
+            LOG_WARNING("could not lower the I/O priority of facter: %1% (%2%).", strerror(errno), errno);
+            success = false;
+        }
+#endif  // __APPLE__
+        if (!cpus.empty()) {
+            LOG_WARNING("restricting facter to processors is not supported on this platform.");
+            success = false;
+        }
+#endif  // __linux__
+        return success;
+    }
+
+    static void terminate_child(pid_t child, string const& file, uint32_t timeout)
+    {
+        // Ask the child's process group to exit, then kill whatever remains once the grace period is over
+        LOG_DEBUG("terminating child process %1%: %2% did not exit within %3% seconds.", child, file, timeout);
+        signal_child(child, SIGTERM, true);
+        auto grace = chrono::steady_clock::now() + chrono::seconds(1);
+        while (!child_exited(child) && chrono::steady_clock::now() < grace) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+
+        // The group outlives the child if the child started other processes, so it is killed even if the child exited
+        // An exited child that is not yet reaped keeps its pid, so the group is still the child's
+        signal_child(child, SIGKILL, true);
+        reap_child(child);
+        throw timeout_exception((boost::format("%1% did not exit within %2% seconds and was killed.") % file % timeout).str(), static_cast<size_t>(child));
+    }
 
-            // Clear the environment if not merging
-            if (!options[execution_options::merge_environment] && environ) {
-                *environ = nullptr;
+    bool wait_child(pid_t child, string const& output, option_set<execution_options> const& options)
+    {
+        bool success = false;
+        int status = reap_child(child);
+        if (WIFEXITED(status)) {
+            status = static_cast<char>(WEXITSTATUS(status));
+            LOG_DEBUG("process exited with status code %1%.", status);
+            if (status != 0 && options[execution_options::throw_on_nonzero_exit]) {
+                throw child_exit_exception(status, output, "child process returned non-zero exit status.");
+            }
+            success = status == 0;
+        } else if (WIFSIGNALED(status)) {
+            status = static_cast<char>(WTERMSIG(status));
+            LOG_DEBUG("process was signaled with signal %1%.", status);
+            if (options[execution_options::throw_on_signal]) {
+                throw child_signal_exception(status, output, "child process was terminated by signal.");
             }
+        }
+        return success;
+    }
+
+    pair<bool, string> execute(
+        string const& file,
+        vector<string> const* arguments,
+        map<string, string> const* environment,
+        function<bool(string&)> callback,
+        function<bool(string&)> stderr_callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        // Don't start the child process if its output would be abandoned
+        scoped_deadline::check();
 
-            // Set the locale to C unless specified in the given environment
-            if (!environment || environment->count("LC_ALL") == 0) {
-                environment::set("LC_ALL", "C");
+        // Search for the executable
+        string executable = which(file);
+        log_execution(executable.empty() ? file : executable, arguments);
+        if (executable.empty()) {
+            LOG_DEBUG("%1% was not found on the PATH.", file);
+            if (options[execution_options::throw_on_nonzero_exit]) {
+                throw child_exit_exception(127, "", "child process returned non-zero exit status.");
             }
-            if (!environment || environment->count("LANG") == 0) {
-                environment::set("LANG", "C");
+            return { false, "" };
+        }
+
+        scoped_trace_span tracing("process", file, "command", scoped_trace_span::enabled() ? command_line(executable, arguments) : string());
+
+        // A child with a timeout is started in its own process group so that any process it starts is also killed
+        auto expiry = chrono::steady_clock::now() + chrono::seconds(timeout);
+        pid_t child = 0;
+        scoped_descriptor stdout_read(-1);
+        scoped_descriptor stderr_read(-1);
+        int error = start_child(file, executable, arguments, environment, options, child, stdout_read, timeout != 0, stderr_callback ? &stderr_read : nullptr);
+        if (error != 0) {
+            // The program could not be executed; report it the same as a child that failed to exec
+            if (options[execution_options::throw_on_nonzero_exit]) {
+                throw child_exit_exception(error, "", "child process returned non-zero exit status.");
             }
-            if (environment) {
-                for (auto const& variable : *environment) {
-                    environment::set(variable.first, variable.second);
+            return { false, "" };
+        }
+        scoped_log_context tagging(scoped_log_context::for_child(static_cast<long>(child)));
+
+        // Read stdout and, if captured separately, stderr until both are closed or their callbacks stop reading
+        output_processor output(move(callback), options);
+        unique_ptr<output_processor> error_output(stderr_callback ? new output_processor(move(stderr_callback), options) : nullptr);
+        scoped_descriptor* readers[] = { &stdout_read, &stderr_read };
+        output_processor* processors[] = { &output, error_output.get() };
+        pollfd descriptors[] = {
+            { stdout_read, POLLIN, 0 },
+            { stderr_read, POLLIN, 0 }
+        };
+        size_t streams = error_output ? 2 : 1;
+        while (streams > 0) {
+            // Wait for output in short intervals so that a timeout, deadline, or cancellation is noticed promptly
+            int interval = -1;
+            if (timeout != 0 || scoped_deadline::active()) {
+                auto now = chrono::steady_clock::now();
+                if (timeout != 0 && now >= expiry) {
+                    terminate_child(child, file, timeout);
+                }
+                auto remaining = scoped_deadline::remaining();
+                if (remaining == chrono::steady_clock::duration::zero()) {
+                    LOG_DEBUG("killing child process %1%: the deadline passed or resolution was cancelled.", child);
+                    signal_child(child, SIGKILL, timeout != 0);
+                    reap_child(child);
+                    throw deadline_exceeded_exception("child process did not exit before the deadline.");
+                }
+                if (timeout != 0) {
+                    remaining = min<chrono::steady_clock::duration>(remaining, expiry - now);
                 }
+                interval = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(min<chrono::steady_clock::duration>(remaining, chrono::milliseconds(100))).count()) + 1;
+            }
+            int ready = poll(descriptors, error_output ? 2 : 1, interval);
+            if (ready < 0 && errno != EINTR) {
+                throw execution_exception("failed to wait for child output.");
+            }
+            if (ready <= 0) {
+                continue;
             }
 
-            // Execute the given program and exit in case of failure
-            execv(executable.c_str(), const_cast<char* const*>(args.data()));
-            exit(errno == 0 ? EXIT_FAILURE : errno);
+            for (size_t i = 0; i < 2; ++i) {
+                // Closed pipes have a negative descriptor, which poll ignores
+                if (descriptors[i].fd < 0 || descriptors[i].revents == 0) {
+                    continue;
+                }
+                size_t size = 0;
+                auto buffer = processors[i]->prepare(size);
+                auto count = read(descriptors[i].fd, buffer, size);
+                if (count < 0) {
+                    processors[i]->commit(0);
+                    if (errno != EINTR) {
+                        throw execution_exception("failed to read child output.");
+                    }
+
+                    // The call to read was interrupted by a signal before any data was read. Retry read.
+                    // See http://www.gnu.org/software/libc/manual/html_node/Interrupted-Primitives.html
+                    // This happens in Xcode's debugging.
+                    LOG_DEBUG("child pipe read was interrupted and will be retried.");
+                    errno = 0;
+                    continue;
+                }
+                // Halt if nothing was read
+                if (processors[i]->commit(static_cast<size_t>(count)) && count != 0) {
+                    continue;
+                }
+
+                // Close the read pipe
+                // If the child hasn't sent all the data yet, this may signal SIGPIPE on next write
+                readers[i]->release();
+                descriptors[i].fd = -1;
+                --streams;
+            }
         }
-        catch (exception& ex)
-        {
-            // Write out any exception message to "stderr" and exit
-            if (options[execution_options::redirect_stderr]) {
-                string message = ex.what();
-                message += "\n";
-                int result = write(STDERR_FILENO, message.c_str(), message.size());
-                if (result == -1) {
-                    // We don't really care if writing the error message failed
+        string result = output.finish();
+        if (error_output) {
+            error_output->finish();
+        }
+
+        // The child may close its output before it exits, so wait for it to exit without reaping it until the timeout
+        if (timeout != 0) {
+            while (!child_exited(child)) {
+                if (chrono::steady_clock::now() >= expiry) {
+                    terminate_child(child, file, timeout);
                 }
+                this_thread::sleep_for(chrono::milliseconds(10));
             }
-            exit(EXIT_FAILURE);
         }
 
-        // CHILD DOES NOT RETURN
+        // Wait for the child to exit
+        bool success = wait_child(child, result, options);
+        return { success, move(result) };
     }
 
 }}  // namespace facter::executions
@@ -0,0 +1,172 @@
+#include <internal/execution/executor.hpp>
+#include <internal/execution/execution.hpp>
+#include <internal/execution/posix/execution.hpp>
+#include <internal/util/posix/scoped_descriptor.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <memory>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::util::posix;
+
+namespace facter { namespace execution {
+
+    string command_line(string const& file, vector<string> const* arguments);
+    void log_execution(string const& file, vector<string> const* arguments);
+
+    // A command whose child process is running
+    struct running_command
+    {
+        running_command(function<bool(string&)> const& callback, option_set<execution_options> const& options) :
+            processor(callback, options),
+            output(-1),
+            child(0),
+            start(chrono::steady_clock::now())
+        {
+        }
+
+        output_processor processor;
+        scoped_descriptor output;
+        pid_t child;
+        chrono::steady_clock::time_point start;
+    };
+
+    void executor::run()
+    {
+        // Don't start the child processes if their output would be abandoned
+        scoped_deadline::check();
+
+        exception_ptr failure;
+        vector<pair<command const*, unique_ptr<running_command>>> active;
+        vector<pollfd> descriptors;
+        size_t next = 0;
+
+        // Report a command that could not be started the same as a child that failed to exec
+        auto not_started = [&](command const& cmd, int status) {
+            if (cmd.options[execution_options::throw_on_nonzero_exit]) {
+                if (!failure) {
+                    failure = make_exception_ptr(child_exit_exception(status, "", "child process returned non-zero exit status."));
+                }
+                return;
+            }
+            if (cmd.completed) {
+                string output;
+                cmd.completed(false, output);
+            }
+        };
+
+        try {
+            while (next < _commands.size() || !active.empty()) {
+                // Start commands until the concurrency limit is reached
+                while (next < _commands.size() && active.size() < _concurrency) {
+                    auto const& cmd = _commands[next++];
+                    string executable = which(cmd.file);
+                    log_execution(executable.empty() ? cmd.file : executable, &cmd.arguments);
+                    if (executable.empty()) {
+                        LOG_DEBUG("%1% was not found on the PATH.", cmd.file);
+                        not_started(cmd, 127);
+                        continue;
+                    }
+                    unique_ptr<running_command> running(new running_command(cmd.callback, cmd.options));
+                    int error = start_child(cmd.file, executable, &cmd.arguments, nullptr, cmd.options, running->child, running->output);
+                    if (error != 0) {
+                        not_started(cmd, error);
+                        continue;
+                    }
+                    active.emplace_back(&cmd, move(running));
+                }
+                if (active.empty()) {
+                    continue;
+                }
+
+                // Wait for output in short intervals so that a deadline or cancellation is noticed promptly
+                int timeout = -1;
+                if (scoped_deadline::active()) {
+                    auto remaining = scoped_deadline::remaining();
+                    if (remaining == chrono::steady_clock::duration::zero()) {
+                        LOG_DEBUG("killing child processes: the deadline passed or resolution was cancelled.");
+                        throw deadline_exceeded_exception("child process did not exit before the deadline.");
+                    }
+                    timeout = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(min<chrono::steady_clock::duration>(remaining, chrono::milliseconds(100))).count()) + 1;
+                }
+                descriptors.clear();
+                for (auto const& command : active) {
+                    descriptors.push_back({ command.second->output, POLLIN, 0 });
+                }
+                int ready = poll(descriptors.data(), descriptors.size(), timeout);
+                if (ready < 0) {
+                    if (errno != EINTR) {
+                        throw execution_exception("failed to wait for child output.");
+                    }
+                    continue;
+                }
+
+                // Read from each child with output; a child is finished when its output closes or its callback stops reading
+                for (size_t i = descriptors.size(); i-- > 0;) {
+                    if (descriptors[i].revents == 0) {
+                        continue;
+                    }
+                    auto& running = *active[i].second;
+                    size_t size = 0;
+                    auto data = running.processor.prepare(size);
+                    auto count = read(running.output, data, size);
+                    if (count < 0) {
+                        running.processor.commit(0);
+                        if (errno != EINTR) {
+                            throw execution_exception("failed to read child output.");
+                        }
+                        continue;
+                    }
+                    if (running.processor.commit(static_cast<size_t>(count)) && count != 0) {
+                        continue;
+                    }
+
+                    auto const& cmd = *active[i].first;
+                    unique_ptr<running_command> finished = move(active[i].second);
+                    active.erase(active.begin() + i);
+
+                    // Close the read pipe
+                    // If the child hasn't sent all the data yet, this may signal SIGPIPE on next write
+                    string output = finished->processor.finish();
+                    finished->output.release();
+
+                    // The children run at once, so their spans overlap
+                    scoped_trace_span::record_async("process", cmd.file, finished->start, "command", scoped_trace_span::enabled() ? command_line(cmd.file, &cmd.arguments) : string());
+
+                    bool success = false;
+                    try {
+                        success = wait_child(finished->child, output, cmd.options);
+                    } catch (execution_failure_exception&) {
+                        // Let the other commands finish before reporting the failure
+                        if (!failure) {
+                            failure = current_exception();
+                        }
+                        continue;
+                    }
+                    if (cmd.completed) {
+                        cmd.completed(success, output);
+                    }
+                }
+            }
+        } catch (...) {
+            // Don't leave any children running
+            for (auto& command : active) {
+                kill(command.second->child, SIGKILL);
+                command.second->output.release();
+                reap_child(command.second->child);
+            }
+            throw;
+        }
+
+        if (failure) {
+            rethrow_exception(failure);
+        }
+    }
+
+}}  // namespace facter::execution
@@ -0,0 +1,511 @@
+#include <internal/execution/posix/spawn_helper.hpp>
+#include <internal/execution/posix/execution.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+namespace facter { namespace execution {
+
+    // A request to start a child; followed by the executable, the arguments, and the environment as null-terminated strings
+    struct spawn_request
+    {
+        uint32_t size;
+        uint32_t arguments;
+        uint32_t flags;
+    };
+
+    // The reply to a request: the process id of the child or the error that prevented it from being executed
+    struct spawn_reply
+    {
+        int32_t child;
+        int32_t error;
+    };
+
+    static uint32_t const capture_stderr = 1;
+    static uint32_t const new_process_group = 2;
+
+    // A request carries the child's stdout, the pipe to report the child's exit status on, and the child's stderr if captured
+    static size_t const max_request_descriptors = 3;
+
+    // The socket connected to the helper and the helper's process id; only used in this process
+    static boost::mutex helper_mutex;
+    static int helper_socket = -1;
+    static pid_t helper_process = 0;
+
+    // The pipes the exit status of each child started by the helper is reported on
+    static boost::mutex children_mutex;
+    static map<pid_t, int> helper_children;
+
+    // The pipe written to when the helper receives SIGCHLD; only used in the helper
+    static int child_signals = -1;
+
+    static void set_cloexec(int descriptor)
+    {
+        fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+    }
+
+    static bool open_pipe(int (&pipes)[2])
+    {
+        if (pipe(pipes) < 0) {
+            return false;
+        }
+        set_cloexec(pipes[0]);
+        set_cloexec(pipes[1]);
+        return true;
+    }
+
+    static bool write_all(int descriptor, void const* data, size_t size)
+    {
+        auto current = static_cast<char const*>(data);
+        while (size > 0) {
+#ifdef MSG_NOSIGNAL
+            // Don't raise SIGPIPE if the other end of a socket is gone
+            auto count = send(descriptor, current, size, MSG_NOSIGNAL);
+            if (count < 0 && errno == ENOTSOCK) {
+                count = write(descriptor, current, size);
+            }
+#else
+            auto count = write(descriptor, current, size);
+#endif  // MSG_NOSIGNAL
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            current += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    static bool read_all(int descriptor, void* data, size_t size)
+    {
+        auto current = static_cast<char*>(data);
+        while (size > 0) {
+            auto count = read(descriptor, current, size);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (count == 0) {
+                return false;
+            }
+            current += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    static bool send_request(int socket, spawn_request const& header, string const& payload, int const* descriptors, size_t count)
+    {
+        // The descriptors are sent with the first byte of the header
+        iovec data = { const_cast<spawn_request*>(&header), sizeof(header) };
+        union {
+            cmsghdr align;
+            char buffer[CMSG_SPACE(sizeof(int) * max_request_descriptors)];
+        } control;
+        memset(&control, 0, sizeof(control));
+
+        msghdr message = {};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+        auto descriptor_message = CMSG_FIRSTHDR(&message);
+        descriptor_message->cmsg_level = SOL_SOCKET;
+        descriptor_message->cmsg_type = SCM_RIGHTS;
+        descriptor_message->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        memcpy(CMSG_DATA(descriptor_message), descriptors, sizeof(int) * count);
+
+        int flags = 0;
+#ifdef MSG_NOSIGNAL
+        flags = MSG_NOSIGNAL;
+#endif  // MSG_NOSIGNAL
+        ssize_t sent;
+        while ((sent = sendmsg(socket, &message, flags)) < 0 && errno == EINTR) {
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        return
+            write_all(socket, reinterpret_cast<char const*>(&header) + sent, sizeof(header) - sent) &&
+            write_all(socket, payload.data(), payload.size());
+    }
+
+    static bool receive_request(int socket, spawn_request& header, string& payload, vector<int>& descriptors)
+    {
+        iovec data = { &header, sizeof(header) };
+        union {
+            cmsghdr align;
+            char buffer[CMSG_SPACE(sizeof(int) * max_request_descriptors)];
+        } control;
+
+        msghdr message = {};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        ssize_t received;
+        while ((received = recvmsg(socket, &message, 0)) < 0 && errno == EINTR) {
+        }
+        if (received <= 0) {
+            return false;
+        }
+        for (auto current = CMSG_FIRSTHDR(&message); current; current = CMSG_NXTHDR(&message, current)) {
+            if (current->cmsg_level != SOL_SOCKET || current->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            size_t count = (current->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; ++i) {
+                int descriptor;
+                memcpy(&descriptor, CMSG_DATA(current) + i * sizeof(int), sizeof(int));
+                // The helper's descriptors must not be inherited by the other children it starts
+                set_cloexec(descriptor);
+                descriptors.push_back(descriptor);
+            }
+        }
+        if (!read_all(socket, reinterpret_cast<char*>(&header) + received, sizeof(header) - received)) {
+            return false;
+        }
+        payload.resize(header.size);
+        return payload.empty() || read_all(socket, &payload[0], payload.size());
+    }
+
+    static void on_child_exit(int)
+    {
+        int saved = errno;
+        char signaled = 0;
+        if (write(child_signals, &signaled, 1) == -1) {
+            // The pipe is full, so the helper is already going to reap its children
+        }
+        errno = saved;
+    }
+
+    static spawn_reply start_child(spawn_request const& header, string const& payload, vector<int> const& descriptors, map<pid_t, int>& children)
+    {
+        spawn_reply reply = { 0, EINVAL };
+        bool capture = (header.flags & capture_stderr) != 0;
+        if (descriptors.size() != (capture ? 3u : 2u) || payload.empty() || payload.back() != '\0') {
+            return reply;
+        }
+
+        // Split the payload into the executable, the arguments, and the environment
+        vector<char const*> strings;
+        for (auto current = payload.data(), end = payload.data() + payload.size(); current < end; current += strlen(current) + 1) {
+            strings.push_back(current);
+        }
+        if (strings.size() < header.arguments + 1) {
+            return reply;
+        }
+        vector<char const*> args(strings.begin() + 1, strings.begin() + 1 + header.arguments);
+        args.push_back(nullptr);
+        vector<char const*> envp(strings.begin() + 1 + header.arguments, strings.end());
+        envp.push_back(nullptr);
+
+        int stdout_write = descriptors[0];
+        int stderr_write = capture ? descriptors[2] : -1;
+
+        // Use a pipe to learn whether the exec succeeded (the pipe is closed without data) or failed (the error is written)
+        int pipes[2];
+        if (!open_pipe(pipes)) {
+            reply.error = errno;
+            return reply;
+        }
+        int dev_null = open("/dev/null", O_RDWR);
+        if (dev_null < 0) {
+            reply.error = errno;
+            close(pipes[0]);
+            close(pipes[1]);
+            return reply;
+        }
+        set_cloexec(dev_null);
+
+        pid_t child = fork();
+        if (child == 0) {
+            // Restore what the helper changed; signal handlers are reset by exec
+            if (header.flags & new_process_group) {
+                setpgid(0, 0);
+            }
+            signal(SIGPIPE, SIG_DFL);
+            if (dup2(dev_null, STDIN_FILENO) != -1 &&
+                dup2(stdout_write, STDOUT_FILENO) != -1 &&
+                dup2(stderr_write >= 0 ? stderr_write : dev_null, STDERR_FILENO) != -1 &&
+                dup2(pipes[1], STDERR_FILENO + 1) != -1) {
+                set_cloexec(STDERR_FILENO + 1);
+                execve(strings[0], const_cast<char* const*>(args.data()), const_cast<char* const*>(envp.data()));
+            }
+            int error = errno == 0 ? EXIT_FAILURE : errno;
+            if (write(STDERR_FILENO + 1, &error, sizeof(error)) == -1) {
+                // We don't really care if reporting the error failed
+            }
+            _exit(error);
+
+            // CHILD DOES NOT RETURN
+        }
+        int error = child < 0 ? errno : 0;
+        close(dev_null);
+        close(pipes[1]);
+        if (child > 0 && read_all(pipes[0], &error, sizeof(error))) {
+            waitpid(child, nullptr, 0);
+        }
+        close(pipes[0]);
+        if (child < 0 || error != 0) {
+            reply.error = error;
+            return reply;
+        }
+
+        // Keep the status pipe until the child exits
+        children[child] = dup(descriptors[1]);
+        set_cloexec(children[child]);
+        reply.child = child;
+        reply.error = 0;
+        return reply;
+    }
+
+    static int serve(int socket)
+    {
+        // Don't hold this process's standard streams open
+        int dev_null = open("/dev/null", O_RDWR);
+        if (dev_null >= 0) {
+            dup2(dev_null, STDIN_FILENO);
+            dup2(dev_null, STDOUT_FILENO);
+            dup2(dev_null, STDERR_FILENO);
+            if (dev_null > STDERR_FILENO) {
+                close(dev_null);
+            }
+        }
+
+        // Reap children as they exit; the handler only wakes the loop below
+        int pipes[2];
+        if (!open_pipe(pipes)) {
+            return EXIT_FAILURE;
+        }
+        fcntl(pipes[0], F_SETFL, O_NONBLOCK);
+        fcntl(pipes[1], F_SETFL, O_NONBLOCK);
+        child_signals = pipes[1];
+        struct sigaction action = {};
+        action.sa_handler = on_child_exit;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+        sigaction(SIGCHLD, &action, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+
+        map<pid_t, int> children;
+        while (true) {
+            pollfd descriptors[] = {
+                { socket, POLLIN, 0 },
+                { pipes[0], POLLIN, 0 }
+            };
+            if (poll(descriptors, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return EXIT_FAILURE;
+            }
+
+            if (descriptors[1].revents != 0) {
+                char buffer[64];
+                while (read(pipes[0], buffer, sizeof(buffer)) > 0) {
+                }
+                int status = 0;
+                pid_t child;
+                while ((child = waitpid(-1, &status, WNOHANG)) > 0) {
+                    auto it = children.find(child);
+                    if (it == children.end()) {
+                        continue;
+                    }
+                    write_all(it->second, &status, sizeof(status));
+                    close(it->second);
+                    children.erase(it);
+                }
+            }
+
+            if (descriptors[0].revents != 0) {
+                // The helper exits when this process closes the socket or exits
+                spawn_request header;
+                string payload;
+                vector<int> received;
+                bool more = receive_request(socket, header, payload, received);
+                spawn_reply reply = { 0, EINVAL };
+                if (more) {
+                    reply = start_child(header, payload, received, children);
+                }
+                for (auto descriptor : received) {
+                    close(descriptor);
+                }
+                if (!more || !write_all(socket, &reply, sizeof(reply))) {
+                    return EXIT_SUCCESS;
+                }
+            }
+        }
+    }
+
+    bool spawn_helper::start()
+    {
+        boost::lock_guard<boost::mutex> lock(helper_mutex);
+        if (helper_socket >= 0) {
+            return true;
+        }
+
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+            LOG_DEBUG("failed to create socket for spawn helper: %1%.", strerror(errno));
+            return false;
+        }
+        set_cloexec(sockets[0]);
+        set_cloexec(sockets[1]);
+#ifdef SO_NOSIGPIPE
+        int enabled = 1;
+        setsockopt(sockets[0], SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif  // SO_NOSIGPIPE
+
+        pid_t helper = fork();
+        if (helper < 0) {
+            LOG_DEBUG("failed to fork spawn helper: %1%.", strerror(errno));
+            close(sockets[0]);
+            close(sockets[1]);
+            return false;
+        }
+        if (helper == 0) {
+            // Keep only the helper's end of the socket
+            int socket = STDERR_FILENO + 1;
+            if (sockets[1] != socket) {
+                dup2(sockets[1], socket);
+            }
+            set_cloexec(socket);
+            close_descriptors(socket + 1);
+            _exit(serve(socket));
+
+            // HELPER DOES NOT RETURN
+        }
+        close(sockets[1]);
+        helper_socket = sockets[0];
+        helper_process = helper;
+        LOG_DEBUG("started spawn helper process %1%.", helper);
+        return true;
+    }
+
+    void spawn_helper::stop()
+    {
+        boost::lock_guard<boost::mutex> lock(helper_mutex);
+        if (helper_socket < 0) {
+            return;
+        }
+        close(helper_socket);
+        helper_socket = -1;
+        waitpid(helper_process, nullptr, 0);
+        helper_process = 0;
+    }
+
+    bool spawn_helper::spawn(
+        int& error,
+        pid_t& child,
+        string const& executable,
+        vector<char const*> const& args,
+        vector<char const*> const& envp,
+        int stdout_write,
+        int stderr_write,
+        bool new_group)
+    {
+        boost::lock_guard<boost::mutex> lock(helper_mutex);
+        if (helper_socket < 0) {
+            return false;
+        }
+
+        spawn_request header = { 0, 0, 0 };
+        string payload = executable;
+        payload += '\0';
+        for (auto argument = args.data(); *argument; ++argument) {
+            payload += *argument;
+            payload += '\0';
+            ++header.arguments;
+        }
+        for (auto variable = envp.data(); *variable; ++variable) {
+            payload += *variable;
+            payload += '\0';
+        }
+        header.size = static_cast<uint32_t>(payload.size());
+        header.flags = (stderr_write >= 0 ? capture_stderr : 0) | (new_group ? new_process_group : 0);
+
+        int pipes[2];
+        if (!open_pipe(pipes)) {
+            throw execution_exception("failed to allocate pipe for child status.");
+        }
+        int descriptors[] = { stdout_write, pipes[1], stderr_write };
+        spawn_reply reply;
+        bool sent = send_request(helper_socket, header, payload, descriptors, stderr_write >= 0 ? 3 : 2);
+        close(pipes[1]);
+        if (!sent || !read_all(helper_socket, &reply, sizeof(reply))) {
+            // Start children from this process from now on
+            LOG_WARNING("spawn helper process %1% is no longer running: child processes will be started directly.", helper_process);
+            close(pipes[0]);
+            close(helper_socket);
+            helper_socket = -1;
+            waitpid(helper_process, nullptr, 0);
+            helper_process = 0;
+            return false;
+        }
+
+        error = reply.error;
+        if (error != 0) {
+            close(pipes[0]);
+            return true;
+        }
+        child = reply.child;
+        boost::lock_guard<boost::mutex> children_lock(children_mutex);
+        helper_children[child] = pipes[0];
+        return true;
+    }
+
+    bool spawn_helper::exited(pid_t child, bool& exited)
+    {
+        boost::lock_guard<boost::mutex> lock(children_mutex);
+        auto it = helper_children.find(child);
+        if (it == helper_children.end()) {
+            return false;
+        }
+        // The status is written (or the pipe is closed) once the child exits
+        pollfd descriptor = { it->second, POLLIN, 0 };
+        exited = poll(&descriptor, 1, 0) > 0;
+        return true;
+    }
+
+    bool spawn_helper::reap(pid_t child, int& status)
+    {
+        int descriptor;
+        {
+            boost::lock_guard<boost::mutex> lock(children_mutex);
+            auto it = helper_children.find(child);
+            if (it == helper_children.end()) {
+                return false;
+            }
+            descriptor = it->second;
+            helper_children.erase(it);
+        }
+        if (!read_all(descriptor, &status, sizeof(status))) {
+            // The helper exited before the child did; report the child as killed
+            LOG_DEBUG("exit status of child process %1% is unknown: the spawn helper exited.", child);
+            status = SIGKILL;
+        }
+        close(descriptor);
+        return true;
+    }
+
+}}  // namespace facter::execution
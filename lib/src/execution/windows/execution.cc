@@ -2,17 +2,24 @@
 #include <facter/util/environment.hpp>
 #include <facter/util/scoped_resource.hpp>
 #include <internal/execution/execution.hpp>
-#include <internal/util/scoped_env.hpp>
+#include <internal/execution/windows/execution.hpp>
+#include <internal/util/log_context.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <internal/util/statistics.hpp>
 #include <internal/util/windows/system_error.hpp>
 #include <internal/util/windows/windows.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/nowide/convert.hpp>
+#include <boost/format.hpp>
+#include <atomic>
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
 #include <cstring>
+#include <memory>
 
 using namespace std;
 using namespace facter::util;
@@ -23,11 +30,18 @@ using namespace boost::algorithm;
 
 namespace facter { namespace execution {
 
+    string command_line(string const& file, vector<string> const* arguments);
     void log_execution(string const& file, vector<string> const* arguments);
 
     const char *const command_shell = "cmd.exe";
     const char *const command_args = "/c";
 
+    pair<string, vector<string>> command_invocation(string const& command, vector<string> const& directories)
+    {
+        // Quoting and builtins differ between cmd.exe and programs, so commands are always run with the command shell
+        return make_pair(string(command_shell), vector<string>{ command_args, expand_command(command, directories) });
+    }
+
     struct extpath_helper
     {
         vector<string> const& ext_paths() const
@@ -63,7 +77,7 @@ namespace facter { namespace execution {
         return isfile;
     }
 
-    string which(string const& file, vector<string> const& directories)
+    string search_executable(string const& file, vector<string> const& directories)
     {
         // On Windows, everything has execute permission; Ruby determined
         // executability based on extension {com, exe, bat, cmd}. We'll do the
@@ -95,6 +109,44 @@ namespace facter { namespace execution {
         return {};
     }
 
+    bool start_spawn_helper()
+    {
+        // Windows doesn't fork, so starting a child doesn't copy this process
+        return false;
+    }
+
+    void stop_spawn_helper()
+    {
+    }
+
+    bool lower_priority(vector<unsigned int> const& cpus)
+    {
+        bool success = true;
+
+        // Child processes inherit the idle priority class; background mode also lowers this process's I/O priority
+        if (!SetPriorityClass(GetCurrentProcess(), IDLE_PRIORITY_CLASS)) {
+            LOG_WARNING("could not lower the CPU priority of facter: %1%.", system_error());
+            success = false;
+        }
+        if (!SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN)) {
+            LOG_WARNING("could not lower the I/O priority of facter: %1%.", system_error());
+            success = false;
+        }
+        if (!cpus.empty()) {
+            DWORD_PTR mask = 0;
+            for (auto cpu : cpus) {
+                if (cpu < sizeof(mask) * 8) {
+                    mask |= static_cast<DWORD_PTR>(1) << cpu;
+                }
+            }
+            if (!mask || !SetProcessAffinityMask(GetCurrentProcess(), mask)) {
+                LOG_WARNING("could not restrict facter to the given processors: %1%.", system_error());
+                success = false;
+            }
+        }
+        return success;
+    }
+
     // Create a pipe, throwing if there's an error. Returns {read, write} handles.
     static tuple<scoped_resource<HANDLE>, scoped_resource<HANDLE>> CreatePipeThrow()
     {
@@ -156,13 +208,303 @@ namespace facter { namespace execution {
         return commandline;
     }
 
+    // Create a pipe whose read end supports overlapped I/O, throwing if there's an error. Returns {read, write} handles.
+    // Anonymous pipes don't support overlapped I/O, so a uniquely named pipe is used instead.
+    static tuple<scoped_resource<HANDLE>, scoped_resource<HANDLE>> CreateOverlappedPipeThrow()
+    {
+        static atomic<unsigned long> serial(0);
+        auto name = boost::nowide::widen((boost::format("\\\\.\\pipe\\facter-%1%-%2%") % GetCurrentProcessId() % ++serial).str());
+
+        HANDLE tmpHandleRd = CreateNamedPipeW(
+            name.c_str(),
+            PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_WAIT,
+            1,              /* Only the child writes to the pipe */
+            64 * 1024,
+            64 * 1024,
+            0,
+            NULL);          /* The read end isn't inherited by the child */
+        if (tmpHandleRd == INVALID_HANDLE_VALUE) {
+            throw execution_exception("pipe could not be created");
+        }
+        scoped_resource<HANDLE> handleRd(move(tmpHandleRd), CloseHandle);
+
+        SECURITY_ATTRIBUTES saAttr = {};
+        saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+        saAttr.bInheritHandle = TRUE;
+        saAttr.lpSecurityDescriptor = NULL;
+
+        HANDLE tmpHandleWr = CreateFileW(name.c_str(), GENERIC_WRITE, 0, &saAttr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (tmpHandleWr == INVALID_HANDLE_VALUE) {
+            throw execution_exception("pipe could not be created");
+        }
+        return make_tuple(move(handleRd), scoped_resource<HANDLE>(move(tmpHandleWr), CloseHandle));
+    }
+
+    child_process::child_process() :
+        id(0),
+        process(nullptr, nullptr),
+        job(nullptr, nullptr),
+        output(nullptr, nullptr),
+        error_output(nullptr, nullptr),
+        input(nullptr, nullptr)
+    {
+    }
+
+    pipe_reader::pipe_reader(HANDLE pipe, output_processor& processor, bool signal) :
+        _pipe(pipe),
+        _processor(processor),
+        _event(nullptr, nullptr),
+        _overlapped(),
+        _pending(false)
+    {
+        if (signal) {
+            // A manual-reset event, so that the result can still be retrieved after a wait on the event
+            HANDLE event = CreateEventW(NULL, TRUE, FALSE, NULL);
+            if (!event) {
+                throw execution_exception("failed to create an event for child output.");
+            }
+            _event = scoped_resource<HANDLE>(move(event), CloseHandle);
+        }
+    }
+
+    pipe_reader::~pipe_reader()
+    {
+        // The buffer and OVERLAPPED must remain valid until a pending read finishes, so cancel it and wait
+        if (_pending) {
+            DWORD count;
+            CancelIoEx(_pipe, &_overlapped);
+            GetOverlappedResult(_pipe, &_overlapped, &count, TRUE);
+            _processor.commit(0);
+        }
+    }
+
+    bool pipe_reader::start()
+    {
+        size_t size = 0;
+        auto buffer = _processor.prepare(size);
+
+        _overlapped = {};
+        _overlapped.hEvent = _event;
+
+        // A read that completes immediately still signals the event and queues a completion packet
+        if (ReadFile(_pipe, buffer, static_cast<DWORD>(size), NULL, &_overlapped) || GetLastError() == ERROR_IO_PENDING) {
+            _pending = true;
+            return true;
+        }
+        auto error = GetLastError();
+        _processor.commit(0);
+        if (error == ERROR_BROKEN_PIPE) {
+            return false;
+        }
+        throw execution_exception("failed to read child output.");
+    }
+
+    bool pipe_reader::complete()
+    {
+        _pending = false;
+
+        DWORD count = 0;
+        if (!GetOverlappedResult(_pipe, &_overlapped, &count, FALSE)) {
+            auto error = GetLastError();
+            _processor.commit(0);
+            if (error == ERROR_BROKEN_PIPE || error == ERROR_OPERATION_ABORTED) {
+                return false;
+            }
+            throw execution_exception("failed to read child output.");
+        }
+        return _processor.commit(count);
+    }
+
+    HANDLE pipe_reader::event() const
+    {
+        return _event;
+    }
+
+    void start_child(
+        string const& executable,
+        vector<string> const* arguments,
+        map<string, string> const* environment,
+        option_set<execution_options> const& options,
+        bool capture_stderr,
+        child_process& child,
+        bool pipe_input)
+    {
+        // Build the environment block of the child rather than changing this process' environment around
+        // CreateProcess, so that other threads never see the child's variables.
+        // Environment variables must be sorted alphabetically and case-insensitive,
+        // so copy them all into the same map with case-insensitive key compare:
+        //   http://msdn.microsoft.com/en-us/library/windows/desktop/ms682009(v=vs.85).aspx
+        std::map<string, string, bool(*)(string const&, string const&)> sortedEnvironment(
+            [](string const& a, string const& b) { return ilexicographical_compare(a, b); });
+        if (options[execution_options::merge_environment]) {
+            util::environment::each([&](string& name, string& value) {
+                // Per-drive current directories (e.g. "=C:=C:\\") have names starting with '='
+                if (name.empty()) {
+                    auto pos = value.find('=');
+                    if (pos == string::npos) {
+                        return true;
+                    }
+                    name = "=" + value.substr(0, pos);
+                    value.erase(0, pos + 1);
+                }
+                sortedEnvironment[name] = move(value);
+                return true;
+            });
+        }
+
+        // Set the locale to C unless specified in the given environment
+        if (!environment || environment->count("LC_ALL") == 0) {
+            sortedEnvironment["LC_ALL"] = "C";
+        }
+        if (!environment || environment->count("LANG") == 0) {
+            sortedEnvironment["LANG"] = "C";
+        }
+        if (environment) {
+            for (auto const& kv : *environment) {
+                LOG_DEBUG("child environment %1%=%2%", kv.first, kv.second);
+                sortedEnvironment[kv.first] = kv.second;
+            }
+        }
+
+        // An environment block is a NULL-terminated list of NULL-terminated strings.
+        vector<wchar_t> modified_environ;
+        for (auto const& variable : sortedEnvironment) {
+            auto var = boost::nowide::widen(variable.first + "=" + variable.second);
+            modified_environ.insert(modified_environ.end(), var.begin(), var.end());
+            modified_environ.push_back(L'\0');
+        }
+        modified_environ.push_back(L'\0');
+
+        // See http://msdn.microsoft.com/en-us/library/windows/desktop/ms682499(v=vs.85).aspx
+        // for details on redirecting input/output.
+        scoped_resource<HANDLE> stdInRd, stdInWr;
+        tie(stdInRd, stdInWr) = CreatePipeThrow();
+        if (!SetHandleInformation(stdInWr, HANDLE_FLAG_INHERIT, 0)) {
+            throw execution_exception("pipe could not be modified");
+        }
+
+        scoped_resource<HANDLE> stdOutWr;
+        tie(child.output, stdOutWr) = CreateOverlappedPipeThrow();
+
+        scoped_resource<HANDLE> stdErrWr(nullptr, nullptr);
+        if (capture_stderr) {
+            tie(child.error_output, stdErrWr) = CreateOverlappedPipeThrow();
+        }
+
+        // Execute the command with arguments. Prefix arguments with the executable, or quoted arguments won't work.
+        auto commandLine = arguments ?
+            boost::nowide::widen(ArgvToCommandLine({executable}) + " " + ArgvToCommandLine(*arguments)) : L"";
+
+        STARTUPINFO startupInfo = {};
+        startupInfo.cb = sizeof(startupInfo);
+        startupInfo.dwFlags |= STARTF_USESTDHANDLES;
+        startupInfo.hStdInput = stdInRd;
+        startupInfo.hStdOutput = stdOutWr;
+        if (capture_stderr) {
+            startupInfo.hStdError = stdErrWr;
+        } else if (options[execution_options::redirect_stderr]) {
+            startupInfo.hStdError = stdOutWr;
+        } else {
+            startupInfo.hStdError = INVALID_HANDLE_VALUE;
+        }
+
+        PROCESS_INFORMATION procInfo = {};
+
+        // The child is started suspended so that it's in its job before it can start any processes of its own
+        bool success = CreateProcessW(
+                boost::nowide::widen(executable).c_str(),
+                &commandLine[0], /* Pass a modifiable string buffer; the contents may be modified */
+                NULL,           /* Don't allow child process to inherit process handle */
+                NULL,           /* Don't allow child process to inherit thread handle */
+                TRUE,           /* Inherit handles from the calling process for communication */
+                CREATE_NO_WINDOW | CREATE_SUSPENDED | CREATE_UNICODE_ENVIRONMENT,
+                modified_environ.data(),
+                NULL,           /* Use existing current directory */
+                &startupInfo,   /* STARTUPINFO for child process */
+                &procInfo);     /* PROCESS_INFORMATION pointer for output */
+
+        // Release unused pipes, to avoid any races in process completion.
+        // The child's input stays open if it's written to; otherwise the child reads an empty stdin.
+        if (success && pipe_input) {
+            child.input = move(stdInWr);
+        }
+        stdInWr.release();
+        stdInRd.release();
+        stdOutWr.release();
+        stdErrWr.release();
+
+        if (!success) {
+            throw execution_exception("child process failed to start");
+        }
+        scoped_statistics::record_process();
+        child.id = procInfo.dwProcessId;
+        child.process = scoped_resource<HANDLE>(move(procInfo.hProcess), CloseHandle);
+        scoped_resource<HANDLE> hThread(move(procInfo.hThread), CloseHandle);
+
+        // Assigning the child can fail if this process is in a job that doesn't allow nesting (before Windows 8)
+        // In that case only the child itself can be terminated
+        HANDLE job = CreateJobObjectW(NULL, NULL);
+        if (job) {
+            if (AssignProcessToJobObject(job, child.process)) {
+                child.job = scoped_resource<HANDLE>(move(job), CloseHandle);
+            } else {
+                LOG_DEBUG("child process %1% could not be assigned to a job: %2%.", child.id, system_error());
+                CloseHandle(job);
+            }
+        }
+        ResumeThread(hThread);
+    }
+
+    void terminate_child(child_process& child)
+    {
+        if (child.job) {
+            TerminateJobObject(child.job, EXIT_FAILURE);
+        } else {
+            TerminateProcess(child.process, EXIT_FAILURE);
+        }
+        WaitForSingleObject(child.process, INFINITE);
+    }
+
+    bool wait_child(child_process& child, string const& output, option_set<execution_options> const& options)
+    {
+        auto waitStatus = WaitForSingleObject(child.process, INFINITE);
+        if (waitStatus != WAIT_OBJECT_0) {
+            // Not a mutex, and there is no timeout, so only WAIT_FAILED should be possible.
+            assert(waitStatus == WAIT_FAILED);
+            throw execution_exception("error waiting on execution");
+        }
+
+        // Now check the process return status.
+        DWORD exitCode;
+        if (!GetExitCodeProcess(child.process, &exitCode)) {
+            throw execution_exception("error retrieving exit code of completed process");
+        }
+        if (exitCode == 0) {
+            return true;
+        }
+
+        // Process signaled finished, so it should not return STILL_ACTIVE.
+        assert(exitCode != STILL_ACTIVE);
+        if (options[execution_options::throw_on_nonzero_exit]) {
+            throw child_exit_exception(exitCode, output, "child process returned non-zero exit status.");
+        }
+        LOG_DEBUG("child process returned non-zero exit status (%1%).", exitCode);
+        return false;
+    }
+
     pair<bool, string> execute(
         string const& file,
         vector<string> const* arguments,
         map<string, string> const* environment,
         function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+        function<bool(string&)> stderr_callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
     {
+        // Don't start the child process if its output would be abandoned
+        scoped_deadline::check();
+
         // Search for the executable
         string executable = which(file);
         log_execution(executable.empty() ? file : executable, arguments);
@@ -174,158 +516,93 @@ namespace facter { namespace execution {
             return { false, "" };
         }
 
-        // Setup the execution environment
-        vector<char> modified_environ;
-        vector<scoped_env> scoped_environ;
-        if (options[execution_options::merge_environment]) {
-            // Modify the existing environment, then restore it after. There's no way to modify environment variables
-            // after the child has started. An alternative would be to use GetEnvironmentStrings and add/modify the block,
-            // but searching for and modifying existing environment strings to update would be cumbersome in that form.
-            // See http://msdn.microsoft.com/en-us/library/windows/desktop/ms682009(v=vs.85).aspx
-            if (!environment || environment->count("LC_ALL") == 0) {
-                scoped_environ.emplace_back("LC_ALL", "C");
-            }
-            if (!environment || environment->count("LANG") == 0) {
-                scoped_environ.emplace_back("LANG", "C");
+        scoped_trace_span tracing("process", file, "command", scoped_trace_span::enabled() ? command_line(executable, arguments) : string());
+        child_process child;
+        start_child(executable, arguments, environment, options, static_cast<bool>(stderr_callback), child);
+        scoped_log_context tagging(scoped_log_context::for_child(static_cast<long>(child.id)));
+
+        // The child and the processes it started are terminated on timeout
+        auto expiry = chrono::steady_clock::now() + chrono::seconds(timeout);
+        auto timed_out = [&]() {
+            LOG_DEBUG("terminating child process %1%: %2% did not exit within %3% seconds.", child.id, file, timeout);
+            terminate_child(child);
+            throw timeout_exception((boost::format("%1% did not exit within %2% seconds and was killed.") % file % timeout).str(), static_cast<size_t>(child.id));
+        };
+
+        // Read stdout and stderr together; the pipes are overlapped so both reads can be waited on at once
+        output_processor output(move(callback), options);
+        unique_ptr<output_processor> error_output(stderr_callback ? new output_processor(move(stderr_callback), options) : nullptr);
+        {
+            vector<unique_ptr<pipe_reader>> readers;
+            readers.emplace_back(new pipe_reader(child.output, output, true));
+            if (error_output) {
+                readers.emplace_back(new pipe_reader(child.error_output, *error_output, true));
             }
-            if (environment) {
-                for (auto const& kv : *environment) {
-                    // Use scoped_env to save the old state and restore it on return.
-                    LOG_DEBUG("child environment %1%=%2%", kv.first, kv.second);
-                    scoped_environ.emplace_back(kv.first, kv.second);
+            for (size_t i = readers.size(); i-- > 0;) {
+                if (!readers[i]->start()) {
+                    readers.erase(readers.begin() + i);
                 }
             }
-        } else {
-            // We aren't inheriting the environment, so create an environment block instead of changing existing env.
-            // Environment variables must be sorted alphabetically and case-insensitive,
-            // so copy them all into the same map with case-insensitive key compare:
-            //   http://msdn.microsoft.com/en-us/library/windows/desktop/ms682009(v=vs.85).aspx
-            std::map<string, string, bool(*)(string const&, string const&)> sortedEnvironment(
-                [](string const& a, string const& b) { return ilexicographical_compare(a, b); });
-            if (environment) {
-                sortedEnvironment.insert(environment->begin(), environment->end());
-            }
-
-            // Insert LANG and LC_ALL if they aren't already present. Emplace ensures this behavior.
-            sortedEnvironment.emplace("LANG", "C");
-            sortedEnvironment.emplace("LC_ALL", "C");
 
-            // An environment block is a NULL-terminated list of NULL-terminated strings.
-            for (auto const& variable : sortedEnvironment) {
-                LOG_DEBUG("child environment %1%=%2%", variable.first, variable.second);
-                string var = variable.first + "=" + variable.second;
-                for (auto c : var) {
-                    modified_environ.push_back(c);
+            vector<HANDLE> events;
+            while (!readers.empty()) {
+                // Wait for output in short intervals so that a timeout, deadline, or cancellation is noticed promptly
+                DWORD interval = INFINITE;
+                if (timeout != 0 || scoped_deadline::active()) {
+                    auto now = chrono::steady_clock::now();
+                    if (timeout != 0 && now >= expiry) {
+                        timed_out();
+                    }
+                    auto remaining = scoped_deadline::remaining();
+                    if (remaining == chrono::steady_clock::duration::zero()) {
+                        LOG_DEBUG("terminating child process: the deadline passed or resolution was cancelled.");
+                        terminate_child(child);
+                        throw deadline_exceeded_exception("child process did not exit before the deadline.");
+                    }
+                    if (timeout != 0) {
+                        remaining = min<chrono::steady_clock::duration>(remaining, expiry - now);
+                    }
+                    interval = static_cast<DWORD>(chrono::duration_cast<chrono::milliseconds>(min<chrono::steady_clock::duration>(remaining, chrono::milliseconds(100))).count()) + 1;
                 }
-                modified_environ.push_back('\0');
-            }
-            modified_environ.push_back('\0');
-        }
-
-        // Execute the command, reading the results into a buffer until there's no more to read.
-        // See http://msdn.microsoft.com/en-us/library/windows/desktop/ms682499(v=vs.85).aspx
-        // for details on redirecting input/output.
-        try {
-            scoped_resource<HANDLE> stdInRd, stdInWr;
-            tie(stdInRd, stdInWr) = CreatePipeThrow();
-            if (!SetHandleInformation(stdInWr, HANDLE_FLAG_INHERIT, 0)) {
-                throw execution_exception("pipe could not be modified");
-            }
-
-            scoped_resource<HANDLE> stdOutRd, stdOutWr;
-            tie(stdOutRd, stdOutWr) = CreatePipeThrow();
-            if (!SetHandleInformation(stdOutRd, HANDLE_FLAG_INHERIT, 0)) {
-                throw execution_exception("pipe could not be modified");
-            }
-
-            scoped_resource<HANDLE> stdErrRd, stdErrWr;
-
-            // Execute the command with arguments. Prefix arguments with the executable, or quoted arguments won't work.
-            auto commandLine = arguments ?
-                boost::nowide::widen(ArgvToCommandLine({executable}) + " " + ArgvToCommandLine(*arguments)) : L"";
 
-            STARTUPINFO startupInfo = {};
-            startupInfo.cb = sizeof(startupInfo);
-            startupInfo.dwFlags |= STARTF_USESTDHANDLES;
-            startupInfo.hStdInput = stdInRd;
-            startupInfo.hStdOutput = stdOutWr;
-            if (options[execution_options::redirect_stderr]) {
-                startupInfo.hStdError = stdOutWr;
-            } else {
-                startupInfo.hStdError = INVALID_HANDLE_VALUE;
-            }
+                events.clear();
+                for (auto const& reader : readers) {
+                    events.push_back(reader->event());
+                }
+                auto waitStatus = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, interval);
+                if (waitStatus == WAIT_TIMEOUT) {
+                    continue;
+                }
+                if (waitStatus >= WAIT_OBJECT_0 + events.size()) {
+                    throw execution_exception("failed to wait for child output.");
+                }
 
-            PROCESS_INFORMATION procInfo = {};
-
-            bool success = CreateProcessW(
-                    boost::nowide::widen(executable).c_str(),
-                    &commandLine[0], /* Pass a modifiable string buffer; the contents may be modified */
-                    NULL,           /* Don't allow child process to inherit process handle */
-                    NULL,           /* Don't allow child process to inherit thread handle */
-                    TRUE,           /* Inherit handles from the calling process for communication */
-                    CREATE_NO_WINDOW,
-                    options[execution_options::merge_environment] ? NULL : modified_environ.data(),
-                    NULL,           /* Use existing current directory */
-                    &startupInfo,   /* STARTUPINFO for child process */
-                    &procInfo);     /* PROCESS_INFORMATION pointer for output */
-
-            // Release unused pipes, to avoid any races in process completion.
-            stdInWr.release();
-            stdInRd.release();
-            stdOutWr.release();
-            stdErrWr.release();
-
-            if (!success) {
-                throw execution_exception("child process failed to start");
-            }
-            scoped_resource<HANDLE> hProcess(move(procInfo.hProcess), CloseHandle);
-            scoped_resource<HANDLE> hThread(move(procInfo.hThread), CloseHandle);
-
-            string result = process_stream([&](string &buffer) {
-                DWORD count;
-                buffer.resize(4096);
-                auto readSucceeded = ReadFile(stdOutRd, &buffer[0], buffer.size(), &count, NULL);
-                if (count != 0 && !readSucceeded) {
-                    // Not an asynchronous read, so it won't return with pending IO.
-                    assert(GetLastError() != ERROR_IO_PENDING);
-                    throw execution_exception("failed to read child stdout");
+                // A pipe is finished when it's closed or its callback stops reading
+                auto index = waitStatus - WAIT_OBJECT_0;
+                if (!readers[index]->complete() || !readers[index]->start()) {
+                    readers.erase(readers.begin() + index);
                 }
-                buffer.resize(count);
-                // Halt if nothing was read.
-                return count != 0;
-            }, callback, options);
-
-            // Close the read pipe; this may be done before all data is read when the callback returns false
-            // If the child hasn't sent all the data yet, this may signal SIGPIPE on next write
-            stdOutRd.release();
-
-            auto waitStatus = WaitForSingleObject(hProcess, INFINITE);
-            if (waitStatus != WAIT_OBJECT_0) {
-                // Not a mutex, and specified INFINITE timeout, so only WAIT_FAILED should be possible.
-                assert(waitStatus == WAIT_FAILED);
-                throw execution_exception("error waiting on execution");
             }
+        }
 
-            // Now check the process return status.
-            DWORD exitCode;
-            if (!GetExitCodeProcess(hProcess, &exitCode)) {
-                throw execution_exception("error retrieving exit code of completed process");
-            }
+        // Close the read pipes; this may be done before all data is read when a callback returns false
+        // If the child hasn't sent all the data yet, this may signal SIGPIPE on next write
+        child.output.release();
+        child.error_output.release();
+        string result = output.finish();
+        if (error_output) {
+            error_output->finish();
+        }
 
-            if (exitCode != 0) {
-                // Process signaled finished, so it should not return STILL_ACTIVE.
-                assert(exitCode != STILL_ACTIVE);
-                throw child_exit_exception(exitCode, result, "child process returned non-zero exit status.");
-            }
-            return { true, move(result) };
-        } catch (child_exit_exception &e) {
-            if (options[execution_options::throw_on_nonzero_exit]) {
-                throw;
-            } else {
-                LOG_DEBUG("%1% (%2%): %3%", e.what(), e.status_code(), system_error());
-                return { false, move(e.output()) };
+        // The child may close its output before it exits, so wait for it only until the timeout
+        if (timeout != 0) {
+            auto remaining = chrono::duration_cast<chrono::milliseconds>(expiry - chrono::steady_clock::now());
+            if (WaitForSingleObject(child.process, static_cast<DWORD>(max<chrono::milliseconds::rep>(remaining.count(), 0))) == WAIT_TIMEOUT) {
+                timed_out();
             }
         }
+        bool success = wait_child(child, result, options);
+        return { success, move(result) };
     }
 
 }}  // namespace facter::executions
@@ -0,0 +1,161 @@
+#include <internal/execution/executor.hpp>
+#include <internal/execution/execution.hpp>
+#include <internal/execution/windows/execution.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+using namespace facter::util;
+
+namespace facter { namespace execution {
+
+    string command_line(string const& file, vector<string> const* arguments);
+    void log_execution(string const& file, vector<string> const* arguments);
+
+    // A command whose child process is running
+    struct running_command
+    {
+        running_command(function<bool(string&)> const& callback, option_set<execution_options> const& options) :
+            processor(callback, options),
+            start(chrono::steady_clock::now())
+        {
+        }
+
+        output_processor processor;
+        child_process child;
+        unique_ptr<pipe_reader> reader;
+        chrono::steady_clock::time_point start;
+    };
+
+    void executor::run()
+    {
+        // Don't start the child processes if their output would be abandoned
+        scoped_deadline::check();
+
+        // Every output pipe is associated with one completion port, so the reads of all the children are waited on together
+        scoped_resource<HANDLE> port(CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1), CloseHandle);
+        if (!static_cast<HANDLE>(port)) {
+            throw execution_exception("failed to create a completion port for child output.");
+        }
+
+        exception_ptr failure;
+        vector<pair<command const*, unique_ptr<running_command>>> active;
+        size_t next = 0;
+
+        // Finish a command whose output was closed or whose callback stopped reading
+        auto finish = [&](size_t index) {
+            auto const& cmd = *active[index].first;
+            unique_ptr<running_command> finished = move(active[index].second);
+            active.erase(active.begin() + index);
+
+            // Close the read pipe
+            finished->reader.reset();
+            finished->child.output.release();
+            string output = finished->processor.finish();
+
+            // The children run at once, so their spans overlap
+            scoped_trace_span::record_async("process", cmd.file, finished->start, "command", scoped_trace_span::enabled() ? command_line(cmd.file, &cmd.arguments) : string());
+
+            bool success = false;
+            try {
+                success = wait_child(finished->child, output, cmd.options);
+            } catch (execution_failure_exception&) {
+                // Let the other commands finish before reporting the failure
+                if (!failure) {
+                    failure = current_exception();
+                }
+                return;
+            }
+            if (cmd.completed) {
+                cmd.completed(success, output);
+            }
+        };
+
+        try {
+            while (next < _commands.size() || !active.empty()) {
+                // Start commands until the concurrency limit is reached
+                while (next < _commands.size() && active.size() < _concurrency) {
+                    auto const& cmd = _commands[next++];
+                    string executable = which(cmd.file);
+                    log_execution(executable.empty() ? cmd.file : executable, &cmd.arguments);
+                    if (executable.empty()) {
+                        LOG_DEBUG("%1% was not found on the PATH.", cmd.file);
+                        if (cmd.options[execution_options::throw_on_nonzero_exit]) {
+                            if (!failure) {
+                                failure = make_exception_ptr(child_exit_exception(127, "", "child process returned non-zero exit status."));
+                            }
+                        } else if (cmd.completed) {
+                            string output;
+                            cmd.completed(false, output);
+                        }
+                        continue;
+                    }
+                    unique_ptr<running_command> running(new running_command(cmd.callback, cmd.options));
+                    start_child(executable, &cmd.arguments, nullptr, cmd.options, false, running->child);
+                    auto key = reinterpret_cast<ULONG_PTR>(running.get());
+                    if (!CreateIoCompletionPort(running->child.output, port, key, 0)) {
+                        terminate_child(running->child);
+                        throw execution_exception("failed to wait for child output.");
+                    }
+                    running->reader.reset(new pipe_reader(running->child.output, running->processor, false));
+                    active.emplace_back(&cmd, move(running));
+                    if (!active.back().second->reader->start()) {
+                        finish(active.size() - 1);
+                    }
+                }
+                if (active.empty()) {
+                    continue;
+                }
+
+                // Wait for output in short intervals so that a deadline or cancellation is noticed promptly
+                DWORD interval = INFINITE;
+                if (scoped_deadline::active()) {
+                    auto remaining = scoped_deadline::remaining();
+                    if (remaining == chrono::steady_clock::duration::zero()) {
+                        LOG_DEBUG("terminating child processes: the deadline passed or resolution was cancelled.");
+                        throw deadline_exceeded_exception("child process did not exit before the deadline.");
+                    }
+                    interval = static_cast<DWORD>(chrono::duration_cast<chrono::milliseconds>(min<chrono::steady_clock::duration>(remaining, chrono::milliseconds(100))).count()) + 1;
+                }
+
+                // A failed read still dequeues its packet; only a timeout or an error of the port itself leaves it null
+                DWORD count = 0;
+                ULONG_PTR key = 0;
+                OVERLAPPED* overlapped = nullptr;
+                if (!GetQueuedCompletionStatus(port, &count, &key, &overlapped, interval) && !overlapped) {
+                    if (GetLastError() == WAIT_TIMEOUT) {
+                        continue;
+                    }
+                    throw execution_exception("failed to wait for child output.");
+                }
+
+                auto it = find_if(active.begin(), active.end(), [&](pair<command const*, unique_ptr<running_command>> const& command) {
+                    return reinterpret_cast<ULONG_PTR>(command.second.get()) == key;
+                });
+                if (it == active.end()) {
+                    continue;
+                }
+                auto& reader = *it->second->reader;
+                if (reader.complete() && reader.start()) {
+                    continue;
+                }
+                finish(static_cast<size_t>(it - active.begin()));
+            }
+        } catch (...) {
+            // Don't leave any children running
+            for (auto& command : active) {
+                terminate_child(command.second->child);
+                command.second->reader.reset();
+            }
+            throw;
+        }
+
+        if (failure) {
+            rethrow_exception(failure);
+        }
+    }
+
+}}  // namespace facter::execution
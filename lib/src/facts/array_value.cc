@@ -1,8 +1,13 @@
 #include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
 #include <facter/facts/scalar_value.hpp>
+#include <internal/facts/memory_usage.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/facts/value_hash.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
+#include <algorithm>
 
 using namespace std;
 using namespace rapidjson;
@@ -20,18 +25,27 @@ namespace facter { namespace facts {
         value::operator=(static_cast<value&&>(other));
         if (this != &other) {
             _elements = std::move(other._elements);
+            _deferred = other._deferred;
+            _hash = other._hash.load();
         }
         return *this;
     }
 
-    void array_value::add(unique_ptr<value> value)
+    void array_value::add(shared_ptr<value const> value)
     {
         if (!value) {
             LOG_DEBUG("null value cannot be added to array.");
             return;
         }
 
+        _deferred = _deferred || value->deferred();
         _elements.emplace_back(move(value));
+        _hash = 0;
+    }
+
+    shared_ptr<value const> array_value::share(size_t i) const
+    {
+        return i < _elements.size() ? _elements[i] : nullptr;
     }
 
     bool array_value::empty() const
@@ -47,7 +61,11 @@ namespace facter { namespace facts {
     void array_value::each(function<bool(value const*)> func) const
     {
         for (auto const& element : _elements) {
-            if (!func(element.get())) {
+            auto val = lazy_value::resolve(element.get());
+            if (!val) {
+                continue;
+            }
+            if (!func(val)) {
                 break;
             }
         }
@@ -59,32 +77,83 @@ namespace facter { namespace facts {
         value.Reserve(_elements.size(), allocator);
 
         for (auto const& element : _elements) {
+            if (!lazy_value::resolve(element.get())) {
+                continue;
+            }
             rapidjson::Value child;
             element->to_json(allocator, child);
             value.PushBack(child, allocator);
         }
     }
 
+    void array_value::to_msgpack(msgpack_writer& writer) const
+    {
+        // The element count is written first, so count the elements that have values
+        size_t count = count_if(_elements.begin(), _elements.end(), [](shared_ptr<value const> const& element) {
+            return lazy_value::resolve(element.get()) != nullptr;
+        });
+        writer.start_array(count);
+
+        for (auto const& element : _elements) {
+            if (!lazy_value::resolve(element.get())) {
+                continue;
+            }
+            element->to_msgpack(writer);
+        }
+    }
+
     value const* array_value::operator[](size_t i) const
     {
         if (i >= _elements.size()) {
             return nullptr;
         }
-        return _elements[i].get();
+        return lazy_value::resolve(_elements[i].get());
     }
 
-    ostream& array_value::write(ostream& os, bool quoted, unsigned int level) const
+    bool array_value::equals(value const& other) const
     {
-        if (_elements.empty()) {
-            os << "[]";
-            return os;
+        auto ptr = value_cast<array_value>(lazy_value::resolve(&other));
+        if (!ptr) {
+            return false;
+        }
+        if (ptr == this) {
+            return true;
+        }
+        if (hash() != ptr->hash()) {
+            return false;
+        }
+        // Compare only the elements that have values; lazy elements without a value are ignored
+        vector<value const*> first;
+        each([&](value const* element) {
+            first.push_back(element);
+            return true;
+        });
+        vector<value const*> second;
+        ptr->each([&](value const* element) {
+            second.push_back(element);
+            return true;
+        });
+        if (first.size() != second.size()) {
+            return false;
         }
+        for (size_t i = 0; i < first.size(); ++i) {
+            if (!first[i]->equals(*second[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-        // Write out the elements in the array
-        os << "[\n";
+    ostream& array_value::write(ostream& os, bool quoted, unsigned int level) const
+    {
+        // Write out the elements in the array that have values
         bool first = true;
         for (auto const& element : _elements) {
+            if (!lazy_value::resolve(element.get())) {
+                continue;
+            }
             if (first) {
+                os << "[\n";
                 first = false;
             } else {
                 os << ",\n";
@@ -92,6 +161,10 @@ namespace facter { namespace facts {
             fill_n(ostream_iterator<char>(os), level * 2, ' ');
             element->write(os, true /* always quote strings in an array */, level + 1);
         }
+        if (first) {
+            os << "[]";
+            return os;
+        }
         os << "\n";
         fill_n(ostream_iterator<char>(os), (level > 0 ? (level - 1) : 0) * 2, ' ');
         os << "]";
@@ -102,10 +175,62 @@ namespace facter { namespace facts {
     {
         emitter << BeginSeq;
         for (auto const& element : _elements) {
+            if (!lazy_value::resolve(element.get())) {
+                continue;
+            }
             element->write(emitter);
         }
         emitter << EndSeq;
         return emitter;
     }
 
+    bool array_value::deferred() const
+    {
+        return _deferred;
+    }
+
+    unique_ptr<value> array_value::clone() const
+    {
+        auto copy = make_value<array_value>(hidden());
+        copy->_elements.reserve(_elements.size());
+        for (auto const& element : _elements) {
+            // Share elements that can no longer change; copy the rest so the copy has no lazy values
+            if (!element->deferred()) {
+                copy->_elements.push_back(element);
+                continue;
+            }
+            auto child = element->clone();
+            if (child) {
+                copy->_elements.emplace_back(move(child));
+            }
+        }
+        copy->_hash = _hash.load();
+        return move(copy);
+    }
+
+    uint64_t array_value::hash() const
+    {
+        auto hash = _hash.load(memory_order_relaxed);
+        if (hash != 0) {
+            return hash;
+        }
+        // Lazy elements without a value are skipped, as they are when comparing
+        hash = hash_integer(hash_basis, static_cast<uint64_t>(type()));
+        each([&](value const* element) {
+            hash = hash_integer(hash, element->hash());
+            return true;
+        });
+        _hash.store(hash, memory_order_relaxed);
+        return hash;
+    }
+
+    size_t array_value::memory_usage() const
+    {
+        size_t usage = sizeof(array_value) + _elements.capacity() * sizeof(shared_ptr<value const>);
+        for (auto const& element : _elements) {
+            usage += shared_control_block_size + element->memory_usage();
+        }
+        return usage;
+    }
+
 }}  // namespace facter::facts
@@ -2,7 +2,9 @@
 #include <internal/facts/posix/kernel_resolver.hpp>
 #include <internal/facts/resolvers/operating_system_resolver.hpp>
 #include <internal/facts/bsd/uptime_resolver.hpp>
-#include <internal/facts/bsd/filesystem_resolver.hpp>
+#include <internal/facts/posix/load_resolver.hpp>
+#include <internal/facts/freebsd/disk_resolver.hpp>
+#include <internal/facts/freebsd/filesystem_resolver.hpp>
 #include <internal/facts/posix/ssh_resolver.hpp>
 #include <internal/facts/posix/identity_resolver.hpp>
 #include <internal/facts/posix/timezone_resolver.hpp>
@@ -16,7 +18,9 @@ namespace facter { namespace facts {
         add(make_shared<posix::kernel_resolver>());
         add(make_shared<resolvers::operating_system_resolver>());
         add(make_shared<bsd::uptime_resolver>());
-        add(make_shared<bsd::filesystem_resolver>());
+        add(make_shared<posix::load_resolver>());
+        add(make_shared<freebsd::filesystem_resolver>());
+        add(make_shared<freebsd::disk_resolver>());
         add(make_shared<posix::ssh_resolver>());
         add(make_shared<posix::identity_resolver>());
         add(make_shared<posix::timezone_resolver>());
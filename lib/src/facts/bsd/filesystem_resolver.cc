@@ -33,6 +33,13 @@ namespace facter { namespace facts { namespace bsd {
 
         // Populate an entry for each mounted file system
         for (auto& fs : filesystems) {
+            result.filesystems.insert(fs.f_fstypename);
+
+            // getfsstat with MNT_NOWAIT returns cached sizes, so remote file systems can't block here
+            if (is_filesystem_excluded(fs.f_fstypename)) {
+                continue;
+            }
+
             mountpoint point;
             point.name = fs.f_mntonname;
             point.device = fs.f_mntfromname;
@@ -41,8 +48,6 @@ namespace facter { namespace facts { namespace bsd {
             point.available = fs.f_bsize * fs.f_bfree;
             point.options = to_options(fs);
             result.mountpoints.emplace_back(move(point));
-
-            result.filesystems.insert(fs.f_fstypename);
         }
         return result;
     }
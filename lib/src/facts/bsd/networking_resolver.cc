@@ -1,10 +1,16 @@
 #include <internal/facts/bsd/networking_resolver.hpp>
 #include <internal/util/bsd/scoped_ifaddrs.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
 #include <facter/execution/execution.hpp>
+#include <internal/execution/executor.hpp>
 #include <facter/util/file.hpp>
 #include <facter/util/directory.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
 #include <netinet/in.h>
 
 using namespace std;
@@ -14,6 +20,49 @@ using namespace facter::execution;
 
 namespace facter { namespace facts { namespace bsd {
 
+    // The interfaces whose DHCP servers were not in a lease file; their servers are found together on first access
+    struct deferred_dhcp_servers
+    {
+        boost::mutex mutex;
+        bool found = false;
+        vector<string> interfaces;
+        map<string, string> servers;
+    };
+
+    static string read_dhcpcd_server(string const& path)
+    {
+        // dhcpcd stores the DHCP message of the lease: the fixed BOOTP fields and magic cookie are followed by the options
+        string lease;
+        if (!file::read(path, lease) || lease.size() <= 240 || lease.compare(236, 4, "\x63\x82\x53\x63") != 0) {
+            return {};
+        }
+        size_t offset = 240;
+        while (offset < lease.size()) {
+            auto code = static_cast<uint8_t>(lease[offset]);
+            if (code == 0) {
+                // Pad option
+                ++offset;
+                continue;
+            }
+            if (code == 255 || offset + 1 >= lease.size()) {
+                break;
+            }
+            auto length = static_cast<uint8_t>(lease[offset + 1]);
+            if (offset + 2 + length > lease.size()) {
+                break;
+            }
+            // Option 54 is the server identifier
+            if (code == 54 && length == 4) {
+                auto bytes = reinterpret_cast<uint8_t const*>(lease.data() + offset + 2);
+                return (boost::format("%1%.%2%.%3%.%4%") %
+                        static_cast<int>(bytes[0]) % static_cast<int>(bytes[1]) %
+                        static_cast<int>(bytes[2]) % static_cast<int>(bytes[3])).str();
+            }
+            offset += 2 + length;
+        }
+        return {};
+    }
+
     networking_resolver::data networking_resolver::collect_data(collection& facts)
     {
         auto data = posix::networking_resolver::collect_data(facts);
@@ -39,22 +88,42 @@ namespace facter { namespace facts { namespace bsd {
             interface_map.insert({ ptr->ifa_name, ptr });
         }
 
-        data.primary_interface = get_primary_interface();
-        if (data.primary_interface.empty()) {
+        populate_interfaces(facts, data, interface_map);
+        return data;
+    }
+
+    void networking_resolver::populate_interfaces(collection& facts, data& result, multimap<string, ifaddrs const*> const& interface_map)
+    {
+        result.primary_interface = get_primary_interface();
+        if (result.primary_interface.empty()) {
             LOG_DEBUG("no primary interface found: using first interface with an assigned address.");
         }
 
-        // Start by getting the DHCP servers
-        auto dhcp_servers = find_dhcp_servers();
+        // Start by getting the DHCP servers, unless they weren't queried as looking them up may spawn processes
+        bool dhcp_queried =
+            facts.is_queried(string(fact::networking) + ".dhcp") ||
+            facts.is_queried(string(fact::networking) + ".interfaces.*.dhcp") ||
+            facts.is_queried(fact::dhcp_servers);
+        map<string, string> dhcp_servers;
+        if (dhcp_queried) {
+            dhcp_servers = find_dhcp_servers();
+        }
+        auto deferred = make_shared<deferred_dhcp_servers>();
 
         // Walk the interfaces
-        decltype(interface_map.begin()) it = interface_map.begin();
+        auto it = interface_map.begin();
         while (it != interface_map.end()) {
             string const& name = it->first;
 
+            // Skip filtered interfaces before anything else is looked up for them
+            if (!is_interface_included(result, name)) {
+                it = interface_map.upper_bound(name);
+                continue;
+            }
+
             // If we don't have a primary interface yet, walk the addresses
             // If there's a non-loopback address assigned, treat it as primary
-            if (data.primary_interface.empty()) {
+            if (result.primary_interface.empty()) {
                 for (auto addr_it = it; addr_it != interface_map.end() && addr_it->first == name; ++addr_it) {
                     ifaddrs const *addr = addr_it->second;
                     if (addr->ifa_addr->sa_family != AF_INET && addr->ifa_addr->sa_family != AF_INET6) {
@@ -63,7 +132,7 @@ namespace facter { namespace facts { namespace bsd {
 
                     string ip = address_to_string(addr->ifa_addr, addr->ifa_netmask);
                     if (!boost::starts_with(ip, "127.") && ip != "::1" && !boost::starts_with(ip, "fe80")) {
-                        data.primary_interface = name;
+                        result.primary_interface = name;
                         break;
                     }
                 }
@@ -81,15 +150,27 @@ namespace facter { namespace facts { namespace bsd {
 
             // Populate the interface's DHCP server value
             auto dhcp_server_it = dhcp_servers.find(name);
-            if (dhcp_server_it == dhcp_servers.end()) {
-                iface.dhcp_server = find_dhcp_server(name);
+            if (!dhcp_queried) {
+                LOG_DEBUG("DHCP server for interface %1% was not queried and will not be resolved.", name);
+            } else if (dhcp_server_it == dhcp_servers.end()) {
+                // Finding the server may spawn a process, so defer it until a server is accessed and then find them all at once
+                deferred->interfaces.push_back(name);
+                string interface_name = name;
+                iface.find_dhcp_server = [this, deferred, interface_name]() {
+                    boost::lock_guard<boost::mutex> lock(deferred->mutex);
+                    if (!deferred->found) {
+                        deferred->servers = find_dhcp_servers(deferred->interfaces);
+                        deferred->found = true;
+                    }
+                    auto it = deferred->servers.find(interface_name);
+                    return it == deferred->servers.end() ? string() : it->second;
+                };
             } else {
                 iface.dhcp_server = dhcp_server_it->second;
             }
 
-            data.interfaces.emplace_back(move(iface));
+            result.interfaces.emplace_back(move(iface));
         }
-        return data;
     }
 
     void networking_resolver::populate_address(interface& iface, ifaddrs const* addr) const
@@ -186,25 +267,61 @@ namespace facter { namespace facts { namespace bsd {
                     return true;
                 });
                 return true;
-            }, "^dhclient.*lease.*$");
+            }, directory::name_filter::glob("dhclient*lease*"));
+        }
+
+        // Also read the leases of dhcpcd, which are named after the interface (e.g. "eth0.lease" or "dhcpcd-eth0.lease")
+        static vector<pair<string, string>> const dhcpcd_search_directories = {
+            { "/var/lib/dhcpcd", "^.+\\.lease$" },
+            { "/var/lib/dhcpcd5", "^.+\\.lease$" },
+            { "/var/db/dhcpcd", "^.+\\.lease$" },
+            { "/var/db", "^dhcpcd-.+\\.lease$" }
+        };
+
+        for (auto const& search : dhcpcd_search_directories) {
+            LOG_DEBUG("searching \"%1%\" for dhcpcd lease files.", search.first);
+            directory::each_file(search.first, [&](string const& path) {
+                string interface = path.substr(path.find_last_of('/') + 1);
+                interface.erase(interface.size() - 6);
+                if (boost::starts_with(interface, "dhcpcd-")) {
+                    interface.erase(0, 7);
+                }
+                if (servers.count(interface)) {
+                    return true;
+                }
+                LOG_DEBUG("reading \"%1%\" for dhcpcd lease information.", path);
+                string server = read_dhcpcd_server(path);
+                if (!server.empty()) {
+                    servers.emplace(move(interface), move(server));
+                }
+                return true;
+            }, search.second);
         }
         return servers;
     }
 
-    string networking_resolver::find_dhcp_server(string const& interface) const
+    map<string, string> networking_resolver::find_dhcp_servers(vector<string> const& interfaces) const
     {
-        // Use dhcpcd if it's present to get the interface's DHCP lease information
-        // This assumes we've already searched for the interface with dhclient
-        string value;
-        execution::each_line("dhcpcd", { "-U", interface }, [&value](string& line) {
-            if (boost::starts_with(line, "dhcp_server_identifier=")) {
-                value = line.substr(23);
-                boost::trim(value);
-                return false;
-            }
-            return true;
-        });
-        return value;
+        // Use dhcpcd if it's present to get the interfaces' DHCP lease information
+        // This assumes we've already searched the lease files; the lookups are independent, so run them concurrently
+        map<string, string> servers;
+        if (interfaces.empty() || which("dhcpcd").empty()) {
+            return servers;
+        }
+        executor commands;
+        for (auto const& interface : interfaces) {
+            commands.each_line("dhcpcd", { "-U", interface }, [&servers, interface](string& line) {
+                if (boost::starts_with(line, "dhcp_server_identifier=")) {
+                    string value = line.substr(23);
+                    boost::trim(value);
+                    servers.emplace(interface, move(value));
+                    return false;
+                }
+                return true;
+            }, nullptr);
+        }
+        commands.run();
+        return servers;
     }
 
 }}}  // namespace facter::facts::bsd
@@ -1,18 +1,19 @@
 #include <internal/facts/bsd/uptime_resolver.hpp>
+#include <internal/util/bsd/sysctl.hpp>
 #include <ctime>
-#include <sys/sysctl.h>
+#include <sys/time.h>
 
 using namespace std;
+using namespace facter::util::bsd;
 
 namespace facter { namespace facts { namespace bsd {
 
     int64_t uptime_resolver::get_uptime()
     {
         // this approach adapted from: http://stackoverflow.com/a/11676260/1004272
+        sysctl_snapshot snapshot;
         timeval boottime;
-        size_t len = sizeof(boottime);
-        int mib[2] = { CTL_KERN, KERN_BOOTTIME };
-        if (sysctl(mib, 2, &boottime, &len, NULL, 0) == 0) {
+        if (snapshot.get_struct("kern.boottime", boottime)) {
             time_t bsec = boottime.tv_sec;
             time_t now = time(NULL);
             return now - bsec;
@@ -0,0 +1,135 @@
+#include <internal/facts/builtin_facts.hpp>
+#include <facter/facts/fact.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    // The built-in fact names, in the order of their ids; names must be unique (the structured zone keys are not fact names)
+    static constexpr char const* names[] = {
+        fact::kernel, fact::kernel_version, fact::kernel_release, fact::kernel_major_version, fact::os, fact::operating_system,
+        fact::os_family, fact::operating_system_release, fact::operating_system_major_release, fact::lsb_dist_id, fact::lsb_dist_release,
+        fact::lsb_dist_codename, fact::lsb_dist_description, fact::lsb_dist_major_release, fact::lsb_dist_minor_release, fact::lsb_release,
+        fact::networking, fact::hostname, fact::ipaddress, fact::ipaddress6, fact::mtu, fact::netmask, fact::netmask6, fact::network,
+        fact::network6, fact::macaddress, fact::interfaces, fact::domain, fact::fqdn, fact::dhcp_servers, fact::block_device,
+        fact::block_devices, fact::processors, fact::processor, fact::processor_count, fact::physical_processor_count, fact::hardware_isa,
+        fact::hardware_model, fact::architecture, fact::dmi, fact::bios_vendor, fact::bios_version, fact::bios_release_date,
+        fact::board_asset_tag, fact::board_manufacturer, fact::board_product_name, fact::board_serial_number, fact::chassis_asset_tag,
+        fact::manufacturer, fact::product_name, fact::serial_number, fact::uuid, fact::chassis_type, fact::system_uptime, fact::uptime,
+        fact::uptime_days, fact::uptime_hours, fact::uptime_seconds, fact::selinux, fact::selinux_enforced, fact::selinux_policyversion,
+        fact::selinux_current_mode, fact::selinux_config_mode, fact::selinux_config_policy, fact::ssh, fact::ssh_dsa_key, fact::ssh_rsa_key,
+        fact::ssh_ecdsa_key, fact::ssh_ed25519_key, fact::sshfp_dsa, fact::sshfp_rsa, fact::sshfp_ecdsa, fact::sshfp_ed25519,
+        fact::system_profiler, fact::sp_boot_mode, fact::sp_boot_rom_version, fact::sp_boot_volume, fact::sp_cpu_type,
+        fact::sp_current_processor_speed, fact::sp_kernel_version, fact::sp_l2_cache_core, fact::sp_l3_cache, fact::sp_local_host_name,
+        fact::sp_machine_model, fact::sp_machine_name, fact::sp_number_processors, fact::sp_os_version, fact::sp_packages,
+        fact::sp_physical_memory, fact::sp_platform_uuid, fact::sp_secure_vm, fact::sp_serial_number, fact::sp_smc_version_system,
+        fact::sp_uptime, fact::sp_user_name, fact::macosx_buildversion, fact::macosx_productname, fact::macosx_productversion,
+        fact::macosx_productversion_major, fact::macosx_productversion_minor, fact::windows_system32, fact::virtualization,
+        fact::is_virtual, fact::identity, fact::id, fact::gid, fact::timezone, fact::mountpoints, fact::filesystems, fact::disks,
+        fact::partitions, fact::memory, fact::memoryfree, fact::memoryfree_mb, fact::memorysize, fact::memorysize_mb, fact::swapfree,
+        fact::swapfree_mb, fact::swapsize, fact::swapsize_mb, fact::swapencrypted, fact::zfs_version, fact::zfs_featurenumbers,
+        fact::zpool_version, fact::zpool_featurenumbers, fact::zpools, fact::zones, fact::zonename, fact::solaris_zones, fact::ec2_metadata,
+        fact::ec2_userdata, fact::gce, fact::az_metadata, fact::openstack_metadata, fact::digitalocean_metadata, fact::ruby,
+        fact::rubyplatform, fact::rubysitedir, fact::rubyversion, fact::path, fact::cgroup, fact::namespaces, fact::load_averages,
+        fact::pressure, fact::utilization
+    };
+
+    static constexpr size_t name_count = sizeof(names) / sizeof(names[0]);
+
+    // Each bucket of about four names has a seed that places them in distinct slots (hash and displace)
+    static constexpr size_t bucket_count = 64;
+    static constexpr size_t slot_count = 256;
+
+    static_assert(name_count < slot_count, "there must be more slots than built-in fact names.");
+
+    struct perfect_hash
+    {
+        uint32_t seeds[bucket_count];
+        // The id of the name in each slot, plus one; empty slots are 0
+        uint16_t slots[slot_count];
+    };
+
+    static uint32_t hash(char const* name, size_t length, uint32_t seed)
+    {
+        // FNV-1a, finished with the MurmurHash3 mixer so that the low bits depend on every bit of the seed
+        uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (size_t i = 0; i < length; ++i) {
+            h = (h ^ static_cast<unsigned char>(name[i])) * 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    static perfect_hash build()
+    {
+        perfect_hash table = {};
+
+        vector<vector<uint16_t>> buckets(bucket_count);
+        for (size_t id = 0; id < name_count; ++id) {
+            buckets[hash(names[id], strlen(names[id]), 0) % bucket_count].push_back(static_cast<uint16_t>(id));
+        }
+
+        // Place the largest buckets first, while most slots are still free
+        vector<size_t> order(bucket_count);
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&](size_t first, size_t second) {
+            return buckets[first].size() > buckets[second].size();
+        });
+
+        vector<size_t> placed;
+        for (auto index : order) {
+            auto const& bucket = buckets[index];
+            for (uint32_t seed = 1; !bucket.empty(); ++seed) {
+                placed.clear();
+                for (auto id : bucket) {
+                    auto slot = hash(names[id], strlen(names[id]), seed) % slot_count;
+                    if (table.slots[slot] || find(placed.begin(), placed.end(), slot) != placed.end()) {
+                        break;
+                    }
+                    placed.push_back(slot);
+                }
+                if (placed.size() == bucket.size()) {
+                    for (size_t i = 0; i < bucket.size(); ++i) {
+                        table.slots[placed[i]] = bucket[i] + 1;
+                    }
+                    table.seeds[index] = seed;
+                    break;
+                }
+            }
+        }
+        return table;
+    }
+
+    size_t builtin_fact_count()
+    {
+        return name_count;
+    }
+
+    size_t builtin_fact_id(string const& name)
+    {
+        // The table only depends on the names, so it is built once
+        static perfect_hash const table = build();
+
+        auto seed = table.seeds[hash(name.data(), name.size(), 0) % bucket_count];
+        size_t slot = table.slots[hash(name.data(), name.size(), seed) % slot_count];
+        if (slot == 0 || name != names[slot - 1]) {
+            return no_builtin_fact;
+        }
+        return slot - 1;
+    }
+
+    char const* builtin_fact_name(size_t id)
+    {
+        return id < name_count ? names[id] : nullptr;
+    }
+
+}}  // namespace facter::facts
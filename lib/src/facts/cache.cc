@@ -0,0 +1,672 @@
+#include <internal/facts/cache.hpp>
+#include <internal/facts/json.hpp>
+#include <internal/facts/value_hash.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/resolver.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/util/file.hpp>
+#include <facter/util/string.hpp>
+#include <facter/version.h>
+#include <leatherman/logging/logging.hpp>
+#include <rapidjson/reader.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+using namespace facter::util;
+using namespace rapidjson;
+namespace fs = boost::filesystem;
+namespace sys = boost::system;
+
+namespace facter { namespace facts {
+
+    static int64_t now()
+    {
+        return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Gets the identifier of the current boot, so that records of unavailable facts don't outlive a reboot
+    // Where there is no boot identifier, records expire only by their TTL
+    static string boot_id()
+    {
+        string id = file::read("/proc/sys/kernel/random/boot_id");
+        boost::trim(id);
+        return id;
+    }
+
+    // Hashes a resolver's facts regardless of their order
+    static uint64_t hash_facts(vector<pair<string, value const*>> const& facts)
+    {
+        uint64_t hash = 0;
+        for (auto const& kvp : facts) {
+            if (kvp.second) {
+                hash += hash_integer(hash_string(hash_basis, kvp.first), kvp.second->hash() ^ (kvp.second->hidden() ? 1 : 0));
+            }
+        }
+        return hash;
+    }
+
+    // Writes doubles with enough digits to be read back unchanged, and with a fraction so they are read back as doubles
+    // rapidjson writes doubles with "%g", which keeps only 6 digits and writes 1.0 as the integer 1
+    template <typename Stream>
+    struct cache_writer : Writer<Stream>
+    {
+        explicit cache_writer(Stream& stream) :
+            Writer<Stream>(stream)
+        {
+        }
+
+        cache_writer& Double(double d)
+        {
+            this->Prefix(kNumberType);
+            char buffer[32];
+            int length = snprintf(buffer, sizeof(buffer), "%.17g", d);
+            if (length <= 0 || length >= static_cast<int>(sizeof(buffer))) {
+                length = 0;
+            }
+            bool whole = true;
+            for (int i = 0; i < length; ++i) {
+                this->stream_.Put(buffer[i]);
+                if (buffer[i] != '-' && (buffer[i] < '0' || buffer[i] > '9')) {
+                    whole = false;
+                }
+            }
+            if (whole) {
+                this->stream_.Put('.');
+                this->stream_.Put('0');
+            }
+            return *this;
+        }
+    };
+
+    // Parses the doubles of a JSON document exactly, in document order
+    // rapidjson's reader rounds doubles (e.g. it keeps only 16 digits of a fraction), so cached doubles would drift
+    struct double_reader : BaseReaderHandler<>
+    {
+        explicit double_reader(StringStream const& stream) :
+            _stream(stream)
+        {
+        }
+
+        void Double(double d)
+        {
+            // The handler is called before the stream moves past the number, so the number starts at the stream's position
+            auto first = _stream.src_;
+            auto last = first;
+            while ((*last >= '0' && *last <= '9') || *last == '-' || *last == '+' || *last == '.' || *last == 'e' || *last == 'E') {
+                ++last;
+            }
+            parse_double(first, last, d);
+            doubles.push_back(d);
+        }
+
+        vector<double> doubles;
+
+     private:
+        StringStream const& _stream;
+    };
+
+    static void restore_doubles(rapidjson::Value& json, vector<double> const& doubles, size_t& next)
+    {
+        if (json.IsDouble()) {
+            if (next < doubles.size()) {
+                json.SetDouble(doubles[next++]);
+            }
+        } else if (json.IsArray()) {
+            for (auto it = json.Begin(); it != json.End(); ++it) {
+                restore_doubles(*it, doubles, next);
+            }
+        } else if (json.IsObject()) {
+            for (auto it = json.MemberBegin(); it != json.MemberEnd(); ++it) {
+                restore_doubles(it->value, doubles, next);
+            }
+        }
+    }
+
+    fact_cache::fact_cache(string path, map<string, chrono::seconds> ttls, chrono::seconds unavailable_ttl, chrono::seconds max_ttl) :
+        _path(move(path)),
+        _ttls(move(ttls)),
+        _unavailable_ttl(unavailable_ttl),
+        _max_ttl(max_ttl),
+        _boot_id(boot_id()),
+        _modified(false)
+    {
+        read();
+    }
+
+    string const& fact_cache::path() const
+    {
+        return _path;
+    }
+
+    bool fact_cache::is_cached(resolver const& res) const
+    {
+        return _ttls.count(res.name()) > 0 || _primed.count(res.name()) > 0;
+    }
+
+    bool fact_cache::can_prime() const
+    {
+        return !_boot_id.empty();
+    }
+
+    void fact_cache::prime(resolver const& res)
+    {
+        if (can_prime()) {
+            _primed.insert(res.name());
+        }
+    }
+
+    bool fact_cache::load(resolver const& res, collection& facts)
+    {
+        auto ttl = _ttls.find(res.name());
+        if (ttl == _ttls.end() && _primed.count(res.name()) == 0) {
+            return false;
+        }
+
+        // Convert the cached facts while locked, but add them to the collection after unlocking
+        // The collection may be storing another resolver's facts in the cache while we add them
+        vector<pair<string, unique_ptr<value>>> cached;
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+
+            auto& resolvers = _document["resolvers"];
+            if (!resolvers.HasMember(res.name().c_str())) {
+                LOG_DEBUG("no cached facts found for %1% facts.", res.name());
+                return false;
+            }
+            auto& entry = resolvers[res.name().c_str()];
+            if (!entry.IsObject() || !entry.HasMember("timestamp") || !entry["timestamp"].IsInt64() ||
+                !entry.HasMember("facts") || !entry["facts"].IsObject()) {
+                LOG_DEBUG("cached facts for %1% facts are invalid.", res.name());
+                return false;
+            }
+
+            if (entry.HasMember("boot_id")) {
+                // Primed facts are kept until the host is rebooted, regardless of any TTL
+                if (!entry["boot_id"].IsString() || _boot_id.empty() || entry["boot_id"].GetString() != _boot_id) {
+                    LOG_DEBUG("cached facts for %1% facts were primed before the host was rebooted.", res.name());
+                    return false;
+                }
+            } else {
+                // Ignore timestamps in the future as the clock may have been changed
+                // An adapted TTL is only used within the bounds of the current options
+                auto age = now() - entry["timestamp"].GetInt64();
+                auto limit = ttl == _ttls.end() ? 0 : ttl->second.count();
+                if (limit > 0 && _max_ttl.count() > limit && entry.HasMember("ttl") && entry["ttl"].IsInt64()) {
+                    limit = max(limit, min(entry["ttl"].GetInt64(), static_cast<int64_t>(_max_ttl.count())));
+                }
+                if (ttl == _ttls.end() || age < 0 || age >= limit) {
+                    LOG_DEBUG("cached facts for %1% facts have expired.", res.name());
+                    return false;
+                }
+            }
+
+            vector<string> hidden;
+            if (entry.HasMember("hidden") && entry["hidden"].IsArray()) {
+                auto& names = entry["hidden"];
+                for (auto it = names.Begin(); it != names.End(); ++it) {
+                    if (it->IsString()) {
+                        hidden.emplace_back(it->GetString(), it->GetStringLength());
+                    }
+                }
+            }
+
+            auto& values = entry["facts"];
+            for (auto it = values.MemberBegin(); it != values.MemberEnd(); ++it) {
+                string name(it->name.GetString(), it->name.GetStringLength());
+                bool is_hidden = find(hidden.begin(), hidden.end(), name) != hidden.end();
+                auto val = from_json(it->value, is_hidden);
+                if (val) {
+                    cached.emplace_back(move(name), move(val));
+                }
+            }
+        }
+
+        for (auto& kvp : cached) {
+            facts.add(move(kvp.first), move(kvp.second));
+        }
+        return true;
+    }
+
+    void fact_cache::store(resolver const& res, vector<pair<string, value const*>> const& facts)
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        auto& allocator = _document.GetAllocator();
+
+        rapidjson::Value values;
+        values.SetObject();
+        rapidjson::Value hidden;
+        hidden.SetArray();
+        for (auto const& kvp : facts) {
+            if (!kvp.second) {
+                continue;
+            }
+            rapidjson::Value name;
+            name.SetString(kvp.first.c_str(), kvp.first.size(), allocator);
+            rapidjson::Value val;
+            kvp.second->to_json(allocator, val);
+            values.AddMember(name, val, allocator);
+
+            if (kvp.second->hidden()) {
+                rapidjson::Value hidden_name;
+                hidden_name.SetString(kvp.first.c_str(), kvp.first.size(), allocator);
+                hidden.PushBack(hidden_name, allocator);
+            }
+        }
+
+        rapidjson::Value entry;
+        entry.SetObject();
+        entry.AddMember("timestamp", now(), allocator);
+        entry.AddMember("facts", values, allocator);
+        entry.AddMember("hidden", hidden, allocator);
+        auto& resolvers = _document["resolvers"];
+        if (_primed.count(res.name())) {
+            rapidjson::Value id;
+            id.SetString(_boot_id.c_str(), _boot_id.size(), allocator);
+            entry.AddMember("boot_id", id, allocator);
+        } else {
+            auto ttl = _ttls.find(res.name());
+            if (ttl != _ttls.end() && ttl->second.count() > 0 && _max_ttl > ttl->second) {
+                // Stretch the TTL of facts that expired unchanged; facts that changed return to the resolver's TTL
+                auto hash = hash_facts(facts);
+                int64_t adapted = ttl->second.count();
+                if (resolvers.HasMember(res.name().c_str())) {
+                    auto const& previous = resolvers[res.name().c_str()];
+                    if (previous.IsObject() && previous.HasMember("hash") && previous["hash"].IsUint64() && previous["hash"].GetUint64() == hash &&
+                        previous.HasMember("ttl") && previous["ttl"].IsInt64()) {
+                        adapted = min(max(previous["ttl"].GetInt64(), adapted) * 2, static_cast<int64_t>(_max_ttl.count()));
+                    }
+                }
+                if (adapted != ttl->second.count()) {
+                    LOG_DEBUG("%1% facts have not changed: they are cached for %2% seconds.", res.name(), adapted);
+                }
+                entry.AddMember("hash", hash, allocator);
+                entry.AddMember("ttl", adapted, allocator);
+            }
+        }
+
+        // Replace any existing entry for the resolver
+        resolvers.RemoveMember(res.name().c_str());
+        rapidjson::Value name;
+        name.SetString(res.name().c_str(), res.name().size(), allocator);
+        resolvers.AddMember(name, entry, allocator);
+        _modified = true;
+    }
+
+    bool fact_cache::is_unavailable(resolver const& res)
+    {
+        if (_unavailable_ttl.count() <= 0) {
+            return false;
+        }
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        auto& unavailable = _document["unavailable"];
+        if (!unavailable.HasMember(res.name().c_str())) {
+            return false;
+        }
+        auto& entry = unavailable[res.name().c_str()];
+        if (!entry.IsObject() || !entry.HasMember("timestamp") || !entry["timestamp"].IsInt64() ||
+            !entry.HasMember("boot_id") || !entry["boot_id"].IsString()) {
+            return false;
+        }
+        if (entry["boot_id"].GetString() != _boot_id) {
+            LOG_DEBUG("%1% facts were recorded as unavailable before the host was rebooted.", res.name());
+            return false;
+        }
+        auto age = now() - entry["timestamp"].GetInt64();
+        if (age < 0 || age >= _unavailable_ttl.count()) {
+            LOG_DEBUG("record of unavailable %1% facts has expired.", res.name());
+            return false;
+        }
+        return true;
+    }
+
+    void fact_cache::store_unavailable(resolver const& res)
+    {
+        if (_unavailable_ttl.count() <= 0) {
+            return;
+        }
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        auto& allocator = _document.GetAllocator();
+
+        rapidjson::Value entry;
+        entry.SetObject();
+        entry.AddMember("timestamp", now(), allocator);
+        rapidjson::Value id;
+        id.SetString(_boot_id.c_str(), _boot_id.size(), allocator);
+        entry.AddMember("boot_id", id, allocator);
+
+        auto& unavailable = _document["unavailable"];
+        unavailable.RemoveMember(res.name().c_str());
+        rapidjson::Value name;
+        name.SetString(res.name().c_str(), res.name().size(), allocator);
+        unavailable.AddMember(name, entry, allocator);
+
+        write();
+    }
+
+    // Gets the modification time and size that identify the version of an external fact file
+    static bool file_version(string const& path, int64_t& modified, int64_t& size)
+    {
+        sys::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (ec) {
+            return false;
+        }
+        auto length = fs::file_size(path, ec);
+        if (ec) {
+            return false;
+        }
+        modified = static_cast<int64_t>(time);
+        size = static_cast<int64_t>(length);
+        return true;
+    }
+
+    chrono::seconds fact_cache::external_ttl(string const& path) const
+    {
+        auto ttl = _ttls.find(fs::path(path).filename().string());
+        return ttl == _ttls.end() ? chrono::seconds(0) : ttl->second;
+    }
+
+    rapidjson::Value const* fact_cache::find_external(string const& path, chrono::seconds ttl)
+    {
+        int64_t modified = 0;
+        int64_t size = 0;
+        if (!file_version(path, modified, size)) {
+            return nullptr;
+        }
+
+        auto& external = _document["external"];
+        if (!external.HasMember(path.c_str())) {
+            return nullptr;
+        }
+        auto& entry = external[path.c_str()];
+        if (!entry.IsObject() || !entry.HasMember("timestamp") || !entry["timestamp"].IsInt64() ||
+            !entry.HasMember("modified") || !entry["modified"].IsInt64() ||
+            !entry.HasMember("size") || !entry["size"].IsInt64() ||
+            !entry.HasMember("facts") || !entry["facts"].IsArray()) {
+            return nullptr;
+        }
+        if (entry["modified"].GetInt64() != modified || entry["size"].GetInt64() != size) {
+            LOG_DEBUG("external fact file \"%1%\" has changed since its facts were cached.", path);
+            return nullptr;
+        }
+        if (ttl.count() > 0) {
+            auto age = now() - entry["timestamp"].GetInt64();
+            if (age < 0 || age >= ttl.count()) {
+                LOG_DEBUG("cached facts of external fact file \"%1%\" have expired.", path);
+                return nullptr;
+            }
+        }
+        return &entry["facts"];
+    }
+
+    bool fact_cache::load_external(string const& path, chrono::seconds ttl, vector<pair<string, unique_ptr<value>>>& facts)
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        auto values = find_external(path, ttl);
+        if (!values) {
+            return false;
+        }
+
+        // Each fact is stored as a pair of its name and value, in the order it was resolved
+        for (auto it = values->Begin(); it != values->End(); ++it) {
+            if (!it->IsArray() || it->Size() != 2 || !(*it)[0u].IsString()) {
+                continue;
+            }
+            auto& name = (*it)[0u];
+            facts.emplace_back(string(name.GetString(), name.GetStringLength()), from_json((*it)[1u]));
+        }
+        return true;
+    }
+
+    bool fact_cache::external_names(string const& path, chrono::seconds ttl, vector<string>& names)
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        auto values = find_external(path, ttl);
+        if (!values) {
+            return false;
+        }
+        for (auto it = values->Begin(); it != values->End(); ++it) {
+            if (!it->IsArray() || it->Size() != 2 || !(*it)[0u].IsString()) {
+                continue;
+            }
+            auto& name = (*it)[0u];
+            names.emplace_back(name.GetString(), name.GetStringLength());
+        }
+        return true;
+    }
+
+    void fact_cache::store_external(string const& path, vector<pair<string, unique_ptr<value>>> const& facts)
+    {
+        int64_t modified = 0;
+        int64_t size = 0;
+        if (!file_version(path, modified, size)) {
+            return;
+        }
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        auto& allocator = _document.GetAllocator();
+
+        rapidjson::Value values;
+        values.SetArray();
+        for (auto const& kvp : facts) {
+            rapidjson::Value fact;
+            fact.SetArray();
+            rapidjson::Value name;
+            name.SetString(kvp.first.c_str(), kvp.first.size(), allocator);
+            fact.PushBack(name, allocator);
+            rapidjson::Value val;
+            if (kvp.second) {
+                kvp.second->to_json(allocator, val);
+            }
+            fact.PushBack(val, allocator);
+            values.PushBack(fact, allocator);
+        }
+
+        rapidjson::Value entry;
+        entry.SetObject();
+        entry.AddMember("timestamp", now(), allocator);
+        entry.AddMember("modified", modified, allocator);
+        entry.AddMember("size", size, allocator);
+        entry.AddMember("facts", values, allocator);
+
+        auto& external = _document["external"];
+        external.RemoveMember(path.c_str());
+        rapidjson::Value name;
+        name.SetString(path.c_str(), path.size(), allocator);
+        external.AddMember(name, entry, allocator);
+        _modified = true;
+    }
+
+    void fact_cache::save()
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        // Discard the facts of files that were removed
+        auto& external = _document["external"];
+        vector<string> removed;
+        for (auto it = external.MemberBegin(); it != external.MemberEnd(); ++it) {
+            string path(it->name.GetString(), it->name.GetStringLength());
+            sys::error_code ec;
+            if (!fs::exists(path, ec)) {
+                removed.emplace_back(move(path));
+            }
+        }
+        for (auto const& path : removed) {
+            external.RemoveMember(path.c_str());
+            _modified = true;
+        }
+
+        if (_modified) {
+            write();
+            _modified = false;
+        }
+    }
+
+    void fact_cache::flush()
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        if (_modified) {
+            write();
+            _modified = false;
+        }
+    }
+
+    void fact_cache::compare_last_run(vector<pair<string, value const*>> const& facts, vector<string>& added, vector<string>& changed, vector<string>& removed)
+    {
+        // Hash the facts before locking; a fact's hash may need to be computed from every value in it
+        map<string, uint64_t> hashes;
+        for (auto const& kvp : facts) {
+            if (kvp.second) {
+                hashes[kvp.first] = kvp.second->hash();
+            }
+        }
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        auto& allocator = _document.GetAllocator();
+        auto& last_run = _document["last_run"];
+        for (auto const& kvp : hashes) {
+            if (!last_run.HasMember(kvp.first.c_str())) {
+                added.push_back(kvp.first);
+                continue;
+            }
+            auto& previous = last_run[kvp.first.c_str()];
+            if (!previous.IsUint64() || previous.GetUint64() != kvp.second) {
+                changed.push_back(kvp.first);
+            }
+        }
+        for (auto it = last_run.MemberBegin(); it != last_run.MemberEnd(); ++it) {
+            string name(it->name.GetString(), it->name.GetStringLength());
+            if (hashes.count(name) == 0) {
+                removed.emplace_back(move(name));
+            }
+        }
+
+        rapidjson::Value run;
+        run.SetObject();
+        for (auto const& kvp : hashes) {
+            rapidjson::Value name;
+            name.SetString(kvp.first.c_str(), kvp.first.size(), allocator);
+            rapidjson::Value hash(kvp.second);
+            run.AddMember(name, hash, allocator);
+        }
+        _document.RemoveMember("last_run");
+        _document.AddMember("last_run", run, allocator);
+
+        write();
+    }
+
+    void fact_cache::read()
+    {
+        string contents;
+        if (file::read(_path, contents)) {
+            _document.Parse<0>(contents.c_str());
+            if (_document.HasParseError()) {
+                LOG_WARNING("fact cache %1% could not be parsed and will be discarded: %2%.", _path, _document.GetParseError());
+            } else if (!_document.IsObject() || !_document.HasMember("version") || !_document["version"].IsString() ||
+                       !_document.HasMember("resolvers") || !_document["resolvers"].IsObject()) {
+                LOG_WARNING("fact cache %1% is invalid and will be discarded.", _path);
+            } else if (_document["version"].GetString() != string(LIBFACTER_VERSION)) {
+                LOG_DEBUG("fact cache %1% was written by facter %2% and will be discarded.", _path, _document["version"].GetString());
+            } else {
+                StringStream stream(contents.c_str());
+                double_reader doubles(stream);
+                Reader reader;
+                if (reader.Parse<0>(stream, doubles)) {
+                    size_t next = 0;
+                    restore_doubles(_document, doubles.doubles, next);
+                }
+
+                // Caches written by earlier builds of this version may not have every section
+                for (auto section : { "unavailable", "external", "last_run" }) {
+                    if (!_document.HasMember(section) || !_document[section].IsObject()) {
+                        _document.RemoveMember(section);
+                        rapidjson::Value value;
+                        value.SetObject();
+                        _document.AddMember(section, value, _document.GetAllocator());
+                    }
+                }
+                // Keep the facts primed during this boot until the host is rebooted
+                if (!_boot_id.empty()) {
+                    auto& resolvers = _document["resolvers"];
+                    for (auto it = resolvers.MemberBegin(); it != resolvers.MemberEnd(); ++it) {
+                        if (it->value.IsObject() && it->value.HasMember("boot_id") && it->value["boot_id"].IsString() &&
+                            it->value["boot_id"].GetString() == _boot_id) {
+                            _primed.emplace(it->name.GetString(), it->name.GetStringLength());
+                        }
+                    }
+                }
+                LOG_DEBUG("loaded fact cache %1%.", _path);
+                return;
+            }
+        }
+
+        _document.SetObject();
+        _document.AddMember("version", LIBFACTER_VERSION, _document.GetAllocator());
+        rapidjson::Value resolvers;
+        resolvers.SetObject();
+        _document.AddMember("resolvers", resolvers, _document.GetAllocator());
+        rapidjson::Value unavailable;
+        unavailable.SetObject();
+        _document.AddMember("unavailable", unavailable, _document.GetAllocator());
+        rapidjson::Value external;
+        external.SetObject();
+        _document.AddMember("external", external, _document.GetAllocator());
+        rapidjson::Value last_run;
+        last_run.SetObject();
+        _document.AddMember("last_run", last_run, _document.GetAllocator());
+    }
+
+    void fact_cache::write()
+    {
+        StringBuffer buffer;
+        cache_writer<StringBuffer> writer(buffer);
+        _document.Accept(writer);
+
+        // Write to a temporary file and rename it so that readers never see a partially written cache
+        sys::error_code ec;
+        fs::path path(_path);
+        if (path.has_parent_path()) {
+            fs::create_directories(path.parent_path(), ec);
+            if (ec) {
+                LOG_WARNING("fact cache directory %1% could not be created: %2%.", path.parent_path().string(), ec.message());
+                return;
+            }
+        }
+
+        // The temporary file is unique so that concurrent runs sharing the cache don't write to the same file
+        string temp_path = (path.parent_path() / fs::unique_path(path.filename().string() + ".%%%%-%%%%-%%%%-%%%%.tmp")).string();
+        {
+            boost::nowide::ofstream out(temp_path.c_str(), ios::out | ios::binary | ios::trunc);
+            out << buffer.GetString();
+            if (!out) {
+                LOG_WARNING("fact cache %1% could not be written.", temp_path);
+                return;
+            }
+        }
+
+        fs::rename(temp_path, path, ec);
+        if (ec) {
+            LOG_WARNING("fact cache %1% could not be written: %2%.", _path, ec.message());
+            fs::remove(temp_path, ec);
+        }
+    }
+
+}}  // namespace facter::facts
@@ -0,0 +1,326 @@
+#include <facter/facts/capi.h>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <boost/thread/tss.hpp>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    // The opaque types are never defined: a collection handle is a collection and a value handle is a value
+    static collection* to_collection(facter_collection* facts)
+    {
+        return reinterpret_cast<collection*>(facts);
+    }
+
+    static string& last_error()
+    {
+        static boost::thread_specific_ptr<string> error;
+        if (!error.get()) {
+            error.reset(new string());
+        }
+        return *error;
+    }
+
+    static int fail(string message)
+    {
+        last_error() = move(message);
+        return -1;
+    }
+
+    // Exceptions must not cross the C boundary, so each call that may throw records the exception's message instead
+    template <typename Function>
+    static int guard(Function const& function)
+    {
+        try {
+            function();
+            return 0;
+        } catch (exception& ex) {
+            return fail(ex.what());
+        } catch (...) {
+            return fail("an unknown error occurred.");
+        }
+    }
+
+    // Lazy values are unwrapped so that callers only ever see the computed value
+    // Computing a lazy value may throw, so it is only done under a guard
+    static facter_value const* from_value(value const* val)
+    {
+        return reinterpret_cast<facter_value const*>(lazy_value::resolve(val));
+    }
+
+    // Unwraps a value handle, recording the error and returning false if computing a lazy value fails
+    static bool to_value(facter_value const* val, value const*& result)
+    {
+        result = nullptr;
+        return guard([&]() {
+            result = lazy_value::resolve(reinterpret_cast<value const*>(val));
+        }) == 0;
+    }
+
+    static vector<string> to_strings(char const* const* strings, size_t count)
+    {
+        vector<string> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            result.emplace_back(strings[i]);
+        }
+        return result;
+    }
+
+    template <typename T, typename Result>
+    static int get_scalar(facter_value const* val, Result* result, char const* type)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved)) {
+            return -1;
+        }
+        auto scalar = value_cast<T>(resolved);
+        if (!scalar || !result) {
+            return fail(string("the value is not ") + type + ".");
+        }
+        *result = static_cast<Result>(scalar->value());
+        return 0;
+    }
+
+}}  // namespace facter::facts
+
+// Exports of the C API; see facter/facts/capi.h
+using namespace facter::facts;
+
+extern "C" {
+
+    char const* facter_last_error(void)
+    {
+        return last_error().c_str();
+    }
+
+    facter_collection* facter_collection_new(void)
+    {
+        collection* facts = nullptr;
+        guard([&]() {
+            facts = new collection();
+        });
+        return reinterpret_cast<facter_collection*>(facts);
+    }
+
+    void facter_collection_free(facter_collection* facts)
+    {
+        delete to_collection(facts);
+    }
+
+    int facter_collection_add_default_facts(facter_collection* facts)
+    {
+        if (!facts) {
+            return fail("the collection is null.");
+        }
+        return guard([&]() {
+            to_collection(facts)->add_default_facts();
+        });
+    }
+
+    int facter_collection_add_external_facts(facter_collection* facts, char const* const* directories, size_t count)
+    {
+        if (!facts || (count > 0 && !directories)) {
+            return fail("the collection or directories are null.");
+        }
+        return guard([&]() {
+            to_collection(facts)->add_external_facts(to_strings(directories, count));
+        });
+    }
+
+    int facter_collection_add_string(facter_collection* facts, char const* name, char const* value)
+    {
+        if (!facts || !name || !value) {
+            return fail("the collection, name, or value is null.");
+        }
+        return guard([&]() {
+            to_collection(facts)->add(name, make_value<string_value>(value));
+        });
+    }
+
+    int facter_collection_resolve(facter_collection* facts, char const* const* queries, size_t count)
+    {
+        if (!facts || (count > 0 && !queries)) {
+            return fail("the collection or queries are null.");
+        }
+        return guard([&]() {
+            auto strings = to_strings(queries, count);
+            to_collection(facts)->resolve(set<string>(strings.begin(), strings.end()));
+        });
+    }
+
+    facter_value const* facter_collection_query(facter_collection* facts, char const* query)
+    {
+        if (!facts || !query) {
+            fail("the collection or query is null.");
+            return nullptr;
+        }
+        facter_value const* result = nullptr;
+        guard([&]() {
+            result = from_value(to_collection(facts)->query<value>(query));
+        });
+        return result;
+    }
+
+    int facter_collection_each(facter_collection* facts, facter_name_callback callback, void* context)
+    {
+        if (!facts || !callback) {
+            return fail("the collection or callback is null.");
+        }
+        return guard([&]() {
+            to_collection(facts)->each([&](string const& name, value const* val) {
+                return callback(context, name.data(), name.size(), from_value(val)) != 0;
+            });
+        });
+    }
+
+    facter_value_type facter_value_get_type(facter_value const* val)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved) || !resolved) {
+            return FACTER_VALUE_OTHER;
+        }
+        switch (resolved->type()) {
+            case value_type::string:
+                return FACTER_VALUE_STRING;
+            case value_type::integer:
+                return FACTER_VALUE_INTEGER;
+            case value_type::boolean:
+                return FACTER_VALUE_BOOLEAN;
+            case value_type::floating_point:
+                return FACTER_VALUE_DOUBLE;
+            case value_type::array:
+                return FACTER_VALUE_ARRAY;
+            case value_type::map:
+                return FACTER_VALUE_MAP;
+            default:
+                return FACTER_VALUE_OTHER;
+        }
+    }
+
+    int facter_value_hidden(facter_value const* val)
+    {
+        value const* resolved;
+        return to_value(val, resolved) && resolved && resolved->hidden() ? 1 : 0;
+    }
+
+    int facter_value_get_string(facter_value const* val, char const** data, size_t* length)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved)) {
+            return -1;
+        }
+        auto str = value_cast<string_value>(resolved);
+        if (!str || !data || !length) {
+            return fail("the value is not a string.");
+        }
+        *data = str->value().c_str();
+        *length = str->value().size();
+        return 0;
+    }
+
+    int facter_value_get_integer(facter_value const* val, int64_t* result)
+    {
+        return get_scalar<integer_value>(val, result, "an integer");
+    }
+
+    int facter_value_get_boolean(facter_value const* val, int* result)
+    {
+        return get_scalar<boolean_value>(val, result, "a boolean");
+    }
+
+    int facter_value_get_double(facter_value const* val, double* result)
+    {
+        return get_scalar<double_value>(val, result, "a double");
+    }
+
+    size_t facter_value_size(facter_value const* val)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved)) {
+            return 0;
+        }
+        if (auto array = value_cast<array_value>(resolved)) {
+            return array->size();
+        }
+        if (auto map = value_cast<map_value>(resolved)) {
+            return map->size();
+        }
+        return 0;
+    }
+
+    facter_value const* facter_value_array_get(facter_value const* val, size_t index)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved)) {
+            return nullptr;
+        }
+        auto array = value_cast<array_value>(resolved);
+        if (!array || index >= array->size()) {
+            return nullptr;
+        }
+        facter_value const* result = nullptr;
+        guard([&]() {
+            result = from_value((*array)[index]);
+        });
+        return result;
+    }
+
+    facter_value const* facter_value_map_get(facter_value const* val, char const* name)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved)) {
+            return nullptr;
+        }
+        auto map = value_cast<map_value>(resolved);
+        if (!map || !name) {
+            return nullptr;
+        }
+        facter_value const* result = nullptr;
+        guard([&]() {
+            result = from_value((*map)[name]);
+        });
+        return result;
+    }
+
+    int facter_value_array_each(facter_value const* val, facter_element_callback callback, void* context)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved)) {
+            return -1;
+        }
+        auto array = value_cast<array_value>(resolved);
+        if (!array || !callback) {
+            return fail("the value is not an array.");
+        }
+        return guard([&]() {
+            array->each([&](value const* element) {
+                return callback(context, from_value(element)) != 0;
+            });
+        });
+    }
+
+    int facter_value_map_each(facter_value const* val, facter_name_callback callback, void* context)
+    {
+        value const* resolved;
+        if (!to_value(val, resolved)) {
+            return -1;
+        }
+        auto map = value_cast<map_value>(resolved);
+        if (!map || !callback) {
+            return fail("the value is not a map.");
+        }
+        return guard([&]() {
+            map->each([&](string const& name, value const* element) {
+                return callback(context, name.data(), name.size(), from_value(element)) != 0;
+            });
+        });
+    }
+}
@@ -0,0 +1,78 @@
+#include <internal/facts/cloud.hpp>
+#include <internal/facts/json.hpp>
+#include <facter/util/file.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/algorithm/string.hpp>
+#include <rapidjson/document.h>
+#include <string>
+
+using namespace std;
+using namespace facter::util;
+
+namespace facter { namespace facts {
+
+    // The asset tag Azure sets on the chassis of every virtual machine; it distinguishes Azure from other Hyper-V hosts
+    static const char* AZURE_CHASSIS_ASSET_TAG = "7783-7084-3265-9085-8269-3286-77";
+
+    static string read_attribute(string const& path)
+    {
+        string value = file::read(path);
+        boost::trim(value);
+        return value;
+    }
+
+    cloud_platform detect_cloud_platform()
+    {
+        string vendor = read_attribute("/sys/class/dmi/id/sys_vendor");
+        string product = read_attribute("/sys/class/dmi/id/product_name");
+
+        // Nitro instances report Amazon as the vendor; Xen instances have an Amazon BIOS version or an "ec2" UUID
+        // The product UUID is only readable by root, so the Xen hypervisor's UUID is checked first
+        if (vendor == "Amazon EC2" || boost::icontains(read_attribute("/sys/class/dmi/id/bios_version"), "amazon")) {
+            return cloud_platform::ec2;
+        }
+        string uuid = read_attribute("/sys/hypervisor/uuid");
+        if (uuid.empty()) {
+            uuid = read_attribute("/sys/class/dmi/id/product_uuid");
+        }
+        if (boost::istarts_with(uuid, "ec2")) {
+            return cloud_platform::ec2;
+        }
+
+        if (boost::starts_with(vendor, "OpenStack") || boost::starts_with(product, "OpenStack")) {
+            return cloud_platform::openstack;
+        }
+        if (vendor == "Google" || product == "Google Compute Engine") {
+            return cloud_platform::gce;
+        }
+        if (vendor == "DigitalOcean") {
+            return cloud_platform::digitalocean;
+        }
+        if (vendor == "Microsoft Corporation" && read_attribute("/sys/class/dmi/id/chassis_asset_tag") == AZURE_CHASSIS_ASSET_TAG) {
+            return cloud_platform::azure;
+        }
+
+        // Without DMI, such as for Xen paravirtual guests, nothing can be decided
+        if (vendor.empty() && product.empty()) {
+            LOG_DEBUG("cloud platform could not be determined: DMI information is not available.");
+            return cloud_platform::unknown;
+        }
+        return cloud_platform::none;
+    }
+
+    unique_ptr<map_value> parse_metadata(string const& document)
+    {
+        rapidjson::Document json;
+        json.Parse<0>(document.c_str());
+        if (json.HasParseError()) {
+            LOG_DEBUG("failed to parse metadata: %1%.", json.GetParseError());
+            return nullptr;
+        }
+        if (!json.IsObject()) {
+            LOG_DEBUG("failed to parse metadata: expected document to contain an object.");
+            return nullptr;
+        }
+        return unique_ptr<map_value>(static_cast<map_value*>(from_json(json).release()));
+    }
+
+}}  // namespace facter::facts
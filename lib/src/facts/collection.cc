@@ -2,17 +2,40 @@
 #include <facter/facts/resolver.hpp>
 #include <facter/facts/value.hpp>
 #include <facter/facts/scalar_value.hpp>
+#include <facter/facts/snapshot.hpp>
 #include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
 #include <facter/facts/map_value.hpp>
 #include <facter/util/directory.hpp>
 #include <facter/util/environment.hpp>
 #include <facter/util/string.hpp>
 #include <facter/version.h>
+#include <internal/execution/command_cache.hpp>
+#include <internal/util/directory_watcher.hpp>
 #include <internal/util/dynamic_library.hpp>
+#include <internal/util/log_context.hpp>
+#include <internal/util/metrics.hpp>
+#include <internal/util/pooled_stream.hpp>
+#include <internal/util/probes.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <internal/util/statistics.hpp>
+#include <internal/util/thread_pool.hpp>
+#include <internal/facts/builtin_facts.hpp>
+#include <internal/facts/cache.hpp>
+#include <internal/facts/memory_usage.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/facts/resolver_index.hpp>
+#include <internal/facts/value_arena.hpp>
+#include <internal/facts/writer.hpp>
 #include <internal/facts/resolvers/ruby_resolver.hpp>
 #include <internal/facts/resolvers/path_resolver.hpp>
+#include <internal/facts/resolvers/az_resolver.hpp>
+#include <internal/facts/resolvers/digitalocean_resolver.hpp>
 #include <internal/facts/resolvers/ec2_resolver.hpp>
 #include <internal/facts/resolvers/gce_resolver.hpp>
+#include <internal/facts/resolvers/openstack_resolver.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
@@ -20,6 +43,7 @@
 #include <rapidjson/prettywriter.h>
 #include <yaml-cpp/yaml.h>
 #include <algorithm>
+#include <exception>
 
 using namespace std;
 using namespace facter::util;
@@ -29,9 +53,151 @@ using namespace boost::filesystem;
 
 namespace facter { namespace facts {
 
-    collection::collection()
+    static bool provides(resolver const& res, string const& name)
     {
-        // This needs to be defined here since we use incomplete types in the header
+        return find(res.names().begin(), res.names().end(), name) != res.names().end() || res.is_match(name);
+    }
+
+    static string query_segment(string const& name)
+    {
+        return name.find('.') == string::npos ? name : "\"" + name + "\"";
+    }
+
+    static void diff(value const& previous, value const& current, string const& path, vector<string>& paths)
+    {
+        // Descend into maps and arrays so that only the values that differ are reported
+        auto previous_map = value_cast<map_value>(lazy_value::resolve(&previous));
+        auto current_map = value_cast<map_value>(lazy_value::resolve(&current));
+        if (previous_map && current_map) {
+            previous_map->each([&](string const& name, value const* element) {
+                auto other = (*current_map)[name];
+                if (!other) {
+                    paths.push_back(path + "." + query_segment(name));
+                } else {
+                    diff(*element, *other, path + "." + query_segment(name), paths);
+                }
+                return true;
+            });
+            current_map->each([&](string const& name, value const*) {
+                if (!(*previous_map)[name]) {
+                    paths.push_back(path + "." + query_segment(name));
+                }
+                return true;
+            });
+            return;
+        }
+
+        auto previous_array = value_cast<array_value>(lazy_value::resolve(&previous));
+        auto current_array = value_cast<array_value>(lazy_value::resolve(&current));
+        if (previous_array && current_array) {
+            for (size_t i = 0; i < previous_array->size() || i < current_array->size(); ++i) {
+                auto element = (*previous_array)[i];
+                auto other = (*current_array)[i];
+                if (!element || !other) {
+                    paths.push_back(path + "." + to_string(i));
+                } else {
+                    diff(*element, *other, path + "." + to_string(i), paths);
+                }
+            }
+            return;
+        }
+
+        if (!previous.equals(current)) {
+            paths.push_back(path);
+        }
+    }
+
+    // The external fact files found by add_external_facts, so that only the files that change are resolved again
+    struct collection::external_files
+    {
+        struct file
+        {
+            external::resolver const* resolver;
+            time_t modified;
+            uintmax_t size;
+            vector<string> names;
+        };
+
+        vector<string> directories;
+        vector<unique_ptr<external::resolver>> resolvers;
+        vector<unique_ptr<directory_watcher>> watchers;
+        map<string, file> files;
+        vector<resolver const*> pending;
+    };
+
+    // Resolves the facts of an external fact file when one of them is first needed
+    // The names of the file's facts are known from the fact cache, which stored them when the file was last resolved
+    struct collection::external_file_resolver : resolver
+    {
+        external_file_resolver(string path, vector<string> names, external::resolver const* res) :
+            resolver(path, move(names)),
+            _path(move(path)),
+            _resolver(res)
+        {
+        }
+
+        virtual void resolve(collection& facts) override
+        {
+            recorded_facts recorded;
+            if (!facts._cache || !facts._cache->load_external(_path, facts._cache->external_ttl(_path), recorded)) {
+                // The file changed after it was indexed
+                recorded = move(facts.resolve_external_files({ { &_path, _resolver } }).front());
+            }
+            facts.add(move(recorded));
+        }
+
+     private:
+        string _path;
+        external::resolver const* _resolver;
+    };
+
+    static void file_version(string const& path, time_t& modified, uintmax_t& size)
+    {
+        boost::system::error_code ec;
+        modified = last_write_time(path, ec);
+        if (ec) {
+            modified = 0;
+        }
+        size = file_size(path, ec);
+        if (ec) {
+            size = 0;
+        }
+    }
+
+    // Finds the files in the given directories and the resolver that can resolve each of them
+    static map<string, external::resolver const*> find_external_files(vector<string> const& directories, vector<unique_ptr<external::resolver>> const& resolvers)
+    {
+        map<string, external::resolver const*> files;
+        for (auto const& dir : directories) {
+            directory::each_file(dir, [&](string const& path) {
+                for (auto const& res : resolvers) {
+                    if (res->can_resolve(path)) {
+                        files.emplace(path, res.get());
+                        break;
+                    }
+                }
+                return true;
+            });
+        }
+        return files;
+    }
+
+    collection::collection() :
+        _index(new resolver_index()),
+        _concurrency(1),
+        _timeout(0),
+        _deadline(chrono::steady_clock::time_point::max()),
+        _cancelled(false),
+        _cost_budget(false),
+        _summarize_interfaces(false),
+        _legacy_on_demand(false),
+        _powershell_host(false),
+        _remote_filesystem_timeout(chrono::seconds(2)),
+        _fqdn_timeout(chrono::seconds(5)),
+        _next_subscriber(0),
+        _recording(nullptr)
+    {
+        index_facts();
     }
 
     collection::~collection()
@@ -39,7 +205,9 @@ namespace facter { namespace facts {
         // This needs to be defined here since we use incomplete types in the header
     }
 
-    collection::collection(collection&& other)
+    collection::collection(collection&& other) :
+        _cancelled(false),
+        _recording(nullptr)
     {
         *this = std::move(other);
     }
@@ -48,9 +216,39 @@ namespace facter { namespace facts {
     {
         if (this != &other) {
             _facts = std::move(other._facts);
+            index_facts();
+            other.index_facts();
             _resolvers = std::move(other._resolvers);
-            _resolver_map = std::move(other._resolver_map);
-            _pattern_resolvers = std::move(other._pattern_resolvers);
+            _index = std::move(other._index);
+            _added = std::move(other._added);
+            _resolved_at = std::move(other._resolved_at);
+            _overrides = std::move(other._overrides);
+            _scoped = std::move(other._scoped);
+            _concurrency = other._concurrency;
+            _timings = std::move(other._timings);
+            _cache = std::move(other._cache);
+            _timeout = other._timeout;
+            _timeouts = std::move(other._timeouts);
+            _deadline = other._deadline;
+            _cancelled = other._cancelled.load();
+            _blocked = std::move(other._blocked);
+            _allowed = std::move(other._allowed);
+            _cost_budget = other._cost_budget;
+            _root = std::move(other._root);
+            _included_interfaces = std::move(other._included_interfaces);
+            _excluded_interfaces = std::move(other._excluded_interfaces);
+            _summarize_interfaces = other._summarize_interfaces;
+            _legacy_on_demand = other._legacy_on_demand;
+            _powershell_host = other._powershell_host;
+            _excluded_filesystems = std::move(other._excluded_filesystems);
+            _remote_filesystem_timeout = other._remote_filesystem_timeout;
+            _fqdn_timeout = other._fqdn_timeout;
+            _arena = std::move(other._arena);
+            _commands = std::move(other._commands);
+            _subscribers = std::move(other._subscribers);
+            _next_subscriber = other._next_subscriber;
+            _external = std::move(other._external);
+            _recording = other._recording;
         }
         return *this;
     }
@@ -67,65 +265,167 @@ namespace facter { namespace facts {
             return;
         }
 
-        for (auto const& name : res->names()) {
-            _resolver_map.insert({ name, res });
-        }
+        lock_type lock(_mutex);
 
-        if (res->has_patterns()) {
-            _pattern_resolvers.push_back(res);
+        if (_blocked.count(res->name()) && !_allowed.count(res->name())) {
+            LOG_DEBUG("%1% resolver is blocked and will not be added.", res->name());
+            return;
         }
 
+        _index->add(res);
         _resolvers.push_back(res);
+        _added.push_back(res);
     }
 
     void collection::add(string name, unique_ptr<value> value)
     {
-        // Ensure the fact is resolved before replacing it
-        auto old_value = get_value(name);
+        // A recording collection only records what was added, to be added to another collection later
+        if (_recording) {
+            _recording->emplace_back(move(name), move(value));
+            return;
+        }
+
+        FACTER_PROBE1(fact__add, name.c_str());
+        lock_type lock(_mutex);
+
+        // Resolve the other resolvers of the fact first so that this value replaces theirs
+        // This resolves nothing unless another resolver is responsible for the fact
+        resolve_fact(name, lock);
+        insert(move(name), move(value), lock);
+    }
+
+    void collection::add(recorded_facts facts)
+    {
+        if (_recording) {
+            move(facts.begin(), facts.end(), back_inserter(*_recording));
+            return;
+        }
+
+        // Files may define many facts, so they are added under one lock
+        lock_type lock(_mutex);
+        for (auto& kvp : facts) {
+            FACTER_PROBE1(fact__add, kvp.first.c_str());
+            resolve_fact(kvp.first, lock);
+            insert(move(kvp.first), move(kvp.second), lock);
+        }
+    }
+
+    void collection::insert(string name, unique_ptr<value> value, lock_type& lock)
+    {
+        auto it = find_fact(name);
+
+        // A value added other than by a resolver overrides the resolvers of the fact, even when they are refreshed
+        // The resolvers of a fact resolve before it is added, so a resolver only finds an override when it is refreshed
+        auto thread = boost::this_thread::get_id();
+        bool resolving = any_of(_active.begin(), _active.end(), [&](pair<resolver const* const, boost::thread::id> const& kvp) {
+            return kvp.second == thread;
+        });
+        if (resolving && it != _facts.end() && _overrides.count(name)) {
+            LOG_DEBUG("fact \"%1%\" was overridden and keeps its value.", name);
+            return;
+        }
+        if (!resolving && value) {
+            _overrides.insert(name);
+        }
 
-        if (LOG_IS_DEBUG_ENABLED()) {
-            if (old_value) {
-                ostringstream old_value_ss;
-                old_value->write(old_value_ss);
+        auto old_value = it == _facts.end() ? nullptr : it->second.get();
+
+        // Don't force lazy values to resolve just to log them
+        auto lazy = value_cast<lazy_value>(value.get());
+        auto old_lazy = value_cast<lazy_value>(old_value);
+        if (lazy && !lazy->evaluated()) {
+            LOG_DEBUG("fact \"%1%\" will be resolved when it is first accessed.", name);
+        } else if (LOG_IS_DEBUG_ENABLED()) {
+            // An evaluated lazy value that resolved to nothing is logged as if there were no previous value
+            auto old_resolved = old_lazy && !old_lazy->evaluated() ? nullptr : lazy_value::resolve(old_value);
+
+            // Render the values into reused buffers rather than allocating a stream for each fact
+            if (old_lazy && !old_lazy->evaluated()) {
+                LOG_DEBUG("fact \"%1%\" has replaced a value that was never accessed.", name);
+            } else if (old_resolved) {
+                pooled_stream old_value_ss;
+                old_resolved->write(old_value_ss.stream());
                 if (!value) {
                     LOG_DEBUG("fact \"%1%\" resolved to null and the existing value of %2% will be removed.", name, old_value_ss.str());
                 } else {
-                    ostringstream new_value_ss;
-                    value->write(new_value_ss);
+                    pooled_stream new_value_ss;
+                    value->write(new_value_ss.stream());
                     LOG_DEBUG("fact \"%1%\" has changed from %2% to %3%.", name, old_value_ss.str(), new_value_ss.str());
                 }
             } else {
                 if (!value) {
                     LOG_DEBUG("fact \"%1%\" resolved to null and will not be added.", name);
                 } else {
-                    ostringstream new_value_ss;
-                    value->write(new_value_ss);
+                    pooled_stream new_value_ss;
+                    value->write(new_value_ss.stream());
                     LOG_DEBUG("fact \"%1%\" has resolved to %2%.", name, new_value_ss.str());
                 }
             }
         }
 
         if (!value) {
-            if (old_value) {
-                remove(name);
+            if (it != _facts.end()) {
+                erase_fact(it);
             }
             return;
         }
+        if (it != _facts.end()) {
+            it->second = move(value);
+            return;
+        }
+        auto id = builtin_fact_id(name);
+        it = _facts.emplace(move(name), move(value)).first;
+        if (id != no_builtin_fact) {
+            _builtins[id] = it;
+        }
+    }
+
+    collection::fact_iterator collection::find_fact(string const& name)
+    {
+        auto id = builtin_fact_id(name);
+        return id == no_builtin_fact ? _facts.find(name) : _builtins[id];
+    }
+
+    collection::fact_iterator collection::erase_fact(fact_iterator it)
+    {
+        _overrides.erase(it->first);
+        auto id = builtin_fact_id(it->first);
+        if (id != no_builtin_fact) {
+            _builtins[id] = _facts.end();
+        }
+        return _facts.erase(it);
+    }
 
-        _facts[move(name)] = move(value);
+    void collection::index_facts()
+    {
+        _builtins.assign(builtin_fact_count(), _facts.end());
+        for (auto it = _facts.begin(); it != _facts.end(); ++it) {
+            auto id = builtin_fact_id(it->first);
+            if (id != no_builtin_fact) {
+                _builtins[id] = it;
+            }
+        }
     }
 
     void collection::add_external_facts(vector<string> const& directories)
     {
-        auto resolvers = get_external_resolvers();
+        // The resolvers are kept so that the files can be resolved again when they change
+        if (!_external) {
+            _external.reset(new external_files());
+            _external->resolvers = get_external_resolvers();
+        }
+        auto& state = *_external;
 
         auto search_directories = directories;
         if (search_directories.empty()) {
-            search_directories = get_external_fact_directories();
+            // The default directories are found beneath the root directory
+            scoped_root rooted(_root);
+            for (auto& directory : get_external_fact_directories()) {
+                search_directories.emplace_back(scoped_root::path(directory));
+            }
         }
 
-        // Build a map between a file and the resolver that can resolve it
-        map<string, external::resolver const*> files;
+        vector<string> found_directories;
         for (auto const& dir : search_directories) {
             // If dir is relative, make it an absolute path before passing to can_resolve.
             boost::system::error_code ec;
@@ -143,42 +443,335 @@ namespace facter { namespace facts {
             }
 
             LOG_DEBUG("searching %1% for external facts.", search_dir);
-
-            directory::each_file(search_dir.string(), [&](string const& path) {
-                for (auto const& res : resolvers) {
-                    if (res->can_resolve(path)) {
-                        files.emplace(path, res.get());
-                        break;
-                    }
-                }
-                return true;
-            });
+            found_directories.emplace_back(search_dir.string());
         }
 
+        // Start watching the directories before searching them so that no change is missed
+        state.watchers.emplace_back(new directory_watcher(found_directories));
+        state.directories.insert(state.directories.end(), found_directories.begin(), found_directories.end());
+
+        // Build a map between a file and the resolver that can resolve it
+        auto files = find_external_files(found_directories, state.resolvers);
+
         if (files.empty()) {
             LOG_DEBUG("no external facts were found.");
+            if (_cache) {
+                // Discard the cached facts of files that were removed
+                _cache->save();
+            }
             return;
         }
 
-        // Resolve the files
+        // With a fact cache, the names of an unchanged file's facts are known without resolving it, so the file is only
+        // resolved when one of its facts is needed (e.g. "cfacter somefact" resolves only the files that provide it)
+        map<string const*, vector<string>> indexed;
+        vector<pair<string const*, external::resolver const*>> work;
+        for (auto const& kvp : files) {
+            vector<string> names;
+            if (_cache) {
+                auto ttl = _cache->external_ttl(kvp.first);
+                if ((kvp.second->is_static() || ttl.count() > 0) && _cache->external_names(kvp.first, ttl, names)) {
+                    indexed.emplace(&kvp.first, move(names));
+                    continue;
+                }
+            }
+            work.emplace_back(&kvp.first, kvp.second);
+        }
+        auto recorded = resolve_external_files(work);
+
+        // A fact provided by more than one file takes the value of the last file in path order, so indexed files that
+        // share a fact with another file are resolved now and added in order with the rest
+        map<string, size_t> providers;
+        for (auto const& facts : recorded) {
+            set<string> names;
+            for (auto const& kvp : facts) {
+                names.insert(kvp.first);
+            }
+            for (auto const& name : names) {
+                ++providers[name];
+            }
+        }
+        for (auto const& kvp : indexed) {
+            for (auto const& name : set<string>(kvp.second.begin(), kvp.second.end())) {
+                ++providers[name];
+            }
+        }
+        vector<pair<string const*, external::resolver const*>> shared;
+        for (auto it = indexed.begin(); it != indexed.end();) {
+            if (any_of(it->second.begin(), it->second.end(), [&](string const& name) { return providers[name] > 1; })) {
+                shared.emplace_back(it->first, files[*it->first]);
+                it = indexed.erase(it);
+                continue;
+            }
+            ++it;
+        }
+        auto shared_recorded = resolve_external_files(shared);
+
+        map<string const*, recorded_facts*> results;
+        for (size_t i = 0; i < work.size(); ++i) {
+            results.emplace(work[i].first, &recorded[i]);
+        }
+        for (size_t i = 0; i < shared.size(); ++i) {
+            results.emplace(shared[i].first, &shared_recorded[i]);
+        }
+
         for (auto const& kvp : files) {
+            auto& file = state.files[kvp.first];
+            file.resolver = kvp.second;
+            file_version(kvp.first, file.modified, file.size);
+            file.names.clear();
+
+            auto index = indexed.find(&kvp.first);
+            if (index != indexed.end()) {
+                LOG_DEBUG("facts of external fact file \"%1%\" will be resolved when first needed.", kvp.first);
+                file.names = index->second;
+                auto res = make_shared<external_file_resolver>(kvp.first, move(index->second), kvp.second);
+                state.pending.push_back(res.get());
+                add(res);
+                continue;
+            }
+
+            // The facts a file resolved before failing are kept
+            auto& recorded = *results[&kvp.first];
+            for (auto const& fact : recorded) {
+                file.names.push_back(fact.first);
+            }
+            add(move(recorded));
+        }
+    }
+
+    vector<collection::recorded_facts> collection::resolve_external_files(vector<pair<string const*, external::resolver const*>> const& work)
+    {
+        // Resolve the files on multiple threads when resolving in parallel; each file's facts are recorded rather than added
+        // The recorded facts are then added in path order, so the result doesn't depend on which file finished first
+        vector<recorded_facts> recorded(work.size());
+        vector<exception_ptr> errors(work.size());
+        vector<char> store(work.size(), 0);
+        atomic<size_t> next(0);
+
+        auto worker = [&]() {
+            for (size_t i = next++; i < work.size(); i = next++) {
+                auto const& file = *work[i].first;
+
+                // The facts of an unchanged file are taken from the cache when the file's facts depend only on its
+                // contents or it was given a TTL (e.g. an executable that queries a remote service)
+                bool cacheable = false;
+                if (_cache) {
+                    auto ttl = _cache->external_ttl(file);
+                    cacheable = work[i].second->is_static() || ttl.count() > 0;
+                    if (cacheable && _cache->load_external(file, ttl, recorded[i])) {
+                        LOG_DEBUG("loaded cached facts for external fact file \"%1%\".", file);
+                        continue;
+                    }
+                }
+
+                collection recording;
+                recording._recording = &recorded[i];
+                scoped_trace_span tracing("external", file);
+                try {
+                    work[i].second->resolve(file, recording);
+                    store[i] = cacheable;
+                } catch (...) {
+                    errors[i] = current_exception();
+                }
+            }
+        };
+
+        auto threads = min<size_t>(_concurrency, work.size());
+        if (threads > 1) {
+            LOG_DEBUG("resolving %1% external fact files using %2% threads.", work.size(), threads);
+
+            // The calling thread is one of the workers
+            auto& pool = thread_pool::instance();
+            pool.reserve(static_cast<unsigned int>(threads - 1));
+            task_group group(pool);
+            for (size_t i = 1; i < threads; ++i) {
+                group.run(worker);
+            }
+            worker();
+            group.wait();
+        } else {
+            worker();
+        }
+
+        if (_cache) {
+            for (size_t i = 0; i < work.size(); ++i) {
+                if (store[i]) {
+                    _cache->store_external(*work[i].first, recorded[i]);
+                }
+            }
+            _cache->save();
+        }
+
+        for (size_t i = 0; i < work.size(); ++i) {
+            if (!errors[i]) {
+                continue;
+            }
             try {
-                kvp.second->resolve(kvp.first, *this);
+                rethrow_exception(errors[i]);
             }
             catch (external::external_fact_exception& ex) {
-                LOG_ERROR("error while processing \"%1%\" for external facts: %2%", kvp.first, ex.what());
+                LOG_ERROR("error while processing \"%1%\" for external facts: %2%", *work[i].first, ex.what());
             }
         }
+        return recorded;
     }
 
-    void collection::add_environment_facts(function<void(string const& name)> callback)
+    set<string> collection::refresh_external_facts()
     {
-        environment::each([&](string& name, string& value) {
-            // If the variable starts with "FACTER_", the remainder of the variable is the fact name
-            if (!boost::istarts_with(name, "FACTER_")) {
-                return true;
+        if (!_external) {
+            return {};
+        }
+        auto& state = *_external;
+
+        // Files whose facts have not been needed yet are resolved first, so that their facts can be compared
+        if (!state.pending.empty()) {
+            set<resolver const*> plan(state.pending.begin(), state.pending.end());
+            state.pending.clear();
+            resolve_facts(&plan);
+        }
+
+        // Every watcher is asked for its changes, even once one of them can't tell, so that no change is reported twice
+        set<string> candidates;
+        bool known = true;
+        for (auto& watcher : state.watchers) {
+            known = watcher->changes(candidates) && known;
+        }
+
+        // Find the files that were added or changed and the files that were removed
+        map<string, external::resolver const*> changed;
+        set<string> removed;
+        if (known) {
+            for (auto const& candidate : candidates) {
+                boost::system::error_code ec;
+                external::resolver const* found = nullptr;
+                if (is_regular_file(candidate, ec)) {
+                    for (auto const& res : state.resolvers) {
+                        if (res->can_resolve(candidate)) {
+                            found = res.get();
+                            break;
+                        }
+                    }
+                }
+                if (found) {
+                    changed.emplace(candidate, found);
+                } else if (state.files.count(candidate)) {
+                    removed.insert(candidate);
+                }
+            }
+        } else {
+            LOG_DEBUG("scanning external fact directories for changed files.");
+            auto current = find_external_files(state.directories, state.resolvers);
+            for (auto const& kvp : current) {
+                auto it = state.files.find(kvp.first);
+                time_t modified;
+                uintmax_t size;
+                file_version(kvp.first, modified, size);
+                if (it == state.files.end() || it->second.resolver != kvp.second || it->second.modified != modified || it->second.size != size) {
+                    changed.insert(kvp);
+                }
+            }
+            for (auto const& kvp : state.files) {
+                if (!current.count(kvp.first)) {
+                    removed.insert(kvp.first);
+                }
+            }
+        }
+        if (changed.empty() && removed.empty()) {
+            return {};
+        }
+
+        LOG_DEBUG("%1% external fact files were added or changed and %2% were removed.", changed.size(), removed.size());
+
+        // The facts of the changed and removed files are affected, as are the facts the changed files now provide
+        set<string> affected;
+        for (auto const& path : removed) {
+            auto const& names = state.files[path].names;
+            affected.insert(names.begin(), names.end());
+            state.files.erase(path);
+        }
+        vector<pair<string const*, external::resolver const*>> work;
+        for (auto const& kvp : changed) {
+            auto it = state.files.find(kvp.first);
+            if (it != state.files.end()) {
+                affected.insert(it->second.names.begin(), it->second.names.end());
+            }
+            work.emplace_back(&kvp.first, kvp.second);
+        }
+        auto recorded = resolve_external_files(work);
+
+        map<string const*, recorded_facts*> results;
+        for (size_t i = 0; i < work.size(); ++i) {
+            auto& file = state.files[*work[i].first];
+            file.resolver = work[i].second;
+            file_version(*work[i].first, file.modified, file.size);
+            file.names.clear();
+            for (auto const& kvp : recorded[i]) {
+                file.names.push_back(kvp.first);
+                affected.insert(kvp.first);
+            }
+            results.emplace(&state.files.find(*work[i].first)->first, &recorded[i]);
+        }
+
+        // As when the facts were added, the last file in path order that provides a fact wins
+        map<string, string const*> winners;
+        for (auto const& kvp : state.files) {
+            for (auto const& name : kvp.second.names) {
+                if (affected.count(name)) {
+                    winners[name] = &kvp.first;
+                }
+            }
+        }
+
+        // An unchanged file that provides an affected fact is resolved again, since its value is replaced
+        vector<pair<string const*, external::resolver const*>> unchanged;
+        for (auto const& kvp : winners) {
+            if (results.count(kvp.second) || any_of(unchanged.begin(), unchanged.end(), [&](pair<string const*, external::resolver const*> const& entry) { return entry.first == kvp.second; })) {
+                continue;
+            }
+            unchanged.emplace_back(kvp.second, state.files[*kvp.second].resolver);
+        }
+        auto unchanged_recorded = resolve_external_files(unchanged);
+        for (size_t i = 0; i < unchanged.size(); ++i) {
+            results.emplace(unchanged[i].first, &unchanged_recorded[i]);
+        }
+
+        // Set aside the current values of the affected facts so that facts that are no longer provided are removed
+        map<string, unique_ptr<value>> previous;
+        {
+            lock_type lock(_mutex);
+            for (auto const& name : affected) {
+                auto it = find_fact(name);
+                if (it != _facts.end()) {
+                    previous.emplace(name, move(it->second));
+                    erase_fact(it);
+                }
             }
+        }
+
+        recorded_facts provided;
+        for (auto const& kvp : state.files) {
+            auto result = results.find(&kvp.first);
+            if (result == results.end()) {
+                continue;
+            }
+            for (auto& fact : *result->second) {
+                auto winner = winners.find(fact.first);
+                if (winner != winners.end() && winner->second == &kvp.first) {
+                    provided.emplace_back(move(fact.first), move(fact.second));
+                }
+            }
+        }
+        add(move(provided));
+
+        lock_type lock(_mutex);
+        return report_changes(previous, [&](string const& name) { return affected.count(name) > 0; }, lock);
+    }
 
+    void collection::add_environment_facts(function<void(string const& name)> callback)
+    {
+        environment::each("FACTER_", [&](string& name, string& value) {
+            // The remainder of the variable after "FACTER_" is the fact name
             auto fact_name = name.substr(7);
             boost::to_lower(fact_name);
             LOG_DEBUG("setting fact \"%1%\" based on the value of environment variable \"%2%\".", fact_name, name);
@@ -192,346 +785,1321 @@ namespace facter { namespace facts {
         });
     }
 
+    bool collection::add_msgpack_facts(string const& data)
+    {
+        // Decode every fact before adding any so that malformed data adds nothing
+        vector<pair<string, unique_ptr<value>>> decoded;
+        try {
+            read_msgpack_facts(data, [&](string&& name, unique_ptr<value> val) {
+                decoded.emplace_back(move(name), move(val));
+            });
+        } catch (msgpack_exception& ex) {
+            LOG_WARNING("facts could not be decoded from MessagePack: %1%.", ex.what());
+            return false;
+        }
+
+        add(move(decoded));
+        return true;
+    }
+
     void collection::remove(shared_ptr<resolver> const& res)
     {
         if (!res) {
             return;
         }
 
-        // Remove all name associations
-        for (auto const& name : res->names()) {
-            auto range = _resolver_map.equal_range(name);
-            auto it = range.first;
-            while (it != range.second) {
-                if (it->second != res) {
-                    ++it;
-                    continue;
-                }
-                it = _resolver_map.erase(it);
-            }
-        }
+        lock_type lock(_mutex);
+        unregister(res);
+        _added.remove(res);
+        _resolved_at.erase(res.get());
+    }
 
-        _pattern_resolvers.remove(res);
+    void collection::unregister(shared_ptr<resolver> const& res)
+    {
+        _index->remove(res);
         _resolvers.remove(res);
     }
 
     void collection::remove(string const& name)
     {
-        // Ensure the fact is in the collection
-        // This will properly resolve the fact prior to removing it
-        if (!get_value(name)) {
-            return;
-        }
+        lock_type lock(_mutex);
 
-        _facts.erase(name);
+        // Resolve the resolvers of the fact first so that they don't add it back later
+        resolve_fact(name, lock);
+        auto it = find_fact(name);
+        if (it != _facts.end()) {
+            erase_fact(it);
+        }
     }
 
     void collection::clear()
     {
+        lock_type lock(_mutex);
         _facts.clear();
+        index_facts();
         _resolvers.clear();
-        _resolver_map.clear();
-        _pattern_resolvers.clear();
+        _added.clear();
+        _resolved_at.clear();
+        _overrides.clear();
+        _scoped.clear();
+        _index->clear();
     }
 
     bool collection::empty()
     {
+        lock_type lock(_mutex);
         return _facts.empty() && _resolvers.empty();
     }
 
     size_t collection::size()
     {
         resolve_facts();
+
+        lock_type lock(_mutex);
         return _facts.size();
     }
 
-    value const* collection::operator[](string const& name)
+    unsigned int collection::concurrency() const
     {
-        return get_value(name);
+        return _concurrency;
     }
 
-    void collection::each(function<bool(string const&, value const*)> func)
+    void collection::concurrency(unsigned int threads)
     {
-        resolve_facts();
+        _concurrency = threads;
+    }
 
-        find_if(begin(_facts), end(_facts), [&func](map<string, unique_ptr<value>>::value_type const& it) {
-            return !func(it.first, it.second.get());
-        });
+    void collection::cache(string path, map<string, chrono::seconds> ttls, chrono::seconds unavailable_ttl, chrono::seconds max_ttl)
+    {
+        _cache.reset(new fact_cache(move(path), move(ttls), unavailable_ttl, max_ttl));
     }
 
-    ostream& collection::write(ostream& stream, format fmt, set<string> const& queries)
+    // The resolvers whose facts do not change until the host is rebooted
+    static set<string> const boot_resolvers = {
+        "Azure",
+        "desktop management interface",
+        "DigitalOcean",
+        "disk",
+        "EC2",
+        "GCE",
+        "kernel",
+        "OpenStack",
+        "operating system",
+        "processor",
+        "ssh",
+    };
+
+    void collection::prime_cache()
     {
-        if (queries.empty()) {
-            // Resolve all facts
-            resolve_facts();
+        if (!_cache) {
+            LOG_WARNING("facts cannot be primed without a cache file.");
+            return;
+        }
+        if (!_cache->can_prime()) {
+            LOG_WARNING("facts cannot be primed in cache %1%: the current boot cannot be identified.", _cache->path());
+            return;
         }
 
-        if (fmt == format::hash) {
-            write_hash(stream, queries);
-        } else if (fmt == format::json) {
-            write_json(stream, queries);
-        } else if (fmt == format::yaml) {
-            write_yaml(stream, queries);
+        set<string> names;
+        {
+            lock_type lock(_mutex);
+            for (auto const& res : _resolvers) {
+                if (boot_resolvers.count(res->name())) {
+                    _cache->prime(*res);
+                    names.insert(res->names().begin(), res->names().end());
+                }
+            }
         }
-        return stream;
+        if (names.empty()) {
+            return;
+        }
+        LOG_DEBUG("priming cache %1% with %2% facts.", _cache->path(), names.size());
+        resolve(names);
     }
 
-    void collection::resolve_facts()
+    void collection::unavailable(resolver const& res)
     {
-        // Remove the front of the resolvers list and resolve until no resolvers are left
-        while (!_resolvers.empty()) {
-            auto resolver = _resolvers.front();
-            remove(resolver);
-            LOG_DEBUG("resolving %1% facts.", resolver->name());
-            resolver->resolve(*this);
+        // The cache locks itself, so this can be called while the resolver resolves without the collection locked
+        if (_cache) {
+            _cache->store_unavailable(res);
         }
     }
 
-    void collection::resolve_fact(string const& name)
+    void collection::timeouts(chrono::milliseconds timeout, map<string, chrono::milliseconds> timeouts)
     {
-        // Resolve every resolver mapped to this name first
-        auto range = _resolver_map.equal_range(name);
-        auto it = range.first;
-        while (it != range.second) {
-            auto resolver = (it++)->second;
-            remove(resolver);
-            LOG_DEBUG("resolving %1% facts.", resolver->name());
-            resolver->resolve(*this);
-        }
+        _timeout = timeout;
+        _timeouts = move(timeouts);
+    }
 
-         // Resolve every resolver that matches the given name
-        auto pattern_it = _pattern_resolvers.begin();
-        while (pattern_it != _pattern_resolvers.end()) {
-            if (!(*pattern_it)->is_match(name)) {
-                ++pattern_it;
-                continue;
-            }
-            auto resolver = *(pattern_it++);
-            remove(resolver);
-            LOG_DEBUG("resolving %1% facts.", resolver->name());
-            resolver->resolve(*this);
-        }
+    void collection::deadline(chrono::steady_clock::time_point deadline)
+    {
+        _deadline = deadline;
     }
 
-    value const* collection::get_value(string const& name)
+    void collection::cancel()
+    {
+        _cancelled = true;
+    }
+
+    void collection::filter(set<string> blocked, set<string> allowed)
     {
-        resolve_fact(name);
+        lock_type lock(_mutex);
+        _blocked = move(blocked);
+        _allowed = move(allowed);
+    }
 
-        // Lookup the fact
-        auto it = _facts.find(name);
-        return it == _facts.end() ? nullptr : it->second.get();
+    void collection::cost_budget(bool enabled)
+    {
+        _cost_budget = enabled;
     }
 
-    value const* collection::query_value(string const& query)
+    void collection::arena(bool enabled)
     {
-        // First attempt to lookup a fact with the exact name of the query
-        value const* current = get_value(query);
-        if (current) {
-            return current;
+        if (!enabled) {
+            _arena.reset();
+        } else if (!_arena) {
+            _arena.reset(new value_arena());
         }
+    }
 
-        bool in_quotes = false;
-        string segment;
-        for (auto const& c : query) {
-            if (c == '"') {
-                in_quotes = !in_quotes;
-                continue;
+    void collection::root(string root)
+    {
+        _root = move(root);
+    }
+
+    string const& collection::root() const
+    {
+        return _root;
+    }
+
+    void collection::interface_filter(vector<string> included, vector<string> excluded, bool summarize)
+    {
+        _included_interfaces = move(included);
+        _excluded_interfaces = move(excluded);
+        _summarize_interfaces = summarize;
+    }
+
+    vector<string> const& collection::included_interfaces() const
+    {
+        return _included_interfaces;
+    }
+
+    vector<string> const& collection::excluded_interfaces() const
+    {
+        return _excluded_interfaces;
+    }
+
+    bool collection::summarize_interfaces() const
+    {
+        return _summarize_interfaces;
+    }
+
+    void collection::legacy_facts_on_demand(bool on_demand)
+    {
+        _legacy_on_demand = on_demand;
+    }
+
+    bool collection::legacy_facts_on_demand() const
+    {
+        return _legacy_on_demand;
+    }
+
+    void collection::powershell_host(bool persistent)
+    {
+        _powershell_host = persistent;
+    }
+
+    bool collection::powershell_host() const
+    {
+        return _powershell_host;
+    }
+
+    void collection::filesystem_filter(vector<string> excluded, chrono::milliseconds remote_timeout)
+    {
+        _excluded_filesystems = move(excluded);
+        _remote_filesystem_timeout = remote_timeout;
+    }
+
+    vector<string> const& collection::excluded_filesystems() const
+    {
+        return _excluded_filesystems;
+    }
+
+    chrono::milliseconds collection::remote_filesystem_timeout() const
+    {
+        return _remote_filesystem_timeout;
+    }
+
+    void collection::fqdn_timeout(chrono::milliseconds timeout)
+    {
+        _fqdn_timeout = timeout;
+    }
+
+    chrono::milliseconds collection::fqdn_timeout() const
+    {
+        return _fqdn_timeout;
+    }
+
+    void collection::resolve_all(vector<collection*> const& collections, unsigned int threads)
+    {
+        if (threads > 1 && collections.size() > 1) {
+            exception_ptr error;
+            boost::mutex error_mutex;
+            atomic<size_t> next(0);
+
+            // Each thread resolves the thread safe resolvers of the next unclaimed collection until none are left
+            auto worker = [&]() {
+                for (size_t i = next++; i < collections.size(); i = next++) {
+                    auto facts = collections[i];
+                    if (!facts) {
+                        continue;
+                    }
+                    try {
+                        lock_type lock(facts->_mutex);
+                        set<resolver const*> budgeted;
+                        if (facts->_cost_budget) {
+                            budgeted = facts->plan_within_budget(lock);
+                        }
+                        while (auto res = facts->next_resolver(true, facts->_cost_budget ? &budgeted : nullptr, false)) {
+                            facts->resolve(move(res), lock);
+                        }
+                    } catch (...) {
+                        boost::lock_guard<boost::mutex> lock(error_mutex);
+                        if (!error) {
+                            error = current_exception();
+                        }
+                    }
+                }
+            };
+
+            LOG_DEBUG("resolving %1% fact collections using %2% threads.", collections.size(), threads);
+
+            // The calling thread is one of the workers
+            auto& pool = thread_pool::instance();
+            pool.reserve(threads - 1);
+            task_group group(pool);
+            for (unsigned int i = 1; i < threads && i < collections.size(); ++i) {
+                group.run(worker);
             }
-            if (in_quotes || c != '.') {
-                segment += c;
-                continue;
+            worker();
+            group.wait();
+
+            if (error) {
+                rethrow_exception(error);
             }
-            current = lookup(current, segment);
-            if (!current) {
-                return nullptr;
+        }
+
+        // Resolve what remains (e.g. resolvers that are not thread safe) on the calling thread
+        for (auto facts : collections) {
+            if (facts) {
+                facts->resolve_facts();
             }
-            segment.clear();
         }
+    }
+
+    vector<resolver_timing> collection::timings()
+    {
+        lock_type lock(_mutex);
 
-        if (!segment.empty()) {
-            current = lookup(current, segment);
+        vector<resolver_timing> result;
+        result.reserve(_timings.size());
+        for (auto const& kvp : _timings) {
+            result.push_back(kvp.second);
         }
-        return current;
+        stable_sort(result.begin(), result.end(), [](resolver_timing const& first, resolver_timing const& second) {
+            return first.wall_time > second.wall_time;
+        });
+        return result;
     }
 
-    value const* collection::lookup(value const* value, string const& name)
+    vector<fact_memory_usage> collection::memory_usage()
     {
-        if (!value) {
-            value = get_value(name);
-            if (!value) {
-                LOG_DEBUG("fact \"%1%\" does not exist.", name);
+        resolve_facts();
+
+        lock_type lock(_mutex);
+        vector<fact_memory_usage> result;
+        result.reserve(_facts.size());
+        for (auto const& kvp : _facts) {
+            size_t bytes = map_node_overhead + sizeof(kvp) + string_memory_usage(kvp.first);
+            if (kvp.second) {
+                bytes += kvp.second->memory_usage();
             }
-            return value;
+            result.push_back({ kvp.first, bytes });
+        }
+        stable_sort(result.begin(), result.end(), [](fact_memory_usage const& first, fact_memory_usage const& second) {
+            return first.bytes > second.bytes;
+        });
+        return result;
+    }
+
+    value const* collection::operator[](string const& name)
+    {
+        return get_value(name);
+    }
+
+    void collection::each(function<bool(string const&, value const*)> func)
+    {
+        resolve_facts();
+
+        find_if(begin(_facts), end(_facts), [&func](map<string, unique_ptr<value>>::value_type const& it) {
+            // Lazy facts without a value are skipped
+            auto val = lazy_value::resolve(it.second.get());
+            return val && !func(it.first, val);
+        });
+    }
+
+    vector<string> collection::names()
+    {
+        lock_type lock(_mutex);
+
+        // Resolvers that are resolving on other threads are no longer registered, but their facts may not have been added yet
+        set<string> names;
+        for (auto const& kvp : _facts) {
+            names.insert(kvp.first);
+        }
+        for (auto const& res : _resolvers) {
+            names.insert(res->names().begin(), res->names().end());
+        }
+        for (auto const& kvp : _active) {
+            names.insert(kvp.first->names().begin(), kvp.first->names().end());
         }
+        return vector<string>(names.begin(), names.end());
+    }
 
-        auto map = dynamic_cast<map_value const*>(value);
-        if (map) {
-            value = (*map)[name];
-            if (!value) {
-                LOG_DEBUG("cannot lookup a hash element with \"%1%\": element does not exist.", name);
+    ostream& collection::write(ostream& stream, format fmt, set<string> const& queries, bool project)
+    {
+        // Resolve only what the queries need
+        resolve(queries);
+
+        write_facts(
+            stream,
+            fmt,
+            queries,
+            [this](function<void(string const&, value const*)> const& func) {
+                for (auto const& kvp : _facts) {
+                    // Skip lazy facts without a value
+                    if (!lazy_value::resolve(kvp.second.get())) {
+                        continue;
+                    }
+                    func(kvp.first, kvp.second.get());
+                }
+            },
+            [this](string const& name) { return find_value(name); },
+            project,
+            _concurrency);
+        return stream;
+    }
+
+    ostream& collection::write_changes(ostream& stream, format fmt)
+    {
+        resolve_facts();
+
+        vector<pair<string, value const*>> facts;
+        for (auto const& kvp : _facts) {
+            auto val = lazy_value::resolve(kvp.second.get());
+            if (val && !val->hidden()) {
+                facts.emplace_back(kvp.first, val);
             }
-            return value;
         }
 
-        auto array = dynamic_cast<array_value const*>(value);
-        if (array) {
-            int index;
-            try {
-                index = stoi(name);
-            } catch (logic_error&) {
-                LOG_DEBUG("cannot lookup an array element with \"%1%\": expected an integral value.", name);
-                return nullptr;
+        vector<string> added;
+        vector<string> changed;
+        vector<string> removed;
+        if (_cache) {
+            _cache->compare_last_run(facts, added, changed, removed);
+        } else {
+            for (auto const& kvp : facts) {
+                added.push_back(kvp.first);
             }
-            if (index < 0) {
-                LOG_DEBUG("cannot lookup an array element with \"%1%\": expected a non-negative value.", name);
-                return nullptr;
+        }
+
+        // The changes are written as facts, copying the values of the facts that were added or changed
+        auto copy = [this](vector<string> const& names) {
+            auto values = make_shared<map_value>();
+            for (auto const& name : names) {
+                shared_ptr<value const> val = lazy_value::resolve(find_fact(name)->second.get())->clone();
+                if (val) {
+                    values->add(name, move(val));
+                }
             }
-            if (array->empty()) {
-                LOG_DEBUG("cannot lookup an array element with \"%1%\": the array is empty.", name);
-                return nullptr;
+            return values;
+        };
+        map<string, shared_ptr<value const>> changes;
+        changes["added"] = copy(added);
+        changes["changed"] = copy(changed);
+        auto names = make_shared<array_value>();
+        for (auto& name : removed) {
+            names->add(make_value<string_value>(move(name)));
+        }
+        changes["removed"] = names;
+
+        write_facts(
+            stream,
+            fmt,
+            {},
+            [&](function<void(string const&, value const*)> const& func) {
+                for (auto const& kvp : changes) {
+                    func(kvp.first, kvp.second.get());
+                }
+            },
+            [&](string const& name) -> value const* {
+                auto it = changes.find(name);
+                return it == changes.end() ? nullptr : it->second.get();
+            });
+        return stream;
+    }
+
+    ostream& collection::write_streaming(ostream& stream, format fmt)
+    {
+        if (fmt == format::msgpack) {
+            return write(stream, fmt);
+        }
+
+        write_facts(
+            stream,
+            fmt,
+            {},
+            [this](function<void(string const&, value const*)> const& func) {
+                // A fact is final once no resolver left to resolve provides it or depends on it
+                set<string> written;
+                auto write_final = [&](lock_type& lock, bool everything) {
+                    vector<string> ready;
+                    for (auto const& kvp : _facts) {
+                        bool pending = !everything && any_of(_resolvers.begin(), _resolvers.end(), [&](shared_ptr<resolver> const& res) {
+                            return provides(*res, kvp.first) ||
+                                find(res->dependencies().begin(), res->dependencies().end(), kvp.first) != res->dependencies().end();
+                        });
+                        if (!pending) {
+                            ready.push_back(kvp.first);
+                        }
+                    }
+                    for (auto& name : ready) {
+                        auto it = find_fact(name);
+                        unique_ptr<value> val = move(it->second);
+                        erase_fact(it);
+
+                        // A resolver may add a fact it doesn't declare after the fact was written; only the first value is written
+                        if (!written.insert(name).second) {
+                            LOG_DEBUG("fact \"%1%\" was added after it was written and will not be written again.", name);
+                            continue;
+                        }
+
+                        // Skip lazy facts without a value
+                        lock.unlock();
+                        if (lazy_value::resolve(val.get())) {
+                            func(name, val.get());
+                        }
+                        val.reset();
+                        lock.lock();
+                    }
+                };
+
+                // Facts added before resolving (e.g. external facts) may already be final
+                {
+                    lock_type lock(_mutex);
+                    write_final(lock, false);
+                }
+                resolve_facts(nullptr, [&](lock_type& lock) { write_final(lock, false); });
+
+                // Resolvers left unresolved (e.g. expensive resolvers outside the cost budget) won't change what's left
+                lock_type lock(_mutex);
+                write_final(lock, true);
+            },
+            [this](string const& name) { return find_value(name); });
+        return stream;
+    }
+
+    shared_ptr<snapshot const> collection::take_snapshot(shared_ptr<snapshot const> const& previous)
+    {
+        resolve_facts();
+
+        // Copy the facts while holding the lock; lazy facts are evaluated and those without a value are skipped
+        lock_type lock(_mutex);
+        map<string, shared_ptr<value const>> facts;
+        for (auto const& kvp : _facts) {
+            auto val = lazy_value::resolve(kvp.second.get());
+            if (!val) {
+                continue;
             }
-            if (static_cast<size_t>(index) >= array->size()) {
-                LOG_DEBUG("cannot lookup an array element with \"%1%\": expected an integral value between 0 and %2% (inclusive).", name, array->size() - 1);
-                return nullptr;
+            auto copy = val->clone();
+            if (copy) {
+                facts.emplace(kvp.first, move(copy));
             }
-            return (*array)[index];
         }
-        return nullptr;
+        return make_shared<snapshot const>(move(facts), previous);
     }
 
-    void collection::write_hash(ostream& stream, set<string> const& queries)
+    void collection::resolve(set<string> const& queries)
     {
-        // If there's only one query, print the result without the name
-        if (queries.size() == 1) {
-            auto value = query_value(*queries.begin());
-            if (value) {
-                value->write(stream, false);
-            }
+        if (queries.empty()) {
+            resolve_facts();
             return;
         }
 
-        bool first = true;
-        auto writer = ([&](string const& key, value const* val) {
-            // Ignore facts with hidden values
-            if (queries.empty() && val && val->hidden()) {
-                return;
+        lock_type lock(_mutex);
+
+        // Queries resolved while resolving (e.g. by a resolver looking up a fact) only apply until they're resolved
+        auto outer = _queries.size();
+
+        // Plan the resolvers responsible for the top-level fact of each query
+        // Resolvers can use the queries to skip work for values that were not queried
+        // A resolver that was resolved for queries that don't select these values is resolved again for its queries and these
+        vector<string> pending;
+        for (auto const& query : queries) {
+            auto segments = split_query(query);
+            if (segments.empty()) {
+                continue;
             }
-            if (first) {
-                first = false;
-            } else {
-                stream << '\n';
+            auto scope = register_unselected(segments);
+            _queries.insert(_queries.end(), scope.begin(), scope.end());
+            _queries.push_back(segments);
+            pending.push_back(query);
+            pending.push_back(segments.front());
+        }
+
+        // Plan the providers of every declared dependency; dependencies are needed in full
+        set<resolver const*> plan;
+        while (!pending.empty()) {
+            auto name = move(pending.back());
+            pending.pop_back();
+            for (auto const& res : _resolvers) {
+                if (plan.count(res.get()) || !provides(*res, name)) {
+                    continue;
+                }
+                plan.insert(res.get());
+                for (auto const& dependency : res->dependencies()) {
+                    auto scope = register_unselected({ dependency });
+                    _queries.insert(_queries.end(), scope.begin(), scope.end());
+                    _queries.push_back({ dependency });
+                    pending.push_back(dependency);
+                }
             }
-            stream << key << " => ";
-            if (val) {
-                val->write(stream, false);
+        }
+
+        LOG_DEBUG("resolving %1% of %2% resolvers for the requested queries.", plan.size(), _resolvers.size());
+
+        lock.unlock();
+        try {
+            resolve_facts(&plan);
+        } catch (...) {
+            lock.lock();
+            _queries.resize(outer);
+            throw;
+        }
+        lock.lock();
+        _queries.resize(outer);
+    }
+
+    bool collection::is_queried(string const& path) const
+    {
+        if (_queries.empty()) {
+            return true;
+        }
+
+        // A query selects the value if either path is a prefix of the other; a "*" segment in the path matches any segment
+        auto segments = split_query(path);
+        return any_of(_queries.begin(), _queries.end(), [&](vector<string> const& query) {
+            for (size_t i = 0; i < query.size() && i < segments.size(); ++i) {
+                if (segments[i] != "*" && segments[i] != query[i]) {
+                    return false;
+                }
             }
+            return true;
         });
+    }
 
-        if (!queries.empty()) {
-            // Print queried facts
-            vector<pair<string, value const*>> facts;
-            for (auto const& query : queries) {
-                facts.push_back(make_pair(query, this->query_value(query)));
+    bool collection::is_legacy_queried(resolver const& res) const
+    {
+        if (!_legacy_on_demand) {
+            return true;
+        }
+
+        // Resolving everything never outputs hidden facts; a query names a legacy fact by its top-level segment
+        return any_of(_queries.begin(), _queries.end(), [&](vector<string> const& query) {
+            return !query.empty() && res.is_match(query.front());
+        });
+    }
+
+    set<string> collection::refresh(set<string> const& names)
+    {
+        lock_type lock(_mutex);
+
+        set<resolver const*> selected;
+        for (auto const& kvp : _resolved_at) {
+            if (any_of(names.begin(), names.end(), [&](string const& name) { return provides(*kvp.first, name); })) {
+                selected.insert(kvp.first);
             }
+        }
+        return refresh(move(selected), lock);
+    }
 
-            for (auto const& kvp : facts) {
-                writer(kvp.first, kvp.second);
+    set<string> collection::refreshable_facts()
+    {
+        lock_type lock(_mutex);
+
+        set<string> names;
+        for (auto const& kvp : _facts) {
+            if (_overrides.count(kvp.first)) {
+                continue;
             }
-        } else {
-            // Print all facts in the map
-            for (auto const& kvp : _facts) {
-                writer(kvp.first, kvp.second.get());
+            if (any_of(_resolved_at.begin(), _resolved_at.end(), [&](pair<resolver const* const, chrono::steady_clock::time_point> const& resolved) {
+                return provides(*resolved.first, kvp.first);
+            })) {
+                names.insert(kvp.first);
             }
         }
+        return names;
     }
 
-    struct stream_adapter
+    set<string> collection::refresh_all_older_than(chrono::steady_clock::duration age)
     {
-        explicit stream_adapter(ostream& stream) : _stream(stream)
-        {
+        lock_type lock(_mutex);
+
+        auto now = chrono::steady_clock::now();
+        set<resolver const*> selected;
+        for (auto const& kvp : _resolved_at) {
+            if (now - kvp.second >= age) {
+                selected.insert(kvp.first);
+            }
         }
+        return refresh(move(selected), lock);
+    }
 
-        void Put(char c)
-        {
-            _stream << c;
+    set<string> collection::refresh(set<resolver const*> selected, lock_type& lock)
+    {
+        // Also refresh the resolvers that share facts with or depend on the facts of a refreshed resolver
+        select_affected(selected, true);
+        if (selected.empty()) {
+            return {};
         }
 
-     private:
-         ostream& _stream;
-    };
+        // Overridden facts keep their values, so only the facts the refreshed resolvers added are refreshed
+        auto is_selected = [&](string const& name) {
+            return !_overrides.count(name) &&
+                any_of(selected.begin(), selected.end(), [&](resolver const* res) { return provides(*res, name); });
+        };
+
+        // Set aside the current facts of the refreshed resolvers so that facts that no longer resolve are removed
+        map<string, unique_ptr<value>> previous;
+        reregister(selected, &previous);
+
+        LOG_DEBUG("refreshing %1% resolvers.", selected.size());
+
+        _refreshing = selected;
+        lock.unlock();
+        try {
+            resolve_facts(&selected);
+        } catch (...) {
+            lock.lock();
+            _refreshing.clear();
+            throw;
+        }
+        lock.lock();
+        _refreshing.clear();
+
+        return report_changes(previous, is_selected, lock);
+    }
+
+    void collection::select_affected(set<resolver const*>& selected, bool dependents) const
+    {
+        // Resolvers for the same facts must be resolved again together so that the last one added still wins
+        bool expanded = true;
+        while (expanded) {
+            expanded = false;
+            for (auto const& kvp : _resolved_at) {
+                auto const& res = *kvp.first;
+                if (selected.count(&res)) {
+                    continue;
+                }
+                bool affected = any_of(selected.begin(), selected.end(), [&](resolver const* other) {
+                    return any_of(res.names().begin(), res.names().end(), [&](string const& name) {
+                        return provides(*other, name);
+                    }) || (dependents && any_of(res.dependencies().begin(), res.dependencies().end(), [&](string const& dependency) {
+                        return provides(*other, dependency);
+                    }));
+                });
+                if (affected) {
+                    selected.insert(&res);
+                    expanded = true;
+                }
+            }
+        }
+    }
 
-    void collection::write_json(ostream& stream, set<string> const& queries)
+    vector<vector<string>> collection::reregister(set<resolver const*> const& selected, map<string, unique_ptr<value>>* previous)
     {
-        Document document;
-        document.SetObject();
+        // Remove the facts the resolvers added; overridden facts keep their values
+        for (auto it = _facts.begin(); it != _facts.end();) {
+            if (_overrides.count(it->first) || none_of(selected.begin(), selected.end(), [&](resolver const* res) { return provides(*res, it->first); })) {
+                ++it;
+                continue;
+            }
+            if (previous) {
+                previous->emplace(it->first, move(it->second));
+            }
+            it = erase_fact(it);
+        }
 
-        auto builder = ([&](string const& key, value const* val) {
-            // Ignore facts with hidden values
-            if (queries.empty() && val && val->hidden()) {
-                return;
+        // Register the resolvers again in the order they were added, returning the queries they were last resolved for
+        vector<vector<string>> scope;
+        for (auto const& res : _added) {
+            if (!selected.count(res.get())) {
+                continue;
             }
-            rapidjson::Value value;
-            if (val) {
-                val->to_json(document.GetAllocator(), value);
-            } else {
-                value.SetString("", 0);
+            auto scoped = _scoped.find(res.get());
+            if (scoped != _scoped.end()) {
+                scope.insert(scope.end(), scoped->second.begin(), scoped->second.end());
+                _scoped.erase(scoped);
             }
-            document.AddMember(key.c_str(), value, document.GetAllocator());
+            _resolved_at.erase(res.get());
+            _index->add(res);
+            _resolvers.push_back(res);
+        }
+        return scope;
+    }
+
+    bool collection::selects(resolver const& res, vector<vector<string>> const& scope, vector<string> const& query) const
+    {
+        // A query selects every value of another query it is a prefix of; an empty query selects everything
+        // Legacy facts on demand were only added if a query named one of the resolver's legacy facts
+        bool legacy = _legacy_on_demand && res.is_match(query.front());
+        return any_of(scope.begin(), scope.end(), [&](vector<string> const& selected) {
+            if (legacy && (selected.empty() || !res.is_match(selected.front()))) {
+                return false;
+            }
+            return selected.size() <= query.size() && equal(selected.begin(), selected.end(), query.begin());
         });
+    }
 
-        if (!queries.empty()) {
-            for (auto const& query : queries) {
-                builder(query, this->query_value(query));
+    vector<vector<string>> collection::register_unselected(vector<string> const& query)
+    {
+        set<resolver const*> unselected;
+        for (auto const& kvp : _scoped) {
+            if (provides(*kvp.first, query.front()) && !selects(*kvp.first, kvp.second, query)) {
+                unselected.insert(kvp.first);
             }
-        } else {
-            for (auto const& kvp : _facts) {
-                builder(kvp.first, kvp.second.get());
+        }
+        if (unselected.empty()) {
+            return {};
+        }
+        LOG_DEBUG("resolving %1% resolvers again as they were resolved for queries that do not select all of %2%.", unselected.size(), boost::join(query, "."));
+        select_affected(unselected, false);
+        return reregister(unselected, nullptr);
+    }
+
+    void collection::resolve_unselected(string const& query)
+    {
+        auto segments = split_query(query);
+        if (segments.empty()) {
+            return;
+        }
+        {
+            lock_type lock(_mutex);
+            if (none_of(_scoped.begin(), _scoped.end(), [&](pair<resolver const* const, vector<vector<string>>> const& kvp) {
+                return provides(*kvp.first, segments.front()) && !selects(*kvp.first, kvp.second, segments);
+            })) {
+                return;
+            }
+        }
+        // Planning the query resolves the resolvers again for the queries they were resolved for and this one
+        resolve(set<string>{ query });
+    }
+
+    set<string> collection::report_changes(map<string, unique_ptr<value>> const& previous, function<bool(string const&)> const& is_selected, lock_type& lock)
+    {
+        // Report the facts that were added, removed, or changed
+        set<string> changed;
+        vector<fact_change> changes;
+        for (auto const& kvp : previous) {
+            auto it = find_fact(kvp.first);
+            if (it == _facts.end()) {
+                changed.insert(kvp.first);
+                changes.push_back({ kvp.first, kvp.second.get(), nullptr, { query_segment(kvp.first) } });
+                continue;
+            }
+            if (kvp.second->hidden() == it->second->hidden() && kvp.second->equals(*it->second)) {
+                continue;
+            }
+            changed.insert(kvp.first);
+            fact_change change{ kvp.first, kvp.second.get(), it->second.get(), {} };
+            diff(*kvp.second, *it->second, query_segment(kvp.first), change.paths);
+            if (change.paths.empty()) {
+                // Only whether or not the value is hidden changed
+                change.paths.push_back(query_segment(kvp.first));
+            }
+            changes.push_back(move(change));
+        }
+        for (auto const& kvp : _facts) {
+            if (!previous.count(kvp.first) && is_selected(kvp.first)) {
+                changed.insert(kvp.first);
+                changes.push_back({ kvp.first, nullptr, kvp.second.get(), { query_segment(kvp.first) } });
+            }
+        }
+
+        // Notify the subscribers without holding the lock so that they can query the collection
+        // The previous values are owned by the caller, but the current values are copied as they may be replaced meanwhile
+        if (!changes.empty() && !_subscribers.empty()) {
+            auto subscribers = _subscribers;
+            vector<unique_ptr<value>> copies;
+            for (auto& change : changes) {
+                if (change.current) {
+                    copies.emplace_back(change.current->clone());
+                    change.current = copies.back().get();
+                }
             }
+            lock.unlock();
+            for (auto const& change : changes) {
+                for (auto const& kvp : subscribers) {
+                    kvp.second(change);
+                }
+            }
+            lock.lock();
         }
+        return changed;
+    }
 
-        stream_adapter adapter(stream);
-        PrettyWriter<stream_adapter> writer(adapter);
-        writer.SetIndent(' ', 2);
-        document.Accept(writer);
+    size_t collection::subscribe(function<void(fact_change const&)> callback)
+    {
+        lock_type lock(_mutex);
+        auto id = ++_next_subscriber;
+        _subscribers.emplace(id, move(callback));
+        return id;
     }
 
-    void collection::write_yaml(ostream& stream, set<string> const& queries)
+    void collection::unsubscribe(size_t id)
     {
-        Emitter emitter(stream);
-        emitter << BeginMap;
+        lock_type lock(_mutex);
+        _subscribers.erase(id);
+    }
 
-        auto writer = ([&](string const& key, value const* val) {
-            // Ignore facts with hidden values
-            if (queries.empty() && val && val->hidden()) {
-                return;
+    void collection::resolve_facts(set<resolver const*> const* plan, function<void(lock_type&)> const& resolved)
+    {
+        // Commands executed by more than one resolver are only run once while resolving
+        // The outermost resolution owns the cache so that commands are run again the next time facts are resolved
+        bool owner = false;
+        {
+            lock_type lock(_mutex);
+            if (!_commands) {
+                _commands.reset(new execution::command_cache());
+                owner = true;
             }
-            emitter << Key;
-            if (needs_quotation(key)) {
-                emitter << DoubleQuoted;
+        }
+        auto release = [&](execution::command_cache*) {
+            lock_type lock(_mutex);
+            _commands.reset();
+        };
+        unique_ptr<execution::command_cache, decltype(release)> releasing(owner ? _commands.get() : nullptr, release);
+
+        // Resolvers that were resolved for queries may have skipped values, so they're resolved again when resolving everything
+        if (!plan) {
+            lock_type lock(_mutex);
+            if (_queries.empty()) {
+                set<resolver const*> partial;
+                for (auto const& kvp : _scoped) {
+                    if (none_of(kvp.second.begin(), kvp.second.end(), [](vector<string> const& query) { return query.empty(); })) {
+                        partial.insert(kvp.first);
+                    }
+                }
+                if (!partial.empty()) {
+                    select_affected(partial, false);
+                    reregister(partial, nullptr);
+                }
             }
-            emitter << key << YAML::Value;
-            if (val) {
-                val->write(emitter);
-            } else {
-                emitter << DoubleQuoted << "";
+        }
+
+        // When resolving everything within a cost budget, plan every resolver except the expensive ones
+        set<resolver const*> budgeted;
+        if (!plan && _cost_budget) {
+            lock_type lock(_mutex);
+            budgeted = plan_within_budget(lock);
+            plan = &budgeted;
+        }
+
+        if (_concurrency > 1) {
+            resolve_facts_parallel(plan, resolved);
+            return;
+        }
+
+        // Resolve the next resolver whose dependencies have been resolved until no resolvers are left
+        lock_type lock(_mutex);
+        while (auto res = next_resolver(false, plan, true)) {
+            resolve(move(res), lock);
+            if (resolved) {
+                resolved(lock);
             }
-        });
+        }
+    }
 
-        if (!queries.empty()) {
-            vector<pair<string, value const*>> facts;
-            for (auto const& query : queries) {
-                facts.push_back(make_pair(query, this->query_value(query)));
+    set<resolver const*> collection::plan_within_budget(lock_type& lock) const
+    {
+        // Expensive resolvers are still planned when a planned resolver depends on one of their facts
+        set<resolver const*> plan;
+        vector<string> pending;
+        for (auto const& res : _resolvers) {
+            if (res->is_expensive() && !_allowed.count(res->name())) {
+                LOG_DEBUG("%1% resolver is expensive and will only be resolved when its facts are queried.", res->name());
+                continue;
             }
+            plan.insert(res.get());
+            pending.insert(pending.end(), res->dependencies().begin(), res->dependencies().end());
+        }
+        while (!pending.empty()) {
+            auto name = move(pending.back());
+            pending.pop_back();
+            for (auto const& res : _resolvers) {
+                if (plan.count(res.get()) || !provides(*res, name)) {
+                    continue;
+                }
+                plan.insert(res.get());
+                pending.insert(pending.end(), res->dependencies().begin(), res->dependencies().end());
+            }
+        }
+        return plan;
+    }
 
-            for (auto const& kvp : facts) {
-                writer(kvp.first, kvp.second);
+    void collection::resolve_facts_parallel(set<resolver const*> const* plan, function<void(lock_type&)> const& resolved)
+    {
+        exception_ptr error;
+
+        // Each thread resolves the next available resolver until there are none left it can resolve
+        // Resolvers that aren't thread safe are only resolved on the calling thread
+        // The caller is only notified on the calling thread, as custom fact values may only be used on the thread that initialized Ruby;
+        // it is notified after each resolver it resolves and whenever it wakes because a resolver on another thread finished
+        auto worker = [&](bool calling_thread) {
+            lock_type lock(_mutex);
+            while (!error) {
+                // Only the calling thread breaks dependency cycles, once nothing else is resolving
+                auto res = next_resolver(!calling_thread, plan, calling_thread && _active.empty());
+                if (!res) {
+                    bool remaining = any_of(_resolvers.begin(), _resolvers.end(), [&](shared_ptr<resolver> const& other) {
+                        return (calling_thread || other->is_thread_safe()) && (!plan || plan->count(other.get()));
+                    });
+                    if (!remaining) {
+                        break;
+                    }
+                    // Wait for a resolver that is blocking the remaining resolvers to finish
+                    _resolved.wait(lock);
+                    if (calling_thread && resolved) {
+                        resolved(lock);
+                    }
+                    continue;
+                }
+                try {
+                    resolve(move(res), lock);
+                    if (calling_thread && resolved) {
+                        resolved(lock);
+                    }
+                } catch (...) {
+                    if (!error) {
+                        error = current_exception();
+                    }
+                    _resolved.notify_all();
+                }
             }
+        };
+
+        LOG_DEBUG("resolving facts using %1% threads.", _concurrency);
+
+        // Resolvers block (e.g. executing commands), so the pool needs a thread for every worker other than the calling thread
+        auto& pool = thread_pool::instance();
+        pool.reserve(_concurrency - 1);
+        task_group group(pool);
+        for (unsigned int i = 1; i < _concurrency; ++i) {
+            group.run([&]() { worker(false); });
+        }
+        worker(true);
+        group.wait();
+
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+    void collection::resolve_fact(string const& name, lock_type& lock)
+    {
+        // Resolve every resolver mapped to this name first, followed by every resolver that matches the name
+        // The lock is released while resolving, so search again after each resolver
+        while (auto res = _index->find(name)) {
+            resolve(move(res), lock);
+        }
+
+        // Wait for any resolvers for this name that are resolving on other threads
+        auto current = boost::this_thread::get_id();
+        while (true) {
+            auto it = find_if(_active.begin(), _active.end(), [&](map<resolver const*, boost::thread::id>::value_type const& kvp) {
+                if (kvp.second == current) {
+                    return false;
+                }
+                return provides(*kvp.first, name);
+            });
+            if (it == _active.end() || would_deadlock(it->first)) {
+                break;
+            }
+            _waiting[current] = it->first;
+            _resolved.wait(lock);
+            _waiting.erase(current);
+        }
+    }
+
+    void collection::resolve(shared_ptr<resolver> res, lock_type& lock)
+    {
+        unregister(res);
+
+        // Only the facts that resolved in time are kept once the deadline passes or resolution is cancelled
+        auto now = chrono::steady_clock::now();
+        if (_cancelled || now >= _deadline) {
+            LOG_WARNING("%1% facts were not resolved because the deadline passed or resolution was cancelled.", res->name());
+            _resolved.notify_all();
+            return;
+        }
+        auto deadline = _deadline;
+        auto timeout = _timeouts.find(res->name());
+        auto limit = timeout == _timeouts.end() ? _timeout : timeout->second;
+        if (limit.count() > 0 && now + limit < deadline) {
+            deadline = now + limit;
+        }
+
+        _active[res.get()] = boost::this_thread::get_id();
+        bool refreshing = _refreshing.count(res.get()) > 0;
+        auto commands = _commands.get();
+        auto scope = _queries;
+        lock.unlock();
+
+        statistics stats;
+        bool cached = _cache && _cache->is_cached(*res);
+        bool abandoned = false;
+        bool resolved = false;
+        FACTER_PROBE1(resolver__start, res->name().c_str());
+        try {
+            scoped_statistics recording(stats);
+            scoped_log_context tagging(scoped_log_context::for_resolver(res->name()));
+            scoped_trace_span tracing("resolver", res->name());
+            scoped_deadline limiting(deadline, &_cancelled);
+            scoped_root rooted(_root);
+            scoped_arena allocating(_arena.get());
+            execution::scoped_command_cache memoizing(commands);
+            if (_cache && _cache->is_unavailable(*res)) {
+                LOG_DEBUG("%1% facts are unavailable according to cache %2%.", res->name(), _cache->path());
+                metrics::record_cache_lookup("facts", true);
+                cached = false;
+            } else if (cached && !refreshing && _cache->load(*res, *this)) {
+                LOG_DEBUG("loaded %1% facts from cache %2%.", res->name(), _cache->path());
+                metrics::record_cache_lookup("facts", true);
+                cached = false;
+            } else {
+                if (cached) {
+                    metrics::record_cache_lookup("facts", false);
+                }
+                LOG_DEBUG("resolving %1% facts.", res->name());
+                resolved = true;
+                res->resolve(*this);
+                LOG_DEBUG("resolved %1% facts.", res->name());
+            }
+            abandoned = scoped_deadline::expired();
+        } catch (deadline_exceeded_exception& ex) {
+            LOG_WARNING("%1% facts did not resolve in time and may be incomplete: %2%", res->name(), ex.what());
+            abandoned = true;
+        } catch (...) {
+            FACTER_PROBE2(resolver__end, res->name().c_str(), 1);
+            lock.lock();
+            record(*res, stats);
+            _active.erase(res.get());
+            _resolved.notify_all();
+            throw;
+        }
+        FACTER_PROBE2(resolver__end, res->name().c_str(), abandoned ? 1 : 0);
+
+        lock.lock();
+
+        // A resolver resolved for queries that don't select all of its facts may have skipped values
+        // Such facts are not cached, and the resolver is resolved again when the values it skipped are needed
+        // An empty query selects everything; hidden legacy facts on demand are remembered separately below
+        bool partial = none_of(scope.begin(), scope.end(), [](vector<string> const& query) { return query.empty(); }) &&
+            !scope.empty() && (res->has_patterns() || !all_of(res->names().begin(), res->names().end(), [&](string const& name) {
+                return selects(*res, scope, { name });
+            }));
+        bool storing = cached && !abandoned && !partial;
+        if (storing) {
+            store(*res);
+        }
+        record(*res, stats);
+        _resolved_at[res.get()] = chrono::steady_clock::now();
+        _active.erase(res.get());
+
+        // Legacy facts on demand are only added for the queries that named them, so those are remembered too
+        if (resolved && (partial || (_legacy_on_demand && res->has_patterns()))) {
+            _scoped[res.get()] = scope.empty() ? vector<vector<string>>{ {} } : move(scope);
         } else {
+            _scoped.erase(res.get());
+        }
+        _resolved.notify_all();
+
+        // Write the cache file without the collection locked; facts stored by other resolvers meanwhile are written with it
+        if (storing) {
+            lock.unlock();
+            _cache->flush();
+            lock.lock();
+        }
+    }
+
+    void collection::store(resolver const& res)
+    {
+        // Store every fact the resolver is responsible for
+        vector<pair<string, value const*>> facts;
+        for (auto const& name : res.names()) {
+            auto it = find_fact(name);
+            if (it != _facts.end()) {
+                facts.emplace_back(it->first, it->second.get());
+            }
+        }
+        if (res.has_patterns()) {
             for (auto const& kvp : _facts) {
-                writer(kvp.first, kvp.second.get());
+                if (res.is_match(kvp.first)) {
+                    facts.emplace_back(kvp.first, kvp.second.get());
+                }
             }
         }
-        emitter << EndMap;
+        _cache->store(res, facts);
+    }
+
+    void collection::record_timing(string const& name, statistics const& stats)
+    {
+        metrics::record_resolution(name, stats);
+        lock_type lock(_mutex);
+        auto& timing = _timings[name];
+        timing.name = name;
+        timing.resolutions += 1;
+        timing.wall_time += stats.wall_time;
+        timing.cpu_time += stats.cpu_time;
+        timing.processes += stats.processes;
+        timing.bytes_read += stats.bytes_read;
+        timing.http_requests += stats.http_requests;
+    }
+
+    void collection::record(resolver const& res, statistics const& stats)
+    {
+        metrics::record_resolution(res.name(), stats);
+        auto& timing = _timings[res.name()];
+        timing.name = res.name();
+        timing.resolutions += 1;
+        timing.wall_time += stats.wall_time;
+        timing.cpu_time += stats.cpu_time;
+        timing.processes += stats.processes;
+        timing.bytes_read += stats.bytes_read;
+        timing.http_requests += stats.http_requests;
+    }
+
+    shared_ptr<resolver> collection::next_resolver(bool thread_safe_only, set<resolver const*> const* plan, bool break_cycles) const
+    {
+        auto conflicts = [](resolver const& first, resolver const& second) {
+            for (auto const& name : first.names()) {
+                if (find(second.names().begin(), second.names().end(), name) != second.names().end()) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        // A resolver is ready once no other pending or active resolver provides a fact it depends on
+        auto ready = [&](resolver const& res) {
+            for (auto const& dependency : res.dependencies()) {
+                if (any_of(_resolvers.begin(), _resolvers.end(), [&](shared_ptr<resolver> const& other) {
+                    return other.get() != &res && provides(*other, dependency);
+                }) || any_of(_active.begin(), _active.end(), [&](map<resolver const*, boost::thread::id>::value_type const& kvp) {
+                    return kvp.first != &res && provides(*kvp.first, dependency);
+                })) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Find the first ready resolver that isn't waiting on an earlier resolver for the same facts
+        // This walks the dependency graph in topological order while otherwise preserving the order in which resolvers were added
+        vector<resolver const*> skipped;
+        shared_ptr<resolver> first;
+        for (auto const& res : _resolvers) {
+            if (plan && !plan->count(res.get())) {
+                continue;
+            }
+            if (!first && (!thread_safe_only || res->is_thread_safe())) {
+                first = res;
+            }
+            bool blocked = any_of(_active.begin(), _active.end(), [&](map<resolver const*, boost::thread::id>::value_type const& kvp) {
+                return conflicts(*res, *kvp.first);
+            }) || any_of(skipped.begin(), skipped.end(), [&](resolver const* other) {
+                return conflicts(*res, *other);
+            });
+            if (!blocked && (!thread_safe_only || res->is_thread_safe()) && ready(*res)) {
+                return res;
+            }
+            skipped.push_back(res.get());
+        }
+
+        if (break_cycles && first) {
+            // The remaining resolvers depend on each other; break the cycle in the order they were added
+            // The resolver will resolve its dependencies inline
+            LOG_DEBUG("resolver dependency cycle detected: resolving %1% facts first.", first->name());
+        }
+        return break_cycles ? first : nullptr;
+    }
+
+    bool collection::would_deadlock(resolver const* res) const
+    {
+        // Follow the chain of threads waiting on each other; waiting would deadlock if it leads back to this thread
+        auto current = boost::this_thread::get_id();
+        for (size_t i = 0; res && i <= _waiting.size(); ++i) {
+            auto owner = _active.find(res);
+            if (owner == _active.end()) {
+                return false;
+            }
+            if (owner->second == current) {
+                return true;
+            }
+            auto waiting = _waiting.find(owner->second);
+            res = waiting == _waiting.end() ? nullptr : waiting->second;
+        }
+        return false;
+    }
+
+    value const* collection::get_value(string const& name)
+    {
+        // The whole fact is needed, so resolvers that were resolved for queries that select only some of it are resolved again
+        resolve_unselected(query_segment(name));
+        return find_value(name);
+    }
+
+    value const* collection::find_value(string const& name)
+    {
+        lock_type lock(_mutex);
+        resolve_fact(name, lock);
+
+        // Lookup the fact
+        auto it = find_fact(name);
+        return it == _facts.end() ? nullptr : lazy_value::resolve(it->second.get());
+    }
+
+    value const* collection::query_value(string const& query)
+    {
+        resolve_unselected(query);
+        return facts::query_value(query, [this](string const& name) { return find_value(name); });
+    }
+
+    value const* collection::query_value(facts::query const& query)
+    {
+        resolve_unselected(query.text());
+        return query.evaluate([this](string const& name) { return find_value(name); });
+    }
+
+    vector<pair<string, value const*>> collection::query_all(facts::query const& query)
+    {
+        vector<pair<string, value const*>> results;
+        resolve_unselected(query.text());
+        query.each([this](string const& name) { return find_value(name); }, [&](vector<string> const& path, value const* val) {
+            results.emplace_back(facts::query::join(path), val);
+            return true;
+        });
+        return results;
     }
 
     void collection::add_common_facts()
@@ -542,6 +2110,9 @@ namespace facter { namespace facts {
         add(make_shared<resolvers::path_resolver>());
         add(make_shared<resolvers::ec2_resolver>());
         add(make_shared<resolvers::gce_resolver>());
+        add(make_shared<resolvers::az_resolver>());
+        add(make_shared<resolvers::openstack_resolver>());
+        add(make_shared<resolvers::digitalocean_resolver>());
     }
 
 }}  // namespace facter::facts
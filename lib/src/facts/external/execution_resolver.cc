@@ -1,4 +1,6 @@
 #include <internal/facts/external/execution_resolver.hpp>
+#include <internal/facts/external/json_resolver.hpp>
+#include <internal/facts/external/yaml_resolver.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/array_value.hpp>
 #include <facter/facts/map_value.hpp>
@@ -6,6 +8,7 @@
 #include <facter/execution/execution.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <sstream>
 
 using namespace std;
 using namespace facter::execution;
@@ -14,6 +17,55 @@ using namespace facter::facts::external;
 
 namespace facter { namespace facts { namespace external {
 
+    executable_output::executable_output(collection& facts) :
+        _facts(facts),
+        _format(output_format::unknown)
+    {
+    }
+
+    bool executable_output::read_line(string& line)
+    {
+        // The first line of output determines its format
+        if (_format == output_format::unknown) {
+            if (line == "---" || boost::starts_with(line, "--- ")) {
+                _format = output_format::yaml;
+            } else if (boost::starts_with(boost::trim_left_copy(line), "{")) {
+                _format = output_format::json;
+            } else {
+                _format = output_format::lines;
+            }
+        }
+
+        if (_format != output_format::lines) {
+            _document += line;
+            _document += '\n';
+            return true;
+        }
+
+        auto pos = line.find('=');
+        if (pos == string::npos) {
+            LOG_DEBUG("ignoring line in output: %1%", line);
+            return true;
+        }
+        // Add as a string fact; the value is what remains of the line once the name is taken from it
+        string fact = line.substr(0, pos);
+        boost::to_lower(fact);
+        line.erase(0, pos + 1);
+        _facts.add(move(fact), make_value<string_value>(move(line)));
+        return true;
+    }
+
+    void executable_output::finish()
+    {
+        if (_format == output_format::json) {
+            resolve_json(&_document[0], &_document[0] + _document.size(), _facts);
+        } else if (_format == output_format::yaml) {
+            istringstream stream(_document);
+            resolve_yaml(stream, _facts);
+        }
+        _document.clear();
+    }
+
     bool execution_resolver::can_resolve(string const& path) const
     {
         // If the path can be resolved as an executable, this resolver can handle it.
@@ -28,18 +80,15 @@ namespace facter { namespace facts { namespace external {
 
         try
         {
-            execution::each_line(path, [&facts](string const& line) {
-                auto pos = line.find('=');
-                if (pos == string::npos) {
-                    LOG_DEBUG("ignoring line in output: %1%", line);
-                    return true;
-                }
-                // Add as a string fact
-                string fact = line.substr(0, pos);
-                boost::to_lower(fact);
-                facts.add(move(fact), make_value<string_value>(line.substr(pos+1)));
+            executable_output output(facts);
+            execution::each_line(path, {}, {}, [&output](string& line) {
+                return output.read_line(line);
+            }, [&path](string const& line) {
+                // Report diagnostics from the executable rather than discarding them
+                LOG_WARNING("external fact file \"%1%\" had output on stderr: %2%", path, line);
                 return true;
             }, { execution_options::defaults, execution_options::throw_on_failure });
+            output.finish();
         }
         catch (execution_exception& ex) {
             throw external_fact_exception(ex.what());
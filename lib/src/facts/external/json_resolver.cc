@@ -1,15 +1,13 @@
 #include <internal/facts/external/json_resolver.hpp>
-#include <internal/util/scoped_file.hpp>
+#include <internal/util/mapped_file.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/array_value.hpp>
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <rapidjson/reader.h>
-#include <rapidjson/filestream.h>
 #include <boost/algorithm/string.hpp>
-#include <stack>
-#include <tuple>
+#include <vector>
 
 using namespace std;
 using namespace facter::facts;
@@ -18,12 +16,65 @@ using namespace rapidjson;
 
 namespace facter { namespace facts { namespace external {
 
+    // Stream over a mapped file for parsing in situ; rapidjson expects a '\0' at the end of the input
+    struct mapped_stream
+    {
+        typedef char Ch;
+
+        mapped_stream(char* begin, char* end) :
+            _begin(begin),
+            _end(end),
+            _src(begin),
+            _dst(nullptr)
+        {
+        }
+
+        Ch Peek() const
+        {
+            return _src == _end ? '\0' : *_src;
+        }
+
+        Ch Take()
+        {
+            return _src == _end ? '\0' : *_src++;
+        }
+
+        size_t Tell() const
+        {
+            return static_cast<size_t>(_src - _begin);
+        }
+
+        Ch* PutBegin()
+        {
+            return _dst = _src;
+        }
+
+        void Put(Ch c)
+        {
+            *_dst++ = c;
+        }
+
+        size_t PutEnd(Ch* begin)
+        {
+            return static_cast<size_t>(_dst - begin);
+        }
+
+     private:
+        char* _begin;
+        char* _end;
+        char* _src;
+        char* _dst;
+    };
+
     // Helper event handler for parsing JSON data
+    // The file is parsed in situ, so keys refer to the mapped contents until their values are added rather than being copied
     struct json_event_handler
     {
         explicit json_event_handler(collection& facts) :
             _initialized(false),
-            _facts(facts)
+            _facts(facts),
+            _key(nullptr),
+            _key_length(0)
         {
         }
 
@@ -32,7 +83,7 @@ namespace facter { namespace facts { namespace external {
             check_initialized();
 
             // Ignore this fact as values cannot be null
-            _key.clear();
+            _key = nullptr;
         }
 
         void Bool(bool b)
@@ -68,13 +119,14 @@ namespace facter { namespace facts { namespace external {
         void String(char const* s, SizeType len, bool copy)
         {
             // If the stack is empty or the top is a map and we don't have a key yet, set the key
-            if ((_stack.empty() || dynamic_cast<map_value*>(get<1>(_stack.top()).get())) && _key.empty()) {
+            if ((_stack.empty() || _stack.back().map) && !_key) {
                 check_initialized();
                 _key = s;
+                _key_length = len;
                 return;
             }
 
-            add_value(make_value<string_value>(s));
+            add_value(make_value<string_value>(s, s + len));
         }
 
         void StartObject()
@@ -85,7 +137,10 @@ namespace facter { namespace facts { namespace external {
             }
 
             // Push a map onto the stack
-            _stack.emplace(make_tuple(move(_key), make_value<map_value>()));
+            auto map = make_value<map_value>();
+            auto current = map.get();
+            push(move(map));
+            _stack.back().map = current;
         }
 
         void EndObject(SizeType count)
@@ -94,14 +149,7 @@ namespace facter { namespace facts { namespace external {
             if (_stack.empty()) {
                 return;
             }
-
-            // Pop the data off the stack
-            auto top = move(_stack.top());
-            _stack.pop();
-
-            // Restore the key and add the value
-            _key = move(get<0>(top));
-            add_value(move(get<1>(top)));
+            pop();
         }
 
         void StartArray()
@@ -109,52 +157,85 @@ namespace facter { namespace facts { namespace external {
             check_initialized();
 
             // Push an array onto the stack
-            _stack.emplace(make_tuple(move(_key), make_value<array_value>()));
+            auto array = make_value<array_value>();
+            auto current = array.get();
+            push(move(array));
+            _stack.back().array = current;
         }
 
         void EndArray(SizeType count)
+        {
+            pop();
+        }
+
+     private:
+        struct frame
+        {
+            frame(char const* key, SizeType key_length, unique_ptr<value> container) :
+                key(key),
+                key_length(key_length),
+                container(move(container)),
+                array(nullptr),
+                map(nullptr)
+            {
+            }
+
+            char const* key;
+            SizeType key_length;
+            unique_ptr<value> container;
+            array_value* array;
+            map_value* map;
+        };
+
+        void push(unique_ptr<value> container)
+        {
+            _stack.emplace_back(_key, _key_length, move(container));
+            _key = nullptr;
+        }
+
+        void pop()
         {
             // Pop the data off the stack
-            auto top = move(_stack.top());
-            _stack.pop();
+            auto top = move(_stack.back());
+            _stack.pop_back();
 
             // Restore the key and add the value
-            _key = move(get<0>(top));
-            add_value(move(get<1>(top)));
+            _key = top.key;
+            _key_length = top.key_length;
+            add_value(move(top.container));
         }
 
-     private:
         template <typename T> void add_value(unique_ptr<T>&& val)
         {
             check_initialized();
 
             // If the stack is empty, just add it as a top-level fact
             if (_stack.empty()) {
-                if (_key.empty()) {
-                    throw external::external_fact_exception("expected non-empty key in object.");
-                }
-                boost::to_lower(_key);
-                _facts.add(move(_key), move(val));
+                _facts.add(boost::to_lower_copy(take_key()), move(val));
                 return;
             }
 
             // If there's an array or map on the stack, add the value as an element
-            auto& top = _stack.top();
-            auto& current = get<1>(top);
-            auto array = dynamic_cast<array_value*>(current.get());
-            if (array) {
-                array->add(move(val));
+            auto& top = _stack.back();
+            if (top.array) {
+                top.array->add(move(val));
                 return;
             }
-            auto map = dynamic_cast<map_value*>(current.get());
-            if (map) {
-                if (_key.empty()) {
-                    throw external::external_fact_exception("expected non-empty key in object.");
-                }
-                map->add(move(_key), move(val));
+            if (top.map) {
+                top.map->add(take_key(), move(val));
             }
         }
 
+        string take_key()
+        {
+            if (!_key || _key_length == 0) {
+                throw external::external_fact_exception("expected non-empty key in object.");
+            }
+            string key(_key, _key_length);
+            _key = nullptr;
+            return key;
+        }
+
         void check_initialized() const
         {
             if (!_initialized) {
@@ -164,8 +245,9 @@ namespace facter { namespace facts { namespace external {
 
         bool _initialized;
         collection& _facts;
-        string _key;
-        stack<tuple<string, unique_ptr<value>>> _stack;
+        char const* _key;
+        SizeType _key_length;
+        vector<frame> _stack;
     };
 
     bool json_resolver::can_resolve(string const& path) const
@@ -177,25 +259,33 @@ namespace facter { namespace facts { namespace external {
     {
         LOG_DEBUG("resolving facts from JSON file \"%1%\".", path);
 
-        // Open the file
-        // We used a scoped_file here because rapidjson expects a FILE*
-        scoped_file file(path, "r");
-        if (file == nullptr) {
+        // Map the file rather than reading it; strings are unescaped in place in the (private) mapping
+        // and passed to the handler without being copied into the reader's buffer first
+        mapped_file file(path);
+        if (!file.is_open()) {
             throw external_fact_exception("file could not be opened.");
         }
+        resolve_json(file.begin(), file.end(), facts);
 
-        // Use the existing FileStream class
-        FileStream stream(file);
+        LOG_DEBUG("completed resolving facts from JSON file \"%1%\".", path);
+    }
 
-        // Parse the file and report any errors
+    bool json_resolver::is_static() const
+    {
+        return true;
+    }
+
+    void resolve_json(char* begin, char* end, collection& facts)
+    {
+        mapped_stream stream(begin, end);
+
+        // Parse the text and report any errors
         Reader reader;
         json_event_handler handler(facts);
-        reader.Parse<0>(stream, handler);
+        reader.Parse<kParseInsituFlag>(stream, handler);
         if (reader.HasParseError()) {
             throw external_fact_exception(reader.GetParseError());
         }
-
-        LOG_DEBUG("completed resolving facts from JSON file \"%1%\".", path);
     }
 
 }}}  // namespace facter::facts::external
@@ -9,4 +9,9 @@ namespace facter { namespace facts { namespace external {
     {
     }
 
+    bool resolver::is_static() const
+    {
+        return false;
+    }
+
 }}}  // namespace facter::facts::external
@@ -1,9 +1,11 @@
 #include <internal/facts/external/text_resolver.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/scalar_value.hpp>
-#include <facter/util/file.hpp>
+#include <internal/util/mapped_file.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <cstring>
 
 using namespace std;
 using namespace facter::util;
@@ -19,22 +21,39 @@ namespace facter { namespace facts { namespace external {
     {
         LOG_DEBUG("resolving facts from text file \"%1%\".", path);
 
-        if (!file::each_line(path, [&facts](string& line) {
-            auto pos = line.find('=');
-            if (pos == string::npos) {
-                LOG_DEBUG("ignoring line in output: %1%", line);
-                return true;
-            }
-            // Add as a string fact
-            string fact = line.substr(0, pos);
-            boost::to_lower(fact);
-            facts.add(move(fact), make_value<string_value>(line.substr(pos+1)));
-            return true;
-        })) {
+        // Map the file and build the facts directly from its lines rather than copying each line first
+        mapped_file file(path);
+        if (!file.is_open()) {
             throw external_fact_exception("file could not be opened.");
         }
 
+        // memchr scans many bytes at a time, which matters for generated files with many lines
+        char const* end = file.end();
+        for (char const* line = file.begin(); line != end;) {
+            auto next = static_cast<char const*>(memchr(line, '\n', end - line));
+            if (!next) {
+                next = end;
+            }
+            auto pos = static_cast<char const*>(memchr(line, '=', next - line));
+            if (!pos) {
+                LOG_DEBUG("ignoring line in output: %1%", string(line, next));
+            } else {
+                // Add as a string fact, lowercasing the name as it is copied
+                string fact(pos - line, '\0');
+                transform(line, pos, fact.begin(), [](char c) {
+                    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+                });
+                facts.add(move(fact), make_value<string_value>(pos + 1, next));
+            }
+            line = next == end ? end : next + 1;
+        }
+
         LOG_DEBUG("completed resolving facts from text file \"%1%\".", path);
     }
 
+    bool text_resolver::is_static() const
+    {
+        return true;
+    }
+
 }}}  // namespace facter::facts::external
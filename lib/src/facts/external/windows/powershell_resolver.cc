@@ -1,21 +1,202 @@
 #include <internal/facts/external/windows/powershell_resolver.hpp>
+#include <internal/facts/external/execution_resolver.hpp>
 #include <internal/util/windows/system_error.hpp>
 #include <internal/util/windows/windows.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/facts/fact.hpp>
 #include <facter/execution/execution.hpp>
+#include <internal/execution/execution.hpp>
+#include <internal/execution/windows/execution.hpp>
+#include <internal/util/scoped_deadline.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <chrono>
 
 using namespace std;
 using namespace facter::execution;
+using namespace facter::util;
 using namespace facter::util::windows;
 using namespace boost::filesystem;
 
 namespace facter { namespace facts { namespace external {
 
+    // A PowerShell process that runs scripts for the resolver
+    struct powershell_resolver::host
+    {
+        host() :
+            failed(false)
+        {
+        }
+
+        ~host()
+        {
+            // The host exits when its input is closed; it's only terminated if a script is still running
+            if (child.process) {
+                child.input.release();
+                if (WaitForSingleObject(child.process, 1000) == WAIT_TIMEOUT) {
+                    terminate_child(child);
+                }
+            }
+        }
+
+        child_process child;
+        string marker;
+        bool failed;
+    };
+
+    // The command run by the host: it reads the path of a script from each line of its input, runs the script as
+    // "powershell -File" would, then writes the marker and the script's exit status on a line of their own.
+    // The command is a single line without double quotes so that it's passed to powershell as one argument.
+    static string host_command(string const& marker)
+    {
+        return
+            "$reader = New-Object System.IO.StreamReader ([Console]::OpenStandardInput()), ([System.Text.Encoding]::UTF8); "
+            "while (($path = $reader.ReadLine()) -ne $null) { "
+                "$global:LASTEXITCODE = 0; $status = 0; "
+                "try { & $path 2>$null | Out-Default; if ($LASTEXITCODE -ne 0) { $status = $LASTEXITCODE } } catch { $status = 1 }; "
+                "[Console]::Out.WriteLine('" + marker + " ' + $status); [Console]::Out.Flush() "
+            "}";
+    }
+
+    powershell_resolver::powershell_resolver(bool persistent) :
+        _persistent(persistent)
+    {
+    }
+
+    powershell_resolver::~powershell_resolver()
+    {
+        // This needs to be defined here since we use incomplete types in the header
+    }
+
+    string powershell_resolver::powershell(collection& facts) const
+    {
+        string pwrshell = "powershell";
+
+        // When facter is a 32-bit process running on 64-bit windows (such as in a 32-bit puppet installation that
+        // includes native facter), PATH-lookp finds the 32-bit powershell and leads to problems. For example, if
+        // using powershell to read values from the registry, it will read the 32-bit view of the registry. Also 32
+        // and 64-bit versions have different modules available (since PSModulePath is in system32). Use the
+        // system32 fact to find the correct powershell executable.
+        auto system32 = facts.get<string_value>(fact::windows_system32);
+        if (system32) {
+            auto pathNative = path(system32->value()) / "WindowsPowerShell" / "v1.0" / "powershell.exe";
+            auto pwrshellNative = which(pathNative.string());
+            if (!pwrshellNative.empty()) {
+                pwrshell = move(pwrshellNative);
+            }
+        }
+        return pwrshell;
+    }
+
+    bool powershell_resolver::resolve_in_host(string const& file, collection& facts) const
+    {
+        // Scripts are run one at a time, since the host only reads the next path once a script finishes
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        if (!_host) {
+            unique_ptr<host> started(new host());
+            started->marker = (boost::format("#facter-%1%-%2%#") % GetCurrentProcessId() % reinterpret_cast<uintptr_t>(this)).str();
+            try {
+                auto executable = which(powershell(facts));
+                if (executable.empty()) {
+                    throw execution_exception("powershell was not found on the PATH.");
+                }
+                vector<string> arguments = { "-NoProfile", "-NonInteractive", "-NoLogo", "-ExecutionPolicy", "Bypass",
+                                             "-Command", host_command(started->marker) };
+                start_child(executable, &arguments, nullptr, { execution_options::defaults }, false, started->child, true);
+                LOG_DEBUG("started powershell process %1% to resolve powershell scripts.", started->child.id);
+            } catch (execution_exception& ex) {
+                LOG_WARNING("powershell could not be started to run every script: %1%", ex.what());
+                started->failed = true;
+            }
+            _host = move(started);
+        }
+        if (_host->failed) {
+            return false;
+        }
+
+        // Give the host the path of the script
+        string request = file + "\n";
+        char const* data = request.data();
+        DWORD remaining = static_cast<DWORD>(request.size());
+        while (remaining > 0) {
+            DWORD written = 0;
+            if (!WriteFile(_host->child.input, data, remaining, &written, NULL)) {
+                LOG_DEBUG("powershell process %1% exited: %2%.", _host->child.id, system_error());
+                _host.reset();
+                return false;
+            }
+            data += written;
+            remaining -= written;
+        }
+
+        // Read the script's output until the marker; the host writes nothing more until it's given the next path
+        executable_output output(facts);
+        bool finished = false;
+        string status;
+        bool expired = false;
+        try {
+            auto const& marker = _host->marker;
+            output_processor processor([&](string& line) {
+                if (boost::starts_with(line, marker)) {
+                    finished = true;
+                    status = boost::trim_copy(line.substr(marker.size()));
+                    return false;
+                }
+                output.read_line(line);
+                return true;
+            }, { execution_options::defaults });
+            pipe_reader reader(_host->child.output, processor, true);
+
+            bool reading = reader.start();
+            while (reading) {
+                // Wait for output in short intervals so that a deadline or cancellation is noticed promptly
+                DWORD interval = INFINITE;
+                if (scoped_deadline::active()) {
+                    auto remaining = scoped_deadline::remaining();
+                    if (remaining == chrono::steady_clock::duration::zero()) {
+                        expired = true;
+                        break;
+                    }
+                    interval = static_cast<DWORD>(chrono::duration_cast<chrono::milliseconds>(min<chrono::steady_clock::duration>(remaining, chrono::milliseconds(100))).count()) + 1;
+                }
+                auto waitStatus = WaitForSingleObject(reader.event(), interval);
+                if (waitStatus == WAIT_TIMEOUT) {
+                    continue;
+                }
+                if (waitStatus != WAIT_OBJECT_0) {
+                    throw execution_exception("failed to wait for powershell output.");
+                }
+                reading = reader.complete() && reader.start();
+            }
+        } catch (execution_exception&) {
+            _host.reset();
+            throw;
+        }
+
+        if (expired) {
+            LOG_DEBUG("terminating powershell process %1%: the deadline passed or resolution was cancelled.", _host->child.id);
+            terminate_child(_host->child);
+            _host.reset();
+            throw deadline_exceeded_exception("powershell script did not finish before the deadline.");
+        }
+        if (!finished) {
+            // The script ended the host (e.g. with [Environment]::Exit); a new host is started for the next script
+            LOG_DEBUG("powershell process %1% exited while running \"%2%\".", _host->child.id, file);
+            _host.reset();
+            return false;
+        }
+        if (status != "0") {
+            throw execution_exception((boost::format("child process returned non-zero exit status (%1%).") % status).str());
+        }
+        output.finish();
+        return true;
+    }
+
     bool powershell_resolver::can_resolve(string const& file) const
     {
         try {
@@ -33,36 +214,19 @@ namespace facter { namespace facts { namespace external {
 
         try
         {
-            string pwrshell = "powershell";
-
-            // When facter is a 32-bit process running on 64-bit windows (such as in a 32-bit puppet installation that
-            // includes native facter), PATH-lookp finds the 32-bit powershell and leads to problems. For example, if
-            // using powershell to read values from the registry, it will read the 32-bit view of the registry. Also 32
-            // and 64-bit versions have different modules available (since PSModulePath is in system32). Use the
-            // system32 fact to find the correct powershell executable.
-            auto system32 = facts.get<string_value>(fact::windows_system32);
-            if (system32) {
-                auto pathNative = path(system32->value()) / "WindowsPowerShell" / "v1.0" / "powershell.exe";
-                auto pwrshellNative = which(pathNative.string());
-                if (!pwrshellNative.empty()) {
-                    pwrshell = move(pwrshellNative);
-                }
+            // If the script can't be run in the persistent host, powershell is started for it
+            if (_persistent && resolve_in_host(file, facts)) {
+                LOG_DEBUG("completed resolving facts from powershell script \"%1%\".", file);
+                return;
             }
 
-            execution::each_line(pwrshell, {"-NoProfile", "-NonInteractive", "-NoLogo", "-ExecutionPolicy", "Bypass",
+            executable_output output(facts);
+            execution::each_line(powershell(facts), {"-NoProfile", "-NonInteractive", "-NoLogo", "-ExecutionPolicy", "Bypass",
                                             "-File", file},
-            [&facts](string const& line) {
-                auto pos = line.find('=');
-                if (pos == string::npos) {
-                    LOG_DEBUG("ignoring line in output: %1%", line);
-                    return true;
-                }
-                // Add as a string fact
-                string fact = line.substr(0, pos);
-                boost::to_lower(fact);
-                facts.add(move(fact), make_value<string_value>(line.substr(pos+1)));
-                return true;
+            [&output](string& line) {
+                return output.read_line(line);
             }, { execution_options::defaults, execution_options::throw_on_failure });
+            output.finish();
         }
         catch (execution_exception& ex) {
             throw external_fact_exception(ex.what());
@@ -8,62 +8,321 @@
 #include <boost/nowide/fstream.hpp>
 #include <yaml-cpp/yaml.h>
 #include <yaml-cpp/eventhandler.h>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
 
 using namespace std;
 using namespace YAML;
 
 namespace facter { namespace facts { namespace external {
 
-    static void add_value(
-        string const& name,
-        Node const& node,
-        collection& facts,
-        array_value* array_parent = nullptr,
-        map_value* map_parent = nullptr)
+    // Decodes a boolean scalar the way yaml-cpp does: y/n, yes/no, true/false or on/off in lower, upper or title case
+    static bool decode_bool(string const& scalar, bool& result)
     {
-        unique_ptr<value> val;
-        // For scalars, code the value into a specific value type
-        if (node.IsScalar()) {
-            bool bool_val;
-            int64_t int_val;
-            double double_val;
-            if (convert<bool>::decode(node, bool_val)) {
-                val = make_value<boolean_value>(bool_val);
-            } else if (convert<int64_t>::decode(node, int_val)) {
-                val = make_value<integer_value>(int_val);
-            } else if (convert<double>::decode(node, double_val)) {
-                val = make_value<double_value>(double_val);
-            } else {
-                val = make_value<string_value>(node.as<string>());
-            }
-        } else if (node.IsSequence()) {
-            // For arrays, convert to a array value
+        static char const* const names[][2] = {
+            { "y", "n" },
+            { "yes", "no" },
+            { "true", "false" },
+            { "on", "off" },
+        };
+        if (scalar.empty() || scalar.size() > 5) {
+            return false;
+        }
+        auto lower = boost::to_lower_copy(scalar);
+        auto rest = scalar.substr(1);
+        if (scalar != lower && !(isupper(static_cast<unsigned char>(scalar[0])) && (rest == lower.substr(1) || rest == boost::to_upper_copy(rest)))) {
+            return false;
+        }
+        for (auto const& name : names) {
+            if (lower == name[0] || lower == name[1]) {
+                result = lower == name[0];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Checks that a number spans the scalar, allowing only trailing whitespace as a stream extraction would
+    static bool consumed(char const* end)
+    {
+        while (isspace(static_cast<unsigned char>(*end))) {
+            ++end;
+        }
+        return *end == '\0';
+    }
+
+    // Decodes an integer scalar the way yaml-cpp does, accepting a hexadecimal or octal prefix
+    static bool decode_integer(string const& scalar, int64_t& result)
+    {
+        if (scalar.empty() || isspace(static_cast<unsigned char>(scalar[0]))) {
+            return false;
+        }
+        char* end = nullptr;
+        errno = 0;
+        auto value = strtoll(scalar.c_str(), &end, 0);
+        if (errno == ERANGE || end == scalar.c_str() || !consumed(end)) {
+            return false;
+        }
+        result = static_cast<int64_t>(value);
+        return true;
+    }
+
+    // Decodes a floating point scalar the way yaml-cpp does, including the YAML spellings of infinity and NaN
+    static bool decode_double(string const& scalar, double& result)
+    {
+        if (scalar == ".inf" || scalar == ".Inf" || scalar == ".INF" || scalar == "+.inf" || scalar == "+.Inf" || scalar == "+.INF") {
+            result = numeric_limits<double>::infinity();
+            return true;
+        }
+        if (scalar == "-.inf" || scalar == "-.Inf" || scalar == "-.INF") {
+            result = -numeric_limits<double>::infinity();
+            return true;
+        }
+        if (scalar == ".nan" || scalar == ".NaN" || scalar == ".NAN") {
+            result = numeric_limits<double>::quiet_NaN();
+            return true;
+        }
+        // Unlike strtod, stream extraction accepts only decimal digits, signs, a point and an exponent
+        auto digits = scalar.find_first_not_of("0123456789+-.eE");
+        if (scalar.empty() || (digits != string::npos && !consumed(scalar.c_str() + digits))) {
+            return false;
+        }
+        char* end = nullptr;
+        errno = 0;
+        auto value = strtod(scalar.c_str(), &end);
+        if ((errno == ERANGE && std::isinf(value)) || end == scalar.c_str() || !consumed(end)) {
+            return false;
+        }
+        result = value;
+        return true;
+    }
+
+    static unique_ptr<value> make_scalar(string const& scalar)
+    {
+        bool bool_val;
+        int64_t int_val;
+        double double_val;
+        if (decode_bool(scalar, bool_val)) {
+            return make_value<boolean_value>(bool_val);
+        }
+        if (decode_integer(scalar, int_val)) {
+            return make_value<integer_value>(int_val);
+        }
+        if (decode_double(scalar, double_val)) {
+            return make_value<double_value>(double_val);
+        }
+        return make_value<string_value>(scalar);
+    }
+
+    // Builds fact values directly from the parser's events, rather than building a YAML node tree and converting it
+    // Each entry of the document's top-level map is added as a fact once its value is complete
+    struct fact_builder : EventHandler
+    {
+        explicit fact_builder(collection& facts) :
+            _facts(facts),
+            _started(false)
+        {
+        }
+
+        virtual void OnDocumentStart(Mark const&) override
+        {
+        }
+
+        virtual void OnDocumentEnd() override
+        {
+        }
+
+        virtual void OnNull(Mark const&, anchor_t anchor) override
+        {
+            if (expecting_key()) {
+                throw external_fact_exception("map keys must be strings.");
+            }
+            _started = true;
+            if (anchor != NullAnchor) {
+                _anchors[anchor] = { nullptr, {}, false };
+            }
+            add(nullptr);
+        }
+
+        virtual void OnAlias(Mark const&, anchor_t anchor) override
+        {
+            auto it = _anchors.find(anchor);
+            if (it == _anchors.end()) {
+                throw external_fact_exception("alias refers to an unknown anchor.");
+            }
+            if (expecting_key()) {
+                if (!it->second.is_scalar) {
+                    throw external_fact_exception("map keys must be strings.");
+                }
+                set_key(it->second.scalar);
+                return;
+            }
+            _started = true;
+            if (_stack.size() == 1 && _stack.back().facts) {
+                // Top-level facts are owned by the collection, so they get a copy of the anchored value
+                add(it->second.shared ? it->second.shared->clone() : nullptr);
+                return;
+            }
+            add_shared(it->second.shared);
+        }
+
+        virtual void OnScalar(Mark const&, string const&, anchor_t anchor, string const& scalar) override
+        {
+            if (expecting_key()) {
+                if (anchor != NullAnchor) {
+                    _anchors[anchor] = { make_scalar(scalar), scalar, true };
+                }
+                set_key(scalar);
+                return;
+            }
+            // A document that is a single scalar has no facts
+            if (!_started) {
+                _started = true;
+                return;
+            }
+            auto val = make_scalar(scalar);
+            if (anchor != NullAnchor) {
+                _anchors[anchor] = { val->clone(), scalar, true };
+            }
+            add(move(val));
+        }
+
+        virtual void OnSequenceStart(Mark const&, string const&, anchor_t anchor, EmitterStyle::value) override
+        {
+            if (expecting_key()) {
+                throw external_fact_exception("map keys must be strings.");
+            }
+            if (!_started) {
+                throw external_fact_exception("the document must be a map of fact names to values.");
+            }
             auto array = make_value<array_value>();
-            for (auto const& child : node) {
-                add_value({}, child, facts, array.get());
+            auto parent = array.get();
+            _stack.emplace_back(move(array), anchor);
+            _stack.back().array = parent;
+        }
+
+        virtual void OnSequenceEnd() override
+        {
+            complete();
+        }
+
+        virtual void OnMapStart(Mark const&, string const&, anchor_t anchor, EmitterStyle::value) override
+        {
+            if (expecting_key()) {
+                throw external_fact_exception("map keys must be strings.");
+            }
+            if (!_started) {
+                // The document's map holds the facts themselves
+                _started = true;
+                _stack.emplace_back(nullptr, NullAnchor);
+                _stack.back().facts = true;
+                return;
             }
-            val = move(array);
-        } else if (node.IsMap()) {
-            // For maps, convert to a map value
             auto map = make_value<map_value>();
-            for (auto const& child : node) {
-                add_value(child.first.as<string>(), child.second, facts, nullptr, map.get());
+            auto parent = map.get();
+            _stack.emplace_back(move(map), anchor);
+            _stack.back().map = parent;
+        }
+
+        virtual void OnMapEnd() override
+        {
+            complete();
+        }
+
+     private:
+        struct frame
+        {
+            frame(unique_ptr<value> container, anchor_t anchor) :
+                container(move(container)),
+                array(nullptr),
+                map(nullptr),
+                anchor(anchor),
+                facts(false),
+                has_key(false)
+            {
             }
-            val = move(map);
-        } else if (!node.IsNull()) {
-            // Ignore nodes we don't understand
-            return;
+
+            unique_ptr<value> container;
+            array_value* array;
+            map_value* map;
+            anchor_t anchor;
+            bool facts;
+            bool has_key;
+            string key;
+        };
+
+        struct anchored
+        {
+            shared_ptr<value const> shared;
+            string scalar;
+            bool is_scalar;
+        };
+
+        bool expecting_key() const
+        {
+            return !_stack.empty() && !_stack.back().array && !_stack.back().has_key;
         }
 
-        // Put the value in the array, map, or directly as a top-level fact
-        if (array_parent) {
-            array_parent->add(move(val));
-        } else if (map_parent) {
-            map_parent->add(string(name), move(val));
-        } else {
-            facts.add(boost::to_lower_copy(name), move(val));
+        void set_key(string const& key)
+        {
+            _stack.back().key = key;
+            _stack.back().has_key = true;
         }
-    }
+
+        void complete()
+        {
+            auto top = move(_stack.back());
+            _stack.pop_back();
+            if (top.facts) {
+                return;
+            }
+            if (top.anchor == NullAnchor) {
+                add(move(top.container));
+                return;
+            }
+            shared_ptr<value const> val(move(top.container));
+            _anchors[top.anchor] = { val, {}, false };
+            if (_stack.size() == 1 && _stack.back().facts) {
+                add(val->clone());
+                return;
+            }
+            add_shared(move(val));
+        }
+
+        void add(unique_ptr<value> val)
+        {
+            if (_stack.empty()) {
+                return;
+            }
+            auto& parent = _stack.back();
+            if (parent.facts) {
+                _facts.add(boost::to_lower_copy(parent.key), move(val));
+                parent.has_key = false;
+                return;
+            }
+            add_shared(move(val));
+        }
+
+        void add_shared(shared_ptr<value const> val)
+        {
+            auto& parent = _stack.back();
+            if (parent.array) {
+                parent.array->add(move(val));
+                return;
+            }
+            parent.map->add(parent.key, move(val));
+            parent.has_key = false;
+        }
+
+        collection& _facts;
+        bool _started;
+        vector<frame> _stack;
+        map<anchor_t, anchored> _anchors;
+    };
 
     bool yaml_resolver::can_resolve(string const& path) const
     {
@@ -79,16 +338,26 @@ namespace facter { namespace facts { namespace external {
             throw external_fact_exception("file could not be opened.");
         }
 
+        resolve_yaml(stream, facts);
+
+        LOG_DEBUG("completed resolving facts from YAML file \"%1%\".", path);
+    }
+
+    bool yaml_resolver::is_static() const
+    {
+        return true;
+    }
+
+    void resolve_yaml(istream& stream, collection& facts)
+    {
         try {
-            Node node = YAML::Load(stream);
-            for (auto const& kvp : node) {
-                add_value(kvp.first.as<string>(), kvp.second, facts);
-            }
+            // Only the first document is read
+            Parser parser(stream);
+            fact_builder builder(facts);
+            parser.HandleNextDocument(builder);
         } catch (Exception& ex) {
             throw external_fact_exception(ex.msg);
         }
-
-        LOG_DEBUG("completed resolving facts from YAML file \"%1%\".", path);
     }
 
 }}}  // namespace facter::facts::external
@@ -0,0 +1,33 @@
+#include <internal/facts/freebsd/disk_resolver.hpp>
+#include <internal/util/freebsd/geom.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <libgeom.h>
+
+using namespace std;
+using namespace facter::util::freebsd;
+
+namespace facter { namespace facts { namespace freebsd {
+
+    disk_resolver::data disk_resolver::collect_data(collection& facts)
+    {
+        data result;
+
+        geom_tree tree;
+        if (!tree.is_open()) {
+            LOG_DEBUG("disk facts are unavailable.");
+            return result;
+        }
+
+        // Each DISK provider is a disk (e.g. "ada0" or "da1"); its description is the model reported by the device
+        tree.each_provider("DISK", [&](gprovider const& provider) {
+            disk d;
+            d.name = provider.lg_name;
+            d.model = geom_tree::config(provider, "descr");
+            d.size = static_cast<uint64_t>(provider.lg_mediasize);
+            result.disks.emplace_back(move(d));
+            return true;
+        });
+        return result;
+    }
+
+}}}  // namespace facter::facts::freebsd
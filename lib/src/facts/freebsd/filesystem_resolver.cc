@@ -0,0 +1,109 @@
+#include <internal/facts/freebsd/filesystem_resolver.hpp>
+#include <internal/util/freebsd/geom.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <libgeom.h>
+#include <map>
+
+using namespace std;
+using namespace facter::util::freebsd;
+
+namespace facter { namespace facts { namespace freebsd {
+
+    filesystem_resolver::data filesystem_resolver::collect_data(collection& facts)
+    {
+        auto result = bsd::filesystem_resolver::collect_data(facts);
+        if (facts.is_queried(fact::partitions)) {
+            collect_partition_data(result);
+        }
+        return result;
+    }
+
+    void filesystem_resolver::collect_partition_data(data& result)
+    {
+        // Read the tree once for both the partitions and their labels
+        geom_tree tree;
+        if (!tree.is_open()) {
+            LOG_DEBUG("partition facts are unavailable.");
+            return;
+        }
+
+        // Each LABEL geom is named after the provider it labels and provides a device for each label found on it
+        // (e.g. "gpt/root", "gptid/<uuid>", "ufs/root", or "ufsid/<id>")
+        map<string, string> labeled;
+        map<string, partition> labels;
+        tree.each_geom("LABEL", [&](ggeom const& geom) {
+            string underlying = geom.lg_name;
+            gconsumer* consumer = LIST_FIRST(&geom.lg_consumer);
+            if (consumer && consumer->lg_provider && consumer->lg_provider->lg_name) {
+                underlying = consumer->lg_provider->lg_name;
+            }
+            gprovider* provider;
+            LIST_FOREACH(provider, &geom.lg_provider, lg_provider) {
+                string name = provider->lg_name;
+                labeled.emplace(name, underlying);
+
+                auto pos = name.find('/');
+                if (pos == string::npos) {
+                    continue;
+                }
+                string kind = name.substr(0, pos);
+                string value = name.substr(pos + 1);
+                auto& part = labels[underlying];
+                if (kind == "gpt") {
+                    part.partition_label = move(value);
+                } else if (kind == "gptid") {
+                    part.partition_uuid = move(value);
+                } else if (kind == "ufsid") {
+                    part.uuid = move(value);
+                } else if (kind != "diskid") {
+                    // File system labels (e.g. "ufs", "msdosfs", "ext2fs", "ntfs", "iso9660", or "label" for glabel)
+                    part.label = move(value);
+                }
+            }
+            return true;
+        });
+
+        // Map the devices of mounted file systems back to partitions, including those mounted by label
+        map<string, mountpoint const*> mounts;
+        for (auto const& point : result.mountpoints) {
+            if (point.device.compare(0, 5, "/dev/") != 0) {
+                continue;
+            }
+            string device = point.device.substr(5);
+            auto it = labeled.find(device);
+            mounts.emplace(it == labeled.end() ? device : it->second, &point);
+        }
+
+        // Each PART provider is a partition (e.g. "ada0p2", or "ada0s1a" of a BSD label within an MBR slice)
+        tree.each_provider("PART", [&](gprovider const& provider) {
+            partition part;
+            part.name = string("/dev/") + provider.lg_name;
+            part.size = static_cast<uint64_t>(provider.lg_mediasize);
+            part.partition_label = geom_tree::config(provider, "label");
+            part.partition_uuid = geom_tree::config(provider, "rawuuid");
+
+            auto label = labels.find(provider.lg_name);
+            if (label != labels.end()) {
+                part.label = move(label->second.label);
+                part.uuid = move(label->second.uuid);
+                if (part.partition_label.empty()) {
+                    part.partition_label = move(label->second.partition_label);
+                }
+                if (part.partition_uuid.empty()) {
+                    part.partition_uuid = move(label->second.partition_uuid);
+                }
+            }
+
+            auto mount = mounts.find(provider.lg_name);
+            if (mount != mounts.end()) {
+                part.mount = mount->second->name;
+                part.filesystem = mount->second->filesystem;
+            }
+            result.partitions.emplace_back(move(part));
+            return true;
+        });
+    }
+
+}}}  // namespace facter::facts::freebsd
@@ -0,0 +1,51 @@
+#include <internal/facts/json.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <rapidjson/document.h>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    unique_ptr<value> from_json(rapidjson::Value const& json, bool hidden)
+    {
+        if (json.IsBool()) {
+            return make_value<boolean_value>(json.GetBool(), hidden);
+        }
+        if (json.IsDouble()) {
+            return make_value<double_value>(json.GetDouble(), hidden);
+        }
+        if (json.IsInt64()) {
+            return make_value<integer_value>(json.GetInt64(), hidden);
+        }
+        if (json.IsUint64()) {
+            return make_value<integer_value>(static_cast<int64_t>(json.GetUint64()), hidden);
+        }
+        if (json.IsString()) {
+            return make_value<string_value>(json.GetString(), json.GetString() + json.GetStringLength(), hidden);
+        }
+        if (json.IsArray()) {
+            auto array = make_value<array_value>(hidden);
+            for (auto it = json.Begin(); it != json.End(); ++it) {
+                auto element = from_json(*it);
+                if (element) {
+                    array->add(move(element));
+                }
+            }
+            return move(array);
+        }
+        if (json.IsObject()) {
+            auto map = make_value<map_value>(hidden);
+            for (auto it = json.MemberBegin(); it != json.MemberEnd(); ++it) {
+                auto element = from_json(it->value);
+                if (element) {
+                    map->add(string(it->name.GetString(), it->name.GetStringLength()), move(element));
+                }
+            }
+            return move(map);
+        }
+        return nullptr;
+    }
+
+}}  // namespace facter::facts
@@ -0,0 +1,178 @@
+#include <facter/facts/lazy_value.hpp>
+#include <internal/facts/memory_usage.hpp>
+#include <internal/facts/value_hash.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <rapidjson/document.h>
+#include <yaml-cpp/yaml.h>
+
+using namespace std;
+using namespace rapidjson;
+using namespace YAML;
+
+namespace facter { namespace facts {
+
+    struct lazy_value::state
+    {
+        explicit state(thunk_type thunk) :
+            thunk(move(thunk)),
+            evaluated(false)
+        {
+        }
+
+        boost::mutex mutex;
+        thunk_type thunk;
+        unique_ptr<value> result;
+        bool evaluated;
+    };
+
+    lazy_value::lazy_value(thunk_type thunk, bool hidden) :
+        value(value_type::lazy, hidden),
+        _state(make_shared<state>(move(thunk)))
+    {
+    }
+
+    lazy_value::lazy_value(shared_ptr<state> state, bool hidden) :
+        value(value_type::lazy, hidden),
+        _state(move(state))
+    {
+    }
+
+    lazy_value::lazy_value(lazy_value&& other)
+    {
+        *this = std::move(other);
+    }
+
+    lazy_value& lazy_value::operator=(lazy_value&& other)
+    {
+        value::operator=(static_cast<value&&>(other));
+        if (this != &other) {
+            _state = std::move(other._state);
+        }
+        return *this;
+    }
+
+    unique_ptr<lazy_value> lazy_value::share(bool hidden) const
+    {
+        return unique_ptr<lazy_value>(new lazy_value(_state, hidden));
+    }
+
+    bool lazy_value::evaluated() const
+    {
+        if (!_state) {
+            return true;
+        }
+        boost::lock_guard<boost::mutex> lock(_state->mutex);
+        return _state->evaluated;
+    }
+
+    value const* lazy_value::get() const
+    {
+        if (!_state) {
+            return nullptr;
+        }
+
+        boost::lock_guard<boost::mutex> lock(_state->mutex);
+        if (!_state->evaluated) {
+            _state->evaluated = true;
+            try {
+                _state->result = _state->thunk();
+            } catch (exception& ex) {
+                LOG_WARNING("lazy fact value could not be resolved: %1%.", ex.what());
+            }
+            // Release anything captured by the thunk
+            _state->thunk = nullptr;
+        }
+        return resolve(_state->result.get());
+    }
+
+    value const* lazy_value::resolve(value const* val)
+    {
+        auto lazy = value_cast<lazy_value>(val);
+        return lazy ? lazy->get() : val;
+    }
+
+    void lazy_value::to_json(Allocator& allocator, rapidjson::Value& value) const
+    {
+        auto val = get();
+        if (!val) {
+            value.SetNull();
+            return;
+        }
+        val->to_json(allocator, value);
+    }
+
+    void lazy_value::to_msgpack(msgpack_writer& writer) const
+    {
+        auto val = get();
+        if (!val) {
+            writer.nil();
+            return;
+        }
+        val->to_msgpack(writer);
+    }
+
+    ostream& lazy_value::write(ostream& os, bool quoted, unsigned int level) const
+    {
+        auto val = get();
+        if (val) {
+            val->write(os, quoted, level);
+        }
+        return os;
+    }
+
+    Emitter& lazy_value::write(Emitter& emitter) const
+    {
+        auto val = get();
+        if (!val) {
+            emitter << Null;
+            return emitter;
+        }
+        return val->write(emitter);
+    }
+
+    bool lazy_value::deferred() const
+    {
+        return true;
+    }
+
+    unique_ptr<value> lazy_value::clone() const
+    {
+        auto val = get();
+        return val ? val->clone() : nullptr;
+    }
+
+    bool lazy_value::equals(struct value const& other) const
+    {
+        auto first = get();
+        auto second = resolve(&other);
+        if (!first || !second) {
+            return first == second;
+        }
+        return first->equals(*second);
+    }
+
+    uint64_t lazy_value::hash() const
+    {
+        auto val = get();
+        return val ? val->hash() : hash_basis;
+    }
+
+    size_t lazy_value::memory_usage() const
+    {
+        if (!_state) {
+            return sizeof(lazy_value);
+        }
+
+        // The state is shared by every value created with share; each counts it
+        size_t usage = sizeof(lazy_value) + shared_control_block_size + sizeof(state);
+        boost::lock_guard<boost::mutex> lock(_state->mutex);
+        if (_state->result) {
+            usage += _state->result->memory_usage();
+        }
+        return usage;
+    }
+
+}}  // namespace facter::facts
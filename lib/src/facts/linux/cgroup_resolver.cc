@@ -0,0 +1,144 @@
+#include <internal/facts/linux/cgroup_resolver.hpp>
+#include <internal/util/posix/attribute_reader.hpp>
+#include <internal/util/proc_file.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <algorithm>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::util::posix;
+
+namespace facter { namespace facts { namespace linux {
+
+    // Parses a cgroup limit, which is either a number or "max" for no limit
+    static int64_t parse_limit(boost::string_ref text)
+    {
+        uint64_t limit = 0;
+        if (text == "max" || !proc_file::to_uint64(text, limit)) {
+            return -1;
+        }
+        return static_cast<int64_t>(limit);
+    }
+
+    // A group is limited by the most restrictive limit of it and its ancestors
+    static void restrict_limit(int64_t& limit, int64_t value)
+    {
+        if (value >= 0 && (limit < 0 || value < limit)) {
+            limit = value;
+        }
+    }
+
+    cgroup_resolver::data cgroup_resolver::collect_data(collection& facts)
+    {
+        data result;
+
+        // Reads the limits of a group, keeping the most restrictive of them and those already read
+        auto read_limits = [&](attribute_reader const& group) {
+            string value;
+
+            // cpu.max is "<quota> <period>", e.g. "200000 100000" for two CPUs
+            if (group.read("cpu.max", value)) {
+                boost::string_ref fields = value;
+                auto quota = parse_limit(proc_file::next_field(fields));
+                auto period = parse_limit(proc_file::next_field(fields));
+                if (quota >= 0 && period > 0 &&
+                    (result.cpu_quota < 0 || static_cast<double>(quota) / period < static_cast<double>(result.cpu_quota) / result.cpu_period)) {
+                    result.cpu_quota = quota;
+                    result.cpu_period = period;
+                }
+            }
+            if (group.read("memory.max", value)) {
+                restrict_limit(result.memory_max, parse_limit(value));
+            }
+
+            // io.max has a line per limited device, e.g. "8:0 rbps=2097152 wbps=max riops=max wiops=120"
+            if (!group.read("io.max", value)) {
+                return;
+            }
+            boost::string_ref remaining = value;
+            for (auto device = proc_file::next_field(remaining); !device.empty(); device = proc_file::next_field(remaining)) {
+                auto it = find_if(result.io.begin(), result.io.end(), [&](io_limit const& limit) { return limit.device == device; });
+                if (it == result.io.end()) {
+                    result.io.emplace_back();
+                    result.io.back().device = device.to_string();
+                    it = result.io.end() - 1;
+                }
+                auto& limit = *it;
+                while (!remaining.empty() && remaining.front() != '\n') {
+                    auto field = proc_file::next_field(remaining);
+                    auto pos = field.find('=');
+                    if (pos == boost::string_ref::npos) {
+                        continue;
+                    }
+                    auto key = field.substr(0, pos);
+                    auto setting = parse_limit(field.substr(pos + 1));
+                    if (key == "rbps") {
+                        restrict_limit(limit.read_bps, setting);
+                    } else if (key == "wbps") {
+                        restrict_limit(limit.write_bps, setting);
+                    } else if (key == "riops") {
+                        restrict_limit(limit.read_iops, setting);
+                    } else if (key == "wiops") {
+                        restrict_limit(limit.write_iops, setting);
+                    }
+                }
+            }
+        };
+
+        // In the unified (v2) hierarchy the process's group is listed with a hierarchy id of 0 and no controllers
+        bool unified = false;
+        proc_file cgroups("/proc/self/cgroup");
+        cgroups.each_line([&](boost::string_ref line) {
+            if (line.starts_with("0::")) {
+                result.path = line.substr(3).to_string();
+                unified = true;
+                return false;
+            }
+            if (!line.empty()) {
+                result.version = 1;
+            }
+            return true;
+        });
+
+        // Limits are only read from a unified hierarchy mounted at /sys/fs/cgroup (i.e. not a v1 or hybrid system)
+        struct stat status;
+        if (unified && stat(scoped_root::path("/sys/fs/cgroup/cgroup.controllers").c_str(), &status) == 0) {
+            result.version = 2;
+
+            attribute_reader root("/sys/fs/cgroup");
+            string relative = result.path;
+            while (!relative.empty() && relative.front() == '/') {
+                relative.erase(0, 1);
+            }
+
+            // Without a cgroup namespace, a container may see a path that isn't mounted; its own group is then the root
+            if (!relative.empty() && !attribute_reader(root, relative).is_open()) {
+                relative.clear();
+            }
+
+            // Walk from the group up to the root, restricting the limits by each ancestor's
+            while (true) {
+                if (relative.empty()) {
+                    read_limits(root);
+                    break;
+                }
+                read_limits(attribute_reader(root, relative));
+                auto pos = relative.rfind('/');
+                relative.erase(pos == string::npos ? 0 : pos);
+            }
+        } else {
+            // The path in a hybrid hierarchy is of the empty unified group rather than the group whose controllers limit the process
+            result.path.clear();
+        }
+
+        // A namespace's identifier is the inode number of its link in /proc
+        for (auto name : { "cgroup", "ipc", "mnt", "net", "pid", "time", "user", "uts" }) {
+            if (stat(scoped_root::path(string("/proc/self/ns/") + name).c_str(), &status) == 0) {
+                result.namespaces.emplace(name, static_cast<uint64_t>(status.st_ino));
+            }
+        }
+        return result;
+    }
+
+}}}  // namespace facter::facts::linux
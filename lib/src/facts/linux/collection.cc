@@ -7,11 +7,13 @@
 #include <internal/facts/linux/dmi_resolver.hpp>
 #include <internal/facts/linux/processor_resolver.hpp>
 #include <internal/facts/linux/uptime_resolver.hpp>
+#include <internal/facts/linux/load_resolver.hpp>
 #include <internal/facts/linux/virtualization_resolver.hpp>
 #include <internal/facts/posix/ssh_resolver.hpp>
 #include <internal/facts/posix/timezone_resolver.hpp>
 #include <internal/facts/linux/filesystem_resolver.hpp>
 #include <internal/facts/linux/memory_resolver.hpp>
+#include <internal/facts/linux/cgroup_resolver.hpp>
 
 using namespace std;
 
@@ -26,12 +28,14 @@ namespace facter { namespace facts {
         add(make_shared<linux::dmi_resolver>());
         add(make_shared<linux::processor_resolver>());
         add(make_shared<linux::uptime_resolver>());
+        add(make_shared<linux::load_resolver>());
         add(make_shared<posix::ssh_resolver>());
         add(make_shared<linux::virtualization_resolver>());
         add(make_shared<posix::identity_resolver>());
         add(make_shared<posix::timezone_resolver>());
         add(make_shared<linux::filesystem_resolver>());
         add(make_shared<linux::memory_resolver>());
+        add(make_shared<linux::cgroup_resolver>());
     }
 
 }}  // namespace facter::facts
@@ -1,51 +1,41 @@
 #include <internal/facts/linux/dmi_resolver.hpp>
+#include <internal/util/posix/attribute_reader.hpp>
 #include <leatherman/logging/logging.hpp>
-#include <facter/util/file.hpp>
-#include <boost/filesystem.hpp>
-#include <boost/algorithm/string.hpp>
+#include <cstring>
 
 using namespace std;
-using namespace facter::util;
-using namespace boost::filesystem;
-namespace bs = boost::system;
+using namespace facter::util::posix;
 
 namespace facter { namespace facts { namespace linux {
 
     dmi_resolver::data dmi_resolver::collect_data(collection& facts)
     {
         data result;
-        result.bios_vendor          = read("/sys/class/dmi/id/bios_vendor");
-        result.bios_version         = read("/sys/class/dmi/id/bios_version");
-        result.bios_release_date    = read("/sys/class/dmi/id/bios_date");
-        result.board_asset_tag      = read("/sys/class/dmi/id/board_asset_tag");
-        result.board_manufacturer   = read("/sys/class/dmi/id/board_vendor");
-        result.board_product_name   = read("/sys/class/dmi/id/board_name");
-        result.board_serial_number  = read("/sys/class/dmi/id/board_serial");
-        result.chassis_asset_tag    = read("/sys/class/dmi/id/chassis_asset_tag");
-        result.manufacturer         = read("/sys/class/dmi/id/sys_vendor");
-        result.product_name         = read("/sys/class/dmi/id/product_name");
-        result.serial_number        = read("/sys/class/dmi/id/product_serial");
-        result.uuid                 = read("/sys/class/dmi/id/product_uuid");
-        result.chassis_type         = to_chassis_description(read("/sys/class/dmi/id/chassis_type"));
-        return result;
-    }
-
-    string dmi_resolver::read(std::string const& path)
-    {
-        bs::error_code ec;
-        if (!is_regular_file(path, ec)) {
-            LOG_DEBUG("%1%: %2%.", path, ec.message());
-            return {};
-        }
 
-        string value;
-        if (!file::read(path, value)) {
-            LOG_DEBUG("%1%: file could not be read.", path);
-            return {};
+        attribute_reader dmi("/sys/class/dmi/id");
+        if (!dmi.is_open()) {
+            LOG_DEBUG("/sys/class/dmi/id: %1% (%2%): DMI facts are unavailable.", strerror(errno), errno);
+            return result;
         }
 
-        boost::trim(value);
-        return value;
+        string chassis_type;
+        dmi.read({
+            { "bios_vendor",        &result.bios_vendor },
+            { "bios_version",       &result.bios_version },
+            { "bios_date",          &result.bios_release_date },
+            { "board_asset_tag",    &result.board_asset_tag },
+            { "board_vendor",       &result.board_manufacturer },
+            { "board_name",         &result.board_product_name },
+            { "board_serial",       &result.board_serial_number },
+            { "chassis_asset_tag",  &result.chassis_asset_tag },
+            { "sys_vendor",         &result.manufacturer },
+            { "product_name",       &result.product_name },
+            { "product_serial",     &result.serial_number },
+            { "product_uuid",       &result.uuid },
+            { "chassis_type",       &chassis_type },
+        });
+        result.chassis_type = to_chassis_description(chassis_type);
+        return result;
     }
 
 }}}  // namespace facter::facts::linux
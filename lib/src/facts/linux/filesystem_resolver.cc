@@ -1,12 +1,19 @@
 #include <internal/facts/linux/filesystem_resolver.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/proc_file.hpp>
 #include <internal/util/scoped_file.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/util/directory.hpp>
 #include <facter/util/file.hpp>
+#include <facter/util/string.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/lexical_cast.hpp>
 #include <mntent.h>
 #include <sys/vfs.h>
+#include <algorithm>
 #include <set>
 #include <map>
 
@@ -19,24 +26,35 @@ using namespace facter::facts;
 using namespace facter::util;
 using namespace boost::filesystem;
 
-using boost::lexical_cast;
-using boost::bad_lexical_cast;
-
 namespace facter { namespace facts { namespace linux {
 
+    bool filesystem_resolver::is_expensive() const
+    {
+        return true;
+    }
+
     filesystem_resolver::data filesystem_resolver::collect_data(collection& facts)
     {
         data result;
-        collect_mountpoint_data(result);
-        collect_filesystem_data(result);
-        collect_partition_data(result);
+
+        // Only collect what was queried; partitions need the mountpoints to populate their mount point
+        bool partitions = facts.is_queried(fact::partitions);
+        if (partitions || facts.is_queried(fact::mountpoints)) {
+            collect_mountpoint_data(result);
+        }
+        if (facts.is_queried(fact::filesystems)) {
+            collect_filesystem_data(result);
+        }
+        if (partitions) {
+            collect_partition_data(result);
+        }
         return result;
     }
 
     void filesystem_resolver::collect_mountpoint_data(data& result)
     {
         // Populate the mountpoint data
-        scoped_file file(setmntent("/etc/mtab", "r"));
+        scoped_file file(setmntent(scoped_root::path("/etc/mtab").c_str(), "r"));
         if (!static_cast<FILE *>(file)) {
             LOG_ERROR("setmntent failed: %1% (%2%): mountpoints are unavailable.", strerror(errno), errno);
             return;
@@ -49,16 +67,29 @@ namespace facter { namespace facts { namespace linux {
                 continue;
             }
 
+            if (is_filesystem_excluded(ptr->mnt_type)) {
+                continue;
+            }
+
             mountpoint point;
             point.name = ptr->mnt_dir;
             point.device = ptr->mnt_fsname;
             point.filesystem = ptr->mnt_type;
             boost::split(point.options, ptr->mnt_opts, boost::is_any_of(","), boost::token_compress_on);
 
-            struct statfs stats;
-            if (statfs(ptr->mnt_dir, &stats) != -1) {
-                point.size = stats.f_frsize * stats.f_blocks;
-                point.available = stats.f_frsize * stats.f_bfree;
+            // A hung network filesystem can block statfs; stop sizing mountpoints once out of time
+            if (scoped_deadline::expired()) {
+                LOG_DEBUG("size of mountpoint %1% is unavailable: the deadline for resolving facts has passed.", point.name);
+            } else {
+                populate_size(point, [](string const& path, uint64_t& size, uint64_t& available) {
+                    struct statfs stats;
+                    if (statfs(path.c_str(), &stats) == -1) {
+                        return false;
+                    }
+                    size = stats.f_frsize * stats.f_blocks;
+                    available = stats.f_frsize * stats.f_bfree;
+                    return true;
+                });
             }
 
             result.mountpoints.emplace_back(move(point));
@@ -68,47 +99,129 @@ namespace facter { namespace facts { namespace linux {
     void filesystem_resolver::collect_filesystem_data(data& result)
     {
         // Populate the partition data
-        file::each_line("/proc/filesystems", [&](string &line) {
-            boost::trim(line);
+        proc_file filesystems("/proc/filesystems");
+        filesystems.each_line([&](boost::string_ref line) {
+            line = proc_file::trim(line);
 
             // Ignore lines without devices or fuseblk
-            if (boost::starts_with(line, "nodev") || line == "fuseblk") {
+            if (line.starts_with("nodev") || line == "fuseblk") {
                 return true;
             }
 
-            result.filesystems.emplace(move(line));
+            result.filesystems.emplace(line.to_string());
             return true;
         });
     }
 
-    void filesystem_resolver::collect_partition_data(data& result)
+    static string decode_udev_value(string const& value)
     {
-        // Only return partition data if we're using libblkid
-#ifdef USE_BLKID
-        // The size of a block, in bytes, read in from /sys/class/block
-        const int block_size = 512;
+        // udev escapes unsafe characters in values and link names as \xNN (e.g. "My\x20Disk")
+        string decoded;
+        decoded.reserve(value.size());
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (value[i] == '\\' && i + 3 < value.size() && value[i + 1] == 'x' && isxdigit(value[i + 2]) && isxdigit(value[i + 3])) {
+                decoded += static_cast<char>(stoi(value.substr(i + 2, 2), nullptr, 16));
+                i += 3;
+                continue;
+            }
+            decoded += value[i];
+        }
+        return decoded;
+    }
 
-        // Get a default cache
-        blkid_cache cache;
-        if (blkid_get_cache(&cache, nullptr) < 0) {
-            LOG_ERROR("blkid_get_cache failed: %1% (%2%): partition data is unavailable.", strerror(errno), errno);
-            return;
+    static bool read_udev_tags(string const& device_number, map<string, string>& tags)
+    {
+        // udev records what it probed for every block device in its database; reading the record avoids opening the device
+        proc_file record("/run/udev/data/b" + device_number);
+        if (!record.is_open()) {
+            return false;
+        }
+        string label;
+        record.each_line([&](boost::string_ref line) {
+            if (!line.starts_with("E:")) {
+                return true;
+            }
+            line.remove_prefix(2);
+            auto pos = line.find('=');
+            if (pos == boost::string_ref::npos) {
+                return true;
+            }
+            auto key = line.substr(0, pos);
+            auto value = line.substr(pos + 1).to_string();
+            if (key == "ID_FS_TYPE") {
+                tags["type"] = move(value);
+            } else if (key == "ID_FS_UUID") {
+                tags["uuid"] = move(value);
+            } else if (key == "ID_FS_LABEL_ENC") {
+                tags["label"] = decode_udev_value(value);
+            } else if (key == "ID_FS_LABEL") {
+                // Unsafe characters are replaced in this form of the label, so prefer the encoded form
+                label = move(value);
+            } else if (key == "ID_PART_ENTRY_UUID") {
+                tags["partuuid"] = move(value);
+            } else if (key == "ID_PART_ENTRY_NAME") {
+                tags["partlabel"] = decode_udev_value(value);
+            } else if (key == "ID_PART_TABLE_TYPE") {
+                tags["pttype"] = move(value);
+            }
+            return true;
+        });
+        if (!label.empty() && tags.count("label") == 0) {
+            tags["label"] = move(label);
         }
+        return true;
+    }
 
-        // Probe all block devices
-        if (blkid_probe_all(cache) < 0) {
-            blkid_put_cache(cache);
-            LOG_ERROR("blkid_probe_all failed: %1% (%2%): partition data is unavailable.", strerror(errno), errno);
-            return;
+    static map<string, map<string, string>> read_link_tags()
+    {
+        // Map each device name to the tags given by the /dev/disk/by-* links that resolve to it
+        map<string, map<string, string>> links;
+        for (auto const& tag : { "uuid", "label", "partuuid", "partlabel" }) {
+            boost::system::error_code ec;
+            directory_iterator it(scoped_root::path(string("/dev/disk/by-") + tag), ec);
+            if (ec) {
+                continue;
+            }
+            for (directory_iterator end; it != end; ++it) {
+                auto target = read_symlink(it->path(), ec);
+                if (ec) {
+                    continue;
+                }
+                links[target.filename().string()][tag] = decode_udev_value(it->path().filename().string());
+            }
         }
+        return links;
+    }
 
-        // Begin iteration
-        auto iter = blkid_dev_iterate_begin(cache);
-        if (!iter) {
-            blkid_put_cache(cache);
-            LOG_ERROR("blkid_dev_iterate_begin failed: %1% (%2%): partition data is unavailable.", strerror(errno), errno);
-            return;
+#ifdef USE_BLKID
+    static bool read_blkid_tags(blkid_cache cache, string const& device_name, map<string, string>& tags)
+    {
+        // Probe only this device; unlike blkid_probe_all, this leaves the other devices alone
+        auto device = blkid_get_dev(cache, device_name.c_str(), BLKID_DEV_NORMAL);
+        if (!device) {
+            return false;
+        }
+
+        auto tag_iter = blkid_tag_iterate_begin(device);
+        if (!tag_iter) {
+            return true;
+        }
+        const char* tag_name;
+        const char* tag_value;
+        while (blkid_tag_next(tag_iter, &tag_name, &tag_value) == 0) {
+            string attribute = tag_name;
+            boost::to_lower(attribute);
+            tags[attribute] = tag_value;
         }
+        blkid_tag_iterate_end(tag_iter);
+        return true;
+    }
+#endif  // USE_BLKID
+
+    void filesystem_resolver::collect_partition_data(data& result)
+    {
+        // The size of a block, in bytes, read in from /sys/class/block
+        const int block_size = 512;
 
         // Populate a map of device -> mountpoint
         map<string, string> device_mountpoints;
@@ -116,49 +229,70 @@ namespace facter { namespace facts { namespace linux {
             device_mountpoints.insert(make_pair(point.device, point.name));
         }
 
+#ifdef USE_BLKID
+        // The cache is only used for devices udev has no record of, so it is not created until needed
+        blkid_cache cache = nullptr;
+        bool cache_failed = false;
+#endif  // USE_BLKID
+        bool have_links = false;
+        map<string, map<string, string>> links;
+
         // Loop each block device
-        blkid_dev device;
-        while (blkid_dev_next(iter, &device) == 0) {
+        directory::each_subdirectory("/sys/class/block", [&](string const& directory) {
+            scoped_deadline::check();
+
+            string name = path(directory).filename().string();
+            string sysfs = "/sys/class/block/" + name;
             partition part;
-            part.name = blkid_dev_devname(device);
-
-            // Populate the tags
-            blkid_tag_iterate tag_iter;
-            tag_iter = blkid_tag_iterate_begin(device);
-            if (tag_iter) {
-                const char* tag_name;
-                const char* tag_value;
-                while (blkid_tag_next(tag_iter, &tag_name, &tag_value) == 0) {
-                    string* ptr = nullptr;
-                    string attribute = tag_name;
-                    boost::to_lower(attribute);
-                    if (attribute == "type") {
-                        ptr = &part.filesystem;
-                    } else if (attribute == "label") {
-                        ptr = &part.label;
-                    } else if (attribute == "partlabel") {
-                        ptr = &part.partition_label;
-                    } else if (attribute == "uuid") {
-                        ptr = &part.uuid;
-                    } else if (attribute == "partuuid") {
-                        ptr = &part.partition_uuid;
+
+            // Device mapper devices are known by their /dev/mapper name
+            string dm_name = file::read(sysfs + "/dm/name");
+            boost::trim(dm_name);
+            part.name = dm_name.empty() ? "/dev/" + name : "/dev/mapper/" + dm_name;
+
+            string device_number = file::read(sysfs + "/dev");
+            boost::trim(device_number);
+
+            // Prefer the udev database, then probe the devices it has no record of
+            map<string, string> tags;
+            if (device_number.empty() || !read_udev_tags(device_number, tags)) {
+#ifdef USE_BLKID
+                if (!cache && !cache_failed && blkid_get_cache(&cache, nullptr) < 0) {
+                    cache = nullptr;
+                    cache_failed = true;
+                    LOG_ERROR("blkid_get_cache failed: %1% (%2%): partition data is limited to what udev provides.", strerror(errno), errno);
+                }
+                if (cache) {
+                    read_blkid_tags(cache, part.name, tags);
+                }
+#endif  // USE_BLKID
+                if (tags.empty()) {
+                    // Fall back to the links udev created (e.g. in a container without the udev database)
+                    if (!have_links) {
+                        links = read_link_tags();
+                        have_links = true;
                     }
-                    if (!ptr) {
-                        continue;
+                    auto it = links.find(name);
+                    if (it != links.end()) {
+                        tags = it->second;
                     }
-                    (*ptr) = tag_value;
                 }
-                blkid_tag_iterate_end(tag_iter);
             }
 
+            // Only report devices that hold a file system or a partition table, or that are partitions
+            if (tags.empty()) {
+                return true;
+            }
+            part.filesystem = tags["type"];
+            part.uuid = tags["uuid"];
+            part.label = tags["label"];
+            part.partition_uuid = tags["partuuid"];
+            part.partition_label = tags["partlabel"];
+
             // Populate the size (the size is given in 512 byte blocks)
-            string blocks = file::read((path("/sys/class/block") / path(part.name).filename() / "/size").string());
-            boost::trim(blocks);
-            if (!blocks.empty()) {
-                try {
-                    part.size = lexical_cast<uint64_t>(blocks) * block_size;
-                } catch (bad_lexical_cast& ex) {
-                }
+            uint64_t blocks;
+            if (parse_integer(file::read(sysfs + "/size"), blocks)) {
+                part.size = blocks * block_size;
             }
 
             // Populate the mountpoint if there is one
@@ -168,12 +302,23 @@ namespace facter { namespace facts { namespace linux {
             }
 
             result.partitions.emplace_back(move(part));
+            return true;
+        });
+
+#ifdef USE_BLKID
+        if (cache) {
+            blkid_put_cache(cache);
         }
-        blkid_dev_iterate_end(iter);
-        blkid_put_cache(cache);
 #else
-        LOG_INFO("partition information is unavailable: facter was built without blkid support.");
+        if (result.partitions.empty()) {
+            LOG_INFO("partition information is unavailable: udev has no record of the block devices and facter was built without blkid support.");
+        }
 #endif  // USE_BLKID
+
+        // Report the partitions in device name order
+        sort(result.partitions.begin(), result.partitions.end(), [](partition const& left, partition const& right) {
+            return left.name < right.name;
+        });
     }
 
 }}}  // namespace facter::facts::linux
@@ -0,0 +1,47 @@
+#include <internal/facts/linux/load_resolver.hpp>
+#include <internal/util/proc_file.hpp>
+#include <facter/util/string.hpp>
+
+using namespace std;
+using namespace facter::util;
+
+namespace facter { namespace facts { namespace linux {
+
+    load_resolver::data load_resolver::collect_data(collection& facts)
+    {
+        auto result = posix::load_resolver::collect_data(facts);
+
+        // Pressure stall information (kernel 4.20+) has a line per kind of stall, e.g.
+        // "some avg10=0.00 avg60=0.12 avg300=0.05 total=1234567"; "full" is absent for cpu on older kernels
+        for (auto resource : { "cpu", "io", "memory" }) {
+            proc_file file(string("/proc/pressure/") + resource);
+            file.each_line([&](boost::string_ref line) {
+                auto kind = proc_file::next_field(line);
+                if (kind.empty()) {
+                    return true;
+                }
+                stall value;
+                for (auto field = proc_file::next_field(line); !field.empty(); field = proc_file::next_field(line)) {
+                    auto pos = field.find('=');
+                    if (pos == boost::string_ref::npos) {
+                        continue;
+                    }
+                    auto name = field.substr(0, pos);
+                    auto setting = field.substr(pos + 1);
+                    if (name == "total") {
+                        proc_file::to_uint64(setting, value.total);
+                        continue;
+                    }
+                    double* average = name == "avg10" ? &value.avg10 : name == "avg60" ? &value.avg60 : name == "avg300" ? &value.avg300 : nullptr;
+                    if (average) {
+                        parse_double(setting.data(), setting.data() + setting.size(), *average);
+                    }
+                }
+                result.pressure[resource][kind.to_string()] = value;
+                return true;
+            });
+        }
+        return result;
+    }
+
+}}}  // namespace facter::facts::linux
@@ -1,48 +1,127 @@
 #include <internal/facts/linux/memory_resolver.hpp>
-#include <facter/util/file.hpp>
-#include <boost/algorithm/string.hpp>
-#include <boost/lexical_cast.hpp>
+#include <internal/util/posix/attribute_reader.hpp>
+#include <internal/util/proc_file.hpp>
+#include <facter/util/directory.hpp>
 
 using namespace std;
 using namespace facter::util;
-
-using boost::lexical_cast;
-using boost::bad_lexical_cast;
+using namespace facter::util::posix;
 
 namespace facter { namespace facts { namespace linux {
 
+    static uint64_t to_count(string const& text)
+    {
+        uint64_t count = 0;
+        proc_file::to_uint64(text, count);
+        return count;
+    }
+
     memory_resolver::data memory_resolver::collect_data(collection& facts)
     {
         data result;
-        file::each_line("/proc/meminfo", [&](string& line) {
+        uint64_t available = 0;
+        bool has_available = false;
+        hugepage_pool default_pool;
+        proc_file meminfo("/proc/meminfo");
+        meminfo.each_value([&](boost::string_ref key, boost::string_ref value) {
+            // The huge page counts are numbers of pages rather than sizes
+            uint64_t* count = nullptr;
+            if (key == "HugePages_Total") {
+                count = &default_pool.total;
+            } else if (key == "HugePages_Free") {
+                count = &default_pool.free;
+            } else if (key == "HugePages_Rsvd") {
+                count = &default_pool.reserved;
+            } else if (key == "HugePages_Surp") {
+                count = &default_pool.surplus;
+            }
+            if (count) {
+                proc_file::to_uint64(value, *count);
+                return true;
+            }
+
             uint64_t* variable = nullptr;
-            if (boost::starts_with(line, "MemTotal:")) {
+            if (key == "MemTotal") {
                 variable = &result.mem_total;
-            } else if (boost::starts_with(line, "MemFree:") ||
-                       boost::starts_with(line, "Buffers:") ||
-                       boost::starts_with(line, "Cached:")) {
+            } else if (key == "MemFree" || key == "Buffers" || key == "Cached") {
                 variable = &result.mem_free;
-            } else if (boost::starts_with(line, "SwapTotal:")) {
+            } else if (key == "MemAvailable") {
+                variable = &available;
+                has_available = true;
+            } else if (key == "SwapTotal") {
                 variable = &result.swap_total;
-            } else if (boost::starts_with(line, "SwapFree:")) {
+            } else if (key == "SwapFree") {
                 variable = &result.swap_free;
+            } else if (key == "Hugepagesize") {
+                variable = &default_pool.size;
             }
             if (!variable) {
                 return true;
             }
 
-            vector<boost::iterator_range<string::iterator>> parts;
-            boost::split(parts, line, boost::is_space(), boost::token_compress_on);
-            if (parts.size() < 2) {
-                return true;
+            // The values are in kB
+            uint64_t size = 0;
+            if (proc_file::to_uint64(value, size)) {
+                *variable += size * 1024;
             }
+            return true;
+        });
 
-            try {
-                *variable += lexical_cast<uint64_t>(parts[1]) * 1024;
-            } catch (bad_lexical_cast&) {
+        // The kernel's estimate (3.14+) accounts for reclaimable slab and the page cache that can't be dropped, unlike the sum of free, buffers and cache
+        if (has_available) {
+            result.mem_free = available;
+        }
+
+        // /proc/meminfo only describes the pool of the default page size; sysfs has a directory per supported size (e.g. "hugepages-2048kB")
+        string total, free, reserved, surplus;
+        static directory::name_filter const pools = directory::name_filter::regex("^hugepages-\\d+kB$");
+        directory::each_subdirectory("/sys/kernel/mm/hugepages", [&](string const& pool_directory) {
+            attribute_reader pool_attributes(pool_directory);
+            if (pool_attributes.read({
+                    { "nr_hugepages", &total },
+                    { "free_hugepages", &free },
+                    { "resv_hugepages", &reserved },
+                    { "surplus_hugepages", &surplus } }) == 0) {
+                return true;
             }
+            hugepage_pool pool;
+            pool.size = to_count(pool_directory.substr(pool_directory.find_last_of('/') + 11)) * 1024;
+            pool.total = to_count(total);
+            pool.free = to_count(free);
+            pool.reserved = to_count(reserved);
+            pool.surplus = to_count(surplus);
+            result.hugepages.emplace_back(move(pool));
             return true;
-        });
+        }, pools);
+        if (result.hugepages.empty() && default_pool.size > 0) {
+            result.hugepages.emplace_back(move(default_pool));
+        }
+
+        // Each node's meminfo prefixes the keys with the node (e.g. "Node 0 MemTotal") and has the counts of default size huge pages
+        static directory::name_filter const nodes = directory::name_filter::regex("^node\\d+$");
+        directory::each_subdirectory("/sys/devices/system/node", [&](string const& node_directory) {
+            numa_node node;
+            node.name = node_directory.substr(node_directory.find_last_of('/') + 1);
+            proc_file node_meminfo(node_directory + "/meminfo");
+            node_meminfo.each_value([&](boost::string_ref key, boost::string_ref value) {
+                uint64_t amount = 0;
+                if (!proc_file::to_uint64(value, amount)) {
+                    return true;
+                }
+                if (key.ends_with(" MemTotal")) {
+                    node.total = amount * 1024;
+                } else if (key.ends_with(" MemFree")) {
+                    node.free = amount * 1024;
+                } else if (key.ends_with(" HugePages_Total")) {
+                    node.hugepages_total = amount;
+                } else if (key.ends_with(" HugePages_Free")) {
+                    node.hugepages_free = amount;
+                }
+                return true;
+            });
+            result.numa_nodes.emplace_back(move(node));
+            return true;
+        }, nodes);
         return result;
     }
 
@@ -1,11 +1,14 @@
 #include <internal/facts/linux/networking_resolver.hpp>
 #include <internal/util/posix/scoped_descriptor.hpp>
-#include <facter/util/file.hpp>
+#include <internal/util/proc_file.hpp>
 #include <leatherman/logging/logging.hpp>
-#include <boost/algorithm/string.hpp>
 #include <cstring>
+#include <functional>
 #include <netpacket/packet.h>
 #include <net/if.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <sys/ioctl.h>
 
 using namespace std;
@@ -14,6 +17,263 @@ using namespace facter::util::posix;
 
 namespace facter { namespace facts { namespace linux {
 
+    static bool netlink_dump(int sock, uint16_t type, void const* request, size_t size, uint32_t sequence, function<void(nlmsghdr const*)> const& callback)
+    {
+        // Send a dump request for the given message type
+        vector<char> buffer(NLMSG_SPACE(size));
+        auto header = reinterpret_cast<nlmsghdr*>(buffer.data());
+        header->nlmsg_len = NLMSG_LENGTH(size);
+        header->nlmsg_type = type;
+        header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        header->nlmsg_seq = sequence;
+        memcpy(NLMSG_DATA(header), request, size);
+
+        sockaddr_nl kernel;
+        memset(&kernel, 0, sizeof(kernel));
+        kernel.nl_family = AF_NETLINK;
+        if (sendto(sock, buffer.data(), header->nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+            LOG_DEBUG("netlink request failed: %1% (%2%).", strerror(errno), errno);
+            return false;
+        }
+
+        // Read the replies until the end of the dump; each read returns as many messages as fit in the buffer
+        buffer.resize(65536);
+        while (true) {
+            ssize_t length = recv(sock, buffer.data(), buffer.size(), 0);
+            if (length < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_DEBUG("netlink receive failed: %1% (%2%).", strerror(errno), errno);
+                return false;
+            }
+            int remaining = static_cast<int>(length);
+            for (auto message = reinterpret_cast<nlmsghdr const*>(buffer.data()); NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining)) {
+                if (message->nlmsg_seq != sequence) {
+                    continue;
+                }
+                if (message->nlmsg_type == NLMSG_DONE) {
+                    return true;
+                }
+                if (message->nlmsg_type == NLMSG_ERROR) {
+                    auto error = reinterpret_cast<nlmsgerr const*>(NLMSG_DATA(message));
+                    LOG_DEBUG("netlink dump failed: %1% (%2%).", strerror(-error->error), -error->error);
+                    return false;
+                }
+                callback(message);
+            }
+        }
+    }
+
+    static void netmask_from_prefix(sockaddr_storage& netmask, int family, unsigned int prefix)
+    {
+        uint8_t* bytes = nullptr;
+        size_t size = 0;
+        if (family == AF_INET) {
+            auto addr = reinterpret_cast<sockaddr_in*>(&netmask);
+            addr->sin_family = AF_INET;
+            bytes = reinterpret_cast<uint8_t*>(&addr->sin_addr);
+            size = sizeof(addr->sin_addr);
+        } else {
+            auto addr = reinterpret_cast<sockaddr_in6*>(&netmask);
+            addr->sin6_family = AF_INET6;
+            bytes = reinterpret_cast<uint8_t*>(&addr->sin6_addr);
+            size = sizeof(addr->sin6_addr);
+        }
+        for (size_t i = 0; i < size && prefix > 0; ++i) {
+            unsigned int bits = prefix < 8 ? prefix : 8;
+            bytes[i] = static_cast<uint8_t>(0xFF << (8 - bits));
+            prefix -= bits;
+        }
+    }
+
+    networking_resolver::data networking_resolver::collect_data(collection& facts)
+    {
+        deque<netlink_address> addresses;
+        if (!read_netlink(addresses)) {
+            LOG_DEBUG("netlink is unavailable: using getifaddrs for interface information.");
+            _mtus.clear();
+            _primary_interface.reset();
+            return bsd::networking_resolver::collect_data(facts);
+        }
+
+        auto data = posix::networking_resolver::collect_data(facts);
+
+        // Map an interface to entries describing that interface
+        multimap<string, ifaddrs const*> interface_map;
+        for (auto const& address : addresses) {
+            interface_map.insert({ address.name, &address.entry });
+        }
+
+        populate_interfaces(facts, data, interface_map);
+        return data;
+    }
+
+    bool networking_resolver::read_netlink(deque<netlink_address>& addresses)
+    {
+        _mtus.clear();
+        _primary_interface.reset();
+
+        scoped_descriptor sock(socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE));
+        if (static_cast<int>(sock) < 0) {
+            LOG_DEBUG("netlink socket failed: %1% (%2%).", strerror(errno), errno);
+            return false;
+        }
+
+        // Entries are added in place; a deque never moves its elements, so the ifaddrs pointers remain valid
+        auto add = [&](string name) -> netlink_address& {
+            addresses.emplace_back();
+            auto& address = addresses.back();
+            address.name = move(name);
+            memset(&address.address, 0, sizeof(address.address));
+            memset(&address.netmask, 0, sizeof(address.netmask));
+            address.mtu = 0;
+            memset(&address.entry, 0, sizeof(address.entry));
+            address.entry.ifa_name = &address.name[0];
+            address.entry.ifa_addr = reinterpret_cast<sockaddr*>(&address.address);
+            return address;
+        };
+
+        // Dump the links first so that addresses and routes can refer to them by index
+        unordered_map<int, string> names;
+        ifinfomsg link_request;
+        memset(&link_request, 0, sizeof(link_request));
+        link_request.ifi_family = AF_UNSPEC;
+        bool success = netlink_dump(sock, RTM_GETLINK, &link_request, sizeof(link_request), 1, [&](nlmsghdr const* message) {
+            if (message->nlmsg_type != RTM_NEWLINK) {
+                return;
+            }
+            auto info = reinterpret_cast<ifinfomsg const*>(NLMSG_DATA(message));
+            string name;
+            boost::optional<uint64_t> mtu;
+            rtattr const* link_address = nullptr;
+            int remaining = IFLA_PAYLOAD(message);
+            for (auto attr = IFLA_RTA(info); RTA_OK(attr, remaining); attr = RTA_NEXT(attr, remaining)) {
+                if (attr->rta_type == IFLA_IFNAME) {
+                    name = reinterpret_cast<char const*>(RTA_DATA(attr));
+                } else if (attr->rta_type == IFLA_MTU && RTA_PAYLOAD(attr) >= sizeof(uint32_t)) {
+                    mtu = *reinterpret_cast<uint32_t const*>(RTA_DATA(attr));
+                } else if (attr->rta_type == IFLA_ADDRESS) {
+                    link_address = attr;
+                }
+            }
+            if (name.empty()) {
+                return;
+            }
+            names[info->ifi_index] = name;
+            if (mtu) {
+                _mtus[name] = *mtu;
+            }
+
+            // Describe the link the same way getifaddrs does, with a packet address
+            auto& address = add(move(name));
+            auto addr = reinterpret_cast<sockaddr_ll*>(&address.address);
+            addr->sll_family = AF_PACKET;
+            addr->sll_ifindex = info->ifi_index;
+            addr->sll_hatype = info->ifi_type;
+            if (link_address) {
+                addr->sll_halen = static_cast<unsigned char>(min<size_t>(RTA_PAYLOAD(link_address), sizeof(addr->sll_addr)));
+                memcpy(addr->sll_addr, RTA_DATA(link_address), addr->sll_halen);
+            }
+            address.entry.ifa_flags = info->ifi_flags;
+            address.mtu = mtu ? *mtu : 0;
+            address.entry.ifa_data = &address.mtu;
+        });
+        if (!success) {
+            return false;
+        }
+
+        // Dump the IPv4 and IPv6 addresses
+        ifaddrmsg address_request;
+        memset(&address_request, 0, sizeof(address_request));
+        address_request.ifa_family = AF_UNSPEC;
+        success = netlink_dump(sock, RTM_GETADDR, &address_request, sizeof(address_request), 2, [&](nlmsghdr const* message) {
+            if (message->nlmsg_type != RTM_NEWADDR) {
+                return;
+            }
+            auto info = reinterpret_cast<ifaddrmsg const*>(NLMSG_DATA(message));
+            if (info->ifa_family != AF_INET && info->ifa_family != AF_INET6) {
+                return;
+            }
+            rtattr const* local = nullptr;
+            rtattr const* remote = nullptr;
+            char const* label = nullptr;
+            int remaining = IFA_PAYLOAD(message);
+            for (auto attr = IFA_RTA(info); RTA_OK(attr, remaining); attr = RTA_NEXT(attr, remaining)) {
+                if (attr->rta_type == IFA_LOCAL) {
+                    local = attr;
+                } else if (attr->rta_type == IFA_ADDRESS) {
+                    remote = attr;
+                } else if (attr->rta_type == IFA_LABEL) {
+                    label = reinterpret_cast<char const*>(RTA_DATA(attr));
+                }
+            }
+
+            // As with getifaddrs, the local address is preferred and IPv4 aliases are named by their label
+            auto attr = local ? local : remote;
+            auto name_it = names.find(static_cast<int>(info->ifa_index));
+            if (!attr || name_it == names.end()) {
+                return;
+            }
+            auto& address = add(info->ifa_family == AF_INET && label ? string(label) : name_it->second);
+            if (info->ifa_family == AF_INET) {
+                auto addr = reinterpret_cast<sockaddr_in*>(&address.address);
+                addr->sin_family = AF_INET;
+                memcpy(&addr->sin_addr, RTA_DATA(attr), min<size_t>(RTA_PAYLOAD(attr), sizeof(addr->sin_addr)));
+            } else {
+                auto addr = reinterpret_cast<sockaddr_in6*>(&address.address);
+                addr->sin6_family = AF_INET6;
+                memcpy(&addr->sin6_addr, RTA_DATA(attr), min<size_t>(RTA_PAYLOAD(attr), sizeof(addr->sin6_addr)));
+                if (IN6_IS_ADDR_LINKLOCAL(&addr->sin6_addr) || IN6_IS_ADDR_MC_LINKLOCAL(&addr->sin6_addr)) {
+                    addr->sin6_scope_id = info->ifa_index;
+                }
+            }
+            netmask_from_prefix(address.netmask, info->ifa_family, info->ifa_prefixlen);
+            address.entry.ifa_netmask = reinterpret_cast<sockaddr*>(&address.netmask);
+        });
+        if (!success) {
+            return false;
+        }
+
+        // Dump the IPv4 routes to find the interface of the default route in the main table
+        rtmsg route_request;
+        memset(&route_request, 0, sizeof(route_request));
+        route_request.rtm_family = AF_INET;
+        string primary;
+        success = netlink_dump(sock, RTM_GETROUTE, &route_request, sizeof(route_request), 3, [&](nlmsghdr const* message) {
+            if (message->nlmsg_type != RTM_NEWROUTE || !primary.empty()) {
+                return;
+            }
+            auto route = reinterpret_cast<rtmsg const*>(NLMSG_DATA(message));
+            if (route->rtm_dst_len != 0 || route->rtm_type != RTN_UNICAST) {
+                return;
+            }
+            uint32_t table = route->rtm_table;
+            int index = 0;
+            int remaining = RTM_PAYLOAD(message);
+            for (auto attr = RTM_RTA(route); RTA_OK(attr, remaining); attr = RTA_NEXT(attr, remaining)) {
+                if (attr->rta_type == RTA_TABLE && RTA_PAYLOAD(attr) >= sizeof(uint32_t)) {
+                    table = *reinterpret_cast<uint32_t const*>(RTA_DATA(attr));
+                } else if (attr->rta_type == RTA_OIF && RTA_PAYLOAD(attr) >= sizeof(int)) {
+                    index = *reinterpret_cast<int const*>(RTA_DATA(attr));
+                } else if (attr->rta_type == RTA_MULTIPATH && index == 0 && RTA_PAYLOAD(attr) >= sizeof(rtnexthop)) {
+                    index = reinterpret_cast<rtnexthop const*>(RTA_DATA(attr))->rtnh_ifindex;
+                }
+            }
+            if (table != RT_TABLE_MAIN) {
+                return;
+            }
+            auto name_it = names.find(index);
+            if (name_it != names.end()) {
+                primary = name_it->second;
+            }
+        });
+        if (success) {
+            _primary_interface = move(primary);
+        }
+        return true;
+    }
+
     bool networking_resolver::is_link_address(sockaddr const* addr) const
     {
         return addr && addr->sa_family == AF_PACKET;
@@ -33,6 +293,12 @@ namespace facter { namespace facts { namespace linux {
 
     boost::optional<uint64_t> networking_resolver::get_link_mtu(string const& interface, void* data) const
     {
+        // Use the MTU from the netlink link dump if there was one
+        auto it = _mtus.find(interface);
+        if (it != _mtus.end()) {
+            return it->second;
+        }
+
         // Unfortunately in Linux, the data points at interface statistics
         // Nothing useful for us, so we need to use ioctl to query the MTU
         ifreq req;
@@ -54,15 +320,20 @@ namespace facter { namespace facts { namespace linux {
 
     string networking_resolver::get_primary_interface() const
     {
+        // Use the default route from the netlink route dump if there was one
+        if (_primary_interface) {
+            return *_primary_interface;
+        }
+
         // Read /proc/net/route to determine the primary interface
         // We consider the primary interface to be the one that has 0.0.0.0 as the
         // routing destination.
         string interface;
-        file::each_line("/proc/net/route", [&interface](string& line) {
-            vector<boost::iterator_range<string::iterator>> parts;
-            boost::split(parts, line, boost::is_space(), boost::token_compress_on);
-            if (parts.size() > 1 && parts[1] == boost::as_literal("00000000")) {
-                interface.assign(parts[0].begin(), parts[0].end());
+        proc_file routes("/proc/net/route");
+        routes.each_line([&interface](boost::string_ref line) {
+            auto name = proc_file::next_field(line);
+            if (proc_file::next_field(line) == "00000000") {
+                interface.assign(name.begin(), name.end());
                 return false;
             }
             return true;
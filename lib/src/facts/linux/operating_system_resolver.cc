@@ -1,10 +1,13 @@
 #include <internal/facts/linux/operating_system_resolver.hpp>
 #include <internal/facts/linux/release_file.hpp>
+#include <internal/util/proc_file.hpp>
 #include <internal/util/regex.hpp>
+#include <internal/util/scoped_root.hpp>
 #include <facter/facts/os.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
 #include <facter/execution/execution.hpp>
 #include <facter/util/file.hpp>
 #include <boost/filesystem.hpp>
@@ -26,44 +29,35 @@ namespace facter { namespace facts { namespace linux {
         // Default to the base implementation
         data result = posix::operating_system_resolver::collect_data(facts);
 
-        // Populate distro info
-        execution::each_line("lsb_release", {"-a"}, [&](string& line) {
-            string* variable = nullptr;
-            size_t offset = 0;
-            if (boost::starts_with(line, "LSB Version:")) {
-                variable = &result.specification_version;
-                offset = 12;
-            } else if (boost::starts_with(line, "Distributor ID:")) {
-                variable = &result.distro.id;
-                offset = 15;
-            } else if (boost::starts_with(line, "Description:")) {
-                variable = &result.distro.description;
-                offset = 12;
-            } else if (boost::starts_with(line, "Codename:")) {
-                variable = &result.distro.codename;
-                offset = 9;
-            } else if (boost::starts_with(line, "Release:")) {
-                variable = &result.distro.release;
-                offset = 8;
-            }
-            if (!variable) {
-                return true;
-            }
-            *variable = line.substr(offset);
-            boost::trim(*variable);
-            return true;
-        });
-
-        auto name = get_name(result.distro.id);
+        // Identify the distro from /etc/os-release rather than running lsb_release, which is a Python script on many distros
+        auto os_release = read_os_release();
+        auto name = get_name(os_release);
         if (!name.empty()) {
             result.name = move(name);
         }
 
-        auto release = get_release(result.name, result.distro.release);
+        auto release = get_release(result.name, os_release["VERSION_ID"]);
         if (!release.empty()) {
             result.release = move(release);
         }
 
+        // The LSB facts are found the first time they are accessed; lsb_release only runs if they were queried
+        // and /etc/lsb-release doesn't describe the distro
+        bool lsb_queried =
+            facts.is_queried(fact::lsb_dist_id) ||
+            facts.is_queried(fact::lsb_dist_release) ||
+            facts.is_queried(fact::lsb_dist_codename) ||
+            facts.is_queried(fact::lsb_dist_description) ||
+            facts.is_queried(fact::lsb_dist_major_release) ||
+            facts.is_queried(fact::lsb_dist_minor_release) ||
+            facts.is_queried(fact::lsb_release) ||
+            facts.is_queried("os.distro");
+        result.find_distro = [lsb_queried](distribution& distro, string& specification_version) {
+            if (!read_lsb_release_file(distro, specification_version) && lsb_queried) {
+                run_lsb_release(distro, specification_version);
+            }
+        };
+
         // Convert the architecture value depending on distro
         // For certain distros, use "amd64" for "x86_64"
         // For certain distros, use "x86" for "i386"
@@ -73,7 +67,7 @@ namespace facter { namespace facts { namespace linux {
              result.name == os::kfreebsd ||
              result.name == os::ubuntu)) {
             result.architecture = "amd64";
-        } else if (re_search(result.architecture, boost::regex("i[3456]86|pentium"))) {
+        } else if (re_search(result.architecture, cached_regex("i[3456]86|pentium"))) {
             // For 32-bit, use "x86" for Gentoo and "i386" for everyone else
             if (result.name == os::gentoo) {
                 result.architecture = "x86";
@@ -87,15 +81,95 @@ namespace facter { namespace facts { namespace linux {
         return result;
     }
 
-    string operating_system_resolver::get_name(string const& distro_id)
+    map<string, string> operating_system_resolver::read_os_release()
+    {
+        // Each line is a KEY=value assignment; values may be quoted
+        map<string, string> values;
+        proc_file file(release_file::os);
+        file.each_value([&](boost::string_ref key, boost::string_ref value) {
+            if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front()) {
+                value = value.substr(1, value.size() - 2);
+            }
+            values[key.to_string()] = value.to_string();
+            return true;
+        }, '=');
+        return values;
+    }
+
+    bool operating_system_resolver::read_lsb_release_file(distribution& distro, string& specification_version)
+    {
+        // Distros that ship /etc/lsb-release (e.g. Ubuntu) describe themselves in it exactly as lsb_release reports
+        bool found = false;
+        proc_file file(release_file::lsb);
+        file.each_value([&](boost::string_ref key, boost::string_ref value) {
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1, value.size() - 2);
+            }
+            if (key == "DISTRIB_ID") {
+                distro.id = value.to_string();
+                found = !distro.id.empty();
+            } else if (key == "DISTRIB_RELEASE") {
+                distro.release = value.to_string();
+            } else if (key == "DISTRIB_CODENAME") {
+                distro.codename = value.to_string();
+            } else if (key == "DISTRIB_DESCRIPTION") {
+                distro.description = value.to_string();
+            } else if (key == "LSB_VERSION") {
+                specification_version = value.to_string();
+            }
+            return true;
+        }, '=');
+        return found;
+    }
+
+    void operating_system_resolver::run_lsb_release(distribution& distro, string& specification_version)
+    {
+        execution::each_line("lsb_release", {"-a"}, [&](string& line) {
+            string* variable = nullptr;
+            size_t offset = 0;
+            if (boost::starts_with(line, "LSB Version:")) {
+                variable = &specification_version;
+                offset = 12;
+            } else if (boost::starts_with(line, "Distributor ID:")) {
+                variable = &distro.id;
+                offset = 15;
+            } else if (boost::starts_with(line, "Description:")) {
+                variable = &distro.description;
+                offset = 12;
+            } else if (boost::starts_with(line, "Codename:")) {
+                variable = &distro.codename;
+                offset = 9;
+            } else if (boost::starts_with(line, "Release:")) {
+                variable = &distro.release;
+                offset = 8;
+            }
+            if (!variable) {
+                return true;
+            }
+            *variable = line.substr(offset);
+            boost::trim(*variable);
+            return true;
+        });
+    }
+
+    string operating_system_resolver::get_name(map<string, string> const& os_release)
     {
         // Start by checking for Cumulus Linux or CoreOS
-        string value = check_os_release_linux();
+        string value = check_os_release_linux(os_release);
         if (!value.empty()) {
             return value;
         }
 
-        // Check for Debian next
+        // Check for Debian next; Debian derivatives are told apart by their os-release ID
+        string distro_id;
+        auto id = os_release.find("ID");
+        if (id != os_release.end()) {
+            if (id->second == "ubuntu") {
+                distro_id = os::ubuntu;
+            } else if (id->second == "linuxmint") {
+                distro_id = os::linux_mint;
+            }
+        }
         value = check_debian_linux(distro_id);
         if (!value.empty()) {
             return value;
@@ -145,16 +219,18 @@ namespace facter { namespace facts { namespace linux {
         string value;
         auto it = release_files.find(name);
         if (it != release_files.end()) {
-            string contents;
-            if (file::each_line(it->second, [&](string& line) {
+            proc_file release(it->second);
+            if (release.is_open()) {
                 // We only need the first line
-                contents = move(line);
-                return false;
-            })) {
+                string contents;
+                release.each_line([&](boost::string_ref line) {
+                    contents = line.to_string();
+                    return false;
+                });
                 if (boost::ends_with(contents, "(Rawhide)")) {
                     value = "Rawhide";
                 } else {
-                    re_search(contents, boost::regex("release (\\d[\\d.]*)"), &value);
+                    re_search(contents, cached_regex("release (\\d[\\d.]*)"), &value);
                 }
             }
         }
@@ -180,10 +256,10 @@ namespace facter { namespace facts { namespace linux {
             string contents = file::read(release_file::suse);
             string major;
             string minor;
-            if (re_search(contents, boost::regex("(?m)^VERSION\\s*=\\s*(\\d+)\\.?(\\d+)?"), &major, &minor)) {
+            if (re_search(contents, cached_regex("(?m)^VERSION\\s*=\\s*(\\d+)\\.?(\\d+)?"), &major, &minor)) {
                 // Check that we have a minor version; if not, use the patch level
                 if (minor.empty()) {
-                    if (!re_search(contents, boost::regex("(?m)^PATCHLEVEL\\s*=\\s*(\\d+)"), &minor)) {
+                    if (!re_search(contents, cached_regex("(?m)^PATCHLEVEL\\s*=\\s*(\\d+)"), &minor)) {
                         minor = "0";
                     }
                 }
@@ -226,7 +302,7 @@ namespace facter { namespace facts { namespace linux {
         if (value.empty() && name == os::vmware_esx) {
             auto result = execute("vmware", { "-v" });
             if (result.first) {
-                re_search(result.second, boost::regex("VMware ESX .*?(\\d.*)"), &value);
+                re_search(result.second, cached_regex("VMware ESX .*?(\\d.*)"), &value);
             }
         }
 
@@ -245,26 +321,20 @@ namespace facter { namespace facts { namespace linux {
         }
 
         string major, minor;
-        re_search(release, boost::regex("(\\d+\\.\\d*)\\.?(\\d*)"), &major, &minor);
+        re_search(release, cached_regex("(\\d+\\.\\d*)\\.?(\\d*)"), &major, &minor);
         return make_tuple(move(major), move(minor));
     }
 
-    string operating_system_resolver::check_os_release_linux()
+    string operating_system_resolver::check_os_release_linux(map<string, string> const& os_release)
     {
         // Check for NAME in /etc/os-release
         // Both cfacter and ruby facter should use the same field.
-        bs::error_code ec;
-        if (is_regular_file(release_file::os, ec)) {
-            string contents = file::read(release_file::os);
-            boost::trim(contents);
-
-            string release;
-            if (re_search(contents, boost::regex("(?m)^NAME=[\"']?(.+?)[\"']?$"), &release)) {
-                if (release == "Cumulus Linux") {
-                    return os::cumulus;
-                } else if (release == "CoreOS") {
-                    return os::coreos;
-                }
+        auto name = os_release.find("NAME");
+        if (name != os_release.end()) {
+            if (name->second == "Cumulus Linux") {
+                return os::cumulus;
+            } else if (name->second == "CoreOS") {
+                return os::coreos;
             }
         }
         return {};
@@ -274,7 +344,7 @@ namespace facter { namespace facts { namespace linux {
     {
         // Check for Debian variants
         bs::error_code ec;
-        if (is_regular_file(release_file::debian, ec)) {
+        if (is_regular_file(scoped_root::path(release_file::debian), ec)) {
             if (distro_id == os::ubuntu || distro_id == os::linux_mint) {
                 return distro_id;
             }
@@ -286,8 +356,8 @@ namespace facter { namespace facts { namespace linux {
     string operating_system_resolver::check_oracle_linux()
     {
         bs::error_code ec;
-        if (is_regular_file(release_file::oracle_enterprise_linux, ec)) {
-            if (is_regular_file(release_file::oracle_vm_linux, ec)) {
+        if (is_regular_file(scoped_root::path(release_file::oracle_enterprise_linux), ec)) {
+            if (is_regular_file(scoped_root::path(release_file::oracle_vm_linux), ec)) {
                 return os::oracle_vm_linux;
             }
             return os::oracle_enterprise_linux;
@@ -298,7 +368,7 @@ namespace facter { namespace facts { namespace linux {
     string operating_system_resolver::check_redhat_linux()
     {
         bs::error_code ec;
-        if (is_regular_file(release_file::redhat, ec)) {
+        if (is_regular_file(scoped_root::path(release_file::redhat), ec)) {
             static vector<tuple<boost::regex, string>> const regexs {
                 make_tuple(boost::regex("(?i)centos"),                        string(os::centos)),
                 make_tuple(boost::regex("(?i)scientific linux CERN"),         string(os::scientific_cern)),
@@ -326,7 +396,7 @@ namespace facter { namespace facts { namespace linux {
     string operating_system_resolver::check_suse_linux()
     {
         bs::error_code ec;
-        if (is_regular_file(release_file::suse, ec)) {
+        if (is_regular_file(scoped_root::path(release_file::suse), ec)) {
             static vector<tuple<boost::regex, string>> const regexs {
                 make_tuple(boost::regex("(?im)^SUSE LINUX Enterprise Server"),  string(os::suse_enterprise_server)),
                 make_tuple(boost::regex("(?im)^SUSE LINUX Enterprise Desktop"), string(os::suse_enterprise_desktop)),
@@ -364,7 +434,7 @@ namespace facter { namespace facts { namespace linux {
 
         for (auto const& file : files) {
             bs::error_code ec;
-            if (is_regular_file(get<0>(file), ec)) {
+            if (is_regular_file(scoped_root::path(get<0>(file)), ec)) {
                 return get<1>(file);
             }
         }
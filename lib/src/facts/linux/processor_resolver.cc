@@ -3,74 +3,204 @@
 #include <facter/facts/fact.hpp>
 #include <facter/facts/os.hpp>
 #include <facter/facts/scalar_value.hpp>
-#include <facter/util/file.hpp>
 #include <facter/util/directory.hpp>
+#include <facter/util/string.hpp>
+#include <internal/util/proc_file.hpp>
+#include <internal/util/posix/attribute_reader.hpp>
 #include <boost/algorithm/string.hpp>
-#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <unordered_map>
 #include <unordered_set>
 
 using namespace std;
 using namespace facter::util;
-using namespace boost::filesystem;
+using namespace facter::util::posix;
 
 namespace facter { namespace facts { namespace linux {
 
+    static int to_int(string const& value)
+    {
+        int64_t result;
+        return (parse_integer(value, result) && result >= 0 && result <= numeric_limits<int>::max()) ? static_cast<int>(result) : -1;
+    }
+
+    static void each_cpu(string const& list, function<void(int)> const& callback)
+    {
+        // The list is a comma-separated list of numbers and ranges (e.g. "0-3,8,10-11")
+        char const* current = list.c_str();
+        while (*current) {
+            char* end = nullptr;
+            long first = strtol(current, &end, 10);
+            if (end == current) {
+                return;
+            }
+            long last = first;
+            if (*end == '-') {
+                current = end + 1;
+                last = strtol(current, &end, 10);
+                if (end == current) {
+                    return;
+                }
+            }
+            for (long cpu = first; cpu <= last; ++cpu) {
+                callback(static_cast<int>(cpu));
+            }
+            if (*end != ',') {
+                return;
+            }
+            current = end + 1;
+        }
+    }
+
     processor_resolver::data processor_resolver::collect_data(collection& facts)
     {
         auto result = posix::processor_resolver::collect_data(facts);
 
-        unordered_set<string> cpus;
+        // Map each logical processor to its NUMA node, reading each node's list of processors once
+        unordered_map<int, int> cpu_nodes;
+        string attribute;
+        static directory::name_filter const nodes = directory::name_filter::regex("^node\\d+$");
+        directory::each_subdirectory("/sys/devices/system/node", [&](string const& node_directory) {
+            numa_node node;
+            node.id = to_int(node_directory.substr(node_directory.find_last_of('/') + 5));
+            if (attribute_reader::read_file(node_directory + "/cpulist", attribute)) {
+                node.cpus = attribute;
+                each_cpu(node.cpus, [&](int cpu) {
+                    cpu_nodes[cpu] = node.id;
+                });
+            }
+            proc_file meminfo(node_directory + "/meminfo");
+            meminfo.each_value([&](boost::string_ref key, boost::string_ref size) {
+                // The keys are prefixed with the node (e.g. "Node 0 MemTotal") and the sizes are in kB
+                if (!key.ends_with("MemTotal")) {
+                    return true;
+                }
+                if (proc_file::to_uint64(size, node.memory)) {
+                    node.memory *= 1024;
+                }
+                return false;
+            });
+            result.nodes.emplace_back(move(node));
+            return true;
+        }, nodes);
+
+        // Walk the logical processors once, reading their topology, maximum speed, and the caches they own
+        unordered_set<string> packages;
+        map<string, cache> caches;
+        string shared;
+        string package;
+        string core;
+        string max_frequency;
+        static directory::name_filter const cpus = directory::name_filter::regex("^cpu\\d+$");
         directory::each_subdirectory("/sys/devices/system/cpu", [&](string const& cpu_directory) {
             ++result.logical_count;
-            string id = file::read((path(cpu_directory) / "/topology/physical_package_id").string());
-            boost::trim(id);
-            if (id.empty() || cpus.emplace(move(id)).second) {
+
+            logical_processor cpu;
+            cpu.id = to_int(cpu_directory.substr(cpu_directory.find_last_of('/') + 4));
+            attribute_reader cpu_attributes(cpu_directory);
+            auto node = cpu_nodes.find(cpu.id);
+            if (node != cpu_nodes.end()) {
+                cpu.node = node->second;
+            }
+
+            cpu_attributes.read({
+                { "topology/physical_package_id",  &package },
+                { "topology/core_id",              &core },
+                { "topology/thread_siblings_list", &cpu.siblings },
+                { "cpufreq/cpuinfo_max_freq",      &max_frequency },
+            });
+            cpu.package = to_int(package);
+            if (package.empty() || packages.emplace(package).second) {
                 // Haven't seen this processor before
                 ++result.physical_count;
             }
+            if (!core.empty()) {
+                cpu.core = to_int(core);
+            }
+            // The speed is in kHz
+            if (to_int(max_frequency) > 0) {
+                cpu.max_speed = to_int(max_frequency) * static_cast<int64_t>(1000);
+            }
+
+            // A cache is described by every processor that shares it; only read it from the first of them
+            static directory::name_filter const indexes = directory::name_filter::regex("^index\\d+$");
+            directory::each_subdirectory(cpu_directory + "/cache", [&](string const& cache_directory) {
+                attribute_reader cache_attributes(cache_directory);
+                if (!cache_attributes.read("shared_cpu_list", shared) || strtol(shared.c_str(), nullptr, 10) != cpu.id) {
+                    return true;
+                }
+                if (!cache_attributes.read("level", attribute)) {
+                    return true;
+                }
+                string name = "L" + attribute;
+                if (cache_attributes.read("type", attribute)) {
+                    if (attribute == "Data") {
+                        name += "d";
+                    } else if (attribute == "Instruction") {
+                        name += "i";
+                    }
+                }
+                auto& entry = caches[name];
+                entry.name = name;
+                ++entry.instances;
+                if (entry.size == 0 && cache_attributes.read("size", attribute)) {
+                    // The size has a unit suffix (e.g. "32K")
+                    uint64_t size = 0;
+                    if (proc_file::to_uint64(attribute, size)) {
+                        if (attribute.back() == 'K') {
+                            size *= 1024;
+                        } else if (attribute.back() == 'M') {
+                            size *= 1024 * 1024;
+                        }
+                        entry.size = size;
+                    }
+                }
+                return true;
+            }, indexes);
+
+            result.topology.emplace_back(move(cpu));
             return true;
-        }, "^cpu\\d+$");
+        }, cpus);
+
+        sort(result.topology.begin(), result.topology.end(), [](logical_processor const& left, logical_processor const& right) {
+            return left.id < right.id;
+        });
+        sort(result.nodes.begin(), result.nodes.end(), [](numa_node const& left, numa_node const& right) {
+            return left.id < right.id;
+        });
+        for (auto& kvp : caches) {
+            result.caches.emplace_back(move(kvp.second));
+        }
+
+        // The speed of the processors is the maximum speed of the first
+        if (!result.topology.empty() && result.topology.front().id == 0) {
+            result.speed = result.topology.front().max_speed;
+        }
 
         // To determine model information, parse /proc/cpuinfo
+        // The file has dozens of lines per logical processor, so only the values that are kept are copied
         bool have_counts = result.logical_count > 0;
-        string id;
-        file::each_line("/proc/cpuinfo", [&](string& line) {
-            // Split the line on colon
-            auto pos = line.find(":");
-            if (pos == string::npos) {
-                return true;
-            }
-            string key = line.substr(0, pos);
-            boost::trim(key);
-            string value = line.substr(pos + 1);
-            boost::trim(value);
-
+        bool in_processor = false;
+        proc_file cpuinfo("/proc/cpuinfo");
+        cpuinfo.each_value([&](boost::string_ref key, boost::string_ref value) {
             if (key == "processor") {
                 // Start of a logical processor
-                id = move(value);
+                in_processor = !value.empty();
                 if (!have_counts) {
                     ++result.logical_count;
                 }
-            } else if (!id.empty() && key == "model name") {
+            } else if (in_processor && key == "model name") {
                 // Add the model for this logical processor
-                result.models.emplace_back(move(value));
-            } else if (!have_counts && key == "physical id" && cpus.emplace(move(value)).second) {
+                result.models.emplace_back(value.begin(), value.end());
+            } else if (!have_counts && key == "physical id" && packages.emplace(value.begin(), value.end()).second) {
                 // Couldn't determine physical count from sysfs, but CPU topology is present, so use it
                 ++result.physical_count;
             }
             return true;
         });
 
-        // Read in the max speed from the first cpu
-        // The speed is in kHz
-        string speed = file::read("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq");
-        if (!speed.empty()) {
-            try {
-                result.speed = stoi(speed) * static_cast<int64_t>(1000);
-            } catch (invalid_argument&) {
-            }
-        }
-
         return result;
     }
 
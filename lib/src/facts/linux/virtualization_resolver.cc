@@ -1,5 +1,7 @@
 #include <internal/facts/linux/virtualization_resolver.hpp>
+#include <internal/util/proc_file.hpp>
 #include <internal/util/regex.hpp>
+#include <internal/util/scoped_root.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
@@ -9,9 +11,14 @@
 #include <leatherman/logging/logging.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
+#include <cstring>
 #include <vector>
 #include <tuple>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
 using namespace std;
 using namespace facter::facts;
 using namespace facter::util;
@@ -21,24 +28,34 @@ namespace bs = boost::system;
 
 namespace facter { namespace facts { namespace linux {
 
+    virtualization_resolver::virtualization_resolver() :
+        resolvers::virtualization_resolver(
+            {
+                fact::bios_vendor,
+                fact::product_name,
+            })
+    {
+    }
+
+    bool virtualization_resolver::is_expensive() const
+    {
+        return true;
+    }
+
     string virtualization_resolver::get_hypervisor(collection& facts)
     {
+        // Detect the hypervisor natively first; the commands below are only run if that is inconclusive
         // First check for Docker/LXC
         string value = get_cgroup_vm();
 
-        // Next check for Google Compute Engine
+        // Next check for container markers
         if (value.empty()) {
-            value = get_gce_vm(facts);
+            value = get_container_vm();
         }
 
-        // Next check based on the virt-what command
-        if (value.empty()) {
-            value = get_what_vm();
-        }
-
-        // Next check the vmware tool output
+        // Next check for Google Compute Engine
         if (value.empty()) {
-            value = get_vmware_vm();
+            value = get_gce_vm(facts);
         }
 
         // Next check for OpenVZ
@@ -56,11 +73,31 @@ namespace facter { namespace facts { namespace linux {
             value = get_xen_vm();
         }
 
+        // Next check for z/VM
+        if (value.empty()) {
+            value = get_zlinux_vm();
+        }
+
         // Next check the DMI product name for the VM
         if (value.empty()) {
             value = get_product_name_vm(facts);
         }
 
+        // Next check the hypervisor's CPUID signature
+        if (value.empty()) {
+            value = get_cpuid_vm();
+        }
+
+        // Next check based on the virt-what command
+        if (value.empty()) {
+            value = get_what_vm();
+        }
+
+        // Next check the vmware tool output
+        if (value.empty()) {
+            value = get_vmware_vm();
+        }
+
         // Lastly, resort to lspci to look for hardware related to certain VMs
         if (value.empty()) {
             value = get_lspci_vm();
@@ -72,8 +109,9 @@ namespace facter { namespace facts { namespace linux {
     string virtualization_resolver::get_cgroup_vm()
     {
         string value;
-        file::each_line("/proc/1/cgroup", [&](string& line) {
-            vector<boost::iterator_range<string::iterator>> parts;
+        proc_file cgroups("/proc/1/cgroup");
+        vector<boost::iterator_range<char const*>> parts;
+        cgroups.each_line([&](boost::string_ref line) {
             boost::split(parts, line, boost::is_any_of(":"), boost::token_compress_on);
             if (parts.size() < 3) {
                 return true;
@@ -91,6 +129,26 @@ namespace facter { namespace facts { namespace linux {
         return value;
     }
 
+    string virtualization_resolver::get_container_vm()
+    {
+        // Docker creates /.dockerenv in its containers
+        bs::error_code ec;
+        if (is_regular_file(scoped_root::path("/.dockerenv"), ec)) {
+            return vm::docker;
+        }
+
+        // LXC sets the container environment variable of the container's init
+        string environment = file::read("/proc/1/environ");
+        vector<boost::iterator_range<string::iterator>> variables;
+        boost::split(variables, environment, boost::is_any_of(string(1, '\0')), boost::token_compress_on);
+        for (auto const& variable : variables) {
+            if (variable == boost::as_literal("container=lxc")) {
+                return vm::lxc;
+            }
+        }
+        return {};
+    }
+
     string virtualization_resolver::get_gce_vm(collection& facts)
     {
         auto vendor = facts.get<string_value>(fact::bios_vendor);
@@ -149,8 +207,9 @@ namespace facter { namespace facts { namespace linux {
     string virtualization_resolver::get_vserver_vm()
     {
         string value;
-        file::each_line("/proc/self/status", [&](string& line) {
-            vector<boost::iterator_range<string::iterator>> parts;
+        proc_file status("/proc/self/status");
+        vector<boost::iterator_range<char const*>> parts;
+        status.each_line([&](boost::string_ref line) {
             boost::split(parts, line, boost::is_space(), boost::token_compress_on);
             if (parts.size() != 2) {
                 return true;
@@ -188,14 +247,15 @@ namespace facter { namespace facts { namespace linux {
     {
         // Detect if it's a OpenVZ without being CloudLinux
         bs::error_code ec;
-        if (!is_directory("/proc/vz", ec) ||
-            is_regular_file("/proc/lve/list", ec) ||
-            boost::filesystem::is_empty("/proc/vz", ec)) {
+        if (!is_directory(scoped_root::path("/proc/vz"), ec) ||
+            is_regular_file(scoped_root::path("/proc/lve/list"), ec) ||
+            boost::filesystem::is_empty(scoped_root::path("/proc/vz"), ec)) {
             return {};
         }
         string value;
-        file::each_line("/proc/self/status", [&](string& line) {
-            vector<boost::iterator_range<string::iterator>> parts;
+        proc_file status("/proc/self/status");
+        vector<boost::iterator_range<char const*>> parts;
+        status.each_line([&](boost::string_ref line) {
             boost::split(parts, line, boost::is_space(), boost::token_compress_on);
             if (parts.size() != 2) {
                 return true;
@@ -215,19 +275,85 @@ namespace facter { namespace facts { namespace linux {
 
     string virtualization_resolver::get_xen_vm()
     {
-        // Check for a required Xen file
+        // The capabilities of the domain tell the control domain (dom0) apart from guests
         bs::error_code ec;
-        if (exists("/dev/xen/evtchn", ec) && !ec) {
+        if (exists(scoped_root::path("/proc/xen/capabilities"), ec) && !ec) {
+            string capabilities = file::read("/proc/xen/capabilities");
+            return capabilities.find("control_d") != string::npos ? vm::xen_privileged : vm::xen_unprivileged;
+        }
+        ec.clear();
+
+        // Check for a required Xen file
+        if (exists(scoped_root::path("/dev/xen/evtchn"), ec) && !ec) {
             return vm::xen_privileged;
         }
         ec.clear();
-        if (exists("/proc/xen", ec) && !ec) {
+        if (exists(scoped_root::path("/proc/xen"), ec) && !ec) {
             return vm::xen_unprivileged;
         }
         ec.clear();
-        if (exists("/dev/xvda1", ec) && !ec) {
+        if (exists(scoped_root::path("/dev/xvda1"), ec) && !ec) {
             return vm::xen_unprivileged;
         }
+
+        // Guests also report their hypervisor and, on newer kernels, their type in sysfs
+        string type = file::read("/sys/hypervisor/type");
+        boost::trim(type);
+        if (type == "xen") {
+            string guest_type = file::read("/sys/hypervisor/guest_type");
+            boost::trim(guest_type);
+            return guest_type == "HVM" ? vm::xen_hardware : vm::xen_unprivileged;
+        }
+        return {};
+    }
+
+    string virtualization_resolver::get_zlinux_vm()
+    {
+        // Linux on z/VM lists the control program in its system information
+        string value;
+        proc_file sysinfo("/proc/sysinfo");
+        sysinfo.each_line([&](boost::string_ref line) {
+            if (line.starts_with("VM00 Control Program:")) {
+                value = vm::zlinux;
+                return false;
+            }
+            return true;
+        });
+        return value;
+    }
+
+    string virtualization_resolver::get_cpuid_vm()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        // The hypervisor bit (ECX bit 31 of leaf 1) is set in guests
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1u << 31))) {
+            return {};
+        }
+
+        // Leaf 0x40000000 holds the hypervisor's vendor signature
+        __cpuid(0x40000000, eax, ebx, ecx, edx);
+        char signature[13] = {};
+        memcpy(signature, &ebx, 4);
+        memcpy(signature + 4, &ecx, 4);
+        memcpy(signature + 8, &edx, 4);
+
+        static vector<tuple<string, string>> const vms = {
+            make_tuple("KVMKVMKVM",     string(vm::kvm)),
+            make_tuple("VMwareVMware",  string(vm::vmware)),
+            make_tuple("Microsoft Hv",  string(vm::hyperv)),
+            make_tuple("XenVMMXenVMM",  string(vm::xen_hardware)),
+            make_tuple("VBoxVBoxVBox",  string(vm::virtualbox)),
+            make_tuple("prl hyperv  ",  string(vm::parallels)),
+            make_tuple(" lrpepyh  vr",  string(vm::parallels)),
+        };
+        for (auto const& vm : vms) {
+            if (get<0>(vm) == signature) {
+                return get<1>(vm);
+            }
+        }
+        LOG_DEBUG("unknown hypervisor CPUID signature \"%1%\".", signature);
+#endif  // defined(__i386__) || defined(__x86_64__)
         return {};
     }
 
@@ -262,20 +388,21 @@ namespace facter { namespace facts { namespace linux {
 
     string virtualization_resolver::get_lspci_vm()
     {
-        static vector<tuple<boost::regex, string>> vms = {
-            make_tuple(boost::regex("VM[wW]are"),                     string(vm::vmware)),
-            make_tuple(boost::regex("VirtualBox"),                    string(vm::virtualbox)),
-            make_tuple(boost::regex("1ab8:|[Pp]arallels"),            string(vm::parallels)),
-            make_tuple(boost::regex("XenSource"),                     string(vm::xen_hardware)),
-            make_tuple(boost::regex("Microsoft Corporation Hyper-V"), string(vm::hyperv)),
-            make_tuple(boost::regex("Class 8007: Google, Inc"),       string(vm::gce)),
-            make_tuple(boost::regex("virtio", boost::regex::icase),   string(vm::kvm)),
+        // Literal patterns are found with a substring search rather than a regular expression
+        static vector<tuple<pattern_matcher, string>> const vms = {
+            make_tuple(pattern_matcher("VM[wW]are"),                     string(vm::vmware)),
+            make_tuple(pattern_matcher("VirtualBox"),                    string(vm::virtualbox)),
+            make_tuple(pattern_matcher("1ab8:|[Pp]arallels"),            string(vm::parallels)),
+            make_tuple(pattern_matcher("XenSource"),                     string(vm::xen_hardware)),
+            make_tuple(pattern_matcher("Microsoft Corporation Hyper-V"), string(vm::hyperv)),
+            make_tuple(pattern_matcher("Class 8007: Google, Inc"),       string(vm::gce)),
+            make_tuple(pattern_matcher("(?i)virtio"),                    string(vm::kvm)),
         };
 
         string value;
         execution::each_line("lspci", [&](string& line) {
             for (auto const& vm : vms) {
-                if (re_search(line, get<0>(vm))) {
+                if (get<0>(vm).search(line)) {
                     value = get<1>(vm);
                     return false;
                 }
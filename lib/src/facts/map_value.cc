@@ -1,9 +1,14 @@
 #include <facter/facts/map_value.hpp>
+#include <facter/facts/lazy_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/util/string.hpp>
+#include <internal/facts/memory_usage.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/facts/value_hash.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
+#include <algorithm>
 
 using namespace std;
 using namespace facter::util;
@@ -22,18 +27,70 @@ namespace facter { namespace facts {
         value::operator=(static_cast<value&&>(other));
         if (this != &other) {
             _elements = std::move(other._elements);
+            _deferred = other._deferred;
+            _hash = other._hash.load();
         }
         return *this;
     }
 
-    void map_value::add(string name, unique_ptr<value> value)
+    void map_value::add(symbol name, shared_ptr<value const> value)
     {
         if (!value) {
             LOG_DEBUG("null value cannot be added to map.");
             return;
         }
 
-        _elements.emplace(move(name), move(value));
+        // Elements are commonly added in order, so check the end first
+        auto it = _elements.end();
+        if (!_elements.empty() && !(_elements.back().first < name)) {
+            it = lower_bound(_elements.begin(), _elements.end(), name, [](elements_type::value_type const& element, symbol const& key) {
+                return element.first < key;
+            });
+            if (it != _elements.end() && it->first == name) {
+                return;
+            }
+        }
+        _deferred = _deferred || value->deferred();
+        _elements.emplace(it, move(name), move(value));
+        _hash = 0;
+    }
+
+    void map_value::assign(elements_type elements)
+    {
+        elements.erase(remove_if(elements.begin(), elements.end(), [](elements_type::value_type const& element) {
+            return !element.second;
+        }), elements.end());
+        stable_sort(elements.begin(), elements.end(), [](elements_type::value_type const& first, elements_type::value_type const& second) {
+            return first.first < second.first;
+        });
+        elements.erase(unique(elements.begin(), elements.end(), [](elements_type::value_type const& first, elements_type::value_type const& second) {
+            return first.first == second.first;
+        }), elements.end());
+
+        _elements = move(elements);
+        _deferred = any_of(_elements.begin(), _elements.end(), [](elements_type::value_type const& element) {
+            return element.second->deferred();
+        });
+        _hash = 0;
+    }
+
+    void map_value::reserve(size_t count)
+    {
+        _elements.reserve(count);
+    }
+
+    map_value::elements_type::const_iterator map_value::find(string const& name) const
+    {
+        auto it = lower_bound(_elements.begin(), _elements.end(), name, [](elements_type::value_type const& element, string const& key) {
+            return element.first.str() < key;
+        });
+        return it != _elements.end() && it->first.str() == name ? it : _elements.end();
+    }
+
+    shared_ptr<value const> map_value::share(string const& name) const
+    {
+        auto it = find(name);
+        return it == _elements.end() ? nullptr : it->second;
     }
 
     bool map_value::empty() const
@@ -49,7 +106,11 @@ namespace facter { namespace facts {
     void map_value::each(function<bool(string const&, value const*)> func) const
     {
         for (auto const& kvp : _elements) {
-            if (!func(kvp.first, kvp.second.get())) {
+            auto element = lazy_value::resolve(kvp.second.get());
+            if (!element) {
+                continue;
+            }
+            if (!func(kvp.first, element)) {
                 break;
             }
         }
@@ -57,11 +118,47 @@ namespace facter { namespace facts {
 
     value const* map_value::operator[](string const& name) const
     {
-        auto it = _elements.find(name);
+        auto it = find(name);
         if (it == _elements.end()) {
             return nullptr;
         }
-        return it->second.get();
+        return lazy_value::resolve(it->second.get());
+    }
+
+    bool map_value::equals(value const& other) const
+    {
+        auto ptr = value_cast<map_value>(lazy_value::resolve(&other));
+        if (!ptr) {
+            return false;
+        }
+        if (ptr == this) {
+            return true;
+        }
+        // Maps with different hashes can't be equal; equal hashes are confirmed by comparing the elements
+        if (hash() != ptr->hash()) {
+            return false;
+        }
+        // Compare only the elements that have values; lazy elements without a value are ignored
+        size_t count = 0;
+        bool equal = true;
+        each([&](string const& name, value const* element) {
+            auto other_element = (*ptr)[name];
+            if (!other_element || !element->equals(*other_element)) {
+                equal = false;
+                return false;
+            }
+            ++count;
+            return true;
+        });
+        if (!equal) {
+            return false;
+        }
+        size_t other_count = 0;
+        ptr->each([&](string const&, value const*) {
+            ++other_count;
+            return true;
+        });
+        return count == other_count;
     }
 
     void map_value::to_json(Allocator& allocator, rapidjson::Value& value) const
@@ -69,24 +166,42 @@ namespace facter { namespace facts {
         value.SetObject();
 
         for (auto const& kvp : _elements) {
+            if (!lazy_value::resolve(kvp.second.get())) {
+                continue;
+            }
             rapidjson::Value child;
             kvp.second->to_json(allocator, child);
-            value.AddMember(kvp.first.c_str(), child, allocator);
+            value.AddMember(kvp.first.str().c_str(), child, allocator);
         }
     }
 
-    ostream& map_value::write(ostream& os, bool quoted, unsigned int level) const
+    void map_value::to_msgpack(msgpack_writer& writer) const
     {
-        if (_elements.empty()) {
-            os << "{}";
-            return os;
+        // The element count is written first, so count the elements that have values
+        size_t count = count_if(_elements.begin(), _elements.end(), [](elements_type::value_type const& kvp) {
+            return lazy_value::resolve(kvp.second.get()) != nullptr;
+        });
+        writer.start_map(count);
+
+        for (auto const& kvp : _elements) {
+            if (!lazy_value::resolve(kvp.second.get())) {
+                continue;
+            }
+            writer.str(kvp.first.str());
+            kvp.second->to_msgpack(writer);
         }
+    }
 
-        // Write out the elements in the map
-        os << "{\n";
+    ostream& map_value::write(ostream& os, bool quoted, unsigned int level) const
+    {
+        // Write out the elements in the map that have values
         bool first = true;
         for (auto const& kvp : _elements) {
+            if (!lazy_value::resolve(kvp.second.get())) {
+                continue;
+            }
             if (first) {
+                os << "{\n";
                 first = false;
             } else {
                 os << ",\n";
@@ -95,6 +210,10 @@ namespace facter { namespace facts {
             os << kvp.first << " => ";
             kvp.second->write(os, true /* always quote strings in a map */, level + 1);
         }
+        if (first) {
+            os << "{}";
+            return os;
+        }
         os << "\n";
         fill_n(ostream_iterator<char>(os), (level > 0 ? (level - 1) : 0) * 2, ' ');
         os << "}";
@@ -105,15 +224,69 @@ namespace facter { namespace facts {
     {
         emitter << BeginMap;
         for (auto const& kvp : _elements) {
+            if (!lazy_value::resolve(kvp.second.get())) {
+                continue;
+            }
             emitter << Key;
             if (needs_quotation(kvp.first)) {
                 emitter << DoubleQuoted;
             }
-            emitter << kvp.first << YAML::Value;
+            emitter << kvp.first.str() << YAML::Value;
             kvp.second->write(emitter);
         }
         emitter << EndMap;
         return emitter;
     }
 
+    bool map_value::deferred() const
+    {
+        return _deferred;
+    }
+
+    unique_ptr<value> map_value::clone() const
+    {
+        auto copy = make_value<map_value>(hidden());
+        copy->_elements.reserve(_elements.size());
+        for (auto const& kvp : _elements) {
+            // Share elements that can no longer change; copy the rest so the copy has no lazy values
+            if (!kvp.second->deferred()) {
+                copy->_elements.emplace_back(kvp.first, kvp.second);
+                continue;
+            }
+            auto child = kvp.second->clone();
+            if (child) {
+                copy->_elements.emplace_back(kvp.first, move(child));
+            }
+        }
+        // The copy has the same elements, so it has the same hash
+        copy->_hash = _hash.load();
+        return move(copy);
+    }
+
+    uint64_t map_value::hash() const
+    {
+        // Zero means the hash hasn't been computed; a map that hashes to zero is just hashed again
+        auto hash = _hash.load(memory_order_relaxed);
+        if (hash != 0) {
+            return hash;
+        }
+        hash = hash_integer(hash_basis, static_cast<uint64_t>(type()));
+        each([&](string const& name, value const* element) {
+            hash = hash_integer(hash_string(hash, name), element->hash());
+            return true;
+        });
+        _hash.store(hash, memory_order_relaxed);
+        return hash;
+    }
+
+    size_t map_value::memory_usage() const
+    {
+        // Keys are interned symbols shared by every map, so only the elements themselves are counted
+        size_t usage = sizeof(map_value) + _elements.capacity() * sizeof(elements_type::value_type);
+        for (auto const& kvp : _elements) {
+            usage += shared_control_block_size + kvp.second->memory_usage();
+        }
+        return usage;
+    }
+
 }}  // namespace facter::facts
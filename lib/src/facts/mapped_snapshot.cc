@@ -0,0 +1,268 @@
+#include <facter/facts/mapped_snapshot.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/facts/writer.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+namespace fs = boost::filesystem;
+namespace io = boost::iostreams;
+
+namespace facter { namespace facts {
+
+    // The header of a published file; the facts follow it in the MessagePack output format
+    // The file is only read on the host that wrote it, so the header is in the host's byte order
+    struct snapshot_header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t generation;
+        uint64_t superseded;
+        uint64_t size;
+    };
+
+    static char const snapshot_magic[8] = { 'F', 'A', 'C', 'T', 'S', 'N', 'A', 'P' };
+    static const uint32_t snapshot_version = 1;
+
+    static_assert(sizeof(atomic<uint64_t>) == sizeof(uint64_t), "the superseded flag must be usable as an atomic in place.");
+    static_assert(offsetof(snapshot_header, superseded) % sizeof(uint64_t) == 0, "the superseded flag must be aligned.");
+
+    // The superseded flag is written by the publisher while readers have the file mapped
+    static atomic<uint64_t>& superseded_flag(char* data)
+    {
+        return *reinterpret_cast<atomic<uint64_t>*>(data + offsetof(snapshot_header, superseded));
+    }
+
+    static atomic<uint64_t> const& superseded_flag(char const* data)
+    {
+        return *reinterpret_cast<atomic<uint64_t> const*>(data + offsetof(snapshot_header, superseded));
+    }
+
+    // Gets the header of a mapped file if it is a published snapshot; mappings are page aligned, so the header can be read in place
+    static snapshot_header const* validate(char const* data, size_t size, string const& path)
+    {
+        if (size < sizeof(snapshot_header)) {
+            LOG_DEBUG("published snapshot %1% is too small to be a snapshot.", path);
+            return nullptr;
+        }
+        auto header = reinterpret_cast<snapshot_header const*>(data);
+        if (memcmp(header->magic, snapshot_magic, sizeof(snapshot_magic)) != 0 || header->version != snapshot_version) {
+            LOG_DEBUG("published snapshot %1% is not a snapshot of this version.", path);
+            return nullptr;
+        }
+        if (header->size > size - sizeof(snapshot_header)) {
+            LOG_DEBUG("published snapshot %1% is truncated.", path);
+            return nullptr;
+        }
+        return header;
+    }
+
+    struct snapshot_publisher::mapping
+    {
+        io::mapped_file file;
+    };
+
+    struct mapped_snapshot::mapping
+    {
+        io::mapped_file_source file;
+    };
+
+    snapshot_publisher::snapshot_publisher(string path) :
+        _path(move(path)),
+        _generation(0)
+    {
+        // Take over a file left by a previous publisher, so its readers are told when it is superseded
+        // and the generation continues from it
+        boost::system::error_code ec;
+        if (fs::file_size(_path, ec) < sizeof(snapshot_header) || ec) {
+            return;
+        }
+        unique_ptr<mapping> previous(new mapping());
+        try {
+            previous->file.open(_path, io::mapped_file::readwrite);
+        } catch (ios_base::failure const& ex) {
+            LOG_DEBUG("published snapshot %1% could not be mapped: %2%.", _path, ex.what());
+            return;
+        }
+        auto header = validate(previous->file.const_data(), previous->file.size(), _path);
+        if (header) {
+            _generation = header->generation;
+            _published = move(previous);
+        }
+    }
+
+    snapshot_publisher::~snapshot_publisher()
+    {
+        if (!_published) {
+            return;
+        }
+        superseded_flag(_published->file.data()).store(1, memory_order_release);
+        _published.reset();
+
+        boost::system::error_code ec;
+        fs::remove(_path, ec);
+    }
+
+    bool snapshot_publisher::publish(snapshot const& facts)
+    {
+        ostringstream body;
+        facts.write(body, format::msgpack);
+        auto contents = body.str();
+
+        snapshot_header header = {};
+        memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+        header.version = snapshot_version;
+        header.generation = _generation + 1;
+        header.size = contents.size();
+
+        // Write to a temporary file and rename it so that readers never see a partially written snapshot
+        string temp_path = _path + ".tmp";
+        {
+            boost::nowide::ofstream out(temp_path.c_str(), ios::out | ios::binary | ios::trunc);
+            out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            out.write(contents.data(), contents.size());
+            if (!out) {
+                LOG_WARNING("published snapshot %1% could not be written.", temp_path);
+                return false;
+            }
+        }
+
+        // Map the new file before it is renamed so that it can be marked as superseded in turn
+        boost::system::error_code ec;
+        unique_ptr<mapping> published(new mapping());
+        try {
+            published->file.open(temp_path, io::mapped_file::readwrite);
+        } catch (ios_base::failure const& ex) {
+            LOG_WARNING("published snapshot %1% could not be mapped: %2%.", temp_path, ex.what());
+            fs::remove(temp_path, ec);
+            return false;
+        }
+        fs::rename(temp_path, _path, ec);
+        if (ec) {
+            LOG_WARNING("published snapshot %1% could not be written: %2%.", _path, ec.message());
+            published.reset();
+            fs::remove(temp_path, ec);
+            return false;
+        }
+
+        if (_published) {
+            superseded_flag(_published->file.data()).store(1, memory_order_release);
+        }
+        _published = move(published);
+        _generation = header.generation;
+        return true;
+    }
+
+    uint64_t snapshot_publisher::generation() const
+    {
+        return _generation;
+    }
+
+    mapped_snapshot::mapped_snapshot(string path) :
+        _path(move(path))
+    {
+        reload();
+    }
+
+    mapped_snapshot::~mapped_snapshot()
+    {
+    }
+
+    bool mapped_snapshot::is_open() const
+    {
+        return static_cast<bool>(_mapping);
+    }
+
+    uint64_t mapped_snapshot::generation() const
+    {
+        return _mapping ? reinterpret_cast<snapshot_header const*>(_mapping->file.data())->generation : 0;
+    }
+
+    bool mapped_snapshot::stale() const
+    {
+        return !_mapping || superseded_flag(_mapping->file.data()).load(memory_order_acquire) != 0;
+    }
+
+    bool mapped_snapshot::reload()
+    {
+        if (!stale()) {
+            return false;
+        }
+
+        boost::system::error_code ec;
+        if (fs::file_size(_path, ec) < sizeof(snapshot_header) || ec) {
+            LOG_DEBUG("no snapshot is published to %1%.", _path);
+            return false;
+        }
+        unique_ptr<mapping> mapped(new mapping());
+        try {
+            mapped->file.open(_path);
+        } catch (ios_base::failure const& ex) {
+            LOG_DEBUG("published snapshot %1% could not be mapped: %2%.", _path, ex.what());
+            return false;
+        }
+        auto header = validate(mapped->file.data(), mapped->file.size(), _path);
+        if (!header || (_mapping && header->generation == generation())) {
+            return false;
+        }
+        _mapping = move(mapped);
+        return true;
+    }
+
+    bool mapped_snapshot::query(string const& query, char const*& data, size_t& size) const
+    {
+        if (!_mapping) {
+            return false;
+        }
+        auto begin = _mapping->file.data() + sizeof(snapshot_header);
+        auto end = begin + reinterpret_cast<snapshot_header const*>(_mapping->file.data())->size;
+
+        try {
+            // As with a collection, a fact with the exact name of the query takes precedence
+            auto current = begin;
+            if (!find_msgpack(current, end, { query })) {
+                current = begin;
+                if (query.find('.') == string::npos || !find_msgpack(current, end, split_query(query))) {
+                    return false;
+                }
+            }
+            auto next = current;
+            skip_msgpack(next, end);
+
+            // A nil value is an unresolved value
+            if (static_cast<uint8_t>(*current) == 0xc0) {
+                return false;
+            }
+            data = current;
+            size = static_cast<size_t>(next - current);
+            return true;
+        } catch (msgpack_exception const& ex) {
+            LOG_DEBUG("published snapshot %1% could not be read: %2%.", _path, ex.what());
+            return false;
+        }
+    }
+
+    unique_ptr<value> mapped_snapshot::get(string const& query) const
+    {
+        char const* data;
+        size_t size;
+        if (!this->query(query, data, size)) {
+            return nullptr;
+        }
+        try {
+            return from_msgpack(data, data + size);
+        } catch (msgpack_exception const& ex) {
+            LOG_DEBUG("published snapshot %1% could not be read: %2%.", _path, ex.what());
+            return nullptr;
+        }
+    }
+
+}}  // namespace facter::facts
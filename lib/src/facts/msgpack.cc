@@ -0,0 +1,489 @@
+#include <internal/facts/msgpack.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <rapidjson/document.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    msgpack_exception::msgpack_exception(string const& message) :
+        runtime_error(message)
+    {
+    }
+
+    msgpack_writer::msgpack_writer(string& buffer) :
+        _buffer(buffer)
+    {
+    }
+
+    void msgpack_writer::nil()
+    {
+        put(0xc0);
+    }
+
+    void msgpack_writer::boolean(bool value)
+    {
+        put(value ? 0xc3 : 0xc2);
+    }
+
+    void msgpack_writer::integer(int64_t value)
+    {
+        if (value >= -32 && value <= 127) {
+            // Positive and negative fixints are stored in the type byte
+            put(static_cast<uint8_t>(value));
+        } else if (value > 0) {
+            if (value <= UINT8_MAX) {
+                put(0xcc);
+                put(static_cast<uint64_t>(value), 1);
+            } else if (value <= UINT16_MAX) {
+                put(0xcd);
+                put(static_cast<uint64_t>(value), 2);
+            } else if (value <= UINT32_MAX) {
+                put(0xce);
+                put(static_cast<uint64_t>(value), 4);
+            } else {
+                put(0xd3);
+                put(static_cast<uint64_t>(value), 8);
+            }
+        } else {
+            if (value >= INT8_MIN) {
+                put(0xd0);
+                put(static_cast<uint64_t>(value), 1);
+            } else if (value >= INT16_MIN) {
+                put(0xd1);
+                put(static_cast<uint64_t>(value), 2);
+            } else if (value >= INT32_MIN) {
+                put(0xd2);
+                put(static_cast<uint64_t>(value), 4);
+            } else {
+                put(0xd3);
+                put(static_cast<uint64_t>(value), 8);
+            }
+        }
+    }
+
+    void msgpack_writer::floating_point(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        put(0xcb);
+        put(bits, 8);
+    }
+
+    void msgpack_writer::str(char const* value, size_t size)
+    {
+        if (size < 32) {
+            put(static_cast<uint8_t>(0xa0 | size));
+        } else if (size <= UINT8_MAX) {
+            put(0xd9);
+            put(size, 1);
+        } else if (size <= UINT16_MAX) {
+            put(0xda);
+            put(size, 2);
+        } else {
+            put(0xdb);
+            put(size, 4);
+        }
+        _buffer.append(value, size);
+    }
+
+    void msgpack_writer::str(std::string const& value)
+    {
+        str(value.c_str(), value.size());
+    }
+
+    void msgpack_writer::start_array(size_t size)
+    {
+        header(0x90, 16, 0xdc, size);
+    }
+
+    void msgpack_writer::start_map(size_t size)
+    {
+        header(0x80, 16, 0xde, size);
+    }
+
+    void msgpack_writer::json(rapidjson::Value const& value)
+    {
+        if (value.IsBool()) {
+            boolean(value.GetBool());
+        } else if (value.IsDouble()) {
+            floating_point(value.GetDouble());
+        } else if (value.IsInt64()) {
+            integer(value.GetInt64());
+        } else if (value.IsUint64()) {
+            integer(static_cast<int64_t>(value.GetUint64()));
+        } else if (value.IsString()) {
+            str(value.GetString(), value.GetStringLength());
+        } else if (value.IsArray()) {
+            start_array(value.Size());
+            for (auto it = value.Begin(); it != value.End(); ++it) {
+                json(*it);
+            }
+        } else if (value.IsObject()) {
+            start_map(static_cast<size_t>(value.MemberEnd() - value.MemberBegin()));
+            for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {
+                str(it->name.GetString(), it->name.GetStringLength());
+                json(it->value);
+            }
+        } else {
+            nil();
+        }
+    }
+
+    void msgpack_writer::header(uint8_t fix, uint8_t fix_limit, uint8_t code, size_t size)
+    {
+        // The 16-bit form's code is followed by the 32-bit form's
+        if (size < fix_limit) {
+            put(static_cast<uint8_t>(fix | size));
+        } else if (size <= UINT16_MAX) {
+            put(code);
+            put(size, 2);
+        } else {
+            put(static_cast<uint8_t>(code + 1));
+            put(size, 4);
+        }
+    }
+
+    void msgpack_writer::put(uint8_t byte)
+    {
+        _buffer += static_cast<char>(byte);
+    }
+
+    void msgpack_writer::put(uint64_t value, unsigned int bytes)
+    {
+        // MessagePack stores multi-byte values in big-endian order
+        for (unsigned int i = bytes; i > 0; --i) {
+            put(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+        }
+    }
+
+    static uint64_t take(char const*& data, char const* end, unsigned int bytes)
+    {
+        if (end - data < static_cast<ptrdiff_t>(bytes)) {
+            throw msgpack_exception("unexpected end of data");
+        }
+        uint64_t value = 0;
+        for (unsigned int i = 0; i < bytes; ++i) {
+            value = (value << 8) | static_cast<uint8_t>(*data++);
+        }
+        return value;
+    }
+
+    static string take_string(char const*& data, char const* end, size_t size)
+    {
+        if (static_cast<size_t>(end - data) < size) {
+            throw msgpack_exception("unexpected end of data");
+        }
+        string value(data, data + size);
+        data += size;
+        return value;
+    }
+
+    static void skip_bytes(char const*& data, char const* end, uint64_t size)
+    {
+        if (static_cast<uint64_t>(end - data) < size) {
+            throw msgpack_exception("unexpected end of data");
+        }
+        data += size;
+    }
+
+    // Takes a string key without copying it; the key points into the data
+    static void take_key(char const*& data, char const* end, char const*& key, size_t& size)
+    {
+        auto code = static_cast<uint8_t>(take(data, end, 1));
+        if ((code & 0xe0) == 0xa0) {
+            size = code & 0x1f;
+        } else if (code >= 0xd9 && code <= 0xdb) {
+            size = take(data, end, 1u << (code - 0xd9));
+        } else {
+            throw msgpack_exception("expected a string key");
+        }
+        key = data;
+        skip_bytes(data, end, size);
+    }
+
+    static string take_key(char const*& data, char const* end)
+    {
+        char const* key;
+        size_t size;
+        take_key(data, end, key, size);
+        return string(key, size);
+    }
+
+    static int64_t take_signed(char const*& data, char const* end, unsigned int bytes)
+    {
+        auto value = take(data, end, bytes);
+        // Sign extend values narrower than 64 bits
+        unsigned int shift = 64 - bytes * 8;
+        return static_cast<int64_t>(value << shift) >> shift;
+    }
+
+    // The deepest nesting of arrays and maps that is decoded; deeper data is rejected rather than overflowing the stack
+    static unsigned int const max_depth = 128;
+
+    static unique_ptr<value> decode(char const*& data, char const* end, bool hidden, unsigned int depth);
+
+    static unique_ptr<value> read_array(char const*& data, char const* end, size_t size, bool hidden, unsigned int depth)
+    {
+        auto array = make_value<array_value>(hidden);
+        for (size_t i = 0; i < size; ++i) {
+            auto element = decode(data, end, false, depth + 1);
+            if (element) {
+                array->add(move(element));
+            }
+        }
+        return move(array);
+    }
+
+    static unique_ptr<value> read_map(char const*& data, char const* end, size_t size, bool hidden, unsigned int depth)
+    {
+        auto map = make_value<map_value>(hidden);
+        // The size is untrusted; each entry takes at least two bytes, so no more can be in the data that remains
+        map->reserve(min<size_t>(size, static_cast<size_t>(end - data) / 2));
+        for (size_t i = 0; i < size; ++i) {
+            auto name = take_key(data, end);
+            auto element = decode(data, end, false, depth + 1);
+            if (element) {
+                map->add(name, move(element));
+            }
+        }
+        return move(map);
+    }
+
+    static unique_ptr<value> decode(char const*& data, char const* end, bool hidden, unsigned int depth)
+    {
+        if (depth > max_depth) {
+            throw msgpack_exception("values are nested too deeply");
+        }
+        auto code = static_cast<uint8_t>(take(data, end, 1));
+        if (code <= 0x7f) {
+            return make_value<integer_value>(code, hidden);
+        }
+        if (code >= 0xe0) {
+            return make_value<integer_value>(static_cast<int8_t>(code), hidden);
+        }
+        if ((code & 0xe0) == 0xa0) {
+            return make_value<string_value>(take_string(data, end, code & 0x1f), hidden);
+        }
+        if ((code & 0xf0) == 0x90) {
+            return read_array(data, end, code & 0x0f, hidden, depth);
+        }
+        if ((code & 0xf0) == 0x80) {
+            return read_map(data, end, code & 0x0f, hidden, depth);
+        }
+
+        switch (code) {
+            case 0xc0:
+                return nullptr;
+            case 0xc2:
+                return make_value<boolean_value>(false, hidden);
+            case 0xc3:
+                return make_value<boolean_value>(true, hidden);
+            case 0xca: {
+                auto bits = static_cast<uint32_t>(take(data, end, 4));
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                return make_value<double_value>(value, hidden);
+            }
+            case 0xcb: {
+                auto bits = take(data, end, 8);
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                return make_value<double_value>(value, hidden);
+            }
+            case 0xcc:
+                return make_value<integer_value>(static_cast<int64_t>(take(data, end, 1)), hidden);
+            case 0xcd:
+                return make_value<integer_value>(static_cast<int64_t>(take(data, end, 2)), hidden);
+            case 0xce:
+                return make_value<integer_value>(static_cast<int64_t>(take(data, end, 4)), hidden);
+            case 0xcf:
+                return make_value<integer_value>(static_cast<int64_t>(take(data, end, 8)), hidden);
+            case 0xd0:
+                return make_value<integer_value>(take_signed(data, end, 1), hidden);
+            case 0xd1:
+                return make_value<integer_value>(take_signed(data, end, 2), hidden);
+            case 0xd2:
+                return make_value<integer_value>(take_signed(data, end, 4), hidden);
+            case 0xd3:
+                return make_value<integer_value>(take_signed(data, end, 8), hidden);
+            case 0xd9:
+                return make_value<string_value>(take_string(data, end, take(data, end, 1)), hidden);
+            case 0xda:
+                return make_value<string_value>(take_string(data, end, take(data, end, 2)), hidden);
+            case 0xdb:
+                return make_value<string_value>(take_string(data, end, take(data, end, 4)), hidden);
+            case 0xdc:
+                return read_array(data, end, take(data, end, 2), hidden, depth);
+            case 0xdd:
+                return read_array(data, end, take(data, end, 4), hidden, depth);
+            case 0xde:
+                return read_map(data, end, take(data, end, 2), hidden, depth);
+            case 0xdf:
+                return read_map(data, end, take(data, end, 4), hidden, depth);
+            default:
+                throw msgpack_exception("unsupported type " + to_string(static_cast<int>(code)));
+        }
+    }
+
+    unique_ptr<value> from_msgpack(char const*& data, char const* end, bool hidden)
+    {
+        return decode(data, end, hidden, 0);
+    }
+
+    void read_msgpack_facts(string const& data, function<void(string&&, unique_ptr<value>)> const& callback)
+    {
+        auto begin = data.data();
+        auto end = begin + data.size();
+
+        // Read the top-level map directly so each fact is handed to the callback as it is decoded
+        size_t size;
+        auto code = static_cast<uint8_t>(take(begin, end, 1));
+        if ((code & 0xf0) == 0x80) {
+            size = code & 0x0f;
+        } else if (code == 0xde) {
+            size = take(begin, end, 2);
+        } else if (code == 0xdf) {
+            size = take(begin, end, 4);
+        } else {
+            throw msgpack_exception("expected a map of facts");
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            auto name = take_key(begin, end);
+            auto val = from_msgpack(begin, end);
+            if (val) {
+                callback(move(name), move(val));
+            }
+        }
+        if (begin != end) {
+            throw msgpack_exception("unexpected data after the facts");
+        }
+    }
+
+    void skip_msgpack(char const*& data, char const* end)
+    {
+        // Containers are skipped by counting the values left to skip rather than by recursing
+        uint64_t remaining = 1;
+        while (remaining > 0) {
+            --remaining;
+            auto code = static_cast<uint8_t>(take(data, end, 1));
+            if (code <= 0x7f || code >= 0xe0) {
+                continue;
+            }
+            if ((code & 0xe0) == 0xa0) {
+                skip_bytes(data, end, code & 0x1f);
+                continue;
+            }
+            if ((code & 0xf0) == 0x90) {
+                remaining += code & 0x0f;
+                continue;
+            }
+            if ((code & 0xf0) == 0x80) {
+                remaining += 2 * (code & 0x0f);
+                continue;
+            }
+
+            switch (code) {
+                case 0xc0:
+                case 0xc2:
+                case 0xc3:
+                    break;
+                case 0xcc:
+                case 0xd0:
+                    skip_bytes(data, end, 1);
+                    break;
+                case 0xcd:
+                case 0xd1:
+                    skip_bytes(data, end, 2);
+                    break;
+                case 0xca:
+                case 0xce:
+                case 0xd2:
+                    skip_bytes(data, end, 4);
+                    break;
+                case 0xcb:
+                case 0xcf:
+                case 0xd3:
+                    skip_bytes(data, end, 8);
+                    break;
+                case 0xd9:
+                case 0xda:
+                case 0xdb:
+                    skip_bytes(data, end, take(data, end, 1u << (code - 0xd9)));
+                    break;
+                case 0xdc:
+                    remaining += take(data, end, 2);
+                    break;
+                case 0xdd:
+                    remaining += take(data, end, 4);
+                    break;
+                case 0xde:
+                    remaining += 2 * take(data, end, 2);
+                    break;
+                case 0xdf:
+                    remaining += 2 * take(data, end, 4);
+                    break;
+                default:
+                    throw msgpack_exception("unsupported type " + to_string(static_cast<int>(code)));
+            }
+        }
+    }
+
+    bool find_msgpack(char const*& data, char const* end, vector<string> const& path)
+    {
+        for (auto const& segment : path) {
+            auto code = static_cast<uint8_t>(take(data, end, 1));
+            uint64_t size;
+            bool is_map;
+            if ((code & 0xf0) == 0x80 || (code & 0xf0) == 0x90) {
+                is_map = (code & 0xf0) == 0x80;
+                size = code & 0x0f;
+            } else if (code == 0xde || code == 0xdc) {
+                is_map = code == 0xde;
+                size = take(data, end, 2);
+            } else if (code == 0xdf || code == 0xdd) {
+                is_map = code == 0xdf;
+                size = take(data, end, 4);
+            } else {
+                return false;
+            }
+
+            if (!is_map) {
+                // Only a segment of digits selects an element of an array
+                if (segment.empty() || segment.size() > 9 || segment.find_first_not_of("0123456789") != string::npos) {
+                    return false;
+                }
+                uint64_t index = stoul(segment);
+                if (index >= size) {
+                    return false;
+                }
+                for (uint64_t i = 0; i < index; ++i) {
+                    skip_msgpack(data, end);
+                }
+                continue;
+            }
+
+            bool found = false;
+            for (uint64_t i = 0; i < size; ++i) {
+                char const* key;
+                size_t length;
+                take_key(data, end, key, length);
+                if (length == segment.size() && memcmp(key, segment.data(), length) == 0) {
+                    found = true;
+                    break;
+                }
+                skip_msgpack(data, end);
+            }
+            if (!found) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}}  // namespace facter::facts
@@ -7,6 +7,7 @@
 #include <internal/facts/osx/system_profiler_resolver.hpp>
 #include <internal/facts/osx/virtualization_resolver.hpp>
 #include <internal/facts/bsd/uptime_resolver.hpp>
+#include <internal/facts/posix/load_resolver.hpp>
 #include <internal/facts/posix/ssh_resolver.hpp>
 #include <internal/facts/posix/identity_resolver.hpp>
 #include <internal/facts/posix/timezone_resolver.hpp>
@@ -22,6 +23,7 @@ namespace facter { namespace facts {
         add(make_shared<posix::kernel_resolver>());
         add(make_shared<osx::operating_system_resolver>());
         add(make_shared<bsd::uptime_resolver>());
+        add(make_shared<posix::load_resolver>());
         add(make_shared<osx::networking_resolver>());
         add(make_shared<osx::processor_resolver>());
         add(make_shared<osx::dmi_resolver>());
@@ -1,8 +1,9 @@
 #include <internal/facts/osx/dmi_resolver.hpp>
+#include <internal/util/bsd/sysctl.hpp>
 #include <leatherman/logging/logging.hpp>
-#include <sys/sysctl.h>
 
 using namespace std;
+using namespace facter::util::bsd;
 
 namespace facter { namespace facts { namespace osx {
 
@@ -10,22 +11,11 @@ namespace facter { namespace facts { namespace osx {
     {
         data result;
 
-        int mib[] = { CTL_HW, HW_MODEL };
-        size_t length = 0;
-
         // OSX only supports the product name
-        if (sysctl(mib, sizeof(mib) / sizeof(mib[0]), nullptr, &length, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctl failed: %1% (%2%): DMI facts are unavailable.", strerror(errno), errno);
-            return result;
-        }
-
-        vector<char> model_name(length);
-        if (sysctl(mib, sizeof(mib) / sizeof(mib[0]), model_name.data(), &length, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctl failed: %1% (%2%): DMI facts are unavailable.", strerror(errno), errno);
-            return result;
+        sysctl_snapshot snapshot;
+        if (!snapshot.get_string("hw.model", result.product_name)) {
+            LOG_DEBUG("DMI facts are unavailable.");
         }
-
-        result.product_name = model_name.data();
         return result;
     }
 
@@ -1,4 +1,5 @@
 #include <internal/facts/osx/memory_resolver.hpp>
+#include <internal/util/bsd/sysctl.hpp>
 #include <facter/execution/execution.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <mach/mach.h>
@@ -7,27 +8,24 @@
 using namespace std;
 using namespace facter::execution;
 using namespace facter::util;
+using namespace facter::util::bsd;
 
 namespace facter { namespace facts { namespace osx {
 
     memory_resolver::data memory_resolver::collect_data(collection& facts)
     {
         data result;
+        sysctl_snapshot snapshot;
 
         // Get the total memory size
-        int mib[] = { CTL_HW, HW_MEMSIZE };
-        size_t size = sizeof(result.mem_total);
-        if (sysctl(mib, sizeof(mib) / sizeof(mib[0]), &result.mem_total, &size, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctl failed: %1% (%2%): total memory size is not available.", strerror(errno), errno);
+        if (!snapshot.get_integer("hw.memsize", result.mem_total)) {
+            LOG_DEBUG("total memory size is not available.");
         }
 
         // Get the system page size
-        mib[0] = CTL_HW;
-        mib[1] = HW_PAGESIZE;
-        uint32_t page_size = 0;
-        size = sizeof(page_size);
-        if (sysctl(mib, sizeof(mib) / sizeof(mib[0]), &page_size, &size, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctl failed: %1% (%2%): system page size is unknown.", strerror(errno), errno);
+        uint64_t page_size = 0;
+        if (!snapshot.get_integer("hw.pagesize", page_size)) {
+            LOG_DEBUG("system page size is unknown.");
         } else {
             // Get the VM stats for free memory
             vm_statistics64 vm_stats;
@@ -44,12 +42,9 @@ namespace facter { namespace facts { namespace osx {
         }
 
         // Get the swap usage statistics
-        mib[0] = CTL_VM;
-        mib[1] = VM_SWAPUSAGE;
         xsw_usage swap_usage;
-        size = sizeof(swap_usage);
-        if (sysctl(mib, sizeof(mib) / sizeof(mib[0]), &swap_usage, &size, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctl failed: %1% (%2%): swap data is not available.", strerror(errno), errno);
+        if (!snapshot.get_struct("vm.swapusage", swap_usage)) {
+            LOG_DEBUG("swap data is not available.");
         } else {
             result.swap_free = swap_usage.xsu_total - swap_usage.xsu_used;
             result.swap_total = swap_usage.xsu_total;
@@ -2,13 +2,19 @@
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
 #include <facter/facts/scalar_value.hpp>
-#include <facter/execution/execution.hpp>
+#include <internal/util/osx/scoped_cftype.hpp>
+#include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <SystemConfiguration/SystemConfiguration.h>
+#include <sys/sysctl.h>
 #include <net/if_dl.h>
 #include <net/if.h>
+#include <net/route.h>
+#include <netinet/in.h>
 
 using namespace std;
-using namespace facter::execution;
+using namespace facter::util::osx;
 
 namespace facter { namespace facts { namespace osx {
 
@@ -39,33 +45,114 @@ namespace facter { namespace facts { namespace osx {
 
     string networking_resolver::get_primary_interface() const
     {
-        string interface;
-        execution::each_line("route", { "-n", "get",  "default" }, [&interface](string& line){
-            boost::trim(line);
-            if (boost::starts_with(line, "interface: ")) {
-                interface = line.substr(11);
-                boost::trim(interface);
-                return false;
+        // Dump the IPv4 gateway routes from the routing table rather than running route(8)
+        int mib[] = { CTL_NET, PF_ROUTE, 0, AF_INET, NET_RT_FLAGS, RTF_GATEWAY };
+        size_t length = 0;
+        if (sysctl(mib, sizeof(mib) / sizeof(mib[0]), nullptr, &length, nullptr, 0) == -1) {
+            LOG_DEBUG("sysctl failed: %1% (%2%): the default route is unavailable.", strerror(errno), errno);
+            return {};
+        }
+        vector<char> buffer(length);
+        if (sysctl(mib, sizeof(mib) / sizeof(mib[0]), buffer.data(), &length, nullptr, 0) == -1) {
+            LOG_DEBUG("sysctl failed: %1% (%2%): the default route is unavailable.", strerror(errno), errno);
+            return {};
+        }
+
+        for (size_t offset = 0; offset + sizeof(rt_msghdr) <= length;) {
+            auto header = reinterpret_cast<rt_msghdr const*>(buffer.data() + offset);
+            if (header->rtm_msglen == 0) {
+                break;
+            }
+            offset += header->rtm_msglen;
+
+            // Scoped default routes are bound to their interfaces; the unscoped one is the primary route
+            if (!(header->rtm_flags & RTF_UP) || (header->rtm_flags & RTF_IFSCOPE) || !(header->rtm_addrs & RTA_DST)) {
+                continue;
             }
-            return true;
-        });
-        return interface;
+
+            // The destination is the first address after the header
+            auto destination = reinterpret_cast<sockaddr_in const*>(header + 1);
+            if (destination->sin_family != AF_INET || destination->sin_addr.s_addr != INADDR_ANY) {
+                continue;
+            }
+
+            char name[IF_NAMESIZE] = {};
+            if (if_indextoname(header->rtm_index, name)) {
+                return name;
+            }
+        }
+        return {};
     }
 
     map<string, string> networking_resolver::find_dhcp_servers() const
     {
-        // We don't parse dhclient information on OSX
-        return map<string, string>();
+        // Read the state that configd keeps for each network service rather than running ipconfig for each interface
+        map<string, string> servers;
+        scoped_cftype store(SCDynamicStoreCreate(kCFAllocatorDefault, CFSTR("facter"), nullptr, nullptr));
+        auto store_ref = store.as<SCDynamicStoreRef>(SCDynamicStoreGetTypeID());
+        if (!store_ref) {
+            LOG_DEBUG("SCDynamicStoreCreate failed: DHCP servers are unavailable.");
+            return servers;
+        }
+
+        CFStringRef patterns[] = {
+            CFSTR("State:/Network/Service/[^/]+/IPv4"),
+            CFSTR("State:/Network/Service/[^/]+/DHCP"),
+        };
+        scoped_cftype pattern_list(CFArrayCreate(kCFAllocatorDefault, reinterpret_cast<void const**>(patterns), 2, &kCFTypeArrayCallBacks));
+        scoped_cftype state(SCDynamicStoreCopyMultiple(store_ref, nullptr, pattern_list.as<CFArrayRef>(CFArrayGetTypeID())));
+        auto entries = state.as<CFDictionaryRef>(CFDictionaryGetTypeID());
+        if (!entries) {
+            return servers;
+        }
+
+        // Match each service's DHCP server identifier (option 54) to the interface of the service
+        CFIndex count = CFDictionaryGetCount(entries);
+        vector<void const*> keys(count);
+        vector<void const*> values(count);
+        CFDictionaryGetKeysAndValues(entries, keys.data(), values.data());
+
+        map<string, string> interfaces;
+        map<string, string> identifiers;
+        for (CFIndex i = 0; i < count; ++i) {
+            if (CFGetTypeID(keys[i]) != CFStringGetTypeID() || CFGetTypeID(values[i]) != CFDictionaryGetTypeID()) {
+                continue;
+            }
+            string key = to_utf8(static_cast<CFStringRef>(keys[i]));
+            auto pos = key.find_last_of('/');
+            if (pos == string::npos) {
+                continue;
+            }
+            string service = key.substr(0, pos);
+            auto entry = static_cast<CFDictionaryRef>(values[i]);
+
+            if (boost::ends_with(key, "/IPv4")) {
+                auto name = CFDictionaryGetValue(entry, CFSTR("InterfaceName"));
+                if (name && CFGetTypeID(name) == CFStringGetTypeID()) {
+                    interfaces.emplace(service, to_utf8(static_cast<CFStringRef>(name)));
+                }
+            } else {
+                auto option = CFDictionaryGetValue(entry, CFSTR("Option_54"));
+                if (option && CFGetTypeID(option) == CFDataGetTypeID() && CFDataGetLength(static_cast<CFDataRef>(option)) == 4) {
+                    auto bytes = CFDataGetBytePtr(static_cast<CFDataRef>(option));
+                    identifiers.emplace(service, (boost::format("%1%.%2%.%3%.%4%") % +bytes[0] % +bytes[1] % +bytes[2] % +bytes[3]).str());
+                }
+            }
+        }
+
+        for (auto& identifier : identifiers) {
+            auto it = interfaces.find(identifier.first);
+            if (it != interfaces.end()) {
+                servers.emplace(it->second, move(identifier.second));
+            }
+        }
+        return servers;
     }
 
-    string networking_resolver::find_dhcp_server(string const& interface) const
+    map<string, string> networking_resolver::find_dhcp_servers(vector<string> const& interfaces) const
     {
-        // Use ipconfig to get the server identifier
-        auto result = execute("ipconfig", { "getoption", interface, "server_identifier" });
-        if (!result.first) {
-            return {};
-        }
-        return result.second;
+        // Every DHCP server known to configd was already found
+        return {};
     }
 
 }}}  // namespace facter::facts::osx
@@ -1,9 +1,10 @@
 #include <internal/facts/osx/processor_resolver.hpp>
+#include <internal/util/bsd/sysctl.hpp>
 #include <leatherman/logging/logging.hpp>
-#include <sys/types.h>
-#include <sys/sysctl.h>
+#include <mach/machine.h>
 
 using namespace std;
+using namespace facter::util::bsd;
 
 namespace facter { namespace facts { namespace osx {
 
@@ -11,42 +12,56 @@ namespace facter { namespace facts { namespace osx {
     {
         auto result = posix::processor_resolver::collect_data(facts);
 
+        sysctl_snapshot snapshot;
+        uint64_t value = 0;
+
+        // "uname -p" prints the name of the processor family rather than the machine (e.g. i386 on x86_64)
+        if (snapshot.get_integer("hw.cputype", value)) {
+            switch (static_cast<cpu_type_t>(value) & ~CPU_ARCH_MASK) {
+                case CPU_TYPE_X86:
+                    result.isa = "i386";
+                    break;
+                case CPU_TYPE_ARM:
+                    result.isa = "arm";
+                    break;
+                case CPU_TYPE_POWERPC:
+                    result.isa = "powerpc";
+                    break;
+                default:
+                    break;
+            }
+        }
+
         // Get the logical count of processors
-        size_t size = sizeof(result.logical_count);
-        if (sysctlbyname("hw.logicalcpu_max", &result.logical_count, &size, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctlbyname failed: logical processor count is unavailable.", strerror(errno), errno);
+        if (snapshot.get_integer("hw.logicalcpu_max", value)) {
+            result.logical_count = static_cast<int>(value);
+        } else {
+            LOG_DEBUG("logical processor count is unavailable.");
         }
 
         // Get the physical count of processors
-        size = sizeof(result.physical_count);
-        if (sysctlbyname("hw.physicalcpu_max", &result.physical_count, &size, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctlbyname failed: %1% (%2%): physical processor count is unavailable.", strerror(errno), errno);
+        if (snapshot.get_integer("hw.physicalcpu_max", value)) {
+            result.physical_count = static_cast<int>(value);
+        } else {
+            LOG_DEBUG("physical processor count is unavailable.");
         }
 
         // For each logical processor, collect the model name
         if (result.logical_count > 0) {
             // Note: we're using the same description string for all logical processors
-            vector<char> buffer(256);
-
-            while (true) {
-                size_t size = buffer.size();
-                if (sysctlbyname("machdep.cpu.brand_string", buffer.data(), &size, nullptr, 0) == 0) {
-                    buffer.resize(size + 1);
-                    result.models.resize(result.logical_count, buffer.data());
-                    break;
-                }
-                if (errno != ENOMEM) {
-                    LOG_DEBUG("sysctlbyname failed: %1% (%2%): processor models are unavailable.", strerror(errno), errno);
-                    break;
-                }
-                buffer.resize(buffer.size() * 2);
+            string model;
+            if (snapshot.get_string("machdep.cpu.brand_string", model)) {
+                result.models.resize(result.logical_count, model);
+            } else {
+                LOG_DEBUG("processor models are unavailable.");
             }
         }
 
         // Set the speed
-        size = sizeof(result.speed);
-        if (sysctlbyname("hw.cpufrequency_max", &result.speed, &size, nullptr, 0) == -1) {
-            LOG_DEBUG("sysctlbyname failed: %1% (%2%): processor speed is unavailable.", strerror(errno), errno);
+        if (snapshot.get_integer("hw.cpufrequency_max", value)) {
+            result.speed = static_cast<int64_t>(value);
+        } else {
+            LOG_DEBUG("processor speed is unavailable.");
         }
 
         return result;
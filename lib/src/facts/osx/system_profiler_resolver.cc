@@ -1,44 +1,216 @@
 #include <internal/facts/osx/system_profiler_resolver.hpp>
+#include <internal/util/bsd/sysctl.hpp>
+#include <internal/util/osx/property_list.hpp>
+#include <internal/util/osx/scoped_cftype.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
 #include <facter/execution/execution.hpp>
+#include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <IOKit/IOKitLib.h>
+#include <SystemConfiguration/SystemConfiguration.h>
+#include <sys/sysctl.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <ctime>
 #include <map>
+#include <set>
+#include <tuple>
 #include <functional>
 
 using namespace std;
 using namespace facter::facts;
 using namespace facter::execution;
+using namespace facter::util::bsd;
+using namespace facter::util::osx;
 
 namespace facter { namespace facts { namespace osx {
 
+    static string format_size(uint64_t size)
+    {
+        // Format sizes the way system_profiler does (e.g. "256 KB" or "16 GB")
+        static char const* units[] = { "KB", "MB", "GB", "TB" };
+        uint64_t unit = 1024;
+        size_t index = 0;
+        while (index < sizeof(units) / sizeof(units[0]) - 1 && size >= unit * 1024 && size % (unit * 1024) == 0) {
+            unit *= 1024;
+            ++index;
+        }
+        return (boost::format("%1% %2%") % (size / unit) % units[index]).str();
+    }
+
+    static string format_speed(uint64_t hz)
+    {
+        // Format speeds the way system_profiler does (e.g. "2.3 GHz" or "800 MHz")
+        string speed;
+        if (hz >= 1000000000) {
+            speed = (boost::format("%.2f") % (hz / 1000000000.0)).str();
+            boost::trim_right_if(speed, boost::is_any_of("0"));
+            boost::trim_right_if(speed, boost::is_any_of("."));
+            return speed + " GHz";
+        }
+        return (boost::format("%1% MHz") % (hz / 1000000)).str();
+    }
+
+    static string get_uptime(sysctl_snapshot& snapshot)
+    {
+        timeval boot_time;
+        if (!snapshot.get_struct("kern.boottime", boot_time)) {
+            return {};
+        }
+        int64_t minutes = (time(nullptr) - boot_time.tv_sec) / 60;
+        int64_t days = minutes / (60 * 24);
+        string uptime = (boost::format("%1%:%2$02d") % ((minutes / 60) % 24) % (minutes % 60)).str();
+        if (days > 0) {
+            uptime = (boost::format("%1% %2% %3%") % days % (days == 1 ? "day" : "days") % uptime).str();
+        }
+        return uptime;
+    }
+
+    static string get_user_name()
+    {
+        passwd* user = getpwuid(geteuid());
+        if (!user) {
+            return {};
+        }
+        string name = user->pw_gecos ? user->pw_gecos : "";
+        return name.empty() ? user->pw_name : name + " (" + user->pw_name + ")";
+    }
+
+    static string get_secure_virtual_memory(sysctl_snapshot& snapshot)
+    {
+        xsw_usage usage;
+        if (!snapshot.get_struct("vm.swapusage", usage)) {
+            return {};
+        }
+        return usage.xsu_encrypted ? "Enabled" : "Disabled";
+    }
+
+    static string get_registry_string(char const* path, CFStringRef key)
+    {
+        io_registry_entry_t entry = IORegistryEntryFromPath(kIOMasterPortDefault, path);
+        if (!entry) {
+            return {};
+        }
+        scoped_cftype property(IORegistryEntryCreateCFProperty(entry, key, kCFAllocatorDefault, 0));
+        IOObjectRelease(entry);
+
+        // Some properties are stored as NUL-terminated data rather than strings
+        auto data = property.as<CFDataRef>(CFDataGetTypeID());
+        if (data) {
+            string value(reinterpret_cast<char const*>(CFDataGetBytePtr(data)), CFDataGetLength(data));
+            return value.substr(0, value.find('\0'));
+        }
+        return to_utf8(property.as<CFStringRef>(CFStringGetTypeID()));
+    }
+
+    static string get_system_version()
+    {
+        auto version = read_property_list("/System/Library/CoreServices/SystemVersion.plist");
+        string const& name = version["ProductName"];
+        string const& number = version["ProductVersion"];
+        string const& build = version["ProductBuildVersion"];
+        if (name.empty() || number.empty()) {
+            return {};
+        }
+        return name + " " + number + (build.empty() ? "" : " (" + build + ")");
+    }
+
+    static string get_computer_name()
+    {
+        scoped_cftype name(SCDynamicStoreCopyComputerName(nullptr, nullptr));
+        return to_utf8(name.as<CFStringRef>(CFStringGetTypeID()));
+    }
+
     system_profiler_resolver::data system_profiler_resolver::collect_data(collection& facts)
     {
-        static map<string, function<string&(data&)>> data_map = {
-            { "Boot Mode",              [](data& d) -> string& { return d.boot_mode; } },
-            { "Boot ROM Version",       [](data& d) -> string& { return d.boot_rom_version; } },
-            { "Boot Volume",            [](data& d) -> string& { return d.boot_volume; } },
-            { "Processor Name",         [](data& d) -> string& { return d.processor_name; } },
-            { "Processor Speed",        [](data& d) -> string& { return d.processor_speed; } },
-            { "Kernel Version",         [](data& d) -> string& { return d.kernel_version; } },
-            { "L2 Cache (per Core)",    [](data& d) -> string& { return d.l2_cache_per_core; } },
-            { "L3 Cache",               [](data& d) -> string& { return d.l3_cache; } },
-            { "Computer Name",          [](data& d) -> string& { return d.computer_name; } },
-            { "Model Identifier",       [](data& d) -> string& { return d.model_identifier; } },
-            { "Model Name",             [](data& d) -> string& { return d.model_name; } },
-            { "Total Number of Cores",  [](data& d) -> string& { return d.cores; } },
-            { "System Version",         [](data& d) -> string& { return d.system_version; } },
-            { "Number of Processors",   [](data& d) -> string& { return d.processors; } },
-            { "Memory",                 [](data& d) -> string& { return d.memory; } },
-            { "Hardware UUID",          [](data& d) -> string& { return d.hardware_uuid; } },
-            { "Secure Virtual Memory",  [](data& d) -> string& { return d.secure_virtual_memory; } },
-            { "Serial Number (system)", [](data& d) -> string& { return d.serial_number; } },
-            { "SMC Version (system)",   [](data& d) -> string& { return d.smc_version; } },
-            { "Time since boot",        [](data& d) -> string& { return d.uptime; } },
-            { "User Name",              [](data& d) -> string& { return d.username; } }
+        data result;
+
+        // Read what is available natively; system_profiler can take seconds to run
+        sysctl_snapshot snapshot;
+        uint64_t number = 0;
+        if (snapshot.get_integer("kern.safeboot", number)) {
+            result.boot_mode = number ? "Safe" : "Normal";
+        }
+        result.boot_rom_version = get_registry_string("IODeviceTree:/rom", CFSTR("version"));
+        if (snapshot.get_integer("hw.cpufrequency", number) && number > 0) {
+            result.processor_speed = format_speed(number);
+        }
+        string kernel;
+        string release;
+        if (snapshot.get_string("kern.ostype", kernel) && snapshot.get_string("kern.osrelease", release)) {
+            result.kernel_version = kernel + " " + release;
+        }
+        if (snapshot.get_integer("hw.l2cachesize", number) && number > 0) {
+            result.l2_cache_per_core = format_size(number);
+        }
+        if (snapshot.get_integer("hw.l3cachesize", number) && number > 0) {
+            result.l3_cache = format_size(number);
+        }
+        result.computer_name = get_computer_name();
+        snapshot.get_string("hw.model", result.model_identifier);
+        if (snapshot.get_integer("hw.physicalcpu", number)) {
+            result.cores = to_string(number);
+        }
+        result.system_version = get_system_version();
+        if (snapshot.get_integer("hw.packages", number)) {
+            result.processors = to_string(number);
+        }
+        if (snapshot.get_integer("hw.memsize", number)) {
+            result.memory = format_size(number);
+        }
+        result.hardware_uuid = get_registry_string("IOService:/", CFSTR(kIOPlatformUUIDKey));
+        result.secure_virtual_memory = get_secure_virtual_memory(snapshot);
+        result.serial_number = get_registry_string("IOService:/", CFSTR(kIOPlatformSerialNumberKey));
+        result.uptime = get_uptime(snapshot);
+        result.username = get_user_name();
+
+        // The label, data type, fact, structured fact key, and data of each system_profiler field
+        static vector<tuple<string, string, string, string, function<string&(data&)>>> const fields = {
+            make_tuple("Boot Mode",              "SPSoftwareDataType", string(fact::sp_boot_mode),               "boot_mode",               [](data& d) -> string& { return d.boot_mode; }),
+            make_tuple("Boot ROM Version",       "SPHardwareDataType", string(fact::sp_boot_rom_version),        "boot_rom_version",        [](data& d) -> string& { return d.boot_rom_version; }),
+            make_tuple("Boot Volume",            "SPSoftwareDataType", string(fact::sp_boot_volume),             "boot_volume",             [](data& d) -> string& { return d.boot_volume; }),
+            make_tuple("Processor Name",         "SPHardwareDataType", string(fact::sp_cpu_type),                "processor_name",          [](data& d) -> string& { return d.processor_name; }),
+            make_tuple("Processor Speed",        "SPHardwareDataType", string(fact::sp_current_processor_speed), "processor_speed",         [](data& d) -> string& { return d.processor_speed; }),
+            make_tuple("Kernel Version",         "SPSoftwareDataType", string(fact::sp_kernel_version),          "kernel_version",          [](data& d) -> string& { return d.kernel_version; }),
+            make_tuple("L2 Cache (per Core)",    "SPHardwareDataType", string(fact::sp_l2_cache_core),           "l2_cache_per_core",       [](data& d) -> string& { return d.l2_cache_per_core; }),
+            make_tuple("L3 Cache",               "SPHardwareDataType", string(fact::sp_l3_cache),                "l3_cache",                [](data& d) -> string& { return d.l3_cache; }),
+            make_tuple("Computer Name",          "SPSoftwareDataType", string(fact::sp_local_host_name),         "computer_name",           [](data& d) -> string& { return d.computer_name; }),
+            make_tuple("Model Identifier",       "SPHardwareDataType", string(fact::sp_machine_model),           "model_identifier",        [](data& d) -> string& { return d.model_identifier; }),
+            make_tuple("Model Name",             "SPHardwareDataType", string(fact::sp_machine_name),            "model_name",              [](data& d) -> string& { return d.model_name; }),
+            make_tuple("Total Number of Cores",  "SPHardwareDataType", string(fact::sp_number_processors),       "cores",                   [](data& d) -> string& { return d.cores; }),
+            make_tuple("System Version",         "SPSoftwareDataType", string(fact::sp_os_version),              "system_version",          [](data& d) -> string& { return d.system_version; }),
+            make_tuple("Number of Processors",   "SPHardwareDataType", string(fact::sp_packages),                "processors",              [](data& d) -> string& { return d.processors; }),
+            make_tuple("Memory",                 "SPHardwareDataType", string(fact::sp_physical_memory),         "memory",                  [](data& d) -> string& { return d.memory; }),
+            make_tuple("Hardware UUID",          "SPHardwareDataType", string(fact::sp_platform_uuid),           "hardware_uuid",           [](data& d) -> string& { return d.hardware_uuid; }),
+            make_tuple("Secure Virtual Memory",  "SPSoftwareDataType", string(fact::sp_secure_vm),               "secure_virtual_memory",   [](data& d) -> string& { return d.secure_virtual_memory; }),
+            make_tuple("Serial Number (system)", "SPHardwareDataType", string(fact::sp_serial_number),           "serial_number",           [](data& d) -> string& { return d.serial_number; }),
+            make_tuple("SMC Version (system)",   "SPHardwareDataType", string(fact::sp_smc_version_system),      "smc_version",             [](data& d) -> string& { return d.smc_version; }),
+            make_tuple("Time since boot",        "SPSoftwareDataType", string(fact::sp_uptime),                  "uptime",                  [](data& d) -> string& { return d.uptime; }),
+            make_tuple("User Name",              "SPSoftwareDataType", string(fact::sp_user_name),               "username",                [](data& d) -> string& { return d.username; }),
         };
 
-        data result;
+        // Fall back to system_profiler only for the data types of queried fields without a native source
+        map<string, function<string&(data&)>> missing;
+        set<string> data_types;
+        for (auto const& field : fields) {
+            if (!get<4>(field)(result).empty()) {
+                continue;
+            }
+            if (!facts.is_queried(get<2>(field)) && !facts.is_queried(string(fact::system_profiler) + "." + get<3>(field))) {
+                continue;
+            }
+            missing.emplace(get<0>(field), get<4>(field));
+            data_types.insert(get<1>(field));
+        }
+        if (data_types.empty()) {
+            return result;
+        }
+
+        LOG_DEBUG("running system_profiler for %1% fields without a native source.", missing.size());
         size_t count = 0;
-        execution::each_line("/usr/sbin/system_profiler", { "SPSoftwareDataType", "SPHardwareDataType" }, [&](string& line) {
+        execution::each_line("/usr/sbin/system_profiler", vector<string>(data_types.begin(), data_types.end()), [&](string& line) {
             // Split at the first ':'
             auto pos = line.find(':');
             if (pos == string::npos) {
@@ -46,18 +218,18 @@ namespace facter { namespace facts { namespace osx {
             }
             string key = line.substr(0, pos);
             boost::trim(key);
-            string value = line.substr(pos + 1);
-            boost::trim(value);
 
             // Lookup the data based on the "key"
-            auto it = data_map.find(key);
-            if (it == data_map.end()) {
+            auto it = missing.find(key);
+            if (it == missing.end()) {
                 return true;
             }
+            string value = line.substr(pos + 1);
+            boost::trim(value);
             it->second(result) = move(value);
 
-            // Continue only if we haven't collected all the data
-            return ++count < data_map.size();
+            // Continue only if we haven't collected all the missing data
+            return ++count < missing.size();
         });
 
         return result;
@@ -3,15 +3,51 @@
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
 #include <facter/facts/vm.hpp>
-#include <facter/execution/execution.hpp>
+#include <internal/util/osx/scoped_cftype.hpp>
+#include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <IOKit/IOKitLib.h>
 
 using namespace std;
 using namespace facter::facts;
-using namespace facter::execution;
+using namespace facter::util::osx;
 
 namespace facter { namespace facts { namespace osx {
 
+    virtualization_resolver::virtualization_resolver() :
+        resolvers::virtualization_resolver(
+            {
+                fact::sp_machine_model,
+                fact::sp_boot_rom_version,
+            })
+    {
+    }
+
+    static bool has_pci_subsystem_vendor(uint32_t vendor)
+    {
+        // Look through the PCI devices in the I/O registry rather than running system_profiler
+        io_iterator_t devices = 0;
+        if (IOServiceGetMatchingServices(kIOMasterPortDefault, IOServiceMatching("IOPCIDevice"), &devices) != KERN_SUCCESS) {
+            LOG_DEBUG("IOServiceGetMatchingServices failed: PCI devices are unavailable.");
+            return false;
+        }
+
+        bool found = false;
+        io_object_t device;
+        while (!found && (device = IOIteratorNext(devices))) {
+            // The vendor is stored as 32-bit little-endian data
+            scoped_cftype property(IORegistryEntryCreateCFProperty(device, CFSTR("subsystem-vendor-id"), kCFAllocatorDefault, 0));
+            IOObjectRelease(device);
+            auto data = property.as<CFDataRef>(CFDataGetTypeID());
+            if (data && CFDataGetLength(data) >= 2) {
+                auto bytes = CFDataGetBytePtr(data);
+                found = (static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8)) == vendor;
+            }
+        }
+        IOObjectRelease(devices);
+        return found;
+    }
+
     string virtualization_resolver::get_hypervisor(collection& facts)
     {
         // Check for VMWare
@@ -31,16 +67,10 @@ namespace facter { namespace facts { namespace osx {
         }
 
         // Check for Parallels
-        string value;
-        execution::each_line("/usr/sbin/system_profiler", { "SPEthernetDataType" }, [&](string& line) {
-            boost::trim(line);
-            if (line == "Subsystem Vendor ID: 0x1ab8") {
-                value = vm::parallels;
-                return false;
-            }
-            return true;
-        });
-        return value;
+        if (has_pci_subsystem_vendor(0x1ab8)) {
+            return vm::parallels;
+        }
+        return {};
     }
 
 }}}  // namespace facter::facts::osx
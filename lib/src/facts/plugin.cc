@@ -0,0 +1,110 @@
+#include <facter/facts/plugin.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/util/directory.hpp>
+#include <facter/version.h>
+#include <internal/util/dynamic_library.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <map>
+
+using namespace std;
+using namespace facter::util;
+namespace fs = boost::filesystem;
+
+namespace facter { namespace facts {
+
+    // Plugins are loaded once per process and never unloaded: their resolvers, and values of types they define,
+    // can outlive the collection they were added to (e.g. in a daemon's snapshot)
+    static boost::mutex plugins_mutex;
+
+    static map<string, dynamic_library>& loaded_plugins()
+    {
+        // Never destroyed, so that plugins are not unloaded while static objects are still being destroyed
+        static auto plugins = new map<string, dynamic_library>();
+        return *plugins;
+    }
+
+    static bool is_plugin_file(string const& name)
+    {
+        auto extension = fs::path(name).extension().string();
+#if defined(_WIN32)
+        return extension == ".dll";
+#elif defined(__APPLE__)
+        return extension == ".dylib" || extension == ".so";
+#else
+        return extension == ".so";
+#endif
+    }
+
+    static plugin_factory load_plugin(string const& path)
+    {
+        boost::lock_guard<boost::mutex> lock(plugins_mutex);
+        auto& plugins = loaded_plugins();
+        auto it = plugins.find(path);
+        if (it == plugins.end()) {
+            dynamic_library library;
+            if (!library.load(path)) {
+                LOG_WARNING("plugin %1% could not be loaded.", path);
+                return nullptr;
+            }
+            auto version = reinterpret_cast<char const* (*)()>(library.find_symbol("facter_plugin_version"));
+            if (!version || !library.find_symbol("facter_plugin_resolvers")) {
+                LOG_WARNING("%1% is not a fact plugin: it was not built with LIBFACTER_PLUGIN.", path);
+                return nullptr;
+            }
+            // Resolvers are C++ objects shared with libfacter, so the plugin must be built against this version
+            string plugin_version = version();
+            if (plugin_version != LIBFACTER_VERSION) {
+                LOG_WARNING("plugin %1% was built for facter %2% and cannot be loaded by facter %3%.", path, plugin_version, LIBFACTER_VERSION);
+                return nullptr;
+            }
+            it = plugins.emplace(path, move(library)).first;
+        }
+        return reinterpret_cast<plugin_factory>(it->second.find_symbol("facter_plugin_resolvers"));
+    }
+
+    void collection::add_plugins(vector<string> const& directories)
+    {
+        for (auto const& dir : directories) {
+            boost::system::error_code ec;
+            if (!fs::is_directory(dir, ec)) {
+                LOG_WARNING("skipping fact plugins for \"%1%\": it is not a directory.", dir);
+                continue;
+            }
+
+            // Load the plugins in name order so that the same resolver wins when plugins define the same fact
+            vector<string> paths;
+            directory::each_file(dir, [&](string const& path) {
+                if (is_plugin_file(path)) {
+                    paths.push_back(path);
+                }
+                return true;
+            });
+            sort(paths.begin(), paths.end());
+
+            for (auto const& path : paths) {
+                auto factory = load_plugin(path);
+                if (!factory) {
+                    continue;
+                }
+                vector<shared_ptr<resolver>> resolvers;
+                try {
+                    factory(resolvers);
+                } catch (exception& ex) {
+                    LOG_ERROR("plugin %1% failed to create its resolvers: %2%", path, ex.what());
+                    continue;
+                }
+                LOG_DEBUG("adding %1% resolvers from plugin %2%.", resolvers.size(), path);
+                for (auto const& res : resolvers) {
+                    if (res) {
+                        add(res);
+                    }
+                }
+            }
+        }
+    }
+
+}}  // namespace facter::facts
@@ -1,62 +1,202 @@
 #include <internal/facts/posix/identity_resolver.hpp>
+#include <internal/util/proc_file.hpp>
+#include <internal/util/scoped_deadline.hpp>
 #include <leatherman/logging/logging.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
 #include <sys/types.h>
 #include <pwd.h>
 #include <grp.h>
+#include <unistd.h>
 
 using namespace std;
+using namespace facter::util;
 
 namespace facter { namespace facts { namespace posix {
 
-    identity_resolver::data identity_resolver::collect_data(collection& facts)
+    // Directory services (e.g. LDAP through SSSD) can take seconds to answer; don't wait longer than this for a name
+    static chrono::milliseconds const lookup_timeout(1000);
+
+    struct pending_lookup
     {
-        data result;
+        pending_lookup() :
+            done(false),
+            found(false)
+        {
+        }
 
-        vector<char> buffer;
-        long buffer_size = sysconf(_SC_GETPW_R_SIZE_MAX);
+        boost::mutex mutex;
+        boost::condition_variable completed;
+        bool done;
+        bool found;
+        string name;
+    };
 
-        if (buffer_size == -1) {
-            buffer.resize(1024);
-        } else {
-            buffer.resize(buffer_size);
-        }
+    // The names found by earlier lookups and the lookups still blocked on an abandoned worker thread, keyed by e.g. "user 1000"
+    static boost::mutex lookup_mutex;
+    static map<string, string> known_names;
+    static set<string> hung_lookups;
 
-        uid_t uid = geteuid();
-        struct passwd pwd;
-        struct passwd *pwd_ptr;
-        int err = getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &pwd_ptr);
+    static vector<char> make_buffer(int name)
+    {
+        long size = sysconf(name);
+        return vector<char>(size == -1 ? 1024 : static_cast<size_t>(size));
+    }
+
+    // Finds the name of an id in a local database (e.g. /etc/passwd), whose lines are "name:password:id:..."
+    static bool find_local_name(string const& path, int64_t id, string& name)
+    {
+        bool found = false;
+        proc_file database(path);
+        database.each_line([&](boost::string_ref line) {
+            // Skip comments and NIS compatibility entries (e.g. "+@admins"), which must be looked up
+            if (line.empty() || line.front() == '#' || line.front() == '+' || line.front() == '-') {
+                return true;
+            }
+            auto name_end = line.find(':');
+            if (name_end == boost::string_ref::npos) {
+                return true;
+            }
+            auto fields = line.substr(name_end + 1);
+            auto password_end = fields.find(':');
+            if (password_end == boost::string_ref::npos) {
+                return true;
+            }
+            fields = fields.substr(password_end + 1);
+            uint64_t value = 0;
+            if (!proc_file::to_uint64(fields, value) || static_cast<int64_t>(value) != id) {
+                return true;
+            }
+            name = line.substr(0, name_end).to_string();
+            found = true;
+            return false;
+        });
+        return found;
+    }
+
+    // Looks up a name with the system's name service, waiting at most the lookup timeout; the last known name is used if it takes longer
+    static bool lookup_name(string const& key, function<bool(string&)> const& lookup, string& name)
+    {
+        auto remember = [&](bool hung) -> bool {
+            boost::lock_guard<boost::mutex> lock(lookup_mutex);
+            if (hung) {
+                hung_lookups.insert(key);
+            }
+            auto it = known_names.find(key);
+            if (it == known_names.end()) {
+                return false;
+            }
+            name = it->second;
+            return true;
+        };
 
-        if (err != 0) {
-            LOG_WARNING("getpwuid_r failed: %1% (%2%)", strerror(err), err);
-        } else if (pwd_ptr == NULL) {
-            LOG_WARNING("effective uid %1% does not have a passwd entry.", uid);
-        } else {
-            result.user_id = static_cast<int64_t>(uid);
-            result.user_name = pwd.pw_name;
+        // Don't start another lookup while an earlier one is still blocked
+        bool hung;
+        {
+            boost::lock_guard<boost::mutex> lock(lookup_mutex);
+            hung = hung_lookups.count(key) > 0;
+        }
+        if (hung) {
+            LOG_DEBUG("the name service has not returned from an earlier lookup of %1%: using the last known name if there is one.", key);
+            return remember(false);
+        }
+
+        auto timeout = lookup_timeout;
+        if (scoped_deadline::active()) {
+            timeout = min(timeout, chrono::duration_cast<chrono::milliseconds>(scoped_deadline::remaining()));
         }
 
-        buffer_size = sysconf(_SC_GETGR_R_SIZE_MAX);
+        // The worker owns copies of everything it uses so it can outlive this call if the lookup hangs
+        auto pending = make_shared<pending_lookup>();
+        boost::thread worker([pending, key, lookup]() {
+            string result;
+            bool found = lookup(result);
+            {
+                boost::lock_guard<boost::mutex> lock(lookup_mutex);
+                hung_lookups.erase(key);
+                if (found) {
+                    known_names[key] = result;
+                }
+            }
+            {
+                boost::lock_guard<boost::mutex> lock(pending->mutex);
+                pending->done = true;
+                pending->found = found;
+                pending->name = move(result);
+            }
+            pending->completed.notify_one();
+        });
 
-        if (buffer_size == -1) {
-            buffer.resize(1024);
-        } else {
-            buffer.resize(buffer_size);
+        boost::unique_lock<boost::mutex> lock(pending->mutex);
+        if (timeout <= chrono::milliseconds::zero() ||
+            !pending->completed.wait_for(lock, boost::chrono::milliseconds(timeout.count()), [&]() { return pending->done; })) {
+            lock.unlock();
+            worker.detach();
+            LOG_WARNING("the name service did not find the name of %1% within %2%ms: using the last known name if there is one.", key, timeout.count());
+            return remember(true);
         }
+        lock.unlock();
+        worker.join();
+        if (!pending->found) {
+            return false;
+        }
+        name = move(pending->name);
+        return true;
+    }
 
-        gid_t gid = getegid();
-        struct group grp;
-        struct group *grp_ptr;
-        err = getgrgid_r(gid, &grp, buffer.data(), buffer.size(), &grp_ptr);
+    identity_resolver::data identity_resolver::collect_data(collection& facts)
+    {
+        data result;
 
-        if (err != 0) {
-            LOG_WARNING("getgrgid_r failed: %1% (%2%)", strerror(err), err);
-        } else if (grp_ptr == NULL) {
-            LOG_WARNING("effective gid %1% does not have a group entry.", gid);
-        } else {
-            result.group_id = static_cast<int64_t>(gid);
-            result.group_name = grp.gr_name;
+        // The ids are always known; only their names may be unavailable
+        uid_t uid = geteuid();
+        result.user_id = static_cast<int64_t>(uid);
+        if (!find_local_name("/etc/passwd", uid, result.user_name)) {
+            lookup_name("user " + to_string(uid), [uid](string& name) {
+                auto buffer = make_buffer(_SC_GETPW_R_SIZE_MAX);
+                struct passwd pwd;
+                struct passwd *pwd_ptr;
+                int err = getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &pwd_ptr);
+                if (err != 0) {
+                    LOG_WARNING("getpwuid_r failed: %1% (%2%)", strerror(err), err);
+                    return false;
+                }
+                if (pwd_ptr == NULL) {
+                    LOG_WARNING("effective uid %1% does not have a passwd entry.", uid);
+                    return false;
+                }
+                name = pwd.pw_name;
+                return true;
+            }, result.user_name);
         }
 
+        gid_t gid = getegid();
+        result.group_id = static_cast<int64_t>(gid);
+        if (!find_local_name("/etc/group", gid, result.group_name)) {
+            lookup_name("group " + to_string(gid), [gid](string& name) {
+                auto buffer = make_buffer(_SC_GETGR_R_SIZE_MAX);
+                struct group grp;
+                struct group *grp_ptr;
+                int err = getgrgid_r(gid, &grp, buffer.data(), buffer.size(), &grp_ptr);
+                if (err != 0) {
+                    LOG_WARNING("getgrgid_r failed: %1% (%2%)", strerror(err), err);
+                    return false;
+                }
+                if (grp_ptr == NULL) {
+                    LOG_WARNING("effective gid %1% does not have a group entry.", gid);
+                    return false;
+                }
+                name = grp.gr_name;
+                return true;
+            }, result.group_name);
+        }
         return result;
     }
 
@@ -0,0 +1,24 @@
+#include <internal/facts/posix/load_resolver.hpp>
+#include <cstdlib>
+#ifdef __sun
+#include <sys/loadavg.h>
+#endif
+
+using namespace std;
+
+namespace facter { namespace facts { namespace posix {
+
+    load_resolver::data load_resolver::collect_data(collection& facts)
+    {
+        data result;
+        double averages[3];
+        if (getloadavg(averages, 3) == 3) {
+            result.load_averages_available = true;
+            result.one = averages[0];
+            result.five = averages[1];
+            result.fifteen = averages[2];
+        }
+        return result;
+    }
+
+}}}  // namespace facter::facts::posix
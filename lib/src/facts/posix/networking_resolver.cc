@@ -1,12 +1,19 @@
 #include <internal/facts/posix/networking_resolver.hpp>
+#include <facter/facts/collection.hpp>
 #include <internal/util/posix/scoped_addrinfo.hpp>
-#include <facter/util/file.hpp>
+#include <internal/util/proc_file.hpp>
+#include <internal/util/scoped_deadline.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <cstring>
+#include <memory>
+#include <set>
 #include <unistd.h>
 #include <limits.h>
 #include <netinet/in.h>
-#include <arpa/inet.h>
 
 using namespace std;
 using namespace facter::util;
@@ -14,13 +21,44 @@ using namespace facter::util::posix;
 
 namespace facter { namespace facts { namespace posix {
 
+    // The result of an FQDN lookup running on a worker thread
+    struct pending_fqdn
+    {
+        pending_fqdn() :
+            done(false)
+        {
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable completed;
+        bool done;
+        string fqdn;
+    };
+
+    // The hostnames whose lookups are still blocked on an abandoned worker thread
+    static boost::mutex hung_mutex;
+    static set<string> hung_hostnames;
+
+    static string get_canonical_name(string const& hostname)
+    {
+        scoped_addrinfo info(hostname);
+        if (info.result() != 0 && info.result() != EAI_NONAME) {
+            LOG_ERROR("getaddrinfo failed: %1% (%2%): hostname may not be externally resolvable.", gai_strerror(info.result()), info.result());
+        } else if (!info || info.result() == EAI_NONAME) {
+            LOG_INFO("hostname \"%1%\" could not be resolved: hostname may not be externally resolvable.", hostname);
+        } else {
+            return static_cast<addrinfo*>(info)->ai_canonname;
+        }
+        return {};
+    }
+
     string networking_resolver::address_to_string(sockaddr const* addr, sockaddr const* mask) const
     {
         if (!addr) {
             return {};
         }
 
-        // Check for IPv4 and IPv6
+        // Check for IPv4 and IPv6; the network is computed with integer masking before the address is formatted
         if (addr->sa_family == AF_INET) {
             in_addr ip = reinterpret_cast<sockaddr_in const*>(addr)->sin_addr;
 
@@ -28,24 +66,21 @@ namespace facter { namespace facts { namespace posix {
             if (mask && mask->sa_family == addr->sa_family) {
                 ip.s_addr &= reinterpret_cast<sockaddr_in const*>(mask)->sin_addr.s_addr;
             }
-
-            char buffer[INET_ADDRSTRLEN] = {};
-            inet_ntop(AF_INET, &ip, buffer, sizeof(buffer));
-            return buffer;
+            return ipv4_to_string(reinterpret_cast<uint8_t const*>(&ip));
         } else if (addr->sa_family == AF_INET6) {
             in6_addr ip = reinterpret_cast<sockaddr_in6 const*>(addr)->sin6_addr;
 
             // Apply an IPv6 mask
             if (mask && mask->sa_family == addr->sa_family) {
-                auto mask_ptr = reinterpret_cast<sockaddr_in6 const*>(mask);
-                for (size_t i = 0; i < 16; ++i) {
-                    ip.s6_addr[i] &= mask_ptr->sin6_addr.s6_addr[i];
-                }
+                uint64_t words[2];
+                uint64_t mask_words[2];
+                memcpy(words, &ip, sizeof(words));
+                memcpy(mask_words, &reinterpret_cast<sockaddr_in6 const*>(mask)->sin6_addr, sizeof(mask_words));
+                words[0] &= mask_words[0];
+                words[1] &= mask_words[1];
+                memcpy(&ip, words, sizeof(words));
             }
-
-            char buffer[INET6_ADDRSTRLEN] = {};
-            inet_ntop(AF_INET6, &ip, buffer, sizeof(buffer));
-            return buffer;
+            return ipv6_to_string(ip.s6_addr);
         } else if (is_link_address(addr)) {
             auto link_addr = get_link_address_bytes(addr);
             if (link_addr) {
@@ -75,15 +110,8 @@ namespace facter { namespace facts { namespace posix {
         }
 
         if (!result.hostname.empty()) {
-            // Retrieve the FQDN by resolving the hostname
-            scoped_addrinfo info(result.hostname);
-            if (info.result() != 0 && info.result() != EAI_NONAME) {
-                LOG_ERROR("getaddrinfo failed: %1% (%2%): hostname may not be externally resolvable.", gai_strerror(info.result()), info.result());
-            } else if (!info || info.result() == EAI_NONAME) {
-                LOG_INFO("hostname \"%1%\" could not be resolved: hostname may not be externally resolvable.", result.hostname);
-            } else {
-                result.fqdn = static_cast<addrinfo*>(info)->ai_canonname;
-            }
+            // Retrieve the FQDN by resolving the hostname; the domain falls back to resolv.conf if DNS doesn't respond in time
+            result.fqdn = lookup_fqdn(result.hostname, facts.fqdn_timeout(), get_canonical_name);
 
             // Set the domain name if the FQDN is prefixed with the hostname
             if (boost::starts_with(result.fqdn, result.hostname + ".")) {
@@ -94,8 +122,9 @@ namespace facter { namespace facts { namespace posix {
         // If no domain, look it up based on resolv.conf
         if (result.domain.empty()) {
             string search;
-            file::each_line("/etc/resolv.conf", [&](string& line) {
-                vector<boost::iterator_range<string::iterator>> parts;
+            proc_file resolv_conf("/etc/resolv.conf");
+            vector<boost::iterator_range<char const*>> parts;
+            resolv_conf.each_line([&](boost::string_ref line) {
                 boost::split(parts, line, boost::is_space(), boost::token_compress_on);
                 if (parts.size() < 2) {
                     return true;
@@ -120,4 +149,54 @@ namespace facter { namespace facts { namespace posix {
         return result;
     }
 
+    string networking_resolver::lookup_fqdn(string const& hostname, chrono::milliseconds timeout, function<string(string const&)> const& lookup)
+    {
+        // Don't start another lookup of a hostname that is still blocked
+        {
+            boost::lock_guard<boost::mutex> lock(hung_mutex);
+            if (hung_hostnames.count(hostname)) {
+                LOG_DEBUG("hostname \"%1%\" was not resolved: an earlier lookup has not returned.", hostname);
+                return {};
+            }
+        }
+
+        if (scoped_deadline::active()) {
+            timeout = min(timeout, chrono::duration_cast<chrono::milliseconds>(scoped_deadline::remaining()));
+        }
+        if (timeout <= chrono::milliseconds::zero()) {
+            LOG_DEBUG("hostname \"%1%\" was not resolved: the deadline for resolving facts has passed.", hostname);
+            return {};
+        }
+
+        // The worker owns copies of everything it uses so it can outlive this call if the lookup hangs
+        auto pending = make_shared<pending_fqdn>();
+        boost::thread worker([pending, hostname, lookup]() {
+            auto fqdn = lookup(hostname);
+            {
+                boost::lock_guard<boost::mutex> lock(pending->mutex);
+                pending->done = true;
+                pending->fqdn = move(fqdn);
+            }
+            pending->completed.notify_one();
+
+            boost::lock_guard<boost::mutex> lock(hung_mutex);
+            hung_hostnames.erase(hostname);
+        });
+
+        boost::unique_lock<boost::mutex> lock(pending->mutex);
+        if (!pending->completed.wait_for(lock, boost::chrono::milliseconds(timeout.count()), [&]() { return pending->done; })) {
+            // getaddrinfo can't be interrupted; remember the hostname until it returns
+            {
+                boost::lock_guard<boost::mutex> hung_lock(hung_mutex);
+                hung_hostnames.insert(hostname);
+            }
+            worker.detach();
+            LOG_WARNING("hostname \"%1%\" could not be resolved within %2%ms: the domain will be taken from /etc/resolv.conf.", hostname, timeout.count());
+            return {};
+        }
+        lock.unlock();
+        worker.join();
+        return move(pending->fqdn);
+    }
+
 }}}  // namespace facter::facts::posix
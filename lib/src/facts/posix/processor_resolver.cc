@@ -1,9 +1,9 @@
 #include <internal/facts/posix/processor_resolver.hpp>
-#include <facter/execution/execution.hpp>
 #include <leatherman/logging/logging.hpp>
+#include <sys/utsname.h>
+#include <cstring>
 
 using namespace std;
-using namespace facter::execution;
 
 namespace facter { namespace facts { namespace posix {
 
@@ -11,11 +11,14 @@ namespace facter { namespace facts { namespace posix {
     {
         data result;
 
-        // Unfortunately there's no corresponding member in utsname for "processor", so we need to spawn
-        auto output = execute("uname", { "-p" });
-        if (output.first) {
-            result.isa = output.second;
+        // There's no member in utsname for the processor type that "uname -p" prints; the machine hardware name is the
+        // closest (it is what "uname -p" prints on most Linux distributions), and platforms with a better source override it
+        struct utsname name;
+        if (uname(&name) == -1) {
+            LOG_DEBUG("uname failed: %1% (%2%): processor isa is unavailable.", strerror(errno), errno);
+            return result;
         }
+        result.isa = name.machine;
         return result;
     }
 
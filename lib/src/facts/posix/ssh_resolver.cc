@@ -1,13 +1,18 @@
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
 #include <internal/facts/posix/ssh_resolver.hpp>
+#include <internal/util/scoped_root.hpp>
 #include <facter/util/file.hpp>
 #include <facter/util/string.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
 #include <tuple>
 #include <vector>
+#include <sys/stat.h>
 
 #ifdef USE_OPENSSL
 #include <internal/util/posix/scoped_bio.hpp>
@@ -23,6 +28,21 @@ namespace bs = boost::system;
 
 namespace facter { namespace facts { namespace posix {
 
+    // Key files rarely change, so a long-running process (e.g. the daemon) keeps their keys and fingerprints
+    // and only reads and hashes a file again when its identity, size, or modification time changes
+    struct cached_key
+    {
+        dev_t device;
+        ino_t inode;
+        off_t size;
+        time_t modified;
+        string key;
+        string sha1;
+        string sha256;
+    };
+    static boost::mutex cache_mutex;
+    static map<string, cached_key> key_cache;
+
     ssh_resolver::data ssh_resolver::collect_data(collection& facts)
     {
         data result;
@@ -45,12 +65,12 @@ namespace facter { namespace facts { namespace posix {
 
         // Search the directories for the fact's key file
         path key_file;
+        struct stat status;
         for (auto const& directory : search_directories) {
-            key_file = directory;
+            key_file = scoped_root::path(directory);
             key_file /= filename;
 
-            bs::error_code ec;
-            if (!is_regular_file(key_file, ec)) {
+            if (stat(key_file.c_str(), &status) != 0 || !S_ISREG(status.st_mode)) {
                 key_file.clear();
                 continue;
             }
@@ -63,6 +83,22 @@ namespace facter { namespace facts { namespace posix {
             return;
         }
 
+        // Reuse the key and fingerprints of a file that hasn't changed since it was last read
+        {
+            boost::lock_guard<boost::mutex> lock(cache_mutex);
+            auto it = key_cache.find(key_file.string());
+            if (it != key_cache.end() &&
+                it->second.device == status.st_dev &&
+                it->second.inode == status.st_ino &&
+                it->second.size == status.st_size &&
+                it->second.modified == status.st_mtime) {
+                key.key = it->second.key;
+                key.digest.sha1 = it->second.sha1;
+                key.digest.sha256 = it->second.sha256;
+                return;
+            }
+        }
+
         // Read the file's contents
         string contents = file::read(key_file.string());
         if (contents.empty()) {
@@ -108,6 +144,17 @@ namespace facter { namespace facts { namespace posix {
 #else
         LOG_INFO("facter was built without OpenSSL support: SSH fingerprint information is unavailable.");
 #endif  // USE_OPENSSL
+
+        cached_key entry;
+        entry.device = status.st_dev;
+        entry.inode = status.st_ino;
+        entry.size = status.st_size;
+        entry.modified = status.st_mtime;
+        entry.key = key.key;
+        entry.sha1 = key.digest.sha1;
+        entry.sha256 = key.digest.sha256;
+        boost::lock_guard<boost::mutex> lock(cache_mutex);
+        key_cache[key_file.string()] = move(entry);
     }
 
 }}}  // namespace facter::facts::posix
@@ -1,6 +1,8 @@
 #include <internal/facts/posix/uptime_resolver.hpp>
 #include <internal/util/regex.hpp>
 #include <facter/execution/execution.hpp>
+#include <ctime>
+#include <utmpx.h>
 
 using namespace std;
 using namespace facter::util;
@@ -43,6 +45,22 @@ namespace facter { namespace facts { namespace posix {
 
     int64_t uptime_resolver::get_uptime()
     {
+        // The boot time is recorded in the user accounting database
+        int64_t boot_time = -1;
+        setutxent();
+        while (auto entry = getutxent()) {
+            if (entry->ut_type == BOOT_TIME) {
+                boot_time = entry->ut_tv.tv_sec;
+                break;
+            }
+        }
+        endutxent();
+        if (boot_time > 0) {
+            auto now = static_cast<int64_t>(time(nullptr));
+            return now > boot_time ? now - boot_time : 0;
+        }
+
+        // Some systems (e.g. containers) don't record the boot time; fall back to parsing the output of uptime
         auto result = execute("uptime");
         if (!result.first || result.second.empty()) {
             return -1;
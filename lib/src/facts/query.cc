@@ -0,0 +1,212 @@
+#include <facter/facts/query.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/util/string.hpp>
+#include <internal/facts/writer.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <limits>
+
+using namespace std;
+using namespace facter::util;
+
+namespace facter { namespace facts {
+
+    query::query(string text) :
+        _text(move(text)),
+        _wildcard(false)
+    {
+        for (auto& name : split_query(_text)) {
+            segment seg;
+            seg.index = 0;
+            seg.integral = true;
+            // The first segment names a fact, so only later segments can be wildcards
+            seg.wildcard = !_segments.empty() && name == "*";
+            _wildcard = _wildcard || seg.wildcard;
+            int64_t index;
+            if (parse_integer(name, index) && index >= numeric_limits<int>::min() && index <= numeric_limits<int>::max()) {
+                seg.index = static_cast<int>(index);
+            } else {
+                seg.integral = false;
+            }
+            seg.name = move(name);
+            _segments.emplace_back(move(seg));
+        }
+    }
+
+    string const& query::text() const
+    {
+        return _text;
+    }
+
+    bool query::wildcard() const
+    {
+        return _wildcard;
+    }
+
+    value const* query::evaluate(function<value const*(string const&)> const& get, vector<string>* path) const
+    {
+        // First attempt to lookup a fact with the exact name of the query
+        value const* current = get(_text);
+        if (current) {
+            if (path) {
+                path->assign(1, _text);
+            }
+            return current;
+        }
+
+        if (_wildcard) {
+            vector<string> found;
+            match(nullptr, 0, found, get, [&](vector<string> const& selected, value const* val) {
+                if (path) {
+                    *path = selected;
+                }
+                current = val;
+                return false;
+            });
+            return current;
+        }
+
+        for (auto const& seg : _segments) {
+            current = lookup(current, seg, get);
+            if (!current) {
+                return nullptr;
+            }
+        }
+        if (path && current) {
+            path->clear();
+            for (auto const& seg : _segments) {
+                path->push_back(seg.name);
+            }
+        }
+        return current;
+    }
+
+    void query::each(function<value const*(string const&)> const& get, function<bool(vector<string> const&, value const*)> const& callback) const
+    {
+        if (!_wildcard) {
+            vector<string> path;
+            auto val = evaluate(get, &path);
+            if (val) {
+                callback(path, val);
+            }
+            return;
+        }
+
+        // A fact with the exact name of the query takes precedence, as it does when evaluating
+        vector<string> path;
+        auto current = get(_text);
+        if (current) {
+            path.push_back(_text);
+            callback(path, current);
+            return;
+        }
+        path.reserve(_segments.size());
+        match(nullptr, 0, path, get, callback);
+    }
+
+    string query::join(vector<string> const& path)
+    {
+        string text;
+        for (auto const& segment : path) {
+            if (!text.empty()) {
+                text += '.';
+            }
+            if (segment.find('.') == string::npos) {
+                text += segment;
+            } else {
+                text += '"';
+                text += segment;
+                text += '"';
+            }
+        }
+        return text;
+    }
+
+    bool query::match(
+        value const* current,
+        size_t index,
+        vector<string>& path,
+        function<value const*(string const&)> const& get,
+        function<bool(vector<string> const&, value const*)> const& callback) const
+    {
+        if (index == _segments.size()) {
+            return callback(path, current);
+        }
+
+        auto const& seg = _segments[index];
+        if (!seg.wildcard) {
+            auto next = lookup(current, seg, get);
+            if (!next) {
+                return true;
+            }
+            path.push_back(seg.name);
+            bool more = match(next, index + 1, path, get, callback);
+            path.pop_back();
+            return more;
+        }
+
+        bool more = true;
+        if (auto map = value_cast<map_value>(current)) {
+            map->each([&](string const& name, value const* element) {
+                path.push_back(name);
+                more = match(element, index + 1, path, get, callback);
+                path.pop_back();
+                return more;
+            });
+        } else if (auto array = value_cast<array_value>(current)) {
+            for (size_t i = 0; more && i < array->size(); ++i) {
+                auto element = (*array)[i];
+                if (!element) {
+                    continue;
+                }
+                path.push_back(to_string(i));
+                more = match(element, index + 1, path, get, callback);
+                path.pop_back();
+            }
+        }
+        return more;
+    }
+
+    value const* query::lookup(value const* current, segment const& seg, function<value const*(string const&)> const& get) const
+    {
+        if (!current) {
+            current = get(seg.name);
+            if (!current) {
+                LOG_DEBUG("fact \"%1%\" does not exist.", seg.name);
+            }
+            return current;
+        }
+
+        auto map = value_cast<map_value>(current);
+        if (map) {
+            current = (*map)[seg.name];
+            if (!current) {
+                LOG_DEBUG("cannot lookup a hash element with \"%1%\": element does not exist.", seg.name);
+            }
+            return current;
+        }
+
+        auto array = value_cast<array_value>(current);
+        if (array) {
+            if (!seg.integral) {
+                LOG_DEBUG("cannot lookup an array element with \"%1%\": expected an integral value.", seg.name);
+                return nullptr;
+            }
+            if (seg.index < 0) {
+                LOG_DEBUG("cannot lookup an array element with \"%1%\": expected a non-negative value.", seg.name);
+                return nullptr;
+            }
+            if (array->empty()) {
+                LOG_DEBUG("cannot lookup an array element with \"%1%\": the array is empty.", seg.name);
+                return nullptr;
+            }
+            if (static_cast<size_t>(seg.index) >= array->size()) {
+                LOG_DEBUG("cannot lookup an array element with \"%1%\": expected an integral value between 0 and %2% (inclusive).", seg.name, array->size() - 1);
+                return nullptr;
+            }
+            return (*array)[seg.index];
+        }
+        return nullptr;
+    }
+
+}}  // namespace facter::facts
@@ -13,13 +13,15 @@ namespace facter { namespace facts {
     {
     }
 
-    resolver::resolver(string name, vector<string> names, vector<string> const& patterns) :
+    resolver::resolver(string name, vector<string> names, vector<string> const& patterns, vector<string> dependencies) :
         _name(move(name)),
-        _names(move(names))
+        _names(move(names)),
+        _patterns(patterns),
+        _dependencies(move(dependencies))
     {
         for (auto const& pattern : patterns) {
             try {
-                _regexes.push_back(boost::regex(pattern));
+                _regexes.push_back(cached_regex(pattern));
             } catch (boost::regex_error const& ex) {
                 throw invalid_name_pattern_exception(ex.what());
             }
@@ -41,7 +43,9 @@ namespace facter { namespace facts {
         if (this != &other) {
             _name = std::move(other._name);
             _names = std::move(other._names);
+            _patterns = std::move(other._patterns);
             _regexes = std::move(other._regexes);
+            _dependencies = std::move(other._dependencies);
         }
         return *this;
     }
@@ -61,6 +65,16 @@ namespace facter { namespace facts {
         return _regexes.size() > 0;
     }
 
+    vector<string> const& resolver::patterns() const
+    {
+        return _patterns;
+    }
+
+    vector<string> const& resolver::dependencies() const
+    {
+        return _dependencies;
+    }
+
     bool resolver::is_match(string const& name) const
     {
         // Check to see if any of our regexes match
@@ -72,4 +86,14 @@ namespace facter { namespace facts {
         return false;
     }
 
+    bool resolver::is_thread_safe() const
+    {
+        return true;
+    }
+
+    bool resolver::is_expensive() const
+    {
+        return false;
+    }
+
 }}  // namespace facter::facts
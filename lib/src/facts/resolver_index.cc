@@ -0,0 +1,172 @@
+#include <internal/facts/resolver_index.hpp>
+#include <internal/facts/builtin_facts.hpp>
+#include <algorithm>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    resolver_index::resolver_index() :
+        _builtins(builtin_fact_count()),
+        _next_id(0)
+    {
+    }
+
+    void resolver_index::add(shared_ptr<resolver> const& res)
+    {
+        for (auto const& name : res->names()) {
+            auto id = builtin_fact_id(name);
+            (id == no_builtin_fact ? _names[name] : _builtins[id]).push_back(res);
+        }
+
+        if (!res->has_patterns()) {
+            return;
+        }
+
+        // Patterns are found in the order their resolvers were added, so identify them by an increasing id
+        auto id = _next_id++;
+        _ids[res.get()] = id;
+        _patterns[id] = res;
+        for (auto const& pattern : res->patterns()) {
+            auto& resolvers = find_node(anchored_prefix(pattern), true)->resolvers;
+            if (std::find(resolvers.begin(), resolvers.end(), id) == resolvers.end()) {
+                resolvers.push_back(id);
+            }
+        }
+    }
+
+    void resolver_index::remove(shared_ptr<resolver> const& res)
+    {
+        for (auto const& name : res->names()) {
+            auto id = builtin_fact_id(name);
+            if (id != no_builtin_fact) {
+                auto& resolvers = _builtins[id];
+                resolvers.erase(std::remove(resolvers.begin(), resolvers.end(), res), resolvers.end());
+                continue;
+            }
+            auto it = _names.find(name);
+            if (it == _names.end()) {
+                continue;
+            }
+            auto& resolvers = it->second;
+            resolvers.erase(std::remove(resolvers.begin(), resolvers.end(), res), resolvers.end());
+            if (resolvers.empty()) {
+                _names.erase(it);
+            }
+        }
+
+        auto id = _ids.find(res.get());
+        if (id == _ids.end()) {
+            return;
+        }
+        for (auto const& pattern : res->patterns()) {
+            auto current = find_node(anchored_prefix(pattern), false);
+            if (current) {
+                current->resolvers.erase(std::remove(current->resolvers.begin(), current->resolvers.end(), id->second), current->resolvers.end());
+            }
+        }
+        _patterns.erase(id->second);
+        _ids.erase(id);
+    }
+
+    void resolver_index::clear()
+    {
+        for (auto& resolvers : _builtins) {
+            resolvers.clear();
+        }
+        _names.clear();
+        _patterns.clear();
+        _ids.clear();
+        _root.children.clear();
+        _root.resolvers.clear();
+    }
+
+    shared_ptr<resolver> resolver_index::find(string const& name) const
+    {
+        // Built-in names have a slot of their own; other names fall back to the map
+        auto id = builtin_fact_id(name);
+        if (id != no_builtin_fact) {
+            if (!_builtins[id].empty()) {
+                return _builtins[id].front();
+            }
+        } else {
+            auto it = _names.find(name);
+            if (it != _names.end() && !it->second.empty()) {
+                return it->second.front();
+            }
+        }
+
+        if (_patterns.empty()) {
+            return nullptr;
+        }
+
+        // Walk the name through the prefix tree to collect only the patterns that could match
+        vector<size_t> candidates;
+        node const* current = &_root;
+        for (size_t i = 0; current; ++i) {
+            candidates.insert(candidates.end(), current->resolvers.begin(), current->resolvers.end());
+            if (i == name.size()) {
+                break;
+            }
+            auto child = current->children.find(name[i]);
+            current = child == current->children.end() ? nullptr : child->second.get();
+        }
+
+        sort(candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+        for (auto id : candidates) {
+            auto const& res = _patterns.at(id);
+            if (res->is_match(name)) {
+                return res;
+            }
+        }
+        return nullptr;
+    }
+
+    string resolver_index::anchored_prefix(string const& pattern)
+    {
+        // Top-level alternation could match names outside of the prefix
+        if (pattern.empty() || pattern[0] != '^' || pattern.find('|') != string::npos) {
+            return {};
+        }
+
+        string prefix;
+        for (size_t i = 1; i < pattern.size(); ++i) {
+            char c = pattern[i];
+            if (c == '?' || c == '*' || c == '{') {
+                // The preceding character is optional
+                if (!prefix.empty()) {
+                    prefix.pop_back();
+                }
+                break;
+            }
+            if (string("\\.^$+()[]").find(c) != string::npos) {
+                break;
+            }
+            prefix += c;
+        }
+        return prefix;
+    }
+
+    resolver_index::node* resolver_index::find_node(string const& prefix, bool create)
+    {
+        node* current = &_root;
+        for (auto c : prefix) {
+            if (!create) {
+                auto child = current->children.find(c);
+                if (child == current->children.end()) {
+                    return nullptr;
+                }
+                current = child->second.get();
+                continue;
+            }
+            auto& child = current->children[c];
+            if (!child) {
+                child.reset(new node());
+            }
+            current = child.get();
+        }
+        return current;
+    }
+
+}}  // namespace facter::facts
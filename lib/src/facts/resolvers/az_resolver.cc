@@ -0,0 +1,71 @@
+#include <internal/facts/resolvers/az_resolver.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/map_value.hpp>
+#include <leatherman/logging/logging.hpp>
+
+#ifdef USE_CURL
+#include <facter/http/client.hpp>
+using namespace facter::http;
+#endif
+
+using namespace std;
+
+namespace facter { namespace facts { namespace resolvers {
+
+    az_resolver::az_resolver() :
+        az_resolver(detect_cloud_platform())
+    {
+    }
+
+    az_resolver::az_resolver(cloud_platform platform) :
+        resolver("Azure", { fact::az_metadata }),
+        _platform(platform)
+    {
+    }
+
+    bool az_resolver::is_expensive() const
+    {
+        return true;
+    }
+
+#ifdef USE_CURL
+    static const char* AZ_METADATA_URL = "http://169.254.169.254/metadata/instance?api-version=2021-02-01";
+#endif
+
+    void az_resolver::resolve(collection& facts)
+    {
+        if (_platform != cloud_platform::azure) {
+            LOG_DEBUG("Azure facts are unavailable: not running under an Azure virtual machine.");
+            return;
+        }
+#ifndef USE_CURL
+        LOG_INFO("Azure facts are unavailable: facter was built without libcurl support.");
+        return;
+#else
+        LOG_DEBUG("querying Azure instance metadata at %1%.", AZ_METADATA_URL);
+
+        try {
+            // The metadata service rejects requests without the Metadata header
+            request req(AZ_METADATA_URL);
+            req.timeout(1000);
+            req.add_header("Metadata", "true");
+
+            client cli;
+            auto response = cli.get(req);
+            if (response.status_code() != 200) {
+                LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), response.status_code());
+                return;
+            }
+
+            auto metadata = parse_metadata(response.body());
+            if (metadata && !metadata->empty()) {
+                facts.add(fact::az_metadata, move(metadata));
+            }
+        } catch (runtime_error& ex) {
+            LOG_ERROR("Azure metadata request failed: %1%", ex.what());
+        }
+#endif
+    }
+
+}}}  // namespace facter::facts::resolvers
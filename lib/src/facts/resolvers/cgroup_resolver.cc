@@ -0,0 +1,77 @@
+#include <internal/facts/resolvers/cgroup_resolver.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+
+using namespace std;
+
+namespace facter { namespace facts { namespace resolvers {
+
+    cgroup_resolver::cgroup_resolver() :
+        resolver(
+            "control group",
+            {
+                fact::cgroup,
+                fact::namespaces,
+            })
+    {
+    }
+
+    static void add_limit(map_value& value, char const* name, int64_t limit)
+    {
+        if (limit < 0) {
+            return;
+        }
+        value.add(name, make_value<integer_value>(limit));
+    }
+
+    void cgroup_resolver::resolve(collection& facts)
+    {
+        auto data = collect_data(facts);
+
+        if (data.version > 0) {
+            auto cgroup = make_value<map_value>();
+            cgroup->add("version", make_value<integer_value>(data.version));
+            if (!data.path.empty()) {
+                cgroup->add("path", make_value<string_value>(move(data.path)));
+            }
+            if (data.cpu_quota >= 0 && data.cpu_period > 0) {
+                auto cpu = make_value<map_value>();
+                cpu->add("quota", make_value<integer_value>(data.cpu_quota));
+                cpu->add("period", make_value<integer_value>(data.cpu_period));
+                cpu->add("cpus", make_value<double_value>(static_cast<double>(data.cpu_quota) / data.cpu_period));
+                cgroup->add("cpu", move(cpu));
+            }
+            if (data.memory_max >= 0) {
+                auto memory = make_value<map_value>();
+                memory->add("max", make_value<integer_value>(data.memory_max));
+                cgroup->add("memory", move(memory));
+            }
+            auto io = make_value<map_value>();
+            for (auto& limit : data.io) {
+                auto device = make_value<map_value>();
+                add_limit(*device, "rbps", limit.read_bps);
+                add_limit(*device, "wbps", limit.write_bps);
+                add_limit(*device, "riops", limit.read_iops);
+                add_limit(*device, "wiops", limit.write_iops);
+                if (!device->empty()) {
+                    io->add(move(limit.device), move(device));
+                }
+            }
+            if (!io->empty()) {
+                cgroup->add("io", move(io));
+            }
+            facts.add(fact::cgroup, move(cgroup));
+        }
+
+        if (!data.namespaces.empty()) {
+            auto namespaces = make_value<map_value>();
+            for (auto const& ns : data.namespaces) {
+                namespaces->add(ns.first, make_value<integer_value>(static_cast<int64_t>(ns.second)));
+            }
+            facts.add(fact::namespaces, move(namespaces));
+        }
+    }
+
+}}}  // namespace facter::facts::resolvers
@@ -0,0 +1,70 @@
+#include <internal/facts/resolvers/digitalocean_resolver.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/map_value.hpp>
+#include <leatherman/logging/logging.hpp>
+
+#ifdef USE_CURL
+#include <facter/http/client.hpp>
+using namespace facter::http;
+#endif
+
+using namespace std;
+
+namespace facter { namespace facts { namespace resolvers {
+
+    digitalocean_resolver::digitalocean_resolver() :
+        digitalocean_resolver(detect_cloud_platform())
+    {
+    }
+
+    digitalocean_resolver::digitalocean_resolver(cloud_platform platform) :
+        resolver("DigitalOcean", { fact::digitalocean_metadata }),
+        _platform(platform)
+    {
+    }
+
+    bool digitalocean_resolver::is_expensive() const
+    {
+        return true;
+    }
+
+#ifdef USE_CURL
+    static const char* DIGITALOCEAN_METADATA_URL = "http://169.254.169.254/metadata/v1.json";
+#endif
+
+    void digitalocean_resolver::resolve(collection& facts)
+    {
+        if (_platform != cloud_platform::digitalocean) {
+            LOG_DEBUG("DigitalOcean facts are unavailable: not running under a DigitalOcean droplet.");
+            return;
+        }
+#ifndef USE_CURL
+        LOG_INFO("DigitalOcean facts are unavailable: facter was built without libcurl support.");
+        return;
+#else
+        LOG_DEBUG("querying DigitalOcean droplet metadata at %1%.", DIGITALOCEAN_METADATA_URL);
+
+        try {
+            // The whole metadata tree is available as a single document
+            request req(DIGITALOCEAN_METADATA_URL);
+            req.timeout(1000);
+
+            client cli;
+            auto response = cli.get(req);
+            if (response.status_code() != 200) {
+                LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), response.status_code());
+                return;
+            }
+
+            auto metadata = parse_metadata(response.body());
+            if (metadata && !metadata->empty()) {
+                facts.add(fact::digitalocean_metadata, move(metadata));
+            }
+        } catch (runtime_error& ex) {
+            LOG_ERROR("DigitalOcean metadata request failed: %1%", ex.what());
+        }
+#endif
+    }
+
+}}}  // namespace facter::facts::resolvers
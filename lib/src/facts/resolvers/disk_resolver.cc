@@ -27,6 +27,9 @@ namespace facter { namespace facts { namespace resolvers {
     {
         auto data = collect_data(facts);
 
+        // The per-disk legacy facts may be skipped unless queried
+        bool legacy = facts.is_legacy_queried(*this);
+
         ostringstream names;
         auto disks = make_value<map_value>();
         for (auto& disk : data.disks) {
@@ -35,17 +38,23 @@ namespace facter { namespace facts { namespace resolvers {
             }
             auto value = make_value<map_value>();
             if (!disk.vendor.empty()) {
-                facts.add(string(fact::block_device) + "_" + disk.name + "_vendor" , make_value<string_value>(disk.vendor, true));
+                if (legacy) {
+                    facts.add(string(fact::block_device) + "_" + disk.name + "_vendor" , make_value<string_value>(disk.vendor, true));
+                }
                 value->add("vendor", make_value<string_value>(move(disk.vendor)));
             }
             if (!disk.model.empty()) {
-                facts.add(string(fact::block_device) + "_" + disk.name + "_model" , make_value<string_value>(disk.model, true));
+                if (legacy) {
+                    facts.add(string(fact::block_device) + "_" + disk.name + "_model" , make_value<string_value>(disk.model, true));
+                }
                 value->add("model", make_value<string_value>(move(disk.model)));
             }
             if (!disk.product.empty()) {
                 value->add("product", make_value<string_value>(move(disk.product)));
             }
-            facts.add(string(fact::block_device) + "_" + disk.name + "_size" , make_value<integer_value>(static_cast<int64_t>(disk.size), true));
+            if (legacy) {
+                facts.add(string(fact::block_device) + "_" + disk.name + "_size" , make_value<integer_value>(static_cast<int64_t>(disk.size), true));
+            }
             value->add("size_bytes", make_value<integer_value>(disk.size));
             value->add("size", make_value<string_value>(si_string(disk.size)));
 
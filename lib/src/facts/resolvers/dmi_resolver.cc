@@ -8,7 +8,7 @@ using namespace std;
 
 namespace facter { namespace facts { namespace resolvers {
 
-    dmi_resolver::dmi_resolver() :
+    dmi_resolver::dmi_resolver(vector<string> dependencies) :
         resolver(
             "desktop management interface",
             {
@@ -26,7 +26,9 @@ namespace facter { namespace facts { namespace resolvers {
                 fact::serial_number,
                 fact::uuid,
                 fact::chassis_type,
-            })
+            },
+            {},
+            move(dependencies))
     {
     }
 
@@ -8,7 +8,9 @@
 #include <facter/util/string.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <map>
 #include <set>
+#include <vector>
 
 #ifdef USE_CURL
 #include <facter/http/client.hpp>
@@ -21,104 +23,215 @@ using namespace facter::util;
 namespace facter { namespace facts { namespace resolvers {
 
     ec2_resolver::ec2_resolver() :
+        ec2_resolver(detect_cloud_platform())
+    {
+    }
+
+    ec2_resolver::ec2_resolver(cloud_platform platform) :
         resolver(
             "EC2",
             {
                 fact::ec2_metadata,
                 fact::ec2_userdata
-            })
+            },
+            {},
+            platform == cloud_platform::unknown ? vector<string>{ fact::virtualization } : vector<string>{}),
+        _platform(platform)
     {
     }
 
+    bool ec2_resolver::is_expensive() const
+    {
+        return true;
+    }
+
 #ifdef USE_CURL
     static const char* EC2_METADATA_ROOT_URL = "http://169.254.169.254/latest/meta-data/";
     static const char* EC2_USERDATA_ROOT_URL = "http://169.254.169.254/latest/user-data/";
+    static const char* EC2_TOKEN_URL = "http://169.254.169.254/latest/api/token";
+    static const int EC2_TOKEN_TTL = 21600;
+
+    // User data beyond this size isn't added as a fact, as it would be carried in every fact payload and cache entry
+    static const size_t EC2_USERDATA_MAX_SIZE = 1024 * 1024;
 
-    void query_metadata_value(client& cli, map_value& value, string const& url, string const& name)
+    static request make_request(string url, string const& token)
     {
-        request req(url + name);
+        request req(move(url));
         req.timeout(200);
-
-        auto response = cli.get(req);
-        if (response.status_code() != 200) {
-            LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), response.status_code());
-            return;
+        if (!token.empty()) {
+            req.add_header("X-aws-ec2-metadata-token", token);
         }
-
-        auto body = response.body();
-        boost::trim(body);
-
-        value.add(name, make_value<string_value>(move(body)));
+        return req;
     }
 
-    void query_metadata(client& cli, map_value& value, string const& url)
+    void query_metadata(client& cli, map_value& value, string const& url, string const& token, map_value const* snapshot)
     {
         // Stores the metadata names to filter out
         static set<string> filter = {
             "security-credentials/"
         };
 
-        request req(url);
-        req.timeout(200);
-
-        auto response = cli.get(req);
-        if (response.status_code() != 200) {
-            LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), response.status_code());
-            return;
-        }
-        util::each_line(response.body(), [&](string& name) {
-            if (name.empty()) {
-                return true;
-            }
+        // Stores the top-level categories that can change while the instance runs
+        // Everything else is taken from the snapshot of a previous query, if given
+        static set<string> changing = {
+            "autoscaling/",
+            "events/",
+            "spot/",
+            "tags/"
+        };
 
-            static boost::regex array_regex("^(\\d+)=.*$");
+        // Sibling keys and categories are requested concurrently
+        // Each request maps to the map its response is added to and, for a key, the name of the key; categories have no name
+        map<string, pair<map_value*, string>> targets;
+        auto add_request = [&](vector<request>& requests, string url, map_value* target, string name) {
+            requests.emplace_back(make_request(url, token));
+            targets.emplace(move(url), make_pair(target, move(name)));
+        };
 
-            string index;
-            if (re_search(name, array_regex, &index)) {
-                name = index + "/";
+        vector<request> requests;
+        add_request(requests, url, &value, {});
+        cli.get(move(requests), [&](request const& req, response& res, vector<request>& next) {
+            auto it = targets.find(req.url());
+            if (it == targets.end()) {
+                return;
             }
+            auto target = move(it->second);
+            targets.erase(it);
 
-            // Check the filter for this name
-            if (filter.count(name) != 0) {
-                return true;
+            if (res.status_code() != 200) {
+                LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), res.status_code());
+                return;
             }
 
-            // If the name does not end with a '/', then it is a key name; request the value
-            if (name.back() != '/') {
-                query_metadata_value(cli, value, url, name);
-                return true;
+            // If the request was for a key, add its value
+            if (!target.second.empty()) {
+                auto body = res.body();
+                boost::trim(body);
+                target.first->add(move(target.second), make_value<string_value>(move(body)));
+                return;
             }
 
-            // Otherwise, this is a category; recurse down it
-            auto child = make_value<map_value>();
-            query_metadata(cli, *child, url + name);
-            trim_right_if(name, boost::is_any_of("/"));
-            value.add(move(name), move(child));
-            return true;
+            bool top = target.first == &value;
+            util::each_line(res.body(), [&](string& name) {
+                if (name.empty()) {
+                    return true;
+                }
+
+                static boost::regex array_regex("^(\\d+)=.*$");
+
+                string index;
+                if (re_search(name, array_regex, &index)) {
+                    name = index + "/";
+                }
+
+                // Check the filter for this name
+                if (filter.count(name) != 0) {
+                    return true;
+                }
+
+                // Reuse what hasn't changed since the snapshot
+                if (top && snapshot && changing.count(name) == 0) {
+                    auto previous = snapshot->share(boost::trim_right_copy_if(name, boost::is_any_of("/")));
+                    if (previous) {
+                        value.add(boost::trim_right_copy_if(name, boost::is_any_of("/")), move(previous));
+                        return true;
+                    }
+                }
+
+                // If the name does not end with a '/', then it is a key name; request the value
+                if (name.back() != '/') {
+                    add_request(next, req.url() + name, target.first, name);
+                    return true;
+                }
+
+                // Otherwise, this is a category; request its listing
+                // The category's map is added now and filled in as the requests under it complete
+                auto child = make_value<map_value>();
+                add_request(next, req.url() + name, child.get(), {});
+                trim_right_if(name, boost::is_any_of("/"));
+                target.first->add(move(name), move(child));
+                return true;
+            });
         });
     }
 #endif
 
+    void ec2_resolver::not_ec2(collection& facts) const
+    {
+        // Only a probe of an unknown platform is remembered; on a detected instance the failure may be transient
+        if (_platform == cloud_platform::unknown) {
+            facts.unavailable(*this);
+        }
+    }
+
     void ec2_resolver::resolve(collection& facts)
     {
 #ifndef USE_CURL
         LOG_INFO("EC2 facts are unavailable: facter was built without libcurl support.");
         return;
 #else
-        auto virtualization = facts.get<string_value>(fact::virtualization);
-        if (!virtualization || (virtualization->value() != vm::kvm && !boost::starts_with(virtualization->value(), "xen"))) {
+        // OpenStack also provides an EC2-compatible metadata service
+        if (_platform == cloud_platform::unknown) {
+            auto virtualization = facts.get<string_value>(fact::virtualization);
+            if (!virtualization || (virtualization->value() != vm::kvm && !boost::starts_with(virtualization->value(), "xen"))) {
+                LOG_DEBUG("EC2 facts are unavailable: not running under an EC2 instance.");
+                return;
+            }
+        } else if (_platform != cloud_platform::ec2 && _platform != cloud_platform::openstack) {
             LOG_DEBUG("EC2 facts are unavailable: not running under an EC2 instance.");
             return;
         }
 
+        client cli;
+
+        // Start an IMDSv2 session unless the current one has expired; the snapshot is only kept for the session
+        if (chrono::steady_clock::now() >= _token_expiry) {
+            _token.clear();
+            _snapshot.reset();
+
+            LOG_DEBUG("requesting an EC2 metadata session token at %1%.", EC2_TOKEN_URL);
+            try {
+                request req(EC2_TOKEN_URL);
+                req.timeout(200);
+                req.add_header("X-aws-ec2-metadata-token-ttl-seconds", to_string(EC2_TOKEN_TTL));
+
+                auto start = chrono::steady_clock::now();
+                auto response = cli.put(req);
+                if (response.status_code() == 200) {
+                    _token = response.body();
+                    boost::trim(_token);
+
+                    // Expire the session a minute early so that it can't expire in the middle of a query
+                    _token_expiry = start + chrono::seconds(EC2_TOKEN_TTL - 60);
+                } else {
+                    // IMDSv1 is still used where the metadata service doesn't provide tokens
+                    LOG_DEBUG("request for %1% returned a status code of %2%; continuing without a session token.", req.url(), response.status_code());
+                }
+            } catch (http_request_exception& ex) {
+                // The metadata service did not respond; most likely not an EC2 instance
+                LOG_DEBUG("EC2 facts are unavailable: not running under an EC2 instance.");
+                not_ec2(facts);
+                return;
+            }
+        }
+
         LOG_DEBUG("querying EC2 instance metadata at %1%.", EC2_METADATA_ROOT_URL);
 
-        client cli;
         auto metadata = make_value<map_value>();
 
         try
         {
-            query_metadata(cli, *metadata, EC2_METADATA_ROOT_URL);
+            query_metadata(cli, *metadata, EC2_METADATA_ROOT_URL, _token, _snapshot.get());
+
+            // Keep the metadata for the next query in this session; the snapshot shares the values with the fact
+            if (!_token.empty()) {
+                auto snapshot = make_shared<map_value>();
+                metadata->each([&](string const& name, value const*) {
+                    snapshot->add(name, metadata->share(name));
+                    return true;
+                });
+                _snapshot = move(snapshot);
+            }
 
             if (!metadata->empty()) {
                 facts.add(fact::ec2_metadata, move(metadata));
@@ -128,6 +241,7 @@ namespace facter { namespace facts { namespace resolvers {
             if (ex.req().url() == EC2_METADATA_ROOT_URL) {
                 // The very first query failed; most likely not an EC2 instance
                 LOG_DEBUG("EC2 facts are unavailable: not running under an EC2 instance.");
+                not_ec2(facts);
                 return;
             }
             LOG_ERROR("EC2 metadata request failed: %1%", ex.what());
@@ -139,9 +253,8 @@ namespace facter { namespace facts { namespace resolvers {
         LOG_DEBUG("querying EC2 instance user data at %1%.", EC2_USERDATA_ROOT_URL);
 
         try {
-            request req(EC2_USERDATA_ROOT_URL);
-            req.timeout(200);
-
+            auto req = make_request(EC2_USERDATA_ROOT_URL, _token);
+            req.max_body_size(EC2_USERDATA_MAX_SIZE);
             auto response = cli.get(req);
             if (response.status_code() != 200) {
                 LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), response.status_code());
@@ -5,7 +5,13 @@
 #include <facter/facts/array_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/util/string.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <memory>
 
 using namespace std;
 using namespace facter::util;
@@ -19,24 +25,147 @@ namespace facter { namespace facts { namespace resolvers {
                 fact::mountpoints,
                 fact::filesystems,
                 fact::partitions
-            })
+            }),
+        _remote_timeout(chrono::seconds(2))
     {
     }
 
+    // The result of a size query running on a worker thread
+    struct pending_size
+    {
+        pending_size() :
+            done(false),
+            success(false),
+            size(0),
+            available(0)
+        {
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable completed;
+        bool done;
+        bool success;
+        uint64_t size;
+        uint64_t available;
+    };
+
+    // The mountpoints whose size queries are still blocked on an abandoned worker thread
+    static boost::mutex hung_mutex;
+    static set<string> hung_mountpoints;
+
+    bool filesystem_resolver::is_filesystem_excluded(string const& type) const
+    {
+        return _excluded_filesystems.count(type) > 0;
+    }
+
+    bool filesystem_resolver::is_remote_filesystem(string const& type)
+    {
+        static set<string> const remote_types = {
+            "9p",
+            "afs",
+            "ceph",
+            "cifs",
+            "davfs",
+            "glusterfs",
+            "lustre",
+            "ncpfs",
+            "nfs",
+            "nfs4",
+            "smb3",
+            "smbfs",
+            "sshfs",
+        };
+        // FUSE file systems are served by a user-space process (e.g. "fuse.sshfs" or "fuseblk")
+        return boost::starts_with(type, "fuse") || remote_types.count(type) > 0;
+    }
+
+    void filesystem_resolver::populate_size(mountpoint& point, function<bool(string const&, uint64_t&, uint64_t&)> const& stat) const
+    {
+        if (!is_remote_filesystem(point.filesystem)) {
+            uint64_t size = 0, available = 0;
+            if (stat(point.name, size, available)) {
+                point.size = size;
+                point.available = available;
+            }
+            return;
+        }
+
+        // Don't start another query of a mountpoint that is still blocked
+        string path = point.name;
+        {
+            boost::lock_guard<boost::mutex> lock(hung_mutex);
+            if (hung_mountpoints.count(path)) {
+                LOG_DEBUG("size of mountpoint %1% is unavailable: an earlier query of the %2% file system has not returned.", path, point.filesystem);
+                point.unavailable = true;
+                return;
+            }
+        }
+
+        auto timeout = _remote_timeout;
+        if (scoped_deadline::active()) {
+            timeout = min(timeout, chrono::duration_cast<chrono::milliseconds>(scoped_deadline::remaining()));
+        }
+        if (timeout <= chrono::milliseconds::zero()) {
+            LOG_DEBUG("size of mountpoint %1% is unavailable: the deadline for resolving facts has passed.", path);
+            point.unavailable = true;
+            return;
+        }
+
+        // The worker owns copies of everything it uses so it can outlive this call if the query hangs
+        auto pending = make_shared<pending_size>();
+        boost::thread worker([pending, path, stat]() {
+            uint64_t size = 0, available = 0;
+            bool success = stat(path, size, available);
+            {
+                boost::lock_guard<boost::mutex> lock(pending->mutex);
+                pending->done = true;
+                pending->success = success;
+                pending->size = size;
+                pending->available = available;
+            }
+            pending->completed.notify_one();
+
+            boost::lock_guard<boost::mutex> lock(hung_mutex);
+            hung_mountpoints.erase(path);
+        });
+
+        boost::unique_lock<boost::mutex> lock(pending->mutex);
+        if (!pending->completed.wait_for(lock, boost::chrono::milliseconds(timeout.count()), [&]() { return pending->done; })) {
+            // The worker can't be interrupted while blocked in the kernel; remember the mountpoint until it returns
+            {
+                boost::lock_guard<boost::mutex> hung_lock(hung_mutex);
+                hung_mountpoints.insert(path);
+            }
+            worker.detach();
+            LOG_WARNING("size of mountpoint %1% is unavailable: the %2% file system did not respond within %3%ms.", path, point.filesystem, timeout.count());
+            point.unavailable = true;
+            return;
+        }
+        lock.unlock();
+        worker.join();
+        if (pending->success) {
+            point.size = pending->size;
+            point.available = pending->available;
+        }
+    }
+
     void filesystem_resolver::resolve(collection& facts)
     {
+        _excluded_filesystems = set<string>(facts.excluded_filesystems().begin(), facts.excluded_filesystems().end());
+        _remote_timeout = facts.remote_filesystem_timeout();
+
         auto data = collect_data(facts);
 
         // Populate the mountpoints fact
         if (!data.mountpoints.empty()) {
-            auto mountpoints = make_value<map_value>();
+            // Build the elements first so the map is sorted once
+            vector<pair<symbol, shared_ptr<value const>>> mountpoints;
+            mountpoints.reserve(data.mountpoints.size());
             for (auto& mountpoint : data.mountpoints) {
                 if (mountpoint.name.empty()) {
                     continue;
                 }
 
-                uint64_t used = mountpoint.size - mountpoint.available;
-
                 auto value = make_value<map_value>();
 
                 if (!mountpoint.filesystem.empty()) {
@@ -45,13 +174,18 @@ namespace facter { namespace facts { namespace resolvers {
                 if (!mountpoint.device.empty()) {
                     value->add("device", make_value<string_value>(move(mountpoint.device)));
                 }
-                value->add("size_bytes", make_value<integer_value>(mountpoint.size));
-                value->add("size", make_value<string_value>(si_string(mountpoint.size)));
-                value->add("available_bytes", make_value<integer_value>(mountpoint.available));
-                value->add("available", make_value<string_value>(si_string(mountpoint.available)));
-                value->add("used_bytes", make_value<integer_value>(used));
-                value->add("used", make_value<string_value>(si_string(used)));
-                value->add("capacity", make_value<string_value>(percentage(used, mountpoint.size)));
+                if (mountpoint.unavailable) {
+                    value->add("unavailable", make_value<boolean_value>(true));
+                } else {
+                    uint64_t used = mountpoint.size - mountpoint.available;
+                    value->add("size_bytes", make_value<integer_value>(mountpoint.size));
+                    value->add("size", make_value<string_value>(si_string(mountpoint.size)));
+                    value->add("available_bytes", make_value<integer_value>(mountpoint.available));
+                    value->add("available", make_value<string_value>(si_string(mountpoint.available)));
+                    value->add("used_bytes", make_value<integer_value>(used));
+                    value->add("used", make_value<string_value>(si_string(used)));
+                    value->add("capacity", make_value<string_value>(percentage(used, mountpoint.size)));
+                }
 
                 if (!mountpoint.options.empty()) {
                     auto options = make_value<array_value>();
@@ -61,9 +195,11 @@ namespace facter { namespace facts { namespace resolvers {
                     value->add("options", move(options));
                 }
 
-                mountpoints->add(move(mountpoint.name), move(value));
+                mountpoints.emplace_back(move(mountpoint.name), move(value));
             }
-            facts.add(fact::mountpoints, move(mountpoints));
+            auto map = make_value<map_value>();
+            map->assign(move(mountpoints));
+            facts.add(fact::mountpoints, move(map));
         }
 
         // Populate the filesystems fact
@@ -73,7 +209,8 @@ namespace facter { namespace facts { namespace resolvers {
 
         // Populate the partitions fact
         if (!data.partitions.empty()) {
-            auto partitions = make_value<map_value>();
+            vector<pair<symbol, shared_ptr<value const>>> partitions;
+            partitions.reserve(data.partitions.size());
             for (auto& partition : data.partitions) {
                 if (partition.name.empty()) {
                     continue;
@@ -102,9 +239,11 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("size_bytes", make_value<integer_value>(partition.size));
                 value->add("size", make_value<string_value>(si_string(partition.size)));
 
-                partitions->add(move(partition.name), move(value));
+                partitions.emplace_back(move(partition.name), move(value));
             }
-            facts.add(fact::partitions, move(partitions));
+            auto map = make_value<map_value>();
+            map->assign(move(partitions));
+            facts.add(fact::partitions, move(map));
         }
     }
 
@@ -7,9 +7,12 @@
 #include <facter/facts/vm.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
 #include <rapidjson/reader.h>
+#include <cassert>
+#include <functional>
 #include <stack>
-#include <tuple>
 #include <stdexcept>
 
 #ifdef USE_CURL
@@ -24,6 +27,103 @@ using namespace rapidjson;
 
 namespace facter { namespace facts { namespace resolvers {
 
+#ifdef USE_CURL
+    // The metadata service is queried by its link-local address so that the name "metadata" isn't resolved through
+    // the system resolver, which is slow (or times out) on hosts with search domains
+    static const char* GCE_METADATA_URL = "http://169.254.169.254/computeMetadata/v1/?recursive=true&alt=json";
+    static const char* GCE_METADATA_HOST = "metadata.google.internal";
+
+    // The number of seconds the metadata service waits for a change before answering a conditional request
+    static const int GCE_WAIT_TIMEOUT = 1;
+
+    // The metadata and its ETag are kept for the process rather than the resolver, as the daemon builds a new
+    // collection for each refresh; later requests only ask the metadata service whether the metadata changed
+    static boost::mutex gce_metadata_mutex;
+    static string gce_metadata_etag;
+    static shared_ptr<map_value const> gce_metadata_snapshot;
+
+    // The parts of a response body as they are received
+    struct body_parts
+    {
+        explicit body_parts(function<bool(string&)> const& read) :
+            read(read),
+            position(0),
+            offset(0)
+        {
+            next();
+        }
+
+        void next()
+        {
+            offset += part.size();
+            position = 0;
+            if (!read(part)) {
+                part.clear();
+            }
+        }
+
+        function<bool(string&)> const& read;
+        string part;
+        size_t position;
+        size_t offset;
+    };
+
+    // Stream over the parts of a response body; rapidjson expects a '\0' at the end of the input
+    // rapidjson copies the stream while parsing, so the stream only refers to the parts
+    struct body_stream
+    {
+        typedef char Ch;
+
+        explicit body_stream(body_parts& parts) :
+            _parts(&parts)
+        {
+        }
+
+        Ch Peek() const
+        {
+            return _parts->position == _parts->part.size() ? '\0' : _parts->part[_parts->position];
+        }
+
+        Ch Take()
+        {
+            if (_parts->position == _parts->part.size()) {
+                return '\0';
+            }
+            Ch c = _parts->part[_parts->position++];
+            if (_parts->position == _parts->part.size()) {
+                _parts->next();
+            }
+            return c;
+        }
+
+        size_t Tell() const
+        {
+            return _parts->offset + _parts->position;
+        }
+
+        Ch* PutBegin()
+        {
+            // Only used for parsing in situ
+            assert(false);
+            return nullptr;
+        }
+
+        void Put(Ch)
+        {
+            assert(false);
+        }
+
+        size_t PutEnd(Ch*)
+        {
+            assert(false);
+            return 0;
+        }
+
+     private:
+        body_parts* _parts;
+    };
+#endif
+
     // Helper event handler for parsing JSON data
     struct gce_event_handler
     {
@@ -72,9 +172,9 @@ namespace facter { namespace facts { namespace resolvers {
         void String(char const* s, SizeType len, bool copy)
         {
             // If the stack is empty or the top is a map and we don't have a key yet, set the key
-            if ((_stack.empty() || dynamic_cast<map_value*>(get<1>(_stack.top()).get())) && _key.empty()) {
+            if ((_stack.empty() || _stack.top().map) && _key.empty()) {
                 check_initialized();
-                _key = s;
+                _key.assign(s, len);
                 return;
             }
 
@@ -104,7 +204,7 @@ namespace facter { namespace facts { namespace resolvers {
                 // Therefore, use only what comes after the last / character
                 auto pos = value.find_last_of('/');
                 if (pos != string::npos) {
-                    value = value.substr(pos + 1);
+                    value.erase(0, pos + 1);
                 }
             }
 
@@ -119,7 +219,7 @@ namespace facter { namespace facts { namespace resolvers {
             }
 
             // Push a map onto the stack
-            _stack.emplace(make_tuple(move(_key), make_value<map_value>()));
+            _stack.emplace(move(_key), make_value<map_value>(), nullptr);
         }
 
         void EndObject(SizeType count)
@@ -134,8 +234,12 @@ namespace facter { namespace facts { namespace resolvers {
             _stack.pop();
 
             // Restore the key and add the value
-            _key = move(get<0>(top));
-            add_value(move(get<1>(top)));
+            _key = move(top.key);
+            if (top.map) {
+                add_value(move(top.map));
+            } else {
+                add_value(move(top.array));
+            }
         }
 
         void StartArray()
@@ -143,7 +247,7 @@ namespace facter { namespace facts { namespace resolvers {
             check_initialized();
 
             // Push an array onto the stack
-            _stack.emplace(make_tuple(move(_key), make_value<array_value>()));
+            _stack.emplace(move(_key), nullptr, make_value<array_value>());
         }
 
         void EndArray(SizeType count)
@@ -153,8 +257,12 @@ namespace facter { namespace facts { namespace resolvers {
             _stack.pop();
 
             // Restore the key and add the value
-            _key = move(get<0>(top));
-            add_value(move(get<1>(top)));
+            _key = move(top.key);
+            if (top.map) {
+                add_value(move(top.map));
+            } else {
+                add_value(move(top.array));
+            }
         }
 
      private:
@@ -162,27 +270,17 @@ namespace facter { namespace facts { namespace resolvers {
         {
             check_initialized();
 
-            value* current = nullptr;
-
-            if (_stack.empty()) {
-                current = &_root;
-            } else {
-                current = get<1>(_stack.top()).get();
-            }
-
-            auto map = dynamic_cast<map_value*>(current);
+            // The top of the stack tracks whether it's a map or an array, so no cast is needed
+            map_value* map = _stack.empty() ? &_root : _stack.top().map.get();
             if (map) {
                 if (_key.empty()) {
                     throw external::external_fact_exception("expected non-empty key in object.");
                 }
                 map->add(move(_key), move(val));
+                _key.clear();
                 return;
             }
-            auto array = dynamic_cast<array_value*>(current);
-            if (array) {
-                array->add(move(val));
-                return;
-            }
+            _stack.top().array->add(move(val));
         }
 
         void check_initialized() const
@@ -192,21 +290,52 @@ namespace facter { namespace facts { namespace resolvers {
             }
         }
 
+        // A map or array that is being parsed, with the key it will be added to its parent with
+        struct frame
+        {
+            frame(string key, unique_ptr<map_value> map, unique_ptr<array_value> array) :
+                key(move(key)),
+                map(move(map)),
+                array(move(array))
+            {
+            }
+
+            string key;
+            unique_ptr<map_value> map;
+            unique_ptr<array_value> array;
+        };
+
         bool _initialized;
         map_value& _root;
         string _key;
-        stack<tuple<string, unique_ptr<value>>> _stack;
+        stack<frame> _stack;
     };
 
     gce_resolver::gce_resolver() :
-        resolver("GCE", { fact::gce })
+        gce_resolver(detect_cloud_platform())
     {
     }
 
+    gce_resolver::gce_resolver(cloud_platform platform) :
+        resolver("GCE", { fact::gce }, {}, platform == cloud_platform::unknown ? vector<string>{ fact::virtualization } : vector<string>{}),
+        _platform(platform)
+    {
+    }
+
+    bool gce_resolver::is_expensive() const
+    {
+        return true;
+    }
+
     void gce_resolver::resolve(collection& facts)
     {
-        auto virtualization = facts.get<string_value>(fact::virtualization);
-        if (!virtualization || virtualization->value() != vm::gce) {
+        if (_platform == cloud_platform::unknown) {
+            auto virtualization = facts.get<string_value>(fact::virtualization);
+            if (!virtualization || virtualization->value() != vm::gce) {
+                LOG_DEBUG("not running under a GCE instance.");
+                return;
+            }
+        } else if (_platform != cloud_platform::gce) {
             LOG_DEBUG("not running under a GCE instance.");
             return;
         }
@@ -218,31 +347,87 @@ namespace facter { namespace facts { namespace resolvers {
 
         try
         {
-            request req("http://metadata/computeMetadata/v1beta1/?recursive=true&alt=json");
-            req.timeout(1000);
+            // With the ETag of the last metadata, the service answers as soon as the metadata differs from it, or with
+            // the same metadata once the wait times out; the unchanged metadata is then taken from the snapshot
+            string etag;
+            shared_ptr<map_value const> snapshot;
+            {
+                boost::lock_guard<boost::mutex> lock(gce_metadata_mutex);
+                etag = gce_metadata_etag;
+                snapshot = gce_metadata_snapshot;
+            }
 
-            client cli;
-            auto response = cli.get(req);
-            if (response.status_code() != 200) {
-                LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), response.status_code());
-                return;
+            string url = GCE_METADATA_URL;
+            if (snapshot && !etag.empty()) {
+                url += "&wait_for_change=true&last_etag=" + etag + "&timeout_sec=" + to_string(GCE_WAIT_TIMEOUT);
             }
+            request req(url);
+            req.add_header("Host", GCE_METADATA_HOST);
+            req.add_header("Metadata-Flavor", "Google");
+            req.timeout(1000 + (url == GCE_METADATA_URL ? 0 : GCE_WAIT_TIMEOUT * 1000));
 
+            // Parse the metadata as it is received rather than buffering all of it first
             auto data = make_value<map_value>();
+            bool parsed = false;
+            bool unchanged = false;
+            string received_etag;
 
-            Reader reader;
-            StringStream ss(response.body().c_str());
-            gce_event_handler handler(*data);
-            reader.Parse<0>(ss, handler);
+            client cli;
+            cli.get(req, [&](http::response const& res, function<bool(string&)> const& read) {
+                if (res.status_code() != 200) {
+                    LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), res.status_code());
+                    return;
+                }
 
-            if (reader.HasParseError()) {
-                LOG_ERROR("failed to parse GCE metadata: %1%.", reader.GetParseError());
+                res.each_header([&](string const& name, string const& value) {
+                    if (boost::iequals(name, "ETag")) {
+                        received_etag = boost::trim_copy(value);
+                        return false;
+                    }
+                    return true;
+                });
+                if (snapshot && !received_etag.empty() && received_etag == etag) {
+                    // The body is the metadata that is already known, so it isn't read
+                    unchanged = true;
+                    return;
+                }
+
+                Reader reader;
+                body_parts parts(read);
+                body_stream stream(parts);
+                gce_event_handler handler(*data);
+                reader.Parse<0>(stream, handler);
+
+                if (reader.HasParseError()) {
+                    LOG_ERROR("failed to parse GCE metadata: %1%.", reader.GetParseError());
+                    return;
+                }
+                parsed = true;
+            });
+
+            if (unchanged) {
+                LOG_DEBUG("GCE metadata has not changed since it was last queried.");
+                facts.add(fact::gce, snapshot->clone());
                 return;
             }
-
-            if (!data->empty()) {
+            if (parsed && !data->empty()) {
+                // The snapshot shares the values with the fact
+                {
+                    boost::lock_guard<boost::mutex> lock(gce_metadata_mutex);
+                    gce_metadata_etag = move(received_etag);
+                    gce_metadata_snapshot = shared_ptr<map_value const>(static_cast<map_value*>(data->clone().release()));
+                }
                 facts.add(fact::gce, move(data));
             }
+        } catch (http_request_exception& ex) {
+            // Without detecting the platform, a metadata service that doesn't respond means this is not a GCE instance
+            // Remember that so the request isn't made again; on a detected instance the failure may be transient
+            if (_platform == cloud_platform::unknown) {
+                LOG_DEBUG("not running under a GCE instance: %1%", ex.what());
+                facts.unavailable(*this);
+                return;
+            }
+            LOG_ERROR("GCE metadata request failed: %1%", ex.what());
         } catch (runtime_error& ex) {
             LOG_ERROR("GCE metadata request failed: %1%", ex.what());
         }
@@ -0,0 +1,59 @@
+#include <internal/facts/resolvers/load_resolver.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+
+using namespace std;
+
+namespace facter { namespace facts { namespace resolvers {
+
+    load_resolver::load_resolver() :
+        resolver(
+            "load",
+            {
+                fact::load_averages,
+                fact::pressure,
+                fact::utilization,
+            })
+    {
+    }
+
+    void load_resolver::resolve(collection& facts)
+    {
+        auto data = collect_data(facts);
+
+        if (data.load_averages_available) {
+            auto averages = make_value<map_value>();
+            averages->add("1m", make_value<double_value>(data.one));
+            averages->add("5m", make_value<double_value>(data.five));
+            averages->add("15m", make_value<double_value>(data.fifteen));
+            facts.add(fact::load_averages, move(averages));
+        }
+
+        auto pressure = make_value<map_value>();
+        for (auto const& resource : data.pressure) {
+            auto kinds = make_value<map_value>();
+            for (auto const& kind : resource.second) {
+                auto value = make_value<map_value>();
+                value->add("avg10", make_value<double_value>(kind.second.avg10));
+                value->add("avg60", make_value<double_value>(kind.second.avg60));
+                value->add("avg300", make_value<double_value>(kind.second.avg300));
+                value->add("total", make_value<integer_value>(static_cast<int64_t>(kind.second.total)));
+                kinds->add(kind.first, move(value));
+            }
+            pressure->add(resource.first, move(kinds));
+        }
+        if (!pressure->empty()) {
+            facts.add(fact::pressure, move(pressure));
+        }
+
+        if (data.utilization_available) {
+            auto utilization = make_value<map_value>();
+            utilization->add("cpu", make_value<double_value>(data.cpu_utilization));
+            utilization->add("disk_queue_length", make_value<double_value>(data.disk_queue_length));
+            facts.add(fact::utilization, move(utilization));
+        }
+    }
+
+}}}  // namespace facter::facts::resolvers
@@ -28,6 +28,21 @@ namespace facter { namespace facts { namespace resolvers {
     {
     }
 
+    static unique_ptr<map_value> make_usage(uint64_t total, uint64_t free)
+    {
+        uint64_t used = total - free;
+
+        auto stats = make_value<map_value>();
+        stats->add("total", make_value<string_value>(si_string(total)));
+        stats->add("total_bytes", make_value<integer_value>(total));
+        stats->add("used", make_value<string_value>(si_string(used)));
+        stats->add("used_bytes", make_value<integer_value>(used));
+        stats->add("available", make_value<string_value>(si_string(free)));
+        stats->add("available_bytes", make_value<integer_value>(free));
+        stats->add("capacity", make_value<string_value>(percentage(used, total)));
+        return stats;
+    }
+
     void memory_resolver::resolve(collection& facts)
     {
         data result = collect_data(facts);
@@ -35,17 +50,7 @@ namespace facter { namespace facts { namespace resolvers {
         auto value = make_value<map_value>();
 
         if (result.mem_total > 0) {
-            uint64_t mem_used = result.mem_total - result.mem_free;
-
-            auto stats = make_value<map_value>();
-            stats->add("total", make_value<string_value>(si_string(result.mem_total)));
-            stats->add("total_bytes", make_value<integer_value>(result.mem_total));
-            stats->add("used", make_value<string_value>(si_string(mem_used)));
-            stats->add("used_bytes", make_value<integer_value>(mem_used));
-            stats->add("available", make_value<string_value>(si_string(result.mem_free)));
-            stats->add("available_bytes", make_value<integer_value>(result.mem_free));
-            stats->add("capacity", make_value<string_value>(percentage(mem_used, result.mem_total)));
-            value->add("system", move(stats));
+            value->add("system", make_usage(result.mem_total, result.mem_free));
 
             // Add hidden facts
             facts.add(fact::memoryfree, make_value<string_value>(si_string(result.mem_free), true));
@@ -55,16 +60,7 @@ namespace facter { namespace facts { namespace resolvers {
         }
 
         if (result.swap_total > 0) {
-            uint64_t swap_used = result.swap_total - result.swap_free;
-
-            auto stats = make_value<map_value>();
-            stats->add("total", make_value<string_value>(si_string(result.swap_total)));
-            stats->add("total_bytes", make_value<integer_value>(result.swap_total));
-            stats->add("used", make_value<string_value>(si_string(swap_used)));
-            stats->add("used_bytes", make_value<integer_value>(swap_used));
-            stats->add("available", make_value<string_value>(si_string(result.swap_free)));
-            stats->add("available_bytes", make_value<integer_value>(result.swap_free));
-            stats->add("capacity", make_value<string_value>(percentage(swap_used, result.swap_total)));
+            auto stats = make_usage(result.swap_total, result.swap_free);
             if (result.swap_encryption != encryption_status::unknown) {
                 stats->add("encrypted", make_value<boolean_value>(result.swap_encryption == encryption_status::encrypted));
             }
@@ -80,6 +76,38 @@ namespace facter { namespace facts { namespace resolvers {
             }
         }
 
+        // Pools are keyed by page size as the kernel names them (e.g. "2048kB")
+        auto hugepages = make_value<map_value>();
+        for (auto const& pool : result.hugepages) {
+            auto stats = make_value<map_value>();
+            stats->add("size", make_value<string_value>(si_string(pool.size)));
+            stats->add("size_bytes", make_value<integer_value>(pool.size));
+            stats->add("total", make_value<integer_value>(pool.total));
+            stats->add("free", make_value<integer_value>(pool.free));
+            stats->add("reserved", make_value<integer_value>(pool.reserved));
+            stats->add("surplus", make_value<integer_value>(pool.surplus));
+            hugepages->add(to_string(pool.size / 1024) + "kB", move(stats));
+        }
+        if (!hugepages->empty()) {
+            value->add("hugepages", move(hugepages));
+        }
+
+        auto nodes = make_value<map_value>();
+        for (auto& node : result.numa_nodes) {
+            if (node.total == 0) {
+                continue;
+            }
+            auto stats = make_usage(node.total, node.free);
+            if (node.hugepages_total > 0) {
+                stats->add("hugepages_total", make_value<integer_value>(node.hugepages_total));
+                stats->add("hugepages_free", make_value<integer_value>(node.hugepages_free));
+            }
+            nodes->add(move(node.name), move(stats));
+        }
+        if (!nodes->empty()) {
+            value->add("numa", move(nodes));
+        }
+
         if (!value->empty()) {
             facts.add(fact::memory, move(value));
         }
@@ -1,9 +1,11 @@
 #include <internal/facts/resolvers/networking_resolver.hpp>
 #include <facter/facts/fact.hpp>
 #include <facter/facts/collection.hpp>
+#include <facter/facts/lazy_value.hpp>
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
-#include <boost/format.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -37,12 +39,14 @@ namespace facter { namespace facts { namespace resolvers {
                 string("^") + fact::network + "_",
                 string("^") + fact::network6 + "_",
                 string("^") + fact::macaddress + "_",
-            })
+            }),
+        _summarize(false)
     {
     }
 
     void networking_resolver::resolve(collection& facts)
     {
+        compile_filter(facts);
         auto data = collect_data(facts);
 
         // If no FQDN, set it to the hostname + domain
@@ -65,14 +69,20 @@ namespace facter { namespace facts { namespace resolvers {
             networking->add("fqdn", make_value<string_value>(move(data.fqdn)));
         }
 
+        // The per-interface legacy facts may be skipped unless queried
+        bool legacy = facts.is_legacy_queried(*this);
+
         ostringstream interface_names;
         auto dhcp_servers = make_value<map_value>(true);
+        bool lazy_dhcp_servers = false;
         auto interfaces = make_value<map_value>();
         for (auto& interface : data.interfaces) {
             bool primary = interface.name == data.primary_interface;
             auto value = make_value<map_value>();
             if (!interface.address.v4.empty()) {
-                facts.add(string(fact::ipaddress) + "_" + interface.name, make_value<string_value>(interface.address.v4, true));
+                if (legacy) {
+                    facts.add(string(fact::ipaddress) + "_" + interface.name, make_value<string_value>(interface.address.v4, true));
+                }
                 if (primary) {
                     facts.add(fact::ipaddress, make_value<string_value>(interface.address.v4, true));
                     networking->add("ip", make_value<string_value>(interface.address.v4));
@@ -80,7 +90,9 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("ip", make_value<string_value>(move(interface.address.v4)));
             }
             if (!interface.address.v6.empty()) {
-                facts.add(string(fact::ipaddress6) + "_" + interface.name, make_value<string_value>(interface.address.v6, true));
+                if (legacy) {
+                    facts.add(string(fact::ipaddress6) + "_" + interface.name, make_value<string_value>(interface.address.v6, true));
+                }
                 if (primary) {
                     facts.add(fact::ipaddress6, make_value<string_value>(interface.address.v6, true));
                     networking->add("ip6", make_value<string_value>(interface.address.v6));
@@ -88,7 +100,9 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("ip6", make_value<string_value>(move(interface.address.v6)));
             }
             if (!interface.netmask.v4.empty()) {
-                facts.add(string(fact::netmask) + "_" + interface.name, make_value<string_value>(interface.netmask.v4, true));
+                if (legacy) {
+                    facts.add(string(fact::netmask) + "_" + interface.name, make_value<string_value>(interface.netmask.v4, true));
+                }
                 if (primary) {
                     facts.add(fact::netmask, make_value<string_value>(interface.netmask.v4, true));
                     networking->add("netmask", make_value<string_value>(interface.netmask.v4));
@@ -96,7 +110,9 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("netmask", make_value<string_value>(move(interface.netmask.v4)));
             }
             if (!interface.netmask.v6.empty()) {
-                facts.add(string(fact::netmask6) + "_" + interface.name, make_value<string_value>(interface.netmask.v6, true));
+                if (legacy) {
+                    facts.add(string(fact::netmask6) + "_" + interface.name, make_value<string_value>(interface.netmask.v6, true));
+                }
                 if (primary) {
                     facts.add(fact::netmask6, make_value<string_value>(interface.netmask.v6, true));
                     networking->add("netmask6", make_value<string_value>(interface.netmask.v6));
@@ -104,7 +120,9 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("netmask6", make_value<string_value>(move(interface.netmask.v6)));
             }
             if (!interface.network.v4.empty()) {
-                facts.add(string(fact::network) + "_" + interface.name, make_value<string_value>(interface.network.v4, true));
+                if (legacy) {
+                    facts.add(string(fact::network) + "_" + interface.name, make_value<string_value>(interface.network.v4, true));
+                }
                 if (primary) {
                     facts.add(fact::network, make_value<string_value>(interface.network.v4, true));
                     networking->add("network", make_value<string_value>(interface.network.v4));
@@ -112,7 +130,9 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("network", make_value<string_value>(move(interface.network.v4)));
             }
             if (!interface.network.v6.empty()) {
-                facts.add(string(fact::network6) + "_" + interface.name, make_value<string_value>(interface.network.v6, true));
+                if (legacy) {
+                    facts.add(string(fact::network6) + "_" + interface.name, make_value<string_value>(interface.network.v6, true));
+                }
                 if (primary) {
                     facts.add(fact::network6, make_value<string_value>(interface.network.v6, true));
                     networking->add("network6", make_value<string_value>(interface.network.v6));
@@ -120,14 +140,33 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("network6", make_value<string_value>(move(interface.network.v6)));
             }
             if (!interface.macaddress.empty()) {
-                facts.add(string(fact::macaddress) + "_" + interface.name, make_value<string_value>(interface.macaddress, true));
+                if (legacy) {
+                    facts.add(string(fact::macaddress) + "_" + interface.name, make_value<string_value>(interface.macaddress, true));
+                }
                 if (primary) {
                     facts.add(fact::macaddress, make_value<string_value>(interface.macaddress, true));
                     networking->add("mac", make_value<string_value>(interface.macaddress));
                 }
                 value->add("mac", make_value<string_value>(move(interface.macaddress)));
             }
-            if (!interface.dhcp_server.empty()) {
+            if (interface.dhcp_server.empty() && interface.find_dhcp_server) {
+                // Defer finding the DHCP server until one of the facts that contain it is accessed
+                auto find = move(interface.find_dhcp_server);
+                auto dhcp = make_value<lazy_value>([find]() -> unique_ptr<facts::value> {
+                    auto server = find();
+                    if (server.empty()) {
+                        return nullptr;
+                    }
+                    return make_value<string_value>(move(server));
+                });
+                if (primary) {
+                    dhcp_servers->add("system", dhcp->share());
+                    networking->add("dhcp", dhcp->share());
+                }
+                dhcp_servers->add(string(interface.name), dhcp->share());
+                value->add("dhcp", move(dhcp));
+                lazy_dhcp_servers = true;
+            } else if (!interface.dhcp_server.empty()) {
                 if (primary) {
                     dhcp_servers->add("system", make_value<string_value>(interface.dhcp_server));
                     networking->add("dhcp", make_value<string_value>(interface.dhcp_server));
@@ -136,7 +175,9 @@ namespace facter { namespace facts { namespace resolvers {
                 value->add("dhcp", make_value<string_value>(move(interface.dhcp_server)));
             }
             if (interface.mtu) {
-                facts.add(string(fact::mtu) + "_" + interface.name, make_value<integer_value>(*interface.mtu, true));
+                if (legacy) {
+                    facts.add(string(fact::mtu) + "_" + interface.name, make_value<integer_value>(*interface.mtu, true));
+                }
                 if (primary) {
                     networking->add("mtu", make_value<integer_value>(*interface.mtu));
                 }
@@ -156,18 +197,75 @@ namespace facter { namespace facts { namespace resolvers {
             facts.add(fact::interfaces, make_value<string_value>(interface_names.str(), true));
         }
 
-        if (!dhcp_servers->empty()) {
+        if (lazy_dhcp_servers) {
+            // The fact exists only if at least one of the deferred DHCP servers is found
+            auto servers = make_shared<unique_ptr<map_value>>(move(dhcp_servers));
+            facts.add(fact::dhcp_servers, make_value<lazy_value>([servers]() -> unique_ptr<facts::value> {
+                bool found = false;
+                (*servers)->each([&](string const&, facts::value const*) {
+                    found = true;
+                    return false;
+                });
+                if (!found) {
+                    return nullptr;
+                }
+                return move(*servers);
+            }, true));
+        } else if (!dhcp_servers->empty()) {
             facts.add(fact::dhcp_servers, move(dhcp_servers));
         }
 
         if (!interfaces->empty()) {
             networking->add("interfaces", move(interfaces));
         }
+        if (!data.interface_counts.empty()) {
+            auto counts = make_value<map_value>();
+            for (auto const& kvp : data.interface_counts) {
+                counts->add(string(kvp.first), make_value<integer_value>(static_cast<int64_t>(kvp.second)));
+            }
+            networking->add("interface_counts", move(counts));
+        }
         if (!networking->empty()) {
             facts.add(fact::networking, move(networking));
         }
     }
 
+    bool networking_resolver::is_interface_included(data& result, string const& name) const
+    {
+        if (_summarize) {
+            // The class of an interface is its leading letters (e.g. "veth" for "veth1a2b3c")
+            auto end = find_if(name.begin(), name.end(), [](char c) {
+                return !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'));
+            });
+            ++result.interface_counts[end == name.begin() ? name : string(name.begin(), end)];
+        }
+
+        auto matches = [&](boost::regex const& expression) {
+            return boost::regex_match(name, expression);
+        };
+        if (!_included.empty() && none_of(_included.begin(), _included.end(), matches)) {
+            return false;
+        }
+        return none_of(_excluded.begin(), _excluded.end(), matches);
+    }
+
+    void networking_resolver::compile_filter(collection const& facts)
+    {
+        auto compile = [](vector<string> const& expressions, vector<boost::regex>& compiled) {
+            compiled.clear();
+            for (auto const& expression : expressions) {
+                try {
+                    compiled.emplace_back(expression);
+                } catch (boost::regex_error const& ex) {
+                    LOG_WARNING("invalid interface expression \"%1%\": %2%: the expression will be ignored.", expression, ex.what());
+                }
+            }
+        };
+        compile(facts.included_interfaces(), _included);
+        compile(facts.excluded_interfaces(), _excluded);
+        _summarize = facts.summarize_interfaces();
+    }
+
     string networking_resolver::macaddress_to_string(uint8_t const* bytes)
     {
         if (!bytes) {
@@ -186,10 +284,113 @@ namespace facter { namespace facts { namespace resolvers {
             return {};
         }
 
-        return (boost::format("%02x:%02x:%02x:%02x:%02x:%02x") %
-                static_cast<int>(bytes[0]) % static_cast<int>(bytes[1]) %
-                static_cast<int>(bytes[2]) % static_cast<int>(bytes[3]) %
-                static_cast<int>(bytes[4]) % static_cast<int>(bytes[5])).str();
+        // Formatted by hand into a stack buffer; this is called for every interface
+        static char const digits[] = "0123456789abcdef";
+        char buffer[17];
+        char* out = buffer;
+        for (size_t i = 0; i < 6; ++i) {
+            if (i > 0) {
+                *out++ = ':';
+            }
+            *out++ = digits[bytes[i] >> 4];
+            *out++ = digits[bytes[i] & 0xf];
+        }
+        return string(buffer, out);
+    }
+
+    static char* write_octet(char* out, uint8_t octet)
+    {
+        if (octet >= 100) {
+            *out++ = static_cast<char>('0' + octet / 100);
+        }
+        if (octet >= 10) {
+            *out++ = static_cast<char>('0' + octet / 10 % 10);
+        }
+        *out++ = static_cast<char>('0' + octet % 10);
+        return out;
+    }
+
+    static char* write_ipv4(char* out, uint8_t const* bytes)
+    {
+        for (size_t i = 0; i < 4; ++i) {
+            if (i > 0) {
+                *out++ = '.';
+            }
+            out = write_octet(out, bytes[i]);
+        }
+        return out;
+    }
+
+    string networking_resolver::ipv4_to_string(uint8_t const* bytes)
+    {
+        if (!bytes) {
+            return {};
+        }
+        char buffer[16];
+        return string(buffer, write_ipv4(buffer, bytes));
+    }
+
+    string networking_resolver::ipv6_to_string(uint8_t const* bytes)
+    {
+        if (!bytes) {
+            return {};
+        }
+
+        uint16_t words[8];
+        for (size_t i = 0; i < 8; ++i) {
+            words[i] = static_cast<uint16_t>((bytes[i * 2] << 8) | bytes[i * 2 + 1]);
+        }
+
+        // Find the first longest run of at least two zero words to compress to "::" (RFC 5952)
+        int best = -1;
+        int best_length = 1;
+        for (int i = 0; i < 8;) {
+            if (words[i] != 0) {
+                ++i;
+                continue;
+            }
+            int start = i;
+            while (i < 8 && words[i] == 0) {
+                ++i;
+            }
+            if (i - start > best_length) {
+                best = start;
+                best_length = i - start;
+            }
+        }
+
+        static char const digits[] = "0123456789abcdef";
+        char buffer[46];
+        char* out = buffer;
+        for (int i = 0; i < 8; ++i) {
+            if (i == best) {
+                *out++ = ':';
+                if (i + best_length == 8) {
+                    *out++ = ':';
+                }
+                i += best_length - 1;
+                continue;
+            }
+            if (i > 0) {
+                *out++ = ':';
+            }
+            // Like inet_ntop, write IPv4-compatible (::a.b.c.d) and IPv4-mapped (::ffff:a.b.c.d) addresses with a dotted quad
+            if (i == 6 && best == 0 && (best_length == 6 || (best_length == 5 && words[5] == 0xffff))) {
+                out = write_ipv4(out, bytes + 12);
+                break;
+            }
+            auto word = words[i];
+            bool leading = true;
+            for (int shift = 12; shift >= 0; shift -= 4) {
+                auto digit = (word >> shift) & 0xf;
+                if (leading && digit == 0 && shift > 0) {
+                    continue;
+                }
+                leading = false;
+                *out++ = digits[digit];
+            }
+        }
+        return string(buffer, out);
     }
 
 }}}  // namespace facter::facts::posix
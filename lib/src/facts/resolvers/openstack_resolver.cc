@@ -0,0 +1,86 @@
+#include <internal/facts/resolvers/openstack_resolver.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/map_value.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <vector>
+
+#ifdef USE_CURL
+#include <facter/http/client.hpp>
+using namespace facter::http;
+#endif
+
+using namespace std;
+
+namespace facter { namespace facts { namespace resolvers {
+
+    openstack_resolver::openstack_resolver() :
+        openstack_resolver(detect_cloud_platform())
+    {
+    }
+
+    openstack_resolver::openstack_resolver(cloud_platform platform) :
+        resolver("OpenStack", { fact::openstack_metadata }),
+        _platform(platform)
+    {
+    }
+
+    bool openstack_resolver::is_expensive() const
+    {
+        return true;
+    }
+
+#ifdef USE_CURL
+    static const char* OPENSTACK_METADATA_URL = "http://169.254.169.254/openstack/latest/meta_data.json";
+    static const char* OPENSTACK_NETWORK_DATA_URL = "http://169.254.169.254/openstack/latest/network_data.json";
+#endif
+
+    void openstack_resolver::resolve(collection& facts)
+    {
+        if (_platform != cloud_platform::openstack) {
+            LOG_DEBUG("OpenStack facts are unavailable: not running under an OpenStack instance.");
+            return;
+        }
+#ifndef USE_CURL
+        LOG_INFO("OpenStack facts are unavailable: facter was built without libcurl support.");
+        return;
+#else
+        LOG_DEBUG("querying OpenStack instance metadata at %1%.", OPENSTACK_METADATA_URL);
+
+        try {
+            // The instance metadata and the network configuration are requested concurrently
+            vector<request> requests;
+            requests.emplace_back(OPENSTACK_METADATA_URL);
+            requests.emplace_back(OPENSTACK_NETWORK_DATA_URL);
+            for (auto& req : requests) {
+                req.timeout(1000);
+            }
+
+            unique_ptr<map_value> metadata;
+            unique_ptr<map_value> network_data;
+
+            client cli;
+            cli.get(move(requests), [&](request const& req, response& res, vector<request>&) {
+                if (res.status_code() != 200) {
+                    LOG_DEBUG("request for %1% returned a status code of %2%.", req.url(), res.status_code());
+                    return;
+                }
+                (req.url() == OPENSTACK_METADATA_URL ? metadata : network_data) = parse_metadata(res.body());
+            });
+
+            if (!metadata) {
+                return;
+            }
+            if (network_data && !network_data->empty()) {
+                metadata->add("network_data", move(network_data));
+            }
+            if (!metadata->empty()) {
+                facts.add(fact::openstack_metadata, move(metadata));
+            }
+        } catch (runtime_error& ex) {
+            LOG_ERROR("OpenStack metadata request failed: %1%", ex.what());
+        }
+#endif
+    }
+
+}}}  // namespace facter::facts::resolvers
@@ -5,6 +5,8 @@
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <boost/thread/mutex.hpp>
 
 using namespace std;
 
@@ -40,10 +42,78 @@ namespace facter { namespace facts { namespace resolvers {
                 fact::selinux_current_mode,
                 fact::selinux_config_mode,
                 fact::selinux_config_policy,
+            },
+            {},
+            {
+                fact::kernel,
+                fact::kernel_release,
             })
     {
     }
 
+    vector<pair<string, string>> operating_system_resolver::get_distro_facts(string const& name, distribution const& distro, string const& specification_version) const
+    {
+        vector<pair<string, string>> result;
+        if (!distro.id.empty()) {
+            result.emplace_back(string(fact::lsb_dist_id), distro.id);
+        }
+        if (!distro.codename.empty()) {
+            result.emplace_back(string(fact::lsb_dist_codename), distro.codename);
+        }
+        if (!distro.description.empty()) {
+            result.emplace_back(string(fact::lsb_dist_description), distro.description);
+        }
+        if (!distro.release.empty()) {
+            string major, minor;
+            tie(major, minor) = parse_release(name, distro.release);
+            if (major.empty()) {
+                major = distro.release;
+            }
+            result.emplace_back(string(fact::lsb_dist_major_release), move(major));
+            if (!minor.empty()) {
+                result.emplace_back(string(fact::lsb_dist_minor_release), move(minor));
+            }
+            result.emplace_back(string(fact::lsb_dist_release), distro.release);
+        }
+        if (!specification_version.empty()) {
+            result.emplace_back(string(fact::lsb_release), specification_version);
+        }
+        return result;
+    }
+
+    unique_ptr<map_value> operating_system_resolver::get_distro_value(string const& name, distribution const& distro, string const& specification_version) const
+    {
+        auto value = make_value<map_value>();
+        if (!distro.id.empty()) {
+            value->add("id", make_value<string_value>(distro.id));
+        }
+        if (!distro.codename.empty()) {
+            value->add("codename", make_value<string_value>(distro.codename));
+        }
+        if (!distro.description.empty()) {
+            value->add("description", make_value<string_value>(distro.description));
+        }
+        if (!distro.release.empty()) {
+            auto release = make_value<map_value>();
+
+            string major, minor;
+            tie(major, minor) = parse_release(name, distro.release);
+            if (major.empty()) {
+                major = distro.release;
+            }
+            release->add("major", make_value<string_value>(move(major)));
+            if (!minor.empty()) {
+                release->add("minor", make_value<string_value>(move(minor)));
+            }
+            release->add("full", make_value<string_value>(distro.release));
+            value->add("release", move(release));
+        }
+        if (!specification_version.empty()) {
+            value->add("specification", make_value<string_value>(specification_version));
+        }
+        return value;
+    }
+
     void operating_system_resolver::resolve(collection& facts)
     {
         auto data = collect_data(facts);
@@ -86,43 +156,66 @@ namespace facter { namespace facts { namespace resolvers {
         }
 
         // Add distro facts
-        auto distro = make_value<map_value>();
-        if (!data.distro.id.empty()) {
-            facts.add(fact::lsb_dist_id, make_value<string_value>(data.distro.id, true));
-            distro->add("id", make_value<string_value>(move(data.distro.id)));
-        }
-        if (!data.distro.codename.empty()) {
-            facts.add(fact::lsb_dist_codename, make_value<string_value>(data.distro.codename, true));
-            distro->add("codename", make_value<string_value>(move(data.distro.codename)));
-        }
-        if (!data.distro.description.empty()) {
-            facts.add(fact::lsb_dist_description, make_value<string_value>(data.distro.description, true));
-            distro->add("description", make_value<string_value>(move(data.distro.description)));
-        }
-        if (!data.distro.release.empty()) {
-            auto value = make_value<map_value>();
-
-            string major, minor;
-            tie(major, minor) = parse_release(data.name, data.distro.release);
+        if (data.find_distro) {
+            // Find the distribution once, the first time any of its facts is accessed
+            struct deferred_distro
+            {
+                boost::mutex mutex;
+                bool found = false;
+                function<void(distribution&, string&)> find;
+                vector<pair<string, string>> facts;
+                unique_ptr<map_value> value;
+            };
+            auto deferred = make_shared<deferred_distro>();
+            deferred->find = move(data.find_distro);
+            string name = data.name;
+            auto find = [this, deferred, name]() {
+                boost::lock_guard<boost::mutex> lock(deferred->mutex);
+                if (deferred->found) {
+                    return;
+                }
+                deferred->found = true;
+                distribution distro;
+                string specification_version;
+                deferred->find(distro, specification_version);
+                deferred->facts = get_distro_facts(name, distro, specification_version);
+                deferred->value = get_distro_value(name, distro, specification_version);
+            };
 
-            if (major.empty()) {
-                major = data.distro.release;
+            for (auto const* fact_name : {
+                    fact::lsb_dist_id,
+                    fact::lsb_dist_codename,
+                    fact::lsb_dist_description,
+                    fact::lsb_dist_release,
+                    fact::lsb_dist_major_release,
+                    fact::lsb_dist_minor_release,
+                    fact::lsb_release }) {
+                string fact_key = fact_name;
+                facts.add(fact_name, make_value<lazy_value>([deferred, find, fact_key]() -> unique_ptr<value> {
+                    find();
+                    for (auto const& kvp : deferred->facts) {
+                        if (kvp.first == fact_key) {
+                            return make_value<string_value>(kvp.second);
+                        }
+                    }
+                    return nullptr;
+                }, true));
             }
-            facts.add(fact::lsb_dist_major_release, make_value<string_value>(major, true));
-            value->add("major", make_value<string_value>(move(major)));
-
-            if (!minor.empty()) {
-                facts.add(fact::lsb_dist_minor_release, make_value<string_value>(minor, true));
-                value->add("minor", make_value<string_value>(move(minor)));
+            os->add("distro", make_value<lazy_value>([deferred, find]() -> unique_ptr<value> {
+                find();
+                if (!deferred->value || deferred->value->empty()) {
+                    return nullptr;
+                }
+                return move(deferred->value);
+            }));
+        } else {
+            for (auto& kvp : get_distro_facts(data.name, data.distro, data.specification_version)) {
+                facts.add(move(kvp.first), make_value<string_value>(move(kvp.second), true));
+            }
+            auto distro = get_distro_value(data.name, data.distro, data.specification_version);
+            if (!distro->empty()) {
+                os->add("distro", move(distro));
             }
-
-            facts.add(fact::lsb_dist_release, make_value<string_value>(data.distro.release, true));
-            value->add("full", make_value<string_value>(move(data.distro.release)));
-            distro->add("release", move(value));
-        }
-        if (!data.specification_version.empty()) {
-            facts.add(fact::lsb_release, make_value<string_value>(data.specification_version, true));
-            distro->add("specification", make_value<string_value>(move(data.specification_version)));
         }
 
         // Add the name last since the above release parsing is dependent on it
@@ -131,10 +224,6 @@ namespace facter { namespace facts { namespace resolvers {
             os->add("name", make_value<string_value>(move(data.name)));
         }
 
-        if (!distro->empty()) {
-             os->add("distro", move(distro));
-        }
-
         // Populate OSX-specific data
         auto macosx = make_value<map_value>();
         if (!data.osx.product.empty()) {
@@ -5,6 +5,7 @@
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/array_value.hpp>
 #include <facter/util/string.hpp>
+#include <set>
 
 using namespace std;
 using namespace facter::util;
@@ -47,10 +48,14 @@ namespace facter { namespace facts { namespace resolvers {
             cpus->add("speed", make_value<string_value>(frequency(data.speed)));
         }
 
+        // The per-processor legacy facts may be skipped unless queried
+        bool legacy = facts.is_legacy_queried(*this);
         auto models = make_value<array_value>();
         int processor = 0;
         for (auto& model : data.models) {
-            facts.add(fact::processor + to_string(processor++), make_value<string_value>(model, true));
+            if (legacy) {
+                facts.add(fact::processor + to_string(processor++), make_value<string_value>(model, true));
+            }
             models->add(make_value<string_value>(move(model)));
         }
 
@@ -58,6 +63,64 @@ namespace facter { namespace facts { namespace resolvers {
             cpus->add("models", move(models));
         }
 
+        auto topology = make_value<map_value>();
+        if (!data.topology.empty()) {
+            set<pair<int, int>> cores;
+            auto logical = make_value<map_value>();
+            for (auto& cpu : data.topology) {
+                auto value = make_value<map_value>();
+                if (cpu.package >= 0) {
+                    value->add("package", make_value<integer_value>(cpu.package));
+                }
+                if (cpu.core >= 0) {
+                    value->add("core", make_value<integer_value>(cpu.core));
+                    cores.emplace(cpu.package, cpu.core);
+                }
+                if (cpu.node >= 0) {
+                    value->add("node", make_value<integer_value>(cpu.node));
+                }
+                if (!cpu.siblings.empty()) {
+                    value->add("siblings", make_value<string_value>(move(cpu.siblings)));
+                }
+                if (cpu.max_speed > 0) {
+                    value->add("speed", make_value<string_value>(frequency(cpu.max_speed)));
+                }
+                logical->add("cpu" + to_string(cpu.id), move(value));
+            }
+            if (!cores.empty()) {
+                topology->add("cores", make_value<integer_value>(static_cast<int64_t>(cores.size())));
+                topology->add("threads_per_core", make_value<integer_value>(static_cast<int64_t>(data.topology.size() / cores.size())));
+            }
+            topology->add("cpus", move(logical));
+        }
+        if (!data.caches.empty()) {
+            auto caches = make_value<map_value>();
+            for (auto& cache : data.caches) {
+                auto value = make_value<map_value>();
+                value->add("size", make_value<string_value>(si_string(cache.size)));
+                value->add("size_bytes", make_value<integer_value>(static_cast<int64_t>(cache.size)));
+                value->add("instances", make_value<integer_value>(cache.instances));
+                caches->add(move(cache.name), move(value));
+            }
+            topology->add("caches", move(caches));
+        }
+        if (!data.nodes.empty()) {
+            auto nodes = make_value<map_value>();
+            for (auto& node : data.nodes) {
+                auto value = make_value<map_value>();
+                value->add("cpus", make_value<string_value>(move(node.cpus)));
+                if (node.memory > 0) {
+                    value->add("memory", make_value<string_value>(si_string(node.memory)));
+                    value->add("memory_bytes", make_value<integer_value>(static_cast<int64_t>(node.memory)));
+                }
+                nodes->add("node" + to_string(node.id), move(value));
+            }
+            topology->add("numa", move(nodes));
+        }
+        if (!topology->empty()) {
+            cpus->add("topology", move(topology));
+        }
+
         facts.add(fact::processors, move(cpus));
     }
 
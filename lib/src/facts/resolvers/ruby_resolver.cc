@@ -82,8 +82,9 @@ namespace facter { namespace facts { namespace resolvers {
     {
         data rb_data;
 
-        auto const* ruby = api::instance();
-        if (!ruby || !ruby->initialized()) {
+        // Ruby is initialized here if it was deferred until needed
+        auto const* ruby = api::initialized_instance();
+        if (!ruby) {
             return rb_data;
         }
 
@@ -94,6 +95,11 @@ namespace facter { namespace facts { namespace resolvers {
         return rb_data;
     }
 
+    bool ruby_resolver::is_thread_safe() const
+    {
+        return false;
+    }
+
     void ruby_resolver::resolve(collection& facts)
     {
         auto rb_data = collect_data(facts);
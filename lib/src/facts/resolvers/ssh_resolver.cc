@@ -1,6 +1,7 @@
 #include <internal/facts/resolvers/ssh_resolver.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
+#include <facter/facts/lazy_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 
 using namespace std;
@@ -39,7 +40,7 @@ namespace facter { namespace facts { namespace resolvers {
         }
     }
 
-    void ssh_resolver::add_key(collection& facts, map_value& value, ssh_key& key, string const& name, string const& key_fact_name, string const& fingerprint_fact_name)
+    void ssh_resolver::add_key(collection& facts, map_value& value, ssh_key& key, char const* name, char const* key_fact_name, char const* fingerprint_fact_name)
     {
         if (key.key.empty()) {
             return;
@@ -48,8 +49,13 @@ namespace facter { namespace facts { namespace resolvers {
         auto key_value = make_value<map_value>();
         auto fingerprint_value = make_value<map_value>();
 
-        facts.add(string(key_fact_name), make_value<string_value>(key.key, true));
-        key_value->add("key", make_value<string_value>(move(key.key)));
+        // The legacy fact shares the structured fact's key rather than holding a copy of it
+        auto key_string = make_shared<string>(move(key.key));
+        auto shared_key = make_value<lazy_value>([key_string]() -> unique_ptr<facter::facts::value> {
+            return make_value<string_value>(move(*key_string));
+        });
+        facts.add(key_fact_name, shared_key->share(true));
+        key_value->add("key", move(shared_key));
 
         string fingerprint;
         if (!key.digest.sha1.empty()) {
@@ -64,13 +70,13 @@ namespace facter { namespace facts { namespace resolvers {
             fingerprint_value->add("sha256", make_value<string_value>(move(key.digest.sha256)));
         }
         if (!fingerprint.empty()) {
-            facts.add(string(fingerprint_fact_name), make_value<string_value>(move(fingerprint), true));
+            facts.add(fingerprint_fact_name, make_value<string_value>(move(fingerprint), true));
         }
         if (!fingerprint_value->empty()) {
             key_value->add("fingerprints", move(fingerprint_value));
         }
 
-        value.add(string(name), move(key_value));
+        value.add(name, move(key_value));
     }
 
 }}}  // namespace facter::facts::resolvers
@@ -39,6 +39,11 @@ namespace facter { namespace facts { namespace resolvers {
     {
     }
 
+    bool system_profiler_resolver::is_expensive() const
+    {
+        return true;
+    }
+
     void system_profiler_resolver::resolve(collection& facts)
     {
         auto data = collect_data(facts);
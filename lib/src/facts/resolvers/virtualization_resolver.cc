@@ -10,13 +10,15 @@ using namespace facter::facts;
 
 namespace facter { namespace facts { namespace resolvers {
 
-    virtualization_resolver::virtualization_resolver() :
+    virtualization_resolver::virtualization_resolver(vector<string> dependencies) :
         resolver(
             "virtualization",
             {
                 fact::virtualization,
                 fact::is_virtual,
-            })
+            },
+            {},
+            move(dependencies))
     {
     }
 
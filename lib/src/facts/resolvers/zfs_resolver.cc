@@ -4,7 +4,9 @@
 #include <facter/facts/collection.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/execution/execution.hpp>
+#include <facter/util/string.hpp>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 
 using namespace std;
 using namespace facter::facts;
@@ -39,24 +41,22 @@ namespace facter { namespace facts { namespace resolvers {
     {
         data result;
 
-        // Get the ZFS version
-        static boost::regex zfs_version("currently running ZFS filesystem version (\\d+)[.]");
-        execution::each_line(zfs_command(), {"upgrade"}, [&] (string& line) {
-            if (re_search(line, zfs_version, &result.version)) {
-                return false;
-            }
-            return true;
-        });
-
-        // Get the ZFS features
+        // Get the ZFS features; the running version is the highest supported version
+        // Don't run "zfs upgrade" to get the version: it examines every file system to find those that can be upgraded
         static boost::regex zfs_feature("\\s*(\\d+)[ ]");
+        uint64_t highest = 0;
         execution::each_line(zfs_command(), {"upgrade", "-v"}, [&] (string& line) {
             string feature;
-            if (re_search(line, zfs_feature, &feature)) {
+            uint64_t number;
+            if (re_search(line, zfs_feature, &feature) && parse_integer(feature, number)) {
+                highest = max<uint64_t>(highest, number);
                 result.features.emplace_back(move(feature));
             }
             return true;
         });
+        if (highest > 0) {
+            result.version = to_string(highest);
+        }
         return result;
     }
 
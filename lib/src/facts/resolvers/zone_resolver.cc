@@ -35,35 +35,50 @@ namespace facter { namespace facts { namespace resolvers {
     {
         auto data = collect_data(facts);
 
+        // The per-zone legacy facts may be skipped unless queried
+        bool legacy = facts.is_legacy_queried(*this);
+
         auto zones = make_value<map_value>();
         for (auto& zone : data.zones) {
             auto value = make_value<map_value>();
 
             if (!zone.id.empty()) {
-                facts.add(string("zone_") + zone.name + "_" + fact::zone_id, make_value<string_value>(zone.id, true));
+                if (legacy) {
+                    facts.add(string("zone_") + zone.name + "_" + fact::zone_id, make_value<string_value>(zone.id, true));
+                }
                 value->add("id", make_value<string_value>(move(zone.id)));
             }
-            if (!zone.name.empty()) {
+            if (legacy && !zone.name.empty()) {
                 facts.add(string("zone_") + zone.name + "_" + fact::zone_name, make_value<string_value>(zone.name, true));
             }
             if (!zone.status.empty()) {
-                facts.add(string("zone_") + zone.name + "_" + fact::zone_status, make_value<string_value>(zone.status, true));
+                if (legacy) {
+                    facts.add(string("zone_") + zone.name + "_" + fact::zone_status, make_value<string_value>(zone.status, true));
+                }
                 value->add("status", make_value<string_value>(move(zone.status)));
             }
             if (!zone.path.empty()) {
-                facts.add(string("zone_") + zone.name + "_" + fact::zone_path, make_value<string_value>(zone.path, true));
+                if (legacy) {
+                    facts.add(string("zone_") + zone.name + "_" + fact::zone_path, make_value<string_value>(zone.path, true));
+                }
                 value->add("path", make_value<string_value>(move(zone.path)));
             }
             if (!zone.uuid.empty()) {
-                facts.add(string("zone_") + zone.name + "_" + fact::zone_uuid, make_value<string_value>(zone.uuid, true));
+                if (legacy) {
+                    facts.add(string("zone_") + zone.name + "_" + fact::zone_uuid, make_value<string_value>(zone.uuid, true));
+                }
                 value->add("uuid", make_value<string_value>(move(zone.uuid)));
             }
             if (!zone.brand.empty()) {
-                facts.add(string("zone_") + zone.name + "_" + fact::zone_brand, make_value<string_value>(zone.brand, true));
+                if (legacy) {
+                    facts.add(string("zone_") + zone.name + "_" + fact::zone_brand, make_value<string_value>(zone.brand, true));
+                }
                 value->add("brand", make_value<string_value>(move(zone.brand)));
             }
             if (!zone.ip_type.empty()) {
-                facts.add(string("zone_") + zone.name + "_" + fact::zone_iptype, make_value<string_value>(zone.ip_type, true));
+                if (legacy) {
+                    facts.add(string("zone_") + zone.name + "_" + fact::zone_iptype, make_value<string_value>(zone.ip_type, true));
+                }
                 value->add("ip_type", make_value<string_value>(move(zone.ip_type)));
             }
 
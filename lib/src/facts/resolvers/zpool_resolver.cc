@@ -3,6 +3,8 @@
 #include <facter/facts/fact.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/scalar_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/util/string.hpp>
 #include <facter/execution/execution.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -19,6 +21,7 @@ namespace facter { namespace facts { namespace resolvers {
             {
                 fact::zpool_version,
                 fact::zpool_featurenumbers,
+                fact::zpools,
             })
     {
     }
@@ -33,6 +36,33 @@ namespace facter { namespace facts { namespace resolvers {
         if (!data.features.empty()) {
             facts.add(fact::zpool_featurenumbers, make_value<string_value>(boost::join(data.features, ",")));
         }
+
+        auto pools = make_value<map_value>();
+        for (auto& pool : data.pools) {
+            uint64_t used = pool.size - pool.free;
+
+            auto value = make_value<map_value>();
+            value->add("total", make_value<string_value>(si_string(pool.size)));
+            value->add("total_bytes", make_value<integer_value>(pool.size));
+            value->add("used", make_value<string_value>(si_string(used)));
+            value->add("used_bytes", make_value<integer_value>(used));
+            value->add("available", make_value<string_value>(si_string(pool.free)));
+            value->add("available_bytes", make_value<integer_value>(pool.free));
+            value->add("capacity", make_value<string_value>(percentage(used, pool.size)));
+            if (!pool.health.empty()) {
+                value->add("health", make_value<string_value>(move(pool.health)));
+            }
+            if (pool.fragmentation >= 0) {
+                value->add("fragmentation", make_value<integer_value>(pool.fragmentation));
+            }
+            if (pool.version > 0) {
+                value->add("version", make_value<integer_value>(pool.version));
+            }
+            pools->add(move(pool.name), move(value));
+        }
+        if (!pools->empty()) {
+            facts.add(fact::zpools, move(pools));
+        }
     }
 
     zpool_resolver::data zpool_resolver::collect_data(collection& facts)
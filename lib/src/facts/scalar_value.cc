@@ -1,5 +1,8 @@
 #include <facter/facts/scalar_value.hpp>
 #include <facter/util/string.hpp>
+#include <internal/facts/memory_usage.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/facts/value_hash.hpp>
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
 #include <iomanip>
@@ -35,6 +38,30 @@ namespace facter { namespace facts {
         value.SetDouble(_value);
     }
 
+    template <>
+    void scalar_value<string>::to_msgpack(msgpack_writer& writer) const
+    {
+        writer.str(_value);
+    }
+
+    template <>
+    void scalar_value<int64_t>::to_msgpack(msgpack_writer& writer) const
+    {
+        writer.integer(_value);
+    }
+
+    template <>
+    void scalar_value<bool>::to_msgpack(msgpack_writer& writer) const
+    {
+        writer.boolean(_value);
+    }
+
+    template <>
+    void scalar_value<double>::to_msgpack(msgpack_writer& writer) const
+    {
+        writer.floating_point(_value);
+    }
+
     template <>
     Emitter& scalar_value<string>::write(Emitter& emitter) const
     {
@@ -45,6 +72,38 @@ namespace facter { namespace facts {
         return emitter;
     }
 
+    template <>
+    uint64_t scalar_value<string>::hash() const
+    {
+        return hash_string(hash_integer(hash_basis, static_cast<uint64_t>(type())), _value);
+    }
+
+    template <>
+    uint64_t scalar_value<int64_t>::hash() const
+    {
+        return hash_integer(hash_integer(hash_basis, static_cast<uint64_t>(type())), static_cast<uint64_t>(_value));
+    }
+
+    template <>
+    uint64_t scalar_value<bool>::hash() const
+    {
+        return hash_integer(hash_integer(hash_basis, static_cast<uint64_t>(type())), _value ? 1 : 0);
+    }
+
+    template <>
+    uint64_t scalar_value<double>::hash() const
+    {
+        // Positive and negative zero are equal, so they must hash the same
+        double value = _value == 0 ? 0 : _value;
+        return hash_bytes(hash_integer(hash_basis, static_cast<uint64_t>(type())), &value, sizeof(value));
+    }
+
+    template <>
+    size_t scalar_value<string>::memory_usage() const
+    {
+        return sizeof(scalar_value) + string_memory_usage(_value);
+    }
+
     template <>
     ostream& scalar_value<bool>::write(ostream& os, bool quoted, unsigned int level) const
     {
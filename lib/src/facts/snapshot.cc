@@ -0,0 +1,155 @@
+#include <facter/facts/snapshot.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <internal/facts/writer.hpp>
+#include <algorithm>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    static shared_ptr<value const> reuse(shared_ptr<value const> const& previous, shared_ptr<value const> current)
+    {
+        if (!previous || !current || previous == current || previous->hidden() != current->hidden()) {
+            return current;
+        }
+
+        // Rebuild hashes and arrays from the previous snapshot's elements where they are unchanged
+        auto current_map = value_cast<map_value>(current.get());
+        if (current_map) {
+            auto previous_map = value_cast<map_value>(previous.get());
+            if (!previous_map) {
+                return current;
+            }
+            bool unchanged = previous_map->size() == current_map->size();
+            auto merged = make_value<map_value>(current->hidden());
+            current_map->each([&](string const& name, value const*) {
+                auto previous_element = previous_map->share(name);
+                auto element = reuse(previous_element, current_map->share(name));
+                unchanged = unchanged && element == previous_element;
+                merged->add(name, move(element));
+                return true;
+            });
+            if (unchanged) {
+                return previous;
+            }
+            return move(merged);
+        }
+
+        auto current_array = value_cast<array_value>(current.get());
+        if (current_array) {
+            auto previous_array = value_cast<array_value>(previous.get());
+            if (!previous_array) {
+                return current;
+            }
+            bool unchanged = previous_array->size() == current_array->size();
+            auto merged = make_value<array_value>(current->hidden());
+            for (size_t i = 0; i < current_array->size(); ++i) {
+                auto previous_element = previous_array->share(i);
+                auto element = reuse(previous_element, current_array->share(i));
+                unchanged = unchanged && element == previous_element;
+                merged->add(move(element));
+            }
+            if (unchanged) {
+                return previous;
+            }
+            return move(merged);
+        }
+        return current->equals(*previous) ? previous : current;
+    }
+
+    snapshot::snapshot(map<string, shared_ptr<value const>> facts, shared_ptr<snapshot const> const& previous) :
+        _facts(move(facts))
+    {
+        if (!previous) {
+            return;
+        }
+        for (auto& kvp : _facts) {
+            kvp.second = reuse(previous->share(kvp.first), move(kvp.second));
+        }
+    }
+
+    snapshot::snapshot(snapshot&& other)
+    {
+        *this = std::move(other);
+    }
+
+    snapshot& snapshot::operator=(snapshot&& other)
+    {
+        if (this != &other) {
+            _facts = std::move(other._facts);
+        }
+        return *this;
+    }
+
+    bool snapshot::empty() const
+    {
+        return _facts.empty();
+    }
+
+    size_t snapshot::size() const
+    {
+        return _facts.size();
+    }
+
+    value const* snapshot::operator[](string const& name) const
+    {
+        return get_value(name);
+    }
+
+    shared_ptr<value const> snapshot::share(string const& name) const
+    {
+        auto it = _facts.find(name);
+        return it == _facts.end() ? nullptr : it->second;
+    }
+
+    void snapshot::each(function<bool(string const&, value const*)> func) const
+    {
+        find_if(begin(_facts), end(_facts), [&func](map<string, shared_ptr<value const>>::value_type const& it) {
+            return !func(it.first, it.second.get());
+        });
+    }
+
+    ostream& snapshot::write(ostream& stream, format fmt, set<string> const& queries, bool project) const
+    {
+        write_facts(
+            stream,
+            fmt,
+            queries,
+            [this](function<void(string const&, value const*)> const& func) {
+                for (auto const& kvp : _facts) {
+                    func(kvp.first, kvp.second.get());
+                }
+            },
+            [this](string const& name) { return get_value(name); },
+            project);
+        return stream;
+    }
+
+    value const* snapshot::get_value(string const& name) const
+    {
+        auto it = _facts.find(name);
+        return it == _facts.end() ? nullptr : it->second.get();
+    }
+
+    value const* snapshot::query_value(string const& query) const
+    {
+        return facts::query_value(query, [this](string const& name) { return get_value(name); });
+    }
+
+    value const* snapshot::query_value(facts::query const& query) const
+    {
+        return query.evaluate([this](string const& name) { return get_value(name); });
+    }
+
+    vector<pair<string, value const*>> snapshot::query_all(facts::query const& query) const
+    {
+        vector<pair<string, value const*>> results;
+        query.each([this](string const& name) { return get_value(name); }, [&](vector<string> const& path, value const* val) {
+            results.emplace_back(facts::query::join(path), val);
+            return true;
+        });
+        return results;
+    }
+
+}}  // namespace facter::facts
@@ -5,6 +5,7 @@
 #include <internal/facts/solaris/networking_resolver.hpp>
 #include <internal/facts/solaris/processor_resolver.hpp>
 #include <internal/facts/solaris/uptime_resolver.hpp>
+#include <internal/facts/posix/load_resolver.hpp>
 #include <internal/facts/posix/ssh_resolver.hpp>
 #include <internal/facts/posix/timezone_resolver.hpp>
 #include <internal/facts/solaris/filesystem_resolver.hpp>
@@ -15,26 +16,38 @@
 #include <internal/facts/solaris/zpool_resolver.hpp>
 #include <internal/facts/solaris/zfs_resolver.hpp>
 #include <internal/facts/solaris/zone_resolver.hpp>
+#include <internal/util/solaris/k_stat.hpp>
+#include <leatherman/logging/logging.hpp>
 
 using namespace std;
+using namespace facter::util::solaris;
 
 namespace facter { namespace facts {
 
     void collection::add_platform_facts()
     {
+        // Share one kstat handle so the chain is opened and indexed once rather than by each resolver
+        shared_ptr<k_stat> shared_kstat;
+        try {
+            shared_kstat = make_shared<k_stat>();
+        } catch (kstat_exception& ex) {
+            LOG_DEBUG("kstat is unavailable to share between resolvers: %1%.", ex.what());
+        }
+
         add(make_shared<solaris::kernel_resolver>());
         add(make_shared<solaris::operating_system_resolver>());
         add(make_shared<solaris::networking_resolver>());
-        add(make_shared<solaris::processor_resolver>());
-        add(make_shared<solaris::uptime_resolver>());
+        add(make_shared<solaris::processor_resolver>(shared_kstat));
+        add(make_shared<solaris::uptime_resolver>(shared_kstat));
+        add(make_shared<posix::load_resolver>());
         add(make_shared<posix::ssh_resolver>());
         add(make_shared<posix::identity_resolver>());
         add(make_shared<posix::timezone_resolver>());
         add(make_shared<solaris::filesystem_resolver>());
         add(make_shared<solaris::dmi_resolver>());
-        add(make_shared<solaris::disk_resolver>());
+        add(make_shared<solaris::disk_resolver>(shared_kstat));
         add(make_shared<solaris::virtualization_resolver>());
-        add(make_shared<solaris::memory_resolver>());
+        add(make_shared<solaris::memory_resolver>(shared_kstat));
 
         // solaris specific
         add(make_shared<solaris::zpool_resolver>());
@@ -8,12 +8,17 @@ using namespace facter::util::solaris;
 
 namespace facter { namespace facts { namespace solaris {
 
+    disk_resolver::disk_resolver(shared_ptr<k_stat> kstat) :
+        _kstat(move(kstat))
+    {
+    }
+
     disk_resolver::data disk_resolver::collect_data(collection& facts)
     {
         try {
             data result;
-            k_stat ks;
-            auto ke = ks["sderr"];
+            auto ks = _kstat ? _kstat : make_shared<k_stat>();
+            auto ke = (*ks)["sderr"];
             for (auto& kv : ke) {
                 disk d;
                 string name = kv.name();
@@ -1,82 +1,121 @@
 #include <internal/facts/solaris/dmi_resolver.hpp>
-#include <internal/util/regex.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
 #include <facter/facts/scalar_value.hpp>
+#include <facter/util/scoped_resource.hpp>
 #include <leatherman/logging/logging.hpp>
-#include <facter/execution/execution.hpp>
+#include <boost/algorithm/string.hpp>
+#include <sys/smbios.h>
+#include <sys/systeminfo.h>
+#include <cstdio>
 
 using namespace std;
 using namespace facter::util;
-using namespace facter::execution;
 
 namespace facter { namespace facts { namespace solaris {
 
-    dmi_resolver::data dmi_resolver::collect_data(collection& facts)
+    dmi_resolver::dmi_resolver() :
+        resolvers::dmi_resolver(
+            {
+                fact::architecture,
+            })
     {
-        data result;
+    }
 
-        auto arch = facts.get<string_value>(fact::architecture);
-        if (arch && arch->value() == "i86pc") {
-            static boost::regex bios_vendor_re("Vendor: (.+)");
-            static boost::regex bios_version_re("Version String: (.+)");
-            static boost::regex bios_release_re("Release Date: (.+)");
-            execution::each_line("/usr/sbin/smbios", {"-t", "SMB_TYPE_BIOS"}, [&](string& line) {
-                if (result.bios_vendor.empty()) {
-                    re_search(line, bios_vendor_re, &result.bios_vendor);
-                }
-                if (result.bios_version.empty()) {
-                    re_search(line, bios_version_re, &result.bios_version);
-                }
-                if (result.bios_release_date.empty()) {
-                    re_search(line, bios_release_re, &result.bios_release_date);
-                }
-                return result.bios_release_date.empty() || result.bios_vendor.empty() || result.bios_version.empty();
-            });
+    static string safe_string(char const* str)
+    {
+        return str ? str : "";
+    }
 
-            static boost::regex manufacturer_re("Manufacturer: (.+)");
-            static boost::regex uuid_re("UUID: (.+)");
-            static boost::regex serial_re("Serial Number: (.+)");
-            static boost::regex product_re("Product: (.+)");
-            execution::each_line("/usr/sbin/smbios", {"-t", "SMB_TYPE_SYSTEM"}, [&](string& line) {
-                if (result.manufacturer.empty()) {
-                    re_search(line, manufacturer_re, &result.manufacturer);
-                }
-                if (result.product_name.empty()) {
-                    re_search(line, product_re, &result.product_name);
-                }
-                if (result.uuid.empty()) {
-                    re_search(line, uuid_re, &result.uuid);
-                }
-                if (result.serial_number.empty()) {
-                    re_search(line, serial_re, &result.serial_number);
-                }
-                return result.manufacturer.empty() || result.product_name.empty() || result.uuid.empty() || result.serial_number.empty();
-            });
+    static string get_sysinfo(int command)
+    {
+        char buffer[257] = {};
+        long size = sysinfo(command, buffer, sizeof(buffer));
+        if (size == -1) {
+            return {};
+        }
+        return buffer;
+    }
+
+    void dmi_resolver::collect_smbios_data(data& result)
+    {
+        // Read the SMBIOS tables once rather than running smbios(1M) for each structure type
+        int error = 0;
+        smbios_hdl_t* shp = smbios_open(nullptr, SMB_VERSION, 0, &error);
+        if (!shp) {
+            LOG_DEBUG("smbios_open failed: %1% (%2%): DMI facts are unavailable.", smbios_errmsg(error), error);
+            return;
+        }
+        scoped_resource<smbios_hdl_t*> handle(shp, smbios_close);
 
-            static boost::regex chassis_type_re("(?:Chassis )?Type: (.+)");
-            static boost::regex chassis_asset_tag_re("Asset Tag: (.+)");
-            execution::each_line("/usr/sbin/smbios", {"-t", "SMB_TYPE_CHASSIS"}, [&](string& line) {
-                if (result.chassis_type.empty()) {
-                    re_search(line, chassis_type_re, &result.chassis_type);
+        smbios_bios_t bios;
+        if (smbios_info_bios(handle, &bios) != SMB_ERR) {
+            result.bios_vendor = safe_string(bios.smbb_vendor);
+            result.bios_version = safe_string(bios.smbb_version);
+            result.bios_release_date = safe_string(bios.smbb_reldate);
+        }
+
+        smbios_system_t system;
+        id_t id = smbios_info_system(handle, &system);
+        if (id != SMB_ERR) {
+            smbios_info_t info;
+            if (smbios_info_common(handle, id, &info) != SMB_ERR) {
+                result.manufacturer = safe_string(info.smbi_manufacturer);
+                result.product_name = safe_string(info.smbi_product);
+                result.serial_number = safe_string(info.smbi_serial);
+            }
+
+            // Format the UUID the same way smbios(1M) does
+            for (size_t i = 0; i < system.smbs_uuidlen; ++i) {
+                char digits[3];
+                snprintf(digits, sizeof(digits), "%02x", system.smbs_uuid[i]);
+                result.uuid += digits;
+                if (i == 3 || i == 5 || i == 7 || i == 9) {
+                    result.uuid += '-';
                 }
-                if (result.chassis_asset_tag.empty()) {
-                    re_search(line, chassis_asset_tag_re, &result.chassis_asset_tag);
+            }
+        }
+
+        // Use the first chassis structure
+        smbios_iter(handle, [](smbios_hdl_t* shp, smbios_struct_t const* sp, void* arg) {
+            if (sp->smbstr_type != SMB_TYPE_CHASSIS) {
+                return 0;
+            }
+            auto& chassis_data = *reinterpret_cast<data*>(arg);
+            smbios_chassis_t chassis;
+            if (smbios_info_chassis(shp, sp->smbstr_id, &chassis) != SMB_ERR) {
+                char type[16];
+                snprintf(type, sizeof(type), "0x%x", static_cast<unsigned int>(chassis.smbc_type));
+                chassis_data.chassis_type = type;
+                auto description = smbios_chassis_type_desc(chassis.smbc_type);
+                if (description) {
+                    chassis_data.chassis_type += " (" + string(description) + ")";
                 }
-                return result.chassis_type.empty() || result.chassis_asset_tag.empty();
-            });
+            }
+            smbios_info_t info;
+            if (smbios_info_common(shp, sp->smbstr_id, &info) != SMB_ERR) {
+                chassis_data.chassis_asset_tag = safe_string(info.smbi_asset);
+            }
+            return 1;
+        }, &result);
+    }
+
+    dmi_resolver::data dmi_resolver::collect_data(collection& facts)
+    {
+        data result;
+
+        auto arch = facts.get<string_value>(fact::architecture);
+        if (arch && arch->value() == "i86pc") {
+            collect_smbios_data(result);
         } else if (arch && arch->value() == "sparc") {
-            static boost::regex line_re("System Configuration: (.+) sun\\d.");
             // prtdiag is not implemented in all sparc machines, so we cant get product name this way.
-            execution::each_line("/usr/sbin/prtconf", [&](string& line) {
-                if (re_search(line, line_re, &result.manufacturer)) {
-                    return false;
-                }
-                return true;
-            });
-            auto output = execution::execute("/usr/sbin/uname", {"-a"});
-            if (output.first) {
-                re_search(output.second, boost::regex(".* sun\\d[vu] sparc SUNW,(.*)"), &result.product_name);
+            // The "System Configuration" reported by prtconf is the hardware provider
+            result.manufacturer = get_sysinfo(SI_HW_PROVIDER);
+
+            // The platform is reported as "SUNW,<product>"
+            string platform = get_sysinfo(SI_PLATFORM);
+            if (boost::starts_with(platform, "SUNW,")) {
+                result.product_name = platform.substr(5);
             }
         }
         return result;
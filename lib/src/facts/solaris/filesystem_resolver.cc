@@ -1,24 +1,24 @@
 #include <internal/facts/solaris/filesystem_resolver.hpp>
 #include <internal/util/solaris/k_stat.hpp>
 #include <internal/util/scoped_file.hpp>
-#include <internal/util/regex.hpp>
 #include <facter/util/file.hpp>
 #include <facter/util/string.hpp>
-#include <facter/execution/execution.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <sys/mnttab.h>
 #include <fcntl.h>
+#include <sys/fstyp.h>
 #include <sys/vfs.h>
 #include <sys/statvfs.h>
+#include <algorithm>
+#include <cstring>
 #include <set>
 #include <map>
 
 using namespace std;
 using namespace facter::facts;
 using namespace facter::util;
-using namespace facter::execution;
 using namespace facter::util::solaris;
 using namespace boost::filesystem;
 
@@ -42,34 +42,51 @@ namespace facter { namespace facts { namespace solaris {
 
         mnttab entry;
         while (getmntent(file, &entry) == 0) {
-            mountpoint point;
-
-            struct statvfs64 stats;
-            if (statvfs64(entry.mnt_mountp, &stats) != -1) {
-                point.size = stats.f_frsize * stats.f_blocks;
-                point.available = stats.f_frsize * stats.f_bfree;
+            if (is_filesystem_excluded(entry.mnt_fstype)) {
+                continue;
             }
 
+            mountpoint point;
             point.name = entry.mnt_mountp;
             point.device = entry.mnt_special;
             point.filesystem = entry.mnt_fstype;
             boost::split(point.options, entry.mnt_mntopts, boost::is_any_of(","), boost::token_compress_on);
 
+            populate_size(point, [](string const& path, uint64_t& size, uint64_t& available) {
+                struct statvfs64 stats;
+                if (statvfs64(path.c_str(), &stats) == -1) {
+                    return false;
+                }
+                size = stats.f_frsize * stats.f_blocks;
+                available = stats.f_frsize * stats.f_bfree;
+                return true;
+            });
+
             result.mountpoints.emplace_back(move(point));
         }
     }
 
     void filesystem_resolver::collect_filesystem_data(data& result)
     {
-        // Build a list of mounted filesystems
-        static boost::regex fs_re("^fs/.*/(.*)$");
-        execution::each_line("/usr/sbin/sysdef", [&](string& line) {
-            string fs;
-            if (re_search(line, fs_re, &fs)) {
-                result.filesystems.insert(move(fs));
+        // Enumerate the kernel's table of filesystem types rather than running sysdef, which dumps the entire
+        // kernel configuration to list the loaded filesystem modules
+        int count = sysfs(GETNFSTYP);
+        if (count < 0) {
+            LOG_DEBUG("sysfs failed: %1% (%2%): filesystems are unavailable.", strerror(errno), errno);
+            return;
+        }
+
+        // Index 0 is not a filesystem type; unused entries have no name and placeholder entries are uppercase
+        char name[FSTYPSZ + 1];
+        for (int index = 1; index < count; ++index) {
+            if (sysfs(GETFSTYP, index, name) != 0 || !name[0]) {
+                continue;
             }
-            return true;
-        });
+            if (any_of(name, name + strlen(name), [](char c) { return c >= 'A' && c <= 'Z'; })) {
+                continue;
+            }
+            result.filesystems.insert(name);
+        }
     }
 
 }}}  // namespace facter::facts::solaris
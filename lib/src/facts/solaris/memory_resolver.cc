@@ -15,6 +15,11 @@ using namespace facter::util::solaris;
 
 namespace facter { namespace facts { namespace solaris {
 
+    memory_resolver::memory_resolver(shared_ptr<k_stat> kstat) :
+        _kstat(move(kstat))
+    {
+    }
+
     memory_resolver::data memory_resolver::collect_data(collection& facts)
     {
         data result;
@@ -22,8 +27,8 @@ namespace facter { namespace facts { namespace solaris {
         const long page_size = sysconf(_SC_PAGESIZE);
         const long max_dev_size = PATH_MAX;
         try {
-            k_stat ks;
-            auto ke = ks[make_pair("unix", "system_pages")][0];
+            auto ks = _kstat ? _kstat : make_shared<k_stat>();
+            auto ke = (*ks)[make_pair("unix", "system_pages")][0];
             result.mem_total = ke.value<ulong_t>("physmem") * page_size;
             result.mem_free = ke.value<ulong_t>("pagesfree") * page_size;
 
@@ -3,9 +3,13 @@
 #include <facter/execution/execution.hpp>
 #include <facter/util/string.hpp>
 #include <leatherman/logging/logging.hpp>
-#include <boost/algorithm/string.hpp>
 #include <sys/sockio.h>
 #include <net/if_arp.h>
+#include <net/if.h>
+#include <net/if_dl.h>
+#include <net/route.h>
+#include <unistd.h>
+#include <cstring>
 
 using namespace std;
 using namespace facter::util::posix;
@@ -55,10 +59,17 @@ namespace facter { namespace facts { namespace solaris {
         while (it != interface_map.end()) {
             string const& name = it->first;
 
+            // Skip filtered interfaces before anything else is looked up for them
+            if (!is_interface_included(data, name)) {
+                it = interface_map.upper_bound(name);
+                continue;
+            }
+
             interface iface;
             iface.name = name;
 
             // Populate the MAC address and MTU once per interface
+            lifreq const* first = it->second;
             populate_macaddress(iface, it->second);
             populate_mtu(iface, it->second);
 
@@ -69,8 +80,14 @@ namespace facter { namespace facts { namespace solaris {
                 ++it;
             } while (it != interface_map.end() && it->first == name);
 
-            // Find the DCHP server for the interface
-            iface.dhcp_server = find_dhcp_server(name);
+            // Finding the DHCP server spawns dhcpinfo, so only do it for interfaces managed by dhcpagent
+            // and defer it until the server is accessed
+            if (is_dhcp_running(first)) {
+                string interface_name = name;
+                iface.find_dhcp_server = [this, interface_name]() {
+                    return find_dhcp_server(interface_name);
+                };
+            }
 
             data.interfaces.emplace_back(move(iface));
         }
@@ -156,20 +173,100 @@ namespace facter { namespace facts { namespace solaris {
         iface.mtu = mtu.lifr_metric;
     }
 
+    // Gets the size of a socket address in a routing message; Solaris socket addresses have no length field
+    static size_t get_address_size(sockaddr const* addr)
+    {
+        if (addr->sa_family == AF_INET) {
+            return sizeof(sockaddr_in);
+        } else if (addr->sa_family == AF_INET6) {
+            return sizeof(sockaddr_in6);
+        } else if (addr->sa_family == AF_LINK) {
+            return sizeof(sockaddr_dl);
+        }
+        return sizeof(sockaddr);
+    }
+
+    // Gets the space taken by a socket address in a routing message; each address is aligned to a long
+    static size_t get_aligned_size(size_t size)
+    {
+        return (size + sizeof(long) - 1) & ~(sizeof(long) - 1);
+    }
+
     string networking_resolver::get_primary_interface() const
     {
-        string value;
-        execution::each_line("netstat", { "-rn"}, [&value](string& line) {
-            boost::trim(line);
-            if (boost::starts_with(line, "default")) {
-                vector<string> fields;
-                boost::split(fields, line, boost::is_space(), boost::token_compress_on);
-                value = fields.size() < 6 ? "" : fields[5];
-                return false;
+        // Ask the routing socket for the interface of the IPv4 default route rather than running netstat
+        scoped_descriptor sock(socket(PF_ROUTE, SOCK_RAW, AF_INET));
+        if (static_cast<int>(sock) == -1) {
+            LOG_DEBUG("socket failed: %1% (%2%): the default route is unavailable.", strerror(errno), errno);
+            return {};
+        }
+
+        struct
+        {
+            rt_msghdr header;
+            char addresses[512];
+        } message = {};
+
+        // The request is for the default destination and netmask (0.0.0.0/0), with the interface in the reply
+        sockaddr_in destination = {};
+        destination.sin_family = AF_INET;
+        sockaddr_in netmask = {};
+        netmask.sin_family = AF_INET;
+        sockaddr_dl interface = {};
+        interface.sdl_family = AF_LINK;
+
+        char* next = message.addresses;
+        for (auto addr : { reinterpret_cast<sockaddr const*>(&destination), reinterpret_cast<sockaddr const*>(&netmask), reinterpret_cast<sockaddr const*>(&interface) }) {
+            size_t size = get_address_size(addr);
+            memcpy(next, addr, size);
+            next += get_aligned_size(size);
+        }
+
+        static int sequence = 0;
+        int seq = ++sequence;
+        pid_t pid = getpid();
+        message.header.rtm_msglen = static_cast<uint16_t>(next - reinterpret_cast<char*>(&message));
+        message.header.rtm_version = RTM_VERSION;
+        message.header.rtm_type = RTM_GET;
+        message.header.rtm_flags = RTF_UP | RTF_GATEWAY;
+        message.header.rtm_addrs = RTA_DST | RTA_NETMASK | RTA_IFP;
+        message.header.rtm_pid = pid;
+        message.header.rtm_seq = seq;
+
+        if (write(sock, &message, message.header.rtm_msglen) == -1) {
+            // ESRCH means there is no default route
+            if (errno != ESRCH) {
+                LOG_DEBUG("write to routing socket failed: %1% (%2%): the default route is unavailable.", strerror(errno), errno);
             }
-            return true;
-        });
-        return value;
+            return {};
+        }
+
+        // Other routing messages may be read before the reply
+        ssize_t length;
+        do {
+            length = read(sock, &message, sizeof(message));
+        } while (length > 0 && (message.header.rtm_type != RTM_GET || message.header.rtm_seq != seq || message.header.rtm_pid != pid));
+
+        if (length <= 0 || message.header.rtm_errno != 0) {
+            LOG_DEBUG("the routing socket did not return the default route.");
+            return {};
+        }
+
+        // The addresses follow the header in the order of their bits
+        char const* current = message.addresses;
+        char const* end = reinterpret_cast<char const*>(&message) + length;
+        for (int bit = 1; bit <= RTA_IFA && current < end; bit <<= 1) {
+            if (!(message.header.rtm_addrs & bit)) {
+                continue;
+            }
+            auto addr = reinterpret_cast<sockaddr const*>(current);
+            if (bit == RTA_IFP && addr->sa_family == AF_LINK) {
+                auto link = reinterpret_cast<sockaddr_dl const*>(addr);
+                return string(link->sdl_data, link->sdl_nlen);
+            }
+            current += get_aligned_size(get_address_size(addr));
+        }
+        return {};
     }
 
     bool networking_resolver::is_link_address(const sockaddr* addr) const
@@ -183,6 +280,22 @@ namespace facter { namespace facts { namespace solaris {
         return nullptr;
     }
 
+    bool networking_resolver::is_dhcp_running(lifreq const* addr) const
+    {
+        scoped_descriptor ctl(socket(addr->lifr_addr.ss_family, SOCK_DGRAM, 0));
+        if (static_cast<int>(ctl) == -1) {
+            LOG_DEBUG("socket failed: %1% (%2%): DHCP server for interface %3% is unavailable.", strerror(errno), errno, addr->lifr_name);
+            return false;
+        }
+
+        lifreq flags = *addr;
+        if (ioctl(ctl, SIOCGLIFFLAGS, &flags) == -1) {
+            LOG_DEBUG("ioctl with SIOCGLIFFLAGS failed: %1% (%2%): DHCP server for interface %3% is unavailable.", strerror(errno), errno, addr->lifr_name);
+            return false;
+        }
+        return (flags.lifr_flags & IFF_DHCPRUNNING) != 0;
+    }
+
     string networking_resolver::find_dhcp_server(string const& interface) const
     {
         auto result = execute("dhcpinfo", { "-i", interface, "ServerID" });
@@ -51,7 +51,7 @@ namespace facter { namespace facts { namespace solaris {
     tuple<string, string> operating_system_resolver::parse_release(string const& name, string const& release) const
     {
         string major, minor;
-        re_search(release, boost::regex("^(\\d+)(?:_u|\\.)(\\d+)"), &major, &minor);
+        re_search(release, cached_regex("^(\\d+)(?:_u|\\.)(\\d+)"), &major, &minor);
         return make_tuple(major, minor);
     }
 
@@ -3,6 +3,7 @@
 #include <leatherman/logging/logging.hpp>
 #include <unordered_set>
 #include <sys/processor.h>
+#include <sys/systeminfo.h>
 
 using namespace std;
 using namespace facter::util::solaris;
@@ -47,15 +48,26 @@ using namespace facter::util::solaris;
 
 namespace facter { namespace facts { namespace solaris {
 
+    processor_resolver::processor_resolver(shared_ptr<k_stat> kstat) :
+        _kstat(move(kstat))
+    {
+    }
+
     processor_resolver::data processor_resolver::collect_data(collection& facts)
     {
         auto result = posix::processor_resolver::collect_data(facts);
 
+        // "uname -p" prints the instruction set architecture (e.g. sparc or i386)
+        char isa[257] = {};
+        if (sysinfo(SI_ARCHITECTURE, isa, sizeof(isa)) != -1) {
+            result.isa = isa;
+        }
+
         try {
             unordered_set<int> chips;
 
-            k_stat kc;
-            auto kv = kc["cpu_info"];
+            auto kc = _kstat ? _kstat : make_shared<k_stat>();
+            auto kv = (*kc)["cpu_info"];
             for (auto const& ke : kv) {
                 try {
                     ++result.logical_count;
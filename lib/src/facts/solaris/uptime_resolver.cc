@@ -10,11 +10,16 @@ using namespace facter::util::solaris;
 
 namespace facter { namespace facts { namespace solaris {
 
+    uptime_resolver::uptime_resolver(shared_ptr<k_stat> kstat) :
+        _kstat(move(kstat))
+    {
+    }
+
     int64_t uptime_resolver::get_uptime()
     {
         try {
-            k_stat ks;
-            auto kv = ks[make_pair("unix", "system_misc")];
+            auto ks = _kstat ? _kstat : make_shared<k_stat>();
+            auto kv = (*ks)[make_pair("unix", "system_misc")];
             auto time_at_boot_in_sec = kv[0].value<unsigned long>("boot_time");
 
             system_clock::time_point atboot{seconds(time_at_boot_in_sec)};
@@ -5,8 +5,14 @@
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
 #include <facter/execution/execution.hpp>
+#include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
-#include <map>
+#include <cstring>
+#include <vector>
+#include <zone.h>
+#ifdef USE_V12N
+#include <libv12n.h>
+#endif
 
 using namespace std;
 using namespace facter::facts;
@@ -15,11 +21,57 @@ using namespace facter::execution;
 
 namespace facter { namespace facts { namespace solaris {
 
+    virtualization_resolver::virtualization_resolver() :
+        resolvers::virtualization_resolver(
+            {
+                fact::architecture,
+                fact::manufacturer,
+                fact::product_name,
+            })
+    {
+    }
+
+    static string get_ldom_hypervisor()
+    {
+#ifdef USE_V12N
+        // Ask libv12n for the domain's roles rather than running virtinfo; a domain without the root role is a guest
+        int capabilities = v12n_capabilities();
+        if (!(capabilities & V12N_CAP_SUPPORTED) || !(capabilities & V12N_CAP_ENABLED) || !(capabilities & V12N_CAP_IMPL_LDOMS)) {
+            return {};
+        }
+        int roles = v12n_domain_roles();
+        if (roles == -1) {
+            LOG_DEBUG("v12n_domain_roles failed: %1% (%2%): the logical domain role is unavailable.", strerror(errno), errno);
+            return {};
+        }
+        return (roles & V12N_ROLE_ROOT) ? string() : string(vm::ldom);
+#else
+        // Uses hints from
+        // http://serverfault.com/questions/153179/how-to-find-out-if-a-solaris-machine-is-virtualized-or-not
+        // interface stability is uncommited. Should we use it?
+        string guest_of;
+        string role;
+
+        static boost::regex domain_role_root("Domain role:.*(root|guest)");
+        execution::each_line("/usr/sbin/virtinfo", [&] (string& line) {
+                if (re_search(line, domain_role_root, &role)) {
+                    if (role != "root") {
+                        guest_of = vm::ldom;
+                    }
+                    return false;
+                }
+                // virtinfo can alsy reply:
+                // Virtual machines are not supported
+                return true;
+        });
+        return guest_of;
+#endif
+    }
+
     string virtualization_resolver::get_hypervisor(collection& facts)
     {
         // works for both x86 & sparc.
-        auto result = execution::execute("/usr/bin/zonename");
-        if (result.first && result.second != "global") {
+        if (getzoneid() != GLOBAL_ZONEID) {
             return vm::zone;
         }
 
@@ -28,50 +80,37 @@ namespace facter { namespace facts { namespace solaris {
             return {};
         }
 
-        string guest_of;
-
         if (arch->value() == "i86pc") {
-            static map<boost::regex, string> virtual_map = {
-                {boost::regex("VMware"),     string(vm::vmware)},
-                {boost::regex("VirtualBox"), string(vm::virtualbox)},
-                {boost::regex("Parallels"),  string(vm::parallels)},
-                {boost::regex("KVM"),        string(vm::kvm)},
-                {boost::regex("HVM domU"),   string(vm::xen_hardware)},
-                {boost::regex("oVirt Node"), string(vm::ovirt)}
+            static vector<pair<string, string>> const virtual_map = {
+                {"VMware",     string(vm::vmware)},
+                {"VirtualBox", string(vm::virtualbox)},
+                {"Parallels",  string(vm::parallels)},
+                {"KVM",        string(vm::kvm)},
+                {"HVM domU",   string(vm::xen_hardware)},
+                {"oVirt Node", string(vm::ovirt)}
             };
 
-            execution::each_line("/usr/sbin/prtdiag", [&](string& line) {
-                for (auto const& it : virtual_map) {
-                    if (re_search(line, it.first)) {
-                        guest_of = it.second;
-                        return false;
-                    }
+            // prtdiag's system configuration is the SMBIOS manufacturer and product name, which the DMI facts
+            // already read from the SMBIOS tables; prtdiag itself is slow to run
+            string system;
+            auto manufacturer = facts.get<string_value>(fact::manufacturer);
+            if (manufacturer) {
+                system = manufacturer->value();
+            }
+            auto product_name = facts.get<string_value>(fact::product_name);
+            if (product_name) {
+                system += " " + product_name->value();
+            }
+
+            // The names are literals, so they're found with a substring search
+            for (auto const& it : virtual_map) {
+                if (system.find(it.first) != string::npos) {
+                    return it.second;
                 }
-                return true;
-            });
+            }
         } else if (arch->value() == "sparc") {
-            // Uses hints from
-            // http://serverfault.com/questions/153179/how-to-find-out-if-a-solaris-machine-is-virtualized-or-not
-            // interface stability is uncommited. Should we use it?
-            string role;
-
-            static boost::regex domain_role_root("Domain role:.*(root|guest)");
-            execution::each_line("/usr/sbin/virtinfo", [&] (string& line) {
-                    if (re_search(line, domain_role_root, &role)) {
-                        if (role != "root") {
-                            guest_of = vm::ldom;
-                        }
-                        return false;
-                    }
-                    if (line.find("virtinfo can only be run from the global zone") != string::npos) {
-                        guest_of = vm::zone;
-                        return false;
-                    }
-                    // virtinfo can alsy reply:
-                    // Virtual machines are not supported
-                    return true;
-            });
+            return get_ldom_hypervisor();
         }
-        return guest_of;
+        return {};
     }
 }}}  // namespace facter::facts::solaris
@@ -1,30 +1,106 @@
 #include <internal/facts/solaris/zone_resolver.hpp>
-#include <internal/util/regex.hpp>
 #include <facter/facts/collection.hpp>
-#include <facter/execution/execution.hpp>
+#include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <libzonecfg.h>
+#include <uuid/uuid.h>
+#include <zone.h>
+#include <sys/param.h>
+#include <cstring>
 
 using namespace std;
 using namespace facter::facts;
-using namespace facter::util;
-using namespace facter::execution;
 
 namespace facter { namespace facts { namespace solaris {
 
+    static string get_zone_string(zoneid_t id, int attribute)
+    {
+        char buffer[MAXPATHLEN] = {};
+        if (zone_getattr(id, attribute, buffer, sizeof(buffer)) < 0) {
+            return {};
+        }
+        return buffer;
+    }
+
+    static string get_zone_status(zoneid_t id)
+    {
+        zone_status_t status;
+        if (zone_getattr(id, ZONE_ATTR_STATUS, &status, sizeof(status)) < 0) {
+            return {};
+        }
+        // Report the states the same way zoneadm does
+        switch (status) {
+            case ZONE_IS_UNINITIALIZED:
+            case ZONE_IS_INITIALIZED:
+            case ZONE_IS_READY:
+                return "ready";
+            case ZONE_IS_BOOTING:
+            case ZONE_IS_RUNNING:
+                return "running";
+            case ZONE_IS_SHUTTING_DOWN:
+            case ZONE_IS_EMPTY:
+                return "shutting_down";
+            default:
+                return "down";
+        }
+    }
+
     zone_resolver::data zone_resolver::collect_data(collection& facts)
     {
         data result;
-        result.current_zone_name = execution::execute("/bin/zonename").second;
 
-        static boost::regex zone_pattern("(\\d+):([^:]*):([^:]*):([^:]*):([^:]*):([^:]*):([^:]*)");
+        char name[ZONENAME_MAX] = {};
+        if (getzonenamebyid(getzoneid(), name, sizeof(name)) >= 0) {
+            result.current_zone_name = name;
+        }
 
-        execution::each_line("/usr/sbin/zoneadm", {"list", "-p"}, [&](string& line) {
+        // List the running zones; the list can grow between calls, so retry until it fits
+        vector<zoneid_t> ids;
+        uint_t count = 0;
+        while (true) {
+            uint_t capacity = count;
+            ids.resize(capacity);
+            if (zone_list(ids.data(), &count) != 0) {
+                LOG_DEBUG("zone_list failed: %1% (%2%): zone facts are unavailable.", strerror(errno), errno);
+                return result;
+            }
+            if (count <= capacity) {
+                ids.resize(count);
+                break;
+            }
+        }
+
+        for (auto id : ids) {
             zone z;
-            if (re_search(line, zone_pattern, &z.id, &z.name, &z.status, &z.path, &z.uuid, &z.brand, &z.ip_type)) {
-                result.zones.emplace_back(move(z));
+            z.id = to_string(id);
+            z.name = get_zone_string(id, ZONE_ATTR_NAME);
+            if (z.name.empty()) {
+                // The zone halted after it was listed
+                continue;
+            }
+            z.status = get_zone_status(id);
+            z.brand = get_zone_string(id, ZONE_ATTR_BRAND);
+
+            // The root of a non-global zone is beneath its zone path
+            z.path = get_zone_string(id, ZONE_ATTR_ROOT);
+            if (id != GLOBAL_ZONEID && boost::ends_with(z.path, "/root")) {
+                z.path.resize(z.path.size() - 5);
+            }
+
+            uint64_t flags = 0;
+            if (zone_getattr(id, ZONE_ATTR_FLAGS, &flags, sizeof(flags)) >= 0) {
+                z.ip_type = (flags & ZF_NET_EXCL) ? "excl" : "shared";
+            }
+
+            // The global zone has no configured UUID
+            uuid_t uuid;
+            if (id != GLOBAL_ZONEID && zonecfg_get_uuid(z.name.c_str(), uuid) == Z_OK && !uuid_is_null(uuid)) {
+                char buffer[UUID_PRINTABLE_STRING_LENGTH] = {};
+                uuid_unparse(uuid, buffer);
+                z.uuid = buffer;
             }
-            return true;
-        });
+            result.zones.emplace_back(move(z));
+        }
         return result;
     }
 }}}  // namespace facter::facts::solaris
@@ -1,12 +1,138 @@
 #include <internal/facts/solaris/zpool_resolver.hpp>
+#include <internal/util/dynamic_library.hpp>
+#include <leatherman/logging/logging.hpp>
 
 using namespace std;
+using namespace facter::util;
+
+// The libzfs interfaces are not committed, so only the few that are stable across releases are used
+// Properties are looked up by name because their numbering differs between releases
+struct libzfs_handle;
+struct zpool_handle;
+
+#define LOAD_SYMBOL(x) x(reinterpret_cast<decltype(x)>(library.find_symbol(#x, true)))
 
 namespace facter { namespace facts { namespace solaris {
 
+    // The functions used from libzfs
+    struct libzfs
+    {
+        explicit libzfs(dynamic_library const& library) :
+            LOAD_SYMBOL(libzfs_init),
+            LOAD_SYMBOL(libzfs_fini),
+            LOAD_SYMBOL(zpool_iter),
+            LOAD_SYMBOL(zpool_close),
+            LOAD_SYMBOL(zpool_get_name),
+            LOAD_SYMBOL(zpool_name_to_prop),
+            LOAD_SYMBOL(zpool_get_prop_int),
+            LOAD_SYMBOL(zpool_get_prop)
+        {
+        }
+
+        libzfs_handle* (* const libzfs_init)();
+        void (* const libzfs_fini)(libzfs_handle*);
+        int (* const zpool_iter)(libzfs_handle*, int (*)(zpool_handle*, void*), void*);
+        void (* const zpool_close)(zpool_handle*);
+        char const* (* const zpool_get_name)(zpool_handle*);
+        int (* const zpool_name_to_prop)(char const*);
+        uint64_t (* const zpool_get_prop_int)(zpool_handle*, int, int*);
+        // Newer releases take a trailing "literal" flag; passing it to a release that doesn't is harmless
+        int (* const zpool_get_prop)(zpool_handle*, int, char*, size_t, int*, int);
+    };
+
     string zpool_resolver::zpool_command()
     {
         return "/sbin/zpool";
     }
 
+    zpool_resolver::data zpool_resolver::collect_data(collection& facts)
+    {
+        auto result = resolvers::zpool_resolver::collect_data(facts);
+        collect_pool_data(result);
+        return result;
+    }
+
+    void zpool_resolver::collect_pool_data(data& result)
+    {
+        // Read the pools in-process rather than running "zpool list"; libzfs only reads the pool configurations
+        dynamic_library library;
+        if (!library.load("libzfs.so.1")) {
+            LOG_DEBUG("libzfs could not be loaded: zpool facts are unavailable.");
+            return;
+        }
+
+        unique_ptr<libzfs> api;
+        try {
+            api.reset(new libzfs(library));
+        } catch (missing_import_exception& ex) {
+            LOG_DEBUG("libzfs is missing a required function: %1%: zpool facts are unavailable.", ex.what());
+            return;
+        }
+
+        libzfs_handle* handle = api->libzfs_init();
+        if (!handle) {
+            LOG_DEBUG("libzfs_init failed: zpool facts are unavailable.");
+            return;
+        }
+
+        // A property the release doesn't have is reported as -1 (ZPROP_INVAL)
+        struct context
+        {
+            libzfs const& api;
+            vector<pool>& pools;
+            int size;
+            int free;
+            int health;
+            int fragmentation;
+            int version;
+        } ctx {
+            *api,
+            result.pools,
+            api->zpool_name_to_prop("size"),
+            api->zpool_name_to_prop("free"),
+            api->zpool_name_to_prop("health"),
+            api->zpool_name_to_prop("fragmentation"),
+            api->zpool_name_to_prop("version"),
+        };
+
+        api->zpool_iter(handle, [](zpool_handle* zhp, void* arg) {
+            auto& ctx = *reinterpret_cast<context*>(arg);
+            auto& api = ctx.api;
+
+            pool p;
+            p.name = api.zpool_get_name(zhp);
+            if (ctx.size != -1) {
+                p.size = api.zpool_get_prop_int(zhp, ctx.size, nullptr);
+            }
+            if (ctx.free != -1) {
+                p.free = min(api.zpool_get_prop_int(zhp, ctx.free, nullptr), p.size);
+            }
+            if (ctx.health != -1) {
+                char buffer[64] = {};
+                if (api.zpool_get_prop(zhp, ctx.health, buffer, sizeof(buffer), nullptr, 0) == 0) {
+                    p.health = buffer;
+                }
+            }
+            if (ctx.fragmentation != -1) {
+                // The fragmentation is unknown (UINT64_MAX) unless the pool has the spacemap_histogram feature
+                uint64_t fragmentation = api.zpool_get_prop_int(zhp, ctx.fragmentation, nullptr);
+                if (fragmentation <= 100) {
+                    p.fragmentation = static_cast<int64_t>(fragmentation);
+                }
+            }
+            if (ctx.version != -1) {
+                // Pools with feature flags report SPA_VERSION_FEATURES (5000) rather than a version
+                uint64_t version = api.zpool_get_prop_int(zhp, ctx.version, nullptr);
+                if (version < 5000) {
+                    p.version = version;
+                }
+            }
+            ctx.pools.emplace_back(move(p));
+            api.zpool_close(zhp);
+            return 0;
+        }, &ctx);
+
+        api->libzfs_fini(handle);
+    }
+
 }}}  // namespace facter::facts::solaris
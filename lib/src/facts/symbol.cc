@@ -0,0 +1,47 @@
+#include <facter/facts/symbol.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <unordered_set>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    struct symbol_table
+    {
+        boost::shared_mutex mutex;
+        unordered_set<string> names;
+    };
+
+    static symbol_table& table()
+    {
+        // Never destroyed so symbols remain valid during static destruction
+        static symbol_table* instance = new symbol_table();
+        return *instance;
+    }
+
+    symbol::symbol(string const& name) :
+        _name(intern(name))
+    {
+    }
+
+    symbol::symbol(char const* name) :
+        _name(intern(name))
+    {
+    }
+
+    string const* symbol::intern(string const& name)
+    {
+        auto& symbols = table();
+        {
+            boost::shared_lock<boost::shared_mutex> lock(symbols.mutex);
+            auto it = symbols.names.find(name);
+            if (it != symbols.names.end()) {
+                return &*it;
+            }
+        }
+        boost::unique_lock<boost::shared_mutex> lock(symbols.mutex);
+        return &*symbols.names.insert(name).first;
+    }
+
+}}  // namespace facter::facts
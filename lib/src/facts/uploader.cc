@@ -0,0 +1,183 @@
+#include <facter/facts/uploader.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <facter/http/client.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+using namespace facter::http;
+namespace io = boost::iostreams;
+
+namespace facter { namespace facts {
+
+    static string compress(string const& data)
+    {
+        string compressed;
+        {
+            io::filtering_ostream stream;
+            stream.push(io::gzip_compressor());
+            stream.push(io::back_inserter(compressed));
+            stream.write(data.data(), data.size());
+        }
+        return compressed;
+    }
+
+    uploader::uploader(upload_options options) :
+        _options(move(options)),
+        _client(new client()),
+        _full(true),
+        _random(random_device()())
+    {
+    }
+
+    uploader::~uploader()
+    {
+    }
+
+    void uploader::add(collection& facts)
+    {
+        add_facts([&](function<bool(string const&, value const*)> func) {
+            facts.each(move(func));
+        });
+    }
+
+    void uploader::add(snapshot const& facts)
+    {
+        add_facts([&](function<bool(string const&, value const*)> func) {
+            facts.each(move(func));
+        });
+    }
+
+    void uploader::add_facts(fact_enumerator const& each)
+    {
+        // Changes are relative to the previous set, so discarding pending sets requires the next set to be full
+        if (_pending.size() >= _options.max_pending) {
+            LOG_WARNING("discarding %1% fact sets that could not be uploaded to %2%.", _pending.size(), _options.url);
+            _pending.clear();
+            _full = true;
+        }
+        bool full = _full || !_options.changes_only;
+
+        // Compare each fact with the previous set by hash, as the values of the previous set may no longer exist
+        vector<pair<string, value const*>> values;
+        map<string, uint64_t> hashes;
+        each([&](string const& name, value const* val) {
+            if (!val->hidden()) {
+                auto hash = val->hash();
+                hashes.emplace(name, hash);
+                auto previous = _hashes.find(name);
+                if (full || previous == _hashes.end() || previous->second != hash) {
+                    values.emplace_back(name, val);
+                }
+            }
+            return true;
+        });
+
+        vector<string> removed;
+        if (!full) {
+            for (auto const& kvp : _hashes) {
+                if (!hashes.count(kvp.first)) {
+                    removed.push_back(kvp.first);
+                }
+            }
+        }
+
+        string fact_set;
+        msgpack_writer writer(fact_set);
+        writer.start_map(3);
+        writer.str("full");
+        writer.boolean(full);
+        writer.str("facts");
+        writer.start_map(values.size());
+        for (auto const& kvp : values) {
+            writer.str(kvp.first);
+            kvp.second->to_msgpack(writer);
+        }
+        writer.str("removed");
+        writer.start_array(removed.size());
+        for (auto const& name : removed) {
+            writer.str(name);
+        }
+        _pending.push_back(move(fact_set));
+        _hashes = move(hashes);
+        _full = false;
+    }
+
+    bool uploader::upload()
+    {
+        if (_pending.empty()) {
+            return true;
+        }
+
+        // Every pending set is sent in one request, oldest first
+        string batch;
+        for (auto const& fact_set : _pending) {
+            batch += fact_set;
+        }
+        auto body = compress(batch);
+        LOG_DEBUG("uploading %1% fact sets to %2% (%3% bytes compressed from %4%).", _pending.size(), _options.url, body.size(), batch.size());
+
+        auto delay = _options.retry_delay;
+        for (unsigned int attempt = 0;; ++attempt) {
+            auto status = post(body);
+            if (status == upload_status::accepted) {
+                _pending.clear();
+                return true;
+            }
+            if (status == upload_status::rejected) {
+                // The endpoint will never accept these sets; start again with every fact
+                LOG_WARNING("facts were rejected by %1%: %2% fact sets were discarded.", _options.url, _pending.size());
+                _pending.clear();
+                _full = true;
+                return false;
+            }
+            if (attempt >= _options.retries) {
+                break;
+            }
+
+            // Back off exponentially with jitter, so that many hosts do not retry in step
+            uniform_int_distribution<int64_t> jitter(0, delay.count());
+            auto wait = delay + chrono::milliseconds(jitter(_random));
+            LOG_DEBUG("retrying upload to %1% in %2%ms.", _options.url, wait.count());
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(wait.count()));
+            delay *= 2;
+        }
+        LOG_WARNING("facts could not be uploaded to %1%: %2% fact sets will be uploaded later.", _options.url, _pending.size());
+        return false;
+    }
+
+    size_t uploader::pending() const
+    {
+        return _pending.size();
+    }
+
+    uploader::upload_status uploader::post(string const& body)
+    {
+        request req(_options.url);
+        req.body(body, "application/x-msgpack");
+        req.add_header("Content-Encoding", "gzip");
+        req.timeout(static_cast<long>(_options.timeout.count()));
+        try {
+            auto res = _client->post(req);
+            auto code = res.status_code();
+            if (code >= 200 && code < 300) {
+                return upload_status::accepted;
+            }
+            LOG_DEBUG("upload to %1% returned a status code of %2%.", _options.url, code);
+
+            // Client errors other than timeouts and throttling will not succeed on a retry
+            if (code >= 400 && code < 500 && code != 408 && code != 429) {
+                return upload_status::rejected;
+            }
+        } catch (http_exception& ex) {
+            LOG_DEBUG("upload to %1% failed: %2%", _options.url, ex.what());
+        }
+        return upload_status::failed;
+    }
+
+}}  // namespace facter::facts
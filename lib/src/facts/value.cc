@@ -0,0 +1,51 @@
+#include <facter/facts/value.hpp>
+#include <internal/facts/json.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/facts/value_hash.hpp>
+#include <internal/facts/value_arena.hpp>
+#include <rapidjson/document.h>
+
+using namespace std;
+using namespace rapidjson;
+
+namespace facter { namespace facts {
+
+    void* value::operator new(size_t size)
+    {
+        return value_arena::allocate_current(size);
+    }
+
+    void value::operator delete(void* ptr)
+    {
+        value_arena::deallocate(ptr);
+    }
+
+    void value::to_msgpack(msgpack_writer& writer) const
+    {
+        Document document;
+        rapidjson::Value json;
+        to_json(document.GetAllocator(), json);
+        writer.json(json);
+    }
+
+    unique_ptr<value> value::clone() const
+    {
+        Document document;
+        rapidjson::Value json;
+        to_json(document.GetAllocator(), json);
+        return from_json(json, hidden());
+    }
+
+    uint64_t value::hash() const
+    {
+        // The copy is made of the built-in value types, which hash their contents
+        auto copy = clone();
+        return copy ? copy->hash() : hash_basis;
+    }
+
+    size_t value::memory_usage() const
+    {
+        return sizeof(value);
+    }
+
+}}  // namespace facter::facts
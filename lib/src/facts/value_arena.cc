@@ -0,0 +1,126 @@
+#include <internal/facts/value_arena.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/tss.hpp>
+#include <atomic>
+#include <new>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    // Every allocation is preceded by a header pointing at its chunk (or nullptr if allocated individually)
+    static size_t const alignment = 16;
+
+    static size_t align(size_t size)
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    static size_t const header_size = align(sizeof(void*));
+
+    struct value_arena::chunk
+    {
+        explicit chunk(size_t capacity) :
+            references(1),
+            used(0),
+            capacity(capacity)
+        {
+        }
+
+        // The arena holds a reference to its current chunk and each allocation holds one
+        atomic<size_t> references;
+        size_t used;
+        size_t capacity;
+    };
+
+    static void* allocate_individually(size_t size)
+    {
+        auto block = static_cast<char*>(::operator new(header_size + size));
+        *reinterpret_cast<void**>(block) = nullptr;
+        return block + header_size;
+    }
+
+    value_arena::value_arena(size_t chunk_size) :
+        _chunk_size(align(chunk_size)),
+        _current(nullptr)
+    {
+    }
+
+    value_arena::~value_arena()
+    {
+        release(_current);
+    }
+
+    void* value_arena::allocate(size_t size)
+    {
+        size = header_size + align(size);
+        if (size > _chunk_size / 4) {
+            return allocate_individually(size - header_size);
+        }
+
+        size_t const chunk_header_size = align(sizeof(chunk));
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        if (!_current || _current->used + size > _current->capacity) {
+            auto next = new (::operator new(chunk_header_size + _chunk_size)) chunk(_chunk_size);
+            release(_current);
+            _current = next;
+        }
+        auto block = reinterpret_cast<char*>(_current) + chunk_header_size + _current->used;
+        _current->used += size;
+        ++_current->references;
+        *reinterpret_cast<void**>(block) = _current;
+        return block + header_size;
+    }
+
+    void* value_arena::allocate_current(size_t size)
+    {
+        auto arena = scoped_arena::current();
+        return arena ? arena->allocate(size) : allocate_individually(size);
+    }
+
+    void value_arena::deallocate(void* ptr)
+    {
+        if (!ptr) {
+            return;
+        }
+        auto block = static_cast<char*>(ptr) - header_size;
+        auto owner = static_cast<chunk*>(*reinterpret_cast<void**>(block));
+        if (!owner) {
+            ::operator delete(block);
+            return;
+        }
+        release(owner);
+    }
+
+    void value_arena::release(chunk* owner)
+    {
+        if (!owner || --owner->references != 0) {
+            return;
+        }
+        owner->~chunk();
+        ::operator delete(owner);
+    }
+
+    // The scopes are owned by the calling thread's stack; never delete them
+    static boost::thread_specific_ptr<scoped_arena> current_scope([](scoped_arena*) {});
+
+    scoped_arena::scoped_arena(value_arena* arena) :
+        _previous(current_scope.get()),
+        _arena(arena)
+    {
+        current_scope.reset(this);
+    }
+
+    scoped_arena::~scoped_arena()
+    {
+        current_scope.reset(_previous);
+    }
+
+    value_arena* scoped_arena::current()
+    {
+        auto scope = current_scope.get();
+        return scope ? scope->_arena : nullptr;
+    }
+
+}}  // namespace facter::facts
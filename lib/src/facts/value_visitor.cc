@@ -0,0 +1,69 @@
+#include <facter/facts/value_visitor.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+
+using namespace std;
+
+namespace facter { namespace facts {
+
+    void value_visitor::visit(string_value const&)
+    {
+    }
+
+    void value_visitor::visit(integer_value const&)
+    {
+    }
+
+    void value_visitor::visit(boolean_value const&)
+    {
+    }
+
+    void value_visitor::visit(double_value const&)
+    {
+    }
+
+    void value_visitor::visit(array_value const&)
+    {
+    }
+
+    void value_visitor::visit(map_value const&)
+    {
+    }
+
+    void value_visitor::visit(value const&)
+    {
+    }
+
+    void visit(value const& val, value_visitor& visitor)
+    {
+        auto resolved = lazy_value::resolve(&val);
+        if (!resolved) {
+            return;
+        }
+        switch (resolved->type()) {
+            case value_type::string:
+                visitor.visit(*static_cast<string_value const*>(resolved));
+                break;
+            case value_type::integer:
+                visitor.visit(*static_cast<integer_value const*>(resolved));
+                break;
+            case value_type::boolean:
+                visitor.visit(*static_cast<boolean_value const*>(resolved));
+                break;
+            case value_type::floating_point:
+                visitor.visit(*static_cast<double_value const*>(resolved));
+                break;
+            case value_type::array:
+                visitor.visit(*static_cast<array_value const*>(resolved));
+                break;
+            case value_type::map:
+                visitor.visit(*static_cast<map_value const*>(resolved));
+                break;
+            default:
+                visitor.visit(*resolved);
+                break;
+        }
+    }
+
+}}  // namespace facter::facts
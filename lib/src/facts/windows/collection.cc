@@ -9,6 +9,7 @@
 #include <internal/facts/windows/dmi_resolver.hpp>
 #include <internal/facts/windows/identity_resolver.hpp>
 #include <internal/facts/windows/kernel_resolver.hpp>
+#include <internal/facts/windows/load_resolver.hpp>
 #include <internal/facts/windows/memory_resolver.hpp>
 #include <internal/facts/windows/networking_resolver.hpp>
 #include <internal/facts/windows/operating_system_resolver.hpp>
@@ -50,7 +51,7 @@ namespace facter { namespace facts {
 
         // The execution resolver is a catch-all for Windows executable types: .bat, .cmd, .com, .exe
         resolvers.emplace_back(new execution_resolver());
-        resolvers.emplace_back(new powershell_resolver());
+        resolvers.emplace_back(new powershell_resolver(_powershell_host));
         return resolvers;
     }
 
@@ -58,20 +59,19 @@ namespace facter { namespace facts {
     {
         add(make_shared<windows::identity_resolver>());
         add(make_shared<windows::kernel_resolver>());
+        add(make_shared<windows::load_resolver>());
         add(make_shared<windows::memory_resolver>());
         add(make_shared<windows::networking_resolver>());
         add(make_shared<windows::timezone_resolver>());
 
-        try {
-            shared_ptr<wmi> shared_wmi = make_shared<wmi>();
-            add(make_shared<windows::dmi_resolver>(shared_wmi));
-            add(make_shared<windows::operating_system_resolver>(shared_wmi));
-            add(make_shared<windows::processor_resolver>(shared_wmi));
-            add(make_shared<windows::virtualization_resolver>(shared_wmi));
-            add(make_shared<windows::uptime_resolver>(shared_wmi));
-        } catch (wmi_exception &e) {
-            LOG_ERROR("failed adding platform facts that require WMI: %1%", e.what());
-        }
+        // WMI connects on the first query, so it costs nothing unless a resolver falls back to it
+        // The uptime only needs WMI on Windows Server 2003
+        auto shared_wmi = make_shared<wmi>();
+        add(make_shared<windows::dmi_resolver>(shared_wmi));
+        add(make_shared<windows::operating_system_resolver>(shared_wmi));
+        add(make_shared<windows::processor_resolver>(shared_wmi));
+        add(make_shared<windows::uptime_resolver>(shared_wmi));
+        add(make_shared<windows::virtualization_resolver>(shared_wmi));
     }
 
 }}  // namespace facter::facts
@@ -1,6 +1,11 @@
 #include <internal/facts/windows/dmi_resolver.hpp>
+#include <internal/util/windows/system_error.hpp>
+#include <internal/util/windows/windows.hpp>
 #include <internal/util/windows/wmi.hpp>
 #include <leatherman/logging/logging.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <cstring>
+#include <vector>
 
 using namespace std;
 using namespace facter::util::windows;
@@ -13,16 +18,98 @@ namespace facter { namespace facts { namespace windows {
     {
     }
 
+    bool dmi_resolver::is_thread_safe() const
+    {
+        return false;
+    }
+
+    // Gets a string of an SMBIOS structure; the index is one-based and the strings follow the formatted area
+    static string get_smbios_string(uint8_t const* structure, uint8_t const* end, uint8_t index)
+    {
+        if (index == 0) {
+            return {};
+        }
+        auto str = reinterpret_cast<char const*>(structure + structure[1]);
+        auto limit = reinterpret_cast<char const*>(end);
+        for (uint8_t i = 1; str < limit && *str; ++i) {
+            auto length = strnlen(str, limit - str);
+            if (i == index) {
+                return boost::trim_copy(string(str, length));
+            }
+            str += length + 1;
+        }
+        return {};
+    }
+
+    void dmi_resolver::collect_smbios_data(data& result)
+    {
+        // GetSystemFirmwareTable is not available on all supported versions of Windows.
+        typedef UINT (WINAPI *LPFN_GETSYSTEMFIRMWARETABLE) (DWORD, DWORD, PVOID, DWORD);
+        LPFN_GETSYSTEMFIRMWARETABLE fnGetSystemFirmwareTable = (LPFN_GETSYSTEMFIRMWARETABLE)
+                GetProcAddress(GetModuleHandleW(L"kernel32"), "GetSystemFirmwareTable");
+        if (nullptr == fnGetSystemFirmwareTable) {
+            return;
+        }
+
+        // The raw SMBIOS table starts with an 8 byte header of the version and the length of the structures
+        DWORD const signature = 0x52534D42;  // 'RSMB'
+        auto size = fnGetSystemFirmwareTable(signature, 0, nullptr, 0);
+        vector<uint8_t> buffer(size);
+        if (size <= 8 || fnGetSystemFirmwareTable(signature, 0, buffer.data(), size) != size) {
+            LOG_DEBUG("GetSystemFirmwareTable failed: %1%", system_error());
+            return;
+        }
+        auto table = buffer.data() + 8;
+        auto end = table + min<size_t>(*reinterpret_cast<DWORD const*>(buffer.data() + 4), size - 8);
+
+        // Each structure is a formatted area (type, length, handle, ...) followed by strings ending with two nulls
+        for (auto structure = table; structure + 4 <= end && structure[1] >= 4 && structure + structure[1] <= end;) {
+            uint8_t type = structure[0];
+            uint8_t length = structure[1];
+            if (type == 0 && length > 4) {
+                // BIOS information
+                result.manufacturer = get_smbios_string(structure, end, structure[4]);
+            } else if (type == 1 && length > 7) {
+                // System information
+                result.product_name = get_smbios_string(structure, end, structure[5]);
+                result.serial_number = get_smbios_string(structure, end, structure[7]);
+            } else if (type == 127) {
+                // End of table
+                break;
+            }
+
+            auto next = structure + length;
+            while (next + 1 < end && (next[0] != 0 || next[1] != 0)) {
+                ++next;
+            }
+            structure = next + 2;
+        }
+    }
+
     dmi_resolver::data dmi_resolver::collect_data(collection& facts)
     {
         data result;
 
-        auto vals = _wmi->query(wmi::computersystemproduct, {wmi::name});
-        result.product_name = wmi::get(vals, wmi::name);
+        // Read the SMBIOS tables directly; query WMI only for what they don't provide
+        collect_smbios_data(result);
+        if (!result.product_name.empty() && !result.serial_number.empty() && !result.manufacturer.empty()) {
+            return result;
+        }
 
-        vals = _wmi->query(wmi::bios, {wmi::manufacturer, wmi::serialnumber});
-        result.serial_number = wmi::get(vals, wmi::serialnumber);
-        result.manufacturer = wmi::get(vals, wmi::manufacturer);
+        LOG_DEBUG("DMI information is not available natively; querying WMI.");
+        auto vals = _wmi->query({
+            {wmi::computersystemproduct, {wmi::name}},
+            {wmi::bios, {wmi::manufacturer, wmi::serialnumber}},
+        });
+        if (result.product_name.empty() && !vals[0].empty()) {
+            result.product_name = wmi::get(vals[0], wmi::name);
+        }
+        if (result.serial_number.empty() && !vals[1].empty()) {
+            result.serial_number = wmi::get(vals[1], wmi::serialnumber);
+        }
+        if (result.manufacturer.empty() && !vals[1].empty()) {
+            result.manufacturer = wmi::get(vals[1], wmi::manufacturer);
+        }
 
         return result;
     }
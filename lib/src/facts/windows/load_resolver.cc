@@ -0,0 +1,88 @@
+#include <internal/facts/windows/load_resolver.hpp>
+#include <internal/util/windows/system_error.hpp>
+#include <internal/util/windows/windows.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/nowide/convert.hpp>
+#include <boost/thread/locks.hpp>
+#include <pdh.h>
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::util::windows;
+
+namespace facter { namespace facts { namespace windows {
+
+    // Adds a counter by its English path, so that the path works regardless of the system's language
+    static PDH_HCOUNTER add_counter(PDH_HQUERY query, wchar_t const* path)
+    {
+        // PdhAddEnglishCounter is not available on Windows Server 2003; fall back to the localized path there.
+        typedef PDH_STATUS (WINAPI *LPFN_PDHADDENGLISHCOUNTER) (PDH_HQUERY, LPCWSTR, DWORD_PTR, PDH_HCOUNTER*);
+        LPFN_PDHADDENGLISHCOUNTER fnPdhAddEnglishCounter = (LPFN_PDHADDENGLISHCOUNTER)
+                GetProcAddress(GetModuleHandleW(L"pdh"), "PdhAddEnglishCounterW");
+
+        PDH_HCOUNTER counter = nullptr;
+        auto status = fnPdhAddEnglishCounter ?
+            fnPdhAddEnglishCounter(query, path, 0, &counter) :
+            PdhAddCounterW(query, path, 0, &counter);
+        if (status != ERROR_SUCCESS) {
+            LOG_DEBUG("failure adding performance counter %1%: %2%", boost::nowide::narrow(path), system_error(status));
+            return nullptr;
+        }
+        return counter;
+    }
+
+    static bool get_counter_value(PDH_HCOUNTER counter, double& value)
+    {
+        PDH_FMT_COUNTERVALUE formatted;
+        if (!counter || PdhGetFormattedCounterValue(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, nullptr, &formatted) != ERROR_SUCCESS ||
+            formatted.CStatus != ERROR_SUCCESS) {
+            return false;
+        }
+        value = formatted.doubleValue;
+        return true;
+    }
+
+    load_resolver::load_resolver() :
+        _query(nullptr, [](void* query) { if (query) PdhCloseQuery(query); }),
+        _cpu(nullptr),
+        _disk(nullptr),
+        _sampled(false)
+    {
+    }
+
+    load_resolver::data load_resolver::collect_data(collection& facts)
+    {
+        data result;
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        if (!_query) {
+            PDH_HQUERY query = nullptr;
+            auto status = PdhOpenQueryW(nullptr, 0, &query);
+            if (status != ERROR_SUCCESS) {
+                LOG_DEBUG("failure opening performance counter query: %1%", system_error(status));
+                return result;
+            }
+            _query = scoped_resource<void*>(move(query), [](void* query) { if (query) PdhCloseQuery(query); });
+            _cpu = add_counter(_query, L"\\Processor(_Total)\\% Processor Time");
+            _disk = add_counter(_query, L"\\PhysicalDisk(_Total)\\Avg. Disk Queue Length");
+        }
+
+        // Each collection completes the rates since the one before; the first only starts them
+        auto status = PdhCollectQueryData(_query);
+        if (status != ERROR_SUCCESS) {
+            LOG_DEBUG("failure collecting performance counters: %1%", system_error(status));
+            return result;
+        }
+        if (!_sampled) {
+            _sampled = true;
+            LOG_DEBUG("performance counters were sampled for the first time: utilization is available from the next resolution.");
+            return result;
+        }
+
+        result.utilization_available =
+            get_counter_value(_cpu, result.cpu_utilization) &&
+            get_counter_value(_disk, result.disk_queue_length);
+        return result;
+    }
+
+}}}  // namespace facter::facts::windows
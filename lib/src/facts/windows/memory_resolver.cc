@@ -2,7 +2,6 @@
 #include <internal/util/windows/system_error.hpp>
 #include <internal/util/windows/windows.hpp>
 #include <leatherman/logging/logging.hpp>
-#include <psapi.h>
 
 using namespace facter::util::windows;
 
@@ -10,15 +9,16 @@ namespace facter { namespace facts { namespace windows {
 
     memory_resolver::data memory_resolver::collect_data(collection& facts)
     {
-        PERFORMANCE_INFORMATION statex;
-        if (!GetPerformanceInfo(&statex, sizeof(statex))) {
+        MEMORYSTATUSEX statex;
+        statex.dwLength = sizeof(statex);
+        if (!GlobalMemoryStatusEx(&statex)) {
             LOG_DEBUG("resolving memory facts failed: %1%", system_error());
             return {};
         }
 
         data result;
-        result.mem_total = statex.PhysicalTotal*statex.PageSize;
-        result.mem_free = statex.PhysicalAvailable*statex.PageSize;
+        result.mem_total = statex.ullTotalPhys;
+        result.mem_free = statex.ullAvailPhys;
         return result;
     }
 
@@ -5,6 +5,7 @@
 #include <internal/util/windows/windows.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/locks.hpp>
 #include <boost/range/combine.hpp>
 #include <boost/nowide/convert.hpp>
 #include <iomanip>
@@ -160,13 +161,21 @@ namespace facter { namespace facts { namespace windows {
             LOG_DEBUG("failure getting networking::domain fact: %1%", e.what());
         }
 
-        // Get linked list of adapters.
+        // Get linked list of adapters, with their gateways where supported (after Windows Server 2003).
         ULONG family = AF_UNSPEC;
         ULONG flags = GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER;
+        if (_convertLengthToIpv4Mask) {
+            flags |= GAA_FLAG_INCLUDE_GATEWAYS;
+        }
 
-        // Pre-allocate and try several times, because the adapter configuration may change between calls.
-        ULONG outBufLen = 15000;
-        vector<char> pAddresses(outBufLen);
+        // Reuse the buffer of the last resolve, growing it if needed.
+        // Try several times, because the adapter configuration may change between calls.
+        boost::lock_guard<boost::mutex> lock(_addresses_mutex);
+        if (_addresses.empty()) {
+            _addresses.resize(15000);
+        }
+        auto& pAddresses = _addresses;
+        ULONG outBufLen = static_cast<ULONG>(pAddresses.size());
         DWORD err;
         for (int i = 0; i < 3; ++i) {
             err = GetAdaptersAddresses(family, flags, nullptr,
@@ -189,6 +198,7 @@ namespace facter { namespace facts { namespace windows {
         wsa winsock;
 
         map<string, pair<string, string>> adapterInfoMasks;
+        bool gateway_found = false;
         for (auto pCurAddr = reinterpret_cast<PIP_ADAPTER_ADDRESSES>(pAddresses.data());
             pCurAddr; pCurAddr = pCurAddr->Next) {
             if (pCurAddr->OperStatus != IfOperStatusUp ||
@@ -204,9 +214,14 @@ namespace facter { namespace facts { namespace windows {
             interface net_interface;
             net_interface.name = boost::nowide::narrow(pCurAddr->FriendlyName);
 
+            // Skip filtered interfaces before anything else is looked up for them
+            if (!is_interface_included(result, net_interface.name)) {
+                continue;
+            }
+
             // Only supported on platforms after Windows Server 2003.
             if (pCurAddr->Flags & IP_ADAPTER_DHCP_ENABLED && pCurAddr->Length >= sizeof(IP_ADAPTER_ADDRESSES_LH)) {
-                auto adapter = reinterpret_cast<IP_ADAPTER_ADDRESSES_LH&>(*pCurAddr);
+                auto& adapter = reinterpret_cast<IP_ADAPTER_ADDRESSES_LH&>(*pCurAddr);
                 net_interface.dhcp_server = winsock.saddress_to_string(adapter.Dhcpv4Server);
             }
 
@@ -237,7 +252,7 @@ namespace facter { namespace facts { namespace windows {
 
                     if (adapterInfoMasks.empty()) {
                         // Need to do lookup based on the structure length.
-                        auto adapterAddr = reinterpret_cast<IP_ADAPTER_UNICAST_ADDRESS_LH&>(*it);
+                        auto& adapterAddr = reinterpret_cast<IP_ADAPTER_UNICAST_ADDRESS_LH&>(*it);
                         auto mask = create_ipv4_mask(adapterAddr.OnLinkPrefixLength);
                         net_interface.netmask.v4 = winsock.address_to_string(mask);
 
@@ -262,7 +277,7 @@ namespace facter { namespace facts { namespace windows {
 
                     // Get mask if on a system later than Windows Server 2003. On 2003, we can't retrieve IPv6 masks.
                     if (adapterInfoMasks.empty()) {
-                        auto adapterAddr = reinterpret_cast<IP_ADAPTER_UNICAST_ADDRESS_LH&>(*it);
+                        auto& adapterAddr = reinterpret_cast<IP_ADAPTER_UNICAST_ADDRESS_LH&>(*it);
                         auto mask = create_ipv6_mask(adapterAddr.OnLinkPrefixLength);
                         net_interface.netmask.v6 = winsock.address_to_string(mask);
 
@@ -276,11 +291,17 @@ namespace facter { namespace facts { namespace windows {
                 }
             }
 
-            // http://support.microsoft.com/kb/894564 talks about how binding order is determined.
+            // The primary interface is the first with a default gateway, if gateways were returned.
+            // Otherwise, http://support.microsoft.com/kb/894564 talks about how binding order is determined.
             // GetAdaptersAddresses returns adapters in binding order. This way, the domain and primary_interface match.
             // The old facter behavior didn't make a lot of sense (it would pick the last in binding order, not 1st).
             // Only accept this as a primary interface if it has a non-link-local address.
-            if (result.primary_interface.empty() &&
+            bool routed = (flags & GAA_FLAG_INCLUDE_GATEWAYS) && pCurAddr->Length >= sizeof(IP_ADAPTER_ADDRESSES_LH) &&
+                reinterpret_cast<IP_ADAPTER_ADDRESSES_LH&>(*pCurAddr).FirstGatewayAddress;
+            if (routed && !gateway_found) {
+                result.primary_interface = net_interface.name;
+                gateway_found = true;
+            } else if (result.primary_interface.empty() &&
                 (!ignored_ipv4_address(net_interface.address.v4) ||
                  !ignored_ipv6_address(net_interface.address.v6))) {
                 result.primary_interface = net_interface.name;
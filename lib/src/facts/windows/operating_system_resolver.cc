@@ -67,7 +67,7 @@ namespace facter { namespace facts { namespace windows {
     {
         // For most, the architecture is the same as the model.
         // For others /(i[3456]86|pentium)/, use x86
-        if (re_search(hardware, boost::regex("i[3456]86|pentium"))) {
+        if (re_search(hardware, cached_regex("i[3456]86|pentium"))) {
             return "x86";
         }
         return hardware;
@@ -101,6 +101,11 @@ namespace facter { namespace facts { namespace windows {
     {
     }
 
+    bool operating_system_resolver::is_thread_safe() const
+    {
+        return false;
+    }
+
     operating_system_resolver::data operating_system_resolver::collect_data(collection& facts)
     {
         // Default to the base implementation
@@ -115,14 +120,26 @@ namespace facter { namespace facts { namespace windows {
             return result;
         }
 
-        auto vals = _wmi->query(wmi::operatingsystem, {wmi::producttype, wmi::othertypedescription});
-        if (vals.empty()) {
-            return result;
+        // The product type and R2 marker are available natively; query WMI only if they aren't
+        bool consumerrel = false;
+        bool r2 = false;
+        OSVERSIONINFOEXW info = {};
+        info.dwOSVersionInfoSize = sizeof(info);
+        if (GetVersionExW(reinterpret_cast<OSVERSIONINFOW*>(&info))) {
+            consumerrel = info.wProductType == VER_NT_WORKSTATION;
+            r2 = GetSystemMetrics(SM_SERVERR2) != 0;
+        } else {
+            LOG_DEBUG("GetVersionEx failed: %1%: querying WMI for the product type.", system_error());
+            auto vals = _wmi->query(wmi::operatingsystem, {wmi::producttype, wmi::othertypedescription});
+            if (vals.empty()) {
+                return result;
+            }
+            consumerrel = (wmi::get(vals, wmi::producttype) == "1");
+            r2 = (wmi::get(vals, wmi::othertypedescription) == "R2");
         }
 
         // Override default release with Windows release names
         auto version = result.release.substr(0, lastDot);
-        bool consumerrel = (wmi::get(vals, wmi::producttype) == "1");
         if (version == "6.4") {
             result.release = consumerrel ? "10" : result.release;
         } else if (version == "6.3") {
@@ -137,7 +154,7 @@ namespace facter { namespace facts { namespace windows {
             if (consumerrel) {
                 result.release = "XP";
             } else {
-                result.release = (wmi::get(vals, wmi::othertypedescription) == "R2") ? "2003 R2" : "2003";
+                result.release = r2 ? "2003 R2" : "2003";
             }
         }
 
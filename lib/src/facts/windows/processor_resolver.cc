@@ -1,7 +1,12 @@
 #include <internal/facts/windows/processor_resolver.hpp>
+#include <facter/util/string.hpp>
+#include <internal/util/windows/registry.hpp>
+#include <internal/util/windows/system_error.hpp>
+#include <internal/util/windows/windows.hpp>
 #include <internal/util/windows/wmi.hpp>
 #include <internal/util/regex.hpp>
 #include <leatherman/logging/logging.hpp>
+#include <bitset>
 
 using namespace std;
 using namespace facter::util;
@@ -15,6 +20,87 @@ namespace facter { namespace facts { namespace windows {
     {
     }
 
+    bool processor_resolver::is_thread_safe() const
+    {
+        return false;
+    }
+
+    // Transforms the numerical architecture into a string based on
+    // https://msdn.microsoft.com/en-us/library/aa394373%28v=vs.85%29.aspx.
+    // The PROCESSOR_ARCHITECTURE_* values of GetNativeSystemInfo use the same numbering.
+    static string get_isa(int architecture)
+    {
+        switch (architecture) {
+            case 0:
+                return "x86";
+            case 1:
+                return "MIPS";
+            case 2:
+                return "Alpha";
+            case 3:
+                return "PowerPC";
+            case 5:
+                return "ARM";
+            case 6:
+                return "Itanium-based systems";
+            case 9:
+                return "x64";
+            default:
+                LOG_DEBUG("Unable to determine processor type: unknown architecture");
+                return {};
+        }
+    }
+
+    // Returns physical_count, logical_count, models, isa, speed from the system rather than WMI
+    // The physical count is zero if the processor packages can't be determined (e.g. on Server 2003)
+    static tuple<int, int, vector<string>, string, int64_t> get_native_processors()
+    {
+        int physical_count = 0;
+        int logical_count = 0;
+
+        // GetLogicalProcessorInformation is not available on all supported versions of Windows.
+        typedef BOOL (WINAPI *LPFN_GLPI) (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION, PDWORD);
+        LPFN_GLPI fnGetLogicalProcessorInformation = (LPFN_GLPI)
+                GetProcAddress(GetModuleHandleW(L"kernel32"), "GetLogicalProcessorInformation");
+        DWORD length = 0;
+        if (nullptr != fnGetLogicalProcessorInformation &&
+            !fnGetLogicalProcessorInformation(nullptr, &length) && GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+            vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+            if (fnGetLogicalProcessorInformation(infos.data(), &length)) {
+                for (auto const& info : infos) {
+                    if (info.Relationship == RelationProcessorPackage) {
+                        ++physical_count;
+                    } else if (info.Relationship == RelationProcessorCore) {
+                        logical_count += bitset<sizeof(ULONG_PTR) * 8>(info.ProcessorMask).count();
+                    }
+                }
+            } else {
+                LOG_DEBUG("GetLogicalProcessorInformation failed: %1%", system_error());
+            }
+        }
+
+        // Every package is described by the name of the first processor
+        vector<string> models;
+        if (physical_count > 0) {
+            try {
+                auto name = registry::get_registry_string(registry::HKEY::LOCAL_MACHINE,
+                    "HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0", "ProcessorNameString");
+                models.resize(physical_count, name);
+            } catch (registry_exception& e) {
+                LOG_DEBUG("failure getting processor name: %1%", e.what());
+                physical_count = 0;
+            }
+        }
+
+        SYSTEM_INFO sysInfo;
+        GetNativeSystemInfo(&sysInfo);
+        if (logical_count == 0) {
+            logical_count = sysInfo.dwNumberOfProcessors;
+        }
+
+        return make_tuple(physical_count, logical_count, move(models), get_isa(sysInfo.wProcessorArchitecture), 0);
+    }
+
     // Returns physical_count, logical_count, models, isa, speed
     static tuple<int, int, vector<string>, string, int64_t> get_processors(wmi const& _wmi)
     {
@@ -22,7 +108,13 @@ namespace facter { namespace facts { namespace windows {
         string isa;
         int logical_count = 0;
 
-        auto procs = _wmi.query(wmi::processor, {wmi::name, wmi::architecture});
+        // Query number of logical processors separately; it's not supported on Server 2003, and will cause
+        // the entire query to return empty if used. Both queries are issued together.
+        auto vals = _wmi.query({
+            {wmi::processor, {wmi::name, wmi::architecture}},
+            {wmi::processor, {wmi::numberoflogicalprocessors}},
+        });
+        auto const& procs = vals[0];
         if (procs.empty()) {
             LOG_DEBUG("WMI processor Name, Architecture query returned no results.");
         }
@@ -31,45 +123,19 @@ namespace facter { namespace facts { namespace windows {
             models.emplace_back(wmi::get(procobj, wmi::name));
 
             if (isa.empty()) {
-                // Query for architecture and transform numerical ID into a string based on
-                // https://msdn.microsoft.com/en-us/library/aa394373%28v=vs.85%29.aspx.
                 // Use the architecture of the first result.
-                int architecture = stoi(wmi::get(procobj, wmi::architecture));
-
-                switch (architecture) {
-                    case 0:
-                        isa = "x86";
-                        break;
-                    case 1:
-                        isa = "MIPS";
-                        break;
-                    case 2:
-                        isa = "Alpha";
-                        break;
-                    case 3:
-                        isa = "PowerPC";
-                        break;
-                    case 5:
-                        isa = "ARM";
-                        break;
-                    case 6:
-                        isa = "Itanium-based systems";
-                        break;
-                    case 9:
-                        isa = "x64";
-                        break;
-                    default:
-                        LOG_DEBUG("Unable to determine processor type: unknown architecture");
-                        break;
+                int64_t architecture;
+                if (parse_integer(wmi::get(procobj, wmi::architecture), architecture)) {
+                    isa = get_isa(static_cast<int>(architecture));
                 }
             }
         }
 
-        // Query number of logical processors separately; it's not supported on Server 2003, and will cause
-        // the entire query to return empty if used.
-        auto logicalprocs = _wmi.query(wmi::processor, {wmi::numberoflogicalprocessors});
-        for (auto const& objs : logicalprocs) {
-            logical_count += stoi(wmi::get(objs, wmi::numberoflogicalprocessors));
+        for (auto const& objs : vals[1]) {
+            int64_t count;
+            if (parse_integer(wmi::get(objs, wmi::numberoflogicalprocessors), count)) {
+                logical_count += static_cast<int>(count);
+            }
         }
 
         if (logical_count == 0) {
@@ -82,7 +148,11 @@ namespace facter { namespace facts { namespace windows {
     processor_resolver::data processor_resolver::collect_data(collection& facts)
     {
         data result;
-        tie(result.physical_count, result.logical_count, result.models, result.isa, result.speed) = get_processors(*_wmi);
+        tie(result.physical_count, result.logical_count, result.models, result.isa, result.speed) = get_native_processors();
+        if (result.physical_count == 0 || result.isa.empty()) {
+            LOG_DEBUG("processor information is not available natively; querying WMI.");
+            tie(result.physical_count, result.logical_count, result.models, result.isa, result.speed) = get_processors(*_wmi);
+        }
         return result;
     }
 
@@ -1,4 +1,5 @@
 #include <internal/facts/windows/uptime_resolver.hpp>
+#include <internal/util/windows/windows.hpp>
 #include <internal/util/windows/wmi.hpp>
 #include <internal/util/regex.hpp>
 #include <leatherman/logging/logging.hpp>
@@ -17,6 +18,19 @@ namespace facter { namespace facts { namespace windows {
         resolvers::uptime_resolver(),
         _wmi(move(wmi_conn))
     {
+        // Find GetTickCount64 and save it to _getTickCount64. Won't be found on Windows Server 2003,
+        // where the uptime is queried from WMI instead.
+        auto func = GetProcAddress(GetModuleHandleW(L"kernel32"), "GetTickCount64");
+        if (nullptr != func) {
+            typedef ULONGLONG (WINAPI *LPFN_GETTICKCOUNT64) ();
+            _getTickCount64 = reinterpret_cast<LPFN_GETTICKCOUNT64>(func);
+        }
+    }
+
+    bool uptime_resolver::is_thread_safe() const
+    {
+        // Only the WMI connection is bound to the thread that initialized COM
+        return static_cast<bool>(_getTickCount64);
     }
 
     static ptime get_ptime(string const& wmitime)
@@ -33,6 +47,13 @@ namespace facter { namespace facts { namespace windows {
 
     int64_t uptime_resolver::get_uptime()
     {
+        if (_getTickCount64) {
+            return static_cast<int64_t>(_getTickCount64() / 1000);
+        }
+        if (!_wmi) {
+            return -1;
+        }
+
         auto vals = _wmi->query(wmi::operatingsystem, {wmi::lastbootuptime, wmi::localdatetime});
         if (vals.empty()) {
             return -1;
@@ -20,6 +20,11 @@ namespace facter { namespace facts { namespace windows {
     {
     }
 
+    bool virtualization_resolver::is_thread_safe() const
+    {
+        return false;
+    }
+
     string virtualization_resolver::get_hypervisor(collection& facts)
     {
         // TODO: This is probably not equivalent to line 194 of
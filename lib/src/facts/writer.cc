@@ -0,0 +1,630 @@
+#include <internal/facts/writer.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/query.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/facts/value_visitor.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/facts/yaml_writer.hpp>
+#include <internal/util/pooled_stream.hpp>
+#include <internal/util/thread_pool.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+using namespace facter::util;
+using namespace rapidjson;
+
+namespace facter { namespace facts {
+
+    vector<string> split_query(string const& query)
+    {
+        vector<string> segments;
+        bool in_quotes = false;
+        string segment;
+        for (auto const& c : query) {
+            if (c == '"') {
+                in_quotes = !in_quotes;
+                continue;
+            }
+            if (in_quotes || c != '.') {
+                segment += c;
+                continue;
+            }
+            segments.emplace_back(move(segment));
+            segment.clear();
+        }
+        if (!segment.empty()) {
+            segments.emplace_back(move(segment));
+        }
+        return segments;
+    }
+
+    value const* query_value(string const& text, fact_getter const& get)
+    {
+        return query(text).evaluate(get);
+    }
+
+    static vector<pair<string, value const*>> select_facts(set<string> const& queries, fact_getter const& get)
+    {
+        vector<pair<string, value const*>> facts;
+        for (auto const& text : queries) {
+            query compiled(text);
+            if (!compiled.wildcard()) {
+                facts.push_back(make_pair(text, compiled.evaluate(get)));
+                continue;
+            }
+
+            // A wildcard query is output as the path of each value it selects
+            size_t count = facts.size();
+            compiled.each(get, [&](vector<string> const& path, value const* val) {
+                facts.push_back(make_pair(query::join(path), val));
+                return true;
+            });
+            if (facts.size() == count) {
+                facts.push_back(make_pair(text, nullptr));
+            }
+        }
+        return facts;
+    }
+
+    // A top-level fact that is formatted into its own buffer
+    struct formatted_fact
+    {
+        formatted_fact(string const& key, value const* val) :
+            key(key),
+            val(val),
+            native(true)
+        {
+        }
+
+        string key;
+        value const* val;
+        bool native;
+        string output;
+    };
+
+    // Determines if a value can be formatted on any thread
+    // Other values (e.g. Ruby values) are only formatted on the calling thread; lazy values are evaluated here
+    static bool is_native(value const* val)
+    {
+        auto resolved = lazy_value::resolve(val);
+        if (!resolved) {
+            return true;
+        }
+        bool native = true;
+        switch (resolved->type()) {
+            case value_type::array:
+                static_cast<array_value const*>(resolved)->each([&](value const* element) {
+                    native = is_native(element);
+                    return native;
+                });
+                break;
+            case value_type::map:
+                static_cast<map_value const*>(resolved)->each([&](string const&, value const* element) {
+                    native = is_native(element);
+                    return native;
+                });
+                break;
+            default:
+                native = resolved->type() != value_type::other;
+                break;
+        }
+        return native;
+    }
+
+    // Gathers the facts to format in parallel, skipping facts with hidden values
+    static vector<formatted_fact> gather_facts(fact_enumerator const& each)
+    {
+        vector<formatted_fact> facts;
+        each([&](string const& key, value const* val) {
+            if (val && val->hidden()) {
+                return;
+            }
+            facts.emplace_back(key, val);
+        });
+        for (auto& fact : facts) {
+            fact.native = is_native(fact.val);
+        }
+        return facts;
+    }
+
+    // Formats each fact into its own buffer using the pool's threads; the output is then written in order
+    static void format_facts(vector<formatted_fact>& facts, unsigned int concurrency, function<void(formatted_fact&)> const& format)
+    {
+        if (facts.empty()) {
+            return;
+        }
+
+        atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next++; i < facts.size(); i = next++) {
+                if (facts[i].native) {
+                    format(facts[i]);
+                }
+            }
+        };
+
+        // The calling thread formats the facts that must be formatted on it, then helps with the rest
+        auto threads = max<size_t>(min<size_t>(concurrency, facts.size()), 1);
+        auto& pool = thread_pool::instance();
+        pool.reserve(static_cast<unsigned int>(threads - 1));
+        task_group group(pool);
+        for (size_t i = 1; i < threads; ++i) {
+            group.run(worker);
+        }
+        for (auto& fact : facts) {
+            if (!fact.native) {
+                format(fact);
+            }
+        }
+        worker();
+        group.wait();
+    }
+
+    // Writes the formatted facts to the stream, separated by the given separator
+    static void write_formatted(ostream& stream, vector<formatted_fact>& facts, char const* separator)
+    {
+        bool first = true;
+        for (auto& fact : facts) {
+            if (first) {
+                first = false;
+            } else {
+                stream << separator;
+            }
+            stream.write(fact.output.data(), fact.output.size());
+            string().swap(fact.output);
+        }
+    }
+
+    // Determines if the facts of the enumerator are formatted in parallel
+    static bool is_parallel(set<string> const& queries, unsigned int concurrency)
+    {
+        // Queried facts are few, so they're always formatted on the calling thread
+        return queries.empty() && concurrency > 1;
+    }
+
+    static void write_hash(ostream& stream, set<string> const& queries, fact_enumerator const& each, fact_getter const& get, unsigned int concurrency)
+    {
+        // Format into a reused buffer and write it out in large blocks rather than formatting into the stream
+        pooled_stream output;
+
+        // If there's only one query that selects a single value, print the result without the name
+        if (queries.size() == 1 && !query(*queries.begin()).wildcard()) {
+            auto value = query_value(*queries.begin(), get);
+            if (value) {
+                value->write(output.stream(), false);
+            }
+            output.flush_to(stream);
+            return;
+        }
+
+        if (is_parallel(queries, concurrency)) {
+            auto facts = gather_facts(each);
+            format_facts(facts, concurrency, [](formatted_fact& fact) {
+                pooled_stream formatted;
+                formatted.stream() << fact.key << " => ";
+                if (fact.val) {
+                    fact.val->write(formatted.stream(), false);
+                }
+                fact.output = formatted.str();
+            });
+            write_formatted(stream, facts, "\n");
+            return;
+        }
+
+        bool first = true;
+        auto writer = ([&](string const& key, value const* val) {
+            // Ignore facts with hidden values
+            if (queries.empty() && val && val->hidden()) {
+                return;
+            }
+            auto& os = output.stream();
+            if (first) {
+                first = false;
+            } else {
+                os << '\n';
+            }
+            os << key << " => ";
+            if (val) {
+                val->write(os, false);
+            }
+            if (output.str().size() >= 64 * 1024) {
+                output.flush_to(stream);
+            }
+        });
+
+        if (!queries.empty()) {
+            // Print queried facts
+            for (auto const& kvp : select_facts(queries, get)) {
+                writer(kvp.first, kvp.second);
+            }
+        } else {
+            // Print all facts with values
+            each(writer);
+        }
+        output.flush_to(stream);
+    }
+
+    // Buffers the characters written by rapidjson rather than writing them to the stream one at a time
+    struct stream_adapter
+    {
+        explicit stream_adapter(ostream& stream) :
+            _stream(stream),
+            _size(0)
+        {
+        }
+
+        ~stream_adapter()
+        {
+            Flush();
+        }
+
+        void Put(char c)
+        {
+            if (_size == sizeof(_buffer)) {
+                Flush();
+            }
+            _buffer[_size++] = c;
+        }
+
+        void Flush()
+        {
+            _stream.write(_buffer, _size);
+            _size = 0;
+        }
+
+     private:
+        ostream& _stream;
+        char _buffer[4096];
+        size_t _size;
+    };
+
+    // Writes values directly to a rapidjson writer without building a document
+    template <typename Writer>
+    struct json_visitor : value_visitor
+    {
+        explicit json_visitor(Writer& writer) :
+            _writer(writer)
+        {
+        }
+
+        virtual void visit(string_value const& val) override
+        {
+            _writer.String(val.value().c_str(), static_cast<SizeType>(val.value().size()));
+        }
+
+        virtual void visit(integer_value const& val) override
+        {
+            _writer.Int64(val.value());
+        }
+
+        virtual void visit(boolean_value const& val) override
+        {
+            _writer.Bool(val.value());
+        }
+
+        virtual void visit(double_value const& val) override
+        {
+            _writer.Double(val.value());
+        }
+
+        virtual void visit(array_value const& val) override
+        {
+            _writer.StartArray();
+            val.each([this](value const* element) {
+                facts::visit(*element, *this);
+                return true;
+            });
+            _writer.EndArray();
+        }
+
+        virtual void visit(map_value const& val) override
+        {
+            _writer.StartObject();
+            val.each([this](string const& name, value const* element) {
+                _writer.String(name.c_str(), static_cast<SizeType>(name.size()));
+                facts::visit(*element, *this);
+                return true;
+            });
+            _writer.EndObject();
+        }
+
+        virtual void visit(value const& val) override
+        {
+            // Other values (e.g. Ruby values) only know how to convert themselves to a document
+            Document document;
+            rapidjson::Value json;
+            val.to_json(document.GetAllocator(), json);
+            json.Accept(_writer);
+        }
+
+     private:
+        Writer& _writer;
+    };
+
+    template <typename Writer>
+    static void emit_json(Writer& writer, set<string> const& queries, fact_enumerator const& each, fact_getter const& get)
+    {
+        json_visitor<Writer> visitor(writer);
+        writer.StartObject();
+
+        auto builder = ([&](string const& key, value const* val) {
+            // Ignore facts with hidden values
+            if (queries.empty() && val && val->hidden()) {
+                return;
+            }
+            writer.String(key.c_str(), static_cast<SizeType>(key.size()));
+            if (val && lazy_value::resolve(val)) {
+                visit(*val, visitor);
+            } else {
+                writer.String("", 0);
+            }
+        });
+
+        if (!queries.empty()) {
+            for (auto const& kvp : select_facts(queries, get)) {
+                builder(kvp.first, kvp.second);
+            }
+        } else {
+            each(builder);
+        }
+        writer.EndObject();
+    }
+
+    static void write_json(ostream& stream, set<string> const& queries, fact_enumerator const& each, fact_getter const& get, bool pretty, unsigned int concurrency)
+    {
+        vector<formatted_fact> facts;
+        if (is_parallel(queries, concurrency)) {
+            facts = gather_facts(each);
+        }
+        if (!facts.empty()) {
+            // Each fact is formatted as the only member of an object, which is then removed from around the member
+            format_facts(facts, concurrency, [&](formatted_fact& fact) {
+                StringBuffer buffer;
+                auto one = [&](function<void(string const&, value const*)> const& func) {
+                    func(fact.key, fact.val);
+                };
+                if (pretty) {
+                    PrettyWriter<StringBuffer> writer(buffer);
+                    writer.SetIndent(' ', 2);
+                    emit_json(writer, {}, one, get);
+                } else {
+                    Writer<StringBuffer> writer(buffer);
+                    emit_json(writer, {}, one, get);
+                }
+                size_t enclosing = pretty ? 2 : 1;
+                fact.output.assign(buffer.GetString() + enclosing, buffer.Size() - enclosing * 2);
+            });
+            stream << (pretty ? "{\n" : "{");
+            write_formatted(stream, facts, pretty ? ",\n" : ",");
+            stream << (pretty ? "\n}" : "}");
+            return;
+        }
+
+        stream_adapter adapter(stream);
+        if (pretty) {
+            PrettyWriter<stream_adapter> writer(adapter);
+            writer.SetIndent(' ', 2);
+            emit_json(writer, queries, each, get);
+        } else {
+            Writer<stream_adapter> writer(adapter);
+            emit_json(writer, queries, each, get);
+        }
+    }
+
+    static void write_ndjson(ostream& stream, set<string> const& queries, fact_enumerator const& each, fact_getter const& get)
+    {
+        // Each line is flushed as soon as it is written so that a consumer can process it before the next fact is resolved
+        auto write_line = ([&](string const& key, value const* val) {
+            // Ignore facts with hidden values
+            if (queries.empty() && val && val->hidden()) {
+                return;
+            }
+            {
+                stream_adapter adapter(stream);
+                Writer<stream_adapter> writer(adapter);
+                json_visitor<Writer<stream_adapter>> visitor(writer);
+                writer.StartObject();
+                writer.String(key.c_str(), static_cast<SizeType>(key.size()));
+                if (val && lazy_value::resolve(val)) {
+                    visit(*val, visitor);
+                } else {
+                    writer.String("", 0);
+                }
+                writer.EndObject();
+            }
+            stream << '\n' << flush;
+        });
+
+        if (!queries.empty()) {
+            for (auto const& kvp : select_facts(queries, get)) {
+                write_line(kvp.first, kvp.second);
+            }
+        } else {
+            each(write_line);
+        }
+    }
+
+    static void write_msgpack(ostream& stream, set<string> const& queries, fact_enumerator const& each, fact_getter const& get, unsigned int concurrency)
+    {
+        if (is_parallel(queries, concurrency)) {
+            auto facts = gather_facts(each);
+            format_facts(facts, concurrency, [](formatted_fact& fact) {
+                msgpack_writer writer(fact.output);
+                writer.str(fact.key);
+                if (fact.val) {
+                    fact.val->to_msgpack(writer);
+                } else {
+                    writer.nil();
+                }
+            });
+            string header;
+            msgpack_writer(header).start_map(facts.size());
+            stream.write(header.data(), header.size());
+            write_formatted(stream, facts, "");
+            return;
+        }
+
+        // Maps are written with their size first, so gather the facts before writing them
+        vector<pair<string, value const*>> facts;
+        if (!queries.empty()) {
+            facts = select_facts(queries, get);
+            for (auto& kvp : facts) {
+                kvp.second = lazy_value::resolve(kvp.second);
+            }
+        } else {
+            each([&](string const& key, value const* val) {
+                // Ignore facts with hidden values
+                if (val && val->hidden()) {
+                    return;
+                }
+                facts.push_back(make_pair(key, val));
+            });
+        }
+
+        string buffer;
+        msgpack_writer writer(buffer);
+        writer.start_map(facts.size());
+        for (auto const& kvp : facts) {
+            writer.str(kvp.first);
+            if (kvp.second) {
+                kvp.second->to_msgpack(writer);
+            } else {
+                writer.nil();
+            }
+        }
+        stream.write(buffer.data(), buffer.size());
+    }
+
+    static void write_yaml(ostream& stream, set<string> const& queries, fact_enumerator const& each, fact_getter const& get, unsigned int concurrency)
+    {
+        vector<formatted_fact> facts;
+        if (is_parallel(queries, concurrency)) {
+            facts = gather_facts(each);
+        }
+        if (!facts.empty()) {
+            format_facts(facts, concurrency, [](formatted_fact& fact) {
+                pooled_stream formatted;
+                yaml_writer writer(formatted.stream());
+                writer.write(fact.key, fact.val);
+                fact.output = formatted.str();
+            });
+            write_formatted(stream, facts, "\n");
+            return;
+        }
+
+        yaml_writer writer(stream);
+
+        auto write = ([&](string const& key, value const* val) {
+            // Ignore facts with hidden values
+            if (queries.empty() && val && val->hidden()) {
+                return;
+            }
+            writer.write(key, val);
+        });
+
+        if (!queries.empty()) {
+            for (auto const& kvp : select_facts(queries, get)) {
+                write(kvp.first, kvp.second);
+            }
+        } else {
+            each(write);
+        }
+        writer.end();
+    }
+
+    // A node in the tree of values selected by projected queries
+    struct projected_node
+    {
+        projected_node() :
+            val(nullptr)
+        {
+        }
+
+        value const* val;
+        map<string, projected_node> children;
+    };
+
+    static void project_value(projected_node& root, vector<string> const& path, value const* current)
+    {
+        auto node = &root;
+        for (auto const& segment : path) {
+            // A query for an enclosing value already selects this one
+            if (node->val) {
+                return;
+            }
+            node = &node->children[segment];
+        }
+        node->val = current;
+        node->children.clear();
+    }
+
+    static void project_query(projected_node& root, string const& text, fact_getter const& get)
+    {
+        query(text).each(get, [&](vector<string> const& path, value const* current) {
+            project_value(root, path, current);
+            return true;
+        });
+    }
+
+    static shared_ptr<value const> to_value(projected_node const& node)
+    {
+        if (node.val) {
+            // The selected values are owned by the facts being written and outlive the projection
+            return shared_ptr<value const>(node.val, [](value const*) {});
+        }
+        auto map = make_value<map_value>();
+        for (auto const& kvp : node.children) {
+            map->add(kvp.first, to_value(kvp.second));
+        }
+        return shared_ptr<value const>(move(map));
+    }
+
+    void write_facts(ostream& stream, format fmt, set<string> const& queries, fact_enumerator const& each, fact_getter const& get, bool project, unsigned int concurrency)
+    {
+        if (project && !queries.empty() && fmt != format::hash) {
+            // Write the selected values as a pruned tree of the facts they were selected from
+            projected_node root;
+            for (auto const& query : queries) {
+                project_query(root, query, get);
+            }
+            map<string, shared_ptr<value const>> facts;
+            set<string> names;
+            for (auto const& kvp : root.children) {
+                facts.emplace(kvp.first, to_value(kvp.second));
+                names.insert(kvp.first);
+            }
+            write_facts(
+                stream,
+                fmt,
+                names,
+                [](function<void(string const&, value const*)> const&) {},
+                [&](string const& name) -> value const* {
+                    auto it = facts.find(name);
+                    return it == facts.end() ? nullptr : it->second.get();
+                });
+            return;
+        }
+
+        if (fmt == format::hash) {
+            write_hash(stream, queries, each, get, concurrency);
+        } else if (fmt == format::json) {
+            write_json(stream, queries, each, get, true, concurrency);
+        } else if (fmt == format::json_compact) {
+            write_json(stream, queries, each, get, false, concurrency);
+        } else if (fmt == format::yaml) {
+            write_yaml(stream, queries, each, get, concurrency);
+        } else if (fmt == format::msgpack) {
+            write_msgpack(stream, queries, each, get, concurrency);
+        } else if (fmt == format::ndjson) {
+            write_ndjson(stream, queries, each, get);
+        }
+    }
+
+}}  // namespace facter::facts
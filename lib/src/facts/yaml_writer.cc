@@ -0,0 +1,227 @@
+#include <internal/facts/yaml_writer.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/util/string.hpp>
+#include <internal/util/string_scan.hpp>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+using namespace facter::util;
+
+namespace facter { namespace facts {
+
+    static bool is_plain(string const& str)
+    {
+        if (str.empty() || str == "~" || str == "null" || str == "Null" || str == "NULL") {
+            return false;
+        }
+        if (str.front() == ' ' || str.back() == ' ' || str.back() == ':') {
+            return false;
+        }
+        auto begin = str.data();
+        auto last = begin + str.size();
+        for (auto it = find_plain_special(begin, last); it != last; it = find_plain_special(it + 1, last)) {
+            auto c = static_cast<unsigned char>(*it);
+            if (c < 0x20 || c == 0x7f) {
+                return false;
+            }
+            // ": " starts a mapping value and " #" starts a comment
+            if ((c == ':' && it + 1 < last && it[1] == ' ') ||
+                (c == '#' && it > begin && it[-1] == ' ')) {
+                return false;
+            }
+        }
+
+        // Indicators cannot start a plain scalar, except "-", "?" and ":" when followed by a non-space
+        char first = str.front();
+        if (strchr("-?:,[]{}#&*!|>'\"%@`", first)) {
+            return (first == '-' || first == '?' || first == ':') && str.size() > 1 && str[1] != ' ';
+        }
+        return true;
+    }
+
+    yaml_writer::yaml_writer(ostream& stream) :
+        _stream(stream),
+        _empty(true)
+    {
+    }
+
+    void yaml_writer::write(string const& name, value const* val)
+    {
+        if (!_empty) {
+            _stream << '\n';
+        }
+        _empty = false;
+
+        write_string(name, needs_quotation(name));
+        _stream << ':';
+        if (!val) {
+            _stream << " \"\"";
+            return;
+        }
+        write_value(*val, 2, position::key);
+    }
+
+    void yaml_writer::end()
+    {
+        if (_empty) {
+            _stream << "{}";
+        }
+    }
+
+    void yaml_writer::write_value(value const& val, unsigned int indent, position pos)
+    {
+        auto resolved = lazy_value::resolve(&val);
+        if (!resolved) {
+            _stream << " ~";
+            return;
+        }
+
+        switch (resolved->type()) {
+            case value_type::string: {
+                auto const& str = static_cast<string_value const*>(resolved)->value();
+                _stream << ' ';
+                write_string(str, needs_quotation(str));
+                break;
+            }
+            case value_type::integer:
+                _stream << ' ' << static_cast<integer_value const*>(resolved)->value();
+                break;
+            case value_type::boolean:
+                _stream << ' ' << (static_cast<boolean_value const*>(resolved)->value() ? "true" : "false");
+                break;
+            case value_type::floating_point: {
+                double d = static_cast<double_value const*>(resolved)->value();
+                _stream << ' ';
+                if (std::isnan(d)) {
+                    _stream << ".nan";
+                } else if (std::isinf(d)) {
+                    _stream << (d > 0 ? ".inf" : "-.inf");
+                } else {
+                    auto precision = _stream.precision(numeric_limits<double>::digits10);
+                    _stream << d;
+                    _stream.precision(precision);
+                }
+                break;
+            }
+            case value_type::array: {
+                // Every item of a sequence starts on its own line
+                bool empty = true;
+                static_cast<array_value const*>(resolved)->each([&](value const* element) {
+                    empty = false;
+                    _stream << '\n';
+                    write_indent(indent);
+                    _stream << '-';
+                    write_value(*element, indent + 2, position::item);
+                    return true;
+                });
+                if (empty) {
+                    _stream << '\n';
+                    write_indent(indent);
+                    _stream << "[]";
+                }
+                break;
+            }
+            case value_type::map: {
+                // The first key of a map that is a sequence item is written on the item's line
+                bool first = true;
+                static_cast<map_value const*>(resolved)->each([&](string const& name, value const* element) {
+                    if (pos == position::key || !first) {
+                        _stream << '\n';
+                        write_indent(indent);
+                    } else {
+                        _stream << ' ';
+                    }
+                    first = false;
+                    write_string(name, needs_quotation(name));
+                    _stream << ':';
+                    write_value(*element, indent + 2, position::key);
+                    return true;
+                });
+                if (first) {
+                    if (pos == position::key) {
+                        _stream << '\n';
+                        write_indent(indent);
+                    } else {
+                        _stream << ' ';
+                    }
+                    _stream << "{}";
+                }
+                break;
+            }
+            default: {
+                // Other values (e.g. Ruby values) are written as their copy in fact values
+                auto copy = resolved->clone();
+                if (copy && copy->type() != value_type::other) {
+                    write_value(*copy, indent, pos);
+                } else {
+                    _stream << " ~";
+                }
+                break;
+            }
+        }
+    }
+
+    void yaml_writer::write_string(string const& str, bool quote)
+    {
+        if (!quote && is_plain(str)) {
+            _stream << str;
+            return;
+        }
+
+        static char const digits[] = "0123456789ABCDEF";
+        _stream << '"';
+        auto first = str.data();
+        auto last = first + str.size();
+        while (true) {
+            // Write clean runs of bytes in bulk
+            auto it = find_escape(first, last);
+            _stream.write(first, it - first);
+            if (it == last) {
+                break;
+            }
+            switch (*it) {
+                case '"':
+                    _stream << "\\\"";
+                    break;
+                case '\\':
+                    _stream << "\\\\";
+                    break;
+                case '\n':
+                    _stream << "\\n";
+                    break;
+                case '\t':
+                    _stream << "\\t";
+                    break;
+                case '\r':
+                    _stream << "\\r";
+                    break;
+                case '\b':
+                    _stream << "\\b";
+                    break;
+                case '\f':
+                    _stream << "\\f";
+                    break;
+                default: {
+                    auto byte = static_cast<unsigned char>(*it);
+                    _stream << "\\x" << digits[byte >> 4] << digits[byte & 0xf];
+                    break;
+                }
+            }
+            first = it + 1;
+        }
+        _stream << '"';
+    }
+
+    void yaml_writer::write_indent(unsigned int indent)
+    {
+        for (unsigned int i = 0; i < indent; ++i) {
+            _stream << ' ';
+        }
+    }
+
+}}  // namespace facter::facts
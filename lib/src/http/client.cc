@@ -1,11 +1,25 @@
 #include <facter/http/client.hpp>
 #include <facter/http/request.hpp>
 #include <facter/http/response.hpp>
+#include <facter/util/string.hpp>
+#include <internal/util/log_context.hpp>
+#include <internal/util/probes.hpp>
 #include <internal/util/regex.hpp>
+#include <internal/util/replay_log.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <internal/util/statistics.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/utility/string_ref.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 using namespace facter::util;
@@ -36,14 +50,66 @@ namespace facter { namespace http {
         CURLcode _result;
     };
 
-    curl_handle::curl_handle() :
-        scoped_resource(nullptr, cleanup)
+    // Globally initializes curl once, throwing if initialization failed
+    static void initialize()
     {
-        // Perform initialization
         static curl_init_helper init_helper;
         if (init_helper.result() != CURLE_OK) {
             throw http_exception(curl_easy_strerror(init_helper.result()));
         }
+    }
+
+    // Helper for sharing the connection and DNS caches between the handles of every client
+    // Resolvers each use their own client, possibly on different threads, so the share is locked per kind of data
+    struct curl_share_helper
+    {
+        curl_share_helper()
+        {
+            _share = curl_share_init();
+            if (!_share) {
+                return;
+            }
+            curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, lock);
+            curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, unlock);
+            curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+#if LIBCURL_VERSION_NUM >= 0x073900
+            // Sharing connections requires libcurl 7.57.0; older versions still reuse connections within a client
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+        }
+
+        ~curl_share_helper()
+        {
+            if (_share) {
+                curl_share_cleanup(_share);
+            }
+        }
+
+        CURLSH* share() const
+        {
+            return _share;
+        }
+
+     private:
+        static void lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* ptr)
+        {
+            reinterpret_cast<curl_share_helper*>(ptr)->_mutexes[data % CURL_LOCK_DATA_LAST].lock();
+        }
+
+        static void unlock(CURL* handle, curl_lock_data data, void* ptr)
+        {
+            reinterpret_cast<curl_share_helper*>(ptr)->_mutexes[data % CURL_LOCK_DATA_LAST].unlock();
+        }
+
+        CURLSH* _share;
+        boost::mutex _mutexes[CURL_LOCK_DATA_LAST];
+    };
+
+    curl_handle::curl_handle() :
+        scoped_resource(nullptr, cleanup)
+    {
+        initialize();
 
         _resource = curl_easy_init();
     }
@@ -55,6 +121,21 @@ namespace facter { namespace http {
         }
     }
 
+    curl_multi_handle::curl_multi_handle() :
+        scoped_resource(nullptr, cleanup)
+    {
+        initialize();
+
+        _resource = curl_multi_init();
+    }
+
+    void curl_multi_handle::cleanup(CURLM* multi)
+    {
+        if (multi) {
+            curl_multi_cleanup(multi);
+        }
+    }
+
     curl_list::curl_list() :
         scoped_resource(nullptr, cleanup)
     {
@@ -88,11 +169,133 @@ namespace facter { namespace http {
         }
     }
 
+    // Gets the key of a request in the replay log
+    static string replay_key(char const* method, request const& req)
+    {
+        string key = string(method) + ' ' + req.url();
+        if (!req.body().empty()) {
+            key += '\n';
+            key += req.body();
+        }
+        return key;
+    }
+
+    // Gets the installed replay log if requests are being replayed rather than made
+    static replay_log* replaying()
+    {
+        auto log = replay_log::current();
+        return log && log->mode() == replay_mode::replay ? log : nullptr;
+    }
+
+    // Gets the installed replay log if requests are being recorded
+    static replay_log* recording()
+    {
+        auto log = replay_log::current();
+        return log && log->mode() == replay_mode::record ? log : nullptr;
+    }
+
+    // Adds the response to a request, or the error that failed it, to the replay log
+    static void record(replay_log& log, char const* method, request const& req, response const& res, string body, string error, chrono::steady_clock::time_point start)
+    {
+        replay_entry entry;
+        entry.status = res.status_code();
+        res.each_header([&](string const& name, string const& value) {
+            entry.headers.emplace_back(name, value);
+            return true;
+        });
+        entry.output = move(body);
+        entry.error = move(error);
+        entry.elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+        log.add(replay_key(method, req), move(entry));
+    }
+
+    // Finds the recorded response to a request; a request that wasn't recorded fails as an unreachable host would
+    static replay_entry const& replayed(replay_log& log, char const* method, request const& req)
+    {
+        scoped_statistics::record_http_request();
+        auto entry = log.find(replay_key(method, req));
+        if (!entry) {
+            throw http_request_exception(req, "request was not recorded in the replay log.");
+        }
+        return *entry;
+    }
+
+    // Sets the status and headers of a recorded response, failing the request as it failed when recorded
+    static void replay(request const& req, replay_entry const& entry, response& res)
+    {
+        if (!entry.error.empty()) {
+            throw http_request_exception(req, entry.error);
+        }
+        size_t limit = req.max_body_size();
+        if (limit > 0 && entry.output.size() > limit) {
+            throw http_request_exception(req, (boost::format("response body exceeds the maximum size of %1% bytes.") % limit).str());
+        }
+        res.status_code(entry.status);
+        for (auto const& header : entry.headers) {
+            res.add_header(header.first, header.second);
+        }
+        LOG_DEBUG("replayed recorded response (status %1%).", entry.status);
+    }
+
+    // Sets the body of a recorded response, or passes it to the request's body callback
+    static void replay_body(request const& req, string const& body, response& res)
+    {
+        auto const& callback = req.body_callback();
+        if (!callback) {
+            res.body(body);
+        } else if (!body.empty()) {
+            callback(res, body.data(), body.size());
+        }
+    }
+
+    // Answers requests from the replay log, at most the given number at a time
+    // Each takes its recorded time to complete, so requests complete in the order they would have
+    static void replay_all(replay_log& log, vector<request> requests, function<void(request const&, response&, vector<request>&)> const& callback, size_t concurrency)
+    {
+        // A request that is being replayed
+        struct transfer
+        {
+            request req;
+            replay_entry const* entry;
+            chrono::steady_clock::time_point start;
+        };
+
+        deque<request> pending(make_move_iterator(requests.begin()), make_move_iterator(requests.end()));
+        multimap<chrono::steady_clock::time_point, transfer> active;
+        concurrency = max<size_t>(concurrency, 1);
+
+        while (!pending.empty() || !active.empty()) {
+            while (!pending.empty() && active.size() < concurrency) {
+                auto const& entry = replayed(log, "GET", pending.front());
+                auto start = chrono::steady_clock::now();
+                active.emplace(start + log.latency(entry), transfer{ move(pending.front()), &entry, start });
+                pending.pop_front();
+            }
+
+            auto next_done = active.begin();
+            this_thread::sleep_until(next_done->first);
+            auto done = move(next_done->second);
+            active.erase(next_done);
+
+            scoped_log_context tagging(scoped_log_context::for_url(done.req.url()));
+            scoped_trace_span::record_async("http", done.req.url(), done.start, "method", "GET");
+            response res;
+            replay(done.req, *done.entry, res);
+            replay_body(done.req, done.entry->output, res);
+
+            vector<request> next;
+            callback(done.req, res, next);
+            pending.insert(pending.end(), make_move_iterator(next.begin()), make_move_iterator(next.end()));
+        }
+    }
+
     client::client()
     {
         if (!_handle) {
             throw http_exception("failed to create cURL handle.");
         }
+
+        configure(_handle);
     }
 
     client::client(client&& other)
@@ -121,29 +324,283 @@ namespace facter { namespace http {
         return perform(http_method::put, req);
     }
 
+    void client::get(vector<request> requests, function<void(request const&, response&, vector<request>&)> const& callback, size_t concurrency)
+    {
+        // A request that is in progress
+        struct transfer
+        {
+            transfer(CURL* handle, request req) :
+                req(move(req)),
+                ctx(handle, this->req, res)
+            {
+            }
+
+            request req;
+            response res;
+            context ctx;
+            chrono::steady_clock::time_point start;
+        };
+
+        if (auto log = replaying()) {
+            replay_all(*log, move(requests), callback, concurrency);
+            return;
+        }
+        auto log = recording();
+
+        curl_multi_handle multi;
+        if (!static_cast<CURLM*>(multi)) {
+            throw http_exception("failed to create cURL multi handle.");
+        }
+
+        // Handles are reused by later requests so that their connections are kept alive; this client's handle is the first
+        deque<curl_handle> handles;
+        vector<CURL*> idle = { _handle };
+        map<CURL*, unique_ptr<transfer>> active;
+        deque<request> pending(make_move_iterator(requests.begin()), make_move_iterator(requests.end()));
+        concurrency = max<size_t>(concurrency, 1);
+
+        try {
+            while (!pending.empty() || !active.empty()) {
+                // Start requests until the concurrency limit is reached
+                while (!pending.empty() && active.size() < concurrency) {
+                    if (idle.empty()) {
+                        handles.emplace_back();
+                        if (!static_cast<CURL*>(handles.back())) {
+                            throw http_exception("failed to create cURL handle.");
+                        }
+                        configure(handles.back());
+                        idle.push_back(handles.back());
+                    }
+                    CURL* handle = idle.back();
+                    unique_ptr<transfer> next(new transfer(handle, move(pending.front())));
+                    pending.pop_front();
+
+                    next->ctx.recording = log != nullptr;
+                    prepare(next->ctx, http_method::get);
+                    scoped_statistics::record_http_request();
+                    next->start = chrono::steady_clock::now();
+                    FACTER_PROBE2(http__start, "GET", next->req.url().c_str());
+                    auto result = curl_multi_add_handle(multi, handle);
+                    if (result != CURLM_OK) {
+                        throw http_request_exception(next->req, curl_multi_strerror(result));
+                    }
+                    idle.pop_back();
+                    active.emplace(handle, move(next));
+                }
+
+                int running = 0;
+                auto result = curl_multi_perform(multi, &running);
+                if (result != CURLM_OK) {
+                    throw http_exception(curl_multi_strerror(result));
+                }
+
+                // Pass each completed request to the callback
+                bool completed = false;
+                int remaining = 0;
+                while (auto message = curl_multi_info_read(multi, &remaining)) {
+                    if (message->msg != CURLMSG_DONE) {
+                        continue;
+                    }
+                    completed = true;
+                    CURL* handle = message->easy_handle;
+                    auto code = message->data.result;
+                    curl_multi_remove_handle(multi, handle);
+                    idle.push_back(handle);
+
+                    auto it = active.find(handle);
+                    unique_ptr<transfer> done = move(it->second);
+                    active.erase(it);
+                    scoped_log_context tagging(scoped_log_context::for_url(done->req.url()));
+                    scoped_trace_span::record_async("http", done->req.url(), done->start, "method", "GET");
+                    FACTER_PROBE3(http__end, "GET", done->req.url().c_str(), done->res.status_code());
+                    try {
+                        check_result(done->ctx, code);
+                    } catch (http_exception& ex) {
+                        if (log) {
+                            record(*log, "GET", done->req, done->res, {}, ex.what(), done->start);
+                        }
+                        throw;
+                    }
+
+                    LOG_DEBUG("request completed (status %1%).", done->res.status_code());
+                    if (log) {
+                        record(*log, "GET", done->req, done->res, move(done->ctx.recorded_body), {}, done->start);
+                    }
+                    done->res.body(move(done->ctx.response_buffer));
+
+                    vector<request> next;
+                    callback(done->req, done->res, next);
+                    pending.insert(pending.end(), make_move_iterator(next.begin()), make_move_iterator(next.end()));
+                }
+
+                // Wait for activity unless requests completed; a request is bounded by its own timeouts
+                if (!completed && running > 0) {
+                    result = curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+                    if (result != CURLM_OK) {
+                        throw http_exception(curl_multi_strerror(result));
+                    }
+                }
+            }
+        } catch (...) {
+            // The handles must be removed before the multi handle is cleaned up
+            for (auto& kvp : active) {
+                curl_multi_remove_handle(multi, kvp.first);
+            }
+            throw;
+        }
+    }
+
+    response client::get(request const& req, function<void(response const&, function<bool(string&)> const&)> const& callback)
+    {
+        scoped_log_context tagging(scoped_log_context::for_url(req.url()));
+        scoped_trace_span tracing("http", req.url(), "method", "GET");
+        response res;
+        if (auto log = replaying()) {
+            // The recorded body is received as a single part
+            auto const& entry = replayed(*log, "GET", req);
+            this_thread::sleep_for(log->latency(entry));
+            replay(req, entry, res);
+            bool received = entry.output.empty();
+            callback(res, [&](string& part) {
+                if (received) {
+                    return false;
+                }
+                part = entry.output;
+                received = true;
+                return true;
+            });
+            return res;
+        }
+        auto log = recording();
+
+        context ctx(_handle, req, res);
+        ctx.buffered = false;
+        ctx.recording = log != nullptr;
+        prepare(ctx, http_method::get);
+
+        curl_multi_handle multi;
+        if (!static_cast<CURLM*>(multi)) {
+            throw http_exception("failed to create cURL multi handle.");
+        }
+
+        scoped_statistics::record_http_request();
+        auto start = chrono::steady_clock::now();
+        FACTER_PROBE2(http__start, "GET", req.url().c_str());
+        auto result = curl_multi_add_handle(multi, _handle);
+        if (result != CURLM_OK) {
+            throw http_request_exception(req, curl_multi_strerror(result));
+        }
+
+        // Transfer until part of the body has been received or the transfer is done
+        bool done = false;
+        auto receive = [&]() {
+            while (ctx.response_buffer.empty() && !done) {
+                int running = 0;
+                auto result = curl_multi_perform(multi, &running);
+                if (result != CURLM_OK) {
+                    throw http_request_exception(req, curl_multi_strerror(result));
+                }
+                int remaining = 0;
+                while (auto message = curl_multi_info_read(multi, &remaining)) {
+                    if (message->msg != CURLMSG_DONE) {
+                        continue;
+                    }
+                    done = true;
+                    check_result(ctx, message->data.result);
+                }
+                if (ctx.response_buffer.empty() && !done) {
+                    result = curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+                    if (result != CURLM_OK) {
+                        throw http_request_exception(req, curl_multi_strerror(result));
+                    }
+                }
+            }
+        };
+
+        try {
+            // The headers have been received once the body starts
+            receive();
+            LOG_DEBUG("response received (status %1%).", res.status_code());
+
+            callback(res, [&](string& part) {
+                receive();
+                if (ctx.response_buffer.empty()) {
+                    return false;
+                }
+                // Swap rather than copy so that the buffers are reused for the following parts
+                part.clear();
+                part.swap(ctx.response_buffer);
+                return true;
+            });
+        } catch (http_exception& ex) {
+            curl_multi_remove_handle(multi, _handle);
+            FACTER_PROBE3(http__end, "GET", req.url().c_str(), res.status_code());
+            if (log) {
+                record(*log, "GET", req, res, {}, ex.what(), start);
+            }
+            throw;
+        } catch (...) {
+            curl_multi_remove_handle(multi, _handle);
+            throw;
+        }
+        curl_multi_remove_handle(multi, _handle);
+        FACTER_PROBE3(http__end, "GET", req.url().c_str(), res.status_code());
+
+        // Only the part of the body that was consumed is recorded
+        if (log) {
+            record(*log, "GET", req, res, move(ctx.recorded_body), {}, start);
+        }
+        return res;
+    }
+
     response client::perform(http_method method, request const& req)
     {
+        scoped_log_context tagging(scoped_log_context::for_url(req.url()));
+        char const* name = method == http_method::post ? "POST" : method == http_method::put ? "PUT" : "GET";
+        scoped_trace_span tracing("http", req.url(), "method", name);
         response res;
-        context ctx(req, res);
+        if (auto log = replaying()) {
+            auto const& entry = replayed(*log, name, req);
+            this_thread::sleep_for(log->latency(entry));
+            replay(req, entry, res);
+            replay_body(req, entry.output, res);
+            return res;
+        }
+        auto log = recording();
 
-        // Reset the options
-        curl_easy_reset(_handle);
+        context ctx(_handle, req, res);
+        ctx.recording = log != nullptr;
+        prepare(ctx, method);
 
-        // Set common options
-        auto result = curl_easy_setopt(_handle, CURLOPT_NOPROGRESS, 1);
-        if (result != CURLE_OK) {
-            throw http_request_exception(req, curl_easy_strerror(result));
+        // Perform the request
+        scoped_statistics::record_http_request();
+        auto start = chrono::steady_clock::now();
+        FACTER_PROBE2(http__start, name, req.url().c_str());
+        try {
+            check_result(ctx, curl_easy_perform(_handle));
+        } catch (http_exception& ex) {
+            FACTER_PROBE3(http__end, name, req.url().c_str(), res.status_code());
+            if (log) {
+                record(*log, name, req, res, {}, ex.what(), start);
+            }
+            throw;
         }
-        result = curl_easy_setopt(_handle, CURLOPT_FOLLOWLOCATION, 1);
-        if (result != CURLE_OK) {
-            throw http_request_exception(req, curl_easy_strerror(result));
+
+        FACTER_PROBE3(http__end, name, req.url().c_str(), res.status_code());
+        LOG_DEBUG("request completed (status %1%).", res.status_code());
+        if (log) {
+            record(*log, name, req, res, move(ctx.recorded_body), {}, start);
         }
 
+        // Set the body of the response
+        res.body(move(ctx.response_buffer));
+        return res;
+    }
+
+    void client::prepare(context& ctx, http_method method)
+    {
         // Set tracing from libcurl if enabled (we don't care if this fails)
-        if (LOG_IS_DEBUG_ENABLED()) {
-            curl_easy_setopt(_handle, CURLOPT_DEBUGFUNCTION, debug);
-            curl_easy_setopt(_handle, CURLOPT_VERBOSE, 1);
-        }
+        curl_easy_setopt(ctx.handle, CURLOPT_VERBOSE, LOG_IS_DEBUG_ENABLED() ? 1 : 0);
 
         // Setup the request
         set_method(ctx, method);
@@ -153,29 +610,52 @@ namespace facter { namespace http {
         set_body(ctx);
         set_timeouts(ctx);
         set_write_callbacks(ctx);
+    }
 
-        // Perform the request
-        result = curl_easy_perform(_handle);
-        if (result != CURLE_OK) {
-            throw http_request_exception(req, curl_easy_strerror(result));
+    void client::configure(CURL* handle)
+    {
+        // Handles aren't reset between requests, so that their connections are kept alive and reused
+        // Options that don't change between requests are set once here; the rest are set by each request
+        static curl_share_helper share_helper;
+        if (share_helper.share()) {
+            curl_easy_setopt(handle, CURLOPT_SHARE, share_helper.share());
+        }
+        if (curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1) != CURLE_OK ||
+            curl_easy_setopt(handle, CURLOPT_DEBUGFUNCTION, debug) != CURLE_OK ||
+            curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, progress) != CURLE_OK ||
+            curl_easy_setopt(handle, CURLOPT_READFUNCTION, read_body) != CURLE_OK ||
+            curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, write_header) != CURLE_OK ||
+            curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_body) != CURLE_OK) {
+            throw http_exception("failed to configure cURL handle.");
         }
+    }
 
-        LOG_DEBUG("request completed (status %1%).", res.status_code());
-
-        // Set the body of the response
-        res.body(move(ctx.response_buffer));
-        return res;
+    void client::check_result(context const& ctx, CURLcode result)
+    {
+        // A transfer stopped by the body callback is not a failure
+        if (result == CURLE_OK || ctx.stopped) {
+            return;
+        }
+        if (ctx.exceeded || result == CURLE_FILESIZE_EXCEEDED) {
+            throw http_request_exception(ctx.req, (boost::format("response body exceeds the maximum size of %1% bytes.") % ctx.req.max_body_size()).str());
+        }
+        throw http_request_exception(ctx.req, curl_easy_strerror(result));
     }
 
     void client::set_method(context& ctx, http_method method)
     {
+        // The handle isn't reset between requests, so start from a GET to undo a previous POST or PUT
+        auto result = curl_easy_setopt(ctx.handle, CURLOPT_HTTPGET, 1);
+        if (result != CURLE_OK) {
+            throw http_request_exception(ctx.req, curl_easy_strerror(result));
+        }
+
         switch (method) {
             case http_method::get:
-                // Unnecessary since we're resetting the handle before calling this function
                 return;
 
             case http_method::post: {
-                auto result = curl_easy_setopt(_handle, CURLOPT_POST, 1);
+                auto result = curl_easy_setopt(ctx.handle, CURLOPT_POST, 1);
                 if (result != CURLE_OK) {
                     throw http_request_exception(ctx.req, curl_easy_strerror(result));
                 }
@@ -183,7 +663,7 @@ namespace facter { namespace http {
             }
 
             case http_method::put: {
-                auto result = curl_easy_setopt(_handle, CURLOPT_PUT, 1);
+                auto result = curl_easy_setopt(ctx.handle, CURLOPT_PUT, 1);
                 if (result != CURLE_OK) {
                     throw http_request_exception(ctx.req, curl_easy_strerror(result));
                 }
@@ -198,7 +678,7 @@ namespace facter { namespace http {
     void client::set_url(context& ctx)
     {
         // TODO: support an easy interface for setting escaped query parameters
-        auto result = curl_easy_setopt(_handle, CURLOPT_URL, ctx.req.url().c_str());
+        auto result = curl_easy_setopt(ctx.handle, CURLOPT_URL, ctx.req.url().c_str());
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
@@ -212,7 +692,7 @@ namespace facter { namespace http {
             ctx.request_headers.append(name + ": " + value);
             return true;
         });
-        auto result = curl_easy_setopt(_handle, CURLOPT_HTTPHEADER, static_cast<curl_slist*>(ctx.request_headers));
+        auto result = curl_easy_setopt(ctx.handle, CURLOPT_HTTPHEADER, static_cast<curl_slist*>(ctx.request_headers));
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
@@ -228,7 +708,7 @@ namespace facter { namespace http {
             cookies << name << "=" << value;
             return true;
         });
-        auto result = curl_easy_setopt(_handle, CURLOPT_COOKIE, cookies.str().c_str());
+        auto result = curl_easy_setopt(ctx.handle, CURLOPT_COOKIE, cookies.str().c_str());
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
@@ -236,11 +716,18 @@ namespace facter { namespace http {
 
     void client::set_body(context& ctx)
     {
-        auto result = curl_easy_setopt(_handle, CURLOPT_READFUNCTION, read_body);
+        auto result = curl_easy_setopt(ctx.handle, CURLOPT_READDATA, &ctx);
+        if (result != CURLE_OK) {
+            throw http_request_exception(ctx.req, curl_easy_strerror(result));
+        }
+
+        // Give the size of the body, otherwise a POST or PUT is sent chunked, which not every server accepts
+        auto size = static_cast<curl_off_t>(ctx.req.body().size());
+        result = curl_easy_setopt(ctx.handle, CURLOPT_POSTFIELDSIZE_LARGE, size);
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
-        result = curl_easy_setopt(_handle, CURLOPT_READDATA, &ctx);
+        result = curl_easy_setopt(ctx.handle, CURLOPT_INFILESIZE_LARGE, size);
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
@@ -248,11 +735,33 @@ namespace facter { namespace http {
 
     void client::set_timeouts(context& ctx)
     {
-        auto result = curl_easy_setopt(_handle, CURLOPT_CONNECTTIMEOUT_MS, ctx.req.connection_timeout());
+        long connection_timeout = ctx.req.connection_timeout();
+        long timeout = ctx.req.timeout();
+
+        // Limit the request to the deadline of the calling thread, if any; a timeout of 0 means no timeout
+        if (scoped_deadline::active()) {
+            auto remaining = scoped_deadline::remaining();
+            if (remaining == chrono::steady_clock::duration::zero()) {
+                throw deadline_exceeded_exception("HTTP request was not made as the deadline has passed.");
+            }
+            if (remaining != chrono::steady_clock::duration::max()) {
+                long limit = static_cast<long>(chrono::duration_cast<chrono::milliseconds>(remaining).count()) + 1;
+                connection_timeout = connection_timeout == 0 ? limit : min(connection_timeout, limit);
+                timeout = timeout == 0 ? limit : min(timeout, limit);
+            }
+
+        }
+
+        // Abort the transfer if the request is cancelled; progress is only reported when there's a deadline
+        auto result = curl_easy_setopt(ctx.handle, CURLOPT_NOPROGRESS, scoped_deadline::active() ? 0 : 1);
+        if (result != CURLE_OK) {
+            throw http_request_exception(ctx.req, curl_easy_strerror(result));
+        }
+        result = curl_easy_setopt(ctx.handle, CURLOPT_CONNECTTIMEOUT_MS, connection_timeout);
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
-        result = curl_easy_setopt(_handle, CURLOPT_TIMEOUT_MS, ctx.req.timeout());
+        result = curl_easy_setopt(ctx.handle, CURLOPT_TIMEOUT_MS, timeout);
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
@@ -260,19 +769,17 @@ namespace facter { namespace http {
 
     void client::set_write_callbacks(context& ctx)
     {
-        auto result = curl_easy_setopt(_handle, CURLOPT_HEADERFUNCTION, write_header);
+        auto result = curl_easy_setopt(ctx.handle, CURLOPT_HEADERDATA, &ctx);
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
-        result = curl_easy_setopt(_handle, CURLOPT_HEADERDATA, &ctx);
-        if (result != CURLE_OK) {
-            throw http_request_exception(ctx.req, curl_easy_strerror(result));
-        }
-        result = curl_easy_setopt(_handle, CURLOPT_WRITEFUNCTION, write_body);
+
+        // Let cURL fail the request as soon as a Content-Length over the limit is received; a limit of 0 means no limit
+        result = curl_easy_setopt(ctx.handle, CURLOPT_MAXFILESIZE_LARGE, static_cast<curl_off_t>(ctx.req.max_body_size()));
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
-        result = curl_easy_setopt(_handle, CURLOPT_WRITEDATA, &ctx);
+        result = curl_easy_setopt(ctx.handle, CURLOPT_WRITEDATA, &ctx);
         if (result != CURLE_OK) {
             throw http_request_exception(ctx.req, curl_easy_strerror(result));
         }
@@ -306,6 +813,8 @@ namespace facter { namespace http {
         if (input.starts_with("HTTP/")) {
             // Reset the response buffer
             ctx->response_buffer.clear();
+            ctx->recorded_body.clear();
+            ctx->received = 0;
 
             // Parse out the error code
             static boost::regex regex("HTTP/\\d\\.\\d (\\d\\d\\d).*");
@@ -331,10 +840,12 @@ namespace facter { namespace http {
         boost::trim(value);
 
         // If this is the "Content-Length" header, reserve the response buffer as an optimization
-        if (name == "Content-Length") {
-            try {
-                ctx->response_buffer.reserve(stoi(value));
-            } catch (logic_error&) {
+        // The body isn't buffered when it is consumed as it is received, and never more than the limit is reserved
+        if (ctx->buffered && !ctx->req.body_callback() && name == "Content-Length") {
+            uint64_t length;
+            if (parse_integer(value, length)) {
+                size_t limit = ctx->req.max_body_size();
+                ctx->response_buffer.reserve(limit > 0 ? min(static_cast<size_t>(length), limit) : static_cast<size_t>(length));
             }
         }
 
@@ -347,13 +858,39 @@ namespace facter { namespace http {
         size_t written = size * count;
 
         auto ctx = reinterpret_cast<context*>(ptr);
-        if (written > 0) {
-            ctx->response_buffer.append(buffer, written);
+        if (written == 0) {
+            return written;
         }
 
+        // Returning less than was given aborts the transfer
+        size_t limit = ctx->req.max_body_size();
+        if (limit > 0 && ctx->received + written > limit) {
+            ctx->exceeded = true;
+            return 0;
+        }
+        ctx->received += written;
+        if (ctx->recording) {
+            ctx->recorded_body.append(buffer, written);
+        }
+
+        auto const& callback = ctx->req.body_callback();
+        if (callback) {
+            if (!callback(ctx->res, buffer, written)) {
+                ctx->stopped = true;
+                return 0;
+            }
+            return written;
+        }
+        ctx->response_buffer.append(buffer, written);
         return written;
     }
 
+    int client::progress(void* ptr, curl_off_t download_total, curl_off_t downloaded, curl_off_t upload_total, curl_off_t uploaded)
+    {
+        // Returning non-zero aborts the transfer
+        return scoped_deadline::expired() ? 1 : 0;
+    }
+
     int client::debug(CURL* handle, curl_infotype type, char* data, size_t size, void* ptr)
     {
         if (type > CURLINFO_DATA_OUT) {
@@ -7,7 +7,8 @@ namespace facter { namespace http {
     request::request(string url) :
         _url(move(url)),
         _timeout(0),
-        _connection_timeout(0)
+        _connection_timeout(0),
+        _max_body_size(0)
     {
     }
 
@@ -108,4 +109,24 @@ namespace facter { namespace http {
     {
         _connection_timeout = value < 0 ? 0 : value;
     }
+
+    size_t request::max_body_size() const
+    {
+        return _max_body_size;
+    }
+
+    void request::max_body_size(size_t value)
+    {
+        _max_body_size = value;
+    }
+
+    function<bool(response const&, char const*, size_t)> const& request::body_callback() const
+    {
+        return _body_callback;
+    }
+
+    void request::body_callback(function<bool(response const&, char const*, size_t)> callback)
+    {
+        _body_callback = move(callback);
+    }
 }}
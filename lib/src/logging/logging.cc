@@ -1,7 +1,22 @@
 #include <facter/logging/logging.hpp>
+#include <internal/util/async_streambuf.hpp>
+#include <internal/util/log_context.hpp>
 #include <leatherman/logging/logging.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
 
 using namespace std;
+using namespace facter::util;
+using namespace rapidjson;
 namespace lm = leatherman::logging;
 
 namespace facter { namespace logging {
@@ -20,11 +35,189 @@ namespace facter { namespace logging {
         return os;
     }
 
+    // The current asynchronous stream is never destroyed: messages may be logged while the process exits
+    static boost::mutex async_mutex;
+    static async_streambuf* async_buffer = nullptr;
+    static ostream* async_stream = nullptr;
+
+    // Asynchronous logging is started by the first message logged rather than when it's set up: most runs log
+    // nothing at the default level, so they never create boost.log's sink or the writer thread
+    // Checking whether it has been started is a single atomic load
+    static atomic<bool> async_pending(false);
+    static ostream* pending_stream = nullptr;
+    static function<void(string&)> pending_format;
+    static function<bool(level, string const&)> message_callback;
+    static bool colorization_set = false;
+
+    static void start_logging()
+    {
+        if (!async_pending.load(memory_order_acquire)) {
+            return;
+        }
+        boost::lock_guard<boost::mutex> lock(async_mutex);
+        if (!async_pending.load(memory_order_relaxed)) {
+            return;
+        }
+        if (!async_buffer) {
+            // Write anything still queued when the process exits normally
+            atexit(flush_logging);
+        }
+        unique_ptr<async_streambuf> previous_buffer(async_buffer);
+        unique_ptr<ostream> previous_stream(async_stream);
+        // The format is kept so that logging can be started again in a forked child (see restart_logging_after_fork)
+        async_buffer = new async_streambuf(*pending_stream, 1024, pending_format);
+        async_stream = new ostream(async_buffer);
+
+        // Setting up the sink may reset the level and colorization, so keep what was set before the first message
+        auto lvl = lm::get_level();
+        auto color = lm::get_colorization();
+        lm::setup_logging(*async_stream);
+        lm::set_level(lvl);
+        if (colorization_set) {
+            lm::set_colorization(color);
+        }
+        async_pending.store(false, memory_order_release);
+
+        // The previous stream is no longer logged to; destroying its buffer writes what it had queued
+    }
+
+    // Called by leatherman for each message at an enabled level, before the message is written to the sink
+    static bool dispatch_message(lm::log_level lvl, string const& message)
+    {
+        if (message_callback && !message_callback(static_cast<level>(lvl), message)) {
+            return false;
+        }
+        start_logging();
+        return true;
+    }
+
     void setup_logging(ostream& os)
     {
+        async_pending.store(false, memory_order_release);
         lm::setup_logging(os);
     }
 
+    static void setup_async_logging(ostream& os, function<void(string&)> format)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(async_mutex);
+            pending_stream = &os;
+            pending_format = move(format);
+            async_pending.store(true, memory_order_release);
+        }
+        lm::set_level(lm::log_level::warning);
+        lm::on_message(dispatch_message);
+    }
+
+    void setup_async_logging(ostream& os)
+    {
+        setup_async_logging(os, nullptr);
+    }
+
+    static void write_json_string(Writer<StringBuffer>& writer, string const& value)
+    {
+        writer.String(value.c_str(), static_cast<SizeType>(value.size()));
+    }
+
+    static void format_json_line(string& line)
+    {
+        // Lines are written as "<date> <time> <LEVEL> <logger> - <message>", possibly with color codes around the message
+        if (!line.empty() && line.back() == '\n') {
+            line.pop_back();
+        }
+        string text;
+        text.reserve(line.size());
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (line[i] == '\x1b' && i + 1 < line.size() && line[i + 1] == '[') {
+                auto end = line.find('m', i);
+                if (end != string::npos) {
+                    i = end;
+                    continue;
+                }
+            }
+            text += line[i];
+        }
+
+        string time, lvl, logger, message;
+        auto separator = text.find(" - ");
+        vector<string> header;
+        if (separator != string::npos) {
+            string prefix = text.substr(0, separator);
+            boost::split(header, prefix, boost::is_space(), boost::token_compress_on);
+        }
+        if (header.size() == 4) {
+            time = header[0] + " " + header[1];
+            lvl = boost::to_lower_copy(header[2]);
+            logger = move(header[3]);
+            message = text.substr(separator + 3);
+        } else {
+            message = move(text);
+        }
+
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        writer.StartObject();
+        if (!time.empty()) {
+            writer.String("time");
+            write_json_string(writer, time);
+            writer.String("level");
+            write_json_string(writer, lvl);
+            writer.String("logger");
+            write_json_string(writer, logger);
+        }
+        writer.String("message");
+        write_json_string(writer, message);
+
+        // Messages are formatted on the thread that logged them, so its context is current
+        auto context = scoped_log_context::get();
+        if (context && !context->resolver.empty()) {
+            writer.String("resolver");
+            write_json_string(writer, context->resolver);
+            writer.String("elapsed_ms");
+            writer.Double(chrono::duration<double, milli>(chrono::steady_clock::now() - context->start).count());
+        }
+        if (context && context->pid != 0) {
+            writer.String("pid");
+            writer.Int64(context->pid);
+        }
+        if (context && !context->url.empty()) {
+            writer.String("url");
+            write_json_string(writer, context->url);
+        }
+        writer.EndObject();
+
+        line.assign(buffer.GetString(), buffer.Size());
+        line += '\n';
+    }
+
+    void setup_structured_logging(ostream& os)
+    {
+        setup_async_logging(os, format_json_line);
+    }
+
+    void flush_logging()
+    {
+        boost::lock_guard<boost::mutex> lock(async_mutex);
+        if (async_buffer) {
+            async_buffer->drain();
+        }
+    }
+
+    void restart_logging_after_fork()
+    {
+        // Only the forking thread is copied into the child: the writer thread is gone, and the mutex may have been held
+        // by a thread that is also gone, so the mutex is made anew rather than locked
+        new (&async_mutex) boost::mutex();
+        if (!async_buffer) {
+            return;
+        }
+
+        // Abandon the parent's buffer (the parent writes what it had queued) and start again at the next message
+        async_buffer = nullptr;
+        async_stream = nullptr;
+        async_pending.store(true, memory_order_release);
+    }
+
     void set_level(level lvl)
     {
         lm::set_level(static_cast<lm::log_level>(lvl));
@@ -37,14 +230,23 @@ namespace facter { namespace logging {
 
     void set_colorization(bool color)
     {
+        colorization_set = true;
         lm::set_colorization(color);
     }
 
     bool get_colorization()
     {
+        // The default colorization is determined when logging is started
+        start_logging();
         return lm::get_colorization();
     }
 
+    void on_message(function<bool(level, string const&)> callback)
+    {
+        message_callback = move(callback);
+        lm::on_message(dispatch_message);
+    }
+
     bool is_enabled(level lvl)
     {
         return lm::is_enabled(static_cast<lm::log_level>(lvl));
@@ -72,11 +274,13 @@ namespace facter { namespace logging {
 
     string const& colorize(level lvl)
     {
+        start_logging();
         return lm::colorize(static_cast<lm::log_level>(lvl));
     }
 
     string const& colorize()
     {
+        start_logging();
         return lm::colorize();
     }
 
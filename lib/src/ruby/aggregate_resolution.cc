@@ -1,5 +1,7 @@
 #include <internal/ruby/aggregate_resolution.hpp>
 #include <internal/ruby/chunk.hpp>
+#include <algorithm>
+#include <functional>
 
 using namespace std;
 
@@ -36,6 +38,15 @@ namespace facter { namespace ruby {
     {
         auto const& ruby = *api::instance();
 
+        // Order the chunks so that each is evaluated once, after its dependencies; a cycle raises before any block is called
+        order_chunks();
+        for (auto& chunk : _chunks) {
+            chunk.second.reset();
+        }
+        for (auto name : _order) {
+            _chunks.find(name)->second.value(*this);
+        }
+
         // If given an aggregate block, build a hash and call the block
         if (!ruby.is_nil(_block)) {
             volatile VALUE result = ruby.rb_hash_new();
@@ -126,10 +137,85 @@ namespace facter { namespace ruby {
 
         auto it = _chunks.find(name);
         if (it == _chunks.end()) {
-            it = _chunks.emplace(make_pair(name, ruby::chunk(dependencies, block))).first;
+            it = _chunks.emplace(make_pair(name, ruby::chunk(name, dependencies, block))).first;
         }
         it->second.dependencies(dependencies);
         it->second.block(block);
+
+        // The chunks are ordered again on the next evaluation
+        _order.clear();
+    }
+
+    void aggregate_resolution::order_chunks()
+    {
+        auto const& ruby = *api::instance();
+
+        if (!_order.empty() || _chunks.empty()) {
+            return;
+        }
+
+        volatile VALUE cycle = ruby.nil_value();
+        {
+            // Declare all C++ objects here
+            // Visit the chunks depth first; a chunk is ordered once all of its dependencies are
+            map<VALUE, bool> visited;
+            vector<VALUE> path;
+            function<bool(VALUE)> visit = [&](VALUE name) {
+                auto it = _chunks.find(name);
+                if (it == _chunks.end()) {
+                    // A missing dependency has a nil value
+                    return true;
+                }
+                auto state = visited.find(name);
+                if (state != visited.end()) {
+                    if (state->second) {
+                        return true;
+                    }
+                    // The chunk is still being visited, so it depends on itself
+                    string message = "chunk dependency cycle detected:";
+                    for (auto current = find(path.begin(), path.end(), name); current != path.end(); ++current) {
+                        message += " " + ruby.to_string(*current) + " ->";
+                    }
+                    message += " " + ruby.to_string(name);
+                    cycle = ruby.utf8_value(message);
+                    return false;
+                }
+                visited.emplace(name, false);
+                path.push_back(name);
+
+                vector<VALUE> dependencies;
+                VALUE required = it->second.dependencies();
+                if (ruby.is_symbol(required)) {
+                    dependencies.push_back(required);
+                } else if (ruby.is_array(required)) {
+                    ruby.array_for_each(required, [&](VALUE element) {
+                        dependencies.push_back(element);
+                        return true;
+                    });
+                }
+                for (auto dependency : dependencies) {
+                    if (!visit(dependency)) {
+                        return false;
+                    }
+                }
+
+                path.pop_back();
+                visited[name] = true;
+                _order.push_back(name);
+                return true;
+            };
+            for (auto& chunk : _chunks) {
+                if (!visit(chunk.first)) {
+                    _order.clear();
+                    break;
+                }
+            }
+        }
+
+        // Now that the above block has exited, it's safe to raise
+        if (!ruby.is_nil(cycle)) {
+            ruby.rb_raise(*ruby.rb_eRuntimeError, "%s", ruby.rb_string_value_ptr(const_cast<VALUE*>(&cycle)));
+        }
     }
 
     VALUE aggregate_resolution::alloc(VALUE klass)
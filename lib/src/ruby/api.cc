@@ -2,14 +2,18 @@
 #include <internal/ruby/ruby_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/facts/map_value.hpp>
+#include <facter/facts/lazy_value.hpp>
 #include <facter/facts/array_value.hpp>
 #include <facter/util/directory.hpp>
 #include <facter/util/environment.hpp>
+#include <facter/util/file.hpp>
 #include <facter/execution/execution.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/nowide/fstream.hpp>
 #include <sstream>
 
 using namespace std;
@@ -25,9 +29,13 @@ namespace facter { namespace ruby {
 #define LOAD_OPTIONAL_SYMBOL(x) x(reinterpret_cast<decltype(x)>(library.find_symbol(#x)))
 
     // Default to cleaning up the VM on shutdown
-    bool api::cleanup = true;
+    atomic<bool> api::cleanup(true);
+    string api::library_cache;
 
     set<VALUE> api::_data_objects;
+    volatile VALUE* api::_stack_start = nullptr;
+    bool api::_deferred = false;
+    bool api::_deferred_stack_trace = false;
 
     api::api(dynamic_library library) :
         LOAD_SYMBOL(rb_intern),
@@ -71,6 +79,7 @@ namespace facter { namespace ruby {
         LOAD_SYMBOL(rb_ary_push),
         LOAD_SYMBOL(rb_ary_entry),
         LOAD_SYMBOL(rb_hash_new),
+        LOAD_OPTIONAL_SYMBOL(rb_hash_new_capa),
         LOAD_SYMBOL(rb_hash_aset),
         LOAD_SYMBOL(rb_hash_lookup),
         LOAD_SYMBOL(rb_obj_freeze),
@@ -98,6 +107,7 @@ namespace facter { namespace ruby {
         LOAD_SYMBOL(ruby_init),
         LOAD_SYMBOL(ruby_options),
         LOAD_SYMBOL(ruby_cleanup),
+        LOAD_OPTIONAL_SYMBOL(ruby_init_stack),
         _library(move(library))
     {
     }
@@ -125,6 +135,28 @@ namespace facter { namespace ruby {
         return instance.get();
     }
 
+    void api::defer_initialize(bool include_stack_trace)
+    {
+        // Only the address of the marker is kept; Ruby's garbage collector scans the stack from it once Ruby is initialized
+        volatile VALUE marker = 0;
+        _stack_start = &marker;
+        _deferred = true;
+        _deferred_stack_trace = include_stack_trace;
+    }
+
+    api* api::initialized_instance()
+    {
+        auto ruby = instance();
+        if (!ruby) {
+            return nullptr;
+        }
+        if (!ruby->initialized() && _deferred) {
+            ruby->initialize();
+            ruby->include_stack_trace(_deferred_stack_trace);
+        }
+        return ruby->initialized() ? ruby : nullptr;
+    }
+
     unique_ptr<api> api::create()
     {
         dynamic_library library = find_library();
@@ -150,6 +182,11 @@ namespace facter { namespace ruby {
             return;
         }
 
+        // When initialization was deferred, start the stack at the frame that deferred it rather than this one
+        if (_stack_start && ruby_init_stack) {
+            ruby_init_stack(_stack_start);
+        }
+
         // Prefer ruby_setup over ruby_init if present (2.0+)
         // If ruby is already initialized, this is a no-op
         if (ruby_setup) {
@@ -388,41 +425,103 @@ namespace facter { namespace ruby {
 
     VALUE api::to_ruby(value const* val) const
     {
+        val = lazy_value::resolve(val);
         if (!val) {
             return _nil;
         }
-        if (auto ptr = dynamic_cast<ruby_value const*>(val)) {
+        switch (val->type()) {
+            case value_type::string:
+                return utf8_value(static_cast<string_value const*>(val)->value());
+            case value_type::integer:
+                return rb_int2inum(static_cast<SIGNED_VALUE>(static_cast<integer_value const*>(val)->value()));
+            case value_type::boolean:
+                return static_cast<boolean_value const*>(val)->value() ? _true : _false;
+            case value_type::floating_point:
+                return rb_float_new_in_heap(static_cast<double_value const*>(val)->value());
+            case value_type::array: {
+                auto ptr = static_cast<array_value const*>(val);
+                volatile VALUE array = rb_ary_new_capa(static_cast<long>(ptr->size()));
+                ptr->each([&](value const* element) {
+                    rb_ary_push(array, to_ruby(element));
+                    return true;
+                });
+                return array;
+            }
+            case value_type::map: {
+                auto ptr = static_cast<map_value const*>(val);
+                volatile VALUE hash = hash_with_capacity(ptr->size());
+                ptr->each([&](string const& name, value const* element) {
+                    rb_hash_aset(hash, key_value(name), to_ruby(element));
+                    return true;
+                });
+                return hash;
+            }
+            default:
+                break;
+        }
+        if (auto ptr = value_cast<ruby_value>(val)) {
             return ptr->value();
         }
-        if (auto ptr = dynamic_cast<string_value const*>(val)) {
-            return utf8_value(ptr->value());
+        return _nil;
+    }
+
+    VALUE api::hash_with_capacity(size_t capacity) const
+    {
+        return rb_hash_new_capa ? rb_hash_new_capa(static_cast<long>(capacity)) : rb_hash_new();
+    }
+
+    VALUE api::key_value(string const& key) const
+    {
+        // Hash keys repeat across values (and conversions), so share one frozen string per key
+        // Ruby stores a frozen string key as is rather than copying it
+        auto it = _keys.find(key);
+        if (it != _keys.end()) {
+            return it->second;
         }
-        if (auto ptr = dynamic_cast<integer_value const*>(val)) {
-            return rb_int2inum(static_cast<SIGNED_VALUE>(ptr->value()));
+        volatile VALUE value = rb_obj_freeze(utf8_value(key));
+
+        // Bound the shared keys in case a fact has arbitrary keys (e.g. mount points)
+        if (_keys.size() >= 4096) {
+            return value;
         }
-        if (auto ptr = dynamic_cast<boolean_value const*>(val)) {
-            return ptr->value() ? _true : _false;
+
+        // Keep the shared keys alive by referencing them from an array registered with the GC
+        if (!_key_strings) {
+            _key_strings = rb_ary_new_capa(64);
+            rb_gc_register_address(&_key_strings);
         }
-        if (auto ptr = dynamic_cast<double_value const*>(val)) {
-            return rb_float_new_in_heap(ptr->value());
+        rb_ary_push(_key_strings, value);
+        _keys.emplace(key, value);
+        return value;
+    }
+
+    void api::retain(VALUE obj) const
+    {
+        // Count the retains of each object in a hash that compares the objects by identity
+        if (!_retained) {
+            _retained = rb_hash_new();
+            rb_funcall(_retained, rb_intern("compare_by_identity"), 0);
+            rb_gc_register_address(&_retained);
+        }
+        volatile VALUE count = rb_hash_lookup(_retained, obj);
+        rb_hash_aset(_retained, obj, rb_int2inum(is_nil(count) ? 1 : static_cast<SIGNED_VALUE>(rb_num2ulong(count)) + 1));
+    }
+
+    void api::release(VALUE obj) const
+    {
+        if (!_retained) {
+            return;
         }
-        if (auto ptr = dynamic_cast<array_value const*>(val)) {
-            volatile VALUE array = rb_ary_new_capa(static_cast<long>(ptr->size()));
-            ptr->each([&](value const* element) {
-                rb_ary_push(array, to_ruby(element));
-                return true;
-            });
-            return array;
+        volatile VALUE count = rb_hash_lookup(_retained, obj);
+        if (is_nil(count)) {
+            return;
         }
-        if (auto ptr = dynamic_cast<map_value const*>(val)) {
-            volatile VALUE hash = rb_hash_new();
-            ptr->each([&](string const& name, value const* element) {
-                rb_hash_aset(hash, utf8_value(name), to_ruby(element));
-                return true;
-            });
-            return hash;
+        auto remaining = static_cast<SIGNED_VALUE>(rb_num2ulong(count)) - 1;
+        if (remaining == 0) {
+            rb_funcall(_retained, rb_intern("delete"), 1, obj);
+        } else {
+            rb_hash_aset(_retained, obj, rb_int2inum(remaining));
         }
-        return _nil;
     }
 
     VALUE api::lookup(std::initializer_list<std::string> const& names) const
@@ -445,6 +544,56 @@ namespace facter { namespace ruby {
         return is_true(rb_funcall(first, rb_intern("==="), 1, second));
     }
 
+    static string ruby_stamp(string const& ruby)
+    {
+        // Identify the ruby by its path and modification time so that an upgraded ruby is asked again
+        boost::system::error_code ec;
+        auto modified = last_write_time(ruby, ec);
+        if (ec) {
+            return {};
+        }
+        return ruby + "\n" + boost::lexical_cast<string>(modified);
+    }
+
+    static string read_library_cache(string const& stamp)
+    {
+        // The cache is the ruby's stamp followed by the location of its library
+        string contents;
+        if (api::library_cache.empty() || stamp.empty() || !file::read(api::library_cache, contents)) {
+            return {};
+        }
+        if (contents.compare(0, stamp.size(), stamp) != 0 || contents.size() <= stamp.size() || contents[stamp.size()] != '\n') {
+            return {};
+        }
+        auto path = contents.substr(stamp.size() + 1);
+        boost::trim_right(path);
+        return path;
+    }
+
+    static void write_library_cache(string const& stamp, string const& path)
+    {
+        if (api::library_cache.empty() || stamp.empty()) {
+            return;
+        }
+
+        // Write to a temporary file and rename it so that readers never see a partially written cache
+        string temp_path = api::library_cache + ".tmp";
+        {
+            boost::nowide::ofstream out(temp_path.c_str(), ios::out | ios::binary | ios::trunc);
+            out << stamp << "\n" << path << "\n";
+            if (!out) {
+                LOG_DEBUG("ruby library cache %1% could not be written.", temp_path);
+                return;
+            }
+        }
+        boost::system::error_code ec;
+        boost::filesystem::rename(temp_path, api::library_cache, ec);
+        if (ec) {
+            LOG_DEBUG("ruby library cache %1% could not be written: %2%.", api::library_cache, ec.message());
+            boost::filesystem::remove(temp_path, ec);
+        }
+    }
+
     dynamic_library api::find_library()
     {
         // First search for an already loaded Ruby.
@@ -480,6 +629,17 @@ namespace facter { namespace ruby {
         }
         LOG_DEBUG("ruby was found at \"%1%\".", ruby);
 
+        // Use the library this ruby reported before rather than starting it again
+        auto stamp = ruby_stamp(ruby);
+        auto cached = read_library_cache(stamp);
+        if (!cached.empty()) {
+            if (library.load(cached)) {
+                LOG_DEBUG("ruby library \"%1%\" was loaded from cache %2%.", cached, library_cache);
+                return library;
+            }
+            LOG_DEBUG("cached ruby library \"%1%\" could not be loaded: asking ruby for its library.", cached);
+        }
+
         auto result = execute(ruby, { "-e", "print File.join(RbConfig::CONFIG['"+libruby_configdir()+"'], RbConfig::CONFIG['LIBRUBY_SO'])" },
             option_set<execution_options>{ execution_options::defaults, execution_options::redirect_stderr });
         if (!result.first) {
@@ -493,7 +653,9 @@ namespace facter { namespace ruby {
             return library;
         }
 
-        library.load(result.second);
+        if (library.load(result.second)) {
+            write_library_cache(stamp, result.second);
+        }
         return library;
     }
 
@@ -1,11 +1,16 @@
 #include <internal/ruby/chunk.hpp>
 #include <internal/ruby/aggregate_resolution.hpp>
+#include <internal/ruby/module.hpp>
+#include <internal/util/statistics.hpp>
+#include <facter/facts/collection.hpp>
 
 using namespace std;
+using namespace facter::util;
 
 namespace facter { namespace ruby {
 
-    chunk::chunk(VALUE dependencies, VALUE block) :
+    chunk::chunk(VALUE name, VALUE dependencies, VALUE block) :
+        _name(name),
         _dependencies(dependencies),
         _block(block),
         _resolved(false),
@@ -22,6 +27,7 @@ namespace facter { namespace ruby {
 
     chunk& chunk::operator=(chunk&& other)
     {
+        _name = other._name;
         _dependencies = other._dependencies;
         _block = other._block;
         _value = other._value;
@@ -47,9 +53,11 @@ namespace facter { namespace ruby {
 
         volatile VALUE value = ruby.nil_value();
         int tag = 0;
+        statistics stats;
         {
             // Declare all C++ objects here
             vector<VALUE> values;
+            scoped_statistics recording(stats);
 
             value = ruby.protect(tag, [&]{
                 // Do not declare any C++ objects inside the protect
@@ -82,6 +90,7 @@ namespace facter { namespace ruby {
         }
 
         _resolving = false;
+        module::current()->facts().record_timing(resolution.timing_name() + " chunk " + ruby.to_string(_name), stats);
 
         if (!tag) {
             _value = value;
@@ -120,6 +129,13 @@ namespace facter { namespace ruby {
         _resolved = false;
     }
 
+    void chunk::reset()
+    {
+        auto const& ruby = *api::instance();
+        _value = ruby.nil_value();
+        _resolved = false;
+    }
+
     void chunk::mark() const
     {
         auto const& ruby = *api::instance();
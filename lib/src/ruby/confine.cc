@@ -32,8 +32,23 @@ namespace facter { namespace ruby {
 
         // If given a fact, either call the block or check the values
         if (!ruby.is_nil(_fact)) {
+            // Without a block, the result depends only on the fact and the expected values; memoize it for other resolutions
+            volatile VALUE key = ruby.nil_value();
+            if (ruby.is_nil(_block)) {
+                key = ruby.rb_ary_new_capa(2);
+                ruby.rb_ary_push(key, facter.normalize(_fact));
+                ruby.rb_ary_push(key, _expected);
+                volatile VALUE memoized = facter.confine_result(key);
+                if (!ruby.is_nil(memoized)) {
+                    return ruby.is_true(memoized);
+                }
+            }
+
             volatile VALUE value = facter.normalize(facter.fact_value(_fact));
             if (ruby.is_nil(value)) {
+                if (!ruby.is_nil(key)) {
+                    facter.confine_result(key, false);
+                }
                 return false;
             }
             // Pass the value to the block if given one
@@ -43,17 +58,19 @@ namespace facter { namespace ruby {
             }
 
             // Otherwise, if it's an array, search for the value
+            bool found = false;
             if (ruby.is_array(_expected)) {
-                bool found = false;
                 ruby.array_for_each(_expected, [&](VALUE expected_value) {
                     expected_value = facter.normalize(expected_value);
                     found = ruby.equals(facter.normalize(expected_value), value);
                     return !found;
                 });
-                return found;
+            } else {
+                // Compare the value directly
+                found = ruby.case_equals(facter.normalize(_expected), value);
             }
-            // Compare the value directly
-            return ruby.case_equals(facter.normalize(_expected), value);
+            facter.confine_result(key, found);
+            return found;
         }
         // If we have only a block, execute it
         if (!ruby.is_nil(_block)) {
@@ -5,8 +5,13 @@
 #include <internal/ruby/ruby_value.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/util/environment.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <internal/util/statistics.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <algorithm>
+#include <chrono>
+#include <memory>
 
 using namespace std;
 using namespace facter::facts;
@@ -90,34 +95,37 @@ namespace facter { namespace ruby {
         }
 
         if (ruby.is_nil(_value)) {
-            vector<VALUE>::iterator it;
-            ruby.rescue([&]() {
-                volatile VALUE value = ruby.nil_value();
-
-                // Look through the resolutions and find the first allowed resolution that resolves
-                for (it = _resolutions.begin(); it != _resolutions.end(); ++it) {
-                    auto res = ruby.to_native<resolution>(*it);
-                    if (!res->suitable(*facter)) {
-                        continue;
-                    }
+            volatile VALUE value = ruby.nil_value();
+            string name = ruby.to_string(_name);
+
+            // Look through the resolutions and find the first allowed resolution that resolves
+            // The confines and each resolution are timed separately; an error in either stops the fact from resolving
+            // A resolution that runs past its timeout is abandoned in favor of the next one
+            bool failed = false;
+            size_t index = 0;
+            for (auto it = _resolutions.begin(); !failed && it != _resolutions.end(); ++it) {
+                auto res = ruby.to_native<resolution>(*it);
+                ++index;
+                res->timing_name(name + " resolution " + (ruby.is_nil(res->name()) ? to_string(index) : ruby.to_string(res->name())));
+
+                bool suitable = false;
+                failed = !timed(facts, name + " confines", [&]() {
+                    suitable = res->suitable(*facter);
+                });
+                if (failed || !suitable) {
+                    continue;
+                }
+                failed = !timed(facts, res->timing_name(), [&]() {
                     value = res->value();
-                    if (!ruby.is_nil(value)) {
-                        break;
-                    }
+                }, res->timeout());
+                if (!failed && !ruby.is_nil(value)) {
+                    break;
                 }
+            }
 
-                // Set the value to what was resolved
-                _value = value;
-                _resolved = true;
-                return 0;
-            }, [&](VALUE ex) {
-                LOG_ERROR("error while resolving custom fact \"%1%\": %2%", ruby.rb_string_value_ptr(&_name), ruby.exception_to_string(ex));
-
-                // Failed, so set to nil
-                _value = ruby.nil_value();
-                _resolved = true;
-                return 0;
-            });
+            // Set the value to what was resolved; if resolving failed, set it to nil
+            _value = failed ? ruby.nil_value() : value;
+            _resolved = true;
         }
 
         if (add) {
@@ -128,6 +136,69 @@ namespace facter { namespace ruby {
         return _value;
     }
 
+    bool fact::timed(collection& facts, string const& timing_name, function<void()> const& callback, double timeout)
+    {
+        auto const& ruby = *api::instance();
+
+        // The statistics are recorded once the callback returns or its Ruby exception was rescued
+        statistics stats;
+        bool failed = false;
+        bool timed_out = false;
+        {
+            scoped_statistics recording(stats);
+            scoped_trace_span tracing("ruby resolve", timing_name);
+
+            // Commands executed by the callback are killed once the timeout passes
+            unique_ptr<scoped_deadline> deadline;
+            if (timeout > 0) {
+                deadline.reset(new scoped_deadline(chrono::steady_clock::now() +
+                    chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout))));
+            }
+
+            VALUE seconds = timeout > 0 ? ruby.rb_float_new_in_heap(timeout) : ruby.nil_value();
+            ruby.rescue([&]() {
+                // Do not construct C++ objects in a rescue callback
+                // C++ stack unwinding will not take place if a Ruby exception is thrown!
+                if (ruby.is_nil(seconds)) {
+                    callback();
+                    return 0;
+                }
+
+                // Ruby code run by the callback is interrupted with Timeout::Error once the timeout passes
+                ruby.rb_require("timeout");
+                ruby.rb_block_call(
+                    ruby.rb_const_get(*ruby.rb_cObject, ruby.rb_intern("Timeout")),
+                    ruby.rb_intern("timeout"),
+                    1,
+                    &seconds,
+                    RUBY_METHOD_FUNC(ruby_timed_block),
+                    reinterpret_cast<VALUE>(&callback));
+                return 0;
+            }, [&](VALUE ex) {
+                if (timeout > 0 && ruby.is_a(ex, ruby.lookup({ "Timeout", "Error" }))) {
+                    timed_out = true;
+                    return 0;
+                }
+                LOG_ERROR("error while resolving custom fact \"%1%\": %2%", ruby.rb_string_value_ptr(&_name), ruby.exception_to_string(ex));
+                failed = true;
+                return 0;
+            });
+        }
+        facts.record_timing(timing_name, stats);
+        if (timed_out) {
+            LOG_WARNING("%1% timed out after %2% seconds.", timing_name, timeout);
+        }
+        return !failed;
+    }
+
+    VALUE fact::ruby_timed_block(VALUE, VALUE context, int, VALUE*)
+    {
+        auto const& ruby = *api::instance();
+
+        (*reinterpret_cast<function<void()> const*>(context))();
+        return ruby.nil_value();
+    }
+
     void fact::value(VALUE v)
     {
         _value = v;
@@ -172,6 +243,8 @@ namespace facter { namespace ruby {
         bool aggregate = false;
         bool has_weight = false;
         size_t weight = 0;
+        bool has_timeout = false;
+        double timeout = 0;
         volatile VALUE resolution_value = ruby.nil_value();
 
         // Read the options if provided
@@ -210,12 +283,9 @@ namespace facter { namespace ruby {
                     has_weight = true;
                     weight = static_cast<size_t>(ruby.rb_num2ulong(value));
                 } else if (key_id == timeout_id) {
-                    // Ignore timeout as it isn't supported
-                    static bool timeout_warning = true;
-                    if (timeout_warning) {
-                        LOG_WARNING("timeout option is not supported for custom facts and will be ignored.")
-                        timeout_warning = false;
-                    }
+                    // Handle the timeout option
+                    has_timeout = true;
+                    timeout = ruby.rb_num2dbl(value);
                 } else {
                     ruby.rb_raise(*ruby.rb_eArgError, "unexpected option %s", ruby.rb_id2name(key_id));
                 }
@@ -244,13 +314,16 @@ namespace facter { namespace ruby {
             }
         }
 
-        // Set the name, value, and weight
+        // Set the name, value, weight, and timeout
         auto res = ruby.to_native<resolution>(resolution_self);
         res->name(name);
         res->value(resolution_value);
         if (has_weight) {
             res->weight(weight);
         }
+        if (has_timeout) {
+            res->timeout(timeout);
+        }
 
         // Call the block if one was given
         if (ruby.rb_block_given_p()) {
@@ -360,6 +433,7 @@ namespace facter { namespace ruby {
     {
         auto const& ruby = *api::instance();
         ruby.to_native<fact>(self)->flush();
+        module::current()->invalidate_hash();
         return ruby.nil_value();
     }
 
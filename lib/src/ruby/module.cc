@@ -5,16 +5,29 @@
 #include <internal/ruby/simple_resolution.hpp>
 #include <facter/facts/collection.hpp>
 #include <facter/util/directory.hpp>
+#include <facter/util/file.hpp>
 #include <facter/execution/execution.hpp>
+#include <facter/logging/logging.hpp>
 #include <facter/version.h>
+#include <internal/execution/executor.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <internal/util/statistics.hpp>
 #include <facter/export.h>
 #include <leatherman/logging/logging.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/nowide/iostream.hpp>
 #include <boost/nowide/convert.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <algorithm>
 #include <stdexcept>
 #include <functional>
+#include <sstream>
 
 using namespace std;
 using namespace facter::facts;
@@ -26,6 +39,42 @@ using namespace leatherman::logging;
 
 namespace facter { namespace ruby {
 
+    /**
+     * Disables Ruby's garbage collector until destructed, unless it was already disabled.
+     */
+    struct scoped_gc_disable
+    {
+        /**
+         * Constructs the scope and disables the garbage collector if requested.
+         * @param disable True to disable the garbage collector or false to leave it as is.
+         */
+        explicit scoped_gc_disable(bool disable) :
+            _enable(false)
+        {
+            if (!disable) {
+                return;
+            }
+            auto const& ruby = *api::instance();
+            // GC.disable returns true if the collector was already disabled
+            _enable = !ruby.is_true(ruby.rb_funcall(ruby.lookup({ "GC" }), ruby.rb_intern("disable"), 0));
+        }
+
+        /**
+         * Enables the garbage collector again if it was disabled by this scope.
+         */
+        ~scoped_gc_disable()
+        {
+            if (!_enable) {
+                return;
+            }
+            auto const& ruby = *api::instance();
+            ruby.rb_funcall(ruby.lookup({ "GC" }), ruby.rb_intern("enable"), 0);
+        }
+
+     private:
+        bool _enable;
+    };
+
     /**
      * Helper for maintaining context when initialized via a Ruby require.
      */
@@ -126,9 +175,17 @@ namespace facter { namespace ruby {
 
     map<VALUE, module*> module::_instances;
 
-    module::module(collection& facts, vector<string> const& paths) :
+    module::module(collection& facts, vector<string> const& paths, string cache_directory) :
         _collection(facts),
-        _loaded_all(false)
+        _cache_directory(move(cache_directory)),
+        _manifest_checked(false),
+        _manifest_valid(false),
+        _loaded_all(false),
+        _workers(0),
+        _disable_gc(false),
+        _hash_stale(true),
+        _subscription(0),
+        _normalized_count(0)
     {
         if (!api::instance()) {
             throw runtime_error("Ruby API is not present.");
@@ -141,12 +198,46 @@ namespace facter { namespace ruby {
         // Initialize the search paths
         initialize_search_paths(paths);
 
+        // Compiled instruction sequences can only be saved and loaded with Ruby 2.3 or later
+        if (!_cache_directory.empty()) {
+            boost::system::error_code ec;
+            volatile VALUE iseq = ruby.is_true(ruby.rb_const_defined(*ruby.rb_cObject, ruby.rb_intern("RubyVM"))) ?
+                ruby.lookup({ "RubyVM", "InstructionSequence" }) : ruby.nil_value();
+            if (ruby.is_nil(iseq) || !ruby.is_true(ruby.rb_funcall(iseq, ruby.rb_intern("respond_to?"), 1, ruby.utf8_value("load_from_binary")))) {
+                LOG_WARNING("custom facts will not be cached: compiled instruction sequences require Ruby 2.3 or later.");
+                _cache_directory.clear();
+            } else {
+                create_directories(_cache_directory, ec);
+                if (ec) {
+                    LOG_WARNING("custom facts will not be cached: cannot create directory %1%: %2%.", _cache_directory, ec.message());
+                    _cache_directory.clear();
+                }
+            }
+        }
+
         // Register the block for logging callback with the GC
         _on_message_block = ruby.nil_value();
         ruby.rb_gc_register_address(&_on_message_block);
 
+        // Register the memoized confine results with the GC
+        _confine_results = ruby.rb_hash_new();
+        ruby.rb_gc_register_address(&_confine_results);
+
+        // Register the normalized fact names with the GC
+        _normalized_names = ruby.rb_hash_new();
+        ruby.rb_gc_register_address(&_normalized_names);
+
+        // Register the hash of every fact with the GC; it is built when first needed
+        _hash = ruby.nil_value();
+        ruby.rb_gc_register_address(&_hash);
+
+        // Discard the hash when facts in the collection change (e.g. when they are refreshed)
+        _subscription = _collection.subscribe([this](fact_change const&) {
+            _hash_stale = true;
+        });
+
         // Install a logging message handler
-        on_message([this](log_level level, string const& message) {
+        facter::logging::on_message([this](facter::logging::level level, string const& message) {
             auto const& ruby = *api::instance();
             if (ruby.is_nil(_on_message_block)) {
                 return true;
@@ -154,7 +245,7 @@ namespace facter { namespace ruby {
 
             // Call the block and don't log messages
             ruby.rescue([&]() {
-                ruby.rb_funcall(_on_message_block, ruby.rb_intern("call"), 2, level_to_symbol(level), ruby.utf8_value(message));
+                ruby.rb_funcall(_on_message_block, ruby.rb_intern("call"), 2, level_to_symbol(static_cast<log_level>(level)), ruby.utf8_value(message));
                 return ruby.nil_value();
             }, [&](VALUE) {
                 // Logging can take place from locations where we do not expect Ruby exceptions to be raised
@@ -216,6 +307,7 @@ namespace facter { namespace ruby {
         ruby.rb_define_singleton_method(execution, "which", RUBY_METHOD_FUNC(ruby_which), 1);
         ruby.rb_define_singleton_method(execution, "exec", RUBY_METHOD_FUNC(ruby_exec), 1);
         ruby.rb_define_singleton_method(execution, "execute", RUBY_METHOD_FUNC(ruby_execute), -1);
+        ruby.rb_define_singleton_method(execution, "execute_all", RUBY_METHOD_FUNC(ruby_execute_all), -1);
         ruby.rb_define_class_under(execution, "ExecutionFailure", *ruby.rb_eStandardError);
         ruby.rb_obj_freeze(execution);
 
@@ -240,6 +332,7 @@ namespace facter { namespace ruby {
     module::~module()
     {
         _instances.erase(_self);
+        _collection.unsubscribe(_subscription);
 
         clear_facts(false);
 
@@ -249,9 +342,12 @@ namespace facter { namespace ruby {
             return;
         }
 
-        // Unregister the on message block
+        // Unregister the on message block and the memoized confine results
         ruby->rb_gc_unregister_address(&_on_message_block);
-        on_message(nullptr);
+        ruby->rb_gc_unregister_address(&_confine_results);
+        ruby->rb_gc_unregister_address(&_normalized_names);
+        ruby->rb_gc_unregister_address(&_hash);
+        facter::logging::on_message(nullptr);
 
         // Undefine the module and restore the previous value
         ruby->rb_const_remove(*ruby->rb_cObject, ruby->rb_intern("Facter"));
@@ -275,20 +371,46 @@ namespace facter { namespace ruby {
             directory::each_file(directory, [&](string const& file) {
                 load_file(file);
                 return true;
-            }, "\\.rb$");
+            }, directory::name_filter::suffix(".rb"));
         }
 
         _loaded_all = true;
+
+        // Record which facts each file defines so that the next run can load only the files it needs
+        if (!_cache_directory.empty() && !manifest()) {
+            save_manifest();
+        }
     }
 
-    void module::resolve_facts()
+    void module::resolve_facts(set<string> const& queries)
     {
+        // Loading and resolving custom facts allocates many short-lived objects; collecting them may be pure overhead
+        scoped_gc_disable gc(_disable_gc);
+
         // Before we do anything, call facts to ensure the collection is populated
         facts();
 
+        auto const& ruby = *api::instance();
+
+        // Load only the files that define the queried facts; a fact named by an entire query takes precedence over its first segment
+        if (!queries.empty() && manifest()) {
+            for (auto const& query : queries) {
+                for (auto const& name : { query, query.substr(0, query.find('.')) }) {
+                    auto index = manifest();
+                    if (index && index->count(boost::to_lower_copy(name))) {
+                        fact_value(ruby.utf8_value(name));
+                    }
+                }
+            }
+            return;
+        }
+
         load_facts();
 
-        auto const& ruby = *api::instance();
+        // Resolve the facts in worker processes if requested; any a worker did not resolve are resolved below
+        if (_workers > 1) {
+            resolve_in_workers();
+        }
 
         // Get the value from all facts
         for (auto const& kvp : _facts) {
@@ -296,19 +418,31 @@ namespace facter { namespace ruby {
         }
     }
 
+    void module::workers(unsigned int count)
+    {
+        _workers = count;
+    }
+
+    void module::disable_gc(bool disable)
+    {
+        _disable_gc = disable;
+    }
+
     void module::clear_facts(bool clear_collection)
     {
         auto ruby = api::instance();
 
-        // Unregister all the facts
+        // Unregister all the facts and forget the confine results that depended on them
         if (ruby) {
             for (auto& kvp : _facts) {
-                ruby->rb_gc_unregister_address(&kvp.second);
+                ruby->release(kvp.second);
             }
+            _confine_results = ruby->rb_hash_new();
         }
 
         // Clear the custom facts
         _facts.clear();
+        invalidate_hash();
 
         // Clear the collection
         if (clear_collection) {
@@ -332,13 +466,43 @@ namespace facter { namespace ruby {
     {
         auto const& ruby = *api::instance();
 
-        if (ruby.is_symbol(name)) {
-            name = ruby.rb_sym_to_s(name);
+        if (!ruby.is_symbol(name) && !ruby.is_string(name)) {
+            return name;
         }
-        if (ruby.is_string(name)) {
-            name = ruby.rb_funcall(name, ruby.rb_intern("downcase"), 0);
+
+        // Custom facts look up the same names repeatedly, so remember the normalized name of each symbol and string
+        // Strings are found by their contents, so a name that was normalized before doesn't allocate
+        volatile VALUE normalized = ruby.rb_hash_lookup(_normalized_names, name);
+        if (!ruby.is_nil(normalized)) {
+            return normalized;
+        }
+        normalized = ruby.is_symbol(name) ? ruby.rb_sym_to_s(name) : name;
+        normalized = ruby.rb_obj_freeze(ruby.rb_funcall(normalized, ruby.rb_intern("downcase"), 0));
+
+        // Bound the names, as confines also normalize fact values
+        if (_normalized_count < 4096) {
+            ruby.rb_hash_aset(_normalized_names, name, normalized);
+            ++_normalized_count;
         }
-        return name;
+        return normalized;
+    }
+
+    VALUE module::confine_result(VALUE key) const
+    {
+        auto const& ruby = *api::instance();
+        return ruby.rb_hash_lookup(_confine_results, key);
+    }
+
+    void module::confine_result(VALUE key, bool suitable)
+    {
+        auto const& ruby = *api::instance();
+        ruby.rb_hash_aset(_confine_results, key, suitable ? ruby.true_value() : ruby.false_value());
+    }
+
+    void module::invalidate_hash()
+    {
+        _hash_stale = true;
+        _hash_entries.clear();
     }
 
     collection& module::facts()
@@ -377,7 +541,9 @@ namespace facter { namespace ruby {
             ruby.rb_raise(*ruby.rb_eArgError, "wrong number of arguments (%d for 2)", argc);
         }
 
-        VALUE fact_self = from_self(self)->create_fact(argv[0]);
+        auto instance = from_self(self);
+        VALUE fact_self = instance->create_fact(argv[0]);
+        instance->add_definition(argv[0]);
 
         // Read the resolution name from the options hash, if present
         volatile VALUE name = ruby.nil_value();
@@ -402,7 +568,9 @@ namespace facter { namespace ruby {
             ruby.rb_raise(*ruby.rb_eArgError, "wrong number of arguments (%d for 2)", argc);
         }
 
-        VALUE fact_self = from_self(self)->create_fact(argv[0]);
+        auto instance = from_self(self);
+        VALUE fact_self = instance->create_fact(argv[0]);
+        instance->add_definition(argv[0]);
 
         // Call the block if one was given
         if (ruby.rb_block_given_p()) {
@@ -512,10 +680,16 @@ namespace facter { namespace ruby {
     {
         auto const& ruby = *api::instance();
 
-        for (auto& kvp : from_self(self)->_facts)
+        module* instance = from_self(self);
+
+        for (auto& kvp : instance->_facts)
         {
             ruby.to_native<fact>(kvp.second)->flush();
         }
+
+        // The flushed facts may resolve differently, so the confines on them must be evaluated again
+        instance->_confine_results = ruby.rb_hash_new();
+        instance->invalidate_hash();
         return ruby.nil_value();
     }
 
@@ -524,31 +698,36 @@ namespace facter { namespace ruby {
         auto const& ruby = *api::instance();
         module* instance = from_self(self);
 
-        instance->resolve_facts();
-
-        volatile VALUE array = ruby.rb_ary_new_capa(instance->facts().size());
+        // Listing the names doesn't resolve any facts: the collection names the facts its resolvers declare,
+        // and custom facts are named by the manifest or by defining them
+        auto native = instance->facts().names();
+        set<string> names(native.begin(), native.end());
+        auto index = instance->_loaded_all ? nullptr : instance->manifest();
+        if (index) {
+            for (auto const& kvp : *index) {
+                names.insert(kvp.first);
+            }
+        } else {
+            instance->load_facts();
+        }
+        for (auto const& kvp : instance->_facts) {
+            names.insert(kvp.first);
+        }
 
-        instance->facts().each([&](string const& name, value const*) {
+        volatile VALUE array = ruby.rb_ary_new_capa(names.size());
+        for (auto const& name : names) {
             ruby.rb_ary_push(array, ruby.utf8_value(name));
-            return true;
-        });
+        }
         return array;
     }
 
     VALUE module::ruby_to_hash(VALUE self)
     {
         auto const& ruby = *api::instance();
-        module* instance = from_self(self);
 
-        instance->resolve_facts();
-
-        volatile VALUE hash = ruby.rb_hash_new();
-
-        instance->facts().each([&](string const& name, value const* val) {
-            ruby.rb_hash_aset(hash, ruby.utf8_value(name), ruby.to_ruby(val));
-            return true;
-        });
-        return hash;
+        // Callers may modify the hash (e.g. Puppet adds its own facts), so each call gets a copy sharing the keys and values
+        volatile VALUE hash = from_self(self)->fact_hash();
+        return ruby.rb_funcall(hash, ruby.rb_intern("dup"), 0);
     }
 
     VALUE module::ruby_each(VALUE self)
@@ -556,12 +735,12 @@ namespace facter { namespace ruby {
         auto const& ruby = *api::instance();
         module* instance = from_self(self);
 
-        instance->resolve_facts();
-
-        instance->facts().each([&](string const& name, value const* val) {
-            ruby.rb_yield_values(2, ruby.utf8_value(name), ruby.to_ruby(val));
-            return true;
-        });
+        // The block may define or flush facts, which discards the hash; the hash on the stack keeps the copied entries alive
+        volatile VALUE hash = instance->fact_hash();
+        auto entries = instance->_hash_entries;
+        for (auto const& entry : entries) {
+            ruby.rb_yield_values(2, entry.first, entry.second);
+        }
         return self;
     }
 
@@ -702,6 +881,87 @@ namespace facter { namespace ruby {
         return execute_command(ruby.to_string(argv[0]), option, false);
     }
 
+    VALUE module::ruby_execute_all(int argc, VALUE* argv, VALUE self)
+    {
+        // Note: self is Facter::Core::Execution
+        auto const& ruby = *api::instance();
+
+        if (argc == 0 || argc > 2) {
+            ruby.rb_raise(*ruby.rb_eArgError, "wrong number of arguments (%d for 2)", argc);
+        }
+        if (!ruby.is_array(argv[0])) {
+            ruby.rb_raise(*ruby.rb_eTypeError, "expected an Array of commands");
+        }
+
+        // As with execute, a failed command raises unless on_fail gives the value to use for it
+        bool raise = true;
+        volatile VALUE failure_default = ruby.nil_value();
+        if (argc == 2) {
+            volatile VALUE option = ruby.rb_hash_lookup(argv[1], ruby.rb_funcall(ruby.utf8_value("on_fail"), ruby.rb_intern("to_sym"), 0));
+            if (!ruby.is_symbol(option) || ruby.to_string(option) != "raise") {
+                raise = false;
+                failure_default = option;
+            }
+        }
+
+        volatile VALUE results = ruby.rb_ary_new_capa(static_cast<long>(ruby.rb_num2ulong(ruby.rb_funcall(argv[0], ruby.rb_intern("size"), 0))));
+        volatile VALUE failed = ruby.nil_value();
+        bool timed_out = false;
+
+        // Block to ensure that the commands and their output are destructed before raising.
+        {
+            vector<string> commands;
+            ruby.array_for_each(argv[0], [&](VALUE command) {
+                commands.emplace_back(ruby.to_string(command));
+                return true;
+            });
+
+            // Run the commands together so that their process startup and output overlap
+            vector<pair<bool, string>> outputs(commands.size());
+            executor runner;
+            for (size_t i = 0; i < commands.size(); ++i) {
+                auto invocation = command_invocation(commands[i]);
+                runner.add(
+                    invocation.first,
+                    invocation.second,
+                    [&outputs, i](bool success, string& output) {
+                        outputs[i] = make_pair(success, move(output));
+                    },
+                    option_set<execution_options> {
+                        execution_options::defaults,
+                        execution_options::redirect_stderr
+                    });
+            }
+            try {
+                runner.run();
+            } catch (deadline_exceeded_exception&) {
+                // The resolution's timeout passed and the commands were killed
+                timed_out = true;
+            } catch (execution_exception& ex) {
+                LOG_DEBUG("failed to execute commands: %1%.", ex.what());
+            }
+
+            for (size_t i = 0; i < commands.size(); ++i) {
+                if (outputs[i].first) {
+                    ruby.rb_ary_push(results, ruby.utf8_value(outputs[i].second));
+                    continue;
+                }
+                if (ruby.is_nil(failed)) {
+                    failed = ruby.utf8_value(commands[i]);
+                }
+                ruby.rb_ary_push(results, failure_default);
+            }
+        }
+
+        if (timed_out) {
+            raise_timed_out(ruby.is_nil(failed) ? "" : ruby.rb_string_value_ptr(const_cast<VALUE*>(&failed)));
+        }
+        if (raise && !ruby.is_nil(failed)) {
+            ruby.rb_raise(ruby.lookup({ "Facter", "Core", "Execution", "ExecutionFailure"}), "execution of command \"%s\" failed", ruby.rb_string_value_ptr(const_cast<VALUE*>(&failed)));
+        }
+        return results;
+    }
+
     VALUE module::ruby_on_message(VALUE self)
     {
         auto const& ruby = *api::instance();
@@ -726,23 +986,43 @@ namespace facter { namespace ruby {
         auto const& ruby = *api::instance();
 
         // Block to ensure that result is destructed before raising.
+        bool timed_out = false;
         {
-            auto result = execution::execute(execution::command_shell,
-                {execution::command_args, expand_command(command)},
-                option_set<execution_options> {
-                    execution_options::defaults,
-                    execution_options::redirect_stderr
-                });
-            if (result.first) {
-                return ruby.utf8_value(result.second);
+            try {
+                auto invocation = command_invocation(command);
+                auto result = execution::execute(invocation.first, invocation.second,
+                    option_set<execution_options> {
+                        execution_options::defaults,
+                        execution_options::redirect_stderr
+                    });
+                if (result.first) {
+                    return ruby.utf8_value(result.second);
+                }
+            } catch (deadline_exceeded_exception&) {
+                // The resolution's timeout passed and the command was killed
+                timed_out = true;
             }
         }
+        if (timed_out) {
+            raise_timed_out(command.c_str());
+        }
         if (raise) {
             ruby.rb_raise(ruby.lookup({ "Facter", "Core", "Execution", "ExecutionFailure"}), "execution of command \"%s\" failed", command.c_str());
         }
         return failure_default;
     }
 
+    void module::raise_timed_out(char const* command)
+    {
+        auto const& ruby = *api::instance();
+
+        // Raise the same error as Ruby's Timeout so the resolution is abandoned like any other that times out
+        if (ruby.rb_const_defined(*ruby.rb_cObject, ruby.rb_intern("Timeout"))) {
+            ruby.rb_raise(ruby.lookup({ "Timeout", "Error" }), "execution of command \"%s\" timed out", command);
+        }
+        ruby.rb_raise(ruby.lookup({ "Facter", "Core", "Execution", "ExecutionFailure"}), "execution of command \"%s\" timed out", command);
+    }
+
     void module::initialize_search_paths(vector<string> const& paths)
     {
         auto const& ruby = *api::instance();
@@ -813,8 +1093,24 @@ namespace facter { namespace ruby {
             return it->second;
         }
 
+        // With a current manifest, only the files that define the fact are loaded
+        auto index = _loaded_all ? nullptr : manifest();
+        if (index) {
+            auto files = index->find(fact_name);
+            if (files != index->end()) {
+                // Copy the files as loading them may change the search paths and therefore the manifest
+                for (auto const& file : vector<string>(files->second)) {
+                    load_file(file);
+                }
+                it = _facts.find(fact_name);
+                if (it != _facts.end()) {
+                    return it->second;
+                }
+            }
+        }
+
         // Try to load it by file name
-        if (!_loaded_all) {
+        if (!_loaded_all && !index) {
             // Next, attempt to load it by file
             string filename = fact_name + ".rb";
             LOG_DEBUG("searching for custom fact \"%1%\".", fact_name);
@@ -847,7 +1143,10 @@ namespace facter { namespace ruby {
         }
 
         // Couldn't load the fact by file name, load all facts to try to find it
-        load_facts();
+        // A current manifest lists every custom fact, so there is nothing more to load
+        if (!index) {
+            load_facts();
+        }
 
         // Check to see if we now have the fact
         it = _facts.find(fact_name);
@@ -870,15 +1169,280 @@ namespace facter { namespace ruby {
         auto const& ruby = *api::instance();
 
         LOG_INFO("loading custom facts from %1%.", path);
+
+        // Record the time spent loading (and compiling) the file, which excludes any facts it resolves
+        statistics stats;
+        scoped_statistics recording(stats);
+        scoped_trace_span tracing("ruby load", path);
+        volatile VALUE iseq = _cache_directory.empty() ? ruby.nil_value() : load_compiled(path);
+        _loading.push_back(path);
         ruby.rescue([&]() {
             // Do not construct C++ objects in a rescue callback
             // C++ stack unwinding will not take place if a Ruby exception is thrown!
-            ruby.rb_load(ruby.utf8_value(path), 0);
+            if (ruby.is_nil(iseq)) {
+                ruby.rb_load(ruby.utf8_value(path), 0);
+            } else {
+                ruby.rb_funcall(iseq, ruby.rb_intern("eval"), 0);
+            }
             return 0;
         }, [&](VALUE ex) {
             LOG_ERROR("error while resolving custom facts in %1%: %2%", path, ruby.exception_to_string(ex));
             return 0;
         });
+        _loading.pop_back();
+        _collection.record_timing("load " + path, stats);
+    }
+
+    VALUE module::load_compiled(string const& file)
+    {
+        auto const& ruby = *api::instance();
+
+        // The compiled form is only valid for the Ruby that compiled it, so the version is part of the key
+        // The cached file is given the modification time of the source file so that a change to the source is detected
+        boost::system::error_code ec;
+        auto modified = last_write_time(file, ec);
+        if (ec) {
+            return ruby.nil_value();
+        }
+        ostringstream key;
+        key << hex << hash<string>()(file + '\0' + ruby.to_string(ruby.rb_const_get(*ruby.rb_cObject, ruby.rb_intern("RUBY_VERSION"))));
+        string cached = (path(_cache_directory) / (key.str() + ".bin")).string();
+        string temporary = cached + "." + unique_path().string() + ".tmp";
+        bool current = last_write_time(cached, ec) == modified && !ec;
+
+        volatile VALUE iseq_class = ruby.lookup({ "RubyVM", "InstructionSequence" });
+        volatile VALUE file_class = ruby.lookup({ "File" });
+        volatile VALUE source = ruby.utf8_value(file);
+        volatile VALUE destination = ruby.utf8_value(current ? cached : temporary);
+        bool failed = false;
+        volatile VALUE iseq = ruby.rescue([&]() -> VALUE {
+            // Do not construct C++ objects in a rescue callback
+            // C++ stack unwinding will not take place if a Ruby exception is thrown!
+            if (current) {
+                return ruby.rb_funcall(iseq_class, ruby.rb_intern("load_from_binary"), 1, ruby.rb_funcall(file_class, ruby.rb_intern("binread"), 1, destination));
+            }
+            volatile VALUE compiled = ruby.rb_funcall(iseq_class, ruby.rb_intern("compile_file"), 1, source);
+            ruby.rb_funcall(file_class, ruby.rb_intern("binwrite"), 2, destination, ruby.rb_funcall(compiled, ruby.rb_intern("to_binary"), 0));
+            return compiled;
+        }, [&](VALUE) {
+            failed = true;
+            return ruby.nil_value();
+        });
+        if (failed) {
+            // The file is loaded from source, which reports any error in it
+            LOG_DEBUG("custom facts in %1% could not be loaded from or saved to the cache.", file);
+            boost::filesystem::remove(temporary, ec);
+            return ruby.nil_value();
+        }
+        if (current) {
+            LOG_DEBUG("loaded compiled custom facts for %1% from %2%.", file, cached);
+            return iseq;
+        }
+
+        // Replace the cached file only once it is complete, as other processes may be reading it
+        last_write_time(temporary, modified, ec);
+        if (!ec) {
+            boost::filesystem::rename(temporary, cached, ec);
+        }
+        if (ec) {
+            boost::filesystem::remove(temporary, ec);
+        }
+        return iseq;
+    }
+
+    // Reads the manifest of the custom facts defined by each file in the given cache directory
+    // Returns false if the manifest is missing or invalid or if a custom fact file in its search paths was added, removed, or changed
+    static bool read_manifest(string const& cache_directory, vector<string>& paths, map<string, vector<string>>& manifest)
+    {
+        string manifest_path = (path(cache_directory) / "manifest.json").string();
+        string contents;
+        if (!file::read(manifest_path, contents)) {
+            return false;
+        }
+        rapidjson::Document document;
+        document.Parse<0>(contents.c_str());
+        if (document.HasParseError() || !document.IsObject() || !document.HasMember("paths") || !document["paths"].IsArray() ||
+            !document.HasMember("files") || !document["files"].IsObject()) {
+            LOG_DEBUG("custom fact manifest %1% is invalid and will be regenerated.", manifest_path);
+            return false;
+        }
+        auto const& stored_paths = document["paths"];
+        for (auto it = stored_paths.Begin(); it != stored_paths.End(); ++it) {
+            if (!it->IsString()) {
+                return false;
+            }
+            paths.emplace_back(it->GetString());
+        }
+
+        auto const& files = document["files"];
+        set<string> found;
+        bool current = true;
+        for (auto const& directory : paths) {
+            if (!current) {
+                break;
+            }
+            directory::each_file(directory, [&](string const& file) {
+                found.insert(file);
+                boost::system::error_code ec;
+                auto modified = last_write_time(file, ec);
+                auto size = file_size(file, ec);
+                if (ec || !files.HasMember(file.c_str())) {
+                    current = false;
+                    return false;
+                }
+                auto const& entry = files[file.c_str()];
+                if (!entry.IsObject() || !entry.HasMember("modified") || !entry["modified"].IsInt64() ||
+                    entry["modified"].GetInt64() != static_cast<int64_t>(modified) || !entry.HasMember("size") ||
+                    !entry["size"].IsUint64() || entry["size"].GetUint64() != size || !entry.HasMember("facts") || !entry["facts"].IsArray()) {
+                    current = false;
+                    return false;
+                }
+                auto const& names = entry["facts"];
+                for (auto name = names.Begin(); name != names.End(); ++name) {
+                    if (name->IsString()) {
+                        manifest[name->GetString()].push_back(file);
+                    }
+                }
+                return true;
+            }, directory::name_filter::suffix(".rb"));
+        }
+        if (!current || static_cast<size_t>(distance(files.MemberBegin(), files.MemberEnd())) != found.size()) {
+            LOG_DEBUG("custom fact manifest %1% is out of date and will be regenerated.", manifest_path);
+            manifest.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool module::may_define(string const& cache_directory, vector<string> const& paths, set<string> const& queries)
+    {
+        vector<string> stored_paths;
+        map<string, vector<string>> manifest;
+        if (queries.empty() || cache_directory.empty() || !read_manifest(cache_directory, stored_paths, manifest)) {
+            return true;
+        }
+
+        // The directories on Ruby's load path can't be known without Ruby, but the others must have been searched
+        vector<string> directories = paths;
+        string variable;
+        if (environment::get("FACTERLIB", variable)) {
+            boost::split(directories, variable, bind(equal_to<char>(), placeholders::_1, environment::get_path_separator()), boost::token_compress_on);
+            directories.insert(directories.end(), paths.begin(), paths.end());
+        }
+        for (auto const& directory : directories) {
+            boost::system::error_code ec;
+            auto canonical_directory = canonical(directory, ec).string();
+            if (!ec && find(stored_paths.begin(), stored_paths.end(), canonical_directory) == stored_paths.end()) {
+                return true;
+            }
+        }
+
+        for (auto const& query : queries) {
+            if (manifest.count(boost::to_lower_copy(query)) || manifest.count(boost::to_lower_copy(query.substr(0, query.find('.'))))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    map<string, vector<string>> const* module::manifest()
+    {
+        if (_cache_directory.empty()) {
+            return nullptr;
+        }
+        if (_manifest_checked && _manifest_paths == _search_paths) {
+            return _manifest_valid ? &_manifest : nullptr;
+        }
+        _manifest_checked = true;
+        _manifest_paths = _search_paths;
+        _manifest_valid = false;
+        _manifest.clear();
+
+        // The manifest is only used for the same search paths
+        vector<string> paths;
+        if (!read_manifest(_cache_directory, paths, _manifest) || paths != _search_paths) {
+            _manifest.clear();
+            return nullptr;
+        }
+
+        LOG_DEBUG("loaded custom fact manifest from %1%.", _cache_directory);
+        _manifest_valid = true;
+        return &_manifest;
+    }
+
+    void module::save_manifest()
+    {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        writer.StartObject();
+        writer.String("paths");
+        writer.StartArray();
+        for (auto const& directory : _search_paths) {
+            writer.String(directory.c_str(), static_cast<rapidjson::SizeType>(directory.size()));
+        }
+        writer.EndArray();
+        writer.String("files");
+        writer.StartObject();
+        set<string> written;
+        for (auto const& directory : _search_paths) {
+            directory::each_file(directory, [&](string const& file) {
+                boost::system::error_code ec;
+                auto modified = last_write_time(file, ec);
+                auto size = file_size(file, ec);
+                if (ec || !written.insert(file).second) {
+                    return true;
+                }
+                writer.String(file.c_str(), static_cast<rapidjson::SizeType>(file.size()));
+                writer.StartObject();
+                writer.String("modified");
+                writer.Int64(static_cast<int64_t>(modified));
+                writer.String("size");
+                writer.Uint64(size);
+                writer.String("facts");
+                writer.StartArray();
+                auto definitions = _definitions.find(file);
+                if (definitions != _definitions.end()) {
+                    for (auto const& name : definitions->second) {
+                        writer.String(name.c_str(), static_cast<rapidjson::SizeType>(name.size()));
+                    }
+                }
+                writer.EndArray();
+                writer.EndObject();
+                return true;
+            }, directory::name_filter::suffix(".rb"));
+        }
+        writer.EndObject();
+        writer.EndObject();
+
+        // Write to a temporary file and rename it so that other processes never read a partial manifest
+        string manifest_path = (path(_cache_directory) / "manifest.json").string();
+        string temporary = manifest_path + "." + unique_path().string() + ".tmp";
+        boost::system::error_code ec;
+        {
+            boost::nowide::ofstream out(temporary.c_str(), ios::out | ios::binary | ios::trunc);
+            out << buffer.GetString();
+            if (!out) {
+                LOG_DEBUG("custom fact manifest %1% could not be written.", temporary);
+                boost::filesystem::remove(temporary, ec);
+                return;
+            }
+        }
+        boost::filesystem::rename(temporary, manifest_path, ec);
+        if (ec) {
+            LOG_DEBUG("custom fact manifest %1% could not be written: %2%.", manifest_path, ec.message());
+            boost::filesystem::remove(temporary, ec);
+            return;
+        }
+        LOG_DEBUG("saved custom fact manifest %1%.", manifest_path);
+    }
+
+    void module::add_definition(VALUE name)
+    {
+        // Remember the file that defined the fact, as opposed to a file that only looked it up
+        if (!_loading.empty()) {
+            auto const& ruby = *api::instance();
+            _definitions[_loading.back()].insert(ruby.to_string(normalize(name)));
+        }
     }
 
     VALUE module::create_fact(VALUE name)
@@ -898,11 +1462,199 @@ namespace facter { namespace ruby {
             // Before adding the first fact, call facts to ensure the collection is populated
             facts();
             it = _facts.insert(make_pair(fact_name, fact::create(name))).first;
-            ruby.rb_gc_register_address(&it->second);
+            ruby.retain(it->second);
+            invalidate_hash();
         }
         return it->second;
     }
 
+    VALUE module::fact_hash()
+    {
+        auto const& ruby = *api::instance();
+
+        if (!_hash_stale && !ruby.is_nil(_hash)) {
+            return _hash;
+        }
+
+        resolve_facts();
+
+        // Get each value through its fact so that the converted Ruby object is shared with Facter.value
+        // Getting the values creates facts for the native facts, which discards the hash, so it is only stored once built
+        auto& facts = this->facts();
+        vector<pair<VALUE, VALUE>> entries;
+        entries.reserve(facts.size());
+        volatile VALUE hash = ruby.hash_with_capacity(facts.size());
+        facts.each([&](string const& name, value const*) {
+            VALUE key = ruby.key_value(name);
+            volatile VALUE val = fact_value(key);
+            ruby.rb_hash_aset(hash, key, val);
+            entries.emplace_back(key, val);
+            return true;
+        });
+
+        _hash = hash;
+        _hash_entries = move(entries);
+        _hash_stale = false;
+        return _hash;
+    }
+
+    void module::resolve_in_workers()
+    {
+        auto const& ruby = *api::instance();
+
+        // Workers are only started once; a fact calling Facter.to_hash resolves in the process it runs in
+        size_t count = min<size_t>(_workers, _facts.size());
+        _workers = 0;
+
+        volatile VALUE process = ruby.rb_const_get(*ruby.rb_cObject, ruby.rb_intern("Process"));
+        if (!ruby.is_true(ruby.rb_funcall(process, ruby.rb_intern("respond_to?"), 1, ruby.utf8_value("fork")))) {
+            LOG_WARNING("custom facts will be resolved in this process: worker processes are not supported on this platform.");
+            return;
+        }
+        if (count < 2) {
+            return;
+        }
+
+        // Resolve the native facts first so that every worker doesn't resolve them again
+        _collection.size();
+
+        // Divide the custom facts between the workers
+        vector<vector<string>> assignments(count);
+        size_t index = 0;
+        for (auto const& kvp : _facts) {
+            assignments[index++ % count].push_back(kvp.first);
+        }
+
+        LOG_DEBUG("resolving %1% custom facts in %2% worker processes.", _facts.size(), count);
+
+        // The process id and output pipe of each worker are kept in a Ruby array so that the GC can see them
+        volatile VALUE workers = ruby.rb_ary_new_capa(static_cast<long>(count * 2));
+        size_t started_count = 0;
+        for (index = 0; index < count; ++index) {
+            volatile VALUE pid = ruby.nil_value();
+            volatile VALUE reader = ruby.nil_value();
+            volatile VALUE writer = ruby.nil_value();
+            bool started = false;
+            ruby.rescue([&]() {
+                // Do not construct C++ objects in a rescue callback
+                // C++ stack unwinding will not take place if a Ruby exception is thrown!
+                volatile VALUE pipe = ruby.rb_funcall(ruby.rb_const_get(*ruby.rb_cObject, ruby.rb_intern("IO")), ruby.rb_intern("pipe"), 0);
+                reader = ruby.rb_ary_entry(pipe, 0);
+                writer = ruby.rb_ary_entry(pipe, 1);
+                ruby.rb_funcall(reader, ruby.rb_intern("binmode"), 0);
+                ruby.rb_funcall(writer, ruby.rb_intern("binmode"), 0);
+                pid = ruby.rb_funcall(process, ruby.rb_intern("fork"), 0);
+                started = true;
+                return 0;
+            }, [&](VALUE ex) {
+                LOG_WARNING("failed to start a worker process for custom facts: %1%.", ruby.exception_to_string(ex));
+                return 0;
+            });
+            if (!started) {
+                break;
+            }
+            if (ruby.is_nil(pid)) {
+                // This is the worker; it exits once its facts are written
+                ruby.rb_funcall(reader, ruby.rb_intern("close"), 0);
+                run_worker(assignments[index], writer);
+            }
+            ruby.rb_funcall(writer, ruby.rb_intern("close"), 0);
+            ruby.rb_ary_push(workers, pid);
+            ruby.rb_ary_push(workers, reader);
+            ++started_count;
+        }
+
+        // Read each worker's facts; the facts of a worker that failed are resolved in this process
+        for (index = 0; index < started_count; ++index) {
+            volatile VALUE data = ruby.nil_value();
+            bool success = false;
+            ruby.rescue([&]() {
+                // Do not construct C++ objects in a rescue callback
+                // C++ stack unwinding will not take place if a Ruby exception is thrown!
+                volatile VALUE reader = ruby.rb_ary_entry(workers, static_cast<long>(index * 2 + 1));
+                data = ruby.rb_funcall(reader, ruby.rb_intern("read"), 0);
+                ruby.rb_funcall(reader, ruby.rb_intern("close"), 0);
+                volatile VALUE status = ruby.rb_funcall(process, ruby.rb_intern("wait2"), 1, ruby.rb_ary_entry(workers, static_cast<long>(index * 2)));
+                success = ruby.is_true(ruby.rb_funcall(ruby.rb_ary_entry(status, 1), ruby.rb_intern("success?"), 0));
+                return 0;
+            }, [&](VALUE ex) {
+                LOG_WARNING("failed to read the facts of a custom fact worker: %1%.", ruby.exception_to_string(ex));
+                return 0;
+            });
+            if (!success) {
+                LOG_WARNING("a custom fact worker process failed: its facts will be resolved in this process.");
+                continue;
+            }
+
+            map<string, unique_ptr<value>> resolved;
+            try {
+                read_msgpack_facts(ruby.to_string(data), [&](string&& name, unique_ptr<value> val) {
+                    resolved[move(name)] = move(val);
+                });
+            } catch (msgpack_exception& ex) {
+                LOG_WARNING("the facts of a custom fact worker could not be decoded: %1%: they will be resolved in this process.", ex.what());
+                continue;
+            }
+
+            // A fact the worker did not return resolved to nil
+            for (auto const& name : assignments[index]) {
+                auto it = resolved.find(name);
+                _collection.add(name, it == resolved.end() ? nullptr : move(it->second));
+                ruby.to_native<fact>(_facts[name])->value(ruby.to_ruby(_collection[name]));
+            }
+        }
+    }
+
+    void module::run_worker(vector<string> const& names, VALUE writer)
+    {
+        auto const& ruby = *api::instance();
+
+        // The parent's logging thread wasn't copied into the worker, so the worker starts its own
+        facter::logging::restart_logging_after_fork();
+
+        // Commands are started by the worker itself; the spawn helper's connection belongs to the parent
+        stop_spawn_helper();
+
+        int status = 1;
+        try {
+            // Resolve the worker's facts and write the values in the collection (including any built-in value a fact did not replace)
+            string buffer;
+            msgpack_writer output(buffer);
+            vector<pair<string const*, value const*>> values;
+            for (auto const& name : names) {
+                ruby.to_native<fact>(_facts[name])->value();
+                auto val = _collection[name];
+                if (val) {
+                    values.emplace_back(&name, val);
+                }
+            }
+            output.start_map(values.size());
+            for (auto const& kvp : values) {
+                output.str(*kvp.first);
+                kvp.second->to_msgpack(output);
+            }
+
+            volatile VALUE data = ruby.utf8_value(buffer);
+            ruby.rescue([&]() {
+                // Do not construct C++ objects in a rescue callback
+                // C++ stack unwinding will not take place if a Ruby exception is thrown!
+                ruby.rb_funcall(writer, ruby.rb_intern("write"), 1, data);
+                ruby.rb_funcall(writer, ruby.rb_intern("close"), 0);
+                status = 0;
+                return 0;
+            }, [&](VALUE ex) {
+                LOG_ERROR("custom fact worker failed to write its facts: %1%.", ruby.exception_to_string(ex));
+                return 0;
+            });
+        } catch (exception& ex) {
+            LOG_ERROR("custom fact worker failed: %1%.", ex.what());
+        }
+
+        // Exit without running the parent's exit handlers or flushing its buffered output, but write what the worker logged
+        facter::logging::flush_logging();
+        ruby.rb_funcall(ruby.rb_const_get(*ruby.rb_cObject, ruby.rb_intern("Process")), ruby.rb_intern("exit!"), 1, ruby.rb_int2inum(status));
+    }
+
     VALUE module::level_to_symbol(log_level level)
     {
         auto const& ruby = *api::instance();
@@ -9,7 +9,8 @@ namespace facter { namespace ruby {
 
     resolution::resolution() :
         _has_weight(false),
-        _weight(0)
+        _weight(0),
+        _timeout(0)
     {
         auto const& ruby = *api::instance();
         _name = ruby.nil_value();
@@ -31,6 +32,16 @@ namespace facter { namespace ruby {
         _name = name;
     }
 
+    string const& resolution::timing_name() const
+    {
+        return _timing_name;
+    }
+
+    void resolution::timing_name(string name)
+    {
+        _timing_name = move(name);
+    }
+
     size_t resolution::weight() const
     {
         if (_has_weight) {
@@ -45,6 +56,16 @@ namespace facter { namespace ruby {
         _weight = weight;
     }
 
+    double resolution::timeout() const
+    {
+        return _timeout;
+    }
+
+    void resolution::timeout(double seconds)
+    {
+        _timeout = seconds < 0 ? 0 : seconds;
+    }
+
     VALUE resolution::value()
     {
         return _value;
@@ -196,12 +217,9 @@ namespace facter { namespace ruby {
 
     VALUE resolution::ruby_timeout(VALUE self, VALUE timeout)
     {
-        static bool timeout_warning = true;
-        if (timeout_warning) {
-            LOG_WARNING("timeout= is not supported for custom facts and will be ignored.")
-            timeout_warning = false;
-        }
-        // Do nothing as we don't support timeouts
+        auto const& ruby = *api::instance();
+
+        ruby.to_native<resolution>(self)->timeout(ruby.rb_num2dbl(timeout));
         return self;
     }
 
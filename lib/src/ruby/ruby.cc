@@ -1,27 +1,34 @@
 #include <facter/ruby/ruby.hpp>
 #include <internal/ruby/api.hpp>
 #include <internal/ruby/module.hpp>
+#include <leatherman/logging/logging.hpp>
 
 using namespace std;
 using namespace facter::facts;
 
 namespace facter { namespace ruby {
 
-    bool initialize(bool include_stack_trace)
+    bool initialize(bool include_stack_trace, string const& library_cache)
     {
-        api* ruby = api::instance();
-        if (!ruby) {
-            return false;
-        }
-        ruby->initialize();
-        ruby->include_stack_trace(include_stack_trace);
+        // Ruby is located and initialized only once custom facts or the ruby facts are needed
+        api::library_cache = library_cache;
+        api::defer_initialize(include_stack_trace);
         return true;
     }
 
-    void load_custom_facts(collection& facts, vector<string> const& paths)
+    void load_custom_facts(collection& facts, vector<string> const& paths, string const& cache_directory, set<string> const& queries, unsigned int workers, bool disable_gc)
     {
-        module mod(facts, paths);
-        mod.resolve_facts();
+        if (!module::may_define(cache_directory, paths, queries)) {
+            LOG_DEBUG("no custom fact defines a queried fact: ruby will not be loaded.");
+            return;
+        }
+        if (!api::initialized_instance()) {
+            return;
+        }
+        module mod(facts, paths, cache_directory);
+        mod.workers(workers);
+        mod.disable_gc(disable_gc);
+        mod.resolve_facts(queries);
     }
 
 }}  // namespace facter::ruby
@@ -16,24 +16,27 @@ namespace facter { namespace ruby {
         _value(value)
     {
         auto const& ruby = *api::instance();
-        ruby.rb_gc_register_address(&_value);
+        ruby.retain(_value);
     }
 
     ruby_value::~ruby_value()
     {
         auto const& ruby = *api::instance();
-        ruby.rb_gc_unregister_address(&_value);
+        ruby.release(_value);
     }
 
     ruby_value::ruby_value(ruby_value&& other) :
         _value(other._value)
     {
         auto const& ruby = *api::instance();
-        ruby.rb_gc_register_address(&_value);
+        ruby.retain(_value);
     }
 
     ruby_value& ruby_value::operator=(ruby_value&& other)
     {
+        auto const& ruby = *api::instance();
+        ruby.retain(other._value);
+        ruby.release(_value);
         _value = other._value;
         return *this;
     }
@@ -63,8 +63,8 @@ namespace facter { namespace ruby {
         }
 
         // Otherwise, we were given a command so execute it
-        auto result = execute(command_shell,
-            {command_args, expand_command(_command)},
+        auto invocation = command_invocation(_command);
+        auto result = execute(invocation.first, invocation.second,
             option_set<execution_options> {
                 execution_options::defaults,
                 execution_options::redirect_stderr
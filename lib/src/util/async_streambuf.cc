@@ -0,0 +1,139 @@
+#include <internal/util/async_streambuf.hpp>
+#include <boost/thread/locks.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    async_streambuf::async_streambuf(ostream& target, size_t capacity, function<void(string&)> format) :
+        _target(target),
+        _format(move(format)),
+        _queue(capacity),
+        _queued(0),
+        _written(0),
+        _sleeping(false),
+        _stopping(false)
+    {
+        _writer = boost::thread([this]() { write(); });
+    }
+
+    async_streambuf::~async_streambuf()
+    {
+        // Write what's left of the calling thread's line along with anything queued
+        sync();
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _stopping = true;
+            _wake.notify_one();
+        }
+        _writer.join();
+    }
+
+    void async_streambuf::drain()
+    {
+        sync();
+        uint64_t target = _queued;
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        _wake.notify_one();
+        while (_written < target) {
+            _drained.wait(lock);
+        }
+    }
+
+    async_streambuf::int_type async_streambuf::overflow(int_type c)
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        auto& text = line();
+        text += traits_type::to_char_type(c);
+        if (text.back() == '\n') {
+            sync();
+        }
+        return c;
+    }
+
+    streamsize async_streambuf::xsputn(char const* s, streamsize n)
+    {
+        auto& text = line();
+        text.append(s, static_cast<size_t>(n));
+        if (!text.empty() && text.back() == '\n') {
+            sync();
+        }
+        return n;
+    }
+
+    int async_streambuf::sync()
+    {
+        auto text = _line.get();
+        if (text && !text->empty()) {
+            // The line is handed off whole; the thread starts a new one
+            _line.release();
+            if (_format) {
+                _format(*text);
+            }
+            push(text);
+        }
+        return 0;
+    }
+
+    string& async_streambuf::line()
+    {
+        auto text = _line.get();
+        if (!text) {
+            text = new string();
+            _line.reset(text);
+        }
+        return *text;
+    }
+
+    void async_streambuf::push(string* text)
+    {
+        ++_queued;
+
+        // Only wait when the ring is full, which means the writer has fallen behind
+        while (!_queue.push(text)) {
+            boost::this_thread::yield();
+        }
+
+        // Only take the lock to wake the writer when it is asleep
+        // The fence pairs with the writer's so that either the writer sees the line or this sees the writer asleep
+        atomic_thread_fence(memory_order_seq_cst);
+        if (_sleeping) {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _wake.notify_one();
+        }
+    }
+
+    void async_streambuf::write()
+    {
+        while (true) {
+            string* text;
+            bool wrote = false;
+            while (_queue.pop(text)) {
+                _target.write(text->data(), static_cast<streamsize>(text->size()));
+                delete text;
+                ++_written;
+                wrote = true;
+            }
+            if (wrote) {
+                _target.flush();
+            }
+
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _drained.notify_all();
+            if (_stopping && _queue.empty()) {
+                break;
+            }
+
+            // Announce the sleep before checking the queue so that a push after the check will wake the writer
+            _sleeping = true;
+            atomic_thread_fence(memory_order_seq_cst);
+            if (_queue.empty() && !_stopping) {
+                _wake.wait(lock);
+            }
+            _sleeping = false;
+        }
+    }
+
+}}  // namespace facter::util
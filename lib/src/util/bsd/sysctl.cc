@@ -0,0 +1,109 @@
+#include <internal/util/bsd/sysctl.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <cerrno>
+
+using namespace std;
+
+namespace facter { namespace util { namespace bsd {
+
+    static bool get_mib(string const& name, vector<int>& mib)
+    {
+        // Names never change their MIB while the system is up, so translate each name once
+        // Names that failed to translate are remembered as an empty MIB so that they aren't retried
+        static boost::mutex mutex;
+        static map<string, vector<int>> mibs;
+
+        boost::lock_guard<boost::mutex> lock(mutex);
+        auto it = mibs.find(name);
+        if (it == mibs.end()) {
+            vector<int> translated(CTL_MAXNAME);
+            size_t length = translated.size();
+            if (sysctlnametomib(name.c_str(), translated.data(), &length) == -1) {
+                LOG_DEBUG("sysctlnametomib failed for %1%: %2% (%3%).", name, strerror(errno), errno);
+                length = 0;
+            }
+            translated.resize(length);
+            it = mibs.emplace(name, move(translated)).first;
+        }
+        mib = it->second;
+        return !mib.empty();
+    }
+
+    static bool read_value(vector<int>& mib, vector<char>& value)
+    {
+        // The size of a value can grow between asking for it and reading it, so retry until the buffer is large enough
+        while (true) {
+            size_t length = 0;
+            if (sysctl(mib.data(), static_cast<u_int>(mib.size()), nullptr, &length, nullptr, 0) == -1) {
+                return false;
+            }
+            value.resize(length);
+            if (sysctl(mib.data(), static_cast<u_int>(mib.size()), value.data(), &length, nullptr, 0) == 0) {
+                value.resize(length);
+                return true;
+            }
+            if (errno != ENOMEM) {
+                return false;
+            }
+        }
+    }
+
+    vector<char> const* sysctl_snapshot::get(string const& name)
+    {
+        auto it = _values.find(name);
+        if (it != _values.end()) {
+            return &it->second;
+        }
+        if (_missing.count(name)) {
+            return nullptr;
+        }
+
+        vector<int> mib;
+        vector<char> value;
+        if (!get_mib(name, mib)) {
+            _missing.insert(name);
+            return nullptr;
+        }
+        if (!read_value(mib, value)) {
+            LOG_DEBUG("sysctl failed for %1%: %2% (%3%).", name, strerror(errno), errno);
+            _missing.insert(name);
+            return nullptr;
+        }
+        return &_values.emplace(name, move(value)).first->second;
+    }
+
+    bool sysctl_snapshot::get_string(string const& name, string& value)
+    {
+        auto raw = get(name);
+        if (!raw || raw->empty()) {
+            return false;
+        }
+        // Stop at the first null; the reported length includes the terminator
+        value.assign(raw->data(), strnlen(raw->data(), raw->size()));
+        return true;
+    }
+
+    bool sysctl_snapshot::get_integer(string const& name, uint64_t& value)
+    {
+        auto raw = get(name);
+        if (!raw) {
+            return false;
+        }
+        if (raw->size() == sizeof(uint32_t)) {
+            uint32_t narrow;
+            memcpy(&narrow, raw->data(), sizeof(narrow));
+            value = narrow;
+            return true;
+        }
+        if (raw->size() == sizeof(uint64_t)) {
+            memcpy(&value, raw->data(), sizeof(value));
+            return true;
+        }
+        return false;
+    }
+
+}}}  // namespace facter::util::bsd
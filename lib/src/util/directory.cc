@@ -1,62 +1,90 @@
 #include <facter/util/directory.hpp>
 #include <internal/util/regex.hpp>
-#include <boost/filesystem.hpp>
 
 using namespace std;
-using namespace boost::filesystem;
 
 namespace facter { namespace util {
 
-    void directory::each_file(string const& directory, function<bool(string const&)> callback, string const& pattern)
+    static bool glob_match(char const* pattern, char const* name)
     {
-        boost::regex regex(pattern);
-
-        // Attempt to iterate the directory
-        boost::system::error_code ec;
-        directory_iterator it = directory_iterator(directory, ec);
-        if (ec) {
-            return;
-        }
-
-        // Call the callback for any matching files
-        directory_iterator end;
-        for (; it != end; ++it) {
-            boost::system::error_code ec;
-            if (!is_regular_file(it->status(ec))) {
-                continue;
-            }
-            if (re_search(it->path().filename().string(), regex)) {
-                if (!callback(it->path().string())) {
-                    break;
-                }
+        // Match iteratively, backtracking only to the most recent '*'
+        char const* star = nullptr;
+        char const* resume = nullptr;
+        while (*name) {
+            if (*pattern == '*') {
+                star = pattern++;
+                resume = name;
+            } else if (*pattern == '?' || *pattern == *name) {
+                ++pattern;
+                ++name;
+            } else if (star) {
+                pattern = star + 1;
+                name = ++resume;
+            } else {
+                return false;
             }
         }
+        while (*pattern == '*') {
+            ++pattern;
+        }
+        return !*pattern;
     }
 
-    void directory::each_subdirectory(string const& directory, function<bool(string const&)> callback, string const& pattern)
+    directory::name_filter::name_filter(function<bool(string const&)> match) :
+        _match(move(match))
     {
-        boost::regex regex(pattern);
+    }
 
-        // Attempt to iterate the directory
-        boost::system::error_code ec;
-        directory_iterator it = directory_iterator(directory, ec);
-        if (ec) {
-            return;
-        }
+    directory::name_filter directory::name_filter::any()
+    {
+        return name_filter(nullptr);
+    }
 
-        // Call the callback for any matching subdirectories
-        directory_iterator end;
-        for (; it != end; ++it) {
-            boost::system::error_code ec;
-            if (!is_directory(it->status(ec))) {
-                continue;
-            }
-            if (re_search(it->path().filename().string(), regex)) {
-                if (!callback(it->path().string())) {
-                    break;
-                }
-            }
+    directory::name_filter directory::name_filter::prefix(string text)
+    {
+        return name_filter([text](string const& name) {
+            return name.compare(0, text.size(), text) == 0;
+        });
+    }
+
+    directory::name_filter directory::name_filter::suffix(string text)
+    {
+        return name_filter([text](string const& name) {
+            return name.size() >= text.size() && name.compare(name.size() - text.size(), text.size(), text) == 0;
+        });
+    }
+
+    directory::name_filter directory::name_filter::glob(string pattern)
+    {
+        return name_filter([pattern](string const& name) {
+            return glob_match(pattern.c_str(), name.c_str());
+        });
+    }
+
+    directory::name_filter directory::name_filter::regex(string const& pattern)
+    {
+        if (pattern.empty()) {
+            return any();
         }
+        pattern_matcher matcher(pattern);
+        return name_filter([matcher](string const& name) {
+            return matcher.search(name);
+        });
+    }
+
+    bool directory::name_filter::operator()(string const& name) const
+    {
+        return !_match || _match(name);
+    }
+
+    void directory::each_file(string const& directory, function<bool(string const&)> callback, string const& pattern)
+    {
+        each_file(directory, move(callback), name_filter::regex(pattern));
+    }
+
+    void directory::each_subdirectory(string const& directory, function<bool(string const&)> callback, string const& pattern)
+    {
+        each_subdirectory(directory, move(callback), name_filter::regex(pattern));
     }
 
 }}  // namespace facter::util
@@ -0,0 +1,22 @@
+#include <internal/util/directory_watcher.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // Directories are not watched on this platform; callers scan them for changes instead
+    directory_watcher::directory_watcher(vector<string> const&) :
+        _descriptor(-1)
+    {
+    }
+
+    directory_watcher::~directory_watcher()
+    {
+    }
+
+    bool directory_watcher::changes(set<string>&)
+    {
+        return false;
+    }
+
+}}  // namespace facter::util
@@ -1,12 +1,22 @@
 #include <facter/util/environment.hpp>
+#include <internal/util/environment_mutex.hpp>
 #include <boost/nowide/cenv.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread/locks.hpp>
 
 using namespace std;
 
 namespace facter { namespace util {
 
+    boost::shared_mutex& environment_mutex()
+    {
+        static boost::shared_mutex mutex;
+        return mutex;
+    }
+
     bool environment::get(string const& name, string& value)
     {
+        boost::shared_lock<boost::shared_mutex> lock(environment_mutex());
         auto variable = boost::nowide::getenv(name.c_str());
         if (!variable) {
             return false;
@@ -18,12 +28,30 @@ namespace facter { namespace util {
 
     bool environment::set(string const& name, string const& value)
     {
-        return boost::nowide::setenv(name.c_str(), value.c_str(), 1) == 0;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(environment_mutex());
+            if (boost::nowide::setenv(name.c_str(), value.c_str(), 1) != 0) {
+                return false;
+            }
+        }
+        if (boost::iequals(name, "PATH")) {
+            reload_search_paths();
+        }
+        return true;
     }
 
     bool environment::clear(string const& name)
     {
-        return boost::nowide::unsetenv(name.c_str()) == 0;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(environment_mutex());
+            if (boost::nowide::unsetenv(name.c_str()) != 0) {
+                return false;
+            }
+        }
+        if (boost::iequals(name, "PATH")) {
+            reload_search_paths();
+        }
+        return true;
     }
 
 }}  // namespace facter::util
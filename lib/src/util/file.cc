@@ -1,6 +1,4 @@
 #include <facter/util/file.hpp>
-#include <boost/nowide/fstream.hpp>
-#include <sstream>
 
 using namespace std;
 
@@ -8,18 +6,7 @@ namespace facter { namespace util {
 
     bool file::each_line(string const& path, function<bool(string&)> callback)
     {
-        boost::nowide::ifstream in(path.c_str());
-        if (!in) {
-            return false;
-        }
-
-        string line;
-        while (getline(in, line)) {
-            if (!callback(line)) {
-                break;
-            }
-        }
-        return true;
+        return each_line<function<bool(string&)>&>(path, callback);
     }
 
     string file::read(string const& path)
@@ -31,16 +18,4 @@ namespace facter { namespace util {
         return contents;
     }
 
-    bool file::read(string const& path, string& contents)
-    {
-        boost::nowide::ifstream in(path.c_str(), ios::in | ios::binary);
-        ostringstream buffer;
-        if (!in) {
-            return false;
-        }
-        buffer << in.rdbuf();
-        contents = buffer.str();
-        return true;
-    }
-
 }}  // namespace facter::util
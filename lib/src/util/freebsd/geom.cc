@@ -0,0 +1,80 @@
+#include <internal/util/freebsd/geom.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <libgeom.h>
+#include <cstring>
+
+using namespace std;
+
+namespace facter { namespace util { namespace freebsd {
+
+    geom_tree::geom_tree() :
+        _mesh(new gmesh())
+    {
+        int result = geom_gettree(_mesh);
+        if (result != 0) {
+            LOG_DEBUG("geom_gettree failed: %1% (%2%): GEOM data is unavailable.", strerror(result), result);
+            delete _mesh;
+            _mesh = nullptr;
+        }
+    }
+
+    geom_tree::~geom_tree()
+    {
+        if (_mesh) {
+            geom_deletetree(_mesh);
+            delete _mesh;
+        }
+    }
+
+    bool geom_tree::is_open() const
+    {
+        return _mesh != nullptr;
+    }
+
+    void geom_tree::each_geom(string const& class_name, function<bool(ggeom const&)> const& callback) const
+    {
+        if (!_mesh) {
+            return;
+        }
+        gclass* klass;
+        LIST_FOREACH(klass, &_mesh->lg_class, lg_class) {
+            if (class_name != klass->lg_name) {
+                continue;
+            }
+            ggeom* geom;
+            LIST_FOREACH(geom, &klass->lg_geom, lg_geom) {
+                if (!callback(*geom)) {
+                    return;
+                }
+            }
+            return;
+        }
+    }
+
+    void geom_tree::each_provider(string const& class_name, function<bool(gprovider const&)> const& callback) const
+    {
+        bool stopped = false;
+        each_geom(class_name, [&](ggeom const& geom) {
+            gprovider* provider;
+            LIST_FOREACH(provider, &geom.lg_provider, lg_provider) {
+                if (!callback(*provider)) {
+                    stopped = true;
+                    break;
+                }
+            }
+            return !stopped;
+        });
+    }
+
+    string geom_tree::config(gprovider const& provider, string const& name)
+    {
+        gconfig* entry;
+        LIST_FOREACH(entry, &provider.lg_config, lg_config) {
+            if (entry->lg_name && entry->lg_val && name == entry->lg_name) {
+                return entry->lg_val;
+            }
+        }
+        return {};
+    }
+
+}}}  // namespace facter::util::freebsd
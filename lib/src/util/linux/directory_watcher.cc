@@ -0,0 +1,103 @@
+#include <internal/util/directory_watcher.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    directory_watcher::directory_watcher(vector<string> const& directories) :
+        _descriptor(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    {
+        if (_descriptor < 0) {
+            LOG_DEBUG("directories cannot be watched: inotify_init1 failed: %1% (%2%).", strerror(errno), errno);
+            return;
+        }
+        for (auto const& directory : directories) {
+            int watch = inotify_add_watch(
+                _descriptor,
+                directory.c_str(),
+                IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+            if (watch < 0) {
+                // Without a watch on every directory, changes can't be known
+                LOG_DEBUG("directory \"%1%\" cannot be watched: inotify_add_watch failed: %2% (%3%).", directory, strerror(errno), errno);
+                close(_descriptor);
+                _descriptor = -1;
+                _watches.clear();
+                return;
+            }
+            _watches.emplace_back(watch, directory);
+        }
+    }
+
+    directory_watcher::~directory_watcher()
+    {
+        if (_descriptor >= 0) {
+            close(_descriptor);
+        }
+    }
+
+    bool directory_watcher::changes(set<string>& paths)
+    {
+        if (_descriptor < 0) {
+            return false;
+        }
+
+        bool known = true;
+        bool unwatched = false;
+        alignas(inotify_event) char buffer[16 * 1024];
+        while (true) {
+            auto count = read(_descriptor, buffer, sizeof(buffer));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG_DEBUG("directory changes cannot be read: %1% (%2%).", strerror(errno), errno);
+                    known = false;
+                }
+                break;
+            }
+            if (count == 0) {
+                break;
+            }
+            for (char* ptr = buffer; ptr < buffer + count;) {
+                auto event = reinterpret_cast<inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                // Lost events mean this call's changes aren't known
+                if (event->mask & IN_Q_OVERFLOW) {
+                    known = false;
+                    continue;
+                }
+                // Once a watched directory is removed or moved, no further changes to it are known
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                    unwatched = true;
+                    continue;
+                }
+                if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                    continue;
+                }
+                auto watch = find_if(_watches.begin(), _watches.end(), [&](pair<int, string> const& entry) {
+                    return entry.first == event->wd;
+                });
+                if (watch != _watches.end()) {
+                    paths.insert(watch->second + "/" + event->name);
+                }
+            }
+        }
+        if (unwatched) {
+            LOG_DEBUG("a watched directory was removed or moved; directories will be scanned for changes.");
+            close(_descriptor);
+            _descriptor = -1;
+            _watches.clear();
+            return false;
+        }
+        return known;
+    }
+
+}}  // namespace facter::util
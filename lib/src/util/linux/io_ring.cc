@@ -0,0 +1,285 @@
+#include <internal/util/linux/io_ring.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/thread/tss.hpp>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+namespace facter { namespace util { namespace linux {
+
+    // A sysfs attribute is at most a page
+    static const size_t file_size = 4096;
+
+    // The number of files opened, read, or closed by each io_uring_enter
+    static const unsigned ring_entries = 64;
+
+    static int io_uring_setup(unsigned entries, io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    static int io_uring_register(int fd, unsigned opcode, void* arg, unsigned count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    static bool is_supported(io_uring_probe const& probe, uint8_t opcode)
+    {
+        return opcode <= probe.last_op && (probe.ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    io_ring* io_ring::instance()
+    {
+        // Once a ring can't be created, don't try again on other threads
+        static atomic<bool> unavailable(false);
+        static boost::thread_specific_ptr<io_ring> rings;
+
+        if (unavailable) {
+            return nullptr;
+        }
+        auto ring = rings.get();
+        if (!ring) {
+            unique_ptr<io_ring> created(new io_ring());
+            if (!created->open()) {
+                unavailable = true;
+                return nullptr;
+            }
+            ring = created.release();
+            rings.reset(ring);
+        }
+        return ring;
+    }
+
+    io_ring::io_ring() :
+        _fd(-1),
+        _sq_ring(nullptr),
+        _sq_ring_size(0),
+        _cq_ring(nullptr),
+        _cq_ring_size(0),
+        _sqes(nullptr),
+        _sqes_size(0),
+        _sq_tail(nullptr),
+        _sq_array(nullptr),
+        _sq_mask(0),
+        _entries(0),
+        _cq_head(nullptr),
+        _cq_tail(nullptr),
+        _cq_mask(0),
+        _cqes(nullptr),
+        _pending(0),
+        _failed(false)
+    {
+    }
+
+    io_ring::~io_ring()
+    {
+        if (_sqes) {
+            munmap(_sqes, _sqes_size);
+        }
+        if (_cq_ring && _cq_ring != _sq_ring) {
+            munmap(_cq_ring, _cq_ring_size);
+        }
+        if (_sq_ring) {
+            munmap(_sq_ring, _sq_ring_size);
+        }
+        if (_fd >= 0) {
+            close(_fd);
+        }
+    }
+
+    bool io_ring::open()
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        _fd = io_uring_setup(ring_entries, &params);
+        if (_fd < 0) {
+            LOG_DEBUG("io_uring is unavailable: %1% (%2%): files will be read one at a time.", strerror(errno), errno);
+            return false;
+        }
+        fcntl(_fd, F_SETFD, FD_CLOEXEC);
+
+        // Opening, reading, and closing files require Linux 5.6, which is also the first to support probing
+        vector<char> probe_buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+        auto probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+        if (io_uring_register(_fd, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+            !is_supported(*probe, IORING_OP_OPENAT) ||
+            !is_supported(*probe, IORING_OP_READ) ||
+            !is_supported(*probe, IORING_OP_CLOSE)) {
+            LOG_DEBUG("io_uring does not support opening, reading, and closing files: files will be read one at a time.");
+            return false;
+        }
+
+        // Map the submission and completion rings; newer kernels map both with one call
+        _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            _sq_ring_size = _cq_ring_size = max(_sq_ring_size, _cq_ring_size);
+        }
+        auto sq_ring = mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) {
+            LOG_DEBUG("io_uring submission ring could not be mapped: %1% (%2%): files will be read one at a time.", strerror(errno), errno);
+            return false;
+        }
+        _sq_ring = sq_ring;
+        if (single_mmap) {
+            _cq_ring = _sq_ring;
+        } else {
+            auto cq_ring = mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+            if (cq_ring == MAP_FAILED) {
+                LOG_DEBUG("io_uring completion ring could not be mapped: %1% (%2%): files will be read one at a time.", strerror(errno), errno);
+                return false;
+            }
+            _cq_ring = cq_ring;
+        }
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        auto sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            LOG_DEBUG("io_uring submission entries could not be mapped: %1% (%2%): files will be read one at a time.", strerror(errno), errno);
+            return false;
+        }
+        _sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto sq = static_cast<char*>(_sq_ring);
+        _sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        _sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        _entries = params.sq_entries;
+
+        auto cq = static_cast<char*>(_cq_ring);
+        _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        _cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    io_uring_sqe* io_ring::next(uint8_t opcode, int fd, uint64_t user_data)
+    {
+        // Entries are only published to the kernel when the batch is run
+        unsigned index = (*_sq_tail + _pending) & _sq_mask;
+        auto sqe = &_sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->user_data = user_data;
+        _sq_array[index] = index;
+        ++_pending;
+        return sqe;
+    }
+
+    bool io_ring::run(vector<int>& results)
+    {
+        unsigned pending = _pending;
+        _pending = 0;
+        __atomic_store_n(_sq_tail, *_sq_tail + pending, __ATOMIC_RELEASE);
+
+        // Submit the batch and wait for every entry of it to complete
+        unsigned submitting = pending;
+        unsigned completed = 0;
+        while (completed < pending) {
+            int submitted = io_uring_enter(_fd, submitting, pending - completed, IORING_ENTER_GETEVENTS);
+            if (submitted < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_DEBUG("io_uring_enter failed: %1% (%2%): files will be read one at a time.", strerror(errno), errno);
+                _failed = true;
+                return false;
+            }
+            submitting -= min<unsigned>(submitting, static_cast<unsigned>(submitted));
+
+            unsigned head = *_cq_head;
+            unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                auto const& cqe = _cqes[head & _cq_mask];
+                results[static_cast<size_t>(cqe.user_data)] = cqe.res;
+                ++completed;
+            }
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+
+    bool io_ring::read_files(int directory, pair<char const*, string*> const* files, size_t count)
+    {
+        // A ring that failed may still hold entries from the failed batch, so it isn't used again
+        if (_failed) {
+            return false;
+        }
+        for (size_t start = 0; start < count; start += _entries) {
+            size_t batch = min<size_t>(count - start, _entries);
+            _descriptors.assign(batch, -1);
+            _results.assign(batch, -1);
+            _buffer.resize(batch * file_size);
+
+            // Open every file
+            for (size_t i = 0; i < batch; ++i) {
+                auto sqe = next(IORING_OP_OPENAT, directory, i);
+                sqe->addr = reinterpret_cast<uint64_t>(files[start + i].first);
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            }
+            if (!run(_descriptors)) {
+                return false;
+            }
+
+            // Read every file that was opened; a short read is the end of the file
+            for (size_t i = 0; i < batch; ++i) {
+                if (_descriptors[i] < 0) {
+                    continue;
+                }
+                auto sqe = next(IORING_OP_READ, _descriptors[i], i);
+                sqe->addr = reinterpret_cast<uint64_t>(&_buffer[i * file_size]);
+                sqe->len = static_cast<uint32_t>(file_size);
+            }
+            bool read = _pending == 0 || run(_results);
+
+            for (size_t i = 0; read && i < batch; ++i) {
+                auto& value = *files[start + i].second;
+                value.clear();
+                if (_descriptors[i] < 0 || _results[i] <= 0) {
+                    continue;
+                }
+                value.assign(&_buffer[i * file_size], static_cast<size_t>(_results[i]));
+
+                // Finish reading a file larger than a page directly
+                if (static_cast<size_t>(_results[i]) == file_size) {
+                    char more[file_size];
+                    ssize_t length;
+                    while ((length = pread(_descriptors[i], more, sizeof(more), static_cast<off_t>(value.size()))) > 0) {
+                        value.append(more, static_cast<size_t>(length));
+                    }
+                }
+            }
+
+            // Close every file that was opened
+            for (size_t i = 0; i < batch; ++i) {
+                if (_descriptors[i] >= 0) {
+                    next(IORING_OP_CLOSE, _descriptors[i], i);
+                }
+            }
+            if (_pending > 0 && !run(_results)) {
+                return false;
+            }
+            if (!read) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}}}  // namespace facter::util::linux
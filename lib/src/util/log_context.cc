@@ -0,0 +1,58 @@
+#include <internal/util/log_context.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // The scopes are owned by the logging thread's stack; never delete them
+    static boost::thread_specific_ptr<scoped_log_context> current_scope([](scoped_log_context*) {});
+
+    log_context::log_context() :
+        pid(0)
+    {
+    }
+
+    scoped_log_context::scoped_log_context(log_context context) :
+        _context(move(context)),
+        _previous(current_scope.get())
+    {
+        current_scope.reset(this);
+    }
+
+    scoped_log_context::~scoped_log_context()
+    {
+        current_scope.reset(_previous);
+    }
+
+    log_context const* scoped_log_context::get()
+    {
+        auto scope = current_scope.get();
+        return scope ? &scope->_context : nullptr;
+    }
+
+    log_context scoped_log_context::for_resolver(string resolver)
+    {
+        log_context context;
+        context.resolver = move(resolver);
+        context.start = chrono::steady_clock::now();
+        return context;
+    }
+
+    log_context scoped_log_context::for_child(long pid)
+    {
+        auto current = get();
+        log_context context = current ? *current : log_context();
+        context.pid = pid;
+        return context;
+    }
+
+    log_context scoped_log_context::for_url(string url)
+    {
+        auto current = get();
+        log_context context = current ? *current : log_context();
+        context.url = move(url);
+        return context;
+    }
+
+}}  // namespace facter::util
@@ -0,0 +1,62 @@
+#include <internal/util/mapped_file.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <internal/util/statistics.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+namespace facter { namespace util {
+
+    mapped_file::mapped_file(string const& path) :
+        _open(false)
+    {
+        auto rooted = scoped_root::path(path);
+
+        // Empty files cannot be mapped, but are still opened with no contents
+        boost::system::error_code ec;
+        auto size = fs::file_size(rooted, ec);
+        if (ec) {
+            return;
+        }
+        if (size == 0) {
+            _open = true;
+            return;
+        }
+
+        try {
+            boost::iostreams::mapped_file_params params(rooted);
+            params.flags = boost::iostreams::mapped_file::priv;
+            _file.open(params);
+        } catch (ios_base::failure& ex) {
+            LOG_DEBUG("file \"%1%\" could not be mapped: %2%.", rooted, ex.what());
+            return;
+        }
+        _open = _file.is_open();
+        if (_open) {
+            scoped_statistics::record_bytes_read(_file.size());
+        }
+    }
+
+    bool mapped_file::is_open() const
+    {
+        return _open;
+    }
+
+    char* mapped_file::begin()
+    {
+        return _file.is_open() ? _file.data() : nullptr;
+    }
+
+    char* mapped_file::end()
+    {
+        return _file.is_open() ? _file.data() + _file.size() : nullptr;
+    }
+
+    size_t mapped_file::size() const
+    {
+        return _file.is_open() ? _file.size() : 0;
+    }
+
+}}  // namespace facter::util
@@ -0,0 +1,158 @@
+#include <facter/util/metrics.hpp>
+#include <facter/util/file.hpp>
+#include <internal/util/metrics.hpp>
+#include <internal/util/statistics.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <sstream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif  // __linux__
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // The upper bounds of the resolution time buckets, in seconds; a resolver usually takes milliseconds, a slow command or request seconds
+    static const array<double, 11> resolution_buckets = {{ 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 1, 5, 30 }};
+
+    // The resolution times of a resolver; each bucket counts the resolutions no longer than its bound
+    struct resolution_histogram
+    {
+        resolution_histogram() :
+            buckets(),
+            sum(0),
+            count(0)
+        {
+        }
+
+        array<uint64_t, resolution_buckets.size()> buckets;
+        double sum;
+        uint64_t count;
+    };
+
+    static boost::mutex metrics_mutex;
+    static map<string, resolution_histogram> resolutions;
+    static map<pair<string, bool>, uint64_t> cache_lookups;
+    static atomic<uint64_t> processes(0);
+    static atomic<uint64_t> http_requests(0);
+
+    // Escapes a label value: backslashes, quotes, and newlines are escaped
+    static string escape(string const& value)
+    {
+        string escaped;
+        escaped.reserve(value.size());
+        for (auto c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    // Gets the resident memory of the process in bytes, or zero if it isn't known
+    static uint64_t resident_memory()
+    {
+#ifdef __linux__
+        // The second field of statm is the number of resident pages
+        string contents;
+        if (!file::read("/proc/self/statm", contents)) {
+            return 0;
+        }
+        istringstream fields(contents);
+        uint64_t size = 0;
+        uint64_t resident = 0;
+        if (!(fields >> size >> resident)) {
+            return 0;
+        }
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif  // __linux__
+    }
+
+    void metrics::record_resolution(string const& name, statistics const& stats)
+    {
+        auto seconds = chrono::duration<double>(stats.wall_time).count();
+        boost::lock_guard<boost::mutex> lock(metrics_mutex);
+        auto& histogram = resolutions[name];
+        for (size_t i = 0; i < resolution_buckets.size(); ++i) {
+            if (seconds <= resolution_buckets[i]) {
+                ++histogram.buckets[i];
+            }
+        }
+        histogram.sum += seconds;
+        ++histogram.count;
+    }
+
+    void metrics::record_cache_lookup(char const* cache, bool hit)
+    {
+        boost::lock_guard<boost::mutex> lock(metrics_mutex);
+        ++cache_lookups[make_pair(string(cache), hit)];
+    }
+
+    void metrics::record_process()
+    {
+        ++processes;
+    }
+
+    void metrics::record_http_request()
+    {
+        ++http_requests;
+    }
+
+    void write_metrics(ostream& stream)
+    {
+        // Format the metrics before writing them so that the lock isn't held while writing to a slow stream
+        ostringstream output;
+        output.imbue(locale::classic());
+        output.precision(numeric_limits<double>::digits10);
+        {
+            boost::lock_guard<boost::mutex> lock(metrics_mutex);
+            output << "# HELP facter_resolver_duration_seconds The time spent resolving each resolver.\n";
+            output << "# TYPE facter_resolver_duration_seconds histogram\n";
+            for (auto const& kvp : resolutions) {
+                auto resolver = escape(kvp.first);
+                auto const& histogram = kvp.second;
+                for (size_t i = 0; i < resolution_buckets.size(); ++i) {
+                    output << "facter_resolver_duration_seconds_bucket{resolver=\"" << resolver << "\",le=\"" << resolution_buckets[i] << "\"} " << histogram.buckets[i] << '\n';
+                }
+                output << "facter_resolver_duration_seconds_bucket{resolver=\"" << resolver << "\",le=\"+Inf\"} " << histogram.count << '\n';
+                output << "facter_resolver_duration_seconds_sum{resolver=\"" << resolver << "\"} " << histogram.sum << '\n';
+                output << "facter_resolver_duration_seconds_count{resolver=\"" << resolver << "\"} " << histogram.count << '\n';
+            }
+
+            output << "# HELP facter_cache_lookups_total The lookups in the fact and command caches.\n";
+            output << "# TYPE facter_cache_lookups_total counter\n";
+            for (auto const& kvp : cache_lookups) {
+                output << "facter_cache_lookups_total{cache=\"" << escape(kvp.first.first) << "\",result=\"" << (kvp.first.second ? "hit" : "miss") << "\"} " << kvp.second << '\n';
+            }
+        }
+
+        output << "# HELP facter_processes_total The child processes spawned.\n";
+        output << "# TYPE facter_processes_total counter\n";
+        output << "facter_processes_total " << processes << '\n';
+        output << "# HELP facter_http_requests_total The HTTP requests made.\n";
+        output << "# TYPE facter_http_requests_total counter\n";
+        output << "facter_http_requests_total " << http_requests << '\n';
+
+        auto memory = resident_memory();
+        if (memory > 0) {
+            output << "# HELP facter_resident_memory_bytes The resident memory of the process.\n";
+            output << "# TYPE facter_resident_memory_bytes gauge\n";
+            output << "facter_resident_memory_bytes " << memory << '\n';
+        }
+        stream << output.str();
+    }
+
+}}  // namespace facter::util
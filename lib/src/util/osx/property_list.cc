@@ -0,0 +1,44 @@
+#include <internal/util/osx/property_list.hpp>
+#include <internal/util/osx/scoped_cftype.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <vector>
+
+using namespace std;
+
+namespace facter { namespace util { namespace osx {
+
+    map<string, string> read_property_list(string const& path)
+    {
+        map<string, string> values;
+
+        scoped_cftype url(CFURLCreateFromFileSystemRepresentation(kCFAllocatorDefault, reinterpret_cast<UInt8 const*>(path.c_str()), path.size(), false));
+        auto url_ref = url.as<CFURLRef>(CFURLGetTypeID());
+        scoped_cftype stream(url_ref ? CFReadStreamCreateWithFile(kCFAllocatorDefault, url_ref) : nullptr);
+        auto stream_ref = stream.as<CFReadStreamRef>(CFReadStreamGetTypeID());
+        if (!stream_ref || !CFReadStreamOpen(stream_ref)) {
+            LOG_DEBUG("property list \"%1%\" could not be opened.", path);
+            return values;
+        }
+        scoped_cftype list(CFPropertyListCreateWithStream(kCFAllocatorDefault, stream_ref, 0, kCFPropertyListImmutable, nullptr, nullptr));
+        CFReadStreamClose(stream_ref);
+
+        auto dictionary = list.as<CFDictionaryRef>(CFDictionaryGetTypeID());
+        if (!dictionary) {
+            LOG_DEBUG("property list \"%1%\" does not contain a dictionary.", path);
+            return values;
+        }
+
+        CFIndex count = CFDictionaryGetCount(dictionary);
+        vector<void const*> keys(count);
+        vector<void const*> entries(count);
+        CFDictionaryGetKeysAndValues(dictionary, keys.data(), entries.data());
+        for (CFIndex i = 0; i < count; ++i) {
+            if (CFGetTypeID(keys[i]) != CFStringGetTypeID() || CFGetTypeID(entries[i]) != CFStringGetTypeID()) {
+                continue;
+            }
+            values.emplace(to_utf8(static_cast<CFStringRef>(keys[i])), to_utf8(static_cast<CFStringRef>(entries[i])));
+        }
+        return values;
+    }
+
+}}}  // namespace facter::util::osx
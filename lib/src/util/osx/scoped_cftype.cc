@@ -0,0 +1,33 @@
+#include <internal/util/osx/scoped_cftype.hpp>
+#include <vector>
+
+using namespace std;
+
+namespace facter { namespace util { namespace osx {
+
+    scoped_cftype::scoped_cftype(CFTypeRef ref) :
+        scoped_resource(move(ref), release)
+    {
+    }
+
+    void scoped_cftype::release(CFTypeRef ref)
+    {
+        if (ref) {
+            CFRelease(ref);
+        }
+    }
+
+    string to_utf8(CFStringRef str)
+    {
+        if (!str) {
+            return {};
+        }
+        CFIndex size = CFStringGetMaximumSizeForEncoding(CFStringGetLength(str), kCFStringEncodingUTF8) + 1;
+        vector<char> buffer(size);
+        if (!CFStringGetCString(str, buffer.data(), size, kCFStringEncodingUTF8)) {
+            return {};
+        }
+        return buffer.data();
+    }
+
+}}}  // namespace facter::util::osx
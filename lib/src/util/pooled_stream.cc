@@ -0,0 +1,95 @@
+#include <internal/util/pooled_stream.hpp>
+#include <boost/thread/tss.hpp>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // Buffers that grew beyond this are not kept in the pool so that one large value doesn't pin its memory
+    static size_t const max_pooled_capacity = 1024 * 1024;
+
+    // The number of buffers kept by each thread; enough for the nesting used when logging
+    static size_t const max_pooled_buffers = 4;
+
+    struct pooled_stream::buffer : streambuf
+    {
+        buffer() :
+            stream(this)
+        {
+        }
+
+        string output;
+        ostream stream;
+
+     protected:
+        virtual int_type overflow(int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                output += traits_type::to_char_type(c);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        virtual streamsize xsputn(char const* s, streamsize count) override
+        {
+            output.append(s, static_cast<size_t>(count));
+            return count;
+        }
+    };
+
+    static boost::thread_specific_ptr<vector<unique_ptr<pooled_stream::buffer>>> pool;
+
+    pooled_stream::pooled_stream()
+    {
+        auto buffers = pool.get();
+        if (buffers && !buffers->empty()) {
+            _buffer = buffers->back().release();
+            buffers->pop_back();
+            return;
+        }
+        _buffer = new buffer();
+    }
+
+    pooled_stream::~pooled_stream()
+    {
+        unique_ptr<buffer> released(_buffer);
+        if (released->output.capacity() > max_pooled_capacity) {
+            return;
+        }
+
+        auto buffers = pool.get();
+        if (!buffers) {
+            buffers = new vector<unique_ptr<buffer>>();
+            pool.reset(buffers);
+        }
+        if (buffers->size() >= max_pooled_buffers) {
+            return;
+        }
+
+        // Reset any state left by the previous use, but keep the capacity
+        released->output.clear();
+        released->stream.clear();
+        released->stream.copyfmt(ios(nullptr));
+        buffers->emplace_back(move(released));
+    }
+
+    ostream& pooled_stream::stream()
+    {
+        return _buffer->stream;
+    }
+
+    string const& pooled_stream::str() const
+    {
+        return _buffer->output;
+    }
+
+    void pooled_stream::flush_to(ostream& os)
+    {
+        os.write(_buffer->output.data(), _buffer->output.size());
+        _buffer->output.clear();
+    }
+
+}}  // namespace facter::util
@@ -0,0 +1,101 @@
+#include <internal/util/posix/attribute_reader.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <internal/util/statistics.hpp>
+#include <boost/algorithm/string.hpp>
+#include <fcntl.h>
+
+#ifdef USE_IO_URING
+#include <internal/util/linux/io_ring.hpp>
+#endif
+
+using namespace std;
+
+namespace facter { namespace util { namespace posix {
+
+    attribute_reader::attribute_reader(string const& directory) :
+        attribute_reader(open(scoped_root::path(directory).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+    {
+    }
+
+    attribute_reader::attribute_reader(attribute_reader const& parent, string const& subdirectory) :
+        attribute_reader(parent.is_open() ? openat(parent._directory, subdirectory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1)
+    {
+    }
+
+    attribute_reader::attribute_reader(int directory) :
+        _directory(directory)
+    {
+    }
+
+    bool attribute_reader::is_open() const
+    {
+        return static_cast<int>(_directory) >= 0;
+    }
+
+    bool attribute_reader::read(char const* name, string& value) const
+    {
+        if (!is_open()) {
+            value.clear();
+            return false;
+        }
+        return read_at(_directory, name, value);
+    }
+
+    size_t attribute_reader::read(initializer_list<pair<char const*, string*>> attributes) const
+    {
+        size_t count = 0;
+#ifdef USE_IO_URING
+        // Open, read, and close every attribute together rather than with three system calls each
+        auto ring = is_open() && attributes.size() > 1 ? linux::io_ring::instance() : nullptr;
+        if (ring && ring->read_files(_directory, attributes.begin(), attributes.size())) {
+            for (auto const& attribute : attributes) {
+                scoped_statistics::record_bytes_read(attribute.second->size());
+                boost::trim(*attribute.second);
+                if (!attribute.second->empty()) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+#endif
+        for (auto const& attribute : attributes) {
+            if (read(attribute.first, *attribute.second)) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    bool attribute_reader::read_file(string const& path, string& value)
+    {
+        // An absolute path is opened as is, ignoring the directory
+        return read_at(AT_FDCWD, scoped_root::path(path).c_str(), value);
+    }
+
+    bool attribute_reader::read_at(int directory, char const* name, string& value)
+    {
+        value.clear();
+        scoped_descriptor descriptor(openat(directory, name, O_RDONLY | O_CLOEXEC));
+        if (static_cast<int>(descriptor) < 0) {
+            return false;
+        }
+
+        // A sysfs attribute is at most a page and is returned whole by the first read; a short read is the end of the file
+        char buffer[4096];
+        ssize_t count;
+        while ((count = ::read(descriptor, buffer, sizeof(buffer))) > 0) {
+            value.append(buffer, static_cast<size_t>(count));
+            if (static_cast<size_t>(count) < sizeof(buffer)) {
+                break;
+            }
+        }
+        if (count < 0) {
+            value.clear();
+            return false;
+        }
+        scoped_statistics::record_bytes_read(value.size());
+        boost::trim(value);
+        return !value.empty();
+    }
+
+}}}  // namespace facter::util::posix
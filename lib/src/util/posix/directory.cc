@@ -0,0 +1,75 @@
+#include <facter/util/directory.hpp>
+#include <facter/util/scoped_resource.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <cstring>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    static bool is_type(DIR* dir, dirent const* entry, mode_t type)
+    {
+#ifdef DT_DIR
+        // The entry type avoids a stat for each entry; symbolic links (e.g. those in /sys/block) are followed below
+        if (entry->d_type == DT_DIR) {
+            return type == S_IFDIR;
+        }
+        if (entry->d_type == DT_REG) {
+            return type == S_IFREG;
+        }
+        if (entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) {
+            return false;
+        }
+#endif
+        struct stat info;
+        if (fstatat(dirfd(dir), entry->d_name, &info, 0) != 0) {
+            return false;
+        }
+        return (info.st_mode & S_IFMT) == type;
+    }
+
+    static void each_entry(string const& directory, mode_t type, function<bool(string const&)> const& callback, directory::name_filter const& filter)
+    {
+        // Attempt to open the directory
+        string root = scoped_root::path(directory);
+        scoped_resource<DIR*> dir(opendir(root.c_str()), [](DIR* d) { if (d) closedir(d); });
+        if (!static_cast<DIR*>(dir)) {
+            return;
+        }
+        if (!root.empty() && root.back() != '/') {
+            root += '/';
+        }
+
+        // Call the callback for any matching entries of the given type; names are filtered first as that doesn't stat
+        string name;
+        string path;
+        while (dirent* entry = readdir(dir)) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            name.assign(entry->d_name);
+            if (!filter(name) || !is_type(dir, entry, type)) {
+                continue;
+            }
+            path.assign(root).append(name);
+            if (!callback(path)) {
+                break;
+            }
+        }
+    }
+
+    void directory::each_file(string const& directory, function<bool(string const&)> callback, name_filter const& filter)
+    {
+        each_entry(directory, S_IFREG, callback, filter);
+    }
+
+    void directory::each_subdirectory(string const& directory, function<bool(string const&)> callback, name_filter const& filter)
+    {
+        each_entry(directory, S_IFDIR, callback, filter);
+    }
+
+}}  // namespace facter::util
@@ -1,6 +1,8 @@
 #include <internal/util/dynamic_library.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
 #include <dlfcn.h>
 
 using namespace std;
@@ -36,17 +38,24 @@ namespace facter { namespace util {
         return library;
     }
 
+    // Serializes loads so that only one of the threads loading the same library sees the first load
+    static boost::mutex load_mutex;
+
     bool dynamic_library::load(string const& name)
     {
         close();
 
+        boost::lock_guard<boost::mutex> lock(load_mutex);
+
         // Don't actually perform a load to determine if it is already loaded
         _handle = dlopen(name.c_str(), RTLD_LAZY | RTLD_NOLOAD);
         if (!_handle) {
             // Load now
             _handle = dlopen(name.c_str(), RTLD_LAZY);
             if (!_handle) {
-                LOG_DEBUG("library %1% not found %2% (%3%).", name.c_str(), strerror(errno), errno);
+                // dlerror is per-thread
+                char const* error = dlerror();
+                LOG_DEBUG("library %1% not found: %2%.", name.c_str(), error ? error : "unknown error");
                 return false;
             }
             _first_load = true;
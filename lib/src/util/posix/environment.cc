@@ -1,6 +1,13 @@
 #include <facter/util/environment.hpp>
+#include <internal/util/environment_mutex.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <atomic>
 #include <functional>
+#include <list>
+#include <cstring>
+#include <strings.h>
 #include <unistd.h>
 
 using namespace std;
@@ -10,58 +17,78 @@ extern char** environ;
 
 namespace facter { namespace util {
 
-    struct search_path_helper
+    static vector<string> load_search_paths()
     {
-        search_path_helper()
-        {
-            string paths;
-            if (environment::get("PATH", paths)) {
-                auto is_sep = bind(equal_to<char>(), placeholders::_1, environment::get_path_separator());
-                boost::trim_if(paths, is_sep);
-                boost::split(_paths, paths, is_sep, boost::token_compress_on);
-            }
-            // Ruby Facter expects /sbin and /usr/sbin to be searched for programs
-            _paths.push_back("/sbin");
-            _paths.push_back("/usr/sbin");
-        }
-
-        vector<string> const& search_paths() const
-        {
-            return _paths;
+        vector<string> paths;
+        string value;
+        if (environment::get("PATH", value)) {
+            auto is_sep = bind(equal_to<char>(), placeholders::_1, environment::get_path_separator());
+            boost::trim_if(value, is_sep);
+            boost::split(paths, value, is_sep, boost::token_compress_on);
         }
+        // Ruby Facter expects /sbin and /usr/sbin to be searched for programs
+        paths.push_back("/sbin");
+        paths.push_back("/usr/sbin");
+        return paths;
+    }
 
-     private:
-         vector<string> _paths;
-    };
+    // Every version of the search paths is kept so that references returned by search_paths stay valid when PATH changes
+    static boost::mutex search_paths_mutex;
+    static list<vector<string>> search_path_versions;
+    static atomic<vector<string> const*> current_search_paths(nullptr);
 
     char environment::get_path_separator()
     {
         return ':';
     }
 
-    static search_path_helper helper;
-
     vector<string> const& environment::search_paths()
     {
-        return helper.search_paths();
+        auto paths = current_search_paths.load(memory_order_acquire);
+        if (!paths) {
+            reload_search_paths();
+            paths = current_search_paths.load(memory_order_acquire);
+        }
+        return *paths;
     }
 
     void environment::reload_search_paths()
     {
-        helper = search_path_helper();
+        // Keep the current paths if they are unchanged
+        auto paths = load_search_paths();
+        boost::lock_guard<boost::mutex> lock(search_paths_mutex);
+        auto current = current_search_paths.load(memory_order_acquire);
+        if (current && *current == paths) {
+            return;
+        }
+        search_path_versions.emplace_back(move(paths));
+        current_search_paths.store(&search_path_versions.back(), memory_order_release);
     }
 
-    void environment::each(function<bool(string&, string&)> callback)
+    static vector<string> copy_environment(string const* prefix)
     {
-        // Enumerate all environment variables
+        // Copy the variables under the lock so that callbacks may change the environment
+        vector<string> variables;
+        boost::shared_lock<boost::shared_mutex> lock(environment_mutex());
         for (char const* const* variable = environ; *variable; ++variable) {
-            string pair = *variable;
-            string name;
-            string value;
+            // Compare the prefix in place so that only the matching variables are copied
+            if (prefix && strncasecmp(*variable, prefix->c_str(), prefix->size()) != 0) {
+                continue;
+            }
+            variables.emplace_back(*variable);
+        }
+        return variables;
+    }
 
+    static void each_variable(vector<string>& variables, function<bool(string&, string&)> const& callback)
+    {
+        string name;
+        string value;
+        for (auto& pair : variables) {
             auto pos = pair.find('=');
             if (pos == string::npos) {
                 name = move(pair);
+                value.clear();
             } else {
                 name = pair.substr(0, pos);
                 value = pair.substr(pos + 1);
@@ -72,4 +99,16 @@ namespace facter { namespace util {
         }
     }
 
+    void environment::each(function<bool(string&, string&)> callback)
+    {
+        auto variables = copy_environment(nullptr);
+        each_variable(variables, callback);
+    }
+
+    void environment::each(string const& prefix, function<bool(string&, string&)> callback)
+    {
+        auto variables = copy_environment(&prefix);
+        each_variable(variables, callback);
+    }
+
 }}  // namespace facter::util
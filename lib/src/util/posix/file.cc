@@ -0,0 +1,55 @@
+#include <facter/util/file.hpp>
+#include <internal/util/posix/scoped_descriptor.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <internal/util/statistics.hpp>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cerrno>
+
+using namespace std;
+using namespace facter::util::posix;
+
+namespace facter { namespace util {
+
+    bool file::read(string const& path, string& contents)
+    {
+        contents.clear();
+        scoped_descriptor descriptor(open(scoped_root::path(path).c_str(), O_RDONLY | O_CLOEXEC));
+        if (static_cast<int>(descriptor) < 0) {
+            return false;
+        }
+
+        // Size the buffer from the file, but read until the end: procfs and sysfs files report a size of zero
+        // Reading into the string's existing capacity reuses the caller's buffer across reads
+        size_t size = 4096;
+        struct stat info;
+        if (fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            // One byte more than the file so the end of the file is found without growing the buffer
+            size = static_cast<size_t>(info.st_size) + 1;
+        }
+        contents.resize(max(contents.capacity(), size));
+
+        size_t length = 0;
+        while (true) {
+            if (length == contents.size()) {
+                contents.resize(contents.size() * 2);
+            }
+            ssize_t count = ::read(descriptor, &contents[length], contents.size() - length);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                contents.clear();
+                return false;
+            }
+            if (count == 0) {
+                break;
+            }
+            length += static_cast<size_t>(count);
+        }
+        contents.resize(length);
+        scoped_statistics::record_bytes_read(length);
+        return true;
+    }
+
+}}  // namespace facter::util
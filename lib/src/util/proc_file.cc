@@ -0,0 +1,93 @@
+#include <internal/util/proc_file.hpp>
+#include <facter/util/file.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    static bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    proc_file::proc_file(string const& path) :
+        _open(file::read(path, _contents))
+    {
+    }
+
+    bool proc_file::is_open() const
+    {
+        return _open;
+    }
+
+    void proc_file::each_line(function<bool(boost::string_ref line)> const& callback) const
+    {
+        size_t start = 0;
+        while (start < _contents.size()) {
+            auto end = _contents.find('\n', start);
+            if (end == string::npos) {
+                end = _contents.size();
+            }
+            boost::string_ref line(_contents.data() + start, end - start);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!callback(line)) {
+                return;
+            }
+            start = end + 1;
+        }
+    }
+
+    void proc_file::each_value(function<bool(boost::string_ref key, boost::string_ref value)> const& callback, char separator) const
+    {
+        each_line([&](boost::string_ref line) {
+            auto pos = line.find(separator);
+            if (pos == boost::string_ref::npos) {
+                return true;
+            }
+            return callback(trim(line.substr(0, pos)), trim(line.substr(pos + 1)));
+        });
+    }
+
+    boost::string_ref proc_file::next_field(boost::string_ref& text)
+    {
+        while (!text.empty() && is_space(text.front())) {
+            text.remove_prefix(1);
+        }
+        size_t length = 0;
+        while (length < text.size() && !is_space(text[length])) {
+            ++length;
+        }
+        auto field = text.substr(0, length);
+        text.remove_prefix(length);
+        return field;
+    }
+
+    boost::string_ref proc_file::trim(boost::string_ref text)
+    {
+        while (!text.empty() && is_space(text.front())) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && is_space(text.back())) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    bool proc_file::to_uint64(boost::string_ref text, uint64_t& value)
+    {
+        if (text.empty() || text.front() < '0' || text.front() > '9') {
+            return false;
+        }
+        value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') {
+                break;
+            }
+            value = value * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return true;
+    }
+
+}}  // namespace facter::util
@@ -0,0 +1,48 @@
+#include <internal/util/regex.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <map>
+#include <memory>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    boost::regex const& cached_regex(string const& pattern, boost::regex::flag_type flags)
+    {
+        // The expressions are never removed, so references to them stay valid for the rest of the process
+        static boost::mutex mutex;
+        static map<pair<string, boost::regex::flag_type>, unique_ptr<boost::regex const>> expressions;
+
+        boost::lock_guard<boost::mutex> lock(mutex);
+        auto& expression = expressions[make_pair(pattern, flags)];
+        if (!expression) {
+            expression.reset(new boost::regex(pattern, flags));
+        }
+        return *expression;
+    }
+
+    bool is_literal_pattern(string const& pattern)
+    {
+        return pattern.find_first_of("\\^$.|?*+()[]{}") == string::npos;
+    }
+
+    pattern_matcher::pattern_matcher(string pattern) :
+        _regex(nullptr)
+    {
+        if (is_literal_pattern(pattern)) {
+            _literal = move(pattern);
+        } else {
+            _regex = &cached_regex(pattern);
+        }
+    }
+
+    bool pattern_matcher::search(string const& text) const
+    {
+        if (_regex) {
+            return re_search(text, *_regex);
+        }
+        return text.find(_literal) != string::npos;
+    }
+
+}}  // namespace facter::util
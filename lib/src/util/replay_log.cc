@@ -0,0 +1,226 @@
+#include <internal/util/replay_log.hpp>
+#include <facter/util/file.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <atomic>
+
+using namespace std;
+using namespace rapidjson;
+namespace fs = boost::filesystem;
+namespace sys = boost::system;
+
+namespace facter { namespace util {
+
+    // The version of the fixture file format; files of other versions are not loaded
+    static const int replay_version = 1;
+
+    // The log installed for the process
+    static atomic<replay_log*> current_log(nullptr);
+
+    static void add_string(rapidjson::Value& object, string const& name, string const& str, Document::AllocatorType& allocator)
+    {
+        rapidjson::Value key(name.c_str(), static_cast<SizeType>(name.size()), allocator);
+        rapidjson::Value value(str.c_str(), static_cast<SizeType>(str.size()), allocator);
+        object.AddMember(key, value, allocator);
+    }
+
+    static string get_string(rapidjson::Value const& object, char const* name)
+    {
+        if (!object.HasMember(name) || !object[name].IsString()) {
+            return {};
+        }
+        auto const& value = object[name];
+        return string(value.GetString(), value.GetStringLength());
+    }
+
+    static int64_t get_integer(rapidjson::Value const& object, char const* name)
+    {
+        if (!object.HasMember(name) || !object[name].IsInt64()) {
+            return 0;
+        }
+        return object[name].GetInt64();
+    }
+
+    replay_entry::replay_entry() :
+        status(0),
+        signaled(false),
+        elapsed(0)
+    {
+    }
+
+    replay_log::replay_log(replay_mode mode) :
+        _mode(mode),
+        _scale(1),
+        _extra(0)
+    {
+    }
+
+    replay_mode replay_log::mode() const
+    {
+        return _mode;
+    }
+
+    void replay_log::latency(double scale, chrono::milliseconds extra)
+    {
+        _scale = scale < 0 ? 0 : scale;
+        _extra = extra;
+    }
+
+    chrono::milliseconds replay_log::latency(replay_entry const& entry) const
+    {
+        return chrono::milliseconds(static_cast<int64_t>(entry.elapsed.count() * _scale)) + _extra;
+    }
+
+    void replay_log::add(string key, replay_entry entry)
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        _entries[move(key)] = move(entry);
+    }
+
+    replay_entry const* replay_log::find(string const& key) const
+    {
+        // Entries are only added when recording, so the entry found can be used without the lock
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        return it == _entries.end() ? nullptr : &it->second;
+    }
+
+    size_t replay_log::size() const
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        return _entries.size();
+    }
+
+    bool replay_log::load(string const& path)
+    {
+        string contents;
+        if (!file::read(path, contents)) {
+            LOG_WARNING("replay log %1% could not be read.", path);
+            return false;
+        }
+
+        Document document;
+        document.Parse<0>(contents.c_str());
+        if (document.HasParseError()) {
+            LOG_WARNING("replay log %1% could not be parsed: %2%.", path, document.GetParseError());
+            return false;
+        }
+        if (!document.IsObject() || get_integer(document, "version") != replay_version ||
+            !document.HasMember("entries") || !document["entries"].IsObject()) {
+            LOG_WARNING("replay log %1% is invalid.", path);
+            return false;
+        }
+
+        auto const& entries = document["entries"];
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        for (auto it = entries.MemberBegin(); it != entries.MemberEnd(); ++it) {
+            auto const& value = it->value;
+            if (!value.IsObject()) {
+                continue;
+            }
+            replay_entry entry;
+            entry.status = static_cast<int>(get_integer(value, "status"));
+            entry.signaled = value.HasMember("signaled") && value["signaled"].IsBool() && value["signaled"].GetBool();
+            entry.output = get_string(value, "output");
+            entry.error = get_string(value, "error");
+            entry.elapsed = chrono::milliseconds(get_integer(value, "elapsed_ms"));
+            if (value.HasMember("headers") && value["headers"].IsObject()) {
+                auto const& headers = value["headers"];
+                for (auto header = headers.MemberBegin(); header != headers.MemberEnd(); ++header) {
+                    if (header->value.IsString()) {
+                        entry.headers.emplace_back(
+                            string(header->name.GetString(), header->name.GetStringLength()),
+                            string(header->value.GetString(), header->value.GetStringLength()));
+                    }
+                }
+            }
+            _entries[string(it->name.GetString(), it->name.GetStringLength())] = move(entry);
+        }
+        LOG_DEBUG("loaded %1% entries from replay log %2%.", entries.MemberEnd() - entries.MemberBegin(), path);
+        return true;
+    }
+
+    bool replay_log::save(string const& path) const
+    {
+        Document document;
+        auto& allocator = document.GetAllocator();
+        document.SetObject();
+        document.AddMember("version", replay_version, allocator);
+
+        rapidjson::Value entries;
+        entries.SetObject();
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            for (auto const& kvp : _entries) {
+                auto const& entry = kvp.second;
+                rapidjson::Value value;
+                value.SetObject();
+                value.AddMember("status", entry.status, allocator);
+                if (entry.signaled) {
+                    value.AddMember("signaled", true, allocator);
+                }
+                add_string(value, "output", entry.output, allocator);
+                if (!entry.headers.empty()) {
+                    rapidjson::Value headers;
+                    headers.SetObject();
+                    for (auto const& header : entry.headers) {
+                        add_string(headers, header.first, header.second, allocator);
+                    }
+                    value.AddMember("headers", headers, allocator);
+                }
+                if (!entry.error.empty()) {
+                    add_string(value, "error", entry.error, allocator);
+                }
+                value.AddMember("elapsed_ms", static_cast<int64_t>(entry.elapsed.count()), allocator);
+                rapidjson::Value key(kvp.first.c_str(), static_cast<SizeType>(kvp.first.size()), allocator);
+                entries.AddMember(key, value, allocator);
+            }
+        }
+        document.AddMember("entries", entries, allocator);
+
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        document.Accept(writer);
+
+        // Write to a temporary file and rename it so that a failed run doesn't leave a partial fixture
+        string temp_path = path + ".tmp";
+        {
+            boost::nowide::ofstream out(temp_path.c_str(), ios::out | ios::binary | ios::trunc);
+            out << buffer.GetString();
+            if (!out) {
+                LOG_WARNING("replay log %1% could not be written.", temp_path);
+                return false;
+            }
+        }
+
+        sys::error_code ec;
+        fs::rename(temp_path, path, ec);
+        if (ec) {
+            LOG_WARNING("replay log %1% could not be written: %2%.", path, ec.message());
+            fs::remove(temp_path, ec);
+            return false;
+        }
+        return true;
+    }
+
+    replay_log* replay_log::current()
+    {
+        return current_log;
+    }
+
+    scoped_replay_log::scoped_replay_log(replay_log* log) :
+        _previous(current_log.exchange(log))
+    {
+    }
+
+    scoped_replay_log::~scoped_replay_log()
+    {
+        current_log = _previous;
+    }
+
+}}  // namespace facter::util
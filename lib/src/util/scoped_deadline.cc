@@ -0,0 +1,72 @@
+#include <internal/util/scoped_deadline.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // The scopes are owned by the limited thread's stack; never delete them
+    static boost::thread_specific_ptr<scoped_deadline> current_scope([](scoped_deadline*) {});
+
+    deadline_exceeded_exception::deadline_exceeded_exception(string const& message) :
+        runtime_error(message)
+    {
+    }
+
+    scoped_deadline::scoped_deadline(chrono::steady_clock::time_point deadline, atomic<bool> const* cancelled) :
+        _previous(current_scope.get()),
+        _deadline(deadline),
+        _cancelled(cancelled)
+    {
+        // Inherit the enclosing scope's deadline and cancellation if they are stricter
+        if (_previous) {
+            _deadline = min(_deadline, _previous->_deadline);
+            if (!_cancelled) {
+                _cancelled = _previous->_cancelled;
+            }
+        }
+        current_scope.reset(this);
+    }
+
+    scoped_deadline::~scoped_deadline()
+    {
+        current_scope.reset(_previous);
+    }
+
+    bool scoped_deadline::active()
+    {
+        return current_scope.get() != nullptr;
+    }
+
+    bool scoped_deadline::expired()
+    {
+        return remaining() == chrono::steady_clock::duration::zero();
+    }
+
+    chrono::steady_clock::duration scoped_deadline::remaining()
+    {
+        auto scope = current_scope.get();
+        if (!scope) {
+            return chrono::steady_clock::duration::max();
+        }
+        // Check the enclosing scopes for cancellation as nested scopes may be cancelled independently
+        for (auto current = scope; current; current = current->_previous) {
+            if (current->_cancelled && *current->_cancelled) {
+                return chrono::steady_clock::duration::zero();
+            }
+        }
+        if (scope->_deadline == chrono::steady_clock::time_point::max()) {
+            return chrono::steady_clock::duration::max();
+        }
+        auto now = chrono::steady_clock::now();
+        return now >= scope->_deadline ? chrono::steady_clock::duration::zero() : scope->_deadline - now;
+    }
+
+    void scoped_deadline::check()
+    {
+        if (expired()) {
+            throw deadline_exceeded_exception("the deadline for resolving facts has passed or resolution was cancelled.");
+        }
+    }
+
+}}  // namespace facter::util
@@ -0,0 +1,47 @@
+#include <internal/util/scoped_root.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // The scopes are owned by the calling thread's stack; never delete them
+    static boost::thread_specific_ptr<scoped_root> current_scope([](scoped_root*) {});
+
+    scoped_root::scoped_root(string root) :
+        _previous(current_scope.get()),
+        _root(move(root))
+    {
+        // Strip trailing separators so that "/" is the same as no root
+        while (!_root.empty() && _root.back() == '/') {
+            _root.pop_back();
+        }
+        current_scope.reset(this);
+    }
+
+    scoped_root::~scoped_root()
+    {
+        current_scope.reset(_previous);
+    }
+
+    string const& scoped_root::current()
+    {
+        static string const none;
+        auto scope = current_scope.get();
+        return scope ? scope->_root : none;
+    }
+
+    string scoped_root::path(string const& path)
+    {
+        auto const& root = current();
+        if (root.empty() || path.empty() || path.front() != '/') {
+            return path;
+        }
+        // Don't rebase paths that were already found beneath the root
+        if (path.compare(0, root.size(), root) == 0 && (path.size() == root.size() || path[root.size()] == '/')) {
+            return path;
+        }
+        return root + path;
+    }
+
+}}  // namespace facter::util
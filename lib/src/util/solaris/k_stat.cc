@@ -1,11 +1,14 @@
 #include <internal/util/solaris/k_stat.hpp>
+#include <boost/thread/locks.hpp>
 #include <sys/kstat.h>
 #include <cstring>
 
 using namespace std;
 
 namespace facter { namespace util { namespace solaris {
-    k_stat::k_stat() {
+    k_stat::k_stat() :
+        _indexed(false)
+    {
         if (ctrl == nullptr) {
             throw kstat_exception("kstat_open failed");
         }
@@ -26,35 +29,48 @@ namespace facter { namespace util { namespace solaris {
         return lookup(entry.first, -1, entry.second);
     }
 
-    vector<k_stat_entry> k_stat::lookup(string const& module, int instance, string const& name)
+    void k_stat::update_index()
     {
-        kstat_t* kp = kstat_lookup(ctrl, const_cast<char*>(module.c_str()), instance, name.empty() ? nullptr : const_cast<char *>(name.c_str()));
-        if (kp == nullptr) {
-            throw kstat_exception("kstat_lookup failed m:" + module + " i:" + to_string(instance) + " n:" + name + " err:" + strerror(errno));
+        // Only walk the chain again if the kernel added or removed kstats since it was indexed
+        kid_t id = kstat_chain_update(ctrl);
+        if (id == -1) {
+            throw kstat_exception(string("kstat_chain_update failed: ") + strerror(errno));
+        }
+        if (_indexed && id == 0) {
+            return;
         }
 
-        vector<k_stat_entry> arr;
-        while (kp) {
-            if (kstat_read(ctrl, kp, 0) == -1) {
-                throw kstat_exception("kstat_read failed");
-            }
+        _modules.clear();
+        for (kstat_t* kp = static_cast<kstat_ctl*>(ctrl)->kc_chain; kp; kp = kp->ks_next) {
+            _modules[kp->ks_module].push_back(kp);
+        }
+        _indexed = true;
+    }
 
-            bool insert = true;
-            if (!module.empty() && module != kp->ks_module) {
-                insert = false;
-            }
-            if (instance != -1 && instance != kp->ks_instance) {
-                insert = false;
-            }
-            if (!name.empty() && name != kp->ks_name) {
-                insert = false;
-            }
-            if (insert) {
+    vector<k_stat_entry> k_stat::lookup(string const& module, int instance, string const& name)
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        update_index();
+
+        vector<k_stat_entry> arr;
+        auto it = _modules.find(module);
+        if (it != _modules.end()) {
+            for (auto kp : it->second) {
+                if (instance != -1 && instance != kp->ks_instance) {
+                    continue;
+                }
+                if (!name.empty() && name != kp->ks_name) {
+                    continue;
+                }
+                if (kstat_read(ctrl, kp, 0) == -1) {
+                    throw kstat_exception("kstat_read failed");
+                }
                 arr.push_back(k_stat_entry(kp));
             }
-            kp = kp->ks_next;
         }
-
+        if (arr.empty()) {
+            throw kstat_exception("kstat_lookup failed m:" + module + " i:" + to_string(instance) + " n:" + name);
+        }
         return arr;
     }
 
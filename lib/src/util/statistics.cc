@@ -0,0 +1,89 @@
+#include <internal/util/statistics.hpp>
+#include <internal/util/metrics.hpp>
+#include <boost/chrono/thread_clock.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // The scopes are owned by the recording thread's stack; never delete them
+    static boost::thread_specific_ptr<scoped_statistics> current_scope([](scoped_statistics*) {});
+
+    static chrono::nanoseconds wall_now()
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch());
+    }
+
+    static chrono::nanoseconds cpu_now()
+    {
+#ifdef BOOST_CHRONO_HAS_THREAD_CLOCK
+        return chrono::nanoseconds(boost::chrono::thread_clock::now().time_since_epoch().count());
+#else
+        return chrono::nanoseconds(0);
+#endif
+    }
+
+    statistics::statistics() :
+        wall_time(0),
+        cpu_time(0),
+        processes(0),
+        bytes_read(0),
+        http_requests(0)
+    {
+    }
+
+    scoped_statistics::scoped_statistics(statistics& stats) :
+        _stats(stats),
+        _previous(current_scope.get()),
+        _wall_start(wall_now()),
+        _cpu_start(cpu_now()),
+        _nested_wall(0),
+        _nested_cpu(0)
+    {
+        current_scope.reset(this);
+    }
+
+    scoped_statistics::~scoped_statistics()
+    {
+        auto wall = wall_now() - _wall_start;
+        auto cpu = cpu_now() - _cpu_start;
+
+        // Only record the time not already recorded by nested scopes
+        _stats.wall_time += wall - _nested_wall;
+        _stats.cpu_time += cpu - _nested_cpu;
+
+        if (_previous) {
+            _previous->_nested_wall += wall;
+            _previous->_nested_cpu += cpu;
+        }
+        current_scope.reset(_previous);
+    }
+
+    void scoped_statistics::record_process()
+    {
+        metrics::record_process();
+        auto scope = current_scope.get();
+        if (scope) {
+            ++scope->_stats.processes;
+        }
+    }
+
+    void scoped_statistics::record_bytes_read(size_t count)
+    {
+        auto scope = current_scope.get();
+        if (scope) {
+            scope->_stats.bytes_read += count;
+        }
+    }
+
+    void scoped_statistics::record_http_request()
+    {
+        metrics::record_http_request();
+        auto scope = current_scope.get();
+        if (scope) {
+            ++scope->_stats.http_requests;
+        }
+    }
+
+}}  // namespace facter::util
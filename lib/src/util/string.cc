@@ -1,10 +1,13 @@
 #include <facter/util/string.hpp>
+#include <internal/util/string_scan.hpp>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <iterator>
 #include <cmath>
 #include <limits>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
@@ -24,28 +27,62 @@ namespace facter { namespace util {
 
     void each_line(string const& s, function<bool(string&)> callback)
     {
-        string line;
-        istringstream in(s);
-        while (getline(in, line)) {
-            // Handle Windows CR in the string.
-            if (line.size() && line.back() == '\r') {
-                line.pop_back();
-            }
-            if (!callback(line)) {
-                break;
-            }
+        each_line<function<bool(string&)>&>(s, callback);
+    }
+
+    static char* write_digits(char* out, uint64_t value)
+    {
+        // Write the digits backwards into a scratch buffer, then copy them forward
+        char digits[20];
+        size_t count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        while (count) {
+            *out++ = digits[--count];
         }
+        return out;
+    }
+
+    static string format_number(uint64_t value, char const* suffix)
+    {
+        // Formats into a stack buffer; the result is short enough to fit in the string without allocating
+        char buffer[48];
+        char* out = write_digits(buffer, value);
+        while (*suffix) {
+            *out++ = *suffix++;
+        }
+        return string(buffer, out);
+    }
+
+    static string format_hundredths(double converted, char const* suffix)
+    {
+        // The value is already rounded to hundredths, so it is written as a whole number of hundredths
+        auto hundredths = static_cast<uint64_t>(round(converted * 100.0));
+        char buffer[48];
+        char* out = write_digits(buffer, hundredths / 100);
+        *out++ = '.';
+        *out++ = static_cast<char>('0' + (hundredths / 10) % 10);
+        *out++ = static_cast<char>('0' + hundredths % 10);
+        while (*suffix) {
+            *out++ = *suffix++;
+        }
+        return string(buffer, out);
     }
 
     string si_string(uint64_t size)
     {
-        static char prefixes[] = { 'K', 'M', 'G', 'T', 'P', 'E' };
+        static char const* const units[] = { " KiB", " MiB", " GiB", " TiB", " PiB", " EiB" };
 
         if (size < 1024) {
-            return to_string(size) + " bytes";
+            return format_number(size, " bytes");
+        }
+        unsigned int exp = 0;
+        for (uint64_t remaining = size; remaining >= 1024; remaining >>= 10) {
+            ++exp;
         }
-        unsigned int exp = floor(log2(size) / 10.0);
-        double converted = round(100.0 * (size / pow(1024.0, exp))) / 100.0;
+        double converted = round(100.0 * (size / ldexp(1.0, 10 * exp))) / 100.0;
 
         // Check to see if rounding up gets us to 1024; if so, move to the next unit
         if (fabs(converted - 1024.0) < numeric_limits<double>::epsilon()) {
@@ -54,13 +91,10 @@ namespace facter { namespace util {
         }
 
         // If we exceed the SI prefix (we shouldn't, but just in case), just return the bytes
-        if (exp - 1 >= sizeof(prefixes)) {
-            return to_string(size) + " bytes";
+        if (exp - 1 >= sizeof(units) / sizeof(units[0])) {
+            return format_number(size, " bytes");
         }
-
-        ostringstream ss;
-        ss  << fixed << setprecision(2) << converted << " " << prefixes[exp - 1] << "iB";
-        return ss.str();
+        return format_hundredths(converted, units[exp - 1]);
     }
 
     string percentage(uint64_t used, uint64_t total)
@@ -76,20 +110,22 @@ namespace facter { namespace util {
         if (fabs(converted - 100.0) < numeric_limits<double>::epsilon()) {
             converted = 99.99;
         }
-        ostringstream ss;
-        ss << fixed << setprecision(2) << converted << "%";
-        return ss.str();
+        return format_hundredths(converted, "%");
     }
 
     string frequency(int64_t freq)
     {
-        static char prefixes[] = { 'k', 'M', 'G', 'T'  };
+        static char const* const units[] = { " kHz", " MHz", " GHz", " THz" };
+        static double const scales[] = { 1.0, 1e3, 1e6, 1e9, 1e12, 1e15, 1e18 };
 
         if (freq < 1000) {
             return to_string(freq) + " Hz";
         }
-        unsigned int exp = floor(log10(freq) / 3.0);
-        double converted = round(100.0 * (freq / pow(1000.0, exp))) / 100.0;
+        unsigned int exp = 0;
+        for (int64_t remaining = freq; remaining >= 1000; remaining /= 1000) {
+            ++exp;
+        }
+        double converted = round(100.0 * (freq / scales[exp])) / 100.0;
 
         // Check to see if rounding up gets us to 1000; if so, move to the next unit
         if (fabs(converted - 1000.0) < numeric_limits<double>::epsilon()) {
@@ -98,13 +134,10 @@ namespace facter { namespace util {
         }
 
         // If we exceed the SI prefix (we shouldn't, but just in case), just return the speed in Hz
-        if (exp - 1 >= sizeof(prefixes)) {
-            return to_string(freq) + " Hz";
+        if (exp - 1 >= sizeof(units) / sizeof(units[0])) {
+            return format_number(static_cast<uint64_t>(freq), " Hz");
         }
-
-        ostringstream ss;
-        ss  << fixed << setprecision(2) << converted << " " << prefixes[exp - 1] << "Hz";
-        return ss.str();
+        return format_hundredths(converted, units[exp - 1]);
     }
 
     bool needs_quotation(string const& str)
@@ -118,25 +151,155 @@ namespace facter { namespace util {
         // May start with - or +
         // May contain at most one . or ,
         // All other characters should be digits
+        auto first = str.data();
+        auto last = first + str.size();
+        if (*first == '+' || *first == '-') {
+            ++first;
+        }
         bool has_separator = false;
-        for (size_t i = 0; i < str.size(); ++i) {
-            char c = str[i];
-            if (i == 0 && (c == '+' || c == '-')) {
-                continue;
+        while ((first = find_not_digit(first, last)) != last) {
+            if ((*first != '.' && *first != ',') || has_separator) {
+                return false;
+            }
+            has_separator = true;
+            ++first;
+        }
+
+        // Numerical strings should be quoted
+        return true;
+    }
+
+    static bool is_blank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    static void trim_blanks(char const*& first, char const*& last)
+    {
+        while (first < last && is_blank(*first)) {
+            ++first;
+        }
+        while (last > first && is_blank(*(last - 1))) {
+            --last;
+        }
+    }
+
+    static bool parse_digits(char const* first, char const* last, uint64_t limit, uint64_t& value)
+    {
+        if (first == last) {
+            return false;
+        }
+        uint64_t result = 0;
+        for (; first < last; ++first) {
+            if (*first < '0' || *first > '9') {
+                return false;
+            }
+            uint64_t digit = static_cast<uint64_t>(*first - '0');
+            if (result > (limit - digit) / 10) {
+                return false;
+            }
+            result = result * 10 + digit;
+        }
+        value = result;
+        return true;
+    }
+
+    bool parse_integer(char const* first, char const* last, int64_t& value)
+    {
+        trim_blanks(first, last);
+        bool negative = first < last && *first == '-';
+        if (first < last && (*first == '-' || *first == '+')) {
+            ++first;
+        }
+        // The magnitude of the most negative value is one more than the most positive
+        uint64_t limit = static_cast<uint64_t>(numeric_limits<int64_t>::max()) + (negative ? 1 : 0);
+        uint64_t magnitude;
+        if (!parse_digits(first, last, limit, magnitude)) {
+            return false;
+        }
+        value = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        return true;
+    }
+
+    bool parse_integer(char const* first, char const* last, uint64_t& value)
+    {
+        trim_blanks(first, last);
+        if (first < last && *first == '+') {
+            ++first;
+        }
+        return parse_digits(first, last, numeric_limits<uint64_t>::max(), value);
+    }
+
+    bool parse_double(char const* first, char const* last, double& value)
+    {
+        trim_blanks(first, last);
+        char const* start = first;
+
+        // Validate the syntax while gathering up to 19 significant digits of the mantissa
+        bool negative = false;
+        if (first < last && (*first == '-' || *first == '+')) {
+            negative = *first++ == '-';
+        }
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool any = false;
+        for (; first < last && *first >= '0' && *first <= '9'; ++first, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*first - '0');
+                digits += mantissa ? 1 : 0;
+            } else {
+                ++exponent;
             }
-            if (c == '.' || c == ',') {
-                if (has_separator) {
-                    return false;
+        }
+        if (first < last && *first == '.') {
+            for (++first; first < last && *first >= '0' && *first <= '9'; ++first, any = true) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*first - '0');
+                    digits += mantissa ? 1 : 0;
+                    --exponent;
                 }
-                has_separator = true;
-                continue;
             }
-            if (!isdigit(c)) {
+        }
+        if (!any) {
+            return false;
+        }
+        if (first < last && (*first == 'e' || *first == 'E')) {
+            ++first;
+            int64_t power;
+            if (first == last || is_blank(*first) || !parse_integer(first, last, power) || power < -10000 || power > 10000) {
                 return false;
             }
+            exponent += static_cast<int>(power);
+            first = last;
+        }
+        if (first != last) {
+            return false;
         }
 
-        // Numerical strings should be quoted
+        // A mantissa and power of ten that are both exact as doubles give a correctly rounded result with one operation
+        static double const powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+            double result = static_cast<double>(mantissa);
+            result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+            value = negative ? -result : result;
+            return true;
+        }
+
+        // Otherwise defer to strtod with a terminated copy of the (already validated) text
+        // Numbers rarely need more than the buffer on the stack; longer ones (e.g. with many digits) are copied to the heap
+        char buffer[64];
+        size_t length = static_cast<size_t>(last - start);
+        if (length >= sizeof(buffer)) {
+            value = strtod(string(start, last).c_str(), nullptr);
+            return true;
+        }
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        value = strtod(buffer, nullptr);
         return true;
     }
 
@@ -0,0 +1,163 @@
+#include <internal/util/string_scan.hpp>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FACTER_SCAN_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FACTER_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+namespace facter { namespace util {
+
+    // Each set of bytes matches one byte at a time and, where supported, 16 bytes at a time (yielding 0xff for each match)
+    struct escape_bytes
+    {
+        static bool match(unsigned char c)
+        {
+            return c < 0x20 || c == 0x7f || c == '"' || c == '\\';
+        }
+
+#if defined(FACTER_SCAN_SSE2)
+        static __m128i match(__m128i bytes)
+        {
+            // There is no unsigned comparison in SSE2: a byte is below 0x20 if the lesser of it and 0x1f is itself
+            auto control = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(0x1f)), bytes);
+            auto quote = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+            auto backslash = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+            auto del = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7f));
+            return _mm_or_si128(_mm_or_si128(control, del), _mm_or_si128(quote, backslash));
+        }
+#elif defined(FACTER_SCAN_NEON)
+        static uint8x16_t match(uint8x16_t bytes)
+        {
+            auto control = vcltq_u8(bytes, vdupq_n_u8(0x20));
+            auto quote = vceqq_u8(bytes, vdupq_n_u8('"'));
+            auto backslash = vceqq_u8(bytes, vdupq_n_u8('\\'));
+            auto del = vceqq_u8(bytes, vdupq_n_u8(0x7f));
+            return vorrq_u8(vorrq_u8(control, del), vorrq_u8(quote, backslash));
+        }
+#endif
+    };
+
+    struct plain_special_bytes
+    {
+        static bool match(unsigned char c)
+        {
+            return c < 0x20 || c == 0x7f || c == ':' || c == '#';
+        }
+
+#if defined(FACTER_SCAN_SSE2)
+        static __m128i match(__m128i bytes)
+        {
+            auto control = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(0x1f)), bytes);
+            auto colon = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(':'));
+            auto hash = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('#'));
+            auto del = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7f));
+            return _mm_or_si128(_mm_or_si128(control, del), _mm_or_si128(colon, hash));
+        }
+#elif defined(FACTER_SCAN_NEON)
+        static uint8x16_t match(uint8x16_t bytes)
+        {
+            auto control = vcltq_u8(bytes, vdupq_n_u8(0x20));
+            auto colon = vceqq_u8(bytes, vdupq_n_u8(':'));
+            auto hash = vceqq_u8(bytes, vdupq_n_u8('#'));
+            auto del = vceqq_u8(bytes, vdupq_n_u8(0x7f));
+            return vorrq_u8(vorrq_u8(control, del), vorrq_u8(colon, hash));
+        }
+#endif
+    };
+
+    struct not_digit_bytes
+    {
+        static bool match(unsigned char c)
+        {
+            return static_cast<unsigned char>(c - '0') > 9;
+        }
+
+#if defined(FACTER_SCAN_SSE2)
+        static __m128i match(__m128i bytes)
+        {
+            // Bytes wrap on subtraction, so only the digits are at most 9 after subtracting '0'
+            auto offset = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+            auto digit = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(9)), offset);
+            return _mm_xor_si128(digit, _mm_set1_epi8(-1));
+        }
+#elif defined(FACTER_SCAN_NEON)
+        static uint8x16_t match(uint8x16_t bytes)
+        {
+            return vcgtq_u8(vsubq_u8(bytes, vdupq_n_u8('0')), vdupq_n_u8(9));
+        }
+#endif
+    };
+
+    struct newline_bytes
+    {
+        static bool match(unsigned char c)
+        {
+            return c == '\n' || c == '\r';
+        }
+
+#if defined(FACTER_SCAN_SSE2)
+        static __m128i match(__m128i bytes)
+        {
+            return _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')));
+        }
+#elif defined(FACTER_SCAN_NEON)
+        static uint8x16_t match(uint8x16_t bytes)
+        {
+            return vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('\n')), vceqq_u8(bytes, vdupq_n_u8('\r')));
+        }
+#endif
+    };
+
+    template <typename Bytes>
+    static char const* find_first(char const* first, char const* last)
+    {
+        // Skip whole blocks without a match; the block with the first match, and any tail, is scanned a byte at a time
+#if defined(FACTER_SCAN_SSE2)
+        for (; last - first >= 16; first += 16) {
+            auto matches = Bytes::match(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first)));
+            if (_mm_movemask_epi8(matches) != 0) {
+                break;
+            }
+        }
+#elif defined(FACTER_SCAN_NEON)
+        for (; last - first >= 16; first += 16) {
+            auto matches = Bytes::match(vld1q_u8(reinterpret_cast<uint8_t const*>(first)));
+            auto folded = vorr_u8(vget_low_u8(matches), vget_high_u8(matches));
+            if (vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0) {
+                break;
+            }
+        }
+#endif
+        for (; first < last; ++first) {
+            if (Bytes::match(static_cast<unsigned char>(*first))) {
+                break;
+            }
+        }
+        return first;
+    }
+
+    char const* find_escape(char const* first, char const* last)
+    {
+        return find_first<escape_bytes>(first, last);
+    }
+
+    char const* find_plain_special(char const* first, char const* last)
+    {
+        return find_first<plain_special_bytes>(first, last);
+    }
+
+    char const* find_not_digit(char const* first, char const* last)
+    {
+        return find_first<not_digit_bytes>(first, last);
+    }
+
+    char const* find_newline(char const* first, char const* last)
+    {
+        return find_first<newline_bytes>(first, last);
+    }
+
+}}  // namespace facter::util
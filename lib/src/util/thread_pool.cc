@@ -0,0 +1,323 @@
+#include <internal/util/thread_pool.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <algorithm>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    struct thread_pool::worker
+    {
+        explicit worker(thread_pool* owner) :
+            pool(owner)
+        {
+        }
+
+        thread_pool* pool;
+        boost::mutex mutex;
+        deque<function<void()>> tasks;
+        boost::thread thread;
+    };
+
+    cancellation_token::cancellation_token() :
+        _flag(make_shared<atomic<bool>>(false))
+    {
+    }
+
+    void cancellation_token::cancel() const
+    {
+        *_flag = true;
+    }
+
+    bool cancellation_token::cancelled() const
+    {
+        return *_flag;
+    }
+
+    atomic<bool> const* cancellation_token::flag() const
+    {
+        return _flag.get();
+    }
+
+    const unsigned int thread_pool::max_threads;
+
+    boost::thread_specific_ptr<thread_pool::worker>& thread_pool::current_worker()
+    {
+        // The workers are owned by their pools; never delete them
+        static boost::thread_specific_ptr<worker> current([](worker*) {});
+        return current;
+    }
+
+    thread_pool::thread_pool(unsigned int threads) :
+        _count(0),
+        _queued(0),
+        _stopping(false)
+    {
+        _workers.reserve(max_threads);
+        reserve(max(threads, 1u));
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _stopping = true;
+            _available.notify_all();
+        }
+        for (auto& w : _workers) {
+            w->thread.join();
+        }
+    }
+
+    thread_pool& thread_pool::instance()
+    {
+        // The shared pool is never destroyed: tasks may still be running while the process exits
+        static thread_pool* pool = new thread_pool(default_size());
+        return *pool;
+    }
+
+    unsigned int thread_pool::default_size()
+    {
+        return max(boost::thread::hardware_concurrency(), 1u);
+    }
+
+    void thread_pool::reserve(unsigned int threads)
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        threads = min(threads, max_threads);
+        if (_workers.size() >= threads) {
+            return;
+        }
+        LOG_DEBUG("starting %1% threads for the thread pool.", threads - _workers.size());
+        while (_workers.size() < threads) {
+            _workers.emplace_back(new worker(this));
+            auto& w = *_workers.back();
+            w.thread = boost::thread([this, &w]() { run(w); });
+        }
+        _count = static_cast<unsigned int>(_workers.size());
+    }
+
+    unsigned int thread_pool::size() const
+    {
+        return _count;
+    }
+
+    void thread_pool::submit(function<void()> task)
+    {
+        // Tasks submitted by a task are queued on its thread, where they're likely to find what it was working on
+        auto self = current_worker().get();
+        if (self && self->pool == this) {
+            boost::lock_guard<boost::mutex> lock(self->mutex);
+            self->tasks.emplace_back(move(task));
+        } else {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _queue.emplace_back(move(task));
+        }
+        ++_queued;
+
+        // Take the pool's lock so that a thread about to sleep sees the task
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        _available.notify_one();
+    }
+
+    bool thread_pool::take(worker* self, function<void()>& task)
+    {
+        if (_queued == 0) {
+            return false;
+        }
+
+        // Run the newest of the thread's own tasks first
+        if (self) {
+            boost::lock_guard<boost::mutex> lock(self->mutex);
+            if (!self->tasks.empty()) {
+                task = move(self->tasks.back());
+                self->tasks.pop_back();
+                --_queued;
+                return true;
+            }
+        }
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            if (!_queue.empty()) {
+                task = move(_queue.front());
+                _queue.pop_front();
+                --_queued;
+                return true;
+            }
+        }
+
+        // Steal the oldest task of another thread, starting after this one so that thieves spread out
+        unsigned int count = _count;
+        unsigned int start = 0;
+        if (self) {
+            start = static_cast<unsigned int>(find_if(_workers.begin(), _workers.begin() + count, [&](unique_ptr<worker> const& w) {
+                return w.get() == self;
+            }) - _workers.begin());
+        }
+        for (unsigned int i = 1; i <= count; ++i) {
+            auto& victim = *_workers[(start + i) % count];
+            if (&victim == self) {
+                continue;
+            }
+            boost::lock_guard<boost::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --_queued;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void thread_pool::run(worker& self)
+    {
+        current_worker().reset(&self);
+        function<void()> task;
+        while (true) {
+            if (take(&self, task)) {
+                try {
+                    task();
+                } catch (exception& ex) {
+                    LOG_ERROR("unhandled exception in thread pool task: %1%", ex.what());
+                } catch (...) {
+                    LOG_ERROR("unhandled exception in thread pool task.");
+                }
+                task = nullptr;
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            while (_queued == 0 && !_stopping) {
+                _available.wait(lock);
+            }
+            if (_stopping) {
+                break;
+            }
+        }
+        current_worker().reset();
+    }
+
+    struct task_group::state
+    {
+        state(cancellation_token token, chrono::steady_clock::time_point deadline) :
+            token(move(token)),
+            deadline(deadline),
+            running(0),
+            abandoned(false)
+        {
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable finished;
+        deque<function<void()>> tasks;
+        cancellation_token token;
+        chrono::steady_clock::time_point deadline;
+        size_t running;
+        bool abandoned;
+        exception_ptr error;
+    };
+
+    task_group::task_group(thread_pool& pool, cancellation_token token, chrono::steady_clock::time_point deadline) :
+        _pool(pool),
+        _state(make_shared<state>(move(token), deadline))
+    {
+    }
+
+    task_group::~task_group()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(_state->mutex);
+            _state->tasks.clear();
+        }
+        try {
+            wait();
+        } catch (...) {
+        }
+    }
+
+    void task_group::run(function<void()> task)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(_state->mutex);
+            _state->tasks.emplace_back(move(task));
+        }
+
+        // The pool runs whichever of the group's tasks is next; the waiting thread may already have run this one
+        auto tasks = _state;
+        _pool.submit([tasks]() { run_next(*tasks); });
+    }
+
+    bool task_group::run_next(state& tasks)
+    {
+        function<void()> task;
+        {
+            boost::lock_guard<boost::mutex> lock(tasks.mutex);
+            if (tasks.tasks.empty()) {
+                return false;
+            }
+            task = move(tasks.tasks.front());
+            tasks.tasks.pop_front();
+            ++tasks.running;
+        }
+
+        exception_ptr error;
+        bool abandoned = tasks.token.cancelled() || chrono::steady_clock::now() >= tasks.deadline;
+        if (!abandoned) {
+            try {
+                scoped_deadline limiting(tasks.deadline, tasks.token.flag());
+                task();
+            } catch (...) {
+                error = current_exception();
+            }
+        }
+
+        boost::lock_guard<boost::mutex> lock(tasks.mutex);
+        tasks.abandoned = tasks.abandoned || abandoned;
+        if (error && !tasks.error) {
+            tasks.error = error;
+        }
+        if (--tasks.running == 0 && tasks.tasks.empty()) {
+            tasks.finished.notify_all();
+        }
+        return true;
+    }
+
+    void task_group::wait()
+    {
+        while (run_next(*_state)) {
+        }
+
+        boost::unique_lock<boost::mutex> lock(_state->mutex);
+        while (_state->running > 0 || !_state->tasks.empty()) {
+            _state->finished.wait(lock);
+        }
+
+        // Report the outcome once; the group may be used again
+        auto error = _state->error;
+        bool abandoned = _state->abandoned;
+        _state->error = nullptr;
+        _state->abandoned = false;
+        lock.unlock();
+        if (error) {
+            rethrow_exception(error);
+        }
+        if (abandoned) {
+            throw deadline_exceeded_exception("tasks were abandoned because their deadline passed or they were cancelled.");
+        }
+    }
+
+    void task_group::cancel()
+    {
+        _state->token.cancel();
+    }
+
+    cancellation_token const& task_group::token() const
+    {
+        return _state->token;
+    }
+
+}}  // namespace facter::util
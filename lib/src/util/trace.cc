@@ -0,0 +1,191 @@
+#include <facter/util/trace.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+#include <boost/nowide/fstream.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <map>
+#include <vector>
+
+using namespace std;
+using namespace rapidjson;
+
+namespace facter { namespace util {
+
+    // A recorded span
+    struct trace_event
+    {
+        char const* category;
+        string name;
+        char const* argument;
+        string value;
+        chrono::steady_clock::time_point start;
+        chrono::steady_clock::time_point end;
+        int thread;
+        bool async;
+    };
+
+    // The spans recorded since the trace was started; threads are numbered in the order they first record a span
+    static atomic<bool> tracing(false);
+    static boost::mutex trace_mutex;
+    static chrono::steady_clock::time_point trace_start;
+    static boost::thread::id main_thread;
+    static map<boost::thread::id, int> trace_threads;
+    static vector<trace_event> trace_events;
+
+    static void record(char const* category, string name, char const* argument, string value, chrono::steady_clock::time_point start, bool async)
+    {
+        auto end = chrono::steady_clock::now();
+        auto id = boost::this_thread::get_id();
+        boost::lock_guard<boost::mutex> lock(trace_mutex);
+        auto thread = trace_threads.emplace(id, static_cast<int>(trace_threads.size()) + 1).first->second;
+        trace_events.push_back({ category, move(name), argument, move(value), start, end, thread, async });
+    }
+
+    static int64_t microseconds(chrono::steady_clock::time_point time)
+    {
+        return chrono::duration_cast<chrono::microseconds>(time - trace_start).count();
+    }
+
+    static void write_common(Writer<StringBuffer>& writer, trace_event const& event, char const* phase, chrono::steady_clock::time_point time)
+    {
+        writer.String("name");
+        writer.String(event.name.c_str(), static_cast<SizeType>(event.name.size()));
+        writer.String("cat");
+        writer.String(event.category);
+        writer.String("ph");
+        writer.String(phase);
+        writer.String("ts");
+        writer.Int64(microseconds(time));
+        writer.String("pid");
+        writer.Int(1);
+        writer.String("tid");
+        writer.Int(event.thread);
+    }
+
+    static void write_argument(Writer<StringBuffer>& writer, trace_event const& event)
+    {
+        if (!event.argument) {
+            return;
+        }
+        writer.String("args");
+        writer.StartObject();
+        writer.String(event.argument);
+        writer.String(event.value.c_str(), static_cast<SizeType>(event.value.size()));
+        writer.EndObject();
+    }
+
+    void start_trace()
+    {
+        boost::lock_guard<boost::mutex> lock(trace_mutex);
+        trace_start = chrono::steady_clock::now();
+        main_thread = boost::this_thread::get_id();
+        trace_threads.clear();
+        trace_threads.emplace(main_thread, 1);
+        trace_events.clear();
+        tracing = true;
+    }
+
+    bool write_trace(string const& path)
+    {
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        {
+            boost::lock_guard<boost::mutex> lock(trace_mutex);
+            writer.StartObject();
+            writer.String("traceEvents");
+            writer.StartArray();
+
+            // Name each thread's track
+            for (auto const& thread : trace_threads) {
+                string name = thread.first == main_thread ? "main" : "thread " + to_string(thread.second);
+                writer.StartObject();
+                writer.String("name");
+                writer.String("thread_name");
+                writer.String("ph");
+                writer.String("M");
+                writer.String("pid");
+                writer.Int(1);
+                writer.String("tid");
+                writer.Int(thread.second);
+                writer.String("args");
+                writer.StartObject();
+                writer.String("name");
+                writer.String(name.c_str(), static_cast<SizeType>(name.size()));
+                writer.EndObject();
+                writer.EndObject();
+            }
+
+            // Nested spans are complete events; overlapping spans are async begin and end events
+            uint64_t id = 0;
+            for (auto const& event : trace_events) {
+                writer.StartObject();
+                if (event.async) {
+                    write_common(writer, event, "b", event.start);
+                    writer.String("id");
+                    writer.Uint64(++id);
+                    write_argument(writer, event);
+                    writer.EndObject();
+                    writer.StartObject();
+                    write_common(writer, event, "e", event.end);
+                    writer.String("id");
+                    writer.Uint64(id);
+                } else {
+                    write_common(writer, event, "X", event.start);
+                    writer.String("dur");
+                    writer.Int64(chrono::duration_cast<chrono::microseconds>(event.end - event.start).count());
+                    write_argument(writer, event);
+                }
+                writer.EndObject();
+            }
+            writer.EndArray();
+            writer.String("displayTimeUnit");
+            writer.String("ms");
+            writer.EndObject();
+        }
+
+        boost::nowide::ofstream out(path.c_str(), ios::out | ios::binary | ios::trunc);
+        out << buffer.GetString();
+        if (!out) {
+            LOG_WARNING("trace file %1% could not be written.", path);
+            return false;
+        }
+        return true;
+    }
+
+    scoped_trace_span::scoped_trace_span(char const* category, string name, char const* argument, string value) :
+        _active(tracing),
+        _category(category),
+        _argument(argument)
+    {
+        if (_active) {
+            _name = move(name);
+            _value = move(value);
+            _start = chrono::steady_clock::now();
+        }
+    }
+
+    scoped_trace_span::~scoped_trace_span()
+    {
+        if (_active) {
+            record(_category, move(_name), _argument, move(_value), _start, false);
+        }
+    }
+
+    bool scoped_trace_span::enabled()
+    {
+        return tracing;
+    }
+
+    void scoped_trace_span::record_async(char const* category, string name, chrono::steady_clock::time_point start, char const* argument, string value)
+    {
+        if (tracing) {
+            record(category, move(name), argument, move(value), start, true);
+        }
+    }
+
+}}  // namespace facter::util
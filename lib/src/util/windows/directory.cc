@@ -0,0 +1,58 @@
+#include <facter/util/directory.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace boost::filesystem;
+
+namespace facter { namespace util {
+
+    void directory::each_file(string const& directory, function<bool(string const&)> callback, name_filter const& filter)
+    {
+        // Attempt to iterate the directory
+        boost::system::error_code ec;
+        directory_iterator it = directory_iterator(scoped_root::path(directory), ec);
+        if (ec) {
+            return;
+        }
+
+        // Call the callback for any matching files
+        directory_iterator end;
+        for (; it != end; ++it) {
+            boost::system::error_code ec;
+            if (!is_regular_file(it->status(ec))) {
+                continue;
+            }
+            if (filter(it->path().filename().string())) {
+                if (!callback(it->path().string())) {
+                    break;
+                }
+            }
+        }
+    }
+
+    void directory::each_subdirectory(string const& directory, function<bool(string const&)> callback, name_filter const& filter)
+    {
+        // Attempt to iterate the directory
+        boost::system::error_code ec;
+        directory_iterator it = directory_iterator(scoped_root::path(directory), ec);
+        if (ec) {
+            return;
+        }
+
+        // Call the callback for any matching subdirectories
+        directory_iterator end;
+        for (; it != end; ++it) {
+            boost::system::error_code ec;
+            if (!is_directory(it->status(ec))) {
+                continue;
+            }
+            if (filter(it->path().filename().string())) {
+                if (!callback(it->path().string())) {
+                    break;
+                }
+            }
+        }
+    }
+
+}}  // namespace facter::util
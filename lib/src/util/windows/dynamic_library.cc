@@ -6,6 +6,8 @@
 #include <leatherman/logging/logging.hpp>
 #include <boost/format.hpp>
 #include <boost/nowide/convert.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
 #include <tlhelp32.h>
 
 using namespace std;
@@ -35,7 +37,7 @@ namespace facter { namespace util {
             return library;
         }
 
-        boost::regex rx(pattern);
+        auto const& rx = cached_regex(pattern);
         do {
             if (re_search(boost::nowide::narrow(me32.szModule), rx)) {
                 // Use GetModuleHandleEx to ensure the reference count is incremented. If the module has been
@@ -62,10 +64,15 @@ namespace facter { namespace util {
         return dynamic_library();
     }
 
+    // Serializes loads so that only one of the threads loading the same library sees the first load
+    static boost::mutex load_mutex;
+
     bool dynamic_library::load(string const& name)
     {
         close();
 
+        boost::lock_guard<boost::mutex> lock(load_mutex);
+
         // Check if the module has already been loaded (and increment the ref count).
         HMODULE hMod;
         auto wname = boost::nowide::widen(name);
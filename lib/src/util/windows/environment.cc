@@ -1,55 +1,72 @@
 #include <facter/util/environment.hpp>
+#include <internal/util/environment_mutex.hpp>
 #include <internal/util/windows/windows.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/nowide/convert.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <atomic>
 #include <functional>
+#include <list>
 
 using namespace std;
 
 namespace facter { namespace util {
 
-    struct search_path_helper
+    static vector<string> load_search_paths()
     {
-        search_path_helper()
-        {
-            string paths;
-            if (environment::get("PATH", paths)) {
-                auto is_sep = bind(equal_to<char>(), placeholders::_1, environment::get_path_separator());
-                boost::trim_if(paths, is_sep);
-                boost::split(_paths, paths, is_sep, boost::token_compress_on);
-            }
-        }
-
-        vector<string> const& search_paths() const
-        {
-            return _paths;
+        vector<string> paths;
+        string value;
+        if (environment::get("PATH", value)) {
+            auto is_sep = bind(equal_to<char>(), placeholders::_1, environment::get_path_separator());
+            boost::trim_if(value, is_sep);
+            boost::split(paths, value, is_sep, boost::token_compress_on);
         }
+        return paths;
+    }
 
-     private:
-         vector<string> _paths;
-    };
+    // Every version of the search paths is kept so that references returned by search_paths stay valid when PATH changes
+    static boost::mutex search_paths_mutex;
+    static list<vector<string>> search_path_versions;
+    static atomic<vector<string> const*> current_search_paths(nullptr);
 
     char environment::get_path_separator()
     {
         return ';';
     }
 
-    static search_path_helper helper;
-
     vector<string> const& environment::search_paths()
     {
-        return helper.search_paths();
+        auto paths = current_search_paths.load(memory_order_acquire);
+        if (!paths) {
+            reload_search_paths();
+            paths = current_search_paths.load(memory_order_acquire);
+        }
+        return *paths;
     }
 
     void environment::reload_search_paths()
     {
-        helper = search_path_helper();
+        // Keep the current paths if they are unchanged
+        auto paths = load_search_paths();
+        boost::lock_guard<boost::mutex> lock(search_paths_mutex);
+        auto current = current_search_paths.load(memory_order_acquire);
+        if (current && *current == paths) {
+            return;
+        }
+        search_path_versions.emplace_back(move(paths));
+        current_search_paths.store(&search_path_versions.back(), memory_order_release);
     }
 
     void environment::each(function<bool(string&, string&)> callback)
     {
         // Enumerate all environment variables
-        auto ptr = GetEnvironmentStringsW();
+        // The block is a copy, so the lock is only needed to take it
+        wchar_t* ptr;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(environment_mutex());
+            ptr = GetEnvironmentStringsW();
+        }
         for (auto variables = ptr; variables && *variables; variables += wcslen(variables) + 1) {
             string pair = boost::nowide::narrow(variables);
             string name;
@@ -71,4 +88,38 @@ namespace facter { namespace util {
         }
     }
 
+    void environment::each(string const& prefix, function<bool(string&, string&)> callback)
+    {
+        // Compare the prefix before narrowing so that only the matching variables are converted
+        wstring wide_prefix = boost::nowide::widen(prefix);
+        string name;
+        string value;
+        // The block is a copy, so the lock is only needed to take it
+        wchar_t* ptr;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(environment_mutex());
+            ptr = GetEnvironmentStringsW();
+        }
+        for (auto variables = ptr; variables && *variables; variables += wcslen(variables) + 1) {
+            if (_wcsnicmp(variables, wide_prefix.c_str(), wide_prefix.size()) != 0) {
+                continue;
+            }
+            string pair = boost::nowide::narrow(variables);
+            auto pos = pair.find('=');
+            if (pos == string::npos) {
+                name = move(pair);
+                value.clear();
+            } else {
+                name = pair.substr(0, pos);
+                value = pair.substr(pos + 1);
+            }
+            if (!callback(name, value)) {
+                break;
+            }
+        }
+        if (ptr) {
+            FreeEnvironmentStringsW(ptr);
+        }
+    }
+
 }}  // namespace facter::util
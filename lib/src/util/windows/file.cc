@@ -0,0 +1,31 @@
+#include <facter/util/file.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <internal/util/statistics.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    bool file::read(string const& path, string& contents)
+    {
+        contents.clear();
+        boost::nowide::ifstream in(scoped_root::path(path).c_str(), ios::in | ios::binary);
+        if (!in) {
+            return false;
+        }
+
+        // Read directly into the caller's string, reusing its capacity
+        in.seekg(0, ios::end);
+        auto size = in.tellg();
+        in.seekg(0, ios::beg);
+        if (size > 0) {
+            contents.resize(static_cast<size_t>(size));
+            in.read(&contents[0], size);
+            contents.resize(static_cast<size_t>(in.gcount()));
+        }
+        scoped_statistics::record_bytes_read(contents.size());
+        return true;
+    }
+
+}}  // namespace facter::util
@@ -1,6 +1,7 @@
 #include <internal/util/windows/wmi.hpp>
 #include <facter/execution/execution.hpp>
 #include <leatherman/logging/logging.hpp>
+#include <boost/thread/locks.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/range/iterator_range.hpp>
@@ -29,7 +30,30 @@ namespace facter { namespace util { namespace windows {
     // doesn't define it, but obscures the Windows Platform SDK version of wbemuuid.lib.
     constexpr static CLSID MyCLSID_WbemLocator = {0x4590f811, 0x1d3a, 0x11d0, 0x89, 0x1f, 0x00, 0xaa, 0x00, 0x4b, 0x2e, 0x24};
 
-    wmi::wmi()
+    wmi::wmi() :
+        _connected(false),
+        _pLoc(nullptr, [](IWbemLocator *loc) { if (loc) loc->Release(); }),
+        _pSvc(nullptr, [](IWbemServices *svc) { if (svc) svc->Release(); })
+    {
+    }
+
+    IWbemServices* wmi::services() const
+    {
+        // Connect once, on the first query; a failed connection isn't retried
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        if (!_connected) {
+            _connected = true;
+            try {
+                connect();
+            } catch (wmi_exception& ex) {
+                LOG_ERROR("WMI facts are unavailable: %1%", ex.what());
+                _pSvc = scoped_resource<IWbemServices *>(nullptr, [](IWbemServices *svc) { if (svc) svc->Release(); });
+            }
+        }
+        return _pSvc;
+    }
+
+    void wmi::connect() const
     {
         LOG_DEBUG("initializing WMI");
         auto hres = CoInitializeEx(0, COINIT_MULTITHREADED);
@@ -99,51 +123,75 @@ namespace facter { namespace util { namespace windows {
 
     wmi::imaps wmi::query(string const& group, vector<string> const& keys, string const& extended) const
     {
-        IEnumWbemClassObject *_pEnum = NULL;
-        string qry = "SELECT " + boost::join(keys, ",") + " FROM " + group;
-        if (!extended.empty()) {
-            qry += " " + extended;
-        }
+        auto results = query(vector<request>{ { group, keys, extended } });
+        return move(results.front());
+    }
 
-        auto hres = (*_pSvc).ExecQuery(_bstr_t(L"WQL"), _bstr_t(boost::nowide::widen(qry).c_str()),
-            WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY, NULL, &_pEnum);
-        if (FAILED(hres)) {
-            LOG_DEBUG("query %1% failed", qry);
-            return {};
+    vector<wmi::imaps> wmi::query(vector<request> const& requests) const
+    {
+        using enumerator = scoped_resource<IEnumWbemClassObject *>;
+
+        // Issue every query before reading any results; the queries are semisynchronous, so each call returns
+        // immediately and WMI works on all of them while the results of the first are read
+        vector<imaps> results(requests.size());
+        auto pSvc = services();
+        if (!pSvc) {
+            return results;
         }
-        scoped_resource<IEnumWbemClassObject *> pEnum(move(_pEnum),
-            [](IEnumWbemClassObject *rsc) { if (rsc) rsc->Release(); });
 
-        imaps array_of_vals;
+        vector<enumerator> enumerators;
+        enumerators.reserve(requests.size());
+        for (auto const& req : requests) {
+            IEnumWbemClassObject *_pEnum = NULL;
+            string qry = "SELECT " + boost::join(req.keys, ",") + " FROM " + req.group;
+            if (!req.extra.empty()) {
+                qry += " " + req.extra;
+            }
 
-        IWbemClassObject *pclsObjs[256];
-        ULONG uReturn = 0;
-        while (pEnum) {
-            auto hr = (*pEnum).Next(WBEM_INFINITE, 256, pclsObjs, &uReturn);
-            if (FAILED(hr) || 0 == uReturn) {
-                break;
+            auto hres = pSvc->ExecQuery(_bstr_t(L"WQL"), _bstr_t(boost::nowide::widen(qry).c_str()),
+                WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY, NULL, &_pEnum);
+            if (FAILED(hres)) {
+                LOG_DEBUG("query %1% failed", qry);
+                _pEnum = NULL;
             }
+            enumerators.emplace_back(move(_pEnum),
+                [](IEnumWbemClassObject *rsc) { if (rsc) rsc->Release(); });
+        }
 
-            for (auto pclsObj : boost::make_iterator_range(pclsObjs, pclsObjs+uReturn)) {
-                imap vals;
-                for (auto &s : keys) {
-                    VARIANT vtProp;
-                    CIMTYPE vtType;
-                    hr = pclsObj->Get(_bstr_t(boost::nowide::widen(s).c_str()), 0, &vtProp, &vtType, 0);
-                    if (FAILED(hr)) {
-                        LOG_DEBUG("query %1%.%2% could not be found", group, s);
-                        break;
-                    }
+        for (size_t i = 0; i < requests.size(); ++i) {
+            auto const& group = requests[i].group;
+            auto const& keys = requests[i].keys;
+            auto& pEnum = enumerators[i];
+            auto& array_of_vals = results[i];
+
+            IWbemClassObject *pclsObjs[256];
+            ULONG uReturn = 0;
+            while (pEnum) {
+                auto hr = (*pEnum).Next(WBEM_INFINITE, 256, pclsObjs, &uReturn);
+                if (FAILED(hr) || 0 == uReturn) {
+                    break;
+                }
 
-                    wmi_add_result(vals, group, s, &vtProp);
-                    VariantClear(&vtProp);
+                for (auto pclsObj : boost::make_iterator_range(pclsObjs, pclsObjs+uReturn)) {
+                    imap vals;
+                    for (auto &s : keys) {
+                        VARIANT vtProp;
+                        CIMTYPE vtType;
+                        hr = pclsObj->Get(_bstr_t(boost::nowide::widen(s).c_str()), 0, &vtProp, &vtType, 0);
+                        if (FAILED(hr)) {
+                            LOG_DEBUG("query %1%.%2% could not be found", group, s);
+                            break;
+                        }
+
+                        wmi_add_result(vals, group, s, &vtProp);
+                        VariantClear(&vtProp);
+                    }
+                    pclsObj->Release();
+                    array_of_vals.emplace_back(move(vals));
                 }
-                pclsObj->Release();
-                array_of_vals.emplace_back(move(vals));
             }
         }
-
-        return array_of_vals;
+        return results;
     }
 
     string const& wmi::get(wmi::imap const& kvmap, string const& key)
@@ -1,9 +1,15 @@
 #include <catch.hpp>
 #include <facter/execution/execution.hpp>
 #include <facter/util/string.hpp>
+#include <internal/execution/command_cache.hpp>
+#include <internal/execution/execution.hpp>
+#include <internal/util/scoped_deadline.hpp>
 #include <boost/algorithm/string.hpp>
 #include "../../fixtures.hpp"
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
 
 using namespace std;
 using namespace facter::util;
@@ -69,6 +75,28 @@ SCENARIO("searching for programs with execution::which") {
     }
 }
 
+SCENARIO("searching for programs with a cache") {
+    clear_which_cache();
+    GIVEN("a program that was not found") {
+        REQUIRE(which("cached_program", { "which_cache" }) == "");
+        test_with_relative_path fixture("which_cache", "cached_program", "#! /bin/sh");
+        THEN("it should not be found until the cache is cleared") {
+            REQUIRE(which("cached_program", { "which_cache" }) == "");
+            clear_which_cache();
+            REQUIRE(which("cached_program", { "which_cache" }) == "which_cache/cached_program");
+        }
+    }
+    GIVEN("a program that was found") {
+        test_with_relative_path fixture("which_cache", "cached_program", "#! /bin/sh");
+        REQUIRE(which("cached_program", { "which_cache" }) == "which_cache/cached_program");
+        THEN("a search of other paths should not use the result") {
+            REQUIRE(which("cached_program", { "which_cache", "other" }) == "which_cache/cached_program");
+            REQUIRE(which("cached_program", { "other" }) == "");
+        }
+    }
+    clear_which_cache();
+}
+
 SCENARIO("expanding command paths with execution::expand_command") {
     GIVEN("an executable on the PATH") {
         THEN("the executable is expanded to an absolute path") {
@@ -112,6 +140,51 @@ SCENARIO("expanding command paths with execution::expand_command") {
     }
 }
 
+SCENARIO("getting the invocation of a command with execution::command_invocation") {
+    vector<string> directories = { LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution" };
+    GIVEN("a command without shell features") {
+        THEN("the program should be run directly with its arguments") {
+            auto invocation = command_invocation("facts  --name=value\t1 /dev/null", directories);
+            REQUIRE(invocation.first == LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/facts");
+            REQUIRE(invocation.second == vector<string>({ "--name=value", "1", "/dev/null" }));
+        }
+    }
+    GIVEN("commands with shell features") {
+        THEN("they should be run with the shell") {
+            for (auto command : { "facts | cat", "facts > out", "facts $HOME", "facts *", "facts 'a b'", "facts && facts", "facts; facts", "facts `facts`", "facts ~", "NAME=value facts", "facts # comment" }) {
+                auto invocation = command_invocation(command, directories);
+                REQUIRE(invocation.first == command_shell);
+                REQUIRE(invocation.second.size() == 2u);
+                REQUIRE(invocation.second[0] == command_args);
+            }
+        }
+    }
+    GIVEN("a shell builtin") {
+        THEN("it should be run with the shell") {
+            auto invocation = command_invocation("cd /", directories);
+            REQUIRE(invocation.first == command_shell);
+            REQUIRE(invocation.second == vector<string>({ command_args, "cd /" }));
+        }
+    }
+    GIVEN("a program that is not found") {
+        THEN("it should be run with the shell") {
+            auto invocation = command_invocation("not_on_the_path 1", directories);
+            REQUIRE(invocation.first == command_shell);
+            REQUIRE(invocation.second == vector<string>({ command_args, "not_on_the_path 1" }));
+        }
+    }
+    GIVEN("a command run directly") {
+        THEN("its output should match the output when run with the shell") {
+            auto invocation = command_invocation("echo hello world");
+            REQUIRE(invocation.first != command_shell);
+            auto direct = execute(invocation.first, invocation.second);
+            auto shell = execute(command_shell, { command_args, "echo hello world" });
+            REQUIRE(direct.first);
+            REQUIRE(direct.second == shell.second);
+        }
+    }
+}
+
 SCENARIO("executing commands with execution::execute") {
     auto get_variables = [](std::string const& input) {
         map<string, string> variables;
@@ -152,6 +225,20 @@ SCENARIO("executing commands with execution::execute") {
                 REQUIRE(variables["LANG"] == "C");
             }
         }
+        WHEN("the environment changes between commands that merge it") {
+            auto before = get_variables(execute("env").second);
+            setenv("TEST_INHERITED_VARIABLE", "TEST_INHERITED_VALUE", 1);
+            auto during = get_variables(execute("env").second);
+            unsetenv("TEST_INHERITED_VARIABLE");
+            auto after = get_variables(execute("env").second);
+            THEN("each child should see the environment at the time it was started") {
+                REQUIRE(before.count("TEST_INHERITED_VARIABLE") == 0);
+                REQUIRE(during.count("TEST_INHERITED_VARIABLE") == 1);
+                REQUIRE(during["TEST_INHERITED_VARIABLE"] == "TEST_INHERITED_VALUE");
+                REQUIRE(after.count("TEST_INHERITED_VARIABLE") == 0);
+                REQUIRE(after["LC_ALL"] == "C");
+            }
+        }
         WHEN("requested to override the environment") {
             option_set<execution_options> options = { execution_options::defaults };
             options.clear(execution_options::merge_environment);
@@ -186,6 +273,16 @@ SCENARIO("executing commands with execution::execute") {
             }
         }
     }
+    GIVEN("a descriptor open in the parent") {
+        int descriptor = open(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt", O_RDONLY);
+        REQUIRE(descriptor > STDERR_FILENO);
+        auto result = execute("sh", { "-c", "test -e /dev/fd/" + to_string(descriptor) + " && echo open || echo closed" });
+        close(descriptor);
+        THEN("it should not be inherited by the child") {
+            REQUIRE(result.first);
+            REQUIRE(result.second == "closed");
+        }
+    }
     GIVEN("a command that fails") {
         WHEN("default options are used") {
             auto result = execute("ls", { "does_not_exist" });
@@ -368,3 +465,235 @@ SCENARIO("executing commands with execution::each_line") {
         }
     }
 }
+
+SCENARIO("executing commands with stdout and stderr captured separately") {
+    GIVEN("a command that writes to both") {
+        vector<string> output;
+        vector<string> errors;
+        bool success = each_line("sh", { "-c", "echo out1; echo err1 1>&2; echo out2; echo err2 1>&2" }, {}, [&](string& line) {
+            output.push_back(line);
+            return true;
+        }, [&](string& line) {
+            errors.push_back(line);
+            return true;
+        });
+        THEN("each line should be passed to the callback for its stream") {
+            REQUIRE(success);
+            REQUIRE(output == vector<string>({ "out1", "out2" }));
+            REQUIRE(errors == vector<string>({ "err1", "err2" }));
+        }
+    }
+    GIVEN("a command that is also requested to redirect stderr") {
+        vector<string> output;
+        vector<string> errors;
+        bool success = each_line("sh", { "-c", "echo out; echo err 1>&2" }, {}, [&](string& line) {
+            output.push_back(line);
+            return true;
+        }, [&](string& line) {
+            errors.push_back(line);
+            return true;
+        }, { execution_options::defaults, execution_options::redirect_stderr });
+        THEN("stderr should still be captured separately") {
+            REQUIRE(success);
+            REQUIRE(output == vector<string>({ "out" }));
+            REQUIRE(errors == vector<string>({ "err" }));
+        }
+    }
+    GIVEN("a command that fails") {
+        vector<string> errors;
+        bool success = each_line("ls", { "does_not_exist" }, {}, [&](string&) {
+            return true;
+        }, [&](string& line) {
+            errors.push_back(line);
+            return true;
+        });
+        THEN("the error output should be captured") {
+            REQUIRE_FALSE(success);
+            REQUIRE(errors.size() == 1);
+            REQUIRE(errors[0].find("does_not_exist") != string::npos);
+        }
+    }
+}
+
+SCENARIO("executing commands with large output") {
+    string script = "i=0; while [ $i -lt 20000 ]; do echo \"line $i\"; i=$((i+1)); done";
+    GIVEN("the output is returned") {
+        auto result = execute("sh", { "-c", script });
+        THEN("all of the output should be returned") {
+            REQUIRE(result.first);
+            vector<string> lines;
+            boost::split(lines, result.second, boost::is_any_of("\n"));
+            REQUIRE(lines.size() == 20000);
+            REQUIRE(lines.front() == "line 0");
+            REQUIRE(lines.back() == "line 19999");
+        }
+    }
+    GIVEN("each line of output is passed to a callback") {
+        size_t count = 0;
+        bool ordered = true;
+        bool success = each_line("sh", { "-c", script }, [&](string& line) {
+            ordered = ordered && line == "line " + to_string(count);
+            ++count;
+            return true;
+        });
+        THEN("every line should be passed in order") {
+            REQUIRE(success);
+            REQUIRE(ordered);
+            REQUIRE(count == 20000);
+        }
+    }
+    GIVEN("a single line longer than a read") {
+        auto result = execute("sh", { "-c", "head -c 300000 /dev/zero | tr '\\0' a" });
+        THEN("the line should be returned whole") {
+            REQUIRE(result.first);
+            REQUIRE(result.second == string(300000, 'a'));
+        }
+    }
+}
+
+SCENARIO("executing commands with a deadline") {
+    GIVEN("a deadline that has passed") {
+        scoped_deadline limiting(chrono::steady_clock::now() - chrono::seconds(1));
+        THEN("the command is not executed") {
+            REQUIRE_THROWS_AS(execute("echo", { "hello" }), deadline_exceeded_exception);
+        }
+    }
+    GIVEN("a command that runs past the deadline") {
+        auto start = chrono::steady_clock::now();
+        scoped_deadline limiting(start + chrono::milliseconds(200));
+        THEN("the command is killed at the deadline") {
+            REQUIRE_THROWS_AS(execute("sleep", { "10" }), deadline_exceeded_exception);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+        }
+    }
+    GIVEN("a command that finishes before the deadline") {
+        scoped_deadline limiting(chrono::steady_clock::now() + chrono::minutes(1));
+        THEN("the command runs normally") {
+            auto result = execute("echo", { "hello" });
+            REQUIRE(result.first);
+            REQUIRE(result.second == "hello");
+        }
+    }
+    GIVEN("a command that can be cancelled") {
+        atomic<bool> cancelled(true);
+        scoped_deadline limiting(chrono::steady_clock::time_point::max(), &cancelled);
+        THEN("the command is not executed once cancelled") {
+            REQUIRE_THROWS_AS(execute("echo", { "hello" }), deadline_exceeded_exception);
+        }
+    }
+}
+
+SCENARIO("executing commands with a timeout") {
+    option_set<execution_options> options = { execution_options::defaults };
+    GIVEN("a command that finishes before the timeout") {
+        auto result = execute("echo", { "hello" }, options, 10);
+        THEN("the output is returned") {
+            REQUIRE(result.first);
+            REQUIRE(result.second == "hello");
+        }
+    }
+    GIVEN("a command that runs past the timeout") {
+        auto start = chrono::steady_clock::now();
+        THEN("the command is killed at the timeout") {
+            REQUIRE_THROWS_AS(execute("sleep", { "10" }, options, 1), timeout_exception);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+        }
+    }
+    GIVEN("a command that starts a process that holds its output open") {
+        auto start = chrono::steady_clock::now();
+        THEN("the process it started is also killed") {
+            REQUIRE_THROWS_AS(execute("sh", { "-c", "sleep 10 & sleep 10" }, options, 1), timeout_exception);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+        }
+    }
+    GIVEN("a command that ignores SIGTERM") {
+        auto start = chrono::steady_clock::now();
+        THEN("the command is killed after the grace period") {
+            REQUIRE_THROWS_AS(each_line("sh", { "-c", "trap '' TERM; echo started; sleep 10" }, [](string&) { return true; }, options, 1), timeout_exception);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+        }
+    }
+}
+
+SCENARIO("executing commands with a command cache") {
+    command_cache cache;
+    scoped_command_cache memoizing(&cache);
+
+    GIVEN("a command executed more than once") {
+        auto first = execute("sh", { "-c", "echo $$" });
+        auto second = execute("sh", { "-c", "echo $$" });
+        THEN("the command should only run once") {
+            REQUIRE(first.first);
+            REQUIRE_FALSE(first.second.empty());
+            REQUIRE(second == first);
+        }
+        THEN("different arguments should run the command again") {
+            auto other = execute("sh", { "-c", "echo $$ " });
+            REQUIRE(other.first);
+            REQUIRE(other.second != first.second);
+        }
+        THEN("a command without the cache should run the command again") {
+            scoped_command_cache uncached(nullptr);
+            auto other = execute("sh", { "-c", "echo $$" });
+            REQUIRE(other.second != first.second);
+        }
+    }
+    GIVEN("a cached command executed with different options") {
+        auto untrimmed = execute("cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file1.txt" }, option_set<execution_options>({ execution_options::merge_environment }));
+        auto trimmed = execute("cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file1.txt" });
+        vector<string> lines;
+        each_line("cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file1.txt" }, [&](string& line) {
+            lines.push_back(line);
+            return true;
+        });
+        THEN("the options should be applied to the cached output") {
+            REQUIRE(untrimmed.second == "   this is a test of trimming   ");
+            REQUIRE(trimmed.second == "this is a test of trimming");
+            REQUIRE(lines == vector<string>({ "this is a test of trimming" }));
+        }
+    }
+    GIVEN("a cached command that fails") {
+        auto result = execute("ls", { "does_not_exist" });
+        THEN("the failure should be returned or thrown as requested") {
+            REQUIRE_FALSE(result.first);
+            REQUIRE_THROWS_AS(execute("ls", { "does_not_exist" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit })), child_exit_exception);
+        }
+    }
+}
+
+SCENARIO("processing a stream of output lines") {
+    // Lines are split across reads to exercise lines that are completed by a later read
+    string output = "  first line  \r\n\n   \nsecond line that is long enough to span a read\n\tthird\t\nlast";
+    auto process = [&](option_set<execution_options> const& options, size_t read_size) {
+        vector<string> lines;
+        size_t offset = 0;
+        process_stream([&](char* buffer, size_t& count) {
+            count = min(min(count, read_size), output.size() - offset);
+            copy(output.begin() + offset, output.begin() + offset + count, buffer);
+            offset += count;
+            return offset < output.size();
+        }, [&](string& line) {
+            lines.push_back(line);
+            return true;
+        }, options);
+        return lines;
+    };
+    WHEN("trimming output") {
+        THEN("each non-empty line should be trimmed") {
+            for (size_t read_size : { 1, 3, 7, 4096 }) {
+                CAPTURE(read_size);
+                REQUIRE(process({ execution_options::defaults }, read_size) == vector<string>({ "first line", "second line that is long enough to span a read", "third", "last" }));
+            }
+        }
+    }
+    WHEN("not trimming output") {
+        option_set<execution_options> options = { execution_options::defaults };
+        options.clear(execution_options::trim_output);
+        THEN("each non-empty line should be passed as is") {
+            for (size_t read_size : { 1, 3, 7, 4096 }) {
+                CAPTURE(read_size);
+                REQUIRE(process(options, read_size) == vector<string>({ "  first line  ", "   ", "second line that is long enough to span a read", "\tthird\t", "last" }));
+            }
+        }
+    }
+}
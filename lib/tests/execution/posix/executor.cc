@@ -0,0 +1,93 @@
+#include <catch.hpp>
+#include <internal/execution/executor.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include "../../fixtures.hpp"
+#include <chrono>
+#include <map>
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::execution;
+
+SCENARIO("executing commands concurrently with an executor") {
+    executor commands;
+
+    GIVEN("commands that succeed") {
+        map<string, string> outputs;
+        for (auto const& name : { "first", "second", "third" }) {
+            commands.add("sh", { "-c", string("sleep 1; echo ") + name }, [&, name](bool success, string& output) {
+                REQUIRE(success);
+                outputs[name] = output;
+            });
+        }
+        auto start = chrono::steady_clock::now();
+        commands.run();
+        THEN("each command's output should be passed to its callback") {
+            REQUIRE(outputs.size() == 3);
+            REQUIRE(outputs["first"] == "first");
+            REQUIRE(outputs["second"] == "second");
+            REQUIRE(outputs["third"] == "third");
+        }
+        THEN("the commands should run at the same time") {
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(3));
+        }
+    }
+    GIVEN("a command whose output is read a line at a time") {
+        vector<string> lines;
+        bool completed = false;
+        commands.each_line("cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt" }, [&](string& line) {
+            lines.push_back(line);
+            return true;
+        }, [&](bool success) {
+            completed = success;
+        });
+        commands.run();
+        THEN("each line should be passed to the callback") {
+            REQUIRE(lines == vector<string>({ "file3" }));
+            REQUIRE(completed);
+        }
+    }
+    GIVEN("more commands than the concurrency limit") {
+        executor limited(2);
+        int count = 0;
+        for (int i = 0; i < 5; ++i) {
+            limited.add("echo", { to_string(i) }, [&](bool success, string& output) {
+                REQUIRE(success);
+                ++count;
+            });
+        }
+        limited.run();
+        THEN("every command should still run") {
+            REQUIRE(count == 5);
+        }
+    }
+    GIVEN("commands that fail") {
+        bool missing_success = true;
+        bool failed_success = true;
+        commands.add("does_not_exist", {}, [&](bool success, string&) { missing_success = success; });
+        commands.add("ls", { "does_not_exist" }, [&](bool success, string&) { failed_success = success; });
+        commands.run();
+        THEN("they should be reported as failures") {
+            REQUIRE_FALSE(missing_success);
+            REQUIRE_FALSE(failed_success);
+        }
+    }
+    GIVEN("a command that throws on failure") {
+        bool other_completed = false;
+        commands.add("ls", { "does_not_exist" }, nullptr, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }));
+        commands.add("echo", { "hello" }, [&](bool success, string&) { other_completed = success; });
+        THEN("the exception should be thrown after the other commands complete") {
+            REQUIRE_THROWS_AS(commands.run(), child_exit_exception);
+            REQUIRE(other_completed);
+        }
+    }
+    GIVEN("a command that runs past the deadline") {
+        auto start = chrono::steady_clock::now();
+        scoped_deadline limiting(start + chrono::milliseconds(200));
+        commands.add("sleep", { "10" }, nullptr);
+        THEN("the command is killed at the deadline") {
+            REQUIRE_THROWS_AS(commands.run(), deadline_exceeded_exception);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+        }
+    }
+}
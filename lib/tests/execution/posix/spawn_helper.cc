@@ -0,0 +1,90 @@
+#include <catch.hpp>
+#include <facter/execution/execution.hpp>
+#include <internal/execution/executor.hpp>
+#include "../../fixtures.hpp"
+#include <chrono>
+#include <unistd.h>
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::execution;
+
+SCENARIO("executing commands with the spawn helper") {
+    REQUIRE(start_spawn_helper());
+
+    GIVEN("a command that succeeds") {
+        auto result = execute("sh", { "-c", "echo $PPID" });
+        THEN("it should be started by the helper") {
+            REQUIRE(result.first);
+            REQUIRE_FALSE(result.second.empty());
+            REQUIRE(result.second != to_string(getpid()));
+        }
+    }
+    GIVEN("a command that fails") {
+        THEN("its exit status should be reported") {
+            REQUIRE_FALSE(execute("sh", { "-c", "exit 3" }).first);
+            try {
+                execute("sh", { "-c", "exit 3" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }));
+                FAIL("expected the command to throw");
+            } catch (child_exit_exception& ex) {
+                REQUIRE(ex.status_code() == 3);
+            }
+        }
+    }
+    GIVEN("a command that is killed by a signal") {
+        THEN("the signal should be reported") {
+            REQUIRE_THROWS_AS(execute("sh", { "-c", "kill -9 $$" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_signal })), child_signal_exception);
+        }
+    }
+    GIVEN("a file that cannot be executed") {
+        THEN("the failure should be reported") {
+            REQUIRE_FALSE(execute(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/not_executable").first);
+        }
+    }
+    GIVEN("a command that writes to stdout and stderr") {
+        vector<string> output;
+        vector<string> errors;
+        bool success = each_line("sh", { "-c", "echo out; echo err 1>&2" }, {}, [&](string& line) {
+            output.push_back(line);
+            return true;
+        }, [&](string& line) {
+            errors.push_back(line);
+            return true;
+        });
+        THEN("both should be captured") {
+            REQUIRE(success);
+            REQUIRE(output == vector<string>({ "out" }));
+            REQUIRE(errors == vector<string>({ "err" }));
+        }
+    }
+    GIVEN("a command that runs past its timeout") {
+        auto start = chrono::steady_clock::now();
+        THEN("the command and the processes it started should be killed") {
+            REQUIRE_THROWS_AS(execute("sh", { "-c", "sleep 10 & sleep 10" }, option_set<execution_options>({ execution_options::defaults }), 1), timeout_exception);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+        }
+    }
+    GIVEN("commands executed concurrently") {
+        executor commands;
+        vector<string> outputs(4);
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            commands.add("sh", { "-c", "echo " + to_string(i) }, [&, i](bool success, string& output) {
+                REQUIRE(success);
+                outputs[i] = output;
+            });
+        }
+        commands.run();
+        THEN("each should complete") {
+            REQUIRE(outputs == vector<string>({ "0", "1", "2", "3" }));
+        }
+    }
+
+    stop_spawn_helper();
+    GIVEN("the helper was stopped") {
+        auto result = execute("sh", { "-c", "echo $PPID" });
+        THEN("commands should be started directly") {
+            REQUIRE(result.first);
+            REQUIRE(result.second == to_string(getpid()));
+        }
+    }
+}
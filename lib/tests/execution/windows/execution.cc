@@ -1,6 +1,7 @@
 #include <catch.hpp>
 #include <facter/execution/execution.hpp>
 #include <facter/util/string.hpp>
+#include <internal/execution/executor.hpp>
 #include <internal/util/windows/windows.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
@@ -320,3 +321,40 @@ SCENARIO("executing commands with execution::each_line") {
         }
     }
 }
+
+SCENARIO("executing commands concurrently with an executor") {
+    GIVEN("several commands") {
+        executor commands;
+        vector<string> outputs(4);
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            commands.add("cmd.exe", { "/c", "echo " + to_string(i) }, [&, i](bool success, string& output) {
+                REQUIRE(success);
+                outputs[i] = output;
+            });
+        }
+        commands.run();
+        THEN("the output of each should be passed to its callback") {
+            REQUIRE(outputs == vector<string>({ "0", "1", "2", "3" }));
+        }
+    }
+    GIVEN("a command that fails") {
+        executor commands;
+        bool called = false;
+        commands.add("cmd.exe", { "/c", "exit 3" }, [&](bool success, string& output) {
+            REQUIRE_FALSE(success);
+            called = true;
+        });
+        commands.run();
+        THEN("its failure should be reported") {
+            REQUIRE(called);
+        }
+    }
+}
+
+SCENARIO("executing commands with a timeout") {
+    GIVEN("a command that starts a process that runs past the timeout") {
+        THEN("the command and the process it started should be terminated") {
+            REQUIRE_THROWS_AS(execute("cmd.exe", { "/c", "ping -n 10 127.0.0.1 > NUL" }, option_set<execution_options>({ execution_options::defaults }), 1), timeout_exception);
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include <catch.hpp>
 #include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
@@ -137,4 +139,52 @@ SCENARIO("using an array fact value") {
             REQUIRE(index == 1);
         }
     }
+    GIVEN("arrays to compare") {
+        value.add(make_value<string_value>("1"));
+        value.add(make_value<integer_value>(2));
+        array_value other;
+        other.add(make_value<string_value>("1"));
+        THEN("arrays with different sizes should not be equal") {
+            REQUIRE_FALSE(value.equals(other));
+        }
+        THEN("arrays with the same elements in the same order should be equal") {
+            other.add(make_value<integer_value>(2));
+            REQUIRE(value.equals(other));
+        }
+        THEN("arrays with elements of different types should not be equal") {
+            other.add(make_value<string_value>("2"));
+            REQUIRE_FALSE(value.equals(other));
+            REQUIRE(value.hash() != other.hash());
+        }
+        THEN("arrays with the same elements in a different order should not have the same hash") {
+            array_value reversed;
+            reversed.add(make_value<integer_value>(2));
+            reversed.add(make_value<string_value>("1"));
+            other.add(make_value<integer_value>(2));
+            REQUIRE(value.hash() == other.hash());
+            REQUIRE(value.hash() != reversed.hash());
+        }
+    }
+    GIVEN("an array to clone") {
+        value.add(make_value<string_value>("1"));
+        auto hash = make_value<map_value>();
+        hash->add("foo", make_value<integer_value>(2));
+        value.add(move(hash));
+        value.add(make_value<lazy_value>([]() {
+            return make_value<string_value>("lazy");
+        }));
+        REQUIRE(value.deferred());
+        auto copy = value.clone();
+        THEN("the copy should be an equal array that shares elements that are not lazy") {
+            auto array = dynamic_cast<array_value const*>(copy.get());
+            REQUIRE(array);
+            REQUIRE(array->equals(value));
+            REQUIRE(array->hash() == value.hash());
+            REQUIRE_FALSE(array->deferred());
+            REQUIRE(array->get<map_value>(1) == value.get<map_value>(1));
+            REQUIRE(array->share(1) == value.share(1));
+            REQUIRE(array->share(2) != value.share(2));
+            REQUIRE(array->get<string_value>(2)->value() == "lazy");
+        }
+    }
 }
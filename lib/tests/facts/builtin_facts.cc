@@ -0,0 +1,41 @@
+#include <catch.hpp>
+#include <facter/facts/fact.hpp>
+#include <internal/facts/builtin_facts.hpp>
+#include <set>
+
+using namespace std;
+using namespace facter::facts;
+
+SCENARIO("identifying built-in fact names") {
+    GIVEN("every built-in fact name") {
+        THEN("each name should have a distinct id that maps back to the name") {
+            set<string> names;
+            for (size_t id = 0; id < builtin_fact_count(); ++id) {
+                string name = builtin_fact_name(id);
+                REQUIRE(builtin_fact_id(name) == id);
+                REQUIRE(names.insert(name).second);
+            }
+            REQUIRE(builtin_fact_name(builtin_fact_count()) == nullptr);
+        }
+    }
+    GIVEN("the fact name constants") {
+        THEN("they should be built-in") {
+            REQUIRE(builtin_fact_id(string(fact::kernel)) != no_builtin_fact);
+            REQUIRE(builtin_fact_id(string(fact::networking)) != no_builtin_fact);
+            REQUIRE(builtin_fact_id(string(fact::ssh_ed25519_key)) != no_builtin_fact);
+            REQUIRE(builtin_fact_id(string(fact::utilization)) != no_builtin_fact);
+            REQUIRE(string(builtin_fact_name(builtin_fact_id(string(fact::os)))) == string(fact::os));
+        }
+    }
+    GIVEN("names that are not built-in") {
+        THEN("they should not have an id") {
+            REQUIRE(builtin_fact_id("") == no_builtin_fact);
+            REQUIRE(builtin_fact_id("foo") == no_builtin_fact);
+            REQUIRE(builtin_fact_id("Kernel") == no_builtin_fact);
+            REQUIRE(builtin_fact_id("kernel ") == no_builtin_fact);
+            REQUIRE(builtin_fact_id("ipaddress_eth0") == no_builtin_fact);
+            REQUIRE(builtin_fact_id("brand") == no_builtin_fact);
+            REQUIRE(builtin_fact_id(string("kernel\0x", 8)) == no_builtin_fact);
+        }
+    }
+}
@@ -0,0 +1,497 @@
+#include <catch.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/resolver.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/util/file.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <sstream>
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::util;
+namespace fs = boost::filesystem;
+
+struct counting_resolver : facter::facts::resolver
+{
+    explicit counting_resolver(int& count) :
+        resolver("counting", { "counted", "structured", "secret" }),
+        _count(count)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        ++_count;
+        facts.add("counted", make_value<integer_value>(_count));
+
+        auto structured = make_value<map_value>();
+        structured->add("string", make_value<string_value>("value"));
+        structured->add("boolean", make_value<boolean_value>(true));
+        structured->add("whole", make_value<double_value>(1.0));
+        structured->add("precise", make_value<double_value>(0.1 + 0.2));
+        auto array = make_value<array_value>();
+        array->add(make_value<integer_value>(1));
+        array->add(make_value<string_value>("two"));
+        structured->add("array", move(array));
+        facts.add("structured", move(structured));
+
+        facts.add("secret", make_value<string_value>("hidden", true));
+    }
+
+    int& _count;
+};
+
+struct scoped_resolver : facter::facts::resolver
+{
+    explicit scoped_resolver(int& count) :
+        resolver("scoped", { "scoped" }),
+        _count(count)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        ++_count;
+        auto scoped = make_value<map_value>();
+        for (auto const& name : { "first", "second" }) {
+            if (facts.is_queried(string("scoped.") + name)) {
+                scoped->add(name, make_value<string_value>(name));
+            }
+        }
+        facts.add("scoped", move(scoped));
+    }
+
+    int& _count;
+};
+
+struct unavailable_resolver : facter::facts::resolver
+{
+    explicit unavailable_resolver(int& count) :
+        resolver("unavailable", { "probed" }),
+        _count(count)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        ++_count;
+        facts.unavailable(*this);
+    }
+
+    int& _count;
+};
+
+struct stable_resolver : facter::facts::resolver
+{
+    explicit stable_resolver(int& count) :
+        resolver("stable", { "stable" }),
+        _count(count)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        ++_count;
+        facts.add("stable", make_value<string_value>("unchanged"));
+    }
+
+    int& _count;
+};
+
+struct boot_resolver : facter::facts::resolver
+{
+    // Named after a resolver whose facts do not change until the host is rebooted
+    explicit boot_resolver(int& count) :
+        resolver("processor", { "primed" }),
+        _count(count)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        ++_count;
+        facts.add("primed", make_value<integer_value>(_count));
+    }
+
+    int& _count;
+};
+
+struct temp_cache_file
+{
+    temp_cache_file() :
+        _path((fs::temp_directory_path() / fs::unique_path("facter-cache-%%%%-%%%%") / "facts.json").string())
+    {
+    }
+
+    ~temp_cache_file()
+    {
+        boost::system::error_code ec;
+        fs::remove_all(fs::path(_path).parent_path(), ec);
+    }
+
+    string _path;
+};
+
+// Moves the timestamp of a resolver's cached facts back and returns their adapted TTL, or -1 if they have none
+static int64_t age_cached_facts(string const& path, string const& name, int64_t seconds)
+{
+    rapidjson::Document document;
+    document.Parse<0>(file::read(path).c_str());
+    auto& entry = document["resolvers"][name.c_str()];
+    entry["timestamp"].SetInt64(entry["timestamp"].GetInt64() - seconds);
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    document.Accept(writer);
+    boost::nowide::ofstream out(path.c_str());
+    out << buffer.GetString();
+    return entry.HasMember("ttl") ? entry["ttl"].GetInt64() : -1;
+}
+
+SCENARIO("caching facts") {
+    temp_cache_file cache_file;
+    int count = 0;
+
+    GIVEN("a resolver with a TTL") {
+        {
+            collection facts;
+            facts.cache(cache_file._path, { { "counting", chrono::seconds(3600) } });
+            facts.add(make_shared<counting_resolver>(count));
+            REQUIRE(facts.size() == 3);
+        }
+        THEN("the cache file should be written") {
+            REQUIRE(count == 1);
+            REQUIRE(fs::exists(cache_file._path));
+        }
+        WHEN("the facts are resolved again") {
+            collection facts;
+            facts.cache(cache_file._path, { { "counting", chrono::seconds(3600) } });
+            facts.add(make_shared<counting_resolver>(count));
+            REQUIRE(facts.size() == 3);
+            THEN("the facts should be loaded from the cache") {
+                REQUIRE(count == 1);
+                auto counted = facts.get<integer_value>("counted");
+                REQUIRE(counted);
+                REQUIRE(counted->value() == 1);
+            }
+            THEN("structured facts should be preserved") {
+                auto structured = facts.get<map_value>("structured");
+                REQUIRE(structured);
+                auto str = structured->get<string_value>("string");
+                REQUIRE(str);
+                REQUIRE(str->value() == "value");
+                auto boolean = structured->get<boolean_value>("boolean");
+                REQUIRE(boolean);
+                REQUIRE(boolean->value());
+                auto whole = structured->get<double_value>("whole");
+                REQUIRE(whole);
+                REQUIRE(whole->value() == 1.0);
+                auto precise = structured->get<double_value>("precise");
+                REQUIRE(precise);
+                REQUIRE(precise->value() == 0.1 + 0.2);
+                auto array = structured->get<array_value>("array");
+                REQUIRE(array);
+                REQUIRE(array->size() == 2);
+                auto element = array->get<string_value>(1);
+                REQUIRE(element);
+                REQUIRE(element->value() == "two");
+            }
+            THEN("hidden facts should remain hidden") {
+                auto secret = facts.get<string_value>("secret");
+                REQUIRE(secret);
+                REQUIRE(secret->hidden());
+                REQUIRE(secret->value() == "hidden");
+            }
+        }
+        WHEN("the cached facts have expired") {
+            collection facts;
+            facts.cache(cache_file._path, { { "counting", chrono::seconds(0) } });
+            facts.add(make_shared<counting_resolver>(count));
+            REQUIRE(facts.size() == 3);
+            THEN("the resolver should be resolved again") {
+                REQUIRE(count == 2);
+                auto counted = facts.get<integer_value>("counted");
+                REQUIRE(counted);
+                REQUIRE(counted->value() == 2);
+            }
+        }
+    }
+    GIVEN("a resolver with a TTL that is resolved for a query") {
+        {
+            collection facts;
+            facts.cache(cache_file._path, { { "scoped", chrono::seconds(3600) } });
+            facts.add(make_shared<scoped_resolver>(count));
+            facts.resolve({ "scoped.first" });
+            REQUIRE(count == 1);
+        }
+        THEN("its facts should not be cached") {
+            collection facts;
+            facts.cache(cache_file._path, { { "scoped", chrono::seconds(3600) } });
+            facts.add(make_shared<scoped_resolver>(count));
+            auto second = facts.query<string_value>("scoped.second");
+            REQUIRE(second);
+            REQUIRE(second->value() == "second");
+            REQUIRE(count == 2);
+        }
+    }
+    GIVEN("a resolver without a TTL") {
+        for (int i = 0; i < 2; ++i) {
+            collection facts;
+            facts.cache(cache_file._path, { { "other", chrono::seconds(3600) } });
+            facts.add(make_shared<counting_resolver>(count));
+            REQUIRE(facts.size() == 3);
+        }
+        THEN("the resolver should be resolved every time") {
+            REQUIRE(count == 2);
+        }
+    }
+    GIVEN("a resolver with a maximum TTL") {
+        auto resolve = [&](shared_ptr<resolver> res) {
+            collection facts;
+            facts.cache(cache_file._path, { { "stable", chrono::seconds(10) }, { "counting", chrono::seconds(10) } }, chrono::seconds(0), chrono::seconds(60));
+            facts.add(move(res));
+            facts.size();
+        };
+        WHEN("the facts do not change when they expire") {
+            resolve(make_shared<stable_resolver>(count));
+            vector<int64_t> ttls;
+            for (int i = 0; i < 4; ++i) {
+                ttls.push_back(age_cached_facts(cache_file._path, "stable", 1000));
+                resolve(make_shared<stable_resolver>(count));
+            }
+            ttls.push_back(age_cached_facts(cache_file._path, "stable", 0));
+            THEN("their TTL should double up to the maximum") {
+                REQUIRE(count == 5);
+                REQUIRE(ttls == (vector<int64_t>{ 10, 20, 40, 60, 60 }));
+            }
+            THEN("they should be loaded from the cache until the stretched TTL expires") {
+                age_cached_facts(cache_file._path, "stable", 30);
+                resolve(make_shared<stable_resolver>(count));
+                REQUIRE(count == 5);
+                age_cached_facts(cache_file._path, "stable", 30);
+                resolve(make_shared<stable_resolver>(count));
+                REQUIRE(count == 6);
+            }
+        }
+        WHEN("the facts change when they expire") {
+            resolve(make_shared<counting_resolver>(count));
+            vector<int64_t> ttls;
+            for (int i = 0; i < 3; ++i) {
+                ttls.push_back(age_cached_facts(cache_file._path, "counting", 1000));
+                resolve(make_shared<counting_resolver>(count));
+            }
+            THEN("their TTL should stay at the resolver's TTL") {
+                REQUIRE(count == 4);
+                REQUIRE(ttls == (vector<int64_t>{ 10, 10, 10 }));
+            }
+        }
+    }
+    GIVEN("facts primed at boot") {
+        // Priming requires an identifier of the current boot
+        bool primed = fs::exists("/proc/sys/kernel/random/boot_id");
+        {
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add(make_shared<boot_resolver>(count));
+            facts.add(make_shared<counting_resolver>(count));
+            facts.prime_cache();
+        }
+        THEN("only the facts that do not change until reboot should be resolved") {
+            REQUIRE(count == (primed ? 1 : 0));
+        }
+        WHEN("the facts are resolved again without a TTL") {
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add(make_shared<boot_resolver>(count));
+            REQUIRE(facts.size() == 1);
+            THEN("the primed facts should be loaded from the cache") {
+                REQUIRE(count == 1);
+                auto value = facts.get<integer_value>("primed");
+                REQUIRE(value);
+                REQUIRE(value->value() == 1);
+            }
+        }
+        WHEN("the facts are resolved again with an expired TTL") {
+            collection facts;
+            facts.cache(cache_file._path, { { "processor", chrono::seconds(0) } });
+            facts.add(make_shared<boot_resolver>(count));
+            REQUIRE(facts.size() == 1);
+            THEN("the primed facts should be loaded from the cache") {
+                REQUIRE(count == 1);
+            }
+        }
+        WHEN("the host was rebooted since the facts were primed") {
+            if (primed) {
+                auto contents = boost::replace_all_copy(file::read(cache_file._path), "\"boot_id\":\"", "\"boot_id\":\"previous-");
+                boost::nowide::ofstream out(cache_file._path.c_str());
+                out << contents;
+            }
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add(make_shared<boot_resolver>(count));
+            REQUIRE(facts.size() == 1);
+            THEN("the resolver should be resolved again") {
+                REQUIRE(count == (primed ? 2 : 1));
+            }
+        }
+    }
+    GIVEN("an invalid cache file") {
+        fs::create_directories(fs::path(cache_file._path).parent_path());
+        {
+            boost::nowide::ofstream out(cache_file._path.c_str());
+            out << "not json";
+        }
+        collection facts;
+        facts.cache(cache_file._path, { { "counting", chrono::seconds(3600) } });
+        facts.add(make_shared<counting_resolver>(count));
+        THEN("the cache should be discarded and the resolver resolved") {
+            REQUIRE(facts.size() == 3);
+            REQUIRE(count == 1);
+            REQUIRE(file::read(cache_file._path) != "not json");
+        }
+    }
+    GIVEN("a resolver whose facts are unavailable") {
+        {
+            collection facts;
+            facts.cache(cache_file._path, {}, chrono::seconds(3600));
+            facts.add(make_shared<unavailable_resolver>(count));
+            REQUIRE(facts.size() == 0);
+        }
+        WHEN("the facts are resolved again") {
+            collection facts;
+            facts.cache(cache_file._path, {}, chrono::seconds(3600));
+            facts.add(make_shared<unavailable_resolver>(count));
+            REQUIRE(facts.size() == 0);
+            THEN("the resolver should not be resolved again") {
+                REQUIRE(count == 1);
+            }
+        }
+        WHEN("the host was rebooted since the record was stored") {
+            {
+                auto contents = boost::replace_all_copy(file::read(cache_file._path), "\"boot_id\":\"", "\"boot_id\":\"previous-");
+                boost::nowide::ofstream out(cache_file._path.c_str());
+                out << contents;
+            }
+            collection facts;
+            facts.cache(cache_file._path, {}, chrono::seconds(3600));
+            facts.add(make_shared<unavailable_resolver>(count));
+            REQUIRE(facts.size() == 0);
+            THEN("the resolver should be resolved again") {
+                REQUIRE(count == 2);
+            }
+        }
+        WHEN("unavailable facts are not recorded") {
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add(make_shared<unavailable_resolver>(count));
+            REQUIRE(facts.size() == 0);
+            THEN("the resolver should be resolved again") {
+                REQUIRE(count == 2);
+            }
+        }
+    }
+    GIVEN("an external fact file") {
+        auto directory = fs::path(cache_file._path).parent_path() / "facts.d";
+        fs::create_directories(directory);
+        auto external = (directory / "external.txt").string();
+        {
+            boost::nowide::ofstream out(external.c_str());
+            out << "external_fact=original\n";
+        }
+        {
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add_external_facts({ directory.string() });
+            REQUIRE(facts.size() == 1);
+        }
+        // Alter the cached value so that loading it can be told apart from resolving the file
+        {
+            auto contents = boost::replace_all_copy(file::read(cache_file._path), "[\"external_fact\",\"original\"]", "[\"external_fact\",\"cached\"]");
+            boost::nowide::ofstream out(cache_file._path.c_str());
+            out << contents;
+        }
+        WHEN("the file has not changed") {
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add_external_facts({ directory.string() });
+            THEN("the facts should be loaded from the cache") {
+                auto fact = facts.get<string_value>("external_fact");
+                REQUIRE(fact);
+                REQUIRE(fact->value() == "cached");
+            }
+        }
+        WHEN("another file provides the same fact") {
+            {
+                boost::nowide::ofstream out((directory / "later.txt").string().c_str());
+                out << "external_fact=later\nlater_fact=value\n";
+            }
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add_external_facts({ directory.string() });
+            THEN("the value of the last file should be kept") {
+                auto fact = facts.get<string_value>("external_fact");
+                REQUIRE(fact);
+                REQUIRE(fact->value() == "later");
+                REQUIRE(facts.get<string_value>("later_fact"));
+            }
+        }
+        WHEN("the file has changed") {
+            {
+                boost::nowide::ofstream out(external.c_str());
+                out << "external_fact=changed\n";
+            }
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add_external_facts({ directory.string() });
+            THEN("the file should be resolved again") {
+                auto fact = facts.get<string_value>("external_fact");
+                REQUIRE(fact);
+                REQUIRE(fact->value() == "changed");
+            }
+        }
+        WHEN("the file was removed") {
+            fs::remove(external);
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add_external_facts({ directory.string() });
+            THEN("its cached facts should be discarded") {
+                REQUIRE(facts.size() == 0);
+                REQUIRE(file::read(cache_file._path).find("external.txt") == string::npos);
+            }
+        }
+    }
+    GIVEN("facts compared with the last run") {
+        auto changes = [&](int counted, bool unchanged) {
+            collection facts;
+            facts.cache(cache_file._path, {});
+            facts.add("counted", make_value<integer_value>(counted));
+            auto structured = make_value<map_value>();
+            structured->add("string", make_value<string_value>("value"));
+            facts.add("structured", move(structured));
+            if (unchanged) {
+                facts.add("unchanged", make_value<string_value>("value"));
+            }
+            facts.add("secret", make_value<string_value>("hidden", true));
+            ostringstream output;
+            facts.write_changes(output, format::json_compact);
+            return output.str();
+        };
+        THEN("every fact should be added on the first run") {
+            REQUIRE(changes(1, true) == R"({"added":{"counted":1,"structured":{"string":"value"},"unchanged":"value"},"changed":{},"removed":[]})");
+        }
+        WHEN("the facts change") {
+            changes(1, true);
+            THEN("only the changes should be written") {
+                REQUIRE(changes(2, false) == R"({"added":{},"changed":{"counted":2},"removed":["unchanged"]})");
+                REQUIRE(changes(2, false) == R"({"added":{},"changed":{},"removed":[]})");
+                REQUIRE(changes(2, true) == R"({"added":{"unchanged":"value"},"changed":{},"removed":[]})");
+            }
+        }
+    }
+}
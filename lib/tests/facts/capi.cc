@@ -0,0 +1,154 @@
+#include <catch.hpp>
+#include <facter/facts/capi.h>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace facter::facts;
+
+struct capi_resolver : resolver
+{
+    capi_resolver() :
+        resolver("capi", { "os", "models", "count", "lazy" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        auto os = make_value<map_value>();
+        os->add("name", make_value<string_value>("Linux"));
+        os->add("virtual", make_value<boolean_value>(true));
+        os->add("load", make_value<double_value>(0.5));
+        facts.add("os", move(os));
+
+        auto models = make_value<array_value>();
+        models->add(make_value<string_value>("first"));
+        models->add(make_value<string_value>("second"));
+        facts.add("models", move(models));
+
+        facts.add("count", make_value<integer_value>(42));
+        facts.add("lazy", make_value<lazy_value>([]() { return make_value<string_value>("computed"); }));
+    }
+};
+
+static string get_string(facter_value const* val)
+{
+    char const* data = nullptr;
+    size_t length = 0;
+    REQUIRE(facter_value_get_string(val, &data, &length) == 0);
+    return string(data, length);
+}
+
+SCENARIO("using the C API") {
+    auto facts = facter_collection_new();
+    REQUIRE(facts);
+    reinterpret_cast<collection*>(facts)->add(make_shared<capi_resolver>());
+
+    GIVEN("a query of a string value") {
+        auto name = facter_collection_query(facts, "os.name");
+        THEN("the string should be borrowed from the value") {
+            REQUIRE(facter_value_get_type(name) == FACTER_VALUE_STRING);
+            char const* data = nullptr;
+            size_t length = 0;
+            REQUIRE(facter_value_get_string(name, &data, &length) == 0);
+            REQUIRE(string(data, length) == "Linux");
+            auto str = reinterpret_cast<collection*>(facts)->query<string_value>("os.name");
+            REQUIRE(data == str->value().c_str());
+        }
+    }
+    GIVEN("queries of scalar values") {
+        THEN("their values should be returned") {
+            int64_t count = 0;
+            REQUIRE(facter_value_get_integer(facter_collection_query(facts, "count"), &count) == 0);
+            REQUIRE(count == 42);
+            int is_virtual = 0;
+            REQUIRE(facter_value_get_boolean(facter_collection_query(facts, "os.virtual"), &is_virtual) == 0);
+            REQUIRE(is_virtual != 0);
+            double load = 0;
+            REQUIRE(facter_value_get_double(facter_collection_query(facts, "os.load"), &load) == 0);
+            REQUIRE(load == Approx(0.5));
+        }
+    }
+    GIVEN("a value of the wrong type") {
+        THEN("getting it should fail with a message") {
+            int64_t count = 0;
+            REQUIRE(facter_value_get_integer(facter_collection_query(facts, "os.name"), &count) != 0);
+            REQUIRE(string(facter_last_error()) == "the value is not an integer.");
+        }
+    }
+    GIVEN("a lazy value") {
+        THEN("the computed value should be returned") {
+            REQUIRE(get_string(facter_collection_query(facts, "lazy")) == "computed");
+        }
+    }
+    GIVEN("a lazy value whose computation throws") {
+        reinterpret_cast<collection*>(facts)->add("failing", make_value<lazy_value>([]() -> unique_ptr<value> { throw 42; }));
+        THEN("the failure should be returned instead of crossing the C boundary") {
+            REQUIRE_FALSE(facter_collection_query(facts, "failing"));
+            REQUIRE(string(facter_last_error()) == "an unknown error occurred.");
+        }
+    }
+    GIVEN("a query that selects nothing") {
+        THEN("no value should be returned") {
+            REQUIRE_FALSE(facter_collection_query(facts, "os.release"));
+            REQUIRE_FALSE(facter_collection_query(facts, "missing"));
+            REQUIRE(facter_value_get_type(nullptr) == FACTER_VALUE_OTHER);
+        }
+    }
+    GIVEN("an array value") {
+        auto models = facter_collection_query(facts, "models");
+        THEN("its elements should be accessible by index and by enumeration") {
+            REQUIRE(facter_value_get_type(models) == FACTER_VALUE_ARRAY);
+            REQUIRE(facter_value_size(models) == 2u);
+            REQUIRE(get_string(facter_value_array_get(models, 1)) == "second");
+            REQUIRE_FALSE(facter_value_array_get(models, 2));
+            vector<string> elements;
+            REQUIRE(facter_value_array_each(models, [](void* context, facter_value const* val) {
+                reinterpret_cast<vector<string>*>(context)->push_back(get_string(val));
+                return 1;
+            }, &elements) == 0);
+            REQUIRE(elements == vector<string>({ "first", "second" }));
+        }
+    }
+    GIVEN("a map value") {
+        auto os = facter_collection_query(facts, "os");
+        THEN("its elements should be accessible by name and by enumeration") {
+            REQUIRE(facter_value_get_type(os) == FACTER_VALUE_MAP);
+            REQUIRE(facter_value_size(os) == 3u);
+            REQUIRE(get_string(facter_value_map_get(os, "name")) == "Linux");
+            REQUIRE_FALSE(facter_value_map_get(os, "missing"));
+            vector<string> names;
+            REQUIRE(facter_value_map_each(os, [](void* context, char const* name, size_t length, facter_value const*) {
+                reinterpret_cast<vector<string>*>(context)->emplace_back(name, length);
+                return 1;
+            }, &names) == 0);
+            REQUIRE(names == vector<string>({ "load", "name", "virtual" }));
+        }
+    }
+    GIVEN("an enumeration of the collection") {
+        REQUIRE(facter_collection_add_string(facts, "added", "value") == 0);
+        THEN("every fact should be enumerated until the callback stops it") {
+            map<string, facter_value_type> types;
+            REQUIRE(facter_collection_each(facts, [](void* context, char const* name, size_t length, facter_value const* val) {
+                (*reinterpret_cast<map<string, facter_value_type>*>(context))[string(name, length)] = facter_value_get_type(val);
+                return 1;
+            }, &types) == 0);
+            REQUIRE(types.size() == 5u);
+            REQUIRE(types["added"] == FACTER_VALUE_STRING);
+            REQUIRE(types["lazy"] == FACTER_VALUE_STRING);
+            size_t count = 0;
+            REQUIRE(facter_collection_each(facts, [](void* context, char const*, size_t, facter_value const*) {
+                ++*reinterpret_cast<size_t*>(context);
+                return 0;
+            }, &count) == 0);
+            REQUIRE(count == 1u);
+        }
+    }
+    facter_collection_free(facts);
+}
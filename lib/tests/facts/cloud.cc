@@ -0,0 +1,98 @@
+#include <catch.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <internal/facts/cloud.hpp>
+#include <internal/util/scoped_root.hpp>
+#include "../fixtures.hpp"
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::util;
+
+SCENARIO("detecting the cloud platform") {
+    string fixtures = LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/cloud/";
+    GIVEN("a Nitro EC2 instance") {
+        scoped_root root(fixtures + "nitro");
+        THEN("EC2 should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::ec2);
+        }
+    }
+    GIVEN("a Xen EC2 instance") {
+        scoped_root root(fixtures + "xen");
+        THEN("EC2 should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::ec2);
+        }
+    }
+    GIVEN("an OpenStack instance") {
+        scoped_root root(fixtures + "openstack");
+        THEN("OpenStack should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::openstack);
+        }
+    }
+    GIVEN("a GCE instance") {
+        scoped_root root(fixtures + "gce");
+        THEN("GCE should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::gce);
+        }
+    }
+    GIVEN("an Azure virtual machine") {
+        scoped_root root(fixtures + "azure");
+        THEN("Azure should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::azure);
+        }
+    }
+    GIVEN("a Hyper-V virtual machine outside of Azure") {
+        scoped_root root(fixtures + "hyperv");
+        THEN("no cloud platform should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::none);
+        }
+    }
+    GIVEN("a DigitalOcean droplet") {
+        scoped_root root(fixtures + "digitalocean");
+        THEN("DigitalOcean should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::digitalocean);
+        }
+    }
+    GIVEN("a physical machine") {
+        scoped_root root(fixtures + "bare");
+        THEN("no cloud platform should be detected") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::none);
+        }
+    }
+    GIVEN("a machine without DMI information") {
+        scoped_root root(fixtures + "missing");
+        THEN("the platform should be unknown") {
+            REQUIRE(detect_cloud_platform() == cloud_platform::unknown);
+        }
+    }
+}
+
+SCENARIO("parsing metadata documents") {
+    GIVEN("a JSON object") {
+        auto metadata = parse_metadata("{ \"compute\": { \"location\": \"westus2\", \"tags\": [ \"a\", \"b\" ] }, \"id\": 1234 }");
+        THEN("it should be converted to a map value") {
+            REQUIRE(metadata);
+            auto compute = metadata->get<map_value>("compute");
+            REQUIRE(compute);
+            auto location = compute->get<string_value>("location");
+            REQUIRE(location);
+            REQUIRE(location->value() == "westus2");
+            auto tags = compute->get<array_value>("tags");
+            REQUIRE(tags);
+            REQUIRE(tags->size() == 2u);
+            auto id = metadata->get<integer_value>("id");
+            REQUIRE(id);
+            REQUIRE(id->value() == 1234);
+        }
+    }
+    GIVEN("a JSON document that isn't an object") {
+        THEN("nothing should be returned") {
+            REQUIRE_FALSE(parse_metadata("[ 1, 2 ]"));
+        }
+    }
+    GIVEN("a malformed JSON document") {
+        THEN("nothing should be returned") {
+            REQUIRE_FALSE(parse_metadata("{ \"id\": "));
+        }
+    }
+}
@@ -5,6 +5,11 @@
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/util/environment.hpp>
+#include <facter/util/file.hpp>
+#include <internal/util/thread_pool.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
 #include "../fixtures.hpp"
 #include <sstream>
 
@@ -37,6 +42,95 @@ struct multi_resolver : facter::facts::resolver
     }
 };
 
+struct override_resolver : facter::facts::resolver
+{
+    override_resolver() : resolver("override", { "foo" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        facts.add("foo", make_value<string_value>("baz"));
+    }
+};
+
+struct dependent_resolver : facter::facts::resolver
+{
+    dependent_resolver() : resolver("dependent", { "dependent" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        auto foo = facts.get<string_value>("foo");
+        facts.add("dependent", make_value<string_value>(foo ? foo->value() + "!" : "missing"));
+    }
+};
+
+struct ordered_resolver : facter::facts::resolver
+{
+    ordered_resolver(string name, string fact, vector<string> dependencies, vector<string>& order) :
+        resolver(move(name), { fact }, {}, move(dependencies)),
+        _order(order)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        _order.push_back(name());
+        string value;
+        for (auto const& dependency : dependencies()) {
+            auto fact = facts.get<string_value>(dependency);
+            value += fact ? fact->value() : "missing";
+        }
+        facts.add(string(names().front()), make_value<string_value>(value + names().front()));
+    }
+
+    vector<string>& _order;
+};
+
+struct incrementing_resolver : facter::facts::resolver
+{
+    incrementing_resolver(string name, string fact, int& count) :
+        resolver(move(name), { fact }),
+        _count(count)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        ++_count;
+        facts.add(string(names().front()), make_value<integer_value>(_count));
+    }
+
+    int& _count;
+};
+
+struct expensive_resolver : incrementing_resolver
+{
+    expensive_resolver(string name, string fact, int& count) :
+        incrementing_resolver(move(name), move(fact), count)
+    {
+    }
+
+    virtual bool is_expensive() const override
+    {
+        return true;
+    }
+};
+
+struct rooted_resolver : facter::facts::resolver
+{
+    rooted_resolver() : resolver("rooted", { "motd" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        facts.add("motd", make_value<string_value>(boost::trim_copy(file::read("/etc/motd"))));
+    }
+};
+
 struct temp_variable
 {
     temp_variable(string name, string const& value) :
@@ -78,6 +172,21 @@ SCENARIO("using the fact collection") {
             REQUIRE(fact->value() == "bar");
         }
     }
+    GIVEN("a fact with a built-in name") {
+        facts.add("kernel", make_value<string_value>("foo"));
+        THEN("it should be found, replaced, and removed") {
+            REQUIRE(facts.get<string_value>("kernel")->value() == "foo");
+            facts.add("kernel", make_value<string_value>("bar"));
+            REQUIRE(facts.size() == 1);
+            REQUIRE(facts.get<string_value>("kernel")->value() == "bar");
+            facts.remove("kernel");
+            REQUIRE_FALSE(facts["kernel"]);
+            REQUIRE(facts.empty());
+            facts.add("kernel", make_value<string_value>("baz"));
+            collection moved(std::move(facts));
+            REQUIRE(moved.get<string_value>("kernel")->value() == "baz");
+        }
+    }
     GIVEN("a resolver that adds a single fact") {
         facts.add(make_shared<simple_resolver>());
         THEN("it should resolve facts into the collection") {
@@ -148,6 +257,20 @@ SCENARIO("using the fact collection") {
                 REQUIRE(ss.str() == "{\n  \"bar\": \"foo\",\n  \"foo\": \"bar\"\n}");
             }
         }
+        WHEN("serializing to compact JSON") {
+            THEN("it should contain the same values without whitespace") {
+                ostringstream ss;
+                facts.write(ss, format::json_compact);
+                REQUIRE(ss.str() == "{\"bar\":\"foo\",\"foo\":\"bar\"}");
+            }
+        }
+        WHEN("serializing to NDJSON") {
+            THEN("each fact should be on its own line") {
+                ostringstream ss;
+                facts.write(ss, format::ndjson);
+                REQUIRE(ss.str() == "{\"bar\":\"foo\"}\n{\"foo\":\"bar\"}\n");
+            }
+        }
         WHEN("serializing to YAML") {
             THEN("it should contain the same values") {
                 ostringstream ss;
@@ -163,6 +286,635 @@ SCENARIO("using the fact collection") {
             }
         }
     }
+    GIVEN("only hidden facts") {
+        facts.concurrency(4);
+        facts.add("hidden", make_value<string_value>("secret", true));
+        REQUIRE(facts.size() == 1u);
+        auto threads = facter::util::thread_pool::instance().size();
+        THEN("writing them as text or MessagePack should write no facts without starting threads") {
+            ostringstream ss;
+            facts.write(ss, format::hash);
+            REQUIRE(ss.str() == "");
+            facts.write(ss, format::msgpack);
+            REQUIRE(ss.str() == "\x80");
+            REQUIRE(facter::util::thread_pool::instance().size() == threads);
+        }
+    }
+    GIVEN("resolvers that are resolved in parallel") {
+        facts.concurrency(4);
+        facts.add(make_shared<dependent_resolver>());
+        facts.add(make_shared<multi_resolver>());
+        THEN("all facts should resolve") {
+            REQUIRE(facts.size() == 3);
+            auto fact = facts.get<string_value>("bar");
+            REQUIRE(fact);
+            REQUIRE(fact->value() == "foo");
+        }
+        THEN("a resolver that depends on another fact should see its value") {
+            REQUIRE(facts.size() == 3);
+            auto fact = facts.get<string_value>("dependent");
+            REQUIRE(fact);
+            REQUIRE(fact->value() == "bar!");
+        }
+    }
+    GIVEN("multiple resolvers for the same fact that are resolved in parallel") {
+        facts.concurrency(4);
+        facts.add(make_shared<simple_resolver>());
+        facts.add(make_shared<override_resolver>());
+        THEN("the fact should have the same value as when resolved serially") {
+            collection serial;
+            serial.add(make_shared<simple_resolver>());
+            serial.add(make_shared<override_resolver>());
+            REQUIRE(serial.size() == 1);
+            REQUIRE(facts.size() == 1);
+            auto fact = facts.get<string_value>("foo");
+            REQUIRE(fact);
+            auto expected = serial.get<string_value>("foo");
+            REQUIRE(expected);
+            REQUIRE(fact->value() == expected->value());
+        }
+    }
+    GIVEN("resolvers that have been resolved") {
+        facts.add(make_shared<dependent_resolver>());
+        facts.add(make_shared<multi_resolver>());
+        REQUIRE(facts.size() == 3);
+        THEN("timings should be recorded for each resolver") {
+            auto timings = facts.timings();
+            REQUIRE(timings.size() == 2);
+            for (auto const& timing : timings) {
+                REQUIRE((timing.name == "dependent" || timing.name == "test"));
+                REQUIRE(timing.resolutions == 1);
+                REQUIRE(timing.processes == 0);
+                REQUIRE(timing.http_requests == 0);
+            }
+            REQUIRE(timings.front().wall_time >= timings.back().wall_time);
+        }
+    }
+    GIVEN("resolvers that declare dependencies") {
+        vector<string> order;
+        facts.add(make_shared<ordered_resolver>("third", "c", vector<string>{ "b" }, order));
+        facts.add(make_shared<ordered_resolver>("second", "b", vector<string>{ "a" }, order));
+        facts.add(make_shared<ordered_resolver>("first", "a", vector<string>{}, order));
+        THEN("the resolvers should resolve in dependency order") {
+            REQUIRE(facts.size() == 3);
+            REQUIRE(order == (vector<string>{ "first", "second", "third" }));
+            auto fact = facts.get<string_value>("c");
+            REQUIRE(fact);
+            REQUIRE(fact->value() == "abc");
+        }
+        WHEN("resolved in parallel") {
+            facts.concurrency(4);
+            THEN("the resolvers should resolve in dependency order") {
+                REQUIRE(facts.size() == 3);
+                REQUIRE(order == (vector<string>{ "first", "second", "third" }));
+                auto fact = facts.get<string_value>("c");
+                REQUIRE(fact);
+                REQUIRE(fact->value() == "abc");
+            }
+        }
+        WHEN("written as each fact becomes final") {
+            facts.add("z", make_value<string_value>("external"));
+            ostringstream ss;
+            facts.write_streaming(ss, format::hash);
+            THEN("each fact should be written once nothing left depends on it and then released") {
+                REQUIRE(ss.str() == "z => external\na => a\nb => ab\nc => abc");
+                REQUIRE(order == (vector<string>{ "first", "second", "third" }));
+                REQUIRE(facts.size() == 0);
+            }
+        }
+        WHEN("streamed as NDJSON while resolving in parallel") {
+            facts.concurrency(4);
+            facts.add("z", make_value<string_value>("external"));
+            ostringstream ss;
+            facts.write_streaming(ss, format::ndjson);
+            THEN("each fact should be written on its own line once nothing left depends on it") {
+                REQUIRE(ss.str() == "{\"z\":\"external\"}\n{\"a\":\"a\"}\n{\"b\":\"ab\"}\n{\"c\":\"abc\"}\n");
+                REQUIRE(order == (vector<string>{ "first", "second", "third" }));
+                REQUIRE(facts.size() == 0);
+            }
+        }
+    }
+    GIVEN("resolvers with a dependency cycle") {
+        vector<string> order;
+        facts.add(make_shared<ordered_resolver>("first", "a", vector<string>{ "b" }, order));
+        facts.add(make_shared<ordered_resolver>("second", "b", vector<string>{ "a" }, order));
+        THEN("the cycle should be broken in the order the resolvers were added") {
+            REQUIRE(facts.size() == 2);
+            REQUIRE(order == (vector<string>{ "first", "second" }));
+            auto fact = facts.get<string_value>("a");
+            REQUIRE(fact);
+            REQUIRE(fact->value() == "missingba");
+        }
+        WHEN("resolved in parallel") {
+            facts.concurrency(4);
+            THEN("the cycle should be broken in the order the resolvers were added") {
+                REQUIRE(facts.size() == 2);
+                REQUIRE(order == (vector<string>{ "first", "second" }));
+            }
+        }
+    }
+    GIVEN("resolvers that are resolved for a set of queries") {
+        vector<string> order;
+        facts.add(make_shared<ordered_resolver>("third", "c", vector<string>{ "b" }, order));
+        facts.add(make_shared<ordered_resolver>("second", "b", vector<string>{ "a" }, order));
+        facts.add(make_shared<ordered_resolver>("first", "a", vector<string>{}, order));
+        facts.add(make_shared<ordered_resolver>("unrelated", "d", vector<string>{}, order));
+        THEN("only the queried resolvers and their dependencies should resolve") {
+            facts.resolve({ "b.foo" });
+            REQUIRE(order == (vector<string>{ "first", "second" }));
+        }
+        THEN("resolving in parallel should only resolve the queried resolvers and their dependencies") {
+            facts.concurrency(4);
+            facts.resolve({ "c", "a" });
+            REQUIRE(order == (vector<string>{ "first", "second", "third" }));
+        }
+        THEN("resolving with no queries should resolve every resolver") {
+            facts.resolve(set<string>{});
+            REQUIRE(order.size() == 4u);
+        }
+    }
+    GIVEN("a fact collection without queries") {
+        THEN("every fact should be queried") {
+            REQUIRE(facts.is_queried("foo"));
+            REQUIRE(facts.is_queried("foo.bar.baz"));
+        }
+    }
+    GIVEN("a resolver that checks what was queried") {
+        struct query_resolver : resolver
+        {
+            query_resolver(vector<string>& queried) :
+                resolver("query", { "foo" }),
+                _queried(queried)
+            {
+            }
+
+            virtual void resolve(collection& facts) override
+            {
+                for (auto const& path : { "foo", "foo.bar", "foo.bar.baz", "foo.baz", "foo.\"bar.baz\"", "foo.*.baz" }) {
+                    if (facts.is_queried(path)) {
+                        _queried.emplace_back(path);
+                    }
+                }
+                facts.add("foo", make_value<string_value>("bar"));
+            }
+
+            vector<string>& _queried;
+        };
+        vector<string> queried;
+        facts.add(make_shared<query_resolver>(queried));
+        THEN("only paths on the way to or under a query should be queried") {
+            facts.resolve({ "foo.bar" });
+            REQUIRE(queried == (vector<string>{ "foo", "foo.bar", "foo.bar.baz", "foo.*.baz" }));
+        }
+        THEN("quoted segments should be matched in full") {
+            facts.resolve({ "foo.\"bar.baz\"" });
+            REQUIRE(queried == (vector<string>{ "foo", "foo.\"bar.baz\"", "foo.*.baz" }));
+        }
+        THEN("queries should no longer apply once resolved") {
+            facts.resolve({ "foo.bar" });
+            REQUIRE(facts.is_queried("foo.baz"));
+        }
+        THEN("a later query of a value that was not queried should resolve it again for both queries") {
+            facts.resolve({ "foo.bar" });
+            queried.clear();
+            facts.query<value>("foo.baz");
+            REQUIRE(queried == (vector<string>{ "foo", "foo.bar", "foo.bar.baz", "foo.baz", "foo.*.baz" }));
+        }
+    }
+    GIVEN("a resolver that skips values that were not queried") {
+        struct skipping_resolver : resolver
+        {
+            skipping_resolver(int& count) :
+                resolver("skipping", { "foo" }),
+                _count(count)
+            {
+            }
+
+            virtual void resolve(collection& facts) override
+            {
+                ++_count;
+                auto foo = make_value<map_value>();
+                if (facts.is_queried("foo.bar")) {
+                    foo->add("bar", make_value<string_value>("bar"));
+                }
+                if (facts.is_queried("foo.baz")) {
+                    foo->add("baz", make_value<string_value>("baz"));
+                }
+                facts.add("foo", move(foo));
+            }
+
+            int& _count;
+        };
+        int count = 0;
+        facts.add(make_shared<skipping_resolver>(count));
+        facts.resolve({ "foo.bar" });
+        REQUIRE(count == 1);
+        THEN("querying a value it skipped should resolve it again") {
+            auto baz = facts.query<string_value>("foo.baz");
+            REQUIRE(baz);
+            REQUIRE(baz->value() == "baz");
+            REQUIRE(count == 2);
+            auto bar = facts.query<string_value>("foo.bar");
+            REQUIRE(bar);
+            REQUIRE(bar->value() == "bar");
+            REQUIRE(count == 2);
+        }
+        THEN("querying a value it resolved should not resolve it again") {
+            auto bar = facts.query<string_value>("foo.bar");
+            REQUIRE(bar);
+            REQUIRE(count == 1);
+            facts.resolve({ "foo.bar" });
+            REQUIRE(count == 1);
+        }
+        THEN("getting the whole fact should resolve it again") {
+            auto foo = facts.get<map_value>("foo");
+            REQUIRE(foo);
+            REQUIRE(foo->size() == 2u);
+            REQUIRE(count == 2);
+        }
+        THEN("writing queries for different values one after another should answer each, as in batch mode") {
+            ostringstream first;
+            facts.write(first, format::json_compact, { "foo.bar" });
+            REQUIRE(first.str() == "{\"foo.bar\":\"bar\"}");
+            ostringstream second;
+            facts.write(second, format::json_compact, { "foo.baz" });
+            REQUIRE(second.str() == "{\"foo.baz\":\"baz\"}");
+        }
+        THEN("resolving every fact should resolve it again once") {
+            REQUIRE(facts.size() == 1u);
+            REQUIRE(count == 2);
+            REQUIRE(facts.get<map_value>("foo")->size() == 2u);
+            REQUIRE(facts.size() == 1u);
+            REQUIRE(count == 2);
+        }
+    }
+    GIVEN("resolvers that have not resolved") {
+        int count = 0;
+        facts.add("c", make_value<string_value>("value"));
+        facts.add(make_shared<incrementing_resolver>("counting", "a", count));
+        facts.add(make_shared<incrementing_resolver>("counting", "b", count));
+        THEN("their facts should be named without resolving them") {
+            REQUIRE(facts.names() == vector<string>({ "a", "b", "c" }));
+            REQUIRE(count == 0);
+            REQUIRE(facts.size() == 3);
+            REQUIRE(count == 2);
+            REQUIRE(facts.names() == vector<string>({ "a", "b", "c" }));
+        }
+    }
+    GIVEN("resolvers that have been resolved and are refreshed") {
+        int count = 0;
+        vector<string> order;
+        facts.add(make_shared<incrementing_resolver>("counting", "a", count));
+        facts.add(make_shared<ordered_resolver>("dependent", "b", vector<string>{}, order));
+        facts.add(make_shared<simple_resolver>());
+        REQUIRE(facts.size() == 3);
+        REQUIRE(count == 1);
+        THEN("only the refreshed facts should resolve again") {
+            auto changed = facts.refresh({ "a" });
+            REQUIRE(count == 2);
+            REQUIRE(order.size() == 1u);
+            REQUIRE(changed == (set<string>{ "a" }));
+            auto fact = facts.get<integer_value>("a");
+            REQUIRE(fact);
+            REQUIRE(fact->value() == 2);
+            REQUIRE(facts.get<string_value>("foo"));
+        }
+        THEN("refreshing facts that did not change should not report them") {
+            auto changed = facts.refresh({ "foo", "b" });
+            REQUIRE(changed.empty());
+            REQUIRE(count == 1);
+            REQUIRE(order.size() == 2u);
+            auto fact = facts.get<string_value>("foo");
+            REQUIRE(fact);
+            REQUIRE(fact->value() == "bar");
+        }
+        THEN("refreshing unknown facts should resolve nothing") {
+            REQUIRE(facts.refresh({ "unknown" }).empty());
+            REQUIRE(count == 1);
+            REQUIRE(facts.size() == 3);
+        }
+        THEN("only facts older than the given age should resolve again") {
+            REQUIRE(facts.refresh_all_older_than(chrono::hours(1)).empty());
+            REQUIRE(count == 1);
+            auto changed = facts.refresh_all_older_than(chrono::steady_clock::duration::zero());
+            REQUIRE(count == 2);
+            REQUIRE(order.size() == 2u);
+            REQUIRE(changed == (set<string>{ "a" }));
+        }
+    }
+    GIVEN("a resolver that depends on a refreshed fact") {
+        int count = 0;
+        vector<string> order;
+        facts.add(make_shared<incrementing_resolver>("counting", "a", count));
+        facts.add(make_shared<ordered_resolver>("dependent", "b", vector<string>{ "a" }, order));
+        REQUIRE(facts.size() == 2);
+        THEN("the dependent resolver should resolve again") {
+            auto changed = facts.refresh({ "a" });
+            REQUIRE(order == (vector<string>{ "dependent", "dependent" }));
+            REQUIRE(changed == (set<string>{ "a" }));
+        }
+    }
+    GIVEN("multiple resolvers for the same fact that are refreshed") {
+        facts.add(make_shared<simple_resolver>());
+        facts.add(make_shared<override_resolver>());
+        REQUIRE(facts.size() == 1);
+        THEN("the fact should have the same value as before the refresh") {
+            auto before = facts.get<string_value>("foo");
+            REQUIRE(before);
+            string expected = before->value();
+            REQUIRE(facts.refresh({ "foo" }).empty());
+            auto fact = facts.get<string_value>("foo");
+            REQUIRE(fact);
+            REQUIRE(fact->value() == expected);
+        }
+    }
+    GIVEN("facts that override the facts of refreshed resolvers") {
+        struct text_resolver : resolver
+        {
+            text_resolver() : resolver("text", { "txt_fact1" })
+            {
+            }
+
+            virtual void resolve(collection& facts) override
+            {
+                facts.add("txt_fact1", make_value<string_value>("resolved"));
+            }
+        };
+        facts.add(make_shared<simple_resolver>());
+        facts.add(make_shared<text_resolver>());
+        facts.add_external_facts({ LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/text" });
+        facts.add("foo", make_value<string_value>("overridden"));
+        THEN("the external fact and the added fact should keep their values") {
+            REQUIRE(facts.refresh({ "foo", "txt_fact1" }).empty());
+            auto external = facts.get<string_value>("txt_fact1");
+            REQUIRE(external);
+            REQUIRE(external->value() == "value1");
+            auto added = facts.get<string_value>("foo");
+            REQUIRE(added);
+            REQUIRE(added->value() == "overridden");
+        }
+    }
+    GIVEN("facts added by resolvers and facts added directly") {
+        facts.add(make_shared<multi_resolver>());
+        facts.add("foo", make_value<string_value>("overridden"));
+        facts.add("custom", make_value<string_value>("added"));
+        THEN("only the facts added by resolvers that were not overridden should be refreshable") {
+            REQUIRE(facts.size() == 3u);
+            REQUIRE(facts.refreshable_facts() == set<string>({ "bar" }));
+        }
+    }
+    GIVEN("a subscription to changes of structured facts") {
+        struct structured_resolver : resolver
+        {
+            structured_resolver(int& count) :
+                resolver("structured", { "structured", "removed" }),
+                _count(count)
+            {
+            }
+
+            virtual void resolve(collection& facts) override
+            {
+                ++_count;
+                auto map = make_value<map_value>();
+                map->add("constant", make_value<string_value>("constant"));
+                map->add("count", make_value<integer_value>(_count));
+                map->add(_count == 1 ? "first" : "second.time", make_value<boolean_value>(true));
+                auto array = make_value<array_value>();
+                for (int i = 0; i < _count; ++i) {
+                    array->add(make_value<integer_value>(i));
+                }
+                map->add("array", move(array));
+                facts.add("structured", move(map));
+                if (_count == 1) {
+                    facts.add("removed", make_value<string_value>("removed"));
+                }
+            }
+
+            int& _count;
+        };
+        int count = 0;
+        facts.add(make_shared<structured_resolver>(count));
+        facts.add(make_shared<simple_resolver>());
+        map<string, vector<string>> changes;
+        auto id = facts.subscribe([&](fact_change const& change) {
+            REQUIRE((change.previous || change.current));
+            changes[change.name] = change.paths;
+        });
+        REQUIRE(facts.size() == 3);
+        THEN("resolving facts should not notify the subscriber") {
+            REQUIRE(changes.empty());
+        }
+        THEN("the subscriber should be notified of the paths that changed") {
+            REQUIRE(facts.refresh({ "structured", "foo" }) == (set<string>{ "removed", "structured" }));
+            REQUIRE(changes.size() == 2u);
+            REQUIRE(changes["removed"] == (vector<string>{ "removed" }));
+            REQUIRE(changes["structured"] == (vector<string>{
+                "structured.array.1",
+                "structured.count",
+                "structured.first",
+                "structured.\"second.time\""
+            }));
+        }
+        THEN("the subscriber should not be notified once unsubscribed") {
+            facts.unsubscribe(id);
+            REQUIRE(facts.refresh({ "structured" }).size() == 2u);
+            REQUIRE(changes.empty());
+        }
+    }
+    GIVEN("resolvers with a deadline") {
+        facts.add(make_shared<simple_resolver>());
+        THEN("resolvers should resolve before the deadline") {
+            facts.deadline(chrono::steady_clock::now() + chrono::hours(1));
+            REQUIRE(facts.size() == 1);
+        }
+        THEN("resolvers should not resolve after the deadline") {
+            facts.deadline(chrono::steady_clock::now());
+            REQUIRE(facts.size() == 0);
+        }
+        THEN("resolvers should not resolve once cancelled") {
+            facts.cancel();
+            REQUIRE(facts.size() == 0);
+        }
+    }
+    GIVEN("default facts that are resolved in parallel") {
+        facts.concurrency(4);
+        facts.add_default_facts();
+        THEN("facts should resolve") {
+            REQUIRE(facts.size() > 0);
+            REQUIRE(facts.get<string_value>("kernel"));
+        }
+    }
+    GIVEN("facts that are formatted in parallel") {
+        for (int i = 0; i < 50; ++i) {
+            auto fact = make_value<map_value>();
+            fact->add("index", make_value<integer_value>(i));
+            fact->add("ratio", make_value<double_value>(i / 4.0));
+            fact->add("enabled", make_value<boolean_value>(i % 2 == 0));
+            auto names = make_value<array_value>();
+            names->add(make_value<string_value>("first \"quoted\""));
+            names->add(make_value<string_value>("second: value"));
+            fact->add("names", move(names));
+            facts.add("fact" + to_string(i), move(fact));
+        }
+        facts.add("hidden", make_value<string_value>("secret", true));
+        facts.add("empty", make_value<map_value>());
+        THEN("the output should be the same as when formatted on one thread") {
+            for (auto fmt : { format::hash, format::json, format::json_compact, format::yaml, format::msgpack }) {
+                ostringstream serial;
+                facts.concurrency(1);
+                facts.write(serial, fmt);
+                ostringstream parallel;
+                facts.concurrency(4);
+                facts.write(parallel, fmt);
+                REQUIRE(parallel.str() == serial.str());
+                REQUIRE(serial.str().find("secret") == string::npos);
+            }
+        }
+    }
+    GIVEN("structured facts to project") {
+        auto os = make_value<map_value>();
+        auto release = make_value<map_value>();
+        release->add("major", make_value<string_value>("7"));
+        release->add("minor", make_value<string_value>("1"));
+        os->add("release", move(release));
+        os->add("name", make_value<string_value>("CentOS"));
+        facts.add("os", move(os));
+        auto models = make_value<array_value>();
+        models->add(make_value<string_value>("first"));
+        models->add(make_value<string_value>("second"));
+        facts.add("models", move(models));
+        facts.add("hidden", make_value<string_value>("secret", true));
+        WHEN("projecting leaf values") {
+            ostringstream ss;
+            facts.write(ss, format::json_compact, { "os.release.major", "models.1", "hidden", "missing.value" }, true);
+            THEN("only the queried paths should be output") {
+                REQUIRE(ss.str() == "{\"hidden\":\"secret\",\"models\":{\"1\":\"second\"},\"os\":{\"release\":{\"major\":\"7\"}}}");
+            }
+        }
+        WHEN("projecting a value and one of its children") {
+            ostringstream ss;
+            facts.write(ss, format::yaml, { "os.release", "os.release.minor" }, true);
+            THEN("the enclosing value should be output") {
+                REQUIRE(ss.str() == "os:\n  release:\n    major: \"7\"\n    minor: \"1\"");
+            }
+        }
+        WHEN("projecting only missing values") {
+            ostringstream ss;
+            facts.write(ss, format::json_compact, { "missing" }, true);
+            THEN("an empty object should be output") {
+                REQUIRE(ss.str() == "{}");
+            }
+        }
+        WHEN("projecting a wildcard query") {
+            ostringstream ss;
+            facts.write(ss, format::json_compact, { "os.release.*" }, true);
+            THEN("every selected value should be output") {
+                REQUIRE(ss.str() == "{\"os\":{\"release\":{\"major\":\"7\",\"minor\":\"1\"}}}");
+            }
+        }
+        WHEN("writing a wildcard query") {
+            ostringstream ss;
+            facts.write(ss, format::hash, { "models.*" });
+            THEN("each selected value should be output by its path") {
+                REQUIRE(ss.str() == "models.0 => first\nmodels.1 => second");
+            }
+        }
+        WHEN("querying all values selected by a wildcard") {
+            auto results = facts.query_all(query("os.release.*"));
+            THEN("each value should be returned with its path") {
+                REQUIRE(results.size() == 2);
+                REQUIRE(results[0].first == "os.release.major");
+                REQUIRE(results[1].first == "os.release.minor");
+                REQUIRE(value_cast<string_value>(results[1].second)->value() == "1");
+            }
+        }
+    }
+    GIVEN("blocked resolvers") {
+        int blocked = 0;
+        int allowed = 0;
+        facts.filter({ "blocked", "allowed" }, { "allowed" });
+        facts.add(make_shared<incrementing_resolver>("blocked", "foo", blocked));
+        facts.add(make_shared<incrementing_resolver>("allowed", "bar", allowed));
+        THEN("only the allowed resolvers should be added") {
+            REQUIRE_FALSE(facts.get<integer_value>("foo"));
+            REQUIRE(facts.get<integer_value>("bar"));
+            REQUIRE(blocked == 0);
+            REQUIRE(allowed == 1);
+        }
+    }
+    GIVEN("expensive resolvers within a cost budget") {
+        int cheap = 0;
+        int expensive = 0;
+        int allowed = 0;
+        facts.cost_budget(true);
+        facts.filter({}, { "allowed" });
+        facts.add(make_shared<incrementing_resolver>("cheap", "foo", cheap));
+        facts.add(make_shared<expensive_resolver>("expensive", "bar", expensive));
+        facts.add(make_shared<expensive_resolver>("allowed", "baz", allowed));
+        WHEN("all facts are resolved") {
+            REQUIRE(facts.size() == 2);
+            THEN("expensive resolvers should be skipped unless allowed") {
+                REQUIRE(cheap == 1);
+                REQUIRE(expensive == 0);
+                REQUIRE(allowed == 1);
+            }
+        }
+        WHEN("an expensive fact is queried") {
+            ostringstream ss;
+            facts.write(ss, format::hash, { "bar" });
+            THEN("the expensive resolver should be resolved") {
+                REQUIRE(ss.str() == "1");
+                REQUIRE(expensive == 1);
+                REQUIRE(cheap == 0);
+            }
+        }
+        WHEN("a resolver depends on an expensive fact") {
+            vector<string> order;
+            facts.add(make_shared<ordered_resolver>("dependent", "qux", vector<string>{ "bar" }, order));
+            facts.size();
+            THEN("the expensive resolver should be resolved first") {
+                REQUIRE(expensive == 1);
+                REQUIRE(order == vector<string>({ "dependent" }));
+                REQUIRE(facts.get<integer_value>("bar"));
+            }
+        }
+    }
+    GIVEN("an alternate root directory") {
+        facts.root(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/roots/first");
+        facts.add(make_shared<rooted_resolver>());
+        THEN("files should be read from beneath the root") {
+            auto motd = facts.get<string_value>("motd");
+            REQUIRE(motd);
+            REQUIRE(motd->value() == "first");
+        }
+    }
+    GIVEN("collections with different root directories") {
+        collection second;
+        facts.root(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/roots/first");
+        second.root(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/roots/second");
+        facts.add(make_shared<rooted_resolver>());
+        second.add(make_shared<rooted_resolver>());
+        auto motd = [](collection& facts) {
+            // The resolver should have been resolved by resolve_all rather than on access
+            REQUIRE(facts.timings().size() == 1);
+            auto value = facts.get<string_value>("motd");
+            return value ? value->value() : string();
+        };
+        WHEN("resolved serially") {
+            collection::resolve_all({ &facts, &second }, 1);
+            THEN("each collection should resolve relative to its root") {
+                REQUIRE(motd(facts) == "first");
+                REQUIRE(motd(second) == "second");
+            }
+        }
+        WHEN("resolved with shared threads") {
+            collection::resolve_all({ &facts, &second }, 4);
+            THEN("each collection should resolve relative to its root") {
+                REQUIRE(motd(facts) == "first");
+                REQUIRE(motd(second) == "second");
+            }
+        }
+    }
     GIVEN("external facts paths to search") {
         facts.add_external_facts({
                 LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/yaml",
@@ -202,6 +954,77 @@ SCENARIO("using the fact collection") {
             }
         }
     }
+    GIVEN("external facts resolved with multiple threads") {
+        facts.concurrency(4);
+        facts.add_external_facts({
+                LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/yaml",
+                LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/json",
+                LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/text",
+                LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/ordered",
+        });
+        THEN("the facts of every file should be added") {
+            REQUIRE(facts.size() == 21);
+            REQUIRE(facts.get<string_value>("yaml_fact1"));
+            REQUIRE(facts.get<string_value>("json_fact1"));
+            REQUIRE(facts.get<string_value>("txt_fact1"));
+            REQUIRE(facts.get<string_value>("text_only"));
+            REQUIRE(facts.get<string_value>("json_only"));
+            REQUIRE(facts.get<string_value>("yaml_only"));
+        }
+        THEN("a fact in more than one file should have the value of the last file in path order") {
+            auto ordered = facts.get<string_value>("ordered_fact");
+            REQUIRE(ordered);
+            REQUIRE(ordered->value() == "third");
+        }
+    }
+    GIVEN("external facts that are refreshed") {
+        auto directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("facter-external-%%%%-%%%%");
+        boost::filesystem::create_directories(directory);
+        auto write = [&](string const& name, string const& contents) {
+            boost::nowide::ofstream out((directory / name).string().c_str());
+            out << contents;
+        };
+        write("a.txt", "a_fact=1\n");
+        write("b.txt", "shared_fact=b\n");
+        write("c.txt", "shared_fact=c\n");
+        facts.add_external_facts({ directory.string() });
+        REQUIRE(facts.get<string_value>("shared_fact")->value() == "c");
+
+        WHEN("no file changed") {
+            THEN("no facts should change") {
+                REQUIRE(facts.refresh_external_facts().empty());
+            }
+        }
+        WHEN("a file changed") {
+            write("a.txt", "a_fact=20\n");
+            auto changed = facts.refresh_external_facts();
+            THEN("only its facts should change") {
+                REQUIRE(changed == set<string>({ "a_fact" }));
+                REQUIRE(facts.get<string_value>("a_fact")->value() == "20");
+                REQUIRE(facts.get<string_value>("shared_fact")->value() == "c");
+            }
+        }
+        WHEN("a file was added") {
+            write("d.txt", "d_fact=1\n");
+            auto changed = facts.refresh_external_facts();
+            THEN("its facts should be added") {
+                REQUIRE(changed == set<string>({ "d_fact" }));
+                REQUIRE(facts.get<string_value>("d_fact"));
+            }
+        }
+        WHEN("a file was removed") {
+            boost::filesystem::remove(directory / "a.txt");
+            boost::filesystem::remove(directory / "c.txt");
+            auto changed = facts.refresh_external_facts();
+            THEN("its facts should be removed or provided by the remaining files") {
+                REQUIRE(changed == set<string>({ "a_fact", "shared_fact" }));
+                REQUIRE_FALSE(facts.get<string_value>("a_fact"));
+                REQUIRE(facts.get<string_value>("shared_fact")->value() == "b");
+            }
+        }
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(directory, ec);
+    }
     GIVEN("structured fact data") {
         auto map = make_value<map_value>();
         map->add("string", make_value<string_value>("hello"));
@@ -337,4 +1160,68 @@ SCENARIO("using the fact collection") {
             REQUIRE(value->value() == "overridden");
         }
     }
+    GIVEN("facts of different sizes") {
+        facts.add("small", make_value<integer_value>(1));
+        auto array = make_value<array_value>();
+        for (int i = 0; i < 100; ++i) {
+            array->add(make_value<string_value>(string(100, 'x')));
+        }
+        facts.add("large", move(array));
+        THEN("their memory usage should be reported largest first") {
+            auto usage = facts.memory_usage();
+            REQUIRE(usage.size() == 2u);
+            REQUIRE(usage[0].name == "large");
+            REQUIRE(usage[0].bytes > 100 * 100);
+            REQUIRE(usage[1].name == "small");
+            REQUIRE(usage[1].bytes >= sizeof(integer_value));
+            REQUIRE(usage[1].bytes < 1000);
+        }
+    }
+}
+
+SCENARIO("adding fact plugins") {
+    collection facts;
+    GIVEN("a directory that does not exist") {
+        facts.add_plugins({ "does_not_exist" });
+        THEN("no facts should be added") {
+            REQUIRE(facts.size() == 0u);
+        }
+    }
+    GIVEN("a directory of files that are not plugins") {
+        auto directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("facter-plugins-%%%%-%%%%");
+        boost::filesystem::create_directories(directory);
+        {
+            boost::nowide::ofstream library((directory / "not_a_library.so").string().c_str());
+            library << "not a shared library";
+            boost::nowide::ofstream text((directory / "readme.txt").string().c_str());
+            text << "not a plugin";
+        }
+        facts.add_plugins({ directory.string() });
+        THEN("they should be skipped") {
+            REQUIRE(facts.size() == 0u);
+        }
+        boost::filesystem::remove_all(directory);
+    }
+    GIVEN("a directory containing a plugin") {
+        facts.add_plugins({ LIBFACTER_TESTS_PLUGINS_DIRECTORY "/plugin" });
+        THEN("the facts of the plugin should be added") {
+            REQUIRE(facts.size() == 1u);
+            auto value = facts.get<string_value>("plugin_fact");
+            REQUIRE(value);
+            REQUIRE(value->value() == "from plugin");
+        }
+    }
+    GIVEN("a directory containing a plugin built for another version of facter") {
+        facts.add_plugins({ LIBFACTER_TESTS_PLUGINS_DIRECTORY "/mismatched_plugin" });
+        THEN("it should not be loaded") {
+            REQUIRE(facts.size() == 0u);
+            REQUIRE_FALSE(facts["mismatched_fact"]);
+        }
+    }
+    GIVEN("a directory containing a library that does not export a plugin factory") {
+        facts.add_plugins({ LIBFACTER_TESTS_PLUGINS_DIRECTORY "/incomplete_plugin" });
+        THEN("it should not be loaded") {
+            REQUIRE(facts.size() == 0u);
+        }
+    }
 }
@@ -37,4 +37,10 @@ SCENARIO("using a double fact value") {
             REQUIRE(stream.str() == "42.4242");
         }
     }
+    WHEN("hashed") {
+        THEN("positive and negative zero should have the same hash") {
+            REQUIRE(double_value(0.0).hash() == double_value(-0.0).hash());
+            REQUIRE(value.hash() != double_value(0.0).hash());
+        }
+    }
 }
@@ -1,6 +1,8 @@
 #include <catch.hpp>
 #include <internal/facts/external/execution_resolver.hpp>
 #include <facter/facts/collection.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/util/string.hpp>
 #include "../../../fixtures.hpp"
@@ -40,6 +42,33 @@ SCENARIO("resolving external executable facts") {
                 REQUIRE(facts.get<string_value>("exe_fact4")->value() == "value2");
             }
         }
+        WHEN("the output is a JSON object") {
+            THEN("it populates structured facts") {
+                resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/structured/json_facts", facts);
+                REQUIRE(facts.size() == 2);
+                REQUIRE(facts.get<integer_value>("exe_json_fact1"));
+                REQUIRE(facts.get<integer_value>("exe_json_fact1")->value() == 5);
+                auto map = facts.get<map_value>("exe_json_fact2");
+                REQUIRE(map);
+                REQUIRE(map->get<boolean_value>("enabled"));
+                REQUIRE(map->get<boolean_value>("enabled")->value());
+                REQUIRE(map->get<array_value>("names"));
+                REQUIRE(map->get<array_value>("names")->size() == 2);
+            }
+        }
+        WHEN("the output is a YAML document") {
+            THEN("it populates structured facts") {
+                resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/structured/yaml_facts", facts);
+                REQUIRE(facts.size() == 2);
+                REQUIRE(facts.get<double_value>("exe_yaml_fact1"));
+                REQUIRE(facts.get<double_value>("exe_yaml_fact1")->value() == Approx(5.5));
+                auto array = facts.get<array_value>("exe_yaml_fact2");
+                REQUIRE(array);
+                REQUIRE(array->size() == 2);
+                REQUIRE(array->get<string_value>(1));
+                REQUIRE(array->get<string_value>(1)->value() == "two");
+            }
+        }
         THEN("the file can be resolved") {
             REQUIRE(resolver.can_resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/facts"));
         }
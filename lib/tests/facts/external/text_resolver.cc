@@ -3,6 +3,8 @@
 #include <facter/facts/collection.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include "../../fixtures.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
 
 using namespace std;
 using namespace facter::facts;
@@ -42,4 +44,23 @@ SCENARIO("resolving external text facts") {
             REQUIRE(facts.get<string_value>("txt_fact4")->value() == "value2");
         }
     }
+    GIVEN("a generated text file with many facts") {
+        auto path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("facter-text-%%%%-%%%%.txt");
+        {
+            boost::nowide::ofstream file(path.string().c_str());
+            for (int i = 0; i < 10000; ++i) {
+                file << "Generated_Fact" << i << "=value=" << i << "\r\n";
+            }
+            file << "last_fact=last";
+        }
+        resolver.resolve(path.string(), facts);
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+        THEN("it should populate every fact with a lowercase name") {
+            REQUIRE(facts.size() == 10001);
+            REQUIRE(facts.get<string_value>("generated_fact0")->value() == "value=0\r");
+            REQUIRE(facts.get<string_value>("generated_fact9999")->value() == "value=9999\r");
+            REQUIRE(facts.get<string_value>("last_fact")->value() == "last");
+        }
+    }
 }
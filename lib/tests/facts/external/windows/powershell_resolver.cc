@@ -44,3 +44,30 @@ SCENARIO("resolving external powershell facts") {
         }
     }
 }
+
+SCENARIO("resolving external powershell facts in a persistent powershell process") {
+    collection facts;
+    powershell_resolver resolver(true);
+
+    GIVEN("a script that fails") {
+        THEN("an exception is thrown and later scripts are still resolved") {
+            REQUIRE_THROWS_AS(resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/windows/powershell/failed.ps1", facts), external_fact_exception);
+            resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/windows/powershell/facts.ps1", facts);
+            REQUIRE(facts.get<string_value>("ps1_fact1"));
+            REQUIRE(facts.get<string_value>("ps1_fact1")->value() == "value1");
+        }
+    }
+    GIVEN("scripts resolved more than once") {
+        THEN("each resolution populates facts") {
+            for (int i = 0; i < 3; ++i) {
+                collection other;
+                resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/windows/powershell/facts.ps1", other);
+                REQUIRE(other.get<string_value>("ps1_fact1"));
+                REQUIRE(other.get<string_value>("ps1_fact1")->value() == "value1");
+                REQUIRE(other.get<string_value>("ps1_fact4"));
+                REQUIRE(other.get<string_value>("ps1_fact4")->value() == "value2");
+                REQUIRE_FALSE(other.get<string_value>("ps1_fact3"));
+            }
+        }
+    }
+}
@@ -58,4 +58,43 @@ SCENARIO("resolving external YAML facts") {
             REQUIRE(facts.get<string_value>("yaml_fact7")->value() == "bar");
         }
     }
+    GIVEN("YAML with anchors and aliases") {
+        THEN("aliases should be replaced with the anchored values") {
+            resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/yaml/documents/anchors.yaml", facts);
+            auto defaults = facts.get<map_value>("defaults");
+            REQUIRE(defaults);
+            REQUIRE(defaults->size() == 2);
+            auto copied = facts.get<map_value>("copied_fact");
+            REQUIRE(copied);
+            REQUIRE(copied->size() == 2);
+            REQUIRE(copied->get<string_value>("owner"));
+            REQUIRE(copied->get<string_value>("owner")->value() == "ops");
+            REQUIRE(copied->get<integer_value>("tier"));
+            REQUIRE(copied->get<integer_value>("tier")->value() == 3);
+            auto nested = facts.get<array_value>("nested_fact");
+            REQUIRE(nested);
+            REQUIRE(nested->size() == 3);
+            REQUIRE(nested->get<map_value>(0));
+            REQUIRE(nested->get<map_value>(0)->size() == 2);
+            REQUIRE(nested->get<map_value>(1));
+            REQUIRE(nested->get<map_value>(1)->size() == 2);
+            REQUIRE(nested->get<string_value>(2));
+            REQUIRE(nested->get<string_value>(2)->value() == "web");
+        }
+        THEN("scalars should be converted as before") {
+            resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/yaml/documents/anchors.yaml", facts);
+            REQUIRE(facts.get<integer_value>("hex_fact"));
+            REQUIRE(facts.get<integer_value>("hex_fact")->value() == 31);
+            REQUIRE(facts.get<boolean_value>("quoted_fact"));
+            REQUIRE(facts.get<boolean_value>("quoted_fact")->value());
+            REQUIRE(facts.get<double_value>("infinite_fact"));
+            REQUIRE(facts.get<double_value>("infinite_fact")->value() < 0);
+            REQUIRE_FALSE(facts["null_fact"]);
+        }
+    }
+    GIVEN("YAML that is not a map") {
+        THEN("it should throw an exception") {
+            REQUIRE_THROWS_AS(resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/yaml/documents/sequence.yaml", facts), external_fact_exception);
+        }
+    }
 }
@@ -0,0 +1,198 @@
+#include <catch.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/logging/logging.hpp>
+#include <rapidjson/document.h>
+#include <yaml-cpp/yaml.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace facter::facts;
+using namespace rapidjson;
+using namespace YAML;
+
+SCENARIO("using a lazy fact value") {
+    int calls = 0;
+    auto thunk = [&]() -> unique_ptr<value> {
+        ++calls;
+        return make_value<string_value>("hello");
+    };
+    GIVEN("a lazy value that has not been accessed") {
+        lazy_value value(thunk);
+        THEN("it should not be evaluated") {
+            REQUIRE_FALSE(value.evaluated());
+            REQUIRE(calls == 0);
+        }
+        THEN("accessing it should evaluate it once") {
+            auto str = dynamic_cast<string_value const*>(value.get());
+            REQUIRE(str);
+            REQUIRE(str->value() == "hello");
+            REQUIRE(value.get() == str);
+            REQUIRE(value.evaluated());
+            REQUIRE(calls == 1);
+        }
+        THEN("shared values should share the evaluation") {
+            auto shared = value.share(true);
+            REQUIRE(shared->hidden());
+            REQUIRE(shared->get() == value.get());
+            REQUIRE(value.evaluated());
+            REQUIRE(calls == 1);
+        }
+        THEN("it should write the evaluated value") {
+            ostringstream stream;
+            value.write(stream);
+            REQUIRE(stream.str() == "\"hello\"");
+
+            rapidjson::Value json;
+            Document document;
+            value.to_json(document.GetAllocator(), json);
+            REQUIRE(json.IsString());
+            REQUIRE(string(json.GetString()) == "hello");
+
+            Emitter emitter;
+            value.write(emitter);
+            REQUIRE(string(emitter.c_str()) == "hello");
+        }
+        THEN("it should compare equal to the evaluated value") {
+            REQUIRE(value.equals(string_value("hello")));
+            REQUIRE(string_value("hello").equals(*value.get()));
+            REQUIRE_FALSE(value.equals(string_value("world")));
+        }
+    }
+    GIVEN("a lazy value whose thunk throws") {
+        lazy_value value([&]() -> unique_ptr<facter::facts::value> {
+            ++calls;
+            throw runtime_error("failed");
+        });
+        THEN("it should have no value and not be evaluated again") {
+            REQUIRE_FALSE(value.get());
+            REQUIRE_FALSE(value.get());
+            REQUIRE(calls == 1);
+        }
+    }
+    GIVEN("a value that is not lazy") {
+        string_value value("hello");
+        THEN("resolving it should return the value") {
+            REQUIRE(lazy_value::resolve(&value) == &value);
+            REQUIRE_FALSE(lazy_value::resolve(nullptr));
+        }
+    }
+}
+
+SCENARIO("using lazy values in structured facts") {
+    int calls = 0;
+    auto make_lazy = [&](unique_ptr<value> result) {
+        auto shared = make_shared<unique_ptr<value>>(move(result));
+        return make_value<lazy_value>([&calls, shared]() {
+            ++calls;
+            return move(*shared);
+        });
+    };
+    GIVEN("a map with lazy elements") {
+        map_value map;
+        map.add("eager", make_value<string_value>("foo"));
+        map.add("lazy", make_lazy(make_value<integer_value>(5)));
+        map.add("missing", make_lazy(nullptr));
+        THEN("elements should not be evaluated until accessed") {
+            REQUIRE(map.size() == 3);
+            REQUIRE(calls == 0);
+            auto integer = map.get<integer_value>("lazy");
+            REQUIRE(integer);
+            REQUIRE(integer->value() == 5);
+            REQUIRE(calls == 1);
+            REQUIRE_FALSE(map["missing"]);
+            REQUIRE(calls == 2);
+        }
+        THEN("enumerating should skip elements without a value") {
+            vector<string> names;
+            map.each([&](string const& name, value const* element) {
+                REQUIRE(element);
+                REQUIRE_FALSE(dynamic_cast<lazy_value const*>(element));
+                names.push_back(name);
+                return true;
+            });
+            REQUIRE(names == vector<string>({ "eager", "lazy" }));
+        }
+        THEN("output should skip elements without a value") {
+            ostringstream stream;
+            map.write(stream);
+            REQUIRE(stream.str() == "{\n  eager => \"foo\",\n  lazy => 5\n}");
+
+            rapidjson::Value json;
+            Document document;
+            map.to_json(document.GetAllocator(), json);
+            REQUIRE(json.IsObject());
+            REQUIRE(json.HasMember("lazy"));
+            REQUIRE(json["lazy"].IsInt64());
+            REQUIRE_FALSE(json.HasMember("missing"));
+
+            Emitter emitter;
+            map.write(emitter);
+            REQUIRE(string(emitter.c_str()) == "eager: foo\nlazy: 5");
+        }
+        THEN("it should equal a map with the evaluated elements") {
+            map_value other;
+            other.add("eager", make_value<string_value>("foo"));
+            other.add("lazy", make_value<integer_value>(5));
+            REQUIRE(map.equals(other));
+            REQUIRE(other.equals(map));
+        }
+    }
+    GIVEN("an array with lazy elements") {
+        array_value array;
+        array.add(make_lazy(nullptr));
+        array.add(make_lazy(make_value<string_value>("bar")));
+        THEN("indexing should unwrap the elements") {
+            REQUIRE(calls == 0);
+            REQUIRE_FALSE(array[0]);
+            auto str = array.get<string_value>(1);
+            REQUIRE(str);
+            REQUIRE(str->value() == "bar");
+            REQUIRE(calls == 2);
+        }
+        THEN("output should skip elements without a value") {
+            ostringstream stream;
+            array.write(stream);
+            REQUIRE(stream.str() == "[\n  \"bar\"\n]");
+        }
+    }
+    GIVEN("a collection with lazy facts") {
+        collection facts;
+        facts.add("lazy", make_lazy(make_value<string_value>("bar")));
+        facts.add("missing", make_lazy(nullptr));
+        THEN("the facts should not be evaluated until accessed") {
+            REQUIRE(calls == 0);
+            auto str = facts.get<string_value>("lazy");
+            REQUIRE(str);
+            REQUIRE(str->value() == "bar");
+            REQUIRE_FALSE(facts["missing"]);
+        }
+        THEN("facts without a value should not be output") {
+            ostringstream stream;
+            facts.write(stream, format::hash, { "lazy", "missing" });
+            REQUIRE(stream.str() == "lazy => bar\nmissing => ");
+            size_t count = 0;
+            facts.each([&](string const& name, value const* val) {
+                REQUIRE(name == "lazy");
+                REQUIRE(dynamic_cast<string_value const*>(val));
+                ++count;
+                return true;
+            });
+            REQUIRE(count == 1);
+        }
+        THEN("replacing a fact that resolved to nothing should be logged without a previous value") {
+            REQUIRE_FALSE(facts["missing"]);
+            auto lvl = facter::logging::get_level();
+            facter::logging::set_level(facter::logging::level::debug);
+            facts.add("missing", make_value<string_value>("found"));
+            facter::logging::set_level(lvl);
+            auto str = facts.get<string_value>("missing");
+            REQUIRE(str);
+            REQUIRE(str->value() == "found");
+        }
+    }
+}
@@ -112,5 +112,108 @@ SCENARIO("using a map fact value") {
                 REQUIRE(string(emitter.c_str()) == "array:\n  - \"1\"\n  - 2\ninteger: 5\nmap:\n  foo: bar\nstring: hello");
             }
         }
+        WHEN("compared to other maps") {
+            auto make_other = [](int64_t integer) {
+                map_value other;
+                other.add("string", make_value<string_value>("hello"));
+                other.add("integer", make_value<integer_value>(integer));
+                auto array_element = make_value<array_value>();
+                array_element->add(make_value<string_value>("1"));
+                array_element->add(make_value<integer_value>(2));
+                other.add("array", move(array_element));
+                auto map_element = make_value<map_value>();
+                map_element->add("foo", make_value<string_value>("bar"));
+                other.add("map", move(map_element));
+                return other;
+            };
+            THEN("a map with the same elements should be equal") {
+                auto other = make_other(5);
+                REQUIRE(value.equals(other));
+                REQUIRE(other.equals(value));
+            }
+            THEN("a map with an element that differs should not be equal") {
+                REQUIRE_FALSE(value.equals(make_other(6)));
+            }
+            THEN("a map with an additional element should not be equal") {
+                auto other = make_other(5);
+                other.add("extra", make_value<string_value>("extra"));
+                REQUIRE_FALSE(value.equals(other));
+                REQUIRE_FALSE(other.equals(value));
+            }
+            THEN("a map with the same elements should have the same hash") {
+                REQUIRE(value.hash() == make_other(5).hash());
+                REQUIRE(value.hash() != make_other(6).hash());
+            }
+            THEN("adding an element should change the hash") {
+                auto other = make_other(5);
+                auto hash = other.hash();
+                other.add("extra", make_value<string_value>("extra"));
+                REQUIRE(other.hash() != hash);
+                REQUIRE(other.clone()->hash() == other.hash());
+            }
+            THEN("whether the map is hidden should not change the hash") {
+                map_value hidden(true);
+                hidden.add("string", make_value<string_value>("hello", true));
+                map_value visible;
+                visible.add("string", make_value<string_value>("hello"));
+                REQUIRE(hidden.hash() == visible.hash());
+            }
+        }
+        WHEN("compared to a value that is not a map") {
+            THEN("it should not be equal") {
+                REQUIRE_FALSE(value.equals(string_value("hello")));
+            }
+        }
+        WHEN("cloned") {
+            auto copy = value.clone();
+            THEN("the copy should be an equal map that shares its elements") {
+                auto map = dynamic_cast<map_value const*>(copy.get());
+                REQUIRE(map);
+                REQUIRE(map->equals(value));
+                REQUIRE(map->size() == 4);
+                REQUIRE(map->get<array_value>("array") == value.get<array_value>("array"));
+                REQUIRE(map->share("map") == value.share("map"));
+                REQUIRE_FALSE(map->share("missing"));
+            }
+        }
+    }
+    GIVEN("elements added out of order") {
+        value.add("b", make_value<string_value>("2"));
+        value.add("c", make_value<string_value>("3"));
+        value.add("a", make_value<string_value>("1"));
+        value.add("b", make_value<string_value>("duplicate"));
+        THEN("they should be enumerated in order and the first duplicate kept") {
+            string names;
+            value.each([&](string const& name, facter::facts::value const* element) {
+                names += name + "=" + dynamic_cast<string_value const*>(element)->value() + " ";
+                return true;
+            });
+            REQUIRE(names == "a=1 b=2 c=3 ");
+            REQUIRE(value.size() == 3);
+        }
+    }
+    GIVEN("elements assigned in bulk") {
+        vector<pair<symbol, shared_ptr<facter::facts::value const>>> elements;
+        elements.emplace_back("b", make_value<integer_value>(2));
+        elements.emplace_back("a", make_value<integer_value>(1));
+        elements.emplace_back("b", make_value<integer_value>(3));
+        elements.emplace_back("c", nullptr);
+        value.assign(move(elements));
+        THEN("the map should be sorted without duplicates or null values") {
+            REQUIRE(value.size() == 2);
+            REQUIRE(value.get<integer_value>("a")->value() == 1);
+            REQUIRE(value.get<integer_value>("b")->value() == 2);
+            REQUIRE_FALSE(value["c"]);
+        }
+    }
+    GIVEN("elements with long and short strings") {
+        value.add("short", make_value<string_value>("short"));
+        auto empty = value.memory_usage();
+        value.add("long", make_value<string_value>(string(1000, 'x')));
+        THEN("the memory usage should include the allocated characters of its elements") {
+            REQUIRE(empty > sizeof(map_value));
+            REQUIRE(value.memory_usage() > empty + 1000);
+            REQUIRE(value.memory_usage() < empty + 1000 + 256);
+        }
     }
 }
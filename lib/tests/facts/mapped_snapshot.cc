@@ -0,0 +1,133 @@
+#include <catch.hpp>
+#include <facter/facts/mapped_snapshot.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace facter::facts;
+namespace fs = boost::filesystem;
+
+struct temp_snapshot_file
+{
+    temp_snapshot_file() :
+        _path((fs::temp_directory_path() / fs::unique_path("facter-snapshot-%%%%-%%%%")).string())
+    {
+    }
+
+    ~temp_snapshot_file()
+    {
+        boost::system::error_code ec;
+        fs::remove(_path, ec);
+        fs::remove(_path + ".tmp", ec);
+    }
+
+    string _path;
+};
+
+static snapshot make_snapshot(string const& release)
+{
+    map<string, shared_ptr<value const>> facts;
+    auto os = make_shared<map_value>();
+    auto version = make_value<map_value>();
+    version->add("major", make_value<string_value>(release));
+    os->add("release", move(version));
+    os->add("name", make_value<string_value>("Linux"));
+    facts["os"] = os;
+    auto models = make_shared<array_value>();
+    models->add(make_value<string_value>("first"));
+    models->add(make_value<string_value>("second"));
+    facts["models"] = models;
+    facts["dotted.name"] = make_shared<integer_value>(42);
+    facts["secret"] = make_shared<string_value>("hidden", true);
+    return snapshot(move(facts));
+}
+
+SCENARIO("publishing a snapshot to a mapped file") {
+    temp_snapshot_file file;
+
+    GIVEN("no published snapshot") {
+        mapped_snapshot mapped(file._path);
+        THEN("nothing should be mapped") {
+            REQUIRE_FALSE(mapped.is_open());
+            REQUIRE(mapped.stale());
+            REQUIRE(mapped.generation() == 0);
+            REQUIRE_FALSE(mapped.get("os"));
+        }
+    }
+    GIVEN("a published snapshot") {
+        unique_ptr<snapshot_publisher> publisher(new snapshot_publisher(file._path));
+        REQUIRE(publisher->publish(make_snapshot("7")));
+        mapped_snapshot mapped(file._path);
+        REQUIRE(mapped.is_open());
+        THEN("it should be the first generation and current") {
+            REQUIRE(mapped.generation() == 1);
+            REQUIRE_FALSE(mapped.stale());
+            REQUIRE_FALSE(mapped.reload());
+        }
+        THEN("queries should select values in the mapped facts") {
+            auto major = mapped.get("os.release.major");
+            REQUIRE(major);
+            REQUIRE(major->as<string_value>()->value() == "7");
+            auto model = mapped.get("models.1");
+            REQUIRE(model);
+            REQUIRE(model->as<string_value>()->value() == "second");
+            auto os = mapped.get("os");
+            REQUIRE(os);
+            REQUIRE(os->as<map_value>()->size() == 2);
+        }
+        THEN("a fact with the exact name of the query should be selected") {
+            auto dotted = mapped.get("dotted.name");
+            REQUIRE(dotted);
+            REQUIRE(dotted->as<integer_value>()->value() == 42);
+        }
+        THEN("queries that select nothing should not find a value") {
+            REQUIRE_FALSE(mapped.get("os.release.minor"));
+            REQUIRE_FALSE(mapped.get("models.2"));
+            REQUIRE_FALSE(mapped.get("models.first"));
+            REQUIRE_FALSE(mapped.get("os.name.length"));
+        }
+        THEN("hidden facts should not be published") {
+            REQUIRE_FALSE(mapped.get("secret"));
+        }
+        THEN("the encoded value should be found in the mapped memory") {
+            char const* data;
+            size_t size;
+            REQUIRE(mapped.query("os.name", data, size));
+            REQUIRE(size == 6);
+            REQUIRE(string(data + 1, size - 1) == "Linux");
+        }
+        WHEN("a newer snapshot is published") {
+            REQUIRE(publisher->publish(make_snapshot("8")));
+            THEN("the mapped snapshot should be stale until it is reloaded") {
+                REQUIRE(mapped.stale());
+                REQUIRE(mapped.get("os.release.major")->as<string_value>()->value() == "7");
+                REQUIRE(mapped.reload());
+                REQUIRE_FALSE(mapped.stale());
+                REQUIRE(mapped.generation() == 2);
+                REQUIRE(mapped.get("os.release.major")->as<string_value>()->value() == "8");
+            }
+        }
+        WHEN("the publisher is destroyed") {
+            publisher.reset();
+            THEN("the mapped snapshot should be stale and kept") {
+                REQUIRE(mapped.stale());
+                REQUIRE_FALSE(fs::exists(file._path));
+                REQUIRE_FALSE(mapped.reload());
+                REQUIRE(mapped.get("os.release.major"));
+            }
+        }
+        WHEN("another publisher takes over the file") {
+            snapshot_publisher next(file._path);
+            REQUIRE(next.publish(make_snapshot("9")));
+            THEN("the generation should continue and the previous snapshot should be stale") {
+                REQUIRE(next.generation() == 2);
+                REQUIRE(mapped.stale());
+                REQUIRE(mapped.reload());
+                REQUIRE(mapped.get("os.release.major")->as<string_value>()->value() == "9");
+            }
+        }
+    }
+}
@@ -0,0 +1,155 @@
+#include <catch.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace facter::facts;
+
+static string encode(value const& val)
+{
+    string buffer;
+    msgpack_writer writer(buffer);
+    val.to_msgpack(writer);
+    return buffer;
+}
+
+static unique_ptr<value> decode(string const& data)
+{
+    auto begin = data.data();
+    auto val = from_msgpack(begin, data.data() + data.size());
+    REQUIRE(begin == data.data() + data.size());
+    return val;
+}
+
+SCENARIO("encoding values as MessagePack") {
+    GIVEN("integers") {
+        THEN("they should use the smallest encoding") {
+            REQUIRE(encode(integer_value(5)) == string("\x05", 1));
+            REQUIRE(encode(integer_value(-1)) == string("\xff", 1));
+            REQUIRE(encode(integer_value(200)) == string("\xcc\xc8", 2));
+            REQUIRE(encode(integer_value(-200)) == string("\xd1\xff\x38", 3));
+            REQUIRE(encode(integer_value(70000)) == string("\xce\x00\x01\x11\x70", 5));
+        }
+        THEN("they should decode to the same value") {
+            for (int64_t i : { 0ll, 127ll, -32ll, -33ll, 255ll, 65536ll, -2147483649ll, 9223372036854775807ll }) {
+                auto val = decode(encode(integer_value(i)));
+                REQUIRE(value_cast<integer_value>(val.get()));
+                REQUIRE(value_cast<integer_value>(val.get())->value() == i);
+            }
+        }
+    }
+    GIVEN("strings") {
+        THEN("short strings should be stored with their length in the type byte") {
+            REQUIRE(encode(string_value("hi")) == string("\xa2hi", 3));
+        }
+        THEN("they should decode to the same value") {
+            for (auto const& s : { string(), string(31, 'a'), string(32, 'b'), string(70000, 'c') }) {
+                auto val = decode(encode(string_value(s)));
+                REQUIRE(value_cast<string_value>(val.get()));
+                REQUIRE(value_cast<string_value>(val.get())->value() == s);
+            }
+        }
+    }
+    GIVEN("booleans and doubles") {
+        THEN("they should decode to the same value") {
+            REQUIRE(encode(boolean_value(true)) == string("\xc3", 1));
+            REQUIRE(decode(encode(boolean_value(false)))->equals(boolean_value(false)));
+            REQUIRE(decode(encode(double_value(42.4242)))->equals(double_value(42.4242)));
+        }
+    }
+    GIVEN("a tree of values") {
+        map_value tree;
+        auto array = make_value<array_value>();
+        array->add(make_value<string_value>("1"));
+        array->add(make_value<lazy_value>([]() { return unique_ptr<value>(); }));
+        array->add(make_value<integer_value>(2));
+        tree.add("array", move(array));
+        auto nested = make_value<map_value>();
+        nested->add("foo", make_value<lazy_value>([]() { return make_value<string_value>("bar"); }));
+        tree.add("map", move(nested));
+        tree.add("double", make_value<double_value>(1.5));
+        THEN("it should decode to an equal tree without the elements that have no value") {
+            auto val = decode(encode(tree));
+            auto map = value_cast<map_value>(val.get());
+            REQUIRE(map);
+            REQUIRE(map->size() == 3);
+            REQUIRE(map->get<array_value>("array")->size() == 2);
+            REQUIRE(map->equals(tree));
+        }
+        THEN("it should be skipped and searched without decoding") {
+            auto data = encode(tree);
+            auto begin = data.data();
+            auto end = begin + data.size();
+            skip_msgpack(begin, end);
+            REQUIRE(begin == end);
+
+            begin = data.data();
+            REQUIRE(find_msgpack(begin, end, { "map", "foo" }));
+            REQUIRE(decode(string(begin, end))->equals(string_value("bar")));
+            begin = data.data();
+            REQUIRE(find_msgpack(begin, end, { "array", "1" }));
+            REQUIRE(static_cast<uint8_t>(*begin) == 2);
+            begin = data.data();
+            REQUIRE_FALSE(find_msgpack(begin, end, { "array", "2" }));
+            begin = data.data();
+            REQUIRE_FALSE(find_msgpack(begin, end, { "double", "value" }));
+        }
+    }
+    GIVEN("malformed data") {
+        THEN("decoding should throw") {
+            REQUIRE_THROWS_AS(decode(string("\xa5hi", 3)), msgpack_exception);
+            REQUIRE_THROWS_AS(decode(string("\xc1", 1)), msgpack_exception);
+            REQUIRE_THROWS_AS(decode(string("\x81\x01\x01", 3)), msgpack_exception);
+            REQUIRE_THROWS_AS(decode(string()), msgpack_exception);
+            string truncated("\x92\xa5hi", 4);
+            auto begin = truncated.data();
+            REQUIRE_THROWS_AS(skip_msgpack(begin, truncated.data() + truncated.size()), msgpack_exception);
+        }
+        THEN("sizes that don't fit in the data should throw without allocating them") {
+            REQUIRE_THROWS_AS(decode(string("\xdf\xff\xff\xff\xff\xa1k\x01", 8)), msgpack_exception);
+            REQUIRE_THROWS_AS(decode(string("\xdd\xff\xff\xff\xff\x01", 6)), msgpack_exception);
+        }
+        THEN("deeply nested values should throw") {
+            REQUIRE_THROWS_AS(decode(string(100000, '\x91') + '\x01'), msgpack_exception);
+            REQUIRE(decode(string(100, '\x91') + '\x01'));
+        }
+    }
+}
+
+SCENARIO("reconstructing a collection from MessagePack output") {
+    collection facts;
+    facts.add("foo", make_value<string_value>("bar"));
+    facts.add("hidden", make_value<string_value>("secret", true));
+    auto map = make_value<map_value>();
+    map->add("first", make_value<integer_value>(1));
+    map->add("second", make_value<boolean_value>(true));
+    facts.add("bar", move(map));
+
+    ostringstream output;
+    facts.write(output, format::msgpack);
+
+    WHEN("the output is added to another collection") {
+        collection copy;
+        REQUIRE(copy.add_msgpack_facts(output.str()));
+        THEN("it should contain the same facts except for hidden ones") {
+            REQUIRE(copy.size() == 2);
+            REQUIRE(copy["foo"]->equals(*facts["foo"]));
+            REQUIRE(copy["bar"]->equals(*facts["bar"]));
+            REQUIRE_FALSE(copy["hidden"]);
+        }
+    }
+    WHEN("the output is truncated") {
+        collection copy;
+        auto data = output.str();
+        data.resize(data.size() - 1);
+        THEN("no facts should be added") {
+            REQUIRE_FALSE(copy.add_msgpack_facts(data));
+            REQUIRE(copy.size() == 0);
+        }
+    }
+}
@@ -4,8 +4,10 @@
 #include <facter/facts/array_value.hpp>
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
+#include <facter/execution/execution.hpp>
 #include "../../fixtures.hpp"
 #include <sstream>
+#include <chrono>
 
 using namespace std;
 using namespace facter::facts;
@@ -36,3 +38,41 @@ SCENARIO("resolving external executable facts into a collection") {
         }
     }
 }
+
+struct slow_resolver : facter::facts::resolver
+{
+    slow_resolver() : resolver("slow", { "slow", "before" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        facts.add("before", make_value<string_value>("resolved"));
+        facter::execution::execute("sleep", { "10" });
+        facts.add("slow", make_value<string_value>("resolved"));
+    }
+};
+
+SCENARIO("resolving facts with a time limit") {
+    collection facts;
+    facts.add(make_shared<slow_resolver>());
+    GIVEN("a resolver that exceeds its time limit") {
+        facts.timeouts(chrono::seconds(60), { { "slow", chrono::milliseconds(200) } });
+        THEN("the facts resolved in time should be kept") {
+            auto start = chrono::steady_clock::now();
+            REQUIRE(facts.size() == 1);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+            REQUIRE(facts.get<string_value>("before"));
+            REQUIRE_FALSE(facts.get<string_value>("slow"));
+        }
+    }
+    GIVEN("a resolver that is resolving when the deadline passes") {
+        facts.deadline(chrono::steady_clock::now() + chrono::milliseconds(200));
+        THEN("the facts resolved in time should be kept") {
+            auto start = chrono::steady_clock::now();
+            REQUIRE(facts.size() == 1);
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(5));
+            REQUIRE(facts.get<string_value>("before"));
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#include <catch.hpp>
+#include <internal/facts/posix/networking_resolver.hpp>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace facter::facts;
+
+struct test_posix_networking_resolver : posix::networking_resolver
+{
+    using posix::networking_resolver::lookup_fqdn;
+
+ protected:
+    virtual bool is_link_address(sockaddr const* addr) const override
+    {
+        return false;
+    }
+
+    virtual uint8_t const* get_link_address_bytes(sockaddr const* addr) const override
+    {
+        return nullptr;
+    }
+};
+
+SCENARIO("looking up the FQDN of a hostname") {
+    GIVEN("a hostname that resolves in time") {
+        THEN("the canonical name should be returned") {
+            auto fqdn = test_posix_networking_resolver::lookup_fqdn("fast", chrono::milliseconds(1000), [](string const& hostname) {
+                return hostname + ".example.com";
+            });
+            REQUIRE(fqdn == "fast.example.com");
+        }
+    }
+    GIVEN("a hostname that does not resolve") {
+        THEN("no FQDN should be returned") {
+            auto fqdn = test_posix_networking_resolver::lookup_fqdn("missing", chrono::milliseconds(1000), [](string const&) {
+                return string();
+            });
+            REQUIRE(fqdn.empty());
+        }
+    }
+    GIVEN("a hostname whose lookup hangs") {
+        THEN("the lookup should be abandoned after the time limit") {
+            auto start = chrono::steady_clock::now();
+            auto fqdn = test_posix_networking_resolver::lookup_fqdn("slow", chrono::milliseconds(50), [](string const& hostname) {
+                this_thread::sleep_for(chrono::milliseconds(500));
+                return hostname + ".example.com";
+            });
+            REQUIRE(fqdn.empty());
+            REQUIRE(chrono::steady_clock::now() - start < chrono::milliseconds(400));
+            AND_THEN("another lookup of the hostname should not be started until it returns") {
+                bool called = false;
+                fqdn = test_posix_networking_resolver::lookup_fqdn("slow", chrono::milliseconds(1000), [&](string const& hostname) {
+                    called = true;
+                    return hostname + ".example.com";
+                });
+                REQUIRE(fqdn.empty());
+                REQUIRE_FALSE(called);
+            }
+            this_thread::sleep_for(chrono::milliseconds(600));
+        }
+    }
+    GIVEN("a time limit that has passed") {
+        THEN("no lookup should be started") {
+            bool called = false;
+            auto fqdn = test_posix_networking_resolver::lookup_fqdn("expired", chrono::milliseconds(0), [&](string const& hostname) {
+                called = true;
+                return hostname;
+            });
+            REQUIRE(fqdn.empty());
+            REQUIRE_FALSE(called);
+        }
+    }
+}
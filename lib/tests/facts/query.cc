@@ -0,0 +1,161 @@
+#include <catch.hpp>
+#include <facter/facts/query.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <map>
+
+using namespace std;
+using namespace facter::facts;
+
+SCENARIO("evaluating compiled queries") {
+    map<string, unique_ptr<value>> facts;
+    auto interfaces = make_value<map_value>();
+    auto eth0 = make_value<map_value>();
+    eth0->add("ip", make_value<string_value>("10.0.0.1"));
+    interfaces->add("eth0", move(eth0));
+    auto eth1 = make_value<map_value>();
+    eth1->add("ip", make_value<string_value>("10.0.0.2"));
+    interfaces->add("eth1", move(eth1));
+    interfaces->add("dotted.name", make_value<string_value>("dotted"));
+    facts["interfaces"] = move(interfaces);
+    auto models = make_value<array_value>();
+    models->add(make_value<string_value>("first"));
+    models->add(make_value<string_value>("second"));
+    facts["models"] = move(models);
+    facts["dotted.fact"] = make_value<integer_value>(5);
+
+    int lookups = 0;
+    auto get = [&](string const& name) -> value const* {
+        ++lookups;
+        auto it = facts.find(name);
+        return it == facts.end() ? nullptr : it->second.get();
+    };
+
+    GIVEN("a query for a nested map element") {
+        query q("interfaces.eth0.ip");
+        THEN("it should return the element every time it is evaluated") {
+            for (int i = 0; i < 3; ++i) {
+                auto ip = value_cast<string_value>(q.evaluate(get));
+                REQUIRE(ip);
+                REQUIRE(ip->value() == "10.0.0.1");
+            }
+            REQUIRE(q.text() == "interfaces.eth0.ip");
+        }
+        THEN("it should return the path to the element") {
+            vector<string> path;
+            REQUIRE(q.evaluate(get, &path));
+            REQUIRE(path == vector<string>({ "interfaces", "eth0", "ip" }));
+        }
+    }
+    GIVEN("a query with a quoted segment") {
+        query q("interfaces.\"dotted.name\"");
+        THEN("the quoted segment should be looked up as a single key") {
+            auto val = value_cast<string_value>(q.evaluate(get));
+            REQUIRE(val);
+            REQUIRE(val->value() == "dotted");
+        }
+    }
+    GIVEN("a query that names a fact containing '.'") {
+        query q("dotted.fact");
+        THEN("the fact should be returned") {
+            vector<string> path;
+            auto val = value_cast<integer_value>(q.evaluate(get, &path));
+            REQUIRE(val);
+            REQUIRE(val->value() == 5);
+            REQUIRE(path == vector<string>({ "dotted.fact" }));
+            REQUIRE(lookups == 1);
+        }
+    }
+    GIVEN("queries for array elements") {
+        THEN("valid indices should return the element") {
+            auto val = value_cast<string_value>(query("models.1").evaluate(get));
+            REQUIRE(val);
+            REQUIRE(val->value() == "second");
+        }
+        THEN("invalid indices should return nullptr") {
+            REQUIRE_FALSE(query("models.2").evaluate(get));
+            REQUIRE_FALSE(query("models.-1").evaluate(get));
+            REQUIRE_FALSE(query("models.first").evaluate(get));
+            REQUIRE_FALSE(query("models.99999999999").evaluate(get));
+        }
+    }
+    GIVEN("a query for a value that does not exist") {
+        THEN("it should return nullptr") {
+            vector<string> path;
+            REQUIRE_FALSE(query("interfaces.eth2.ip").evaluate(get, &path));
+            REQUIRE_FALSE(query("missing").evaluate(get));
+            REQUIRE_FALSE(query("").evaluate(get));
+            REQUIRE(path.empty());
+        }
+    }
+    GIVEN("a query with a wildcard for map elements") {
+        query q("interfaces.*.ip");
+        THEN("each selected value should be found with its path") {
+            REQUIRE(q.wildcard());
+            vector<string> paths;
+            vector<string> ips;
+            q.each(get, [&](vector<string> const& path, value const* val) {
+                paths.push_back(query::join(path));
+                auto ip = value_cast<string_value>(val);
+                REQUIRE(ip);
+                ips.push_back(ip->value());
+                return true;
+            });
+            REQUIRE(paths == vector<string>({ "interfaces.eth0.ip", "interfaces.eth1.ip" }));
+            REQUIRE(ips == vector<string>({ "10.0.0.1", "10.0.0.2" }));
+        }
+        THEN("evaluating it should return the first selected value") {
+            vector<string> path;
+            auto ip = value_cast<string_value>(q.evaluate(get, &path));
+            REQUIRE(ip);
+            REQUIRE(ip->value() == "10.0.0.1");
+            REQUIRE(path == vector<string>({ "interfaces", "eth0", "ip" }));
+        }
+        THEN("returning false should stop the traversal") {
+            int count = 0;
+            q.each(get, [&](vector<string> const&, value const*) {
+                ++count;
+                return false;
+            });
+            REQUIRE(count == 1);
+        }
+    }
+    GIVEN("a query with a wildcard for array elements") {
+        THEN("each element should be selected by index") {
+            vector<string> paths;
+            query("models.*").each(get, [&](vector<string> const& path, value const*) {
+                paths.push_back(query::join(path));
+                return true;
+            });
+            REQUIRE(paths == vector<string>({ "models.0", "models.1" }));
+        }
+    }
+    GIVEN("a wildcard that selects keys containing '.'") {
+        THEN("the joined path should quote the key") {
+            vector<string> paths;
+            query("interfaces.*").each(get, [&](vector<string> const& path, value const*) {
+                paths.push_back(query::join(path));
+                return true;
+            });
+            REQUIRE(paths == vector<string>({ "interfaces.\"dotted.name\"", "interfaces.eth0", "interfaces.eth1" }));
+        }
+    }
+    GIVEN("a wildcard query that selects nothing") {
+        THEN("the callback should not be called") {
+            bool called = false;
+            query("models.*.ip").each(get, [&](vector<string> const&, value const*) {
+                called = true;
+                return true;
+            });
+            REQUIRE_FALSE(called);
+            REQUIRE_FALSE(query("models.*.ip").evaluate(get));
+        }
+    }
+    GIVEN("a query that starts with '*'") {
+        THEN("it should not be a wildcard") {
+            REQUIRE_FALSE(query("*.ip").wildcard());
+            REQUIRE_FALSE(query("*.ip").evaluate(get));
+        }
+    }
+}
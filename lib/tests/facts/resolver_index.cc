@@ -0,0 +1,84 @@
+#include <catch.hpp>
+#include <facter/facts/collection.hpp>
+#include <internal/facts/resolver_index.hpp>
+
+using namespace std;
+using namespace facter::facts;
+
+struct indexed_resolver : facter::facts::resolver
+{
+    indexed_resolver(string name, vector<string> names, vector<string> const& patterns = {}) :
+        resolver(move(name), move(names), patterns)
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+    }
+};
+
+SCENARIO("getting the anchored prefix of a pattern") {
+    REQUIRE(resolver_index::anchored_prefix("^ipaddress_") == "ipaddress_");
+    REQUIRE(resolver_index::anchored_prefix("^processor[0-9]+$") == "processor");
+    REQUIRE(resolver_index::anchored_prefix("^zone_.+_id$") == "zone_");
+    REQUIRE(resolver_index::anchored_prefix("^foox?") == "foo");
+    REQUIRE(resolver_index::anchored_prefix("^foo\\d") == "foo");
+    REQUIRE(resolver_index::anchored_prefix("^foo|bar") == "");
+    REQUIRE(resolver_index::anchored_prefix("foo") == "");
+    REQUIRE(resolver_index::anchored_prefix("") == "");
+}
+
+SCENARIO("finding resolvers in the index") {
+    resolver_index index;
+    auto first = make_shared<indexed_resolver>("first", vector<string>{ "foo" }, vector<string>{ "^foo_" });
+    auto second = make_shared<indexed_resolver>("second", vector<string>{ "foo", "bar" }, vector<string>{ "_bar$", "^foo_b" });
+    index.add(first);
+    index.add(second);
+
+    GIVEN("a fact name") {
+        THEN("resolvers should be found in the order they were added") {
+            REQUIRE(index.find("foo") == first);
+            REQUIRE(index.find("bar") == second);
+            index.remove(first);
+            REQUIRE(index.find("foo") == second);
+        }
+    }
+    GIVEN("a built-in fact name") {
+        auto third = make_shared<indexed_resolver>("third", vector<string>{ "kernel", "foo" });
+        auto fourth = make_shared<indexed_resolver>("fourth", vector<string>{ "kernel" });
+        index.add(third);
+        index.add(fourth);
+        THEN("resolvers should be found in the order they were added") {
+            REQUIRE(index.find("kernel") == third);
+            index.remove(third);
+            REQUIRE(index.find("kernel") == fourth);
+            index.remove(fourth);
+            REQUIRE_FALSE(index.find("kernel"));
+            REQUIRE(index.find("foo") == first);
+        }
+    }
+    GIVEN("a name matching a pattern") {
+        THEN("resolvers should be found in the order they were added") {
+            REQUIRE(index.find("foo_bar") == first);
+            REQUIRE(index.find("baz_bar") == second);
+            index.remove(first);
+            REQUIRE(index.find("foo_bar") == second);
+            REQUIRE_FALSE(index.find("foo_x"));
+        }
+    }
+    GIVEN("a name that is not indexed") {
+        THEN("no resolver should be found") {
+            REQUIRE_FALSE(index.find("baz"));
+            REQUIRE_FALSE(index.find("fo"));
+        }
+    }
+    GIVEN("an index that has been cleared") {
+        index.add(make_shared<indexed_resolver>("third", vector<string>{ "kernel" }));
+        index.clear();
+        THEN("no resolver should be found") {
+            REQUIRE_FALSE(index.find("kernel"));
+            REQUIRE_FALSE(index.find("foo"));
+            REQUIRE_FALSE(index.find("foo_bar"));
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#include <catch.hpp>
+#include <internal/facts/resolvers/cgroup_resolver.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+
+using namespace std;
+using namespace facter::facts;
+
+struct empty_cgroup_resolver : resolvers::cgroup_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        return {};
+    }
+};
+
+struct unlimited_cgroup_resolver : resolvers::cgroup_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.version = 2;
+        result.path = "/user.slice";
+        io_limit limit;
+        limit.device = "8:0";
+        result.io.emplace_back(move(limit));
+        return result;
+    }
+};
+
+struct limited_cgroup_resolver : resolvers::cgroup_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.version = 2;
+        result.path = "/system.slice/facter.service";
+        result.cpu_quota = 150000;
+        result.cpu_period = 100000;
+        result.memory_max = 536870912;
+        io_limit limit;
+        limit.device = "8:16";
+        limit.read_bps = 2097152;
+        limit.write_iops = 120;
+        result.io.emplace_back(move(limit));
+        result.namespaces.emplace("net", 4026531840);
+        result.namespaces.emplace("pid", 4026531836);
+        return result;
+    }
+};
+
+SCENARIO("using the cgroup resolver") {
+    collection facts;
+    WHEN("data is not present") {
+        facts.add(make_shared<empty_cgroup_resolver>());
+        THEN("facts should not be added") {
+            REQUIRE(facts.size() == 0);
+        }
+    }
+    WHEN("the control group is not limited") {
+        facts.add(make_shared<unlimited_cgroup_resolver>());
+        THEN("only the version and path should be added") {
+            REQUIRE(facts.size() == 1);
+            auto cgroup = facts.get<map_value>(fact::cgroup);
+            REQUIRE(cgroup);
+            REQUIRE(cgroup->size() == 2);
+            auto version = cgroup->get<integer_value>("version");
+            REQUIRE(version);
+            REQUIRE(version->value() == 2);
+            auto path = cgroup->get<string_value>("path");
+            REQUIRE(path);
+            REQUIRE(path->value() == "/user.slice");
+        }
+    }
+    WHEN("the control group is limited") {
+        facts.add(make_shared<limited_cgroup_resolver>());
+        THEN("the limits should be added") {
+            REQUIRE(facts.size() == 2);
+            auto cgroup = facts.get<map_value>(fact::cgroup);
+            REQUIRE(cgroup);
+            REQUIRE(cgroup->size() == 5);
+
+            auto cpu = cgroup->get<map_value>("cpu");
+            REQUIRE(cpu);
+            auto quota = cpu->get<integer_value>("quota");
+            REQUIRE(quota);
+            REQUIRE(quota->value() == 150000);
+            auto period = cpu->get<integer_value>("period");
+            REQUIRE(period);
+            REQUIRE(period->value() == 100000);
+            auto cpus = cpu->get<double_value>("cpus");
+            REQUIRE(cpus);
+            REQUIRE(cpus->value() == Approx(1.5));
+
+            auto memory = cgroup->get<map_value>("memory");
+            REQUIRE(memory);
+            auto max = memory->get<integer_value>("max");
+            REQUIRE(max);
+            REQUIRE(max->value() == 536870912);
+
+            auto io = cgroup->get<map_value>("io");
+            REQUIRE(io);
+            REQUIRE(io->size() == 1);
+            auto device = io->get<map_value>("8:16");
+            REQUIRE(device);
+            REQUIRE(device->size() == 2);
+            auto limit = device->get<integer_value>("rbps");
+            REQUIRE(limit);
+            REQUIRE(limit->value() == 2097152);
+            limit = device->get<integer_value>("wiops");
+            REQUIRE(limit);
+            REQUIRE(limit->value() == 120);
+        }
+        THEN("the namespaces should be added") {
+            auto namespaces = facts.get<map_value>(fact::namespaces);
+            REQUIRE(namespaces);
+            REQUIRE(namespaces->size() == 2);
+            auto ns = namespaces->get<integer_value>("net");
+            REQUIRE(ns);
+            REQUIRE(ns->value() == 4026531840);
+            ns = namespaces->get<integer_value>("pid");
+            REQUIRE(ns);
+            REQUIRE(ns->value() == 4026531836);
+        }
+    }
+}
@@ -109,4 +109,25 @@ SCENARIO("using the disk resolver") {
             REQUIRE(devices->value() == names);
         }
     }
+    GIVEN("legacy facts added on demand") {
+        facts.legacy_facts_on_demand(true);
+        resolver->add_disk("disk0", "vendor0", "model0", "product0", 12345);
+        WHEN("resolving all facts") {
+            facts.resolve({});
+            THEN("the flat facts for each disk should not be added") {
+                REQUIRE(facts.get(fact::disks));
+                REQUIRE(facts.get(fact::block_devices));
+                REQUIRE_FALSE(facts.get("blockdevice_disk0_size"));
+            }
+        }
+        WHEN("a query names a flat fact") {
+            facts.resolve({ "blockdevice_disk0_size" });
+            THEN("the flat facts for each disk should be added") {
+                auto size = facts.get<integer_value>("blockdevice_disk0_size");
+                REQUIRE(size);
+                REQUIRE(size->value() == 12345);
+                REQUIRE(facts.get("blockdevice_disk0_model"));
+            }
+        }
+    }
 }
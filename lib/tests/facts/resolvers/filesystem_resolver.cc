@@ -5,6 +5,8 @@
 #include <facter/facts/scalar_value.hpp>
 #include <facter/facts/map_value.hpp>
 #include <facter/facts/array_value.hpp>
+#include <chrono>
+#include <thread>
 
 using namespace std;
 using namespace facter::facts;
@@ -24,6 +26,14 @@ struct test_filesystem_resolver : filesystem_resolver
         mountpoints.emplace_back(move(mp));
     }
 
+    void add_queried_mountpoint(string name, string filesystem, chrono::milliseconds delay)
+    {
+        mountpoint mp;
+        mp.name = move(name);
+        mp.filesystem = move(filesystem);
+        queried.emplace_back(move(mp), delay);
+    }
+
     void add_filesystem(string filesystem)
     {
         filesystems.emplace(move(filesystem));
@@ -50,10 +60,25 @@ struct test_filesystem_resolver : filesystem_resolver
         result.mountpoints = move(mountpoints);
         result.filesystems = move(filesystems);
         result.partitions = move(partitions);
+        for (auto& entry : queried) {
+            if (is_filesystem_excluded(entry.first.filesystem)) {
+                continue;
+            }
+            auto delay = entry.second;
+            populate_size(entry.first, [=](string const&, uint64_t& size, uint64_t& available) {
+                this_thread::sleep_for(delay);
+                size = 2000;
+                available = 1000;
+                return true;
+            });
+            result.mountpoints.emplace_back(move(entry.first));
+        }
+        queried.clear();
         return result;
     }
 
     vector<mountpoint> mountpoints;
+    vector<pair<mountpoint, chrono::milliseconds>> queried;
     set<string> filesystems;
     vector<partition> partitions;
 };
@@ -197,3 +222,58 @@ SCENARIO("using the file system resolver") {
         }
     }
 }
+
+SCENARIO("querying the sizes of mountpoints") {
+    collection facts;
+    auto resolver = make_shared<test_filesystem_resolver>();
+    facts.add(resolver);
+    facts.filesystem_filter({ "tmpfs" }, chrono::milliseconds(100));
+
+    GIVEN("file systems of an excluded type") {
+        resolver->add_queried_mountpoint("/tmp", "tmpfs", chrono::milliseconds(0));
+        resolver->add_queried_mountpoint("/", "ext4", chrono::milliseconds(0));
+        THEN("their mountpoints should not be resolved") {
+            auto mountpoints = facts.get<map_value>(fact::mountpoints);
+            REQUIRE(mountpoints);
+            REQUIRE(mountpoints->size() == 1);
+            REQUIRE_FALSE(mountpoints->get<map_value>("/tmp"));
+            REQUIRE(mountpoints->get<map_value>("/"));
+        }
+    }
+    GIVEN("a local file system that is slow to respond") {
+        resolver->add_queried_mountpoint("/", "ext4", chrono::milliseconds(200));
+        THEN("its size should be waited for") {
+            auto mountpoint = facts.query<map_value>("mountpoints./");
+            REQUIRE(mountpoint);
+            REQUIRE_FALSE(mountpoint->get<boolean_value>("unavailable"));
+            auto size = mountpoint->get<integer_value>("size_bytes");
+            REQUIRE(size);
+            REQUIRE(size->value() == 2000);
+        }
+    }
+    GIVEN("a remote file system that responds in time") {
+        resolver->add_queried_mountpoint("/mnt/fast", "nfs", chrono::milliseconds(0));
+        THEN("its size should be resolved") {
+            auto mountpoint = facts.query<map_value>("mountpoints./mnt/fast");
+            REQUIRE(mountpoint);
+            auto available = mountpoint->get<integer_value>("available_bytes");
+            REQUIRE(available);
+            REQUIRE(available->value() == 1000);
+        }
+    }
+    GIVEN("a remote file system that does not respond in time") {
+        resolver->add_queried_mountpoint("/mnt/hung", "fuse.sshfs", chrono::milliseconds(1000));
+        auto start = chrono::steady_clock::now();
+        auto mountpoints = facts.get<map_value>(fact::mountpoints);
+        THEN("the mountpoint should be marked as unavailable without waiting for it") {
+            REQUIRE(chrono::steady_clock::now() - start < chrono::milliseconds(900));
+            REQUIRE(mountpoints);
+            auto mountpoint = mountpoints->get<map_value>("/mnt/hung");
+            REQUIRE(mountpoint);
+            auto unavailable = mountpoint->get<boolean_value>("unavailable");
+            REQUIRE(unavailable);
+            REQUIRE(unavailable->value());
+            REQUIRE_FALSE(mountpoint->get<integer_value>("size_bytes"));
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#include <catch.hpp>
+#include <internal/facts/resolvers/load_resolver.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/fact.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+
+using namespace std;
+using namespace facter::facts;
+
+struct empty_load_resolver : resolvers::load_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        return {};
+    }
+};
+
+struct test_load_resolver : resolvers::load_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.load_averages_available = true;
+        result.one = 0.5;
+        result.five = 1.25;
+        result.fifteen = 2;
+        stall some;
+        some.avg10 = 1.5;
+        some.avg60 = 0.75;
+        some.avg300 = 0.25;
+        some.total = 123456;
+        result.pressure["memory"]["some"] = some;
+        result.pressure["memory"]["full"] = stall();
+        result.utilization_available = true;
+        result.cpu_utilization = 37.5;
+        result.disk_queue_length = 1.5;
+        return result;
+    }
+};
+
+SCENARIO("using the load resolver") {
+    collection facts;
+    WHEN("data is not present") {
+        facts.add(make_shared<empty_load_resolver>());
+        THEN("facts should not be added") {
+            REQUIRE(facts.size() == 0);
+        }
+    }
+    WHEN("data is present") {
+        facts.add(make_shared<test_load_resolver>());
+        THEN("the load averages should be added") {
+            REQUIRE(facts.size() == 3);
+            auto averages = facts.get<map_value>(fact::load_averages);
+            REQUIRE(averages);
+            REQUIRE(averages->size() == 3);
+            auto average = averages->get<double_value>("1m");
+            REQUIRE(average);
+            REQUIRE(average->value() == Approx(0.5));
+            average = averages->get<double_value>("5m");
+            REQUIRE(average);
+            REQUIRE(average->value() == Approx(1.25));
+            average = averages->get<double_value>("15m");
+            REQUIRE(average);
+            REQUIRE(average->value() == Approx(2));
+        }
+        THEN("the pressure should be added") {
+            auto pressure = facts.get<map_value>(fact::pressure);
+            REQUIRE(pressure);
+            REQUIRE(pressure->size() == 1);
+            auto memory = pressure->get<map_value>("memory");
+            REQUIRE(memory);
+            REQUIRE(memory->size() == 2);
+            auto some = memory->get<map_value>("some");
+            REQUIRE(some);
+            auto average = some->get<double_value>("avg10");
+            REQUIRE(average);
+            REQUIRE(average->value() == Approx(1.5));
+            average = some->get<double_value>("avg60");
+            REQUIRE(average);
+            REQUIRE(average->value() == Approx(0.75));
+            average = some->get<double_value>("avg300");
+            REQUIRE(average);
+            REQUIRE(average->value() == Approx(0.25));
+            auto total = some->get<integer_value>("total");
+            REQUIRE(total);
+            REQUIRE(total->value() == 123456);
+            auto full = memory->get<map_value>("full");
+            REQUIRE(full);
+            REQUIRE(full->size() == 4);
+        }
+        THEN("the utilization should be added") {
+            auto utilization = facts.get<map_value>(fact::utilization);
+            REQUIRE(utilization);
+            REQUIRE(utilization->size() == 2);
+            auto cpu = utilization->get<double_value>("cpu");
+            REQUIRE(cpu);
+            REQUIRE(cpu->value() == Approx(37.5));
+            auto queue = utilization->get<double_value>("disk_queue_length");
+            REQUIRE(queue);
+            REQUIRE(queue->value() == Approx(1.5));
+        }
+    }
+}
@@ -33,6 +33,35 @@ struct test_memory_resolver : memory_resolver
     }
 };
 
+struct test_numa_memory_resolver : memory_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.mem_total = 10 * 1024 * 1024;
+        result.mem_free = 5 * 1024 * 1024;
+        hugepage_pool pool;
+        pool.size = 2 * 1024 * 1024;
+        pool.total = 512;
+        pool.free = 128;
+        pool.reserved = 64;
+        pool.surplus = 1;
+        result.hugepages.push_back(pool);
+        numa_node node;
+        node.name = "node0";
+        node.total = 8 * 1024 * 1024;
+        node.free = 2 * 1024 * 1024;
+        node.hugepages_total = 512;
+        node.hugepages_free = 128;
+        result.numa_nodes.push_back(node);
+        node.name = "node1";
+        node.total = 0;
+        result.numa_nodes.push_back(node);
+        return result;
+    }
+};
+
 SCENARIO("using the memory resolver") {
     collection facts;
     WHEN("data is not present") {
@@ -130,4 +159,57 @@ SCENARIO("using the memory resolver") {
             REQUIRE(swapsize_mb->value() == Approx(20.0));
         }
     }
+    WHEN("huge page and NUMA data is present") {
+        facts.add(make_shared<test_numa_memory_resolver>());
+        THEN("the huge page pools are added") {
+            auto memory = facts.get<map_value>(fact::memory);
+            REQUIRE(memory);
+            auto hugepages = memory->get<map_value>("hugepages");
+            REQUIRE(hugepages);
+            REQUIRE(hugepages->size() == 1);
+            auto pool = hugepages->get<map_value>("2048kB");
+            REQUIRE(pool);
+            REQUIRE(pool->size() == 6);
+            auto size = pool->get<string_value>("size");
+            REQUIRE(size);
+            REQUIRE(size->value() == "2.00 MiB");
+            auto count = pool->get<integer_value>("size_bytes");
+            REQUIRE(count);
+            REQUIRE(count->value() == 2097152);
+            count = pool->get<integer_value>("total");
+            REQUIRE(count);
+            REQUIRE(count->value() == 512);
+            count = pool->get<integer_value>("free");
+            REQUIRE(count);
+            REQUIRE(count->value() == 128);
+            count = pool->get<integer_value>("reserved");
+            REQUIRE(count);
+            REQUIRE(count->value() == 64);
+            count = pool->get<integer_value>("surplus");
+            REQUIRE(count);
+            REQUIRE(count->value() == 1);
+        }
+        THEN("the memory of nodes with memory is added") {
+            auto memory = facts.get<map_value>(fact::memory);
+            REQUIRE(memory);
+            auto numa = memory->get<map_value>("numa");
+            REQUIRE(numa);
+            REQUIRE(numa->size() == 1);
+            auto node = numa->get<map_value>("node0");
+            REQUIRE(node);
+            REQUIRE(node->size() == 9);
+            auto used = node->get<string_value>("used");
+            REQUIRE(used);
+            REQUIRE(used->value() == "6.00 MiB");
+            auto capacity = node->get<string_value>("capacity");
+            REQUIRE(capacity);
+            REQUIRE(capacity->value() == "75.00%");
+            auto count = node->get<integer_value>("hugepages_total");
+            REQUIRE(count);
+            REQUIRE(count->value() == 512);
+            count = node->get<integer_value>("hugepages_free");
+            REQUIRE(count);
+            REQUIRE(count->value() == 128);
+        }
+    }
 }
@@ -90,6 +90,25 @@ struct test_interface_resolver : networking_resolver
     }
 };
 
+struct test_filtered_interface_resolver : networking_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        for (auto const& name : { "eth0", "eth1", "veth1a2b", "veth3c4d", "cali5e6f" }) {
+            if (!is_interface_included(result, name)) {
+                continue;
+            }
+            interface iface;
+            iface.name = name;
+            iface.address.v4 = string("ip_") + name;
+            result.interfaces.emplace_back(move(iface));
+        }
+        return result;
+    }
+};
+
 SCENARIO("using the networking resolver") {
     collection facts;
     WHEN("data is not present") {
@@ -339,4 +358,82 @@ SCENARIO("using the networking resolver") {
             }
         }
     }
+    WHEN("network interfaces are filtered") {
+        facts.interface_filter({ "eth.*", "veth.*" }, { "veth3.*" });
+        facts.add(make_shared<test_filtered_interface_resolver>());
+        THEN("only the included interfaces that are not excluded are resolved") {
+            auto interfaces_list = facts.get<string_value>(fact::interfaces);
+            REQUIRE(interfaces_list);
+            REQUIRE(interfaces_list->value() == "eth0,eth1,veth1a2b");
+            REQUIRE_FALSE(facts.get<string_value>(fact::ipaddress + string("_cali5e6f")));
+            auto networking = facts.get<map_value>(fact::networking);
+            REQUIRE(networking);
+            REQUIRE_FALSE(networking->get<map_value>("interface_counts"));
+        }
+    }
+    WHEN("network interfaces are summarized") {
+        facts.interface_filter({}, { "veth.*", "cali.*" }, true);
+        facts.add(make_shared<test_filtered_interface_resolver>());
+        THEN("every interface is counted by class") {
+            auto interfaces_list = facts.get<string_value>(fact::interfaces);
+            REQUIRE(interfaces_list);
+            REQUIRE(interfaces_list->value() == "eth0,eth1");
+            auto networking = facts.get<map_value>(fact::networking);
+            REQUIRE(networking);
+            auto counts = networking->get<map_value>("interface_counts");
+            REQUIRE(counts);
+            REQUIRE(counts->size() == 3);
+            auto count = counts->get<integer_value>("eth");
+            REQUIRE(count);
+            REQUIRE(count->value() == 2);
+            count = counts->get<integer_value>("veth");
+            REQUIRE(count);
+            REQUIRE(count->value() == 2);
+            count = counts->get<integer_value>("cali");
+            REQUIRE(count);
+            REQUIRE(count->value() == 1);
+        }
+    }
+}
+
+SCENARIO("formatting network addresses") {
+    GIVEN("MAC addresses") {
+        uint8_t mac[] = { 0x00, 0x1c, 0x42, 0xff, 0x0a, 0xb9 };
+        uint8_t null_mac[6] = {};
+        THEN("they should be formatted as lowercase hexadecimal") {
+            REQUIRE(networking_resolver::macaddress_to_string(mac) == "00:1c:42:ff:0a:b9");
+            REQUIRE(networking_resolver::macaddress_to_string(null_mac) == "");
+            REQUIRE(networking_resolver::macaddress_to_string(nullptr) == "");
+        }
+    }
+    GIVEN("IPv4 addresses") {
+        uint8_t address[] = { 192, 168, 10, 255 };
+        uint8_t zero[4] = {};
+        THEN("they should be formatted in dotted decimal notation") {
+            REQUIRE(networking_resolver::ipv4_to_string(address) == "192.168.10.255");
+            REQUIRE(networking_resolver::ipv4_to_string(zero) == "0.0.0.0");
+        }
+    }
+    GIVEN("IPv6 addresses") {
+        auto format = [](initializer_list<uint16_t> words) {
+            uint8_t bytes[16];
+            size_t i = 0;
+            for (auto word : words) {
+                bytes[i++] = static_cast<uint8_t>(word >> 8);
+                bytes[i++] = static_cast<uint8_t>(word);
+            }
+            return networking_resolver::ipv6_to_string(bytes);
+        };
+        THEN("they should be formatted the same as inet_ntop") {
+            REQUIRE(format({ 0, 0, 0, 0, 0, 0, 0, 0 }) == "::");
+            REQUIRE(format({ 0, 0, 0, 0, 0, 0, 0, 1 }) == "::1");
+            REQUIRE(format({ 0xfe80, 0, 0, 0, 0x21c, 0x42ff, 0xfe0a, 0xb9 }) == "fe80::21c:42ff:fe0a:b9");
+            REQUIRE(format({ 0x2001, 0xdb8, 0, 0, 1, 0, 0, 1 }) == "2001:db8::1:0:0:1");
+            REQUIRE(format({ 0x2001, 0xdb8, 0, 1, 1, 1, 1, 1 }) == "2001:db8:0:1:1:1:1:1");
+            REQUIRE(format({ 0x2001, 0xdb8, 0, 0, 0, 0, 0, 0 }) == "2001:db8::");
+            REQUIRE(format({ 0xffff, 0xffff, 0xffff, 0xffff, 0, 0, 0, 0 }) == "ffff:ffff:ffff:ffff::");
+            REQUIRE(format({ 0, 0, 0, 0, 0, 0xffff, 0xc0a8, 0x0a01 }) == "::ffff:192.168.10.1");
+            REQUIRE(format({ 0, 0, 0, 0, 0, 0, 0xc0a8, 0x0a01 }) == "::192.168.10.1");
+        }
+    }
 }
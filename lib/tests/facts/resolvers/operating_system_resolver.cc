@@ -53,6 +53,35 @@ struct test_os_resolver : operating_system_resolver
     }
 };
 
+struct deferred_os_resolver : operating_system_resolver
+{
+    explicit deferred_os_resolver(bool found) :
+        found(found),
+        calls(0)
+    {
+    }
+
+    bool found;
+    int calls;
+
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.name = "Archlinux";
+        result.find_distro = [this](distribution& distro, string& specification_version) {
+            ++calls;
+            if (!found) {
+                return;
+            }
+            distro.id = "Arch";
+            distro.release = "1.2";
+            specification_version = "1.4";
+        };
+        return result;
+    }
+};
+
 SCENARIO("using the operating system resolver") {
     collection facts;
     WHEN("data is not present") {
@@ -247,3 +276,44 @@ SCENARIO("using the operating system resolver") {
         }
     }
 }
+
+SCENARIO("finding distribution facts when they are accessed") {
+    collection facts;
+    GIVEN("a distribution that is found") {
+        auto resolver = make_shared<deferred_os_resolver>(true);
+        facts.add(resolver);
+        auto os = facts.get<map_value>(fact::os);
+        REQUIRE(os);
+        THEN("it should not be found until a distribution fact is accessed") {
+            REQUIRE(resolver->calls == 0);
+            auto id = facts.get<string_value>(fact::lsb_dist_id);
+            REQUIRE(id);
+            REQUIRE(id->value() == "Arch");
+            REQUIRE(resolver->calls == 1);
+        }
+        THEN("it should only be found once") {
+            auto distro = os->get<map_value>("distro");
+            REQUIRE(distro);
+            REQUIRE(distro->get<string_value>("id"));
+            auto specification = distro->get<string_value>("specification");
+            REQUIRE(specification);
+            REQUIRE(specification->value() == "1.4");
+            auto release = facts.get<string_value>(fact::lsb_dist_major_release);
+            REQUIRE(release);
+            REQUIRE(release->value() == "1");
+            REQUIRE(resolver->calls == 1);
+        }
+    }
+    GIVEN("a distribution that is not found") {
+        auto resolver = make_shared<deferred_os_resolver>(false);
+        facts.add(resolver);
+        THEN("the distribution facts should not be present") {
+            REQUIRE_FALSE(facts.get<string_value>(fact::lsb_dist_id));
+            REQUIRE_FALSE(facts.get<string_value>(fact::lsb_release));
+            auto os = facts.get<map_value>(fact::os);
+            REQUIRE(os);
+            REQUIRE_FALSE(os->get<map_value>("distro"));
+            REQUIRE(os->get<string_value>("name"));
+        }
+    }
+}
@@ -39,6 +39,40 @@ struct test_processor_resolver : processor_resolver
     }
 };
 
+struct test_topology_resolver : processor_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.logical_count = 4;
+        result.physical_count = 1;
+        for (int i = 0; i < 4; ++i) {
+            logical_processor cpu;
+            cpu.id = i;
+            cpu.package = 0;
+            cpu.core = i % 2;
+            cpu.node = i / 2;
+            cpu.max_speed = 2 * 1000 * 1000 * 1000ll;
+            cpu.siblings = i % 2 ? "1,3" : "0,2";
+            result.topology.emplace_back(move(cpu));
+        }
+        cache l2;
+        l2.name = "L2";
+        l2.size = 1024 * 1024;
+        l2.instances = 2;
+        result.caches.emplace_back(move(l2));
+        for (int i = 0; i < 2; ++i) {
+            numa_node node;
+            node.id = i;
+            node.cpus = to_string(i * 2) + "-" + to_string(i * 2 + 1);
+            node.memory = 1024 * 1024 * 1024ull;
+            result.nodes.emplace_back(move(node));
+        }
+        return result;
+    }
+};
+
 SCENARIO("using the processor resolver") {
     collection facts;
     WHEN("data is not present") {
@@ -108,4 +142,64 @@ SCENARIO("using the processor resolver") {
             }
         }
     }
+    WHEN("topology data is present") {
+        facts.add(make_shared<test_topology_resolver>());
+        auto processors = facts.get<map_value>(fact::processors);
+        REQUIRE(processors);
+        auto topology = processors->get<map_value>("topology");
+        REQUIRE(topology);
+        THEN("the cores and threads are counted") {
+            auto count = topology->get<integer_value>("cores");
+            REQUIRE(count);
+            REQUIRE(count->value() == 2);
+            count = topology->get<integer_value>("threads_per_core");
+            REQUIRE(count);
+            REQUIRE(count->value() == 2);
+        }
+        THEN("each logical processor is present") {
+            auto cpus = topology->get<map_value>("cpus");
+            REQUIRE(cpus);
+            REQUIRE(cpus->size() == 4);
+            auto cpu = cpus->get<map_value>("cpu3");
+            REQUIRE(cpu);
+            auto value = cpu->get<integer_value>("core");
+            REQUIRE(value);
+            REQUIRE(value->value() == 1);
+            value = cpu->get<integer_value>("node");
+            REQUIRE(value);
+            REQUIRE(value->value() == 1);
+            value = cpu->get<integer_value>("package");
+            REQUIRE(value);
+            REQUIRE(value->value() == 0);
+            auto siblings = cpu->get<string_value>("siblings");
+            REQUIRE(siblings);
+            REQUIRE(siblings->value() == "1,3");
+            auto speed = cpu->get<string_value>("speed");
+            REQUIRE(speed);
+            REQUIRE(speed->value() == "2.00 GHz");
+        }
+        THEN("the caches and NUMA nodes are present") {
+            auto caches = topology->get<map_value>("caches");
+            REQUIRE(caches);
+            auto l2 = caches->get<map_value>("L2");
+            REQUIRE(l2);
+            auto size = l2->get<string_value>("size");
+            REQUIRE(size);
+            REQUIRE(size->value() == "1.00 MiB");
+            auto instances = l2->get<integer_value>("instances");
+            REQUIRE(instances);
+            REQUIRE(instances->value() == 2);
+            auto nodes = topology->get<map_value>("numa");
+            REQUIRE(nodes);
+            REQUIRE(nodes->size() == 2);
+            auto node = nodes->get<map_value>("node1");
+            REQUIRE(node);
+            auto cpus = node->get<string_value>("cpus");
+            REQUIRE(cpus);
+            REQUIRE(cpus->value() == "2-3");
+            auto memory = node->get<integer_value>("memory_bytes");
+            REQUIRE(memory);
+            REQUIRE(memory->value() == 1024 * 1024 * 1024ll);
+        }
+    }
 }
@@ -3,6 +3,7 @@
 #include <facter/facts/collection.hpp>
 #include <facter/facts/fact.hpp>
 #include <facter/facts/scalar_value.hpp>
+#include <facter/facts/map_value.hpp>
 
 using namespace std;
 using namespace facter::facts;
@@ -36,6 +37,19 @@ struct test_zpool_resolver : zpool_resolver
         data result;
         result.version = "1";
         result.features = { "1", "2", "3" };
+        pool p;
+        p.name = "rpool";
+        p.health = "ONLINE";
+        p.size = 1024;
+        p.free = 768;
+        p.fragmentation = 5;
+        result.pools.emplace_back(move(p));
+        p = pool();
+        p.name = "tank";
+        p.size = 2048;
+        p.free = 2048;
+        p.version = 28;
+        result.pools.emplace_back(move(p));
         return result;
     }
 };
@@ -51,7 +65,7 @@ SCENARIO("using the zpool resolver") {
     WHEN("data is present") {
         facts.add(make_shared<test_zpool_resolver>());
         THEN("flat facts are added") {
-            REQUIRE(facts.size() == 2);
+            REQUIRE(facts.size() == 3);
             auto value = facts.get<string_value>(fact::zpool_version);
             REQUIRE(value);
             REQUIRE(value->value() == "1");
@@ -59,5 +73,42 @@ SCENARIO("using the zpool resolver") {
             REQUIRE(value);
             REQUIRE(value->value() == "1,2,3");
         }
+        THEN("a structured fact is added for the pools") {
+            auto pools = facts.get<map_value>(fact::zpools);
+            REQUIRE(pools);
+            REQUIRE(pools->size() == 2);
+
+            auto pool = pools->get<map_value>("rpool");
+            REQUIRE(pool);
+            REQUIRE(pool->size() == 9);
+            auto total = pool->get<integer_value>("total_bytes");
+            REQUIRE(total);
+            REQUIRE(total->value() == 1024);
+            auto used = pool->get<integer_value>("used_bytes");
+            REQUIRE(used);
+            REQUIRE(used->value() == 256);
+            auto available = pool->get<integer_value>("available_bytes");
+            REQUIRE(available);
+            REQUIRE(available->value() == 768);
+            auto capacity = pool->get<string_value>("capacity");
+            REQUIRE(capacity);
+            REQUIRE(capacity->value() == "25.00%");
+            auto health = pool->get<string_value>("health");
+            REQUIRE(health);
+            REQUIRE(health->value() == "ONLINE");
+            auto fragmentation = pool->get<integer_value>("fragmentation");
+            REQUIRE(fragmentation);
+            REQUIRE(fragmentation->value() == 5);
+            REQUIRE_FALSE(pool->get<integer_value>("version"));
+
+            pool = pools->get<map_value>("tank");
+            REQUIRE(pool);
+            REQUIRE(pool->size() == 8);
+            REQUIRE_FALSE(pool->get<string_value>("health"));
+            REQUIRE_FALSE(pool->get<integer_value>("fragmentation"));
+            auto version = pool->get<integer_value>("version");
+            REQUIRE(version);
+            REQUIRE(version->value() == 28);
+        }
     }
 }
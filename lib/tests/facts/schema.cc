@@ -11,6 +11,7 @@
 #include "../fixtures.hpp"
 
 // Include all base resolvers here
+#include <internal/facts/resolvers/cgroup_resolver.hpp>
 #include <internal/facts/resolvers/disk_resolver.hpp>
 #include <internal/facts/resolvers/dmi_resolver.hpp>
 #include <internal/facts/resolvers/ec2_resolver.hpp>
@@ -18,6 +19,7 @@
 #include <internal/facts/resolvers/gce_resolver.hpp>
 #include <internal/facts/resolvers/identity_resolver.hpp>
 #include <internal/facts/resolvers/kernel_resolver.hpp>
+#include <internal/facts/resolvers/load_resolver.hpp>
 #include <internal/facts/resolvers/memory_resolver.hpp>
 #include <internal/facts/resolvers/networking_resolver.hpp>
 #include <internal/facts/resolvers/operating_system_resolver.hpp>
@@ -40,6 +42,31 @@ using namespace facter::util;
 // For every base resolver, implement a resolver that outputs the minimum values to pass schema validation
 // We don't care about the actual data in the facts, only that it conforms to the schema
 
+struct cgroup_resolver : resolvers::cgroup_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.version = 2;
+        result.path = "/system.slice/facter.service";
+        result.cpu_quota = 200000;
+        result.cpu_period = 100000;
+        result.memory_max = 1073741824;
+        io_limit limit;
+        limit.device = "8:0";
+        limit.read_bps = 1;
+        limit.write_bps = 2;
+        limit.read_iops = 3;
+        limit.write_iops = 4;
+        result.io.emplace_back(move(limit));
+        for (auto name : { "cgroup", "ipc", "mnt", "net", "pid", "time", "user", "uts" }) {
+            result.namespaces.emplace(name, 4026531835);
+        }
+        return result;
+    }
+};
+
 struct disk_resolver : resolvers::disk_resolver
 {
     data collect_data(collection& facts) override
@@ -95,6 +122,11 @@ struct filesystem_resolver : resolvers::filesystem_resolver
         mp.options.push_back("option");
         result.mountpoints.emplace_back(move(mp));
 
+        mountpoint unavailable;
+        unavailable.name = "unavailable";
+        unavailable.unavailable = true;
+        result.mountpoints.emplace_back(move(unavailable));
+
         result.filesystems.insert("filesystem");
 
         partition p;
@@ -138,6 +170,27 @@ struct kernel_resolver : resolvers::kernel_resolver
     }
 };
 
+struct load_resolver : resolvers::load_resolver
+{
+ protected:
+    virtual data collect_data(collection& facts) override
+    {
+        data result;
+        result.load_averages_available = true;
+        result.one = 1;
+        result.five = 5;
+        result.fifteen = 15;
+        for (auto resource : { "cpu", "io", "memory" }) {
+            result.pressure[resource]["some"] = stall();
+            result.pressure[resource]["full"] = stall();
+        }
+        result.utilization_available = true;
+        result.cpu_utilization = 12.5;
+        result.disk_queue_length = 0.25;
+        return result;
+    }
+};
+
 struct memory_resolver : resolvers::memory_resolver
 {
  protected:
@@ -149,6 +202,15 @@ struct memory_resolver : resolvers::memory_resolver
         result.mem_free = 5 * 1024 * 1024;
         result.swap_total = 20 * 1024 * 1024;
         result.swap_free = 4 * 1024 * 1024;
+        hugepage_pool pool;
+        pool.size = 2 * 1024 * 1024;
+        pool.total = 1;
+        result.hugepages.push_back(pool);
+        numa_node node;
+        node.name = "node0";
+        node.total = 10 * 1024 * 1024;
+        node.hugepages_total = 1;
+        result.numa_nodes.push_back(node);
         return result;
     }
 };
@@ -177,6 +239,7 @@ struct networking_resolver : resolvers::networking_resolver
         iface.macaddress = "00:00:00:00:00:00";
         iface.mtu = 12345;
         result.interfaces.emplace_back(move(iface));
+        result.interface_counts["interface"] = 1;
         return result;
     }
 };
@@ -232,6 +295,24 @@ protected:
                 "processor4"
         };
         result.speed = 10 * 1000 * 1000 * 1000ull;
+        logical_processor cpu;
+        cpu.id = 0;
+        cpu.package = 0;
+        cpu.core = 0;
+        cpu.node = 0;
+        cpu.max_speed = 10 * 1000 * 1000 * 1000ll;
+        cpu.siblings = "0";
+        result.topology.emplace_back(move(cpu));
+        cache l1;
+        l1.name = "L1d";
+        l1.size = 32 * 1024;
+        l1.instances = 1;
+        result.caches.emplace_back(move(l1));
+        numa_node node;
+        node.id = 0;
+        node.cpus = "0";
+        node.memory = 1024 * 1024 * 1024ull;
+        result.nodes.emplace_back(move(node));
         return result;
     }
 };
@@ -379,6 +460,14 @@ protected:
         data result;
         result.version = 1;
         result.features = { "1", "2", "3" };
+        pool p;
+        p.name = "rpool";
+        p.health = "ONLINE";
+        p.size = 21474836480;
+        p.free = 10737418240;
+        p.fragmentation = 4;
+        p.version = 28;
+        result.pools.emplace_back(move(p));
         return result;
     }
 };
@@ -387,6 +476,7 @@ void add_all_facts(collection& facts)
 {
     facts.add("cfacterversion", make_value<string_value>("version"));
     facts.add("facterversion", make_value<string_value>("version"));
+    facts.add(make_shared<cgroup_resolver>());
     facts.add(make_shared<disk_resolver>());
     facts.add(make_shared<dmi_resolver>());
     facts.add(make_shared<filesystem_resolver>());
@@ -395,8 +485,12 @@ void add_all_facts(collection& facts)
     facts.add(fact::ec2_userdata, make_value<string_value>("user data"));
     // TODO: refactor the GCE resolver to use the "collect_data" pattern
     facts.add(fact::gce, make_value<map_value>());
+    facts.add(fact::az_metadata, make_value<map_value>());
+    facts.add(fact::openstack_metadata, make_value<map_value>());
+    facts.add(fact::digitalocean_metadata, make_value<map_value>());
     facts.add(make_shared<identity_resolver>());
     facts.add(make_shared<kernel_resolver>());
+    facts.add(make_shared<load_resolver>());
     facts.add(make_shared<memory_resolver>());
     facts.add(make_shared<networking_resolver>());
     facts.add(make_shared<operating_system_resolver>());
@@ -0,0 +1,166 @@
+#include <catch.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace facter::facts;
+
+struct snapshot_resolver : facter::facts::resolver
+{
+    snapshot_resolver() :
+        resolver("snapshot", { "foo", "bar" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        facts.add("foo", make_value<string_value>("value"));
+        auto map = make_value<map_value>();
+        map->add("first", make_value<integer_value>(1));
+        auto array = make_value<array_value>();
+        array->add(make_value<string_value>("element"));
+        map->add("second", move(array));
+        facts.add("bar", move(map));
+    }
+};
+
+SCENARIO("taking a snapshot of a fact collection") {
+    collection facts;
+    facts.add(make_shared<snapshot_resolver>());
+    facts.add("hidden", make_value<string_value>("secret", true));
+    facts.add("lazy", make_value<lazy_value>([]() {
+        return make_value<integer_value>(42);
+    }));
+    facts.add("missing", make_value<lazy_value>([]() {
+        return unique_ptr<value>();
+    }));
+    auto snap = facts.take_snapshot();
+    REQUIRE(snap);
+
+    GIVEN("a snapshot of resolved facts") {
+        THEN("it should contain a copy of each fact with a value") {
+            REQUIRE(snap->size() == 4);
+            REQUIRE_FALSE(snap->empty());
+            auto str = snap->get<string_value>("foo");
+            REQUIRE(str);
+            REQUIRE(str->value() == "value");
+            REQUIRE(str != facts.get<string_value>("foo"));
+            auto integer = snap->get<integer_value>("lazy");
+            REQUIRE(integer);
+            REQUIRE(integer->value() == 42);
+            REQUIRE_FALSE((*snap)["missing"]);
+            REQUIRE((*snap)["hidden"]->hidden());
+        }
+        THEN("it should answer queries") {
+            auto integer = snap->query<integer_value>("bar.first");
+            REQUIRE(integer);
+            REQUIRE(integer->value() == 1);
+            auto str = snap->query<string_value>("bar.second.0");
+            REQUIRE(str);
+            REQUIRE(str->value() == "element");
+            REQUIRE_FALSE(snap->query("bar.third"));
+        }
+        THEN("it should write the same output as the collection") {
+            ostringstream expected;
+            facts.write(expected, format::json);
+            ostringstream actual;
+            snap->write(actual, format::json);
+            REQUIRE(actual.str() == expected.str());
+
+            ostringstream queried;
+            snap->write(queried, format::hash, { "bar.first", "foo" });
+            REQUIRE(queried.str() == "bar.first => 1\nfoo => value");
+        }
+        THEN("enumeration should stop when the callback returns false") {
+            size_t count = 0;
+            snap->each([&](string const&, value const*) {
+                ++count;
+                return false;
+            });
+            REQUIRE(count == 1);
+        }
+    }
+    GIVEN("a collection that changes after the snapshot was taken") {
+        facts.remove("foo");
+        facts.add("baz", make_value<string_value>("new"));
+        THEN("the snapshot should not change") {
+            REQUIRE(snap->get<string_value>("foo"));
+            REQUIRE_FALSE(snap->get<string_value>("baz"));
+        }
+    }
+    GIVEN("a snapshot taken after a refresh") {
+        collection refreshed;
+        refreshed.add(make_shared<snapshot_resolver>());
+        refreshed.add("hidden", make_value<string_value>("secret", true));
+        refreshed.add("lazy", make_value<integer_value>(43));
+        auto next = refreshed.take_snapshot(snap);
+        THEN("unchanged facts should be shared with the previous snapshot") {
+            REQUIRE(next->share("foo") == snap->share("foo"));
+            REQUIRE(next->share("bar") == snap->share("bar"));
+            REQUIRE(next->share("hidden") == snap->share("hidden"));
+        }
+        THEN("changed facts should not be shared with the previous snapshot") {
+            REQUIRE(next->share("lazy") != snap->share("lazy"));
+            REQUIRE(next->get<integer_value>("lazy")->value() == 43);
+            REQUIRE(snap->get<integer_value>("lazy")->value() == 42);
+        }
+    }
+    GIVEN("a snapshot taken after a hash changed") {
+        collection refreshed;
+        auto map = make_value<map_value>();
+        map->add("first", make_value<integer_value>(2));
+        auto array = make_value<array_value>();
+        array->add(make_value<string_value>("element"));
+        map->add("second", move(array));
+        refreshed.add("bar", move(map));
+        auto next = refreshed.take_snapshot(snap);
+        THEN("the unchanged elements of the hash should be shared") {
+            REQUIRE(next->share("bar") != snap->share("bar"));
+            REQUIRE(next->get<map_value>("bar")->share("second") == snap->get<map_value>("bar")->share("second"));
+            REQUIRE(next->query<integer_value>("bar.first")->value() == 2);
+        }
+    }
+    GIVEN("a snapshot that outlives the collection") {
+        shared_ptr<snapshot const> outlived;
+        {
+            collection other;
+            other.add("foo", make_value<string_value>("bar"));
+            outlived = other.take_snapshot();
+        }
+        THEN("it should still be readable") {
+            auto str = outlived->get<string_value>("foo");
+            REQUIRE(str);
+            REQUIRE(str->value() == "bar");
+        }
+    }
+    GIVEN("readers on multiple threads") {
+        atomic<size_t> failures(0);
+        vector<boost::thread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([snap, &failures]() {
+                for (int j = 0; j < 100; ++j) {
+                    ostringstream output;
+                    snap->write(output, format::yaml, { "foo", "bar.second" });
+                    auto integer = snap->query<integer_value>("bar.first");
+                    if (!integer || integer->value() != 1 || output.str() != "bar.second:\n  - element\nfoo: value") {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        THEN("each reader should see the same facts") {
+            REQUIRE(failures == 0);
+        }
+    }
+}
@@ -58,5 +58,12 @@ SCENARIO("using a string fact value") {
                 REQUIRE(stream.str() == "foobar");
             }
         }
+    }    GIVEN("a range of characters") {
+        char const buffer[] = "foobar";
+        auto value = make_value<string_value>(buffer, buffer + 3, true);
+        THEN("it should have the value of the range") {
+            REQUIRE(value->value() == "foo");
+            REQUIRE(value->hidden());
+        }
     }
 }
@@ -0,0 +1,51 @@
+#include <catch.hpp>
+#include <facter/facts/symbol.hpp>
+#include <boost/thread/thread.hpp>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace facter::facts;
+
+SCENARIO("interning names") {
+    GIVEN("symbols with the same name") {
+        symbol first("foo");
+        symbol second(string("foo"));
+        THEN("they should refer to the same string") {
+            REQUIRE(first == second);
+            REQUIRE(&first.str() == &second.str());
+            REQUIRE_FALSE(first < second);
+        }
+    }
+    GIVEN("symbols with different names") {
+        symbol first("bar");
+        symbol second("foo");
+        THEN("they should be ordered by name") {
+            REQUIRE(first != second);
+            REQUIRE(first < second);
+            REQUIRE_FALSE(second < first);
+            ostringstream output;
+            output << first;
+            REQUIRE(output.str() == "bar");
+            string const& name = second;
+            REQUIRE(name == "foo");
+        }
+    }
+    GIVEN("names interned on multiple threads") {
+        vector<string const*> names(8);
+        vector<boost::thread> threads;
+        for (size_t i = 0; i < names.size(); ++i) {
+            threads.emplace_back([&names, i]() {
+                names[i] = &symbol("interned_on_threads").str();
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        THEN("every thread should get the same string") {
+            for (auto name : names) {
+                REQUIRE(name == names.front());
+            }
+        }
+    }
+}
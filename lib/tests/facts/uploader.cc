@@ -0,0 +1,298 @@
+#include <catch.hpp>
+#include <facter/facts/uploader.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <internal/facts/msgpack.hpp>
+#include <boost/asio.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+using namespace facter::facts;
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+// A minimal HTTP endpoint that records the bodies POSTed to it and answers with the given status codes
+struct upload_endpoint
+{
+    explicit upload_endpoint(deque<int> statuses) :
+        _acceptor(_service, tcp::endpoint(asio::ip::address_v4::loopback(), 0)),
+        _statuses(move(statuses)),
+        _thread([this]() { serve(); })
+    {
+    }
+
+    ~upload_endpoint()
+    {
+        // Connections may be kept open by the client, so close the current connection and wake the pending accept
+        _stopping = true;
+        boost::system::error_code ec;
+        {
+            lock_guard<mutex> lock(_mutex);
+            if (_socket) {
+                _socket->shutdown(tcp::socket::shutdown_both, ec);
+            }
+        }
+        tcp::socket waking(_service);
+        waking.connect(_acceptor.local_endpoint(), ec);
+        _thread.join();
+    }
+
+    string url() const
+    {
+        return "http://127.0.0.1:" + boost::lexical_cast<string>(_acceptor.local_endpoint().port()) + "/facts";
+    }
+
+    vector<string> bodies()
+    {
+        lock_guard<mutex> lock(_mutex);
+        return _bodies;
+    }
+
+ private:
+    void serve()
+    {
+        while (!_stopping) {
+            tcp::socket socket(_service);
+            boost::system::error_code ec;
+            _acceptor.accept(socket, ec);
+            if (ec) {
+                return;
+            }
+            {
+                lock_guard<mutex> lock(_mutex);
+                if (_stopping) {
+                    return;
+                }
+                _socket = &socket;
+            }
+            try {
+                handle(socket);
+            } catch (exception&) {
+                // The connection was closed
+            }
+            lock_guard<mutex> lock(_mutex);
+            _socket = nullptr;
+        }
+    }
+
+    void handle(tcp::socket& socket)
+    {
+        asio::streambuf buffer;
+        while (true) {
+            // Requests are read one after another, as the client reuses its connection
+            asio::read_until(socket, buffer, "\r\n\r\n");
+            istream input(&buffer);
+            string line;
+            size_t length = 0;
+            bool expect = false;
+            while (getline(input, line) && line != "\r") {
+                boost::trim(line);
+                if (boost::istarts_with(line, "Content-Length:")) {
+                    length = boost::lexical_cast<size_t>(boost::trim_copy(line.substr(15)));
+                } else if (boost::iequals(line, "Expect: 100-continue")) {
+                    expect = true;
+                }
+            }
+            if (expect) {
+                asio::write(socket, asio::buffer(string("HTTP/1.1 100 Continue\r\n\r\n")));
+            }
+            if (buffer.size() < length) {
+                asio::read(socket, buffer, asio::transfer_exactly(length - buffer.size()));
+            }
+            string body(length, '\0');
+            input.read(&body[0], length);
+
+            int status = 200;
+            {
+                lock_guard<mutex> lock(_mutex);
+                _bodies.push_back(move(body));
+                if (!_statuses.empty()) {
+                    status = _statuses.front();
+                    _statuses.pop_front();
+                }
+            }
+            auto response = "HTTP/1.1 " + boost::lexical_cast<string>(status) + " Status\r\nContent-Length: 0\r\n\r\n";
+            asio::write(socket, asio::buffer(response));
+        }
+    }
+
+    asio::io_service _service;
+    tcp::acceptor _acceptor;
+    mutex _mutex;
+    tcp::socket* _socket = nullptr;
+    atomic<bool> _stopping{ false };
+    deque<int> _statuses;
+    vector<string> _bodies;
+    boost::thread _thread;
+};
+
+static vector<unique_ptr<value>> decode(string const& body)
+{
+    string data;
+    {
+        boost::iostreams::filtering_istream stream;
+        stream.push(boost::iostreams::gzip_decompressor());
+        stream.push(boost::iostreams::array_source(body.data(), body.size()));
+        boost::iostreams::copy(stream, boost::iostreams::back_inserter(data));
+    }
+    vector<unique_ptr<value>> sets;
+    char const* it = data.data();
+    char const* end = it + data.size();
+    while (it < end) {
+        sets.emplace_back(from_msgpack(it, end));
+    }
+    return sets;
+}
+
+SCENARIO("uploading facts") {
+    upload_options options;
+    options.retries = 0;
+    options.retry_delay = chrono::milliseconds(1);
+
+    collection facts;
+    facts.add("kernel", make_value<string_value>("Linux"));
+    facts.add("processorcount", make_value<integer_value>(4));
+    facts.add("secret", make_value<string_value>("hidden", true));
+
+    GIVEN("an endpoint that accepts every upload") {
+        upload_endpoint endpoint({});
+        options.url = endpoint.url();
+        WHEN("every fact is uploaded") {
+            uploader uploading(options);
+            uploading.add(facts);
+            REQUIRE(uploading.upload());
+            THEN("a full fact set without hidden facts should be posted") {
+                auto bodies = endpoint.bodies();
+                REQUIRE(bodies.size() == 1);
+                auto sets = decode(bodies[0]);
+                REQUIRE(sets.size() == 1);
+                auto fact_set = dynamic_cast<map_value const*>(sets[0].get());
+                REQUIRE(fact_set);
+                REQUIRE(fact_set->get<boolean_value>("full")->value());
+                auto values = fact_set->get<map_value>("facts");
+                REQUIRE(values->size() == 2);
+                REQUIRE(values->get<string_value>("kernel")->value() == "Linux");
+                REQUIRE(values->get<integer_value>("processorcount")->value() == 4);
+                REQUIRE(uploading.pending() == 0);
+            }
+        }
+        WHEN("a snapshot of the facts is uploaded") {
+            uploader uploading(options);
+            uploading.add(*facts.take_snapshot());
+            REQUIRE(uploading.upload());
+            THEN("the same fact set should be posted as for the collection") {
+                auto bodies = endpoint.bodies();
+                REQUIRE(bodies.size() == 1);
+                auto sets = decode(bodies[0]);
+                REQUIRE(sets.size() == 1);
+                auto fact_set = dynamic_cast<map_value const*>(sets[0].get());
+                REQUIRE(fact_set);
+                REQUIRE(fact_set->get<boolean_value>("full")->value());
+                auto values = fact_set->get<map_value>("facts");
+                REQUIRE(values->size() == 2);
+                REQUIRE(values->get<string_value>("kernel")->value() == "Linux");
+                REQUIRE(values->get<integer_value>("processorcount")->value() == 4);
+            }
+        }
+        WHEN("only changes are uploaded") {
+            options.changes_only = true;
+            uploader uploading(options);
+            uploading.add(facts);
+            REQUIRE(uploading.upload());
+
+            collection changed;
+            changed.add("kernel", make_value<string_value>("Linux"));
+            changed.add("processorcount", make_value<integer_value>(8));
+            changed.add("uptime", make_value<string_value>("1 day"));
+            uploading.add(changed);
+            REQUIRE(uploading.upload());
+            THEN("the second fact set should have only the changes") {
+                auto bodies = endpoint.bodies();
+                REQUIRE(bodies.size() == 2);
+                auto sets = decode(bodies[1]);
+                REQUIRE(sets.size() == 1);
+                auto fact_set = dynamic_cast<map_value const*>(sets[0].get());
+                REQUIRE(fact_set);
+                REQUIRE_FALSE(fact_set->get<boolean_value>("full")->value());
+                auto values = fact_set->get<map_value>("facts");
+                REQUIRE(values->size() == 2);
+                REQUIRE(values->get<integer_value>("processorcount")->value() == 8);
+                REQUIRE(values->get<string_value>("uptime")->value() == "1 day");
+                auto removed = fact_set->get<array_value>("removed");
+                REQUIRE(removed->size() == 0);
+            }
+        }
+    }
+    GIVEN("an endpoint that fails the first upload") {
+        upload_endpoint endpoint({ 503 });
+        options.url = endpoint.url();
+        options.changes_only = true;
+        uploader uploading(options);
+        uploading.add(facts);
+        REQUIRE_FALSE(uploading.upload());
+        REQUIRE(uploading.pending() == 1);
+
+        collection changed;
+        changed.add("kernel", make_value<string_value>("Linux"));
+        uploading.add(changed);
+        REQUIRE(uploading.upload());
+        THEN("the pending fact sets should be uploaded together") {
+            auto bodies = endpoint.bodies();
+            REQUIRE(bodies.size() == 2);
+            auto sets = decode(bodies[1]);
+            REQUIRE(sets.size() == 2);
+            auto first = dynamic_cast<map_value const*>(sets[0].get());
+            auto second = dynamic_cast<map_value const*>(sets[1].get());
+            REQUIRE(first->get<boolean_value>("full")->value());
+            REQUIRE_FALSE(second->get<boolean_value>("full")->value());
+            auto removed = second->get<array_value>("removed");
+            REQUIRE(removed->size() == 1);
+            REQUIRE(removed->get<string_value>(0)->value() == "processorcount");
+            REQUIRE(uploading.pending() == 0);
+        }
+    }
+    GIVEN("an endpoint that fails and then accepts a retry") {
+        upload_endpoint endpoint({ 500 });
+        options.url = endpoint.url();
+        options.retries = 2;
+        uploader uploading(options);
+        uploading.add(facts);
+        THEN("the upload should be retried") {
+            REQUIRE(uploading.upload());
+            REQUIRE(endpoint.bodies().size() == 2);
+        }
+    }
+    GIVEN("an endpoint that rejects an upload") {
+        upload_endpoint endpoint({ 400 });
+        options.url = endpoint.url();
+        options.retries = 2;
+        options.changes_only = true;
+        uploader uploading(options);
+        uploading.add(facts);
+        REQUIRE_FALSE(uploading.upload());
+        THEN("the upload should not be retried and the next fact set should have every fact") {
+            REQUIRE(endpoint.bodies().size() == 1);
+            REQUIRE(uploading.pending() == 0);
+            uploading.add(facts);
+            REQUIRE(uploading.upload());
+            auto sets = decode(endpoint.bodies()[1]);
+            REQUIRE(sets.size() == 1);
+            auto fact_set = dynamic_cast<map_value const*>(sets[0].get());
+            REQUIRE(fact_set->get<boolean_value>("full")->value());
+            REQUIRE(fact_set->get<map_value>("facts")->size() == 2);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#include <catch.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <internal/facts/value_arena.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+using namespace std;
+using namespace facter::facts;
+
+SCENARIO("allocating values from an arena") {
+    GIVEN("no arena") {
+        THEN("values should be allocated individually") {
+            REQUIRE_FALSE(scoped_arena::current());
+            auto val = make_value<string_value>("foo");
+            REQUIRE(val->value() == "foo");
+        }
+    }
+    GIVEN("an arena for the calling thread") {
+        unique_ptr<array_value> array;
+        {
+            value_arena arena(1024);
+            scoped_arena allocating(&arena);
+            REQUIRE(scoped_arena::current() == &arena);
+            array = make_value<array_value>();
+            for (int i = 0; i < 100; ++i) {
+                auto map = make_value<map_value>();
+                map->add("index", make_value<integer_value>(i));
+                array->add(move(map));
+            }
+            {
+                scoped_arena individually(nullptr);
+                REQUIRE_FALSE(scoped_arena::current());
+            }
+            REQUIRE(scoped_arena::current() == &arena);
+        }
+        THEN("the values should outlive the arena") {
+            REQUIRE_FALSE(scoped_arena::current());
+            REQUIRE(array->size() == 100);
+            REQUIRE(array->get<map_value>(99)->get<integer_value>("index")->value() == 99);
+        }
+    }
+    GIVEN("an arena shared by multiple threads") {
+        value_arena arena(256);
+        vector<unique_ptr<string_value>> values(8);
+        vector<boost::thread> threads;
+        for (size_t i = 0; i < values.size(); ++i) {
+            threads.emplace_back([&, i]() {
+                scoped_arena allocating(&arena);
+                for (int j = 0; j < 100; ++j) {
+                    values[i] = make_value<string_value>(to_string(i));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        THEN("each thread's values should be intact") {
+            for (size_t i = 0; i < values.size(); ++i) {
+                REQUIRE(values[i]->value() == to_string(i));
+            }
+        }
+    }
+}
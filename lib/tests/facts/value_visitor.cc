@@ -0,0 +1,88 @@
+#include <catch.hpp>
+#include <facter/facts/value_visitor.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace facter::facts;
+
+struct recording_visitor : value_visitor
+{
+    virtual void visit(string_value const& val) override
+    {
+        output << "string:" << val.value() << ' ';
+    }
+
+    virtual void visit(integer_value const& val) override
+    {
+        output << "integer:" << val.value() << ' ';
+    }
+
+    virtual void visit(array_value const& val) override
+    {
+        output << "array ";
+        val.each([this](value const* element) {
+            facter::facts::visit(*element, *this);
+            return true;
+        });
+    }
+
+    virtual void visit(map_value const& val) override
+    {
+        output << "map ";
+        val.each([this](string const&, value const* element) {
+            facter::facts::visit(*element, *this);
+            return true;
+        });
+    }
+
+    ostringstream output;
+};
+
+SCENARIO("checking the type of a value") {
+    GIVEN("values of each type") {
+        string_value str("foo");
+        integer_value integer(1);
+        boolean_value boolean(true);
+        double_value dbl(1.5);
+        array_value array;
+        map_value map;
+        lazy_value lazy([]() { return make_value<string_value>("bar"); });
+        THEN("each value should have the type tag of its type") {
+            REQUIRE(str.type() == value_type::string);
+            REQUIRE(integer.type() == value_type::integer);
+            REQUIRE(boolean.type() == value_type::boolean);
+            REQUIRE(dbl.type() == value_type::floating_point);
+            REQUIRE(array.type() == value_type::array);
+            REQUIRE(map.type() == value_type::map);
+            REQUIRE(lazy.type() == value_type::lazy);
+        }
+        THEN("values should only cast to their own type") {
+            REQUIRE(str.as<string_value>() == &str);
+            REQUIRE_FALSE(str.as<integer_value>());
+            REQUIRE(str.as<value>() == &str);
+            REQUIRE(value_cast<map_value>(&map) == &map);
+            REQUIRE_FALSE(value_cast<map_value>(&array));
+            REQUIRE_FALSE(value_cast<map_value>(nullptr));
+            REQUIRE_FALSE(lazy.as<string_value>());
+        }
+        THEN("moved values should keep their type tag") {
+            string_value moved(move(str));
+            REQUIRE(moved.type() == value_type::string);
+        }
+    }
+}
+
+SCENARIO("visiting a value") {
+    map_value map;
+    auto array = make_value<array_value>();
+    array->add(make_value<integer_value>(1));
+    array->add(make_value<lazy_value>([]() { return make_value<string_value>("lazy"); }));
+    map.add("array", move(array));
+    recording_visitor visitor;
+    visit(map, visitor);
+    REQUIRE(visitor.output.str() == "map array integer:1 string:lazy ");
+}
@@ -0,0 +1,87 @@
+#include <catch.hpp>
+#include <internal/facts/yaml_writer.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/lazy_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace facter::facts;
+
+SCENARIO("writing facts as YAML") {
+    ostringstream output;
+    yaml_writer writer(output);
+
+    GIVEN("no facts") {
+        writer.end();
+        THEN("an empty map should be written") {
+            REQUIRE(output.str() == "{}");
+        }
+    }
+    GIVEN("scalar facts") {
+        writer.write("string", make_value<string_value>("hello").get());
+        writer.write("integer", make_value<integer_value>(-5).get());
+        writer.write("boolean", make_value<boolean_value>(true).get());
+        writer.write("double", make_value<double_value>(42.4242).get());
+        writer.write("missing", nullptr);
+        writer.end();
+        THEN("each fact should be written on its own line") {
+            REQUIRE(output.str() == "string: hello\ninteger: -5\nboolean: true\ndouble: 42.4242\nmissing: \"\"");
+        }
+    }
+    GIVEN("strings that cannot be written as plain scalars") {
+        writer.write("1.0", make_value<string_value>("1.0").get());
+        writer.write("colon", make_value<string_value>("a: b").get());
+        writer.write("comment", make_value<string_value>("a #b").get());
+        writer.write("indicator", make_value<string_value>("*star").get());
+        writer.write("empty", make_value<string_value>("").get());
+        writer.write("null", make_value<string_value>("null").get());
+        writer.write("escapes", make_value<string_value>("\"quoted\"\n\\\t").get());
+        writer.end();
+        THEN("they should be double quoted") {
+            REQUIRE(output.str() ==
+                "\"1.0\": \"1.0\"\n"
+                "colon: \"a: b\"\n"
+                "comment: \"a #b\"\n"
+                "indicator: \"*star\"\n"
+                "empty: \"\"\n"
+                "\"null\": \"null\"\n"
+                "escapes: \"\\\"quoted\\\"\\n\\\\\\t\"");
+        }
+    }
+    GIVEN("structured facts") {
+        auto map = make_value<map_value>();
+        map->add("first", make_value<integer_value>(1));
+        map->add("second", make_value<array_value>());
+        auto array = make_value<array_value>();
+        array->add(make_value<string_value>("1"));
+        auto nested = make_value<array_value>();
+        nested->add(make_value<integer_value>(2));
+        nested->add(make_value<lazy_value>([]() { return unique_ptr<value>(); }));
+        array->add(move(nested));
+        auto element = make_value<map_value>();
+        element->add("a", make_value<boolean_value>(false));
+        element->add("b", make_value<map_value>());
+        array->add(move(element));
+        map->add("third", move(array));
+        writer.write("map", map.get());
+        writer.write("lazy", make_value<lazy_value>([]() { return unique_ptr<value>(); }).get());
+        writer.end();
+        THEN("they should be written in block style") {
+            REQUIRE(output.str() ==
+                "map:\n"
+                "  first: 1\n"
+                "  second:\n"
+                "    []\n"
+                "  third:\n"
+                "    - \"1\"\n"
+                "    -\n"
+                "      - 2\n"
+                "    - a: false\n"
+                "      b:\n"
+                "        {}\n"
+                "lazy: ~");
+        }
+    }
+}
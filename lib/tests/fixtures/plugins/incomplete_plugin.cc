@@ -0,0 +1,7 @@
+// A shared library that exports a plugin version but no factory; it should not be loaded
+#include <facter/facts/plugin.hpp>
+
+extern "C" LIBFACTER_PLUGIN_EXPORT char const* facter_plugin_version()
+{
+    return LIBFACTER_VERSION;
+}
@@ -0,0 +1,29 @@
+// A fact plugin that claims to be built for another version of facter; it should not be loaded
+#include <facter/facts/plugin.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/scalar_value.hpp>
+
+using namespace std;
+using namespace facter::facts;
+
+struct mismatched_resolver : resolver
+{
+    mismatched_resolver() : resolver("mismatched plugin", { "mismatched_fact" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        facts.add("mismatched_fact", make_value<string_value>("from mismatched plugin"));
+    }
+};
+
+extern "C" LIBFACTER_PLUGIN_EXPORT char const* facter_plugin_version()
+{
+    return "0.0.0-mismatched";
+}
+
+extern "C" LIBFACTER_PLUGIN_EXPORT void facter_plugin_resolvers(vector<shared_ptr<resolver>>& resolvers)
+{
+    resolvers.push_back(make_shared<mismatched_resolver>());
+}
@@ -0,0 +1,26 @@
+// A fact plugin used by the collection tests to check that plugins are loaded
+#include <facter/facts/plugin.hpp>
+#include <facter/facts/collection.hpp>
+#include <facter/facts/scalar_value.hpp>
+
+using namespace std;
+using namespace facter::facts;
+
+struct plugin_resolver : resolver
+{
+    plugin_resolver() : resolver("test plugin", { "plugin_fact" })
+    {
+    }
+
+    virtual void resolve(collection& facts) override
+    {
+        facts.add("plugin_fact", make_value<string_value>("from plugin"));
+    }
+};
+
+static void create_resolvers(vector<shared_ptr<resolver>>& resolvers)
+{
+    resolvers.push_back(make_shared<plugin_resolver>());
+}
+
+LIBFACTER_PLUGIN(create_resolvers)
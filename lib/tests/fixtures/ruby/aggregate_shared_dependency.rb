@@ -0,0 +1,27 @@
+$calls = 0
+
+Facter.add(:foo, :type => :aggregate) do
+    chunk :first, :require => [:second, :third] do |second, third|
+        second + third
+    end
+
+    chunk :second, :require => :shared do |shared|
+        [shared]
+    end
+
+    chunk :third, :require => :shared do |shared|
+        [shared]
+    end
+
+    chunk :shared do
+        $calls += 1
+        'shared'
+    end
+end
+
+Facter.add(:calls) do
+    setcode do
+        Facter.value(:foo)
+        $calls
+    end
+end
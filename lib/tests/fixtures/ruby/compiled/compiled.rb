@@ -0,0 +1,3 @@
+Facter.add(:compiled) do
+  setcode { 'value' }
+end
@@ -0,0 +1,3 @@
+Facter.add(:other) do
+  setcode { 'other' }
+end
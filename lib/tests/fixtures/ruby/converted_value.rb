@@ -0,0 +1,9 @@
+# The converted value of a fact should be shared between calls and have frozen keys
+hash = Facter.to_hash['map']
+$shared = hash.equal?(Facter.value(:map)) && hash.keys.all? { |key| key.frozen? }
+
+Facter.add(:foo) do
+    setcode do
+        $shared
+    end
+end
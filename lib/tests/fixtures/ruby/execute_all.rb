@@ -0,0 +1,15 @@
+Facter.add(:foo) do
+    setcode do
+        Facter::Core::Execution.execute_all(['echo bar', 'exit 1', 'echo baz'], :on_fail => 'failed')
+    end
+end
+
+Facter.add(:bar) do
+    setcode do
+        begin
+            Facter::Core::Execution.execute_all(['echo bar', 'exit 1'])
+        rescue Facter::Core::Execution::ExecutionFailure => e
+            e.message
+        end
+    end
+end
@@ -0,0 +1,8 @@
+Facter.add(:foo) do
+    setcode do
+        # GC.disable returns true if the garbage collector was already disabled
+        disabled = GC.disable
+        GC.enable unless disabled
+        disabled
+    end
+end
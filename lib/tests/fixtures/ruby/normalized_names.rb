@@ -0,0 +1,11 @@
+Facter.add(:Foo) do
+    setcode do
+        name = 'BAR'
+        values = 3.times.map do
+            [Facter.value(:Bar), Facter.value(:bar), Facter.value('Bar'), Facter.value(name), Facter.fact(:BAR).value]
+        end.flatten
+        name << '_changed'
+        raise 'nope' unless Facter.value(name).nil?
+        values.uniq == ['baz']
+    end
+end
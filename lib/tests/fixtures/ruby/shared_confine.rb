@@ -0,0 +1,29 @@
+# Count how many times the confine is evaluated
+$evaluated = 0
+matcher = Object.new
+def matcher.===(value)
+    $evaluated += 1
+    value == 'value'
+end
+
+Facter.add(:foo) do
+    confine :fact => matcher
+    setcode do
+        'foo'
+    end
+end
+
+Facter.add(:bar) do
+    confine :fact => matcher
+    setcode do
+        'bar'
+    end
+end
+
+Facter.add(:evaluated) do
+    setcode do
+        Facter.value(:foo)
+        Facter.value(:bar)
+        $evaluated
+    end
+end
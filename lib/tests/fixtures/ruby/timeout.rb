@@ -1,10 +1,19 @@
-# We should get a warning for using the timeout option
-Facter.add(:timeout, :name => 'bar', :timeout => 1000) do
-    # And another warning for using timeout=
-    self.timeout = 10
+# The block is interrupted once the timeout passes
+Facter.add(:timeout, :name => 'sleep', :weight => 100, :timeout => 1) do
+    setcode do
+        sleep 10
+        'sleep'
+    end
 end
 
-# Try again to ensure only one warning each
-Facter.add(:timeout, :name => 'bar', :timeout => 100) do
+# The command is killed once the timeout passes
+Facter.add(:timeout, :name => 'command', :weight => 50) do
     self.timeout = 1
+    setcode 'sleep 10; echo command'
+end
+
+Facter.add(:timeout, :weight => 1) do
+    setcode do
+        'fallback'
+    end
 end
@@ -0,0 +1,21 @@
+# Repeated calls to Facter.to_hash should return separate hashes sharing the same keys and values
+first = Facter.to_hash
+second = Facter.to_hash
+first['added'] = 'value'
+shared = !first.equal?(second) && !second.key?('added') &&
+  first['bar'].equal?(second['bar']) &&
+  first.keys.find { |key| key == 'bar' }.equal?(second.keys.find { |key| key == 'bar' })
+
+# Defining a fact should be reflected in the next hash
+Facter.add(:later) do
+    setcode do
+        'later'
+    end
+end
+updated = Facter.to_hash['later'] == 'later'
+
+Facter.add(:foo) do
+    setcode do
+        shared && updated
+    end
+end
@@ -0,0 +1,7 @@
+$loaded_by = Process.pid
+
+Facter.add(:first) do
+    setcode do
+        Process.pid == $loaded_by ? 'parent' : 'worker'
+    end
+end
@@ -0,0 +1,17 @@
+Facter.add(:second) do
+    setcode do
+        Process.pid == $loaded_by ? 'parent' : 'worker'
+    end
+end
+
+Facter.add(:third) do
+    setcode do
+        { 'first' => Facter.value(:first), 'second' => Facter.value(:second) }
+    end
+end
+
+Facter.add(:nothing) do
+    setcode do
+        nil
+    end
+end
@@ -114,3 +114,32 @@ SCENARIO("logging with a FATAL level") {
     REQUIRE(context._appender->_message == string(colorize(level::fatal)) + "testing 1 2 3" + colorize());
     REQUIRE(error_logged());
 }
+
+SCENARIO("logging with a message callback") {
+    logging_test_context context;
+    string received;
+    GIVEN("a callback that logs the message") {
+        on_message([&](level lvl, string const& message) {
+            received = message;
+            return true;
+        });
+        log(level::info, "testing %1%", 1);
+        on_message(nullptr);
+        THEN("the callback is called and the message is logged") {
+            REQUIRE(received == "testing 1");
+            REQUIRE(context._appender->_message == string(colorize(level::info)) + "testing 1" + colorize());
+        }
+    }
+    GIVEN("a callback that discards the message") {
+        on_message([&](level lvl, string const& message) {
+            received = message;
+            return false;
+        });
+        log(level::error, "testing %1%", 2);
+        on_message(nullptr);
+        THEN("the callback is called and the message is not logged") {
+            REQUIRE(received == "testing 2");
+            REQUIRE(context._appender->_message.empty());
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include <catch.hpp>
 #include <facter/version.h>
 #include <facter/facts/collection.hpp>
+#include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <internal/ruby/api.hpp>
 #include <internal/ruby/module.hpp>
@@ -9,9 +10,12 @@
 #include <internal/util/scoped_env.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/log/sinks/sync_frontend.hpp>
 #include <boost/log/sinks/basic_sink_backend.hpp>
+#include <chrono>
 #include <memory>
+#include <set>
 #include <vector>
 #include <sstream>
 #include <string>
@@ -52,7 +56,7 @@ class ruby_log_appender :
 
 bool load_custom_fact(string const& filename, collection& facts)
 {
-    auto ruby = api::instance();
+    auto ruby = api::initialized_instance();
 
     module mod(facts);
 
@@ -102,7 +106,7 @@ SCENARIO("custom facts written in Ruby") {
     REQUIRE(facts.size() == 0);
 
     // Setup ruby
-    auto ruby = api::instance();
+    auto ruby = api::initialized_instance();
     REQUIRE(ruby);
     REQUIRE(ruby->initialized());
     ruby->include_stack_trace(true);
@@ -286,6 +290,15 @@ SCENARIO("custom facts written in Ruby") {
                 REQUIRE_FALSE(facts["foo"]);
             }
         }
+        WHEN("the same confine is used by multiple facts") {
+            facts.add("fact", make_value<string_value>("value"));
+            REQUIRE(load_custom_fact("shared_confine.rb", facts));
+            THEN("the confine is evaluated only once") {
+                REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "\"foo\"");
+                REQUIRE(ruby_value_to_string(facts.get<ruby_value>("bar")) == "\"bar\"");
+                REQUIRE(ruby_value_to_string(facts.get<ruby_value>("evaluated")) == "1");
+            }
+        }
         THEN("resolution with the most confines wins") {
             facts.add("fact1", make_value<string_value>("value1"));
             facts.add("fact2", make_value<string_value>("value2"));
@@ -369,6 +382,30 @@ SCENARIO("custom facts written in Ruby") {
             REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "\"baz\"");
         }
     }
+    GIVEN("a fact that looks up names with different cases more than once") {
+        facts.add("bar", make_value<string_value>("baz"));
+        REQUIRE(load_custom_fact("normalized_names.rb", facts));
+        THEN("every lookup should find the fact") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "true");
+        }
+    }
+    GIVEN("a fact that reads a hash value more than once") {
+        auto map = make_value<map_value>();
+        map->add("first", make_value<string_value>("1"));
+        map->add("second", make_value<string_value>("2"));
+        facts.add("map", move(map));
+        REQUIRE(load_custom_fact("converted_value.rb", facts));
+        THEN("the converted value is shared and its keys are frozen") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "true");
+        }
+    }
+    GIVEN("a fact that calls Facter.to_hash more than once") {
+        facts.add("bar", make_value<string_value>("baz"));
+        REQUIRE(load_custom_fact("to_hash.rb", facts));
+        THEN("each hash is a copy sharing its keys and values and reflects newly defined facts") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "true");
+        }
+    }
     GIVEN("a fact that resolves using Facter[]") {
         facts.add("bar", make_value<string_value>("baz"));
         REQUIRE(load_custom_fact("lookup.rb", facts));
@@ -382,6 +419,15 @@ SCENARIO("custom facts written in Ruby") {
             REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "\"bar\"");
         }
     }
+    GIVEN("a fact that executes commands together") {
+        REQUIRE(load_custom_fact("execute_all.rb", facts));
+        THEN("the output of each command should be returned in order") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "[\n  \"bar\",\n  \"failed\",\n  \"baz\"\n]");
+        }
+        THEN("a failed command should raise by default") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("bar")) == "\"execution of command \"exit 1\" failed\"");
+        }
+    }
     GIVEN("a fact that logs debug messages") {
         core->set_filter(log_level_attr >= log_level::debug);
         REQUIRE(load_custom_fact("debug.rb", facts));
@@ -484,7 +530,13 @@ SCENARIO("custom facts written in Ruby") {
         core->set_filter(log_level_attr >= log_level::error);
         REQUIRE(load_custom_fact("aggregate_with_cycle.rb", facts));
         THEN("an error is logged") {
-            REQUIRE(has_message(*appender, "ERROR", "chunk dependency cycle detected"));
+            REQUIRE(has_message(*appender, "ERROR", "chunk dependency cycle detected: (first -> second -> first|second -> first -> second)"));
+        }
+    }
+    GIVEN("an aggregate resolution with chunks that share a dependency") {
+        REQUIRE(load_custom_fact("aggregate_shared_dependency.rb", facts));
+        THEN("the shared chunk is evaluated once") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("calls")) == "1");
         }
     }
     GIVEN("a fact with a defined aggregate resolution") {
@@ -520,12 +572,15 @@ SCENARIO("custom facts written in Ruby") {
             REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "\"bar baz\"");
         }
     }
-    GIVEN("a fact that uses timeout") {
+    GIVEN("a fact with resolutions that run past their timeout") {
         core->set_filter(log_level_attr >= log_level::warning);
+        auto start = chrono::steady_clock::now();
         REQUIRE(load_custom_fact("timeout.rb", facts));
-        THEN("a warning is logged") {
-            REQUIRE(has_message(*appender, "WARN", "timeout option is not supported for custom facts and will be ignored."));
-            REQUIRE(has_message(*appender, "WARN", "timeout= is not supported for custom facts and will be ignored."));
+        THEN("the resolutions are abandoned in favor of the next one") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("timeout")) == "\"fallback\"");
+            REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(8));
+            REQUIRE(has_message(*appender, "WARN", "timeout resolution sleep timed out after 1 seconds\\."));
+            REQUIRE(has_message(*appender, "WARN", "timeout resolution command timed out after 1 seconds\\."));
         }
     }
     GIVEN("a fact that uses Facter#trace to enable backtraces") {
@@ -576,6 +631,93 @@ SCENARIO("custom facts written in Ruby") {
             REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "{\n  foo => \"bar\"\n}");
         }
     }
+    GIVEN("custom facts that have been resolved") {
+        REQUIRE(load_custom_fact("aggregate.rb", facts));
+        THEN("the time spent in each resolution and chunk should be recorded") {
+            set<string> names;
+            for (auto const& timing : facts.timings()) {
+                names.insert(timing.name);
+            }
+            REQUIRE(names.count("foo confines"));
+            REQUIRE(names.count("foo resolution 1"));
+            REQUIRE(names.count("foo resolution 1 chunk first"));
+            REQUIRE(names.count("foo resolution 1 chunk second"));
+        }
+    }
+    GIVEN("custom facts cached in compiled form") {
+        auto cache = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("facter-ruby-%%%%-%%%%");
+        vector<string> paths = { LIBFACTER_TESTS_DIRECTORY "/fixtures/ruby/compiled" };
+        {
+            module mod(facts, paths, cache.string());
+            mod.resolve_facts();
+        }
+        bool supported = ruby->is_true(ruby->rb_funcall(ruby->lookup({ "RubyVM", "InstructionSequence" }), ruby->rb_intern("respond_to?"), 1, ruby->utf8_value("load_from_binary")));
+        THEN("the compiled facts should be loaded on the next run") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("compiled")) == "\"value\"");
+            if (supported) {
+                REQUIRE(count_if(boost::filesystem::directory_iterator(cache), boost::filesystem::directory_iterator(), [](boost::filesystem::directory_entry const& entry) {
+                    return entry.path().extension() == ".bin";
+                }) == 2);
+            }
+            collection cached;
+            {
+                module mod(cached, paths, cache.string());
+                mod.resolve_facts();
+            }
+            REQUIRE(ruby_value_to_string(cached.get<ruby_value>("compiled")) == "\"value\"");
+        }
+        THEN("a query should load only the files that define the queried facts") {
+            REQUIRE(boost::filesystem::exists(cache / "manifest.json"));
+            collection queried;
+            {
+                module mod(queried, paths, cache.string());
+                mod.resolve_facts({ "compiled" });
+            }
+            REQUIRE(ruby_value_to_string(queried.get<ruby_value>("compiled")) == "\"value\"");
+            REQUIRE_FALSE(queried.get<ruby_value>("other"));
+        }
+        THEN("the manifest should tell whether custom facts define a query without loading them") {
+            REQUIRE(module::may_define(cache.string(), paths, { "compiled.key" }));
+            REQUIRE_FALSE(module::may_define(cache.string(), paths, { "kernel" }));
+            REQUIRE(module::may_define(string(), paths, { "kernel" }));
+        }
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(cache, ec);
+    }
+    GIVEN("custom facts resolved in worker processes") {
+        {
+            module mod(facts, { LIBFACTER_TESTS_DIRECTORY "/fixtures/ruby/workers" });
+            mod.workers(2);
+            mod.resolve_facts();
+        }
+        bool supported = ruby->is_true(ruby->rb_funcall(ruby->lookup({ "Process" }), ruby->rb_intern("respond_to?"), 1, ruby->utf8_value("fork")));
+        auto render = [](value const* val) {
+            ostringstream ss;
+            if (val) {
+                val->write(ss);
+            }
+            return ss.str();
+        };
+        THEN("the facts should be resolved by the workers") {
+            string expected = supported ? "\"worker\"" : "\"parent\"";
+            REQUIRE(render(facts["first"]) == expected);
+            REQUIRE(render(facts["second"]) == expected);
+            REQUIRE(facts["third"]);
+            REQUIRE_FALSE(facts["nothing"]);
+        }
+    }
+    GIVEN("custom facts resolved with the garbage collector disabled") {
+        {
+            module mod(facts, { LIBFACTER_TESTS_DIRECTORY "/fixtures/ruby/gc" });
+            mod.disable_gc(true);
+            mod.resolve_facts();
+        }
+        THEN("the garbage collector should be disabled only while resolving") {
+            REQUIRE(ruby_value_to_string(facts.get<ruby_value>("foo")) == "true");
+            // GC.enable returns true if the garbage collector was disabled
+            REQUIRE_FALSE(ruby->is_true(ruby->rb_funcall(ruby->lookup({ "GC" }), ruby->rb_intern("enable"), 0)));
+        }
+    }
 
     // Cleanup
     set_level(log_level::none);
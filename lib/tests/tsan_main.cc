@@ -0,0 +1,14 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch.hpp>
+#include <facter/logging/logging.hpp>
+
+using namespace facter::logging;
+
+// The thread sanitizer tests only link the utilities they test, so Ruby isn't initialized as it is by main.cc
+int main(int argc, char **argv)
+{
+    // Disable logging for tests
+    set_level(level::none);
+
+    return Catch::Session().run(argc, argv);
+}
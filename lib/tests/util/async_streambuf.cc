@@ -0,0 +1,51 @@
+#include <catch.hpp>
+#include <internal/util/async_streambuf.hpp>
+#include <boost/thread.hpp>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("writing through an asynchronous stream buffer") {
+    ostringstream target;
+    GIVEN("lines written from many threads") {
+        {
+            async_streambuf buffer(target, 16);
+            ostream out(&buffer);
+            vector<boost::thread> threads;
+            for (int i = 0; i < 4; ++i) {
+                threads.emplace_back([&out, i]() {
+                    for (int j = 0; j < 100; ++j) {
+                        out << "thread " << i << " line " << j << '\n';
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            THEN("every line is written whole once drained") {
+                buffer.drain();
+                string written = target.str();
+                REQUIRE(count(written.begin(), written.end(), '\n') == 400);
+                istringstream lines(written);
+                string line;
+                while (getline(lines, line)) {
+                    REQUIRE(line.compare(0, 7, "thread ") == 0);
+                    REQUIRE(line.find(" line ") != string::npos);
+                }
+            }
+        }
+    }
+    GIVEN("a line without a newline") {
+        {
+            async_streambuf buffer(target);
+            ostream out(&buffer);
+            out << "partial";
+        }
+        THEN("it is written when the buffer is destroyed") {
+            REQUIRE(target.str() == "partial");
+        }
+    }
+}
@@ -55,12 +55,13 @@ SCENARIO("listing directories in a directory") {
         });
         sort(subdirectories.begin(), subdirectories.end());
         THEN("all directories are returned") {
-            REQUIRE(subdirectories.size() == 5);
+            REQUIRE(subdirectories.size() == 6);
             REQUIRE(subdirectories[0] == "json");
-            REQUIRE(subdirectories[1] == "posix");
-            REQUIRE(subdirectories[2] == "text");
-            REQUIRE(subdirectories[3] == "windows");
-            REQUIRE(subdirectories[4] == "yaml");
+            REQUIRE(subdirectories[1] == "ordered");
+            REQUIRE(subdirectories[2] == "posix");
+            REQUIRE(subdirectories[3] == "text");
+            REQUIRE(subdirectories[4] == "windows");
+            REQUIRE(subdirectories[5] == "yaml");
         }
     }
     GIVEN("a directory pattern") {
@@ -85,3 +86,50 @@ SCENARIO("listing directories in a directory") {
         }
     }
 }
+
+SCENARIO("filtering directory entries by name") {
+    vector<string> files;
+    auto collect = [&](string const& file) {
+        files.push_back(boost::filesystem::path(file).filename().string());
+        return true;
+    };
+    GIVEN("a prefix filter") {
+        directory::each_file(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls", collect, directory::name_filter::prefix("file1"));
+        THEN("only the files starting with the prefix are returned") {
+            REQUIRE(files == vector<string>{ "file1.txt" });
+        }
+    }
+    GIVEN("a suffix filter") {
+        directory::each_file(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls", collect, directory::name_filter::suffix("4.txt"));
+        THEN("only the files ending with the suffix are returned") {
+            REQUIRE(files == vector<string>{ "file4.txt" });
+        }
+    }
+    GIVEN("a glob filter") {
+        directory::each_file(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls", collect, directory::name_filter::glob("f*?.t*"));
+        THEN("'*' and '?' match any characters") {
+            REQUIRE(files.size() == 4);
+        }
+    }
+    GIVEN("a glob filter with brackets") {
+        directory::each_file(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls", collect, directory::name_filter::glob("f*[23]*"));
+        THEN("the brackets are matched literally") {
+            REQUIRE(files.empty());
+        }
+    }
+    GIVEN("a compiled regular expression") {
+        auto filter = directory::name_filter::regex("^file[23].txt$");
+        directory::each_file(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls", collect, filter);
+        directory::each_file(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls", collect, filter);
+        sort(files.begin(), files.end());
+        THEN("the filter can be reused") {
+            REQUIRE(files == (vector<string>{ "file2.txt", "file2.txt", "file3.txt", "file3.txt" }));
+        }
+    }
+    GIVEN("a filter that passes any name") {
+        directory::each_subdirectory(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external", collect, directory::name_filter::any());
+        THEN("all directories are returned") {
+            REQUIRE(files.size() == 6);
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include <catch.hpp>
 #include <facter/util/environment.hpp>
 #include <boost/nowide/cenv.hpp>
+#include <map>
 
 using namespace std;
 using namespace facter::util;
@@ -88,3 +89,22 @@ SCENARIO("enumearing enviornment variables") {
     boost::nowide::unsetenv("FACTERTEST2");
     boost::nowide::unsetenv("FACTERTEST3");
 }
+
+SCENARIO("enumerating environment variables with a prefix") {
+    boost::nowide::setenv("FACTERTEST_PREFIX1", "FOO", 1);
+    boost::nowide::setenv("facterTEST_PREFIX2", "BAR", 1);
+    boost::nowide::setenv("FACTERTESTOTHER", "BAZ", 1);
+    map<string, string> found;
+    environment::each("FACTERTEST_", [&](string& name, string& value) {
+        found.emplace(move(name), move(value));
+        return true;
+    });
+    THEN("only the variables starting with the prefix are returned, regardless of case") {
+        REQUIRE(found.size() == 2);
+        REQUIRE(found["FACTERTEST_PREFIX1"] == "FOO");
+        REQUIRE(found["facterTEST_PREFIX2"] == "BAR");
+    }
+    boost::nowide::unsetenv("FACTERTEST_PREFIX1");
+    boost::nowide::unsetenv("facterTEST_PREFIX2");
+    boost::nowide::unsetenv("FACTERTESTOTHER");
+}
@@ -74,3 +74,31 @@ SCENARIO("reading the entire contents of a file") {
         }
     }
 }
+
+SCENARIO("reading files into the same string") {
+    string fixture_path = "util/multiline_file.txt";
+    string fixture_file_path = LIBFACTER_TESTS_DIRECTORY "/fixtures/" + fixture_path;
+    string fixture;
+    REQUIRE(load_fixture(fixture_path, fixture));
+
+    GIVEN("a string with existing contents") {
+        string data(fixture.size() * 4, 'x');
+        THEN("the contents are replaced by the file") {
+            REQUIRE(file::read(fixture_file_path, data));
+            REQUIRE(data == fixture);
+        }
+        THEN("the contents are cleared when the file does not exist") {
+            REQUIRE_FALSE(file::read("does_not_exist", data));
+            REQUIRE(data.empty());
+        }
+    }
+    GIVEN("an empty string that is reused") {
+        string data;
+        THEN("each read returns the whole file") {
+            for (int i = 0; i < 3; ++i) {
+                REQUIRE(file::read(fixture_file_path, data));
+                REQUIRE(data == fixture);
+            }
+        }
+    }
+}
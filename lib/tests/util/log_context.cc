@@ -0,0 +1,45 @@
+#include <catch.hpp>
+#include <internal/util/log_context.hpp>
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("tagging log messages with context") {
+    GIVEN("no context") {
+        THEN("there is no current context") {
+            REQUIRE_FALSE(scoped_log_context::get());
+        }
+    }
+    GIVEN("a resolver context") {
+        scoped_log_context resolving(scoped_log_context::for_resolver("networking"));
+        THEN("it is current") {
+            auto context = scoped_log_context::get();
+            REQUIRE(context);
+            REQUIRE(context->resolver == "networking");
+            REQUIRE(context->pid == 0);
+            REQUIRE(context->url.empty());
+            REQUIRE(context->start <= chrono::steady_clock::now());
+        }
+        WHEN("waiting on a child process") {
+            {
+                scoped_log_context waiting(scoped_log_context::for_child(1234));
+                THEN("the child is tagged within the resolver") {
+                    auto context = scoped_log_context::get();
+                    REQUIRE(context->resolver == "networking");
+                    REQUIRE(context->pid == 1234);
+                }
+            }
+            THEN("the resolver context is restored") {
+                REQUIRE(scoped_log_context::get()->pid == 0);
+            }
+        }
+        WHEN("making a HTTP request") {
+            scoped_log_context requesting(scoped_log_context::for_url("http://169.254.169.254/latest/meta-data/"));
+            THEN("the URL is tagged within the resolver") {
+                auto context = scoped_log_context::get();
+                REQUIRE(context->resolver == "networking");
+                REQUIRE(context->url == "http://169.254.169.254/latest/meta-data/");
+            }
+        }
+    }
+}
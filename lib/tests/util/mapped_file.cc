@@ -0,0 +1,32 @@
+#include <catch.hpp>
+#include <internal/util/mapped_file.hpp>
+#include <facter/util/file.hpp>
+#include <string>
+#include "../fixtures.hpp"
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("mapping a file into memory") {
+    GIVEN("a file that does not exist") {
+        mapped_file file("does_not_exist");
+        THEN("it should not be open") {
+            REQUIRE_FALSE(file.is_open());
+            REQUIRE(file.size() == 0);
+        }
+    }
+    GIVEN("a file with contents") {
+        string path = LIBFACTER_TESTS_DIRECTORY "/fixtures/util/multiline_file.txt";
+        mapped_file file(path);
+        THEN("the contents should be the contents of the file") {
+            REQUIRE(file.is_open());
+            REQUIRE(string(file.begin(), file.end()) == file::read(path));
+            REQUIRE(file.size() == static_cast<size_t>(file.end() - file.begin()));
+        }
+        THEN("modifying the contents should not modify the file") {
+            auto contents = file::read(path);
+            file.begin()[0] = '!';
+            REQUIRE(file::read(path) == contents);
+        }
+    }
+}
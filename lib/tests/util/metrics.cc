@@ -0,0 +1,78 @@
+#include <catch.hpp>
+#include <facter/util/metrics.hpp>
+#include <internal/util/metrics.hpp>
+#include <internal/util/statistics.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace facter::util;
+
+static string written_metrics()
+{
+    ostringstream output;
+    write_metrics(output);
+    return output.str();
+}
+
+SCENARIO("writing metrics") {
+    GIVEN("resolutions of a resolver") {
+        statistics fast;
+        fast.wall_time = chrono::milliseconds(2);
+        statistics slow;
+        slow.wall_time = chrono::seconds(2);
+        metrics::record_resolution("metrics \"test\"", fast);
+        metrics::record_resolution("metrics \"test\"", slow);
+        THEN("they should be written as a histogram labelled with the escaped resolver name") {
+            auto output = written_metrics();
+            REQUIRE(output.find("# TYPE facter_resolver_duration_seconds histogram\n") != string::npos);
+            REQUIRE(output.find("facter_resolver_duration_seconds_bucket{resolver=\"metrics \\\"test\\\"\",le=\"0.001\"} 0\n") != string::npos);
+            REQUIRE(output.find("facter_resolver_duration_seconds_bucket{resolver=\"metrics \\\"test\\\"\",le=\"0.0025\"} 1\n") != string::npos);
+            REQUIRE(output.find("facter_resolver_duration_seconds_bucket{resolver=\"metrics \\\"test\\\"\",le=\"1\"} 1\n") != string::npos);
+            REQUIRE(output.find("facter_resolver_duration_seconds_bucket{resolver=\"metrics \\\"test\\\"\",le=\"5\"} 2\n") != string::npos);
+            REQUIRE(output.find("facter_resolver_duration_seconds_bucket{resolver=\"metrics \\\"test\\\"\",le=\"+Inf\"} 2\n") != string::npos);
+            REQUIRE(output.find("facter_resolver_duration_seconds_sum{resolver=\"metrics \\\"test\\\"\"} 2.002\n") != string::npos);
+            REQUIRE(output.find("facter_resolver_duration_seconds_count{resolver=\"metrics \\\"test\\\"\"} 2\n") != string::npos);
+        }
+    }
+    GIVEN("cache lookups") {
+        auto count = [](string const& result) {
+            auto output = written_metrics();
+            auto line = "facter_cache_lookups_total{cache=\"metrics test\",result=\"" + result + "\"} ";
+            auto pos = output.find(line);
+            return pos == string::npos ? 0 : stoi(output.substr(pos + line.size()));
+        };
+        auto hits = count("hit");
+        auto misses = count("miss");
+        metrics::record_cache_lookup("metrics test", true);
+        metrics::record_cache_lookup("metrics test", true);
+        metrics::record_cache_lookup("metrics test", false);
+        THEN("the hits and misses should be counted separately") {
+            REQUIRE(count("hit") == hits + 2);
+            REQUIRE(count("miss") == misses + 1);
+        }
+    }
+    GIVEN("processes and HTTP requests recorded outside of a resolver") {
+        auto count = [](string const& name) {
+            auto output = written_metrics();
+            auto pos = output.find("\n" + name + " ");
+            REQUIRE(pos != string::npos);
+            return stoull(output.substr(pos + name.size() + 2));
+        };
+        auto processes = count("facter_processes_total");
+        auto requests = count("facter_http_requests_total");
+        scoped_statistics::record_process();
+        scoped_statistics::record_http_request();
+        scoped_statistics::record_http_request();
+        THEN("they should still be counted") {
+            REQUIRE(count("facter_processes_total") == processes + 1);
+            REQUIRE(count("facter_http_requests_total") == requests + 2);
+        }
+    }
+#ifdef __linux__
+    GIVEN("a process on Linux") {
+        THEN("its resident memory should be written") {
+            REQUIRE(written_metrics().find("\nfacter_resident_memory_bytes ") != string::npos);
+        }
+    }
+#endif  // __linux__
+}
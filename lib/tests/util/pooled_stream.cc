@@ -0,0 +1,51 @@
+#include <catch.hpp>
+#include <internal/util/pooled_stream.hpp>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("formatting output with a pooled stream") {
+    GIVEN("formatted output") {
+        pooled_stream output;
+        output.stream() << "answer: " << 42 << ' ' << boolalpha << true;
+        THEN("the output should be available as a string") {
+            REQUIRE(output.str() == "answer: 42 true");
+        }
+        WHEN("flushed to another stream") {
+            ostringstream destination;
+            output.flush_to(destination);
+            output.stream() << "more";
+            THEN("the buffer should be cleared") {
+                REQUIRE(destination.str() == "answer: 42 true");
+                REQUIRE(output.str() == "more");
+            }
+        }
+    }
+    GIVEN("a buffer that was previously used") {
+        char const* storage;
+        {
+            pooled_stream first;
+            first.stream() << hex << setw(10) << string(100, 'x');
+            storage = first.str().data();
+        }
+        pooled_stream second;
+        THEN("it should be reused empty and with the default formatting") {
+            REQUIRE(second.str().empty());
+            second.stream() << 255;
+            REQUIRE(second.str() == "255");
+            REQUIRE(second.str().data() == storage);
+        }
+    }
+    GIVEN("nested streams") {
+        pooled_stream outer;
+        outer.stream() << "outer";
+        pooled_stream inner;
+        inner.stream() << "inner";
+        THEN("they should not share a buffer") {
+            REQUIRE(outer.str() == "outer");
+            REQUIRE(inner.str() == "inner");
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#include <catch.hpp>
+#include <internal/util/posix/attribute_reader.hpp>
+#include <internal/util/scoped_root.hpp>
+#include "../../fixtures.hpp"
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::util::posix;
+
+SCENARIO("reading attribute files") {
+    attribute_reader block(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/attributes");
+    REQUIRE(block.is_open());
+    string value;
+
+    GIVEN("an attribute in a subdirectory") {
+        attribute_reader device(block, "sda");
+        REQUIRE(device.is_open());
+        THEN("it should be read and trimmed") {
+            REQUIRE(device.read("size", value));
+            REQUIRE(value == "1953525168");
+        }
+        THEN("a nested attribute should be read") {
+            REQUIRE(device.read("device/vendor", value));
+            REQUIRE(value == "ATA");
+        }
+        THEN("an empty attribute should not be read") {
+            REQUIRE_FALSE(device.read("empty", value));
+            REQUIRE(value.empty());
+        }
+    }
+    GIVEN("many attributes") {
+        attribute_reader device(attribute_reader(block, "sda"), "device");
+        string vendor, model, serial = "stale";
+        auto count = device.read({
+            { "vendor", &vendor },
+            { "model",  &model },
+            { "serial", &serial },
+        });
+        THEN("the attributes that exist should be read and the others cleared") {
+            REQUIRE(count == 2);
+            REQUIRE(vendor == "ATA");
+            REQUIRE(model == "Samsung SSD 860");
+            REQUIRE(serial.empty());
+        }
+    }
+    GIVEN("a subdirectory that does not exist") {
+        attribute_reader missing(block, "sdz");
+        THEN("it should not be open and nothing should be read") {
+            REQUIRE_FALSE(missing.is_open());
+            REQUIRE_FALSE(attribute_reader(missing, "device").is_open());
+            REQUIRE_FALSE(missing.read("size", value));
+        }
+    }
+    GIVEN("an absolute path") {
+        THEN("it should be read") {
+            REQUIRE(attribute_reader::read_file(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/attributes/sda/size", value));
+            REQUIRE(value == "1953525168");
+        }
+    }
+    GIVEN("a root directory") {
+        scoped_root root(LIBFACTER_TESTS_DIRECTORY "/fixtures/util");
+        THEN("absolute paths should be read beneath the root") {
+            REQUIRE(attribute_reader("/attributes").is_open());
+            REQUIRE(attribute_reader::read_file("/attributes/sda/device/model", value));
+            REQUIRE(value == "Samsung SSD 860");
+        }
+    }
+}
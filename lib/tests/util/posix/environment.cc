@@ -33,4 +33,16 @@ SCENARIO("environment search paths") {
         REQUIRE(environment::set("PATH", value));
         environment::reload_search_paths();
     }
+    GIVEN("a changed PATH") {
+        string value;
+        REQUIRE(environment::get("PATH", value));
+        REQUIRE(environment::set("PATH", "/facter/test/bin:" + value));
+        THEN("the search paths are reloaded") {
+            REQUIRE(environment::search_paths().front() == "/facter/test/bin");
+        }
+        REQUIRE(environment::set("PATH", value));
+        THEN("the search paths are reloaded when it is restored") {
+            REQUIRE(environment::search_paths().front() != "/facter/test/bin");
+        }
+    }
 }
@@ -0,0 +1,76 @@
+#include <catch.hpp>
+#include <internal/util/proc_file.hpp>
+#include <string>
+#include <vector>
+#include "../fixtures.hpp"
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("reading a proc file") {
+    GIVEN("a file that does not exist") {
+        proc_file file("does_not_exist");
+        THEN("it should not be open and have no lines") {
+            REQUIRE_FALSE(file.is_open());
+            bool called = false;
+            file.each_line([&](boost::string_ref) {
+                called = true;
+                return true;
+            });
+            REQUIRE_FALSE(called);
+        }
+    }
+    GIVEN("a file of keys and values") {
+        proc_file file(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/proc_file.txt");
+        REQUIRE(file.is_open());
+        THEN("each line should be passed without its line ending") {
+            vector<string> lines;
+            file.each_line([&](boost::string_ref line) {
+                lines.emplace_back(line.begin(), line.end());
+                return true;
+            });
+            REQUIRE(lines.size() == 8);
+            REQUIRE(lines[0] == "processor\t: 0");
+            REQUIRE(lines[3].empty());
+            REQUIRE(lines[7] == "MemTotal:       16318540 kB");
+        }
+        THEN("the keys and values should be trimmed") {
+            vector<pair<string, string>> values;
+            file.each_value([&](boost::string_ref key, boost::string_ref value) {
+                values.emplace_back(string(key.begin(), key.end()), string(value.begin(), value.end()));
+                return true;
+            });
+            REQUIRE(values.size() == 6);
+            REQUIRE(values[0] == make_pair(string("processor"), string("0")));
+            REQUIRE(values[1] == make_pair(string("model name"), string("Test CPU @ 2.00GHz")));
+            REQUIRE(values[2] == make_pair(string("flags"), string("fpu vme")));
+            REQUIRE(values[5] == make_pair(string("MemTotal"), string("16318540 kB")));
+        }
+        THEN("returning false should stop the iteration") {
+            size_t count = 0;
+            file.each_value([&](boost::string_ref, boost::string_ref) {
+                ++count;
+                return false;
+            });
+            REQUIRE(count == 1);
+        }
+    }
+    GIVEN("a line of whitespace-delimited fields") {
+        boost::string_ref line = "eth0\t00000000  010200C0 ";
+        THEN("the fields should be removed in order") {
+            REQUIRE(proc_file::next_field(line) == "eth0");
+            REQUIRE(proc_file::next_field(line) == "00000000");
+            REQUIRE(proc_file::next_field(line) == "010200C0");
+            REQUIRE(proc_file::next_field(line).empty());
+        }
+    }
+    GIVEN("a value with a unit") {
+        uint64_t value = 0;
+        THEN("the leading digits should be parsed") {
+            REQUIRE(proc_file::to_uint64("16318540 kB", value));
+            REQUIRE(value == 16318540);
+            REQUIRE_FALSE(proc_file::to_uint64("kB", value));
+            REQUIRE_FALSE(proc_file::to_uint64("", value));
+        }
+    }
+}
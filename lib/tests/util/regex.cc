@@ -0,0 +1,52 @@
+#include <catch.hpp>
+#include <internal/util/regex.hpp>
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("caching compiled regular expressions") {
+    GIVEN("the same pattern twice") {
+        THEN("the same expression is returned") {
+            auto const& first = cached_regex("^cpu\\d+$");
+            auto const& second = cached_regex("^cpu\\d+$");
+            REQUIRE(&first == &second);
+            REQUIRE(re_search(string("cpu12"), first));
+            REQUIRE_FALSE(re_search(string("cpufreq"), first));
+        }
+    }
+    GIVEN("the same pattern with different flags") {
+        THEN("different expressions are returned") {
+            auto const& sensitive = cached_regex("virtio");
+            auto const& insensitive = cached_regex("virtio", boost::regex::icase);
+            REQUIRE(&sensitive != &insensitive);
+            REQUIRE_FALSE(re_search(string("Virtio"), sensitive));
+            REQUIRE(re_search(string("Virtio"), insensitive));
+        }
+    }
+    GIVEN("an invalid pattern") {
+        THEN("an exception is thrown each time") {
+            REQUIRE_THROWS_AS(cached_regex("("), boost::regex_error);
+            REQUIRE_THROWS_AS(cached_regex("("), boost::regex_error);
+        }
+    }
+}
+
+SCENARIO("matching patterns") {
+    GIVEN("a literal pattern") {
+        pattern_matcher matcher("HVM domU");
+        THEN("it is found anywhere in the text") {
+            REQUIRE(is_literal_pattern("HVM domU"));
+            REQUIRE(matcher.search("System Configuration: Xen HVM domU"));
+            REQUIRE_FALSE(matcher.search("System Configuration: Xen"));
+        }
+    }
+    GIVEN("a regular expression") {
+        pattern_matcher matcher("1ab8:|[Pp]arallels");
+        THEN("it is searched for as a regular expression") {
+            REQUIRE_FALSE(is_literal_pattern("1ab8:|[Pp]arallels"));
+            REQUIRE(matcher.search("parallels"));
+            REQUIRE(matcher.search("vendor 1ab8:4000"));
+            REQUIRE_FALSE(matcher.search("VirtualBox"));
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#include <catch.hpp>
+#include <internal/util/replay_log.hpp>
+#include <facter/execution/execution.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::execution;
+namespace fs = boost::filesystem;
+
+struct temp_replay_file
+{
+    temp_replay_file() :
+        _path((fs::temp_directory_path() / fs::unique_path("facter-replay-%%%%-%%%%.json")).string())
+    {
+    }
+
+    ~temp_replay_file()
+    {
+        boost::system::error_code ec;
+        fs::remove(_path, ec);
+    }
+
+    string _path;
+};
+
+SCENARIO("recording and replaying commands and requests") {
+    GIVEN("a recorded entry") {
+        replay_entry entry;
+        entry.status = 200;
+        entry.output = "{\"instance-id\": \"i-1234\"}";
+        entry.headers.emplace_back("Content-Type", "application/json");
+        entry.elapsed = chrono::milliseconds(100);
+        THEN("it should replay after its recorded time by default") {
+            replay_log log(replay_mode::replay);
+            REQUIRE(log.latency(entry) == chrono::milliseconds(100));
+        }
+        THEN("its latency should be scaled and extended") {
+            replay_log log(replay_mode::replay);
+            log.latency(0.5, chrono::milliseconds(10));
+            REQUIRE(log.latency(entry) == chrono::milliseconds(60));
+            log.latency(0);
+            REQUIRE(log.latency(entry) == chrono::milliseconds(0));
+        }
+        WHEN("the log is saved and loaded") {
+            temp_replay_file file;
+            replay_log recorded(replay_mode::record);
+            recorded.add("GET http://169.254.169.254/latest/meta-data/", entry);
+            replay_entry failed;
+            failed.error = "Timeout was reached";
+            failed.elapsed = chrono::milliseconds(600);
+            recorded.add(string("3\0uname\0-a\0", 11), failed);
+            REQUIRE(recorded.save(file._path));
+
+            replay_log replayed(replay_mode::replay);
+            REQUIRE(replayed.load(file._path));
+            THEN("every entry should be replayed as it was recorded") {
+                REQUIRE(replayed.size() == 2u);
+                auto loaded = replayed.find("GET http://169.254.169.254/latest/meta-data/");
+                REQUIRE(loaded);
+                REQUIRE(loaded->status == 200);
+                REQUIRE_FALSE(loaded->signaled);
+                REQUIRE(loaded->output == entry.output);
+                REQUIRE(loaded->headers == entry.headers);
+                REQUIRE(loaded->error.empty());
+                REQUIRE(loaded->elapsed == chrono::milliseconds(100));
+                loaded = replayed.find(string("3\0uname\0-a\0", 11));
+                REQUIRE(loaded);
+                REQUIRE(loaded->error == "Timeout was reached");
+                REQUIRE(loaded->elapsed == chrono::milliseconds(600));
+                REQUIRE_FALSE(replayed.find("GET http://169.254.169.254/"));
+            }
+        }
+    }
+    GIVEN("a file that is not a replay log") {
+        temp_replay_file file;
+        {
+            boost::nowide::ofstream out(file._path.c_str());
+            out << "not json";
+        }
+        THEN("it should not be loaded") {
+            replay_log log(replay_mode::replay);
+            REQUIRE_FALSE(log.load(file._path));
+            REQUIRE(log.size() == 0u);
+        }
+    }
+    GIVEN("a log recording commands") {
+        replay_log recorded(replay_mode::record);
+        {
+            scoped_replay_log recording(&recorded);
+            REQUIRE(replay_log::current() == &recorded);
+            auto result = execute("echo", { "hello" });
+            REQUIRE(result.first);
+            REQUIRE(result.second == "hello");
+        }
+        REQUIRE_FALSE(replay_log::current());
+        REQUIRE(recorded.size() == 1u);
+
+        WHEN("the commands are replayed") {
+            temp_replay_file file;
+            REQUIRE(recorded.save(file._path));
+            replay_log replayed(replay_mode::replay);
+            REQUIRE(replayed.load(file._path));
+            replayed.latency(0);
+            scoped_replay_log replaying(&replayed);
+            THEN("recorded commands should have their recorded output") {
+                auto result = execute("echo", { "hello" });
+                REQUIRE(result.first);
+                REQUIRE(result.second == "hello");
+                vector<string> lines;
+                REQUIRE(each_line("echo", { "hello" }, [&](string& line) {
+                    lines.push_back(line);
+                    return true;
+                }));
+                REQUIRE(lines == vector<string>({ "hello" }));
+            }
+            THEN("commands that weren't recorded should fail as if they were not found") {
+                auto result = execute("echo", { "goodbye" });
+                REQUIRE_FALSE(result.first);
+                REQUIRE(result.second.empty());
+                REQUIRE_THROWS_AS(execute("echo", { "goodbye" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit })), child_exit_exception);
+            }
+        }
+    }
+}
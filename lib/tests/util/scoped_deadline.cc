@@ -0,0 +1,71 @@
+#include <catch.hpp>
+#include <internal/util/scoped_deadline.hpp>
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("limiting work with a deadline") {
+    GIVEN("no deadline") {
+        THEN("work should never expire") {
+            REQUIRE_FALSE(scoped_deadline::active());
+            REQUIRE_FALSE(scoped_deadline::expired());
+            REQUIRE(scoped_deadline::remaining() == chrono::steady_clock::duration::max());
+            REQUIRE_NOTHROW(scoped_deadline::check());
+        }
+    }
+    GIVEN("a deadline in the future") {
+        scoped_deadline limiting(chrono::steady_clock::now() + chrono::hours(1));
+        THEN("work should not expire") {
+            REQUIRE(scoped_deadline::active());
+            REQUIRE_FALSE(scoped_deadline::expired());
+            REQUIRE(scoped_deadline::remaining() > chrono::minutes(59));
+            REQUIRE_NOTHROW(scoped_deadline::check());
+        }
+        WHEN("a nested scope has an earlier deadline") {
+            scoped_deadline nested(chrono::steady_clock::now());
+            THEN("the nested deadline should apply") {
+                REQUIRE(scoped_deadline::expired());
+            }
+        }
+        WHEN("a nested scope has a later deadline") {
+            scoped_deadline nested(chrono::steady_clock::now() + chrono::hours(2));
+            THEN("the enclosing deadline should apply") {
+                REQUIRE(scoped_deadline::remaining() <= chrono::hours(1));
+            }
+        }
+        WHEN("the nested scope ends") {
+            {
+                scoped_deadline nested(chrono::steady_clock::now());
+            }
+            THEN("the enclosing deadline should apply again") {
+                REQUIRE_FALSE(scoped_deadline::expired());
+            }
+        }
+    }
+    GIVEN("a deadline that has passed") {
+        scoped_deadline limiting(chrono::steady_clock::now() - chrono::seconds(1));
+        THEN("work should expire") {
+            REQUIRE(scoped_deadline::expired());
+            REQUIRE(scoped_deadline::remaining() == chrono::steady_clock::duration::zero());
+            REQUIRE_THROWS_AS(scoped_deadline::check(), deadline_exceeded_exception);
+        }
+    }
+    GIVEN("work that may be cancelled") {
+        atomic<bool> cancelled(false);
+        scoped_deadline limiting(chrono::steady_clock::time_point::max(), &cancelled);
+        THEN("work should expire once cancelled") {
+            REQUIRE(scoped_deadline::remaining() == chrono::steady_clock::duration::max());
+            REQUIRE_FALSE(scoped_deadline::expired());
+            cancelled = true;
+            REQUIRE(scoped_deadline::expired());
+        }
+        WHEN("a nested scope is not cancelled") {
+            atomic<bool> nested_cancelled(false);
+            scoped_deadline nested(chrono::steady_clock::time_point::max(), &nested_cancelled);
+            THEN("cancelling the enclosing scope should expire the nested work") {
+                cancelled = true;
+                REQUIRE(scoped_deadline::expired());
+            }
+        }
+    }
+}
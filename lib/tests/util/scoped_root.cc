@@ -0,0 +1,62 @@
+#include <catch.hpp>
+#include <internal/util/scoped_root.hpp>
+#include <facter/util/directory.hpp>
+#include <facter/util/file.hpp>
+#include <boost/algorithm/string.hpp>
+#include "../fixtures.hpp"
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("resolving files relative to an alternate root") {
+    string root = LIBFACTER_TESTS_DIRECTORY "/fixtures/util/roots/first";
+    GIVEN("no alternate root") {
+        THEN("paths should not change") {
+            REQUIRE(scoped_root::current().empty());
+            REQUIRE(scoped_root::path("/etc/motd") == "/etc/motd");
+        }
+    }
+    GIVEN("the root directory") {
+        scoped_root rooted("/");
+        THEN("paths should not change") {
+            REQUIRE(scoped_root::current().empty());
+            REQUIRE(scoped_root::path("/etc/motd") == "/etc/motd");
+        }
+    }
+    GIVEN("an alternate root") {
+        scoped_root rooted(root + "/");
+        THEN("absolute paths should be beneath the root") {
+            REQUIRE(scoped_root::current() == root);
+            REQUIRE(scoped_root::path("/etc/motd") == root + "/etc/motd");
+        }
+        THEN("relative paths and paths beneath the root should not change") {
+            REQUIRE(scoped_root::path("etc/motd") == "etc/motd");
+            REQUIRE(scoped_root::path(root + "/etc/motd") == root + "/etc/motd");
+            REQUIRE(scoped_root::path(root) == root);
+        }
+        THEN("files should be read from beneath the root") {
+            REQUIRE(boost::trim_copy(file::read("/etc/motd")) == "first");
+            vector<string> files;
+            directory::each_file("/etc", [&](string const& path) {
+                files.push_back(path);
+                return true;
+            });
+            REQUIRE(files.size() == 1);
+            REQUIRE(boost::trim_copy(file::read(files.front())) == "first");
+        }
+        WHEN("a nested scope has a different root") {
+            scoped_root nested(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/roots/second");
+            THEN("the nested root should apply") {
+                REQUIRE(boost::trim_copy(file::read("/etc/motd")) == "second");
+            }
+        }
+        WHEN("a nested scope ends") {
+            {
+                scoped_root nested("");
+            }
+            THEN("the enclosing root should apply") {
+                REQUIRE(scoped_root::current() == root);
+            }
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include <catch.hpp>
+#include <facter/util/file.hpp>
+#include <internal/util/statistics.hpp>
+#include "../fixtures.hpp"
+
+using namespace std;
+using namespace facter::util;
+using namespace facter::testing;
+
+SCENARIO("recording statistics") {
+    statistics stats;
+    REQUIRE(stats.processes == 0);
+    REQUIRE(stats.bytes_read == 0);
+    REQUIRE(stats.http_requests == 0);
+
+    GIVEN("no scope is recording") {
+        scoped_statistics::record_process();
+        scoped_statistics::record_bytes_read(42);
+        scoped_statistics::record_http_request();
+        THEN("nothing is recorded") {
+            REQUIRE(stats.processes == 0);
+            REQUIRE(stats.bytes_read == 0);
+            REQUIRE(stats.http_requests == 0);
+        }
+    }
+    GIVEN("a file is read while recording") {
+        string contents;
+        {
+            scoped_statistics recording(stats);
+            REQUIRE(file::read(LIBFACTER_TESTS_DIRECTORY "/fixtures/util/multiline_file.txt", contents));
+        }
+        THEN("the bytes read are recorded") {
+            REQUIRE_FALSE(contents.empty());
+            REQUIRE(stats.bytes_read == contents.size());
+        }
+        THEN("the elapsed time is recorded") {
+            REQUIRE(stats.wall_time.count() >= 0);
+            REQUIRE(stats.cpu_time.count() >= 0);
+        }
+    }
+    GIVEN("a nested scope") {
+        statistics nested;
+        {
+            scoped_statistics recording(stats);
+            scoped_statistics::record_http_request();
+            {
+                scoped_statistics inner(nested);
+                scoped_statistics::record_process();
+                scoped_statistics::record_http_request();
+            }
+            scoped_statistics::record_bytes_read(10);
+        }
+        THEN("the nested scope records only its own work") {
+            REQUIRE(nested.processes == 1);
+            REQUIRE(nested.http_requests == 1);
+            REQUIRE(nested.bytes_read == 0);
+        }
+        THEN("the enclosing scope records the rest") {
+            REQUIRE(stats.processes == 0);
+            REQUIRE(stats.http_requests == 1);
+            REQUIRE(stats.bytes_read == 10);
+        }
+        THEN("recording stops when the scopes end") {
+            scoped_statistics::record_http_request();
+            REQUIRE(stats.http_requests == 1);
+            REQUIRE(nested.http_requests == 1);
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include <catch.hpp>
 #include <facter/util/string.hpp>
+#include <limits>
 
 using namespace std;
 using namespace facter::util;
@@ -28,6 +29,42 @@ SCENARIO("converting bytes to hex strings") {
     }
 }
 
+SCENARIO("reading each line of a string") {
+    string text = "first\r\nsecond\n\nfourth";
+    vector<string> expected = { "first", "second", "", "fourth" };
+
+    GIVEN("a std::function callback") {
+        THEN("each line is passed without line endings") {
+            vector<string> lines;
+            function<bool(string&)> callback = [&](string& line) {
+                lines.push_back(line);
+                return true;
+            };
+            each_line(text, callback);
+            REQUIRE(lines == expected);
+        }
+    }
+    GIVEN("a lambda callback") {
+        THEN("each line is passed without line endings") {
+            vector<string> lines;
+            each_line(text, [&](string& line) {
+                lines.push_back(line);
+                return true;
+            });
+            REQUIRE(lines == expected);
+        }
+        THEN("returning false stops reading") {
+            vector<string> lines;
+            each_line(text, [&](string& line) {
+                lines.push_back(line);
+                return false;
+            });
+            REQUIRE(lines.size() == 1);
+            REQUIRE(lines[0] == "first");
+        }
+    }
+}
+
 SCENARIO("converting bytes to SI unit strings") {
     GIVEN("zero bytes") {
         THEN("the string should show 0 bytes") {
@@ -274,3 +311,71 @@ SCENARIO("converting frequencies to strings") {
         }
     }
 }
+
+SCENARIO("parsing integers") {
+    GIVEN("valid integers") {
+        THEN("they are parsed") {
+            int64_t value = 0;
+            REQUIRE(parse_integer("42", value));
+            REQUIRE(value == 42);
+            REQUIRE(parse_integer(" -17\n", value));
+            REQUIRE(value == -17);
+            REQUIRE(parse_integer("+5", value));
+            REQUIRE(value == 5);
+            REQUIRE(parse_integer("-9223372036854775808", value));
+            REQUIRE(value == numeric_limits<int64_t>::min());
+            uint64_t unsigned_value = 0;
+            REQUIRE(parse_integer("18446744073709551615\n", unsigned_value));
+            REQUIRE(unsigned_value == numeric_limits<uint64_t>::max());
+        }
+    }
+    GIVEN("invalid integers") {
+        THEN("they are not parsed and the value is unchanged") {
+            int64_t value = 7;
+            REQUIRE_FALSE(parse_integer("", value));
+            REQUIRE_FALSE(parse_integer("  ", value));
+            REQUIRE_FALSE(parse_integer("-", value));
+            REQUIRE_FALSE(parse_integer("12ab", value));
+            REQUIRE_FALSE(parse_integer("1 2", value));
+            REQUIRE_FALSE(parse_integer("9223372036854775808", value));
+            REQUIRE(value == 7);
+            uint64_t unsigned_value = 7;
+            REQUIRE_FALSE(parse_integer("-1", unsigned_value));
+            REQUIRE_FALSE(parse_integer("18446744073709551616", unsigned_value));
+            REQUIRE(unsigned_value == 7);
+        }
+    }
+}
+
+SCENARIO("parsing floating point numbers") {
+    GIVEN("valid numbers") {
+        THEN("they are parsed") {
+            double value = 0;
+            REQUIRE(parse_double("0.25", value));
+            REQUIRE(value == 0.25);
+            REQUIRE(parse_double(" -3 ", value));
+            REQUIRE(value == -3.0);
+            REQUIRE(parse_double("1.5e3", value));
+            REQUIRE(value == 1500.0);
+            REQUIRE(parse_double(".5", value));
+            REQUIRE(value == 0.5);
+            REQUIRE(parse_double("0.1", value));
+            REQUIRE(value == 0.1);
+            REQUIRE(parse_double("12345678901234567890123", value));
+            REQUIRE(value == 12345678901234567890123.0);
+            REQUIRE(parse_double("0." + string(80, '0') + "1e81", value));
+            REQUIRE(value == 1.0);
+        }
+    }
+    GIVEN("invalid numbers") {
+        THEN("they are not parsed and the value is unchanged") {
+            double value = 7;
+            REQUIRE_FALSE(parse_double("", value));
+            REQUIRE_FALSE(parse_double(".", value));
+            REQUIRE_FALSE(parse_double("1.2.3", value));
+            REQUIRE_FALSE(parse_double("1e", value));
+            REQUIRE_FALSE(parse_double("nan", value));
+            REQUIRE(value == 7);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include <catch.hpp>
+#include <internal/util/string_scan.hpp>
+#include <facter/util/string.hpp>
+#include <string>
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("scanning strings for special bytes") {
+    GIVEN("strings with a special byte at every offset") {
+        THEN("the first special byte should be found regardless of its offset") {
+            for (size_t length = 1; length < 70; ++length) {
+                for (size_t offset = 0; offset < length; ++offset) {
+                    string str(length, 'a');
+                    str[offset] = '"';
+                    REQUIRE(find_escape(str.data(), str.data() + str.size()) == str.data() + offset);
+                    str[offset] = '\r';
+                    REQUIRE(find_newline(str.data(), str.data() + str.size()) == str.data() + offset);
+                    str[offset] = '#';
+                    REQUIRE(find_plain_special(str.data(), str.data() + str.size()) == str.data() + offset);
+                    REQUIRE(find_not_digit(str.data(), str.data() + str.size()) == str.data());
+                    string digits(length, '7');
+                    digits[offset] = '/';
+                    REQUIRE(find_not_digit(digits.data(), digits.data() + digits.size()) == digits.data() + offset);
+                }
+            }
+        }
+    }
+    GIVEN("strings without special bytes") {
+        string clean = "the quick brown fox jumps over the lazy dog \xc3\xa9\xe2\x82\xac\xff~";
+        string digits = "0123456789012345678901234567890123456789";
+        THEN("the end of the string should be returned") {
+            REQUIRE(find_escape(clean.data(), clean.data() + clean.size()) == clean.data() + clean.size());
+            REQUIRE(find_plain_special(clean.data(), clean.data() + clean.size()) == clean.data() + clean.size());
+            REQUIRE(find_newline(clean.data(), clean.data() + clean.size()) == clean.data() + clean.size());
+            REQUIRE(find_not_digit(digits.data(), digits.data() + digits.size()) == digits.data() + digits.size());
+        }
+    }
+    GIVEN("each byte value in a long string") {
+        THEN("only the expected bytes should be found") {
+            for (int byte = 0; byte < 256; ++byte) {
+                string str(40, ' ');
+                str[33] = static_cast<char>(byte);
+                auto c = static_cast<unsigned char>(byte);
+                bool control = c < 0x20 || c == 0x7f;
+                auto found = find_escape(str.data(), str.data() + str.size()) != str.data() + str.size();
+                REQUIRE(found == (control || c == '"' || c == '\\'));
+                found = find_plain_special(str.data(), str.data() + str.size()) != str.data() + str.size();
+                REQUIRE(found == (control || c == ':' || c == '#'));
+                found = find_newline(str.data(), str.data() + str.size()) != str.data() + str.size();
+                REQUIRE(found == (c == '\n' || c == '\r'));
+                string digits(40, '0');
+                digits[33] = static_cast<char>(byte);
+                found = find_not_digit(digits.data(), digits.data() + digits.size()) != digits.data() + digits.size();
+                REQUIRE(found == (c < '0' || c > '9'));
+            }
+        }
+    }
+}
+
+SCENARIO("checking strings for YAML quotation") {
+    REQUIRE(needs_quotation(""));
+    REQUIRE(needs_quotation("12345678901234567890123456789012345"));
+    REQUIRE(needs_quotation("-1234567890123456789.0123456789"));
+    REQUIRE(needs_quotation("+1,5"));
+    REQUIRE(needs_quotation("-"));
+    REQUIRE_FALSE(needs_quotation("1.2.3"));
+    REQUIRE_FALSE(needs_quotation("12345678901234567890123456789x"));
+    REQUIRE_FALSE(needs_quotation("1-2"));
+    REQUIRE_FALSE(needs_quotation("foo"));
+}
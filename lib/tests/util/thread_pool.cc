@@ -0,0 +1,95 @@
+#include <catch.hpp>
+#include <internal/util/thread_pool.hpp>
+#include <internal/util/scoped_deadline.hpp>
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+using namespace facter::util;
+
+SCENARIO("running tasks in a task group") {
+    thread_pool pool(2);
+    atomic<int> count(0);
+    GIVEN("many tasks") {
+        task_group group(pool);
+        for (int i = 0; i < 1000; ++i) {
+            group.run([&]() { ++count; });
+        }
+        group.wait();
+        THEN("every task runs") {
+            REQUIRE(count == 1000);
+        }
+    }
+    GIVEN("tasks that wait for groups of their own") {
+        // More waiting tasks than threads: the waiting tasks run their own groups' tasks
+        task_group group(pool);
+        for (int i = 0; i < 8; ++i) {
+            group.run([&]() {
+                task_group nested(pool);
+                for (int j = 0; j < 10; ++j) {
+                    nested.run([&]() { ++count; });
+                }
+                nested.wait();
+            });
+        }
+        group.wait();
+        THEN("every task runs") {
+            REQUIRE(count == 80);
+        }
+    }
+    GIVEN("a task that throws") {
+        task_group group(pool);
+        group.run([&]() { ++count; });
+        group.run([]() { throw runtime_error("failed"); });
+        THEN("waiting throws the exception once the other tasks finish") {
+            REQUIRE_THROWS_AS(group.wait(), runtime_error);
+            REQUIRE(count == 1);
+            group.wait();
+        }
+    }
+    GIVEN("a cancelled group") {
+        task_group group(pool);
+        group.cancel();
+        group.run([&]() { ++count; });
+        THEN("its tasks are abandoned") {
+            REQUIRE_THROWS_AS(group.wait(), deadline_exceeded_exception);
+            REQUIRE(count == 0);
+        }
+    }
+    GIVEN("a token shared by groups") {
+        cancellation_token token;
+        task_group first(pool, token);
+        task_group second(pool, token);
+        first.run([&]() {
+            token.cancel();
+            if (scoped_deadline::expired()) {
+                ++count;
+            }
+        });
+        first.wait();
+        second.run([&]() { ++count; });
+        THEN("cancelling it is seen by running tasks and abandons the tasks of every group") {
+            REQUIRE(count == 1);
+            REQUIRE_THROWS_AS(second.wait(), deadline_exceeded_exception);
+            REQUIRE(count == 1);
+        }
+    }
+    GIVEN("a group whose deadline has passed") {
+        task_group group(pool, cancellation_token(), chrono::steady_clock::now());
+        group.run([&]() { ++count; });
+        THEN("its tasks are abandoned") {
+            REQUIRE_THROWS_AS(group.wait(), deadline_exceeded_exception);
+            REQUIRE(count == 0);
+        }
+    }
+}
+
+SCENARIO("growing a thread pool") {
+    thread_pool pool(1);
+    REQUIRE(pool.size() == 1);
+    pool.reserve(4);
+    REQUIRE(pool.size() == 4);
+    pool.reserve(2);
+    REQUIRE(pool.size() == 4);
+    REQUIRE(thread_pool::default_size() >= 1);
+}
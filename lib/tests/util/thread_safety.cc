@@ -0,0 +1,107 @@
+#include <catch.hpp>
+#include <facter/util/environment.hpp>
+#include <facter/logging/logging.hpp>
+#include <internal/util/async_streambuf.hpp>
+#include <internal/util/dynamic_library.hpp>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace facter::util;
+
+// Catch's assertions aren't thread-safe, so the threads count failures and the test checks the counts after joining
+
+static void run_threads(int count, function<void(int)> const& body)
+{
+    vector<boost::thread> threads;
+    for (int i = 0; i < count; ++i) {
+        threads.emplace_back([&body, i]() { body(i); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+SCENARIO("using the environment from many threads", "[thread-safety]") {
+    string path;
+    REQUIRE(environment::get("PATH", path));
+    atomic<int> failures(0);
+    GIVEN("threads setting, getting, and clearing variables") {
+        run_threads(8, [&](int thread) {
+            string name = "FACTER_THREAD_SAFETY_" + boost::lexical_cast<string>(thread);
+            for (int i = 0; i < 200; ++i) {
+                string expected = boost::lexical_cast<string>(i);
+                string value;
+                if (!environment::set(name, expected) || !environment::get(name, value) || value != expected) {
+                    ++failures;
+                }
+                environment::each("FACTER_THREAD_SAFETY_", [](string&, string&) { return true; });
+                if (!environment::clear(name)) {
+                    ++failures;
+                }
+            }
+        });
+        THEN("every thread sees its own changes") {
+            REQUIRE(failures == 0);
+        }
+    }
+    GIVEN("threads searching paths while PATH changes") {
+        run_threads(4, [&](int thread) {
+            for (int i = 0; i < 200; ++i) {
+                if (thread == 0) {
+                    environment::set("PATH", i % 2 ? path : path + environment::get_path_separator() + "/facter/thread/safety");
+                    continue;
+                }
+                auto const& paths = environment::search_paths();
+                if (paths.empty() || paths.front().empty()) {
+                    ++failures;
+                }
+            }
+        });
+        environment::set("PATH", path);
+        THEN("the paths are always complete") {
+            REQUIRE(failures == 0);
+        }
+    }
+}
+
+SCENARIO("logging from many threads", "[thread-safety]") {
+    ostringstream target;
+    {
+        async_streambuf buffer(target, 16);
+        ostream out(&buffer);
+        run_threads(4, [&](int thread) {
+            for (int i = 0; i < 100; ++i) {
+                facter::logging::log(facter::logging::level::debug, "thread safety");
+                facter::logging::is_enabled(facter::logging::level::info);
+                out << "thread " << thread << " line " << i << '\n';
+            }
+        });
+        buffer.drain();
+    }
+    string written = target.str();
+    REQUIRE(count(written.begin(), written.end(), '\n') == 400);
+}
+
+SCENARIO("finding dynamic libraries from many threads", "[thread-safety]") {
+    atomic<int> found(0);
+    run_threads(4, [&](int) {
+        for (int i = 0; i < 50; ++i) {
+            auto library = dynamic_library::find_by_symbol("malloc");
+            if (library.loaded()) {
+                ++found;
+            }
+        }
+    });
+#ifdef _WIN32
+    // Windows can't find libraries by symbol
+    REQUIRE(found == 0);
+#else
+    REQUIRE(found == 200);
+#endif
+}
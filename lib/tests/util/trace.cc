@@ -0,0 +1,88 @@
+#include <catch.hpp>
+#include <facter/util/trace.hpp>
+#include <facter/util/file.hpp>
+#include <internal/util/scoped_trace_span.hpp>
+#include <rapidjson/document.h>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
+
+using namespace std;
+using namespace facter::util;
+namespace fs = boost::filesystem;
+
+struct temp_trace_file
+{
+    temp_trace_file() :
+        _path((fs::temp_directory_path() / fs::unique_path("facter-trace-%%%%-%%%%.json")).string())
+    {
+    }
+
+    ~temp_trace_file()
+    {
+        boost::system::error_code ec;
+        fs::remove(_path, ec);
+    }
+
+    string _path;
+};
+
+SCENARIO("tracing a run") {
+    GIVEN("spans recorded while tracing") {
+        start_trace();
+        REQUIRE(scoped_trace_span::enabled());
+        {
+            scoped_trace_span resolving("resolver", "kernel");
+            scoped_trace_span executing("process", "uname", "command", "/bin/uname -a");
+        }
+        scoped_trace_span::record_async("http", "http://169.254.169.254/", chrono::steady_clock::now(), "method", "GET");
+        boost::thread other([]() {
+            scoped_trace_span resolving("resolver", "networking");
+        });
+        other.join();
+
+        temp_trace_file file;
+        REQUIRE(write_trace(file._path));
+        rapidjson::Document document;
+        document.Parse<0>(file::read(file._path).c_str());
+        REQUIRE_FALSE(document.HasParseError());
+        REQUIRE(document.IsObject());
+        REQUIRE(document.HasMember("traceEvents"));
+        auto const& events = document["traceEvents"];
+        REQUIRE(events.IsArray());
+
+        map<string, rapidjson::Value const*> spans;
+        map<int, string> threads;
+        for (rapidjson::SizeType i = 0; i < events.Size(); ++i) {
+            auto const& event = events[i];
+            string phase = event["ph"].GetString();
+            if (phase == "M") {
+                threads[event["tid"].GetInt()] = event["args"]["name"].GetString();
+            } else if (phase != "e") {
+                spans[event["name"].GetString()] = &event;
+            }
+        }
+        THEN("the calling thread and the other thread should have their own tracks") {
+            REQUIRE(threads.size() == 2u);
+            REQUIRE(threads[1] == "main");
+            REQUIRE(threads[2] == "thread 2");
+            REQUIRE((*spans["networking"])["tid"].GetInt() == 2);
+        }
+        THEN("nested spans should be complete events") {
+            REQUIRE(spans.count("kernel") == 1u);
+            auto const& kernel = *spans["kernel"];
+            REQUIRE(string(kernel["cat"].GetString()) == "resolver");
+            REQUIRE(string(kernel["ph"].GetString()) == "X");
+            REQUIRE(kernel["tid"].GetInt() == 1);
+            auto const& uname = *spans["uname"];
+            REQUIRE(string(uname["args"]["command"].GetString()) == "/bin/uname -a");
+            REQUIRE(uname["ts"].GetInt64() >= kernel["ts"].GetInt64());
+            REQUIRE(uname["dur"].GetInt64() <= kernel["dur"].GetInt64());
+        }
+        THEN("overlapping spans should be async events") {
+            auto const& request = *spans["http://169.254.169.254/"];
+            REQUIRE(string(request["ph"].GetString()) == "b");
+            REQUIRE(string(request["args"]["method"].GetString()) == "GET");
+        }
+    }
+}